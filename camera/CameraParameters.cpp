@@ -184,52 +184,221 @@ CameraParameters::~CameraParameters()
 
 String8 CameraParameters::flatten() const
 {
-    String8 flattened("");
     size_t size = mMap.size();
+    if (size == 0) {
+        return String8("");
+    }
 
+    // Size the string up front instead of growing it for every key and value.
+    size_t length = 0;
     for (size_t i = 0; i < size; i++) {
-        String8 k, v;
-        k = mMap.keyAt(i);
-        v = mMap.valueAt(i);
+        length += mMap.keyAt(i).length() + mMap.valueAt(i).length() + 2; // '=' and ';'
+    }
+    length--; // No ';' after the last value
 
-        flattened += k;
-        flattened += "=";
-        flattened += v;
+    String8 flattened;
+    char *dst = flattened.lockBuffer(length);
+    for (size_t i = 0; i < size; i++) {
+        const String8 &k = mMap.keyAt(i);
+        const String8 &v = mMap.valueAt(i);
+
+        memcpy(dst, k.string(), k.length());
+        dst += k.length();
+        *dst++ = '=';
+        memcpy(dst, v.string(), v.length());
+        dst += v.length();
         if (i != size-1)
-            flattened += ";";
+            *dst++ = ';';
     }
+    flattened.unlockBuffer(length);
 
     return flattened;
 }
 
+// The keys defined above, hashed for lookup by unflatten(). Known keys in a flattened
+// string share these strings instead of each allocating one.
+namespace {
+
+class KnownKeys {
+public:
+    static const KnownKeys &get();
+
+    // Returns the known key equal to key[0, length), or NULL.
+    const String8 *find(const char *key, size_t length) const;
+
+    size_t size() const { return mKeys.size(); }
+
+private:
+    KnownKeys();
+
+    static uint32_t hash(const char *key, size_t length);
+
+    // Open addressing with linear probing. Each slot holds 1 + an index into mKeys, or 0.
+    static const size_t kSlotCount = 256;
+    Vector<String8> mKeys;
+    uint8_t mSlots[kSlotCount];
+};
+
+const char *const kKnownKeys[] = {
+    CameraParameters::KEY_PREVIEW_SIZE,
+    CameraParameters::KEY_SUPPORTED_PREVIEW_SIZES,
+    CameraParameters::KEY_PREVIEW_FORMAT,
+    CameraParameters::KEY_SUPPORTED_PREVIEW_FORMATS,
+    CameraParameters::KEY_PREVIEW_FRAME_RATE,
+    CameraParameters::KEY_SUPPORTED_PREVIEW_FRAME_RATES,
+    CameraParameters::KEY_PREVIEW_FPS_RANGE,
+    CameraParameters::KEY_SUPPORTED_PREVIEW_FPS_RANGE,
+    CameraParameters::KEY_PICTURE_SIZE,
+    CameraParameters::KEY_SUPPORTED_PICTURE_SIZES,
+    CameraParameters::KEY_PICTURE_FORMAT,
+    CameraParameters::KEY_SUPPORTED_PICTURE_FORMATS,
+    CameraParameters::KEY_JPEG_THUMBNAIL_WIDTH,
+    CameraParameters::KEY_JPEG_THUMBNAIL_HEIGHT,
+    CameraParameters::KEY_SUPPORTED_JPEG_THUMBNAIL_SIZES,
+    CameraParameters::KEY_JPEG_THUMBNAIL_QUALITY,
+    CameraParameters::KEY_JPEG_QUALITY,
+    CameraParameters::KEY_ROTATION,
+    CameraParameters::KEY_GPS_LATITUDE,
+    CameraParameters::KEY_GPS_LONGITUDE,
+    CameraParameters::KEY_GPS_ALTITUDE,
+    CameraParameters::KEY_GPS_TIMESTAMP,
+    CameraParameters::KEY_GPS_PROCESSING_METHOD,
+    CameraParameters::KEY_WHITE_BALANCE,
+    CameraParameters::KEY_SUPPORTED_WHITE_BALANCE,
+    CameraParameters::KEY_EFFECT,
+    CameraParameters::KEY_SUPPORTED_EFFECTS,
+    CameraParameters::KEY_ANTIBANDING,
+    CameraParameters::KEY_SUPPORTED_ANTIBANDING,
+    CameraParameters::KEY_SCENE_MODE,
+    CameraParameters::KEY_SUPPORTED_SCENE_MODES,
+    CameraParameters::KEY_FLASH_MODE,
+    CameraParameters::KEY_SUPPORTED_FLASH_MODES,
+    CameraParameters::KEY_FOCUS_MODE,
+    CameraParameters::KEY_SUPPORTED_FOCUS_MODES,
+    CameraParameters::KEY_MAX_NUM_FOCUS_AREAS,
+    CameraParameters::KEY_FOCUS_AREAS,
+    CameraParameters::KEY_FOCAL_LENGTH,
+    CameraParameters::KEY_HORIZONTAL_VIEW_ANGLE,
+    CameraParameters::KEY_VERTICAL_VIEW_ANGLE,
+    CameraParameters::KEY_EXPOSURE_COMPENSATION,
+    CameraParameters::KEY_MAX_EXPOSURE_COMPENSATION,
+    CameraParameters::KEY_MIN_EXPOSURE_COMPENSATION,
+    CameraParameters::KEY_EXPOSURE_COMPENSATION_STEP,
+    CameraParameters::KEY_AUTO_EXPOSURE_LOCK,
+    CameraParameters::KEY_AUTO_EXPOSURE_LOCK_SUPPORTED,
+    CameraParameters::KEY_AUTO_WHITEBALANCE_LOCK,
+    CameraParameters::KEY_AUTO_WHITEBALANCE_LOCK_SUPPORTED,
+    CameraParameters::KEY_MAX_NUM_METERING_AREAS,
+    CameraParameters::KEY_METERING_AREAS,
+    CameraParameters::KEY_ZOOM,
+    CameraParameters::KEY_MAX_ZOOM,
+    CameraParameters::KEY_ZOOM_RATIOS,
+    CameraParameters::KEY_ZOOM_SUPPORTED,
+    CameraParameters::KEY_SMOOTH_ZOOM_SUPPORTED,
+    CameraParameters::KEY_FOCUS_DISTANCES,
+    CameraParameters::KEY_VIDEO_FRAME_FORMAT,
+    CameraParameters::KEY_VIDEO_SIZE,
+    CameraParameters::KEY_SUPPORTED_VIDEO_SIZES,
+    CameraParameters::KEY_PREFERRED_PREVIEW_SIZE_FOR_VIDEO,
+    CameraParameters::KEY_MAX_NUM_DETECTED_FACES_HW,
+    CameraParameters::KEY_MAX_NUM_DETECTED_FACES_SW,
+    CameraParameters::KEY_RECORDING_HINT,
+    CameraParameters::KEY_VIDEO_SNAPSHOT_SUPPORTED,
+    CameraParameters::KEY_VIDEO_STABILIZATION,
+    CameraParameters::KEY_VIDEO_STABILIZATION_SUPPORTED,
+    CameraParameters::KEY_LIGHTFX,
+};
+
+const KnownKeys &KnownKeys::get()
+{
+    static const KnownKeys *keys = new KnownKeys();
+    return *keys;
+}
+
+KnownKeys::KnownKeys()
+{
+    static_assert(sizeof(kKnownKeys) / sizeof(kKnownKeys[0]) < kSlotCount / 2,
+            "too many known keys for the hash table");
+    memset(mSlots, 0, sizeof(mSlots));
+    mKeys.setCapacity(sizeof(kKnownKeys) / sizeof(kKnownKeys[0]));
+    for (const char *key : kKnownKeys) {
+        size_t length = strlen(key);
+        size_t slot = hash(key, length) & (kSlotCount - 1);
+        while (mSlots[slot] != 0) {
+            slot = (slot + 1) & (kSlotCount - 1);
+        }
+        mSlots[slot] = (uint8_t)(mKeys.add(String8(key, length)) + 1);
+    }
+}
+
+uint32_t KnownKeys::hash(const char *key, size_t length)
+{
+    // FNV-1a over the length and a few characters spread across the key. Hashing every
+    // character costs more than the allocation a lookup saves.
+    const uint8_t samples[] = { (uint8_t)length, (uint8_t)key[0], (uint8_t)key[length / 4],
+            (uint8_t)key[length / 2], (uint8_t)key[length - 1] };
+    uint32_t h = 2166136261u;
+    for (uint8_t sample : samples) {
+        h = (h ^ sample) * 16777619u;
+    }
+    return h;
+}
+
+const String8 *KnownKeys::find(const char *key, size_t length) const
+{
+    if (length == 0) {
+        return NULL;
+    }
+    size_t slot = hash(key, length) & (kSlotCount - 1);
+    while (mSlots[slot] != 0) {
+        const String8 &k = mKeys.itemAt(mSlots[slot] - 1);
+        if (k.length() == length && memcmp(k.string(), key, length) == 0) {
+            return &k;
+        }
+        slot = (slot + 1) & (kSlotCount - 1);
+    }
+    return NULL;
+}
+
+} // namespace
+
 void CameraParameters::unflatten(const String8 &params)
 {
+    const KnownKeys &knownKeys = KnownKeys::get();
     const char *a = params.string();
     const char *b;
 
     mMap.clear();
 
+    // Strings usually carry about as many keys as CameraParameters defines, and need at
+    // least two characters per key. Reserving for that avoids a counting pass.
+    size_t capacity = (params.length() + 1) / 2;
+    mMap.setCapacity(capacity < knownKeys.size() ? capacity : knownKeys.size());
+
+    // Single pass over the string: each key and value is located in place, values are
+    // copied once, and known keys share the strings in KnownKeys.
     for (;;) {
         // Find the bounds of the key name.
         b = strchr(a, '=');
         if (b == 0)
             break;
+        const char *key = a;
+        size_t keyLength = (size_t)(b-a);
 
-        // Create the key string.
-        String8 k(a, (size_t)(b-a));
-
-        // Find the value.
+        // Find the value. If there's no semicolon, this is the last item.
         a = b+1;
         b = strchr(a, ';');
-        if (b == 0) {
-            // If there's no semicolon, this is the last item.
-            String8 v(a);
-            mMap.add(k, v);
-            break;
+        String8 v = b ? String8(a, (size_t)(b-a)) : String8(a);
+
+        const String8 *knownKey = knownKeys.find(key, keyLength);
+        if (knownKey != NULL) {
+            mMap.add(*knownKey, v);
+        } else {
+            mMap.add(String8(key, keyLength), v);
         }
 
-        String8 v(a, (size_t)(b-a));
-        mMap.add(k, v);
+        if (b == 0)
+            break;
         a = b+1;
     }
 }
@@ -36,20 +36,33 @@ CameraParameters2::~CameraParameters2()
 
 String8 CameraParameters2::flatten() const
 {
-    String8 flattened("");
     size_t size = mMap.size();
+    if (size == 0) {
+        return String8("");
+    }
 
+    // Size the string up front instead of growing it for every key and value.
+    size_t length = 0;
     for (size_t i = 0; i < size; i++) {
-        String8 k, v;
-        k = mMap.keyAt(i);
-        v = mMap.valueAt(i);
+        length += mMap.keyAt(i).length() + mMap.valueAt(i).length() + 2; // '=' and ';'
+    }
+    length--; // No ';' after the last value
 
-        flattened += k;
-        flattened += "=";
-        flattened += v;
+    String8 flattened;
+    char *dst = flattened.lockBuffer(length);
+    for (size_t i = 0; i < size; i++) {
+        const String8 &k = mMap.keyAt(i);
+        const String8 &v = mMap.valueAt(i);
+
+        memcpy(dst, k.string(), k.length());
+        dst += k.length();
+        *dst++ = '=';
+        memcpy(dst, v.string(), v.length());
+        dst += v.length();
         if (i != size-1)
-            flattened += ";";
+            *dst++ = ';';
     }
+    flattened.unlockBuffer(length);
 
     ALOGV("%s: Flattened params = %s", __FUNCTION__, flattened.string());
 
@@ -63,6 +76,13 @@ void CameraParameters2::unflatten(const String8 &params)
 
     mMap.clear();
 
+    // Reserve room for every pair so the map is not regrown while parsing.
+    size_t count = 1;
+    for (const char *c = strchr(a, ';'); c != NULL; c = strchr(c + 1, ';')) {
+        count++;
+    }
+    mMap.setCapacity(count);
+
     for (;;) {
         // Find the bounds of the key name.
         b = strchr(a, '=');
@@ -123,7 +143,7 @@ void CameraParameters2::setFloat(const char *key, float value)
 
 const char *CameraParameters2::get(const char *key) const
 {
-    ssize_t idx = mMap.indexOfKey(String8(key));
+    ssize_t idx = mMap.indexOfKey(key);
     if (idx < 0) {
         return NULL;
     } else {
@@ -159,8 +179,8 @@ status_t CameraParameters2::compareSetOrder(const char *key1, const char *key2,
         return BAD_VALUE;
     }
 
-    ssize_t index1 = mMap.indexOfKey(String8(key1));
-    ssize_t index2 = mMap.indexOfKey(String8(key2));
+    ssize_t index1 = mMap.indexOfKey(key1);
+    ssize_t index2 = mMap.indexOfKey(key2);
     if (index1 < 0) {
         ALOGW("%s: Key1 (%s) was not set", __FUNCTION__, key1);
         return NAME_NOT_FOUND;
@@ -150,6 +150,25 @@ private:
                 return NAME_NOT_FOUND;
         }
 
+        // Lookup by C string, without building a temporary key
+        ssize_t indexOfKey(const char* key) const {
+                size_t keyLength = strlen(key);
+                size_t vectorIdx = 0;
+                for (; vectorIdx < mList.size(); ++vectorIdx) {
+                    const KeyT& candidate = mList[vectorIdx].mKey;
+                    if (candidate.length() == keyLength &&
+                            memcmp(candidate.string(), key, keyLength) == 0) {
+                        return (ssize_t) vectorIdx;
+                    }
+                }
+
+                return NAME_NOT_FOUND;
+        }
+
+        void setCapacity(size_t capacity) {
+            mList.setCapacity(capacity);
+        }
+
         ssize_t removeItem(const KeyT& key) {
             ssize_t vectorIdx = indexOfKey(key);
 
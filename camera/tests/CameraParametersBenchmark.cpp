@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Cost of CameraParameters::unflatten() and flatten() on the parameter strings API1 passes
+ * across binder in getParameters()/setParameters().
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <camera/CameraParameters.h>
+#include <utils/String8.h>
+
+using namespace android;
+
+// What Camera2Client reports for a 12MP back camera, as flattened by CameraParameters.
+static const char kCamera2ClientParams[] =
+        "antibanding=auto;antibanding-values=off,50hz,60hz,auto;"
+        "auto-exposure-lock=false;auto-exposure-lock-supported=true;"
+        "auto-whitebalance-lock=false;auto-whitebalance-lock-supported=true;"
+        "effect=none;effect-values=none,mono,negative,solarize,sepia,posterize,aqua;"
+        "exposure-compensation=0;exposure-compensation-step=0.166667;"
+        "flash-mode=off;flash-mode-values=off,auto,on,torch,red-eye;"
+        "focal-length=4.38;focus-areas=(0,0,0,0,0);"
+        "focus-distances=0.095,0.95,Infinity;focus-mode=continuous-picture;"
+        "focus-mode-values=auto,infinity,macro,continuous-video,continuous-picture;"
+        "horizontal-view-angle=65.2;jpeg-quality=95;jpeg-thumbnail-height=240;"
+        "jpeg-thumbnail-quality=95;jpeg-thumbnail-size-values=0x0,320x240,320x180,256x144;"
+        "jpeg-thumbnail-width=320;max-exposure-compensation=12;max-num-detected-faces-hw=10;"
+        "max-num-detected-faces-sw=0;max-num-focus-areas=1;max-num-metering-areas=1;"
+        "max-zoom=99;metering-areas=(0,0,0,0,0);min-exposure-compensation=-12;"
+        "picture-format=jpeg;picture-format-values=jpeg;picture-size=4032x3024;"
+        "picture-size-values=4032x3024,4000x3000,3264x2448,3200x2400,2976x2976,2592x1944,"
+        "2048x1536,1920x1080,1600x1200,1280x960,1280x720,1024x768,800x600,720x480,"
+        "640x480,352x288,320x240,176x144;"
+        "preferred-preview-size-for-video=1920x1080;preview-format=yuv420sp;"
+        "preview-format-values=yuv420sp,yuv420p;preview-fps-range=15000,30000;"
+        "preview-fps-range-values=(15000,15000),(15000,30000),(24000,24000),(30000,30000);"
+        "preview-frame-rate=30;preview-frame-rate-values=15,24,30;preview-size=1920x1080;"
+        "preview-size-values=1920x1080,1600x1200,1440x1080,1280x960,1280x768,1280x720,"
+        "1024x768,800x600,864x480,800x480,720x480,640x480,480x640,352x288,320x240,176x144;"
+        "recording-hint=false;rotation=0;scene-mode=auto;"
+        "scene-mode-values=auto,action,portrait,landscape,night,night-portrait,theatre,"
+        "beach,snow,sunset,steadyphoto,fireworks,sports,party,candlelight,hdr;"
+        "smooth-zoom-supported=false;vertical-view-angle=51.3;video-frame-format=android-opaque;"
+        "video-size=1920x1080;video-size-values=3840x2160,1920x1080,1280x720,720x480,"
+        "640x480,352x288,320x240,176x144;video-snapshot-supported=true;"
+        "video-stabilization=false;video-stabilization-supported=true;whitebalance=auto;"
+        "whitebalance-values=auto,incandescent,fluorescent,warm-fluorescent,daylight,"
+        "cloudy-daylight,twilight,shade;zoom=0;"
+        "zoom-ratios=100,102,104,107,109,112,114,117,120,123,125,128,131,135,138,141,144,148,"
+        "151,155,158,162,166,170,174,178,182,186,191,195,200,204,209,214,219,224,229,235,240,"
+        "246,251,257,263,270,276,282,289,296,303,310,317,324,332,340,348,356,364,373,381,390,"
+        "400;zoom-supported=true";
+
+// A legacy HAL1 string: the standard keys in the HAL's own order, plus vendor keys that
+// CameraParameters does not define.
+static const char kLegacyHalParams[] =
+        "preview-size=1280x720;preview-size-values=1280x720,800x480,768x432,720x480,640x480,"
+        "576x432,480x320,384x288,352x288,320x240,240x160,176x144;preview-format=yuv420sp;"
+        "preview-format-values=yuv420sp,yuv420sp-adreno,yuv420p,nv12;preview-frame-rate=30;"
+        "preview-frame-rate-values=15,24,30;preview-fps-range=7500,30000;"
+        "preview-fps-range-values=(7500,30000),(30000,30000);picture-size=3264x2448;"
+        "picture-size-values=3264x2448,3264x1836,2592x1944,2048x1536,1920x1080,1600x1200,"
+        "1280x768,1280x720,1024x768,800x600,640x480,320x240;picture-format=jpeg;"
+        "picture-format-values=jpeg,raw;jpeg-quality=85;jpeg-thumbnail-width=512;"
+        "jpeg-thumbnail-height=288;jpeg-thumbnail-quality=90;"
+        "jpeg-thumbnail-size-values=512x288,480x288,432x288,512x384,352x288,0x0;"
+        "whitebalance=auto;whitebalance-values=auto,incandescent,fluorescent,daylight,"
+        "cloudy-daylight;effect=none;effect-values=none,mono,negative,solarize,sepia,"
+        "posterize,whiteboard,blackboard,aqua,emboss,sketch,neon;antibanding=off;"
+        "antibanding-values=off,50hz,60hz,auto;scene-mode=auto;scene-mode-values=auto,"
+        "asd,action,portrait,landscape,night,night-portrait,theatre,beach,snow,sunset,"
+        "steadyphoto,fireworks,sports,party,candlelight,backlight,flowers,AR,hdr;"
+        "flash-mode=off;flash-mode-values=off,auto,on,torch;focus-mode=auto;"
+        "focus-mode-values=auto,infinity,normal,macro,continuous-picture,continuous-video;"
+        "max-num-focus-areas=1;focus-areas=(0,0,0,0,0);focal-length=3.49;"
+        "horizontal-view-angle=54.8;vertical-view-angle=42.5;exposure-compensation=0;"
+        "max-exposure-compensation=12;min-exposure-compensation=-12;"
+        "exposure-compensation-step=0.166667;auto-exposure-lock=false;"
+        "auto-exposure-lock-supported=true;auto-whitebalance-lock=false;"
+        "auto-whitebalance-lock-supported=true;max-num-metering-areas=5;"
+        "metering-areas=(0,0,0,0,0);zoom=0;max-zoom=59;zoom-ratios=100,102,104,107,109,"
+        "112,114,117,120,123,125,128,131,135,138,141,144,148,151,155,158,162,166,170,174,"
+        "178,182,186,190,195,200,204,209,214,219,224,229,235,240,246,251,257,263,270,276,"
+        "282,289,296,303,310,317,324,332,340,348,356,364,373,381,390,400;"
+        "zoom-supported=true;smooth-zoom-supported=false;focus-distances=1.2,2.5,Infinity;"
+        "video-size=1920x1080;video-size-values=1920x1080,1280x720,800x480,720x480,640x480,"
+        "480x320,352x288,320x240,176x144;preferred-preview-size-for-video=1280x720;"
+        "max-num-detected-faces-hw=2;max-num-detected-faces-sw=0;recording-hint=false;"
+        "video-snapshot-supported=true;video-stabilization=false;"
+        "video-stabilization-supported=true;iso=auto;iso-values=auto,ISO_HJR,ISO100,ISO200,"
+        "ISO400,ISO800,ISO1600;auto-exposure=frame-average;"
+        "auto-exposure-values=frame-average,center-weighted,spot-metering;"
+        "denoise=denoise-on;denoise-values=denoise-off,denoise-on;lensshade=enable;"
+        "lensshade-values=enable,disable;sharpness=10;max-sharpness=30;contrast=5;"
+        "max-contrast=10;saturation=5;max-saturation=10;skinToneEnhancement=0;"
+        "selectable-zone-af=auto;selectable-zone-af-values=auto,spot-metering,"
+        "center-weighted,frame-average;face-detection=off;face-detection-values=off,on;"
+        "redeye-reduction=disable;redeye-reduction-values=enable,disable;"
+        "histogram=disable;histogram-values=enable,disable;hfr-size-values=800x480,640x480;"
+        "video-hfr=off;video-hfr-values=off,60,90,120;camera-mode=0;"
+        "capture-burst-exposures=;num-snaps-per-shutter=1;touch-af-aec=touch-off;"
+        "touch-af-aec-values=touch-off,touch-on;zsl=off;zsl-values=off,on";
+
+static const char *const kParams[] = { kCamera2ClientParams, kLegacyHalParams };
+
+// A new CameraParameters per call, as in CameraClient::setParameters() and
+// CameraHardwareInterface::getParameters()
+static void BM_Unflatten(benchmark::State& state) {
+    const String8 flattened(kParams[state.range(0)]);
+    while (state.KeepRunning()) {
+        CameraParameters params;
+        params.unflatten(flattened);
+        benchmark::DoNotOptimize(params);
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t) flattened.length());
+}
+
+static void BM_Flatten(benchmark::State& state) {
+    CameraParameters params;
+    params.unflatten(String8(kParams[state.range(0)]));
+    while (state.KeepRunning()) {
+        String8 flattened = params.flatten();
+        benchmark::DoNotOptimize(flattened);
+    }
+}
+
+// Args: index into kParams (0: Camera2Client, 1: legacy HAL with vendor keys)
+BENCHMARK(BM_Unflatten)->Arg(0)->Arg(1);
+BENCHMARK(BM_Flatten)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "CameraParametersTests"
+
+#include <camera/CameraParameters.h>
+#include <camera/CameraParameters2.h>
+#include <utils/String8.h>
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+using namespace android;
+
+// A representative subset of what an API1 HAL reports, in the sorted order
+// CameraParameters flattens to.
+static const char kSortedParams[] =
+        "antibanding=auto;antibanding-values=off,50hz,60hz,auto;"
+        "focus-areas=(0,0,0,0,0);focus-mode=continuous-picture;"
+        "focus-mode-values=auto,infinity,macro,continuous-video,continuous-picture;"
+        "jpeg-quality=95;picture-size=4032x3024;preview-format=yuv420sp;"
+        "preview-fps-range=15000,30000;preview-size=1920x1080;"
+        "preview-size-values=1920x1080,1280x720,640x480,320x240;zoom=0";
+
+TEST(CameraParametersTest, FlattenRoundTrip) {
+    CameraParameters params;
+    params.unflatten(String8(kSortedParams));
+
+    EXPECT_STREQ(kSortedParams, params.flatten().string());
+    EXPECT_STREQ("continuous-picture", params.get(CameraParameters::KEY_FOCUS_MODE));
+    EXPECT_EQ(95, params.getInt(CameraParameters::KEY_JPEG_QUALITY));
+
+    int width = 0, height = 0;
+    params.getPreviewSize(&width, &height);
+    EXPECT_EQ(1920, width);
+    EXPECT_EQ(1080, height);
+}
+
+TEST(CameraParametersTest, FlattenEmptyAndSingle) {
+    CameraParameters params;
+    EXPECT_STREQ("", params.flatten().string());
+
+    params.set(CameraParameters::KEY_ZOOM, 3);
+    EXPECT_STREQ("zoom=3", params.flatten().string());
+
+    params.unflatten(String8(""));
+    EXPECT_TRUE(params.isEmpty());
+}
+
+TEST(CameraParametersTest, UnflattenKeySpans) {
+    CameraParameters params;
+    // Unsorted input, a vendor key, keys that are prefixes of known keys or extend them,
+    // an empty value and a repeated key
+    params.unflatten(String8("zoom=2;vendor-mode=fast;preview=a;preview-sizes=b;"
+            "preview-size=640x480;scene-mode=;zoom=4"));
+
+    EXPECT_STREQ("preview=a;preview-size=640x480;preview-sizes=b;scene-mode=;"
+            "vendor-mode=fast;zoom=4", params.flatten().string());
+    EXPECT_STREQ("fast", params.get("vendor-mode"));
+    EXPECT_STREQ("a", params.get("preview"));
+    EXPECT_STREQ("b", params.get("preview-sizes"));
+    EXPECT_EQ(4, params.getInt(CameraParameters::KEY_ZOOM));
+
+    // A trailing key without a value is dropped, and a new string replaces every key
+    params.unflatten(String8("zoom=1;antibanding"));
+    EXPECT_STREQ("zoom=1", params.flatten().string());
+}
+
+TEST(CameraParameters2Test, FlattenKeepsSetOrder) {
+    CameraParameters2 params;
+    params.unflatten(String8(kSortedParams));
+    EXPECT_STREQ(kSortedParams, params.flatten().string());
+
+    // Setting a key again moves it to the end
+    params.set(CameraParameters::KEY_ANTIBANDING, CameraParameters::ANTIBANDING_60HZ);
+    String8 flattened = params.flatten();
+    const char *tail = strrchr(flattened.string(), ';');
+    ASSERT_NE(nullptr, tail);
+    EXPECT_STREQ(";antibanding=60hz", tail);
+
+    int order = 0;
+    ASSERT_EQ(OK, params.compareSetOrder(CameraParameters::KEY_PREVIEW_FPS_RANGE,
+            CameraParameters::KEY_ANTIBANDING, &order));
+    EXPECT_LT(order, 0);
+
+    EXPECT_STREQ("4032x3024", params.get(CameraParameters::KEY_PICTURE_SIZE));
+    EXPECT_EQ(nullptr, params.get("picture"));
+    EXPECT_EQ(nullptr, params.get("picture-size-values"));
+}
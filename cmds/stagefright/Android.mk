@@ -64,6 +64,7 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_C_INCLUDES:= \
         frameworks/av/media/libstagefright \
+        frameworks/av/media/libstagefright/webm \
         frameworks/native/include/media/openmax \
         frameworks/native/include/media/hardware
 
@@ -150,6 +151,31 @@ include $(BUILD_EXECUTABLE)
 
 include $(CLEAR_VARS)
 
+LOCAL_SRC_FILES:=               \
+        codec2.cpp              \
+
+LOCAL_SHARED_LIBRARIES := \
+        libstagefright liblog libutils libbinder libstagefright_foundation \
+        libmedia libstagefright_codec2 libstagefright_codec2_omxhost
+
+LOCAL_C_INCLUDES:= \
+        frameworks/av/media/libstagefright \
+        frameworks/av/media/libstagefright/codec2/include \
+        frameworks/av/media/libstagefright/codec2/vndk/include \
+        frameworks/native/include/media/openmax
+
+LOCAL_CFLAGS += -Wno-multichar -Werror -Wall
+
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE:= codec2
+
+include $(BUILD_EXECUTABLE)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
 LOCAL_SRC_FILES:= \
         filters/argbtorgba.rs \
         filters/nightvision.rs \
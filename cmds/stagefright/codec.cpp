@@ -47,7 +47,8 @@ static void usage(const char *me) {
                     "\t\t[-p] playback\n"
                     "\t\t[-S] allocate buffers from a surface\n"
                     "\t\t[-R] render output to surface (enables -S)\n"
-                    "\t\t[-T] use render timestamps (enables -R)\n",
+                    "\t\t[-T] use render timestamps (enables -R)\n"
+                    "\t\t[-F] decode audio to float PCM\n",
                     me);
     exit(1);
 }
@@ -63,6 +64,7 @@ struct CodecState {
     int64_t mNumBuffersDecoded;
     int64_t mNumBytesDecoded;
     bool mIsAudio;
+    sp<AMessage> mOutputFormat;
 };
 
 }  // namespace android
@@ -74,7 +76,8 @@ static int decode(
         bool useVideo,
         const android::sp<android::Surface> &surface,
         bool renderSurface,
-        bool useTimestamp) {
+        bool useTimestamp,
+        bool useFloat) {
     using namespace android;
 
     static int64_t kTimeout = 500ll;
@@ -125,12 +128,17 @@ static int decode(
 
         CHECK(state->mCodec != NULL);
 
+        if (isAudio && useFloat) {
+            format->setInt32("pcm-encoding", kAudioEncodingPcmFloat);
+        }
+
         err = state->mCodec->configure(
                 format, isVideo ? surface : NULL,
                 NULL /* crypto */,
                 0 /* flags */);
 
         CHECK_EQ(err, (status_t)OK);
+        CHECK_EQ((status_t)OK, state->mCodec->getOutputFormat(&state->mOutputFormat));
 
         state->mSignalledInputEOS = false;
         state->mSawOutputEOS = false;
@@ -297,10 +305,9 @@ static int decode(
 
                 ALOGV("got %zu output buffers", state->mOutBuffers.size());
             } else if (err == INFO_FORMAT_CHANGED) {
-                sp<AMessage> format;
-                CHECK_EQ((status_t)OK, state->mCodec->getOutputFormat(&format));
+                CHECK_EQ((status_t)OK, state->mCodec->getOutputFormat(&state->mOutputFormat));
 
-                ALOGV("INFO_FORMAT_CHANGED: %s", format->debugString().c_str());
+                ALOGV("INFO_FORMAT_CHANGED: %s", state->mOutputFormat->debugString().c_str());
             } else {
                 CHECK_EQ(err, -EAGAIN);
             }
@@ -309,16 +316,39 @@ static int decode(
 
     int64_t elapsedTimeUs = ALooper::GetNowUs() - startTimeUs;
 
+    int result = 0;
     for (size_t i = 0; i < stateByTrack.size(); ++i) {
         CodecState *state = &stateByTrack.editValueAt(i);
 
+        AString componentName;
+        CHECK_EQ((status_t)OK, state->mCodec->getName(&componentName));
         CHECK_EQ((status_t)OK, state->mCodec->release());
 
         if (state->mIsAudio) {
-            printf("track %zu: %lld bytes received. %.2f KB/sec\n",
+            int32_t pcmEncoding = kAudioEncodingPcm16bit;
+            int32_t numChannels, sampleRate;
+            (void)state->mOutputFormat->findInt32("pcm-encoding", &pcmEncoding);
+            CHECK(state->mOutputFormat->findInt32("channel-count", &numChannels));
+            CHECK(state->mOutputFormat->findInt32("sample-rate", &sampleRate));
+
+            size_t sampleSize = pcmEncoding == kAudioEncodingPcmFloat ? sizeof(float)
+                    : pcmEncoding == kAudioEncodingPcm8bit ? sizeof(uint8_t) : sizeof(int16_t);
+            int64_t numFrames = state->mNumBytesDecoded / (sampleSize * numChannels);
+
+            printf("track %zu (%s): %lld bytes received. %.2f KB/sec, "
+                    "%.1fx realtime, pcm-encoding %d\n",
                    i,
+                   componentName.c_str(),
                    (long long)state->mNumBytesDecoded,
-                   state->mNumBytesDecoded * 1E6 / 1024 / elapsedTimeUs);
+                   state->mNumBytesDecoded * 1E6 / 1024 / elapsedTimeUs,
+                   numFrames * 1E6 / sampleRate / elapsedTimeUs,
+                   pcmEncoding);
+
+            if (useFloat && pcmEncoding != kAudioEncodingPcmFloat) {
+                fprintf(stderr, "track %zu: expected float output, got pcm-encoding %d\n",
+                        i, pcmEncoding);
+                result = 1;
+            }
         } else {
             printf("track %zu: %lld frames decoded, %.2f fps. %lld"
                     " bytes received. %.2f KB/sec\n",
@@ -330,7 +360,7 @@ static int decode(
         }
     }
 
-    return 0;
+    return result;
 }
 
 int main(int argc, char **argv) {
@@ -344,9 +374,10 @@ int main(int argc, char **argv) {
     bool useSurface = false;
     bool renderSurface = false;
     bool useTimestamp = false;
+    bool useFloat = false;
 
     int res;
-    while ((res = getopt(argc, argv, "havpSDRT")) >= 0) {
+    while ((res = getopt(argc, argv, "havpSDRTF")) >= 0) {
         switch (res) {
             case 'a':
             {
@@ -363,6 +394,11 @@ int main(int argc, char **argv) {
                 playback = true;
                 break;
             }
+            case 'F':
+            {
+                useFloat = true;
+                break;
+            }
             case 'T':
             {
                 useTimestamp = true;
@@ -403,6 +439,8 @@ int main(int argc, char **argv) {
     sp<ALooper> looper = new ALooper;
     looper->start();
 
+    int result = 0;
+
     sp<SurfaceComposerClient> composerClient;
     sp<SurfaceControl> control;
     sp<Surface> surface;
@@ -450,8 +488,8 @@ int main(int argc, char **argv) {
         player->stop();
         player->reset();
     } else {
-        decode(looper, argv[0], useAudio, useVideo, surface, renderSurface,
-                useTimestamp);
+        result = decode(looper, argv[0], useAudio, useVideo, surface, renderSurface,
+                useTimestamp, useFloat);
     }
 
     if (playback || (useSurface && useVideo)) {
@@ -460,5 +498,5 @@ int main(int argc, char **argv) {
 
     looper->stop();
 
-    return 0;
+    return result;
 }
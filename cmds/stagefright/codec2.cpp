@@ -0,0 +1,443 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "codec2"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <binder/ProcessState.h>
+#include <media/MediaCodecBuffer.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/NuMediaExtractor.h>
+
+#include <C2AllocatorMemfd.h>
+#include <C2BufferPriv.h>
+#include <C2SoftOMXComponentHost.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-c component] use this software component\n"
+                    "\t\t[-b batch] number of works queued at once (default 8)\n"
+                    "\t\t[-n] do not decode through MediaCodec\n"
+                    "\t\t<file>\n",
+                    me);
+    exit(1);
+}
+
+namespace android {
+
+struct Sample {
+    sp<ABuffer> mData;
+    int64_t mTimeUs;
+    bool mCodecConfig;
+};
+
+struct DecodeStats {
+    int64_t mElapsedUs;
+    int64_t mNumInputs;
+    int64_t mNumOutputs;
+    int64_t mNumBytes;
+};
+
+static const char *componentForMime(const char *mime) {
+    static const struct {
+        const char *mMime;
+        const char *mComponent;
+    } kComponents[] = {
+        { MEDIA_MIMETYPE_AUDIO_AAC, "OMX.google.aac.decoder" },
+        { MEDIA_MIMETYPE_AUDIO_MPEG, "OMX.google.mp3.decoder" },
+        { MEDIA_MIMETYPE_AUDIO_AMR_NB, "OMX.google.amrnb.decoder" },
+        { MEDIA_MIMETYPE_AUDIO_AMR_WB, "OMX.google.amrwb.decoder" },
+        { MEDIA_MIMETYPE_AUDIO_VORBIS, "OMX.google.vorbis.decoder" },
+        { MEDIA_MIMETYPE_VIDEO_AVC, "OMX.google.h264.decoder" },
+        { MEDIA_MIMETYPE_VIDEO_HEVC, "OMX.google.hevc.decoder" },
+        { MEDIA_MIMETYPE_VIDEO_MPEG4, "OMX.google.mpeg4.decoder" },
+        { MEDIA_MIMETYPE_VIDEO_H263, "OMX.google.h263.decoder" },
+        { MEDIA_MIMETYPE_VIDEO_VP8, "OMX.google.vp8.decoder" },
+        { MEDIA_MIMETYPE_VIDEO_VP9, "OMX.google.vp9.decoder" },
+    };
+    for (size_t i = 0; i < NELEM(kComponents); ++i) {
+        if (!strcasecmp(mime, kComponents[i].mMime)) {
+            return kComponents[i].mComponent;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Reads all samples of the first audio or video track into memory, so that neither decode
+ * path is timed with the extractor. Codec specific data of the track format is returned
+ * as the leading codec config samples.
+ */
+static bool readSamples(
+        const char *path, sp<AMessage> *format, std::vector<Sample> *samples) {
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor;
+    if (extractor->setDataSource(NULL /* httpService */, path) != OK) {
+        fprintf(stderr, "unable to instantiate extractor.\n");
+        return false;
+    }
+
+    size_t i;
+    for (i = 0; i < extractor->countTracks(); ++i) {
+        CHECK_EQ((status_t)OK, extractor->getTrackFormat(i, format));
+
+        AString mime;
+        CHECK((*format)->findString("mime", &mime));
+        if (!strncasecmp(mime.c_str(), "audio/", 6) || !strncasecmp(mime.c_str(), "video/", 6)) {
+            break;
+        }
+    }
+    if (i == extractor->countTracks()) {
+        fprintf(stderr, "no audio or video track.\n");
+        return false;
+    }
+    CHECK_EQ((status_t)OK, extractor->selectTrack(i));
+
+    for (size_t j = 0;; ++j) {
+        AString key = AStringPrintf("csd-%zu", j);
+        sp<ABuffer> csd;
+        if (!(*format)->findBuffer(key.c_str(), &csd)) {
+            break;
+        }
+        samples->push_back({ csd, 0ll, true });
+    }
+
+    sp<ABuffer> buffer = new ABuffer(1024 * 1024);
+    for (;;) {
+        buffer->setRange(0, buffer->capacity());
+        if (extractor->readSampleData(buffer) != OK) {
+            break;
+        }
+        Sample sample;
+        sample.mData = ABuffer::CreateAsCopy(buffer->data(), buffer->size());
+        CHECK_EQ((status_t)OK, extractor->getSampleTime(&sample.mTimeUs));
+        sample.mCodecConfig = false;
+        samples->push_back(sample);
+        extractor->advance();
+    }
+    return true;
+}
+
+/**
+ * Decodes |samples| with the component |name| through MediaCodec (and so through the OMX
+ * service and ACodec.) MediaCodec submits the codec specific data of |format| on its own.
+ */
+static status_t decodeWithMediaCodec(
+        const sp<ALooper> &looper, const char *name, const sp<AMessage> &format,
+        const std::vector<Sample> &samples, DecodeStats *stats) {
+    static int64_t kTimeout = 500ll;
+
+    status_t err;
+    sp<MediaCodec> codec = MediaCodec::CreateByComponentName(looper, name, &err);
+    if (codec == NULL) {
+        return err;
+    }
+    err = codec->configure(format, NULL /* surface */, NULL /* crypto */, 0 /* flags */);
+    if (err != OK) {
+        codec->release();
+        return err;
+    }
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+    CHECK_EQ((status_t)OK, codec->start());
+
+    Vector<sp<MediaCodecBuffer> > inBuffers;
+    CHECK_EQ((status_t)OK, codec->getInputBuffers(&inBuffers));
+
+    size_t next = 0;
+    while (next < samples.size() && samples[next].mCodecConfig) {
+        ++next;
+    }
+    bool signalledInputEOS = false;
+    bool sawOutputEOS = false;
+    while (!sawOutputEOS) {
+        size_t index;
+        if (!signalledInputEOS && codec->dequeueInputBuffer(&index, kTimeout) == OK) {
+            if (next < samples.size()) {
+                const Sample &sample = samples[next++];
+                const sp<MediaCodecBuffer> &buffer = inBuffers.itemAt(index);
+                CHECK_LE(sample.mData->size(), buffer->capacity());
+                memcpy(buffer->base(), sample.mData->data(), sample.mData->size());
+                CHECK_EQ((status_t)OK, codec->queueInputBuffer(
+                        index, 0 /* offset */, sample.mData->size(), sample.mTimeUs,
+                        0 /* flags */));
+                ++stats->mNumInputs;
+            } else {
+                CHECK_EQ((status_t)OK, codec->queueInputBuffer(
+                        index, 0 /* offset */, 0 /* size */, 0ll /* timeUs */,
+                        MediaCodec::BUFFER_FLAG_EOS));
+                signalledInputEOS = true;
+            }
+        }
+
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        err = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags, kTimeout);
+        if (err == OK) {
+            if (size > 0) {
+                ++stats->mNumOutputs;
+                stats->mNumBytes += size;
+            }
+            CHECK_EQ((status_t)OK, codec->releaseOutputBuffer(index));
+            sawOutputEOS = (flags & MediaCodec::BUFFER_FLAG_EOS) != 0;
+        } else if (err != INFO_OUTPUT_BUFFERS_CHANGED && err != INFO_FORMAT_CHANGED) {
+            CHECK_EQ(err, -EAGAIN);
+        }
+    }
+
+    stats->mElapsedUs = ALooper::GetNowUs() - startTimeUs;
+    codec->release();
+    return OK;
+}
+
+/** Counts completed works and output, and releases them right away. */
+struct Listener : public C2ComponentListener {
+    Listener() : mNumWorks(0), mNumOutputs(0), mNumBytes(0), mNumCalls(0), mSawEOS(false) { }
+
+    virtual void onWorkDone(
+            std::weak_ptr<C2Component> component,
+            std::vector<std::unique_ptr<C2Work>> workItems) override {
+        (void)component;
+        std::lock_guard<std::mutex> lock(mLock);
+        ++mNumCalls;
+        for (const std::unique_ptr<C2Work> &work : workItems) {
+            ++mNumWorks;
+            const C2BufferPack &output = work->worklets.front()->output;
+            for (const std::shared_ptr<C2Buffer> &buffer : output.buffers) {
+                if (buffer == nullptr) {
+                    continue;
+                }
+                ++mNumOutputs;
+                for (const C2ConstLinearBlock &block : buffer->data().linearBlocks()) {
+                    mNumBytes += block.size();
+                }
+                for (const C2ConstGraphicBlock &block : buffer->data().graphicBlocks()) {
+                    mNumBytes += block.crop().mWidth * block.crop().mHeight * 3 / 2;
+                }
+            }
+            if (output.flags & BUFFERFLAG_END_OF_STREAM) {
+                mSawEOS = true;
+            }
+        }
+        mCondition.notify_all();
+    }
+
+    virtual void onTripped(
+            std::weak_ptr<C2Component> component,
+            std::vector<std::shared_ptr<C2SettingResult>> settingResult) override {
+        (void)component;
+        (void)settingResult;
+    }
+
+    virtual void onError(std::weak_ptr<C2Component> component, uint32_t errorCode) override {
+        (void)component;
+        ALOGE("component error %u", errorCode);
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    int64_t mNumWorks;
+    int64_t mNumOutputs;
+    int64_t mNumBytes;
+    int64_t mNumCalls;
+    bool mSawEOS;
+};
+
+/**
+ * Decodes |samples| with the component |name| hosted as a Codec2 component, queueing
+ * |batch| works at a time and keeping up to 4 batches in flight.
+ */
+static status_t decodeWithCodec2(
+        const char *name, const std::vector<Sample> &samples, size_t batch,
+        DecodeStats *stats, int64_t *numCallbacks) {
+    std::shared_ptr<Listener> listener = std::make_shared<Listener>();
+    std::shared_ptr<C2SoftOMXComponentHost> component;
+    status_t err = C2SoftOMXComponentHost::Create(name, listener, &component);
+    if (err != C2_OK) {
+        return err;
+    }
+
+    std::shared_ptr<C2BlockAllocator> allocator =
+            std::make_shared<C2PooledBlockAllocator>(std::make_shared<C2AllocatorMemfd>());
+    const C2MemoryUsage usage = { C2MemoryUsage::kSoftwareRead, C2MemoryUsage::kSoftwareWrite };
+    const int64_t maxInFlight = 4 * batch;
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+    CHECK_EQ((status_t)C2_OK, component->start());
+
+    for (size_t next = 0; next < samples.size();) {
+        std::list<std::unique_ptr<C2Work>> items;
+        for (; next < samples.size() && items.size() < batch; ++next) {
+            const Sample &sample = samples[next];
+            std::shared_ptr<C2LinearBlock> block;
+            CHECK_EQ((status_t)C2_OK, allocator->allocateLinearBlock(
+                    sample.mData->size(), usage, &block));
+            C2WriteView view = block->map().get();
+            memcpy(view.data(), sample.mData->data(), sample.mData->size());
+
+            std::unique_ptr<C2Work> work(new C2Work);
+            work->input.flags = sample.mCodecConfig ? BUFFERFLAG_CODEC_CONFIG : (flags_t)0;
+            work->input.ordinal.timestamp = sample.mTimeUs;
+            work->input.ordinal.frame_index = next;
+            work->input.ordinal.custom_ordinal = 0;
+            work->input.buffers.push_back(_C2BlockFactory::CreateLinearBuffer(
+                    { block->share(0, sample.mData->size(), C2Fence()) }));
+            work->worklets.emplace_back(new C2Worklet);
+            work->worklets_processed = 0;
+            items.push_back(std::move(work));
+            if (!sample.mCodecConfig) {
+                ++stats->mNumInputs;
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lock(listener->mLock);
+            listener->mCondition.wait(lock, [&] {
+                return (int64_t)next - listener->mNumWorks <= maxInFlight;
+            });
+        }
+        CHECK_EQ((status_t)C2_OK, component->queue_nb(&items));
+    }
+    CHECK_EQ((status_t)C2_OK, component->drain_nb(false /* drainThrough */));
+    {
+        std::unique_lock<std::mutex> lock(listener->mLock);
+        listener->mCondition.wait(lock, [&] { return listener->mSawEOS; });
+        stats->mNumOutputs = listener->mNumOutputs;
+        stats->mNumBytes = listener->mNumBytes;
+        *numCallbacks = listener->mNumCalls;
+    }
+
+    stats->mElapsedUs = ALooper::GetNowUs() - startTimeUs;
+    component->release();
+    return OK;
+}
+
+static void printStats(const char *path, const DecodeStats &stats) {
+    printf("%s: %" PRId64 " inputs, %" PRId64 " outputs (%" PRId64 " bytes) in %.2f ms, "
+            "%.2f inputs/sec, %.2f us/input\n",
+            path, stats.mNumInputs, stats.mNumOutputs, stats.mNumBytes,
+            stats.mElapsedUs / 1E3, stats.mNumInputs * 1E6 / stats.mElapsedUs,
+            (double)stats.mElapsedUs / stats.mNumInputs);
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+
+    const char *componentName = NULL;
+    size_t batch = 8;
+    bool useMediaCodec = true;
+
+    int res;
+    while ((res = getopt(argc, argv, "hc:b:n")) >= 0) {
+        switch (res) {
+            case 'c':
+                componentName = optarg;
+                break;
+
+            case 'b':
+            {
+                char *end;
+                unsigned long x = strtoul(optarg, &end, 10);
+                if (*end != '\0' || end == optarg || x == 0) {
+                    usage(me);
+                }
+                batch = x;
+                break;
+            }
+
+            case 'n':
+                useMediaCodec = false;
+                break;
+
+            case '?':
+            case 'h':
+            default:
+                usage(me);
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    sp<AMessage> format;
+    std::vector<Sample> samples;
+    if (!readSamples(argv[0], &format, &samples)) {
+        return 1;
+    }
+
+    AString mime;
+    CHECK(format->findString("mime", &mime));
+    if (componentName == NULL) {
+        componentName = componentForMime(mime.c_str());
+        if (componentName == NULL) {
+            fprintf(stderr, "no software decoder for %s.\n", mime.c_str());
+            return 1;
+        }
+    }
+    printf("%s: %zu samples of %s\n", componentName, samples.size(), mime.c_str());
+
+    if (useMediaCodec) {
+        sp<ALooper> looper = new ALooper;
+        looper->start();
+
+        DecodeStats stats = {};
+        status_t err = decodeWithMediaCodec(looper, componentName, format, samples, &stats);
+        if (err != OK) {
+            fprintf(stderr, "unable to decode through MediaCodec (%d).\n", err);
+            return 1;
+        }
+        printStats("omx", stats);
+
+        looper->stop();
+    }
+
+    DecodeStats stats = {};
+    int64_t numCallbacks = 0;
+    status_t err = decodeWithCodec2(componentName, samples, batch, &stats, &numCallbacks);
+    if (err != OK) {
+        fprintf(stderr, "unable to host %s as a Codec2 component (%d).\n", componentName, err);
+        return 1;
+    }
+    printStats("codec2", stats);
+    printf("codec2: %" PRId64 " onWorkDone calls for batches of %zu works\n",
+            numCallbacks, batch);
+
+    return 0;
+}
@@ -15,6 +15,7 @@
  */
 
 #include "SineSource.h"
+#include "WebmWriter.h"
 
 #include <inttypes.h>
 #include <sys/types.h>
@@ -30,6 +31,7 @@
 #include <media/stagefright/MediaCodecSource.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MetaData.h>
+#include <media/stagefright/MediaWriter.h>
 #include <media/stagefright/MPEG4Writer.h>
 #include <media/MediaPlayerInterface.h>
 
@@ -50,22 +52,26 @@ static void usage(const char *me) {
     fprintf(stderr, "       -t height in pixels (default: 144)\n");
     fprintf(stderr, "       -l encoder level. see omx il header (default: encoder specific)\n");
     fprintf(stderr, "       -p encoder profile. see omx il header (default: encoder specific)\n");
-    fprintf(stderr, "       -v video codec: [0] AVC [1] M4V [2] H263 (default: 0)\n");
+    fprintf(stderr, "       -v video codec: [0] AVC [1] M4V [2] H263 [3] VP8 [4] VP9 (default: 0)\n");
     fprintf(stderr, "       -s(oftware) prefer software codec\n");
-    fprintf(stderr, "       -o filename: output file (default: /sdcard/output.mp4)\n");
+    fprintf(stderr, "       -o filename: output file, MPEG4 or WebM for VP8 and VP9 (default: /sdcard/output.mp4 or /sdcard/output.webm)\n");
+    fprintf(stderr, "       -y filename: raw YUV420 input clip (default: synthetic frames)\n");
+    fprintf(stderr, "       -a lookahead in frames, for encoders supporting it (default: 0)\n");
     exit(1);
 }
 
 class DummySource : public MediaSource {
 
 public:
-    DummySource(int width, int height, int nFrames, int fps, int colorFormat)
+    DummySource(int width, int height, int nFrames, int fps, int colorFormat,
+                FILE *clip)
         : mWidth(width),
           mHeight(height),
           mMaxNumFrames(nFrames),
           mFrameRate(fps),
           mColorFormat(colorFormat),
-          mSize((width * height * 3) / 2) {
+          mSize((width * height * 3) / 2),
+          mClip(clip) {
 
         mGroup.add_buffer(new MediaBuffer(mSize));
     }
@@ -89,6 +95,10 @@ public:
         return OK;
     }
 
+    int64_t numFramesOutput() const {
+        return mNumFramesOutput;
+    }
+
     virtual status_t read(
             MediaBuffer **buffer, const MediaSource::ReadOptions *options __unused) {
 
@@ -104,6 +114,15 @@ public:
             return err;
         }
 
+        // Frames of a clip are read in the color format given to the encoder.
+        if (mClip != NULL) {
+            if (fread((*buffer)->data(), 1, mSize, mClip) != mSize) {
+                (*buffer)->release();
+                *buffer = NULL;
+                return ERROR_END_OF_STREAM;
+            }
+        }
+
         // We don't care about the contents. we just test video encoder
         // Also, by skipping the content generation, we can return from
         // read() much faster.
@@ -123,7 +142,11 @@ public:
     }
 
 protected:
-    virtual ~DummySource() {}
+    virtual ~DummySource() {
+        if (mClip != NULL) {
+            fclose(mClip);
+        }
+    }
 
 private:
     MediaBufferGroup mGroup;
@@ -132,6 +155,7 @@ private:
     int mFrameRate;
     int mColorFormat;
     size_t mSize;
+    FILE *mClip;
     int64_t mNumFramesOutput;;
 
     DummySource(const DummySource &);
@@ -174,12 +198,14 @@ int main(int argc, char **argv) {
     int level = -1;        // Encoder specific default
     int profile = -1;      // Encoder specific default
     int codec = 0;
-    const char *fileName = "/sdcard/output.mp4";
+    const char *fileName = NULL;
+    const char *clipFileName = NULL;
+    int lookahead = 0;
     bool preferSoftwareCodec = false;
 
     android::ProcessState::self()->startThreadPool();
     int res;
-    while ((res = getopt(argc, argv, "b:c:f:i:n:w:t:l:p:v:o:hs")) >= 0) {
+    while ((res = getopt(argc, argv, "b:c:f:i:n:w:t:l:p:v:o:y:a:hs")) >= 0) {
         switch (res) {
             case 'b':
             {
@@ -241,7 +267,7 @@ int main(int argc, char **argv) {
             case 'v':
             {
                 codec = atoi(optarg);
-                if (codec < 0 || codec > 2) {
+                if (codec < 0 || codec > 4) {
                     usage(argv[0]);
                 }
                 break;
@@ -253,6 +279,18 @@ int main(int argc, char **argv) {
                 break;
             }
 
+            case 'y':
+            {
+                clipFileName = optarg;
+                break;
+            }
+
+            case 'a':
+            {
+                lookahead = atoi(optarg);
+                break;
+            }
+
             case 's':
             {
                 preferSoftwareCodec = true;
@@ -268,9 +306,18 @@ int main(int argc, char **argv) {
         }
     }
 
+    FILE *clip = NULL;
+    if (clipFileName != NULL) {
+        clip = fopen(clipFileName, "rb");
+        if (clip == NULL) {
+            fprintf(stderr, "couldn't open clip %s\n", clipFileName);
+            return 1;
+        }
+    }
+
     status_t err = OK;
-    sp<MediaSource> source =
-        new DummySource(width, height, nFrames, frameRateFps, colorFormat);
+    sp<DummySource> source =
+        new DummySource(width, height, nFrames, frameRateFps, colorFormat, clip);
 
     sp<AMessage> enc_meta = new AMessage;
     switch (codec) {
@@ -280,6 +327,12 @@ int main(int argc, char **argv) {
         case 2:
             enc_meta->setString("mime", MEDIA_MIMETYPE_VIDEO_H263);
             break;
+        case 3:
+            enc_meta->setString("mime", MEDIA_MIMETYPE_VIDEO_VP8);
+            break;
+        case 4:
+            enc_meta->setString("mime", MEDIA_MIMETYPE_VIDEO_VP9);
+            break;
         default:
             enc_meta->setString("mime", MEDIA_MIMETYPE_VIDEO_AVC);
             break;
@@ -298,6 +351,9 @@ int main(int argc, char **argv) {
     if (profile != -1) {
         enc_meta->setInt32("profile", profile);
     }
+    if (lookahead > 0) {
+        enc_meta->setInt32("vendor.android.lookahead.value", lookahead);
+    }
 
     sp<ALooper> looper = new ALooper;
     looper->setName("recordvideo");
@@ -308,12 +364,22 @@ int main(int argc, char **argv) {
                 looper, enc_meta, source, NULL /* consumer */,
                 preferSoftwareCodec ? MediaCodecSource::FLAG_PREFER_SOFTWARE_CODEC : 0);
 
+    // MPEG4 does not carry VP8 and VP9
+    const bool webm = (codec == 3 || codec == 4);
+    if (fileName == NULL) {
+        fileName = webm ? "/sdcard/output.webm" : "/sdcard/output.mp4";
+    }
     int fd = open(fileName, O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
     if (fd < 0) {
         fprintf(stderr, "couldn't open file");
         return 1;
     }
-    sp<MPEG4Writer> writer = new MPEG4Writer(fd);
+    sp<MediaWriter> writer;
+    if (webm) {
+        writer = new WebmWriter(fd);
+    } else {
+        writer = new MPEG4Writer(fd);
+    }
     close(fd);
     writer->addSource(encoder);
     int64_t start = systemTime();
@@ -330,7 +396,10 @@ int main(int argc, char **argv) {
         fprintf(stderr, "record failed: %d\n", err);
         return 1;
     }
-    fprintf(stderr, "encoding %d frames in %" PRId64 " us\n", nFrames, (end-start)/1000);
-    fprintf(stderr, "encoding speed is: %.2f fps\n", (nFrames * 1E9) / (end-start));
+    // a clip may end before nFrames
+    int64_t numFrames = source->numFramesOutput();
+    fprintf(stderr, "encoding %" PRId64 " frames in %" PRId64 " us\n",
+            numFrames, (end-start)/1000);
+    fprintf(stderr, "encoding speed is: %.2f fps\n", (numFrames * 1E9) / (end-start));
     return 0;
 }
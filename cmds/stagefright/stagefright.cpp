@@ -401,6 +401,99 @@ static void playSource(sp<IMediaSource> &source) {
     }
 }
 
+// Decodes the first audio track of each file with a software decoder, as fast as possible,
+// requesting |framesPerBuffer| frames per input buffer from extractors that support packing
+// (kKeyFramesPerBuffer), and prints the total throughput.
+static int bulkDecode(int argc, char **argv, int32_t framesPerBuffer) {
+    int64_t startTimeUs = getNowUs();
+
+    int64_t totalDurationUs = 0;
+    int64_t totalBytes = 0;
+    int64_t totalBuffers = 0;
+    int numFiles = 0;
+
+    sp<MetaData> params = new MetaData;
+    params->setInt32(kKeyFramesPerBuffer, framesPerBuffer);
+
+    for (int k = 0; k < argc; ++k) {
+        const char *filename = argv[k];
+
+        sp<DataSource> dataSource =
+            DataSource::CreateFromURI(NULL /* httpService */, filename);
+        sp<IMediaExtractor> extractor;
+        if (dataSource != NULL) {
+            extractor = MediaExtractor::Create(dataSource);
+        }
+        if (extractor == NULL) {
+            fprintf(stderr, "%s: could not create extractor.\n", filename);
+            continue;
+        }
+
+        sp<IMediaSource> source;
+        for (size_t i = 0; i < extractor->countTracks(); ++i) {
+            sp<MetaData> meta = extractor->getTrackMetaData(i);
+            const char *mime;
+            if (meta != NULL && meta->findCString(kKeyMIMEType, &mime)
+                    && !strncasecmp(mime, "audio/", 6)) {
+                source = extractor->getTrack(i);
+                break;
+            }
+        }
+        if (source == NULL) {
+            fprintf(stderr, "%s: no audio track.\n", filename);
+            continue;
+        }
+
+        sp<IMediaSource> decSource = SimpleDecodingSource::Create(
+                source, MediaCodecList::kPreferSoftwareCodecs);
+        if (decSource == NULL || decSource->start(params.get()) != OK) {
+            fprintf(stderr, "%s: could not start decoder.\n", filename);
+            continue;
+        }
+
+        int32_t sampleRate = 0;
+        int32_t channelCount = 0;
+        int64_t bytes = 0;
+        for (;;) {
+            MediaBuffer *buffer;
+            status_t err = decSource->read(&buffer);
+            if (err == INFO_FORMAT_CHANGED) {
+                continue;
+            } else if (err != OK) {
+                break;
+            }
+
+            bytes += buffer->range_length();
+            ++totalBuffers;
+
+            buffer->release();
+            buffer = NULL;
+        }
+
+        sp<MetaData> format = decSource->getFormat();
+        if (format->findInt32(kKeySampleRate, &sampleRate)
+                && format->findInt32(kKeyChannelCount, &channelCount)
+                && sampleRate > 0 && channelCount > 0) {
+            totalDurationUs += bytes * 1000000ll / (sampleRate * channelCount * sizeof(int16_t));
+        }
+
+        decSource->stop();
+
+        totalBytes += bytes;
+        ++numFiles;
+    }
+
+    int64_t delayUs = getNowUs() - startTimeUs;
+
+    printf("decoded %d file(s), %.2f secs of audio in %.2f secs (%.1fx realtime)\n",
+           numFiles, totalDurationUs / 1E6, delayUs / 1E6,
+           delayUs > 0 ? (double)totalDurationUs / delayUs : 0.);
+    printf("%" PRId64 " output buffers, %" PRId64 " bytes, avg. %.2f usecs per buffer\n",
+           totalBuffers, totalBytes, totalBuffers > 0 ? (double)delayUs / totalBuffers : 0.);
+
+    return numFiles == argc ? 0 : 1;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 struct DetectSyncSource : public MediaSource {
@@ -624,6 +717,8 @@ static void usage(const char *me) {
     fprintf(stderr, "       -T allocate buffers from a surface texture\n");
     fprintf(stderr, "       -d(ump) output_filename (raw stream data to a file)\n");
     fprintf(stderr, "       -D(ump) output_filename (decoded PCM data to a file)\n");
+    fprintf(stderr, "       -B frames-per-buffer bulk decode audio of all files "
+                    "(packing frames in input buffers where supported)\n");
 }
 
 static void dumpCodecProfiles(bool queryDecoders) {
@@ -690,6 +785,7 @@ int main(int argc, char **argv) {
     bool dumpStream = false;
     bool dumpPCMStream = false;
     String8 dumpStreamFilename;
+    int32_t bulkFramesPerBuffer = 0;
     gNumRepetitions = 1;
     gMaxNumFrames = 0;
     gReproduceBug = -1;
@@ -702,7 +798,7 @@ int main(int argc, char **argv) {
     sp<ALooper> looper;
 
     int res;
-    while ((res = getopt(argc, argv, "haqn:lm:b:ptsrow:kxSTd:D:")) >= 0) {
+    while ((res = getopt(argc, argv, "haqn:lm:b:ptsrow:kxSTd:D:B:")) >= 0) {
         switch (res) {
             case 'a':
             {
@@ -740,6 +836,7 @@ int main(int argc, char **argv) {
             case 'm':
             case 'n':
             case 'b':
+            case 'B':
             {
                 char *end;
                 long x = strtol(optarg, &end, 10);
@@ -752,6 +849,8 @@ int main(int argc, char **argv) {
                     gNumRepetitions = x;
                 } else if (res == 'm') {
                     gMaxNumFrames = x;
+                } else if (res == 'B') {
+                    bulkFramesPerBuffer = x;
                 } else {
                     CHECK_EQ(res, 'b');
                     gReproduceBug = x;
@@ -839,6 +938,10 @@ int main(int argc, char **argv) {
     argc -= optind;
     argv += optind;
 
+    if (bulkFramesPerBuffer > 0) {
+        return bulkDecode(argc, argv, bulkFramesPerBuffer);
+    }
+
     if (extractThumbnail) {
         sp<IServiceManager> sm = defaultServiceManager();
         sp<IBinder> binder = sm->getService(String16("media.player"));
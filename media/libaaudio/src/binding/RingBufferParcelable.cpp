@@ -51,6 +51,18 @@ void RingBufferParcelable::setupMemory(int32_t sharedMemoryIndex,
     mDataParcelable.setup(sharedMemoryIndex, dataMemoryOffset, dataSizeInBytes);
 }
 
+void RingBufferParcelable::setupMemory(int32_t readCounterMemoryIndex,
+                 int32_t readCounterOffset,
+                 int32_t sharedMemoryIndex,
+                 int32_t dataMemoryOffset,
+                 int32_t dataSizeInBytes,
+                 int32_t writeCounterOffset,
+                 int32_t counterSizeBytes) {
+    mReadCounterParcelable.setup(readCounterMemoryIndex, readCounterOffset, counterSizeBytes);
+    mWriteCounterParcelable.setup(sharedMemoryIndex, writeCounterOffset, counterSizeBytes);
+    mDataParcelable.setup(sharedMemoryIndex, dataMemoryOffset, dataSizeInBytes);
+}
+
 int32_t RingBufferParcelable::getBytesPerFrame() {
     return mBytesPerFrame;
 }
@@ -43,6 +43,16 @@ public:
                      int32_t dataMemoryOffset,
                      int32_t dataSizeInBytes);
 
+    // The read counter is in its own SharedMemoryParcelable, while the data and write counter
+    // are shared with other readers, e.g. the clients of a shared capture endpoint.
+    void setupMemory(int32_t readCounterMemoryIndex,
+                     int32_t readCounterOffset,
+                     int32_t sharedMemoryIndex,
+                     int32_t dataMemoryOffset,
+                     int32_t dataSizeInBytes,
+                     int32_t writeCounterOffset,
+                     int32_t counterSizeBytes);
+
     int32_t getBytesPerFrame();
 
     void setBytesPerFrame(int32_t bytesPerFrame);
@@ -96,6 +96,11 @@ aaudio_result_t SharedMemoryParcelable::close() {
 aaudio_result_t SharedMemoryParcelable::resolveSharedMemory(const unique_fd& fd) {
     mResolvedAddress = (uint8_t *) mmap(0, mSizeInBytes, PROT_READ | PROT_WRITE,
                                         MAP_SHARED, fd.get(), 0);
+    if (mResolvedAddress == MMAP_UNRESOLVED_ADDRESS && errno == EPERM) {
+        // The service may share memory read-only, e.g. the capture data of a shared endpoint.
+        mResolvedAddress = (uint8_t *) mmap(0, mSizeInBytes, PROT_READ,
+                                            MAP_SHARED, fd.get(), 0);
+    }
     if (mResolvedAddress == MMAP_UNRESOLVED_ADDRESS) {
         ALOGE("SharedMemoryParcelable mmap() failed for fd = %d, errno = %s",
               fd.get(), strerror(errno));
@@ -18,6 +18,7 @@
 //#define LOG_NDEBUG 0
 #include <utils/Log.h>
 
+#include <algorithm>
 #include <cassert>
 #include <aaudio/AAudio.h>
 
@@ -42,8 +43,11 @@ AudioEndpoint::~AudioEndpoint()
 {
 }
 
+// If readOnly then the data and write counter may be mapped read-only, as for capture,
+// so only the read counter is tested for writing.
 static aaudio_result_t AudioEndpoint_validateQueueDescriptor(const char *type,
-                                                  const RingBufferDescriptor *descriptor) {
+                                                  const RingBufferDescriptor *descriptor,
+                                                  bool readOnly) {
     if (descriptor == nullptr) {
         ALOGE("AudioEndpoint_validateQueueDescriptor() NULL descriptor");
         return AAUDIO_ERROR_NULL;
@@ -78,11 +82,12 @@ static aaudio_result_t AudioEndpoint_validateQueueDescriptor(const char *type,
     // Try to READ from the data area.
     // This code will crash if the mmap failed.
     uint8_t value = descriptor->dataAddress[0];
-    ALOGV("AudioEndpoint_validateQueueDescriptor() dataAddress[0] = %d, then try to write",
-        (int) value);
-    // Try to WRITE to the data area.
-    descriptor->dataAddress[0] = value * 3;
-    ALOGV("AudioEndpoint_validateQueueDescriptor() wrote successfully");
+    ALOGV("AudioEndpoint_validateQueueDescriptor() dataAddress[0] = %d", (int) value);
+    if (!readOnly) {
+        // Try to WRITE to the data area.
+        descriptor->dataAddress[0] = value * 3;
+        ALOGV("AudioEndpoint_validateQueueDescriptor() wrote successfully");
+    }
 
     if (descriptor->readCounterAddress) {
         fifo_counter_t counter = *descriptor->readCounterAddress;
@@ -92,7 +97,7 @@ static aaudio_result_t AudioEndpoint_validateQueueDescriptor(const char *type,
         ALOGV("AudioEndpoint_validateQueueDescriptor() wrote readCounterAddress successfully");
     }
 
-    if (descriptor->writeCounterAddress) {
+    if (descriptor->writeCounterAddress && !readOnly) {
         fifo_counter_t counter = *descriptor->writeCounterAddress;
         ALOGV("AudioEndpoint_validateQueueDescriptor() *writeCounterAddress = %d, now write",
               (int) counter);
@@ -103,12 +108,14 @@ static aaudio_result_t AudioEndpoint_validateQueueDescriptor(const char *type,
     return AAUDIO_OK;
 }
 
-aaudio_result_t AudioEndpoint_validateDescriptor(const EndpointDescriptor *pEndpointDescriptor) {
+aaudio_result_t AudioEndpoint_validateDescriptor(const EndpointDescriptor *pEndpointDescriptor,
+                                                 aaudio_direction_t direction) {
     aaudio_result_t result = AudioEndpoint_validateQueueDescriptor("messages",
-                                    &pEndpointDescriptor->upMessageQueueDescriptor);
+                                    &pEndpointDescriptor->upMessageQueueDescriptor, false);
     if (result == AAUDIO_OK) {
         result = AudioEndpoint_validateQueueDescriptor("data",
-                                                &pEndpointDescriptor->dataQueueDescriptor);
+                                                &pEndpointDescriptor->dataQueueDescriptor,
+                                                direction == AAUDIO_DIRECTION_INPUT);
     }
     return result;
 }
@@ -116,7 +123,7 @@ aaudio_result_t AudioEndpoint_validateDescriptor(const EndpointDescriptor *pEndp
 aaudio_result_t AudioEndpoint::configure(const EndpointDescriptor *pEndpointDescriptor,
                                          aaudio_direction_t   direction)
 {
-    aaudio_result_t result = AudioEndpoint_validateDescriptor(pEndpointDescriptor);
+    aaudio_result_t result = AudioEndpoint_validateDescriptor(pEndpointDescriptor, direction);
     if (result != AAUDIO_OK) {
         ALOGE("AudioEndpoint_validateQueueDescriptor returned %d %s",
               result, AAudio_convertResultToText(result));
@@ -229,6 +236,25 @@ fifo_counter_t AudioEndpoint::getDataWriteCounter()
     return mDataQueue->getWriteCounter();
 }
 
+int32_t AudioEndpoint::skipOverrunFrames(int32_t guardFrames) {
+    // The writer does not wait for us, so frames older than the capacity were overwritten.
+    // The writer may also be writing its next burst over the oldest unread frames right now,
+    // before it advances the write counter, so treat a buffer filled to within guardFrames
+    // of its capacity as overrun too.
+    const int32_t capacity = getBufferCapacityInFrames();
+    int32_t framesAvailable = getFullFramesAvailable();
+    if (framesAvailable < capacity - guardFrames) {
+        return 0;
+    }
+    // Keep at most the buffer size, and leave room for the writer to be at least a
+    // guard band away from the oldest kept frame.
+    int32_t framesToKeep = std::min(getBufferSizeInFrames(), capacity - 2 * guardFrames);
+    framesToKeep = std::max(framesToKeep, 0);
+    int32_t framesToSkip = framesAvailable - framesToKeep;
+    advanceReadIndex(framesToSkip);
+    return framesToSkip;
+}
+
 int32_t AudioEndpoint::setBufferSizeInFrames(int32_t requestedFrames,
                                             int32_t *actualFrames)
 {
@@ -73,6 +73,15 @@ public:
 
     android::fifo_counter_t getDataWriteCounter();
 
+    /**
+     * If the writer has overwritten frames that were not read yet, or could be overwriting
+     * them now, then skip ahead so that only the most recent buffer of frames remains to be read.
+     * @param guardFrames frames the writer may write before it advances the write counter,
+     *        typically one burst
+     * @return number of frames skipped
+     */
+    int32_t skipOverrunFrames(int32_t guardFrames);
+
     /**
      * The result is not valid until after configure() is called.
      *
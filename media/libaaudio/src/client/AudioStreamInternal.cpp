@@ -249,6 +249,9 @@ aaudio_result_t AudioStreamInternal::requestStart()
 
     setState(AAUDIO_STREAM_STATE_STARTING);
     aaudio_result_t result = AAudioConvert_androidToAAudioResult(startWithStatus());
+    if (result == AAUDIO_OK) {
+        onStartedByService();
+    }
 
     startTime = AudioClock::getNanoseconds();
     mClockModel.start(startTime);
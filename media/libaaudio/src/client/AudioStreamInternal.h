@@ -120,6 +120,9 @@ protected:
 
     virtual void onFlushFromServer() {}
 
+    // Called after the service has started the stream, before the callback thread is launched.
+    virtual void onStartedByService() {}
+
     aaudio_result_t onEventFromServer(AAudioServiceMessage *message);
 
     aaudio_result_t onTimestampFromServer(AAudioServiceMessage *message);
@@ -65,8 +65,9 @@ aaudio_result_t AudioStreamInternalCapture::processDataNow(void *buffer, int32_t
         mAudioEndpoint.setDataWriteCounter(estimatedRemoteCounter);
     }
 
-    // If the write index passed the read index then consider it an overrun.
-    if (mAudioEndpoint.getEmptyFramesAvailable() < 0) {
+    // If the write index passed the read index, or the burst being written may overlap the
+    // oldest unread frames, then consider it an overrun and do not read those frames.
+    if (mAudioEndpoint.skipOverrunFrames(mFramesPerBurst) > 0) {
         mXRunCount++;
         if (ATRACE_ENABLED()) {
             ATRACE_INT("aaOverRuns", mXRunCount);
@@ -165,6 +166,7 @@ aaudio_result_t AudioStreamInternalCapture::readNowWithConversion(void *buffer,
 
     int32_t framesProcessed = numFrames - framesLeft;
     mAudioEndpoint.advanceReadIndex(framesProcessed);
+    mLastFramesRead = mAudioEndpoint.getDataReadCounter() + mFramesOffsetFromService;
 
     //ALOGD("AudioStreamInternalCapture::readNowWithConversion() returns %d", framesProcessed);
     return framesProcessed;
@@ -186,10 +188,17 @@ int64_t AudioStreamInternalCapture::getFramesWritten() {
 }
 
 int64_t AudioStreamInternalCapture::getFramesRead() {
-    int64_t frames = mAudioEndpoint.getDataWriteCounter()
-                               + mFramesOffsetFromService;
-    //ALOGD("AudioStreamInternalCapture::getFramesRead() returns %lld", (long long)frames);
-    return frames;
+    //ALOGD("AudioStreamInternalCapture::getFramesRead() returns %lld",
+    //      (long long)mLastFramesRead);
+    return mLastFramesRead;
+}
+
+void AudioStreamInternalCapture::onStartedByService() {
+    // A shared capture stream reads a ring shared by the whole endpoint, so its read counter
+    // is an endpoint position, and the service moves it past whatever was captured while the
+    // stream was not running.  Rebase the service positions so that this stream's positions
+    // start at 0 and continue from where they were when it stopped.
+    mFramesOffsetFromService = mLastFramesRead - mAudioEndpoint.getDataReadCounter();
 }
 
 // Read data from the stream and pass it to the callback for processing.
@@ -58,6 +58,8 @@ protected:
                                    int64_t currentTimeNanos,
                                    int64_t *wakeTimePtr) override;
 
+    void onStartedByService() override;
+
 private:
     /*
      * Asynchronous read with data conversion.
@@ -68,6 +70,7 @@ private:
     aaudio_result_t readNowWithConversion(void *buffer, int32_t numFrames);
 
     int64_t       mLastFramesWritten = 0; // used to prevent retrograde motion
+    int64_t       mLastFramesRead = 0;    // frames read by this stream, across stop and start
 };
 
 } /* namespace aaudio */
@@ -41,8 +41,8 @@ public:
         , mReadCounterAddress((std::atomic<fifo_counter_t> *) readCounterAddress)
         , mWriteCounterAddress((std::atomic<fifo_counter_t> *) writeCounterAddress)
     {
-        setReadCounter(0);
-        setWriteCounter(0);
+        // Do not reset the counters. They are zeroed by whoever allocates them,
+        // and may be shared with other readers or be read-only for us.
     }
     virtual ~FifoControllerIndirect() {};
 
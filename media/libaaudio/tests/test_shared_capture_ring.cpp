@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Test several readers of one capture ring, as used by a shared capture endpoint.
+
+#include <string.h>
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "binding/AAudioServiceDefinitions.h"
+#include "binding/AAudioServiceMessage.h"
+#include "client/AudioEndpoint.h"
+#include "fifo/FifoBuffer.h"
+
+using android::fifo_counter_t;
+using android::FifoBuffer;
+using namespace aaudio;
+
+#define FRAMES_PER_BURST   32
+#define CAPACITY_IN_FRAMES (8 * FRAMES_PER_BURST)
+#define NUM_MESSAGES       16
+
+// Frames contain a sequential index, which is easily checked.
+class CaptureRing {
+public:
+    CaptureRing()
+            : mWriter(sizeof(int32_t), CAPACITY_IN_FRAMES,
+                      &mReadCounter, &mWriteCounter, mData) {
+    }
+
+    void writeBursts(int32_t numBursts) {
+        int32_t burst[FRAMES_PER_BURST];
+        for (int32_t b = 0; b < numBursts; b++) {
+            for (int32_t i = 0; i < FRAMES_PER_BURST; i++) {
+                burst[i] = mNextIndex++;
+            }
+            // The writer never waits for readers, like AAudioServiceEndpointCapture.
+            fifo_counter_t writeCounter = mWriter.getWriteCounter();
+            memcpy(&mData[writeCounter % CAPACITY_IN_FRAMES], burst, sizeof(burst));
+            mWriter.setWriteCounter(writeCounter + FRAMES_PER_BURST);
+        }
+    }
+
+    // Same sharing as SharedRingBuffer::allocateReader().
+    FifoBuffer *createReader(fifo_counter_t *readCounter) {
+        FifoBuffer *reader = new FifoBuffer(sizeof(int32_t), CAPACITY_IN_FRAMES,
+                                            readCounter, &mWriteCounter, mData);
+        reader->setReadCounter(reader->getWriteCounter());
+        return reader;
+    }
+
+    void fillDescriptor(EndpointDescriptor *descriptor, fifo_counter_t *readCounter) {
+        memset(descriptor, 0, sizeof(*descriptor));
+        RingBufferDescriptor *messages = &descriptor->upMessageQueueDescriptor;
+        messages->dataAddress = (uint8_t *) mMessages;
+        messages->readCounterAddress = &mMessageReadCounter;
+        messages->writeCounterAddress = &mMessageWriteCounter;
+        messages->bytesPerFrame = sizeof(AAudioServiceMessage);
+        messages->capacityInFrames = NUM_MESSAGES;
+
+        RingBufferDescriptor *data = &descriptor->dataQueueDescriptor;
+        data->dataAddress = (uint8_t *) mData;
+        data->readCounterAddress = readCounter;
+        data->writeCounterAddress = &mWriteCounter;
+        data->bytesPerFrame = sizeof(int32_t);
+        data->framesPerBurst = FRAMES_PER_BURST;
+        data->capacityInFrames = CAPACITY_IN_FRAMES;
+    }
+
+    int32_t              mNextIndex = 0;
+
+private:
+    fifo_counter_t       mReadCounter = 0; // not used by the writer
+    fifo_counter_t       mWriteCounter = 0;
+    int32_t              mData[CAPACITY_IN_FRAMES];
+    FifoBuffer           mWriter;
+
+    fifo_counter_t       mMessageReadCounter = 0;
+    fifo_counter_t       mMessageWriteCounter = 0;
+    AAudioServiceMessage mMessages[NUM_MESSAGES];
+};
+
+static void checkRead(FifoBuffer *reader, int32_t numFrames, int32_t firstIndex) {
+    int32_t buffer[CAPACITY_IN_FRAMES];
+    ASSERT_LE(numFrames, CAPACITY_IN_FRAMES);
+    ASSERT_EQ(numFrames, reader->read(buffer, numFrames));
+    for (int32_t i = 0; i < numFrames; i++) {
+        ASSERT_EQ(firstIndex + i, buffer[i]);
+    }
+}
+
+TEST(test_shared_capture_ring, late_joining_reader) {
+    CaptureRing ring;
+    fifo_counter_t readCounter1 = 0;
+    fifo_counter_t readCounter2 = 0;
+    std::unique_ptr<FifoBuffer> reader1(ring.createReader(&readCounter1));
+
+    ring.writeBursts(3);
+    EXPECT_EQ(3 * FRAMES_PER_BURST, reader1->getFifoControllerBase()->getFullFramesAvailable());
+
+    // A reader that joins later only sees data written after it joined,
+    // and creating it does not disturb the other reader.
+    std::unique_ptr<FifoBuffer> reader2(ring.createReader(&readCounter2));
+    EXPECT_EQ(0, reader2->getFifoControllerBase()->getFullFramesAvailable());
+    EXPECT_EQ(3 * FRAMES_PER_BURST, reader1->getFifoControllerBase()->getFullFramesAvailable());
+
+    ring.writeBursts(2);
+    checkRead(reader1.get(), 5 * FRAMES_PER_BURST, 0);
+    checkRead(reader2.get(), 2 * FRAMES_PER_BURST, 3 * FRAMES_PER_BURST);
+
+    // Each reader advances independently.
+    ring.writeBursts(1);
+    checkRead(reader2.get(), FRAMES_PER_BURST, 5 * FRAMES_PER_BURST);
+    EXPECT_EQ(FRAMES_PER_BURST, reader1->getFifoControllerBase()->getFullFramesAvailable());
+    EXPECT_EQ(0, reader2->getFifoControllerBase()->getFullFramesAvailable());
+}
+
+TEST(test_shared_capture_ring, overrun) {
+    CaptureRing ring;
+    fifo_counter_t readCounter = 0;
+    EndpointDescriptor descriptor;
+    ring.fillDescriptor(&descriptor, &readCounter);
+
+    AudioEndpoint endpoint;
+    ASSERT_EQ(AAUDIO_OK, endpoint.configure(&descriptor, AAUDIO_DIRECTION_INPUT));
+    int32_t bufferSize = 0;
+    ASSERT_EQ(AAUDIO_OK, endpoint.setBufferSizeInFrames(2 * FRAMES_PER_BURST, &bufferSize));
+    ASSERT_EQ(2 * FRAMES_PER_BURST, bufferSize);
+
+    // More than the buffer size but within capacity, so nothing is lost or skipped.
+    ring.writeBursts(4);
+    EXPECT_EQ(0, endpoint.skipOverrunFrames(FRAMES_PER_BURST));
+    EXPECT_EQ(4 * FRAMES_PER_BURST, endpoint.getFullFramesAvailable());
+
+    // The writer laps the reader by two bursts.
+    ring.writeBursts(6);
+    EXPECT_EQ(10 * FRAMES_PER_BURST, endpoint.getFullFramesAvailable());
+    EXPECT_EQ(8 * FRAMES_PER_BURST, endpoint.skipOverrunFrames(FRAMES_PER_BURST));
+    EXPECT_EQ(bufferSize, endpoint.getFullFramesAvailable());
+
+    // Only the most recent frames remain, in order.
+    android::WrappingBuffer wrappingBuffer;
+    int32_t expected = ring.mNextIndex - bufferSize;
+    endpoint.getFullFramesAvailable(&wrappingBuffer);
+    for (int part = 0; part < android::WrappingBuffer::SIZE; part++) {
+        const int32_t *data = (const int32_t *) wrappingBuffer.data[part];
+        for (int32_t i = 0; i < wrappingBuffer.numFrames[part]; i++) {
+            ASSERT_EQ(expected++, data[i]);
+        }
+    }
+    EXPECT_EQ(ring.mNextIndex, expected);
+}
+
+TEST(test_shared_capture_ring, overrun_guard_band) {
+    CaptureRing ring;
+    fifo_counter_t readCounter = 0;
+    EndpointDescriptor descriptor;
+    ring.fillDescriptor(&descriptor, &readCounter);
+
+    AudioEndpoint endpoint;
+    ASSERT_EQ(AAUDIO_OK, endpoint.configure(&descriptor, AAUDIO_DIRECTION_INPUT));
+    int32_t bufferSize = 0;
+    ASSERT_EQ(AAUDIO_OK, endpoint.setBufferSizeInFrames(CAPACITY_IN_FRAMES, &bufferSize));
+    ASSERT_EQ(CAPACITY_IN_FRAMES, bufferSize);
+
+    // More than a burst of free space, so the next burst cannot overlap unread frames.
+    ring.writeBursts(6);
+    EXPECT_EQ(0, endpoint.skipOverrunFrames(FRAMES_PER_BURST));
+
+    // Within a burst of capacity: the burst being written may already overlap the oldest
+    // frames, so those are skipped even though the write counter has not lapped the reader.
+    ring.writeBursts(1);
+    EXPECT_EQ(7 * FRAMES_PER_BURST, endpoint.getFullFramesAvailable());
+    EXPECT_EQ(FRAMES_PER_BURST, endpoint.skipOverrunFrames(FRAMES_PER_BURST));
+    EXPECT_EQ(CAPACITY_IN_FRAMES - 2 * FRAMES_PER_BURST, endpoint.getFullFramesAvailable());
+
+    // Exactly full.
+    ring.writeBursts(2);
+    EXPECT_EQ(CAPACITY_IN_FRAMES, endpoint.getFullFramesAvailable());
+    EXPECT_EQ(2 * FRAMES_PER_BURST, endpoint.skipOverrunFrames(FRAMES_PER_BURST));
+
+    // The remaining frames are the most recent ones, in order.
+    android::WrappingBuffer wrappingBuffer;
+    int32_t expected = ring.mNextIndex - (CAPACITY_IN_FRAMES - 2 * FRAMES_PER_BURST);
+    endpoint.getFullFramesAvailable(&wrappingBuffer);
+    for (int part = 0; part < android::WrappingBuffer::SIZE; part++) {
+        const int32_t *data = (const int32_t *) wrappingBuffer.data[part];
+        for (int32_t i = 0; i < wrappingBuffer.numFrames[part]; i++) {
+            ASSERT_EQ(expected++, data[i]);
+        }
+    }
+    EXPECT_EQ(ring.mNextIndex, expected);
+}
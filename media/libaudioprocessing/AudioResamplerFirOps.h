@@ -43,6 +43,19 @@ namespace android {
 #define USE_SSE (false)
 #endif
 
+// AVX2 kernels are built with a function target attribute and selected at runtime,
+// as AVX2 is not part of the x86 ABI.
+#if USE_SSE && (defined(__clang__) || defined(__GNUC__))
+#ifndef USE_AVX2
+#define USE_AVX2 (true)
+#endif
+#else
+#define USE_AVX2 (false)
+#endif
+#if USE_AVX2
+#include <immintrin.h>
+#endif
+
 template<typename T, typename U>
 struct is_same
 {
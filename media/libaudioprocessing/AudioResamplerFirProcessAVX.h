@@ -0,0 +1,572 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_RESAMPLER_FIR_PROCESS_AVX_H
+#define ANDROID_AUDIO_RESAMPLER_FIR_PROCESS_AVX_H
+
+namespace android {
+
+// depends on AudioResamplerFirOps.h, AudioResamplerFirProcess.h,
+// AudioResamplerFirProcessSSE.h
+
+#if USE_AVX2
+
+//
+// AVX2 specializations are enabled for Process() and ProcessL() in AudioResamplerFirProcess.h
+//
+// The x86 ABI only guarantees SSSE3, so the AVX2 kernels are compiled with a function
+// target attribute and selected at runtime.  When AVX2 is not present the float variants
+// fall back to the SSE kernels and the integer variants fall back to ProcessBase().
+//
+// The integer kernels are bit-exact with ProcessBase() (all accumulation is modulo 2^32,
+// so the summation order does not matter).  The float kernels differ from ProcessBase()
+// only in summation order, similar to the SSE and NEON kernels.
+//
+// A stride of 16 means halfNumCoefs is a multiple of 8, so each loop iteration
+// consumes 8 positive and 8 negative coefficients.
+//
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+static inline bool cpuSupportsAvx2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+// reverses the order of 8 floats or int32s
+AVX2_TARGET static inline __m256i avx2ReverseIndex()
+{
+    return _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+}
+
+// splits 8 interleaved stereo float frames (two registers) into L and R registers
+template <bool REVERSE>
+AVX2_TARGET static inline void avx2Deinterleave(__m256 first, __m256 second,
+        __m256& left, __m256& right)
+{
+    // for REVERSE, first holds the earlier frames, but the result starts from the latest frame.
+    const __m256i index = REVERSE ? _mm256_setr_epi32(6, 4, 2, 0, 7, 5, 3, 1)
+                                  : _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    first = _mm256_permutevar8x32_ps(first, index);   // L L L L R R R R
+    second = _mm256_permutevar8x32_ps(second, index); // L L L L R R R R
+    if (REVERSE) {
+        left = _mm256_permute2f128_ps(second, first, 0x20);
+        right = _mm256_permute2f128_ps(second, first, 0x31);
+    } else {
+        left = _mm256_permute2f128_ps(first, second, 0x20);
+        right = _mm256_permute2f128_ps(first, second, 0x31);
+    }
+}
+
+AVX2_TARGET static inline float avx2HorizontalSum(__m256 acc)
+{
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+}
+
+AVX2_TARGET static inline int32_t avx2HorizontalSum(__m256i acc)
+{
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+template <int CHANNELS, int STRIDE, bool FIXED>
+AVX2_TARGET static void ProcessAVX2Intrinsic(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    static_assert(CHANNELS == 1 || CHANNELS == 2, "CHANNELS must be 1 or 2");
+
+    sP -= CHANNELS*(8-1);   // adjust sP for a loop iteration of eight
+
+    __m256 interp;
+    if (!FIXED) {
+        interp = _mm256_set1_ps(lerpP);
+    }
+
+    __m256 accL, accR;
+    accL = _mm256_setzero_ps();
+    if (CHANNELS == 2) {
+        accR = _mm256_setzero_ps();
+    }
+
+    do {
+        __m256 posCoef = _mm256_loadu_ps(coefsP);
+        __m256 negCoef = _mm256_loadu_ps(coefsN);
+        coefsP += 8;
+        coefsN += 8;
+
+        if (!FIXED) { // interpolate
+            __m256 posCoef1 = _mm256_loadu_ps(coefsP1);
+            __m256 negCoef1 = _mm256_loadu_ps(coefsN1);
+            coefsP1 += 8;
+            coefsN1 += 8;
+
+            // Calculate the final coefficient for interpolation
+            // posCoef = interp * (posCoef1 - posCoef) + posCoef
+            // negCoef = interp * (negCoef - negCoef1) + negCoef1
+            posCoef1 = _mm256_sub_ps(posCoef1, posCoef);
+            negCoef = _mm256_sub_ps(negCoef, negCoef1);
+
+            posCoef1 = _mm256_mul_ps(posCoef1, interp);
+            negCoef = _mm256_mul_ps(negCoef, interp);
+
+            posCoef = _mm256_add_ps(posCoef1, posCoef);
+            negCoef = _mm256_add_ps(negCoef, negCoef1);
+        }
+        switch (CHANNELS) {
+        case 1: {
+            __m256 posSamp = _mm256_loadu_ps(sP);
+            __m256 negSamp = _mm256_loadu_ps(sN);
+            sP -= 8;
+            sN += 8;
+
+            posSamp = _mm256_permutevar8x32_ps(posSamp, avx2ReverseIndex());
+            posSamp = _mm256_mul_ps(posSamp, posCoef);
+            negSamp = _mm256_mul_ps(negSamp, negCoef);
+
+            accL = _mm256_add_ps(accL, posSamp);
+            accL = _mm256_add_ps(accL, negSamp);
+        } break;
+        case 2: {
+            __m256 posSampL, posSampR, negSampL, negSampR;
+            avx2Deinterleave<true>(_mm256_loadu_ps(sP), _mm256_loadu_ps(sP + 8),
+                    posSampL, posSampR);
+            avx2Deinterleave<false>(_mm256_loadu_ps(sN), _mm256_loadu_ps(sN + 8),
+                    negSampL, negSampR);
+            sP -= 16;
+            sN += 16;
+
+            posSampL = _mm256_mul_ps(posSampL, posCoef);
+            posSampR = _mm256_mul_ps(posSampR, posCoef);
+            negSampL = _mm256_mul_ps(negSampL, negCoef);
+            negSampR = _mm256_mul_ps(negSampR, negCoef);
+
+            accL = _mm256_add_ps(accL, posSampL);
+            accR = _mm256_add_ps(accR, posSampR);
+            accL = _mm256_add_ps(accL, negSampL);
+            accR = _mm256_add_ps(accR, negSampR);
+        } break;
+        }
+    } while (count -= 8);
+
+    // multiply by volume and save
+    const float l = avx2HorizontalSum(accL);
+    const float r = CHANNELS == 2 ? avx2HorizontalSum(accR) : l;
+    out[0] += l * volumeLR[0];
+    out[1] += r * volumeLR[1];
+}
+
+// loads 8 coefficients as int32 lanes
+AVX2_TARGET static inline __m256i avx2LoadCoefs(const int16_t* coefs)
+{
+    return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(coefs)));
+}
+
+AVX2_TARGET static inline __m256i avx2LoadCoefs(const int32_t* coefs)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(coefs));
+}
+
+// interpolate<int16_t, uint32_t>(): (int16(lerp) * int16(coef1 - coef0) >> 15) + coef0
+AVX2_TARGET static inline __m256i avx2Interpolate(const int16_t* coefs0, const int16_t* coefs1,
+        __m128i lerp)
+{
+    const __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefs0));
+    const __m128i diff = _mm_sub_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefs1)), c0);
+    // bits 15-30 of the 32 bit product
+    const __m128i product = _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epi16(diff, lerp), 1),
+            _mm_srli_epi16(_mm_mullo_epi16(diff, lerp), 15));
+    return _mm256_cvtepi16_epi32(_mm_add_epi16(product, c0));
+}
+
+// interpolate<int32_t, uint32_t>(): (lerp * int64(coef1 - coef0) >> 31) + coef0
+AVX2_TARGET static inline __m256i avx2Interpolate(const int32_t* coefs0, const int32_t* coefs1,
+        __m256i lerp)
+{
+    const __m256i c0 = avx2LoadCoefs(coefs0);
+    const __m256i diff = _mm256_sub_epi32(avx2LoadCoefs(coefs1), c0);
+    // bits 31-62 of the 64 bit products of the even and odd lanes
+    const __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(diff, lerp), 31);
+    const __m256i odd = _mm256_slli_epi64(
+            _mm256_mul_epi32(_mm256_srli_epi64(diff, 32), lerp), 1);
+    return _mm256_add_epi32(_mm256_blend_epi32(even, odd, 0xAA), c0);
+}
+
+// mulAdd() and mulAddRL() for int16_t coefficients: a + v * s
+AVX2_TARGET static inline __m256i avx2MulAdd(__m256i acc, __m256i coefs, __m256i samples,
+        const int16_t*)
+{
+    return _mm256_add_epi32(acc, _mm256_mullo_epi32(coefs, samples));
+}
+
+// mulAdd() and mulAddRL() for int32_t coefficients: a + (int64(v) * s >> 16)
+// computed as (v >> 16) * s + ((v & 0xffff) * s >> 16), which is exact as s is 16 bits.
+AVX2_TARGET static inline __m256i avx2MulAdd(__m256i acc, __m256i coefs, __m256i samples,
+        const int32_t*)
+{
+    const __m256i high = _mm256_mullo_epi32(_mm256_srai_epi32(coefs, 16), samples);
+    const __m256i low = _mm256_srai_epi32(_mm256_mullo_epi32(
+            _mm256_and_si256(coefs, _mm256_set1_epi32(0xffff)), samples), 16);
+    return _mm256_add_epi32(acc, _mm256_add_epi32(high, low));
+}
+
+template <typename TC>
+struct Avx2Lerp;
+
+template <>
+struct Avx2Lerp<int16_t> {
+    typedef __m128i type;
+    AVX2_TARGET static inline type set(uint32_t lerpP) {
+        return _mm_set1_epi16(static_cast<int16_t>(lerpP));
+    }
+};
+
+template <>
+struct Avx2Lerp<int32_t> {
+    typedef __m256i type;
+    AVX2_TARGET static inline type set(uint32_t lerpP) {
+        return _mm256_set1_epi32(static_cast<int32_t>(lerpP));
+    }
+};
+
+template <int CHANNELS, int STRIDE, bool FIXED, typename TC>
+AVX2_TARGET static void ProcessAVX2Intrinsic(int32_t* out,
+        int count,
+        const TC* coefsP,
+        const TC* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* volumeLR,
+        uint32_t lerpP,
+        const TC* coefsP1,
+        const TC* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    static_assert(CHANNELS == 1 || CHANNELS == 2, "CHANNELS must be 1 or 2");
+
+    sP -= CHANNELS*(8-1);   // adjust sP for a loop iteration of eight
+
+    typename Avx2Lerp<TC>::type interp;
+    if (!FIXED) {
+        interp = Avx2Lerp<TC>::set(lerpP);
+    }
+
+    __m256i accL, accR;
+    accL = _mm256_setzero_si256();
+    if (CHANNELS == 2) {
+        accR = _mm256_setzero_si256();
+    }
+
+    do {
+        __m256i posCoef, negCoef;
+        if (FIXED) {
+            posCoef = avx2LoadCoefs(coefsP);
+            negCoef = avx2LoadCoefs(coefsN);
+        } else { // interpolate, see InterpCompute
+            posCoef = avx2Interpolate(coefsP, coefsP1, interp);
+            negCoef = avx2Interpolate(coefsN1, coefsN, interp);
+            coefsP1 += 8;
+            coefsN1 += 8;
+        }
+        coefsP += 8;
+        coefsN += 8;
+
+        switch (CHANNELS) {
+        case 1: {
+            __m256i posSamp = _mm256_cvtepi16_epi32(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(sP)));
+            __m256i negSamp = _mm256_cvtepi16_epi32(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(sN)));
+            sP -= 8;
+            sN += 8;
+
+            posSamp = _mm256_permutevar8x32_epi32(posSamp, avx2ReverseIndex());
+            accL = avx2MulAdd(accL, posCoef, posSamp, coefsP);
+            accL = avx2MulAdd(accL, negCoef, negSamp, coefsN);
+        } break;
+        case 2: {
+            // each 32 bit lane holds one interleaved RL frame
+            __m256i posSamp = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sP));
+            __m256i negSamp = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sN));
+            sP -= 16;
+            sN += 16;
+
+            posSamp = _mm256_permutevar8x32_epi32(posSamp, avx2ReverseIndex());
+            accL = avx2MulAdd(accL, posCoef,
+                    _mm256_srai_epi32(_mm256_slli_epi32(posSamp, 16), 16), coefsP);
+            accR = avx2MulAdd(accR, posCoef, _mm256_srai_epi32(posSamp, 16), coefsP);
+            accL = avx2MulAdd(accL, negCoef,
+                    _mm256_srai_epi32(_mm256_slli_epi32(negSamp, 16), 16), coefsN);
+            accR = avx2MulAdd(accR, negCoef, _mm256_srai_epi32(negSamp, 16), coefsN);
+        } break;
+        }
+    } while (count -= 8);
+
+    // multiply by volume and save
+    const int32_t l = avx2HorizontalSum(accL);
+    const int32_t r = CHANNELS == 2 ? avx2HorizontalSum(accR) : l;
+    out[0] += volumeAdjust(l, volumeLR[0]);
+    out[1] += volumeAdjust(r, volumeLR[1]);
+}
+
+template<>
+inline void ProcessL<1, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<1, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
+    } else {
+        ProcessSSEIntrinsic<1, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
+    }
+}
+
+template<>
+inline void ProcessL<2, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<2, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
+    } else {
+        ProcessSSEIntrinsic<2, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
+    }
+}
+
+template<>
+inline void Process<1, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* coefsP1,
+        const float* coefsN1,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<1, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+    } else {
+        ProcessSSEIntrinsic<1, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+    }
+}
+
+template<>
+inline void Process<2, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* coefsP1,
+        const float* coefsN1,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<2, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+    } else {
+        ProcessSSEIntrinsic<2, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+    }
+}
+
+template<>
+inline void ProcessL<1, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<1, 16, true, int16_t>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
+    } else {
+        ProcessBase<1, 16, InterpNull>(out, count, coefsP, coefsN, sP, sN, 0, volumeLR);
+    }
+}
+
+template<>
+inline void ProcessL<2, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<2, 16, true, int16_t>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
+    } else {
+        ProcessBase<2, 16, InterpNull>(out, count, coefsP, coefsN, sP, sN, 0, volumeLR);
+    }
+}
+
+template<>
+inline void Process<1, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* coefsP1,
+        const int16_t* coefsN1,
+        const int16_t* sP,
+        const int16_t* sN,
+        uint32_t lerpP,
+        const int32_t* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<1, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+    } else {
+        ProcessBase<1, 16, InterpCompute>(out, count, coefsP, coefsN, sP, sN, lerpP, volumeLR);
+    }
+}
+
+template<>
+inline void Process<2, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* coefsP1,
+        const int16_t* coefsN1,
+        const int16_t* sP,
+        const int16_t* sN,
+        uint32_t lerpP,
+        const int32_t* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<2, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+    } else {
+        ProcessBase<2, 16, InterpCompute>(out, count, coefsP, coefsN, sP, sN, lerpP, volumeLR);
+    }
+}
+
+template<>
+inline void ProcessL<1, 16>(int32_t* const out,
+        int count,
+        const int32_t* coefsP,
+        const int32_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<1, 16, true, int32_t>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
+    } else {
+        ProcessBase<1, 16, InterpNull>(out, count, coefsP, coefsN, sP, sN, 0, volumeLR);
+    }
+}
+
+template<>
+inline void ProcessL<2, 16>(int32_t* const out,
+        int count,
+        const int32_t* coefsP,
+        const int32_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<2, 16, true, int32_t>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
+    } else {
+        ProcessBase<2, 16, InterpNull>(out, count, coefsP, coefsN, sP, sN, 0, volumeLR);
+    }
+}
+
+template<>
+inline void Process<1, 16>(int32_t* const out,
+        int count,
+        const int32_t* coefsP,
+        const int32_t* coefsN,
+        const int32_t* coefsP1,
+        const int32_t* coefsN1,
+        const int16_t* sP,
+        const int16_t* sN,
+        uint32_t lerpP,
+        const int32_t* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<1, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+    } else {
+        ProcessBase<1, 16, InterpCompute>(out, count, coefsP, coefsN, sP, sN, lerpP, volumeLR);
+    }
+}
+
+template<>
+inline void Process<2, 16>(int32_t* const out,
+        int count,
+        const int32_t* coefsP,
+        const int32_t* coefsN,
+        const int32_t* coefsP1,
+        const int32_t* coefsN1,
+        const int16_t* sP,
+        const int16_t* sN,
+        uint32_t lerpP,
+        const int32_t* const volumeLR)
+{
+    if (cpuSupportsAvx2()) {
+        ProcessAVX2Intrinsic<2, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+    } else {
+        ProcessBase<2, 16, InterpCompute>(out, count, coefsP, coefsN, sP, sN, lerpP, volumeLR);
+    }
+}
+
+#undef AVX2_TARGET
+
+#endif //USE_AVX2
+
+} // namespace android
+
+#endif /*ANDROID_AUDIO_RESAMPLER_FIR_PROCESS_AVX_H*/
@@ -150,6 +150,9 @@ static inline void ProcessSSEIntrinsic(float* out,
     _mm_storel_pi(reinterpret_cast<__m64*>(out), outSamp);
 }
 
+// When AVX2 is enabled, AudioResamplerFirProcessAVX.h selects between AVX2 and SSE at runtime.
+#if !USE_AVX2
+
 template<>
 inline void ProcessL<1, 16>(float* const out,
         int count,
@@ -208,6 +211,8 @@ inline void Process<2, 16>(float* const out,
             lerpP, coefsP1, coefsN1);
 }
 
+#endif //!USE_AVX2
+
 #endif //USE_SSE
 
 } // namespace android
@@ -37,6 +37,57 @@ static inline T max(const T& a, const T& b)
 
 namespace android {
 
+// Sample conversions for the fused path; these match memcpy_by_audio_format() exactly.
+template <typename TO, typename TI>
+static inline TO convertSample(TI value);
+
+template <>
+inline int16_t convertSample<int16_t, int16_t>(int16_t value)
+{
+    return value;
+}
+
+template <>
+inline float convertSample<float, int16_t>(int16_t value)
+{
+    return float_from_i16(value);
+}
+
+template <>
+inline int16_t convertSample<int16_t, float>(float value)
+{
+    return clamp16_from_float(value);
+}
+
+template <>
+inline float convertSample<float, float>(float value)
+{
+    return value;
+}
+
+// Legacy stereo to mono downmix, matching downmix_to_mono_float_from_stereo_float()
+// followed by conversion to the destination format.
+template <typename TO, typename TI>
+static inline TO downmixSample(TI left, TI right)
+{
+    return convertSample<TO, float>(
+            (convertSample<float, TI>(left) + convertSample<float, TI>(right)) * 0.5f);
+}
+
+// For 16 bit the float computation above is exact up to the final round to nearest even,
+// so it reduces to an integer average with that rounding, which vectorizes well.
+template <>
+inline int16_t downmixSample<int16_t, int16_t>(int16_t left, int16_t right)
+{
+    const int32_t sum = (int32_t) left + right;
+    return (int16_t) ((sum + ((sum >> 1) & 1)) >> 1);
+}
+
+static inline bool isFusedFormat(audio_format_t format)
+{
+    return format == AUDIO_FORMAT_PCM_16_BIT || format == AUDIO_FORMAT_PCM_FLOAT;
+}
+
 RecordBufferConverter::RecordBufferConverter(
         audio_channel_mask_t srcChannelMask, audio_format_t srcFormat,
         uint32_t srcSampleRate,
@@ -56,6 +107,7 @@ RecordBufferConverter::RecordBufferConverter(
             mIsLegacyDownmix(false),
             mIsLegacyUpmix(false),
             mRequiresFloat(false),
+            mIsFused(false),
             mInputConverterProvider(NULL)
 {
     (void)updateParameters(srcChannelMask, srcFormat, srcSampleRate,
@@ -180,12 +232,21 @@ status_t RecordBufferConverter::updateParameters(
                    && (mDstChannelMask == AUDIO_CHANNEL_IN_STEREO
                             || mDstChannelMask == AUDIO_CHANNEL_IN_FRONT_BACK);
 
+    // can channel conversion and format conversion be done together in one pass?
+    // (channel conversion alone already goes directly to the destination)
+    mIsFused = mResampler == NULL
+            && isFusedFormat(mSrcFormat) && isFusedFormat(mDstFormat)
+            && (mIsLegacyDownmix || mIsLegacyUpmix
+                    || (mSrcChannelMask != mDstChannelMask && mSrcFormat != mDstFormat));
+
     // do we need to process in float?
-    mRequiresFloat = mResampler != NULL || mIsLegacyDownmix || mIsLegacyUpmix;
+    mRequiresFloat = mResampler != NULL || ((mIsLegacyDownmix || mIsLegacyUpmix) && !mIsFused);
 
     // do we need a staging buffer to convert for destination (we can still optimize this)?
     // we use mBufFrameSize > 0 to indicate both frame size as well as buffer necessity
-    if (mResampler != NULL) {
+    if (mIsFused) {
+        mBufFrameSize = 0;
+    } else if (mResampler != NULL) {
         mBufFrameSize = max(mSrcChannelCount, (uint32_t)FCC_2)
                 * audio_bytes_per_sample(AUDIO_FORMAT_PCM_FLOAT);
     } else if (mIsLegacyUpmix || mIsLegacyDownmix) { // legacy modes always float
@@ -219,6 +280,10 @@ status_t RecordBufferConverter::updateParameters(
 void RecordBufferConverter::convertNoResampler(
         void *dst, const void *src, size_t frames)
 {
+    if (mIsFused) {
+        convertFused(dst, src, frames);
+        return;
+    }
     // src is native type unless there is legacy upmix or downmix, whereupon it is float.
     if (mBufFrameSize != 0 && mBufFrames < frames) {
         free(mBuf);
@@ -256,6 +321,53 @@ void RecordBufferConverter::convertNoResampler(
             frames * mDstChannelCount);
 }
 
+void RecordBufferConverter::convertFused(
+        void *dst, const void *src, size_t frames)
+{
+    // src is always native type, see mRequiresFloat.
+    if (mSrcFormat == AUDIO_FORMAT_PCM_16_BIT) {
+        if (mDstFormat == AUDIO_FORMAT_PCM_16_BIT) {
+            convertFused((int16_t *)dst, (const int16_t *)src, frames);
+        } else {
+            convertFused((float *)dst, (const int16_t *)src, frames);
+        }
+    } else {
+        if (mDstFormat == AUDIO_FORMAT_PCM_16_BIT) {
+            convertFused((int16_t *)dst, (const float *)src, frames);
+        } else {
+            convertFused((float *)dst, (const float *)src, frames);
+        }
+    }
+}
+
+template <typename TO, typename TI>
+void RecordBufferConverter::convertFused(
+        TO * __restrict__ dst, const TI * __restrict__ src, size_t frames)
+{
+    // The loops are kept free of dependencies so that the compiler vectorizes them.
+    if (mIsLegacyDownmix) {
+        for (size_t i = 0; i < frames; ++i) {
+            dst[i] = downmixSample<TO, TI>(src[2 * i], src[2 * i + 1]);
+        }
+    } else if (mIsLegacyUpmix) {
+        for (size_t i = 0; i < frames; ++i) {
+            dst[2 * i] = dst[2 * i + 1] = convertSample<TO, TI>(src[i]);
+        }
+    } else {
+        // same semantics as memcpy_by_index_array(): negative index means silence.
+        const uint32_t dstChannels = mDstChannelCount;
+        const uint32_t srcChannels = mSrcChannelCount;
+        for (size_t i = 0; i < frames; ++i) {
+            for (uint32_t c = 0; c < dstChannels; ++c) {
+                const int index = mIdxAry[c];
+                dst[c] = index < 0 ? TO(0) : convertSample<TO, TI>(src[index]);
+            }
+            dst += dstChannels;
+            src += srcChannels;
+        }
+    }
+}
+
 void RecordBufferConverter::convertResampler(
         void *dst, /*not-a-const*/ void *src, size_t frames)
 {
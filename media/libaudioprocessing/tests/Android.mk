@@ -16,6 +16,7 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_C_INCLUDES := \
     $(call include-path-for, audio-utils) \
+    $(LOCAL_PATH)/.. \
 
 LOCAL_SRC_FILES := \
     resampler_tests.cpp
@@ -28,6 +29,32 @@ LOCAL_CFLAGS := -Werror -Wall
 
 include $(BUILD_NATIVE_TEST)
 
+#
+# record buffer converter unit test
+#
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := \
+    libaudioutils \
+    libaudioprocessing \
+    libcutils \
+    liblog \
+    libutils \
+
+LOCAL_C_INCLUDES := \
+    $(call include-path-for, audio-utils) \
+
+LOCAL_SRC_FILES := \
+    record_buffer_converter_tests.cpp
+
+LOCAL_MODULE := record_buffer_converter_tests
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_CFLAGS := -Werror -Wall
+
+include $(BUILD_NATIVE_TEST)
+
 #
 # audio mixer test tool
 #
@@ -18,6 +18,8 @@ adb push $OUT/system/lib/libaudioresampler.so /system/lib
 adb push $OUT/system/lib64/libaudioresampler.so /system/lib64
 adb push $OUT/data/nativetest/resampler_tests/resampler_tests /data/nativetest/resampler_tests/resampler_tests
 adb push $OUT/data/nativetest64/resampler_tests/resampler_tests /data/nativetest64/resampler_tests/resampler_tests
+adb push $OUT/data/nativetest/record_buffer_converter_tests/record_buffer_converter_tests /data/nativetest/record_buffer_converter_tests/record_buffer_converter_tests
+adb push $OUT/data/nativetest64/record_buffer_converter_tests/record_buffer_converter_tests /data/nativetest64/record_buffer_converter_tests/record_buffer_converter_tests
 
 sh $ANDROID_BUILD_TOP/frameworks/av/media/libaudioprocessing/tests/run_all_unit_tests.sh
 
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "record_buffer_converter_tests"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <audio_utils/format.h>
+#include <audio_utils/primitives.h>
+#include <gtest/gtest.h>
+#include <log/log.h>
+#include <media/RecordBufferConverter.h>
+#include "test_utils.h"
+
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(x) (sizeof(x)/sizeof((x)[0]))
+#endif
+
+/* Computes the expected output the way the multi-pass converter does:
+ * convert to float, legacy downmix/upmix in float, convert to the destination format;
+ * or remix by index array in the source format, then convert.
+ */
+static void referenceConvert(void *dst, audio_channel_mask_t dstMask, audio_format_t dstFormat,
+        const void *src, audio_channel_mask_t srcMask, audio_format_t srcFormat, size_t frames)
+{
+    const uint32_t srcChannels = audio_channel_count_from_in_mask(srcMask);
+    const uint32_t dstChannels = audio_channel_count_from_in_mask(dstMask);
+    const bool legacyDownmix = (srcMask == AUDIO_CHANNEL_IN_STEREO
+            || srcMask == AUDIO_CHANNEL_IN_FRONT_BACK) && dstMask == AUDIO_CHANNEL_IN_MONO;
+    const bool legacyUpmix = srcMask == AUDIO_CHANNEL_IN_MONO
+            && (dstMask == AUDIO_CHANNEL_IN_STEREO || dstMask == AUDIO_CHANNEL_IN_FRONT_BACK);
+
+    if (legacyDownmix || legacyUpmix) {
+        std::vector<float> in(frames * srcChannels);
+        std::vector<float> out(frames * dstChannels);
+        memcpy_by_audio_format(in.data(), AUDIO_FORMAT_PCM_FLOAT, src, srcFormat, in.size());
+        if (legacyDownmix) {
+            downmix_to_mono_float_from_stereo_float(out.data(), in.data(), frames);
+        } else {
+            upmix_to_stereo_float_from_mono_float(out.data(), in.data(), frames);
+        }
+        memcpy_by_audio_format(dst, dstFormat, out.data(), AUDIO_FORMAT_PCM_FLOAT, out.size());
+        return;
+    }
+    int8_t idxAry[sizeof(uint32_t) * 8];
+    (void) memcpy_by_index_array_initialization_from_channel_mask(
+            idxAry, ARRAY_SIZE(idxAry), dstMask, srcMask);
+    std::vector<float> remixed(frames * dstChannels); // large enough for any source format
+    memcpy_by_index_array(remixed.data(), dstChannels, src, srcChannels, idxAry,
+            audio_bytes_per_sample(srcFormat), frames);
+    memcpy_by_audio_format(dst, dstFormat, remixed.data(), srcFormat, frames * dstChannels);
+}
+
+static void testConvert(audio_channel_mask_t srcMask, audio_format_t srcFormat,
+        audio_channel_mask_t dstMask, audio_format_t dstFormat)
+{
+    const size_t kFrames = 1000;
+    const uint32_t srcChannels = audio_channel_count_from_in_mask(srcMask);
+    const uint32_t dstChannels = audio_channel_count_from_in_mask(dstMask);
+    const size_t srcFrameSize = srcChannels * audio_bytes_per_sample(srcFormat);
+    const size_t dstFrameSize = dstChannels * audio_bytes_per_sample(dstFormat);
+
+    // random 16 bit source, also covering full scale and odd sums for rounding
+    std::vector<int16_t> samples16(kFrames * srcChannels);
+    for (size_t i = 0; i < samples16.size(); ++i) {
+        samples16[i] = static_cast<int16_t>(rand());
+    }
+    samples16[0] = samples16[1] = -32768;
+    samples16[2] = samples16[3] = 32767;
+    std::vector<uint8_t> src(kFrames * srcFrameSize);
+    memcpy_by_audio_format(src.data(), srcFormat, samples16.data(), AUDIO_FORMAT_PCM_16_BIT,
+            samples16.size());
+
+    std::vector<uint8_t> reference(kFrames * dstFrameSize);
+    referenceConvert(reference.data(), dstMask, dstFormat,
+            src.data(), srcMask, srcFormat, kFrames);
+
+    android::RecordBufferConverter converter(srcMask, srcFormat, 48000,
+            dstMask, dstFormat, 48000);
+    ASSERT_EQ(android::NO_ERROR, converter.initCheck());
+    // uneven provider buffers to exercise partial conversion
+    TestProvider provider(src.data(), kFrames, srcFrameSize, { 37, 256, 1 });
+    std::vector<uint8_t> test(kFrames * dstFrameSize);
+    size_t converted = 0;
+    while (converted < kFrames) {
+        const size_t frames = converter.convert(test.data() + converted * dstFrameSize,
+                &provider, kFrames - converted);
+        ASSERT_GT(frames, 0u);
+        converted += frames;
+    }
+    EXPECT_EQ(0, memcmp(reference.data(), test.data(), test.size()))
+            << "srcMask:" << srcMask << " srcFormat:" << srcFormat
+            << " dstMask:" << dstMask << " dstFormat:" << dstFormat;
+}
+
+TEST(audioflinger_record_buffer_converter, convert_no_resampler) {
+    static const audio_format_t kFormats[] = {
+        AUDIO_FORMAT_PCM_16_BIT,
+        AUDIO_FORMAT_PCM_FLOAT,
+    };
+    static const audio_channel_mask_t kMasks[][2] = {
+        { AUDIO_CHANNEL_IN_STEREO, AUDIO_CHANNEL_IN_MONO },
+        { AUDIO_CHANNEL_IN_FRONT_BACK, AUDIO_CHANNEL_IN_MONO },
+        { AUDIO_CHANNEL_IN_MONO, AUDIO_CHANNEL_IN_STEREO },
+        { AUDIO_CHANNEL_INDEX_MASK_2, AUDIO_CHANNEL_INDEX_MASK_4 },
+        { AUDIO_CHANNEL_INDEX_MASK_4, AUDIO_CHANNEL_INDEX_MASK_2 },
+        { AUDIO_CHANNEL_IN_STEREO, AUDIO_CHANNEL_IN_STEREO },
+    };
+    srand(42);
+    for (size_t i = 0; i < ARRAY_SIZE(kMasks); ++i) {
+        for (audio_format_t srcFormat : kFormats) {
+            for (audio_format_t dstFormat : kFormats) {
+                testConvert(kMasks[i][0], srcFormat, kMasks[i][1], dstFormat);
+            }
+        }
+    }
+}
@@ -39,6 +39,13 @@
 #include <media/AudioResampler.h>
 #include "test_utils.h"
 
+// private headers, for testing the SIMD dot product kernels against ProcessBase()
+#include "AudioResamplerFirOps.h"
+#include "AudioResamplerFirProcess.h"
+#include "AudioResamplerFirProcessNeon.h"
+#include "AudioResamplerFirProcessSSE.h"
+#include "AudioResamplerFirProcessAVX.h"
+
 template <typename T>
 static void printData(T *data, size_t size) {
     const size_t stride = 8;
@@ -484,3 +491,89 @@ TEST(audioflinger_resampler, stopbandresponse_float_multichannel) {
     }
 }
 
+
+template <typename T>
+static T randomValue();
+
+template <>
+float randomValue<float>() {
+    return rand() * 2.f / RAND_MAX - 1.f;
+}
+
+template <>
+int16_t randomValue<int16_t>() {
+    return static_cast<int16_t>(rand());
+}
+
+template <>
+int32_t randomValue<int32_t>() {
+    return static_cast<int32_t>(static_cast<uint32_t>(rand()) << 16 ^ rand());
+}
+
+/* Dot product kernel test
+ *
+ * Compares the (possibly SIMD) ProcessL() and Process() specializations used by
+ * AudioResamplerDyn against the generic ProcessBase() for all supported coefficient
+ * lengths of a stride 16 filter.  The AVX2 integer kernels must be bit-exact;
+ * the float kernels and the NEON integer kernels differ only by rounding.
+ */
+template <int CHANNELS, typename TC, typename TI, typename TO, typename TINTERP>
+void testProcessKernels(TINTERP lerpP, TO volumeL, TO volumeR)
+{
+    const int kMaxHalfNumCoefs = 256;
+    std::vector<TC> coefs(4 * kMaxHalfNumCoefs);
+    std::vector<TI> samples((2 * kMaxHalfNumCoefs + 1) * CHANNELS);
+    for (size_t i = 0; i < coefs.size(); ++i) {
+        coefs[i] = randomValue<TC>();
+    }
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = randomValue<TI>();
+    }
+    const TI* sP = &samples[kMaxHalfNumCoefs * CHANNELS];
+    const TI* sN = sP + CHANNELS;
+    const TO volumeLR[2] = { volumeL, volumeR };
+    const bool exact = !android::is_same<TO, float>::value && !USE_NEON;
+
+    for (int count = 8; count <= kMaxHalfNumCoefs; count += 8) {
+        const TC* coefsP = &coefs[0];
+        const TC* coefsN = &coefs[2 * kMaxHalfNumCoefs];
+        for (int locked = 0; locked <= 1; ++locked) {
+            TO test[2] = { 1, 2 };
+            TO reference[2] = { 1, 2 };
+            if (locked) {
+                android::ProcessL<CHANNELS, 16>(test, count, coefsP, coefsN, sP, sN, volumeLR);
+                android::ProcessBase<CHANNELS, 16, android::InterpNull>(reference, count,
+                        coefsP, coefsN, sP, sN, lerpP, volumeLR);
+            } else {
+                android::Process<CHANNELS, 16>(test, count, coefsP, coefsN,
+                        coefsP + count, coefsN + count, sP, sN, lerpP, volumeLR);
+                android::ProcessBase<CHANNELS, 16, android::InterpCompute>(reference, count,
+                        coefsP, coefsN, sP, sN, lerpP, volumeLR);
+            }
+            for (int i = 0; i < 2; ++i) {
+                if (exact) {
+                    ASSERT_EQ(reference[i], test[i])
+                            << "count:" << count << " locked:" << locked;
+                } else {
+                    // relative tolerance for a different order of summation
+                    ASSERT_NEAR(reference[i], test[i], fabs(reference[i]) * 1e-4 + 1e-5)
+                            << "count:" << count << " locked:" << locked;
+                }
+            }
+        }
+    }
+}
+
+TEST(audioflinger_resampler, process_kernels) {
+    srand(42);
+    testProcessKernels<1, float, float, float>(0.3f, 0.5f, 0.75f);
+    testProcessKernels<2, float, float, float>(0.7f, 0.5f, 0.75f);
+    testProcessKernels<1, int16_t, int16_t, int32_t>(
+            (uint32_t)0x1234, (int32_t)0x10001000, (int32_t)0x08000800);
+    testProcessKernels<2, int16_t, int16_t, int32_t>(
+            (uint32_t)0x7fff, (int32_t)0x10001000, (int32_t)0x08000800);
+    testProcessKernels<1, int32_t, int16_t, int32_t>(
+            (uint32_t)0x12345678, (int32_t)0x10001000, (int32_t)0x08000800);
+    testProcessKernels<2, int32_t, int16_t, int32_t>(
+            (uint32_t)0x7fffffff, (int32_t)0x10001000, (int32_t)0x08000800);
+}
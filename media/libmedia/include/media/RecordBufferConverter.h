@@ -37,6 +37,10 @@ namespace android {
  * There are legacy conversion requirements for this converter, specifically
  * due to mono handling, so be careful about modifying.
  *
+ * When no resampling is needed and both formats are 16 bit or float, channel
+ * conversion and format conversion are fused into a single pass from the
+ * provider buffer to dst, without intermediate buffers.
+ *
  * Original source audioflinger/Threads.{h,cpp}
  */
 class RecordBufferConverter
@@ -85,6 +89,12 @@ private:
     // format conversion when using resampler; modifies src in-place
     void convertResampler(void *dst, /*not-a-const*/ void *src, size_t frames);
 
+    // single pass channel and format conversion, used when mIsFused
+    void convertFused(void *dst, const void *src, size_t frames);
+
+    template <typename TO, typename TI>
+    void convertFused(TO *dst, const TI *src, size_t frames);
+
     // user provided information
     audio_channel_mask_t mSrcChannelMask;
     audio_format_t       mSrcFormat;
@@ -109,6 +119,7 @@ private:
     bool                 mIsLegacyDownmix;  // legacy stereo to mono conversion needed
     bool                 mIsLegacyUpmix;    // legacy mono to stereo conversion needed
     bool                 mRequiresFloat;    // data processing requires float (e.g. resampler)
+    bool                 mIsFused;          // channel and format conversion in one pass
     PassthruBufferProvider *mInputConverterProvider;    // converts input to float
     int8_t               mIdxAry[sizeof(uint32_t) * 8]; // used for channel mask conversion
 };
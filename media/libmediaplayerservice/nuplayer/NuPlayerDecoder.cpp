@@ -57,6 +57,10 @@ static inline bool getAudioDeepBufferSetting() {
     return property_get_bool("media.stagefright.audio.deep", false /* default_value */);
 }
 
+static inline bool getAudioFloatOutputSetting() {
+    return property_get_bool("media.stagefright.audio.float", false /* default_value */);
+}
+
 NuPlayer::Decoder::Decoder(
         const sp<AMessage> &notify,
         const sp<Source> &source,
@@ -348,6 +352,13 @@ void NuPlayer::Decoder::onConfigure(const sp<AMessage> &format) {
         format->setInt32("feature-tunneled-playback", tunneled);
     }
 
+    int32_t pcmEncoding;
+    if (mIsAudio && getAudioFloatOutputSetting()
+            && !format->findInt32("pcm-encoding", &pcmEncoding)) {
+        // decode to float PCM; the renderer opens the audio sink in the decoded encoding.
+        format->setInt32("pcm-encoding", kAudioEncodingPcmFloat);
+    }
+
     status_t err;
     if (mSurface != NULL) {
         // disconnect from surface as MediaCodec will reconnect
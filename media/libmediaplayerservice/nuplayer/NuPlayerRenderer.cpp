@@ -32,6 +32,7 @@
 #include <media/stagefright/Utils.h>
 #include <media/stagefright/VideoFrameScheduler.h>
 #include <media/MediaCodecBuffer.h>
+#include <media/MediaDefs.h>
 
 #include <inttypes.h>
 
@@ -55,6 +56,9 @@ namespace android {
    #Set size of buffers for pcm audio sink in msec (example: 1000 msec)
    adb shell setprop media.stagefright.audio.sink 1000
 
+   #Decode to float PCM and open the pcm audio sink in float -- NuPlayerDecoder
+   adb shell setprop media.stagefright.audio.float 1
+
  * These configurations take effect for the next track played (not the current track).
  */
 
@@ -67,6 +71,17 @@ static inline int32_t getAudioSinkPcmMsSetting() {
             "media.stagefright.audio.sink", 500 /* default_value */);
 }
 
+static audio_format_t getAudioFormatForPcmEncoding(int32_t pcmEncoding) {
+    switch (pcmEncoding) {
+        case kAudioEncodingPcmFloat:
+            return AUDIO_FORMAT_PCM_FLOAT;
+        case kAudioEncodingPcm8bit:
+            return AUDIO_FORMAT_PCM_8_BIT;
+        default:
+            return AUDIO_FORMAT_PCM_16_BIT;
+    }
+}
+
 // Maximum time in paused state when offloading audio decompression. When elapsed, the AudioSink
 // is closed to allow the audio DSP to power down.
 static const int64_t kOffloadPauseMaxUs = 10000000ll;
@@ -2018,10 +2033,16 @@ status_t NuPlayer::Renderer::onOpenAudioSink(
         uint32_t pcmFlags = flags;
         pcmFlags &= ~AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD;
 
+        audio_format_t audioFormat = AUDIO_FORMAT_PCM_16_BIT;
+        int32_t pcmEncoding;
+        if (format->findInt32("pcm-encoding", &pcmEncoding)) {
+            audioFormat = getAudioFormatForPcmEncoding(pcmEncoding);
+        }
+
         const PcmInfo info = {
                 (audio_channel_mask_t)channelMask,
                 (audio_output_flags_t)pcmFlags,
-                AUDIO_FORMAT_PCM_16_BIT, // TODO: change to audioFormat
+                audioFormat,
                 numChannels,
                 sampleRate
         };
@@ -2060,7 +2081,7 @@ status_t NuPlayer::Renderer::onOpenAudioSink(
                     sampleRate,
                     numChannels,
                     (audio_channel_mask_t)channelMask,
-                    AUDIO_FORMAT_PCM_16_BIT,
+                    audioFormat,
                     0 /* bufferCount - unused */,
                     mUseAudioCallback ? &NuPlayer::Renderer::AudioSinkCallback : NULL,
                     mUseAudioCallback ? this : NULL,
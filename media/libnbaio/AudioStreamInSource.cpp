@@ -89,4 +89,16 @@ ssize_t AudioStreamInSource::read(void *buffer, size_t count)
     }
 }
 
+status_t AudioStreamInSource::getTimestamp(ExtendedTimestamp &timestamp)
+{
+    int64_t position, time;
+    status_t result = mStream->getCapturePosition(&position, &time);
+    if (result != OK) {
+        return result;
+    }
+    timestamp.mPosition[ExtendedTimestamp::LOCATION_KERNEL] = position;
+    timestamp.mTimeNs[ExtendedTimestamp::LOCATION_KERNEL] = time;
+    return OK;
+}
+
 }   // namespace android
@@ -35,7 +35,8 @@
 *     TODO: why mLength (max length of buffer data)  must be <= kMaxLength = 255?
 *     calls NBLOG::Writer::log(Entry *, bool)
 * NBLog::Writer::log(Entry *, bool)
-*     Calls copyEntryDataAt to format data as follows in temp array:
+*     Calls Entry::copyTo to format data as follows in temp array (or in the batch buffer
+*     while logVFormat is composing a format entry):
 *     [type][length][data ... ][length]
 *     calls audio_utils_fifo_writer.write on temp
 * audio_utils_fifo_writer.write
@@ -99,6 +100,7 @@
 #include <string.h>
 #include <sys/prctl.h>
 #include <time.h>
+#include <unistd.h>
 #include <new>
 #include <audio_utils/roundup.h>
 #include <media/nbaio/NBLog.h>
@@ -111,19 +113,14 @@
 
 namespace android {
 
-int NBLog::Entry::copyEntryDataAt(size_t offset) const
+void NBLog::Entry::copyTo(uint8_t *dst) const
 {
-    // FIXME This is too slow
-    if (offset == 0)
-        return mEvent;
-    else if (offset == 1)
-        return mLength;
-    else if (offset < (size_t) (mLength + 2))
-        return ((char *) mData)[offset - 2];
-    else if (offset == (size_t) (mLength + 2))
-        return mLength;
-    else
-        return 0;
+    dst[offsetof(entry, type)] = mEvent;
+    dst[offsetof(entry, length)] = mLength;
+    if (mLength > 0) {
+        memcpy(dst + offsetof(entry, data), mData, mLength);
+    }
+    dst[offsetof(entry, data) + mLength + offsetof(ending, length)] = mLength;
 }
 
 // ---------------------------------------------------------------------------
@@ -212,11 +209,11 @@ int NBLog::FormatEntry::author() const {
 NBLog::EntryIterator NBLog::FormatEntry::copyWithAuthor(
         std::unique_ptr<audio_utils_fifo_writer> &dst, int author) const {
     auto it = begin();
-    // copy fmt start entry
-    it.copyTo(dst);
-    // copy timestamp
-    (++it).copyTo(dst);    // copy hash
-    (++it).copyTo(dst);
+    // copy fmt start, timestamp and hash entries with a single write
+    ++it;
+    ++it;
+    ++it;
+    dst->write(mEntry, it - begin());
     // insert author entry
     size_t authorEntrySize = NBLog::Entry::kOverhead + sizeof(author);
     uint8_t authorEntry[authorEntrySize];
@@ -226,12 +223,13 @@ NBLog::EntryIterator NBLog::FormatEntry::copyWithAuthor(
         sizeof(author);
     *(int*) (&authorEntry[offsetof(entry, data)]) = author;
     dst->write(authorEntry, authorEntrySize);
-    // copy rest of entries
-    while ((++it)->type != EVENT_END_FMT) {
-        it.copyTo(dst);
+    // copy rest of entries, up to and including the end fmt entry, with a single write
+    const EntryIterator args(it);
+    while (it->type != EVENT_END_FMT) {
+        ++it;
     }
-    it.copyTo(dst);
     ++it;
+    dst->write(args, it - args);
     return it;
 }
 
@@ -359,7 +357,8 @@ size_t NBLog::Timeline::sharedSize(size_t size)
 // ---------------------------------------------------------------------------
 
 NBLog::Writer::Writer()
-    : mShared(NULL), mFifo(NULL), mFifoWriter(NULL), mEnabled(false), mPidTag(NULL), mPidTagSize(0)
+    : mShared(NULL), mFifo(NULL), mFifoWriter(NULL), mEnabled(false), mPidTag(NULL), mPidTagSize(0),
+      mBatch(NULL), mBatchLength(0)
 {
 }
 
@@ -369,7 +368,8 @@ NBLog::Writer::Writer(void *shared, size_t size)
         new audio_utils_fifo(size, sizeof(uint8_t),
             mShared->mBuffer, mShared->mRear, NULL /*throttlesFront*/) : NULL),
       mFifoWriter(mFifo != NULL ? new audio_utils_fifo_writer(*mFifo) : NULL),
-      mEnabled(mFifoWriter != NULL)
+      mEnabled(mFifoWriter != NULL),
+      mBatch(NULL), mBatchLength(0)
 {
     // caching pid and process name
     pid_t id = ::getpid();
@@ -560,6 +560,9 @@ void NBLog::Writer::logVFormat(const char *fmt, log_hash_t hash, va_list argp)
     if (!mEnabled) {
         return;
     }
+    // publish the whole format entry at once rather than one FIFO write per argument
+    uint8_t batch[kBatchSize];
+    startBatch(batch);
     Writer::logStart(fmt);
     int i;
     double f;
@@ -611,6 +614,7 @@ void NBLog::Writer::logVFormat(const char *fmt, log_hash_t hash, va_list argp)
         }
     }
     Writer::logEnd();
+    endBatch();
 }
 
 void NBLog::Writer::log(Event event, const void *data, size_t length)
@@ -643,19 +647,42 @@ void NBLog::Writer::log(const NBLog::Entry *etr, bool trusted)
     }
     size_t need = etr->mLength + Entry::kOverhead;    // mEvent, mLength, data[mLength], mLength
                                                       // need = number of bytes written to FIFO
+    if (mBatch != NULL) {
+        if (mBatchLength + need > kBatchSize) {
+            flushBatch();
+        }
+        etr->copyTo(mBatch + mBatchLength);
+        mBatchLength += need;
+        return;
+    }
 
-    // FIXME optimize this using memcpy for the data part of the Entry.
-    // The Entry could have a method copyTo(ptr, offset, size) to optimize the copy.
     // checks size of a single log Entry: type, length, data pointer and ending
     uint8_t temp[Entry::kMaxLength + Entry::kOverhead];
-    // write this data to temp array
-    for (size_t i = 0; i < need; i++) {
-        temp[i] = etr->copyEntryDataAt(i);
-    }
+    etr->copyTo(temp);
     // write to circular buffer
     mFifoWriter->write(temp, need);
 }
 
+void NBLog::Writer::startBatch(uint8_t *buffer)
+{
+    mBatch = buffer;
+    mBatchLength = 0;
+}
+
+void NBLog::Writer::flushBatch()
+{
+    if (mBatchLength > 0) {
+        mFifoWriter->write(mBatch, mBatchLength);
+        mBatchLength = 0;
+    }
+}
+
+void NBLog::Writer::endBatch()
+{
+    flushBatch();
+    mBatch = NULL;
+}
+
 bool NBLog::Writer::isEnabled() const
 {
     return mEnabled;
@@ -767,14 +794,234 @@ bool NBLog::LockedWriter::setEnabled(bool enabled)
 
 // ---------------------------------------------------------------------------
 
+NBLog::MultiWriter::MultiWriter(void *shared, size_t size, size_t segments)
+    : Writer(),
+      mOwners(new std::atomic<pid_t>[segments]),
+      mDropped(0)
+{
+    const size_t segmentSize = Timeline::sharedSize(size);
+    for (size_t i = 0; i < segments; ++i) {
+        void *segment = shared != NULL ? (char *) shared + i * segmentSize : NULL;
+        if (segment != NULL) {
+            new(segment) Shared();
+        }
+        mSegments.push_back(new Writer(segment, size));
+        mOwners[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+NBLog::MultiWriter::MultiWriter(const sp<IMemory>& iMemory, size_t size, size_t segments)
+    : MultiWriter(iMemory != 0 ? iMemory->pointer() : NULL, size, segments)
+{
+    mIMemory = iMemory;
+}
+
+NBLog::MultiWriter::~MultiWriter()
+{
+}
+
+/*static*/
+size_t NBLog::MultiWriter::sharedSize(size_t size, size_t segments)
+{
+    return Timeline::sharedSize(size) * segments;
+}
+
+NBLog::Writer *NBLog::MultiWriter::threadWriter()
+{
+    // A segment released by another thread may have a lower index than the segment owned by
+    // the calling thread, so look for an owned segment in all of them before claiming a free
+    // one.  Only the owner stores to a claimed segment's owner tid, so the first pass can't
+    // miss it.  Both passes are bounded by the number of segments, so this is wait-free.
+    const pid_t tid = gettid();
+    const size_t segments = mSegments.size();
+    for (size_t i = 0; i < segments; ++i) {
+        if (mOwners[i].load(std::memory_order_relaxed) == tid) {
+            return mSegments[i].get();
+        }
+    }
+    for (size_t i = 0; i < segments; ++i) {
+        pid_t owner = 0;
+        if (mOwners[i].load(std::memory_order_relaxed) == 0 &&
+                mOwners[i].compare_exchange_strong(owner, tid, std::memory_order_acq_rel)) {
+            return mSegments[i].get();
+        }
+    }
+    mDropped.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+}
+
+size_t NBLog::MultiWriter::segmentsOwnedBy(pid_t tid) const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < mSegments.size(); ++i) {
+        if (mOwners[i].load(std::memory_order_acquire) == tid) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void NBLog::MultiWriter::releaseThread()
+{
+    const pid_t tid = gettid();
+    for (size_t i = 0; i < mSegments.size(); ++i) {
+        if (mOwners[i].load(std::memory_order_relaxed) == tid) {
+            mOwners[i].store(0, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+void NBLog::MultiWriter::log(const char *string)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->log(string);
+    }
+}
+
+void NBLog::MultiWriter::logf(const char *fmt, ...)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        va_list ap;
+        va_start(ap, fmt);
+        writer->logvf(fmt, ap);
+        va_end(ap);
+    }
+}
+
+void NBLog::MultiWriter::logvf(const char *fmt, va_list ap)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logvf(fmt, ap);
+    }
+}
+
+void NBLog::MultiWriter::logTimestamp()
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logTimestamp();
+    }
+}
+
+void NBLog::MultiWriter::logTimestamp(const int64_t ts)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logTimestamp(ts);
+    }
+}
+
+void NBLog::MultiWriter::logInteger(const int x)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logInteger(x);
+    }
+}
+
+void NBLog::MultiWriter::logFloat(const float x)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logFloat(x);
+    }
+}
+
+void NBLog::MultiWriter::logPID()
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logPID();
+    }
+}
+
+void NBLog::MultiWriter::logFormat(const char *fmt, log_hash_t hash, ...)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        va_list ap;
+        va_start(ap, hash);
+        writer->logVFormat(fmt, hash, ap);
+        va_end(ap);
+    }
+}
+
+void NBLog::MultiWriter::logVFormat(const char *fmt, log_hash_t hash, va_list ap)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logVFormat(fmt, hash, ap);
+    }
+}
+
+void NBLog::MultiWriter::logStart(const char *fmt)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logStart(fmt);
+    }
+}
+
+void NBLog::MultiWriter::logEnd()
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logEnd();
+    }
+}
+
+void NBLog::MultiWriter::logHash(log_hash_t hash)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logHash(hash);
+    }
+}
+
+void NBLog::MultiWriter::logHistTS(log_hash_t hash)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logHistTS(hash);
+    }
+}
+
+void NBLog::MultiWriter::logHistFlush(log_hash_t hash)
+{
+    Writer *writer = threadWriter();
+    if (writer != NULL) {
+        writer->logHistFlush(hash);
+    }
+}
+
+bool NBLog::MultiWriter::isEnabled() const
+{
+    return !mSegments.empty() && mSegments[0]->isEnabled();
+}
+
+bool NBLog::MultiWriter::setEnabled(bool enabled)
+{
+    bool old = isEnabled();
+    for (const auto &segment : mSegments) {
+        segment->setEnabled(enabled);
+    }
+    return old;
+}
+
+// ---------------------------------------------------------------------------
+
 const std::set<NBLog::Event> NBLog::Reader::startingTypes {NBLog::Event::EVENT_START_FMT,
                                                            NBLog::Event::EVENT_HISTOGRAM_ENTRY_TS};
 const std::set<NBLog::Event> NBLog::Reader::endingTypes   {NBLog::Event::EVENT_END_FMT,
                                                            NBLog::Event::EVENT_HISTOGRAM_ENTRY_TS,
                                                            NBLog::Event::EVENT_HISTOGRAM_FLUSH};
 NBLog::Reader::Reader(const void *shared, size_t size)
-    : mShared((/*const*/ Shared *) shared), /*mIMemory*/
-      mFd(-1), mIndent(0),
+    : mFd(-1), mIndent(0),
+      mShared((/*const*/ Shared *) shared), /*mIMemory*/
       mFifo(mShared != NULL ?
         new audio_utils_fifo(size, sizeof(uint8_t),
             mShared->mBuffer, mShared->mRear, NULL /*throttlesFront*/) : NULL),
@@ -789,6 +1036,13 @@ NBLog::Reader::Reader(const sp<IMemory>& iMemory, size_t size)
     mIMemory = iMemory;
 }
 
+NBLog::Reader::Reader(const sp<IMemory>& iMemory, size_t size, size_t segment)
+    : Reader(iMemory != 0 ?
+            (const char *) iMemory->pointer() + segment * Timeline::sharedSize(size) : NULL, size)
+{
+    mIMemory = iMemory;
+}
+
 NBLog::Reader::~Reader()
 {
     delete mFifoReader;
@@ -986,135 +1240,142 @@ void NBLog::Reader::dump(int fd, size_t indent, NBLog::Reader::Snapshot &snapsho
 #endif
 
     for (auto entry = snapshot.begin(); entry != snapshot.end();) {
-        switch (entry->type) {
+        entry = dumpEntry(entry, &timestamp, &body);
+        if (!body.isEmpty()) {
+            dumpLine(timestamp, body);
+        }
+    }
+}
+
+NBLog::EntryIterator NBLog::Reader::dumpEntry(const NBLog::EntryIterator &it, String8 *timestamp,
+                                              String8 *body)
+{
+    EntryIterator entry(it);
+    switch (entry->type) {
 #if 0
-        case EVENT_STRING:
-            body.appendFormat("%.*s", (int) entry.length(), entry.data());
-            break;
-        case EVENT_TIMESTAMP: {
-            // already checked that length == sizeof(struct timespec);
-            entry.copyData((const uint8_t*) &ts);
-            long prevNsec = ts.tv_nsec;
-            long deltaMin = LONG_MAX;
-            long deltaMax = -1;
-            long deltaTotal = 0;
-            auto aux(entry);
-            for (;;) {
-                ++aux;
-                if (end - aux >= 0 || aux.type() != EVENT_TIMESTAMP) {
-                    break;
-                }
-                struct timespec tsNext;
-                aux.copyData((const uint8_t*) &tsNext);
-                if (tsNext.tv_sec != ts.tv_sec) {
-                    break;
-                }
-                long delta = tsNext.tv_nsec - prevNsec;
-                if (delta < 0) {
-                    break;
-                }
-                if (delta < deltaMin) {
-                    deltaMin = delta;
-                }
-                if (delta > deltaMax) {
-                    deltaMax = delta;
-                }
-                deltaTotal += delta;
-                prevNsec = tsNext.tv_nsec;
+    case EVENT_STRING:
+        body->appendFormat("%.*s", (int) entry.length(), entry.data());
+        break;
+    case EVENT_TIMESTAMP: {
+        // already checked that length == sizeof(struct timespec);
+        entry.copyData((const uint8_t*) &ts);
+        long prevNsec = ts.tv_nsec;
+        long deltaMin = LONG_MAX;
+        long deltaMax = -1;
+        long deltaTotal = 0;
+        auto aux(entry);
+        for (;;) {
+            ++aux;
+            if (end - aux >= 0 || aux.type() != EVENT_TIMESTAMP) {
+                break;
             }
-            size_t n = (aux - entry) / (sizeof(struct timespec) + 3 /*Entry::kOverhead?*/);
-            if (deferredTimestamp) {
-                dumpLine(timestamp, body);
-                deferredTimestamp = false;
+            struct timespec tsNext;
+            aux.copyData((const uint8_t*) &tsNext);
+            if (tsNext.tv_sec != ts.tv_sec) {
+                break;
             }
-            timestamp.clear();
-            if (n >= kSquashTimestamp) {
-                timestamp.appendFormat("[%d.%03d to .%.03d by .%.03d to .%.03d]",
-                        (int) ts.tv_sec, (int) (ts.tv_nsec / 1000000),
-                        (int) ((ts.tv_nsec + deltaTotal) / 1000000),
-                        (int) (deltaMin / 1000000), (int) (deltaMax / 1000000));
-                entry = aux;
-                // advance = 0;
+            long delta = tsNext.tv_nsec - prevNsec;
+            if (delta < 0) {
                 break;
             }
-            timestamp.appendFormat("[%d.%03d]", (int) ts.tv_sec,
-                    (int) (ts.tv_nsec / 1000000));
-            deferredTimestamp = true;
+            if (delta < deltaMin) {
+                deltaMin = delta;
             }
-            break;
-        case EVENT_INTEGER:
-            appendInt(&body, entry.data());
-            break;
-        case EVENT_FLOAT:
-            appendFloat(&body, entry.data());
-            break;
-        case EVENT_PID:
-            appendPID(&body, entry.data(), entry.length());
-            break;
-#endif
-        case EVENT_START_FMT:
-            entry = handleFormat(FormatEntry(entry), &timestamp, &body);
-            break;
-        case EVENT_HISTOGRAM_ENTRY_TS: {
-            HistTsEntryWithAuthor *data = (HistTsEntryWithAuthor *) (entry->data);
-            // TODO This memcpies are here to avoid unaligned memory access crash.
-            // There's probably a more efficient way to do it
-            log_hash_t hash;
-            memcpy(&hash, &(data->hash), sizeof(hash));
-            int64_t ts;
-            memcpy(&ts, &data->ts, sizeof(ts));
-            const std::pair<log_hash_t, int> key(hash, data->author);
-            // TODO might want to filter excessively high outliers, which are usually caused
-            // by the thread being inactive.
-            mHists[key].push_back(ts);
-            ++entry;
-            break;
-        }
-        // draws histograms stored in global Reader::mHists and erases them
-        case EVENT_HISTOGRAM_FLUSH: {
-            HistogramEntry histEntry(entry);
-            // Log timestamp
-            // Timestamp of call to drawHistogram, not when audio was generated
-            const int64_t ts = histEntry.timestamp();
-            timestamp.clear();
-            timestamp.appendFormat("[%d.%03d]", (int) (ts / (1000 * 1000 * 1000)),
-                            (int) ((ts / (1000 * 1000)) % 1000));
-            // Log histograms
-            setFindGlitch(true);
-            body.appendFormat("Histogram flush - ");
-            handleAuthor(histEntry, &body);
-            for (auto hist = mHists.begin(); hist != mHists.end();) {
-                if (hist->first.second == histEntry.author()) {
-                    body.appendFormat("%X", (int)hist->first.first);
-                    if (findGlitch) {
-                        alertIfGlitch(hist->second);
-                    }
-                    // set file to empty and write data for all histograms in this set
-                    writeHistToFile(hist->second, hist != mHists.begin());
-                    drawHistogram(&body, hist->second, true, indent);
-                    hist = mHists.erase(hist);
-                } else {
-                    ++hist;
-                }
+            if (delta > deltaMax) {
+                deltaMax = delta;
             }
-            ++entry;
-            break;
+            deltaTotal += delta;
+            prevNsec = tsNext.tv_nsec;
         }
-        case EVENT_END_FMT:
-            body.appendFormat("warning: got to end format event");
-            ++entry;
-            break;
-        case EVENT_RESERVED:
-        default:
-            body.appendFormat("warning: unexpected event %d", entry->type);
-            ++entry;
+        size_t n = (aux - entry) / (sizeof(struct timespec) + 3 /*Entry::kOverhead?*/);
+        if (deferredTimestamp) {
+            dumpLine(*timestamp, *body);
+            deferredTimestamp = false;
+        }
+        timestamp->clear();
+        if (n >= kSquashTimestamp) {
+            timestamp->appendFormat("[%d.%03d to .%.03d by .%.03d to .%.03d]",
+                    (int) ts.tv_sec, (int) (ts.tv_nsec / 1000000),
+                    (int) ((ts.tv_nsec + deltaTotal) / 1000000),
+                    (int) (deltaMin / 1000000), (int) (deltaMax / 1000000));
+            entry = aux;
+            // advance = 0;
             break;
         }
-
-        if (!body.isEmpty()) {
-            dumpLine(timestamp, body);
+        timestamp->appendFormat("[%d.%03d]", (int) ts.tv_sec,
+                (int) (ts.tv_nsec / 1000000));
+        deferredTimestamp = true;
         }
+        break;
+    case EVENT_INTEGER:
+        appendInt(body, entry.data());
+        break;
+    case EVENT_FLOAT:
+        appendFloat(body, entry.data());
+        break;
+    case EVENT_PID:
+        appendPID(body, entry.data(), entry.length());
+        break;
+#endif
+    case EVENT_START_FMT:
+        entry = handleFormat(FormatEntry(entry), timestamp, body);
+        break;
+    case EVENT_HISTOGRAM_ENTRY_TS: {
+        HistTsEntryWithAuthor *data = (HistTsEntryWithAuthor *) (entry->data);
+        // TODO This memcpies are here to avoid unaligned memory access crash.
+        // There's probably a more efficient way to do it
+        log_hash_t hash;
+        memcpy(&hash, &(data->hash), sizeof(hash));
+        int64_t ts;
+        memcpy(&ts, &data->ts, sizeof(ts));
+        const std::pair<log_hash_t, int> key(hash, data->author);
+        // TODO might want to filter excessively high outliers, which are usually caused
+        // by the thread being inactive.
+        mHists[key].push_back(ts);
+        ++entry;
+        break;
+    }
+    // draws histograms stored in global Reader::mHists and erases them
+    case EVENT_HISTOGRAM_FLUSH: {
+        HistogramEntry histEntry(entry);
+        // Log timestamp
+        // Timestamp of call to drawHistogram, not when audio was generated
+        const int64_t ts = histEntry.timestamp();
+        timestamp->clear();
+        timestamp->appendFormat("[%d.%03d]", (int) (ts / (1000 * 1000 * 1000)),
+                        (int) ((ts / (1000 * 1000)) % 1000));
+        // Log histograms
+        setFindGlitch(true);
+        body->appendFormat("Histogram flush - ");
+        handleAuthor(histEntry, body);
+        for (auto hist = mHists.begin(); hist != mHists.end();) {
+            if (hist->first.second == histEntry.author()) {
+                body->appendFormat("%X", (int)hist->first.first);
+                if (findGlitch) {
+                    alertIfGlitch(hist->second);
+                }
+                // set file to empty and write data for all histograms in this set
+                writeHistToFile(hist->second, hist != mHists.begin());
+                drawHistogram(body, hist->second, true, mIndent);
+                hist = mHists.erase(hist);
+            } else {
+                ++hist;
+            }
+        }
+        ++entry;
+        break;
+    }
+    case EVENT_END_FMT:
+        body->appendFormat("warning: got to end format event");
+        ++entry;
+        break;
+    case EVENT_RESERVED:
+    default:
+        body->appendFormat("warning: unexpected event %d", entry->type);
+        ++entry;
+        break;
     }
+    return entry;
 }
 
 void NBLog::Reader::dump(int fd, size_t indent)
@@ -1492,6 +1753,76 @@ void NBLog::MergeReader::handleAuthor(const NBLog::AbstractEntry &entry, String8
 
 // ---------------------------------------------------------------------------
 
+NBLog::MultiReader::MultiReader(const void *shared, size_t size, size_t segments)
+    : Reader(NULL, 0), mSegment(-1)
+{
+    const size_t segmentSize = Timeline::sharedSize(size);
+    for (size_t i = 0; i < segments; ++i) {
+        mSegments.push_back(new Reader(
+                shared != NULL ? (const char *) shared + i * segmentSize : NULL, size));
+    }
+}
+
+NBLog::MultiReader::MultiReader(const sp<IMemory>& iMemory, size_t size, size_t segments)
+    : Reader(NULL, 0), mSegment(-1)
+{
+    for (size_t i = 0; i < segments; ++i) {
+        mSegments.push_back(new Reader(iMemory, size, i));
+    }
+}
+
+void NBLog::MultiReader::dump(int fd, size_t indent)
+{
+    mFd = fd;
+    mIndent = indent;
+    const int nSegments = mSegments.size();
+    std::vector<std::unique_ptr<Snapshot>> snapshots(nSegments);
+    std::vector<EntryIterator> offsets(nSegments);
+    String8 timestamp, body;
+    for (int i = 0; i < nSegments; ++i) {
+        snapshots[i] = mSegments[i]->getSnapshot();
+        offsets[i] = snapshots[i]->begin();
+        size_t lost = snapshots[i]->lost() +
+                (snapshots[i]->begin() - EntryIterator(snapshots[i]->data()));
+        if (lost > 0) {
+            body.appendFormat("warning: segment %d lost %zu bytes worth of events", i, lost);
+            dumpLine(timestamp, body);
+        }
+    }
+
+    // k-way merge of the snapshots by timestamp, see Merger::merge()
+    std::priority_queue<MergeItem, std::vector<MergeItem>, std::greater<MergeItem>> timestamps;
+    for (int i = 0; i < nSegments; ++i) {
+        if (offsets[i] != snapshots[i]->end()) {
+            timestamps.emplace(AbstractEntry::buildEntry(offsets[i])->timestamp(), i);
+        }
+    }
+    while (!timestamps.empty()) {
+        mSegment = timestamps.top().index;
+        timestamps.pop();
+        offsets[mSegment] = dumpEntry(offsets[mSegment], &timestamp, &body);
+        if (!body.isEmpty()) {
+            dumpLine(timestamp, body);
+        }
+        if (offsets[mSegment] != snapshots[mSegment]->end()) {
+            timestamps.emplace(AbstractEntry::buildEntry(offsets[mSegment])->timestamp(),
+                    mSegment);
+        }
+    }
+    mSegment = -1;
+}
+
+bool NBLog::MultiReader::isIMemory(const sp<IMemory>& iMemory) const
+{
+    return !mSegments.empty() && mSegments[0]->isIMemory(iMemory);
+}
+
+void NBLog::MultiReader::handleAuthor(const NBLog::AbstractEntry& /*entry*/, String8 *body) {
+    body->appendFormat("segment %d: ", mSegment);
+}
+
+// ---------------------------------------------------------------------------
+
 NBLog::MergeThread::MergeThread(NBLog::Merger &merger)
     : mMerger(merger),
       mTimeoutUs(0) {}
@@ -33,7 +33,8 @@ Pipe::Pipe(size_t maxFrames, const NBAIO_Format& format, void *buffer) :
         mFifo(mMaxFrames, Format_frameSize(format), mBuffer, false /*throttlesWriter*/),
         mFifoWriter(mFifo),
         mReaders(0),
-        mFreeBufferInDestructor(buffer == NULL)
+        mFreeBufferInDestructor(buffer == NULL),
+        mTimestampSequence(0)
 {
 }
 
@@ -60,4 +61,40 @@ ssize_t Pipe::write(const void *buffer, size_t count)
     return actual;
 }
 
+void Pipe::setTimestamp(const ExtendedTimestamp &timestamp)
+{
+    // Single writer, so a relaxed load of our own sequence is sufficient.
+    const uint32_t sequence = mTimestampSequence.load(std::memory_order_relaxed);
+    mTimestampSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mTimestamp = timestamp;
+    mTimestampSequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool Pipe::readTimestamp(ExtendedTimestamp &timestamp) const
+{
+    static const int kMaxTries = 5;
+    for (int tries = 0; tries < kMaxTries; ++tries) {
+        const uint32_t before = mTimestampSequence.load(std::memory_order_acquire);
+        if (before == 0) {
+            return false;
+        }
+        if (before & 1) {
+            continue;
+        }
+        ExtendedTimestamp temp = mTimestamp;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mTimestampSequence.load(std::memory_order_relaxed) == before) {
+            timestamp = temp;
+            return true;
+        }
+    }
+    return false;
+}
+
+status_t Pipe::getTimestamp(ExtendedTimestamp &timestamp)
+{
+    return readTimestamp(timestamp) ? (status_t) OK : INVALID_OPERATION;
+}
+
 }   // namespace android
@@ -95,4 +95,78 @@ ssize_t PipeReader::flush()
     return flushed;
 }
 
+ssize_t PipeReader::readVia(readVia_t via, size_t total, void *user, size_t block)
+{
+    if (CC_UNLIKELY(!mNegotiated)) {
+        return NEGOTIATE;
+    }
+    if (block == 0 || block > total) {
+        block = total;
+    }
+    const uint8_t *buffer = (const uint8_t *) mPipe.mBuffer;
+    size_t accumulator = 0;
+    while (accumulator < total) {
+        audio_utils_iovec iovec[2];
+        size_t lost;
+        ssize_t obtained = mFifoReader.obtain(iovec, total - accumulator, NULL /*timeout*/, &lost);
+        if (obtained == -EOVERFLOW || lost > 0) {
+            mFramesOverrun += lost;
+            ++mOverruns;
+            obtained = OVERRUN;
+        }
+        if (obtained <= 0) {
+            return accumulator > 0 ? accumulator : obtained;
+        }
+        size_t consumed = 0;
+        ssize_t ret = 0;
+        for (int i = 0; i < 2 && consumed < (size_t) obtained; ++i) {
+            const uint8_t *part = buffer + iovec[i].mOffset * mFrameSize;
+            size_t remaining = iovec[i].mLength;
+            while (remaining > 0) {
+                const size_t count = remaining < block ? remaining : block;
+                ret = via(user, part, count);
+                if (ret <= 0) {
+                    break;
+                }
+                ALOG_ASSERT((size_t) ret <= count);
+                consumed += ret;
+                part += ret * mFrameSize;
+                remaining -= ret;
+                if ((size_t) ret < count) {
+                    // the consumer is full for now
+                    ret = 0;
+                    break;
+                }
+            }
+            if (ret <= 0) {
+                break;
+            }
+        }
+        mFifoReader.release(consumed);
+        mFramesRead += consumed;
+        accumulator += consumed;
+        if (ret <= 0) {
+            return accumulator > 0 ? accumulator : ret;
+        }
+    }
+    return accumulator;
+}
+
+status_t PipeReader::getTimestamp(ExtendedTimestamp &timestamp)
+{
+    ExtendedTimestamp ets;
+    if (!mPipe.readTimestamp(ets)) {
+        return INVALID_OPERATION;
+    }
+    const int64_t position = ets.mPosition[ExtendedTimestamp::LOCATION_KERNEL];
+    const int64_t timeNs = ets.mTimeNs[ExtendedTimestamp::LOCATION_KERNEL];
+    timestamp.mPosition[ExtendedTimestamp::LOCATION_KERNEL] = position;
+    timestamp.mTimeNs[ExtendedTimestamp::LOCATION_KERNEL] = timeNs;
+    timestamp.mPosition[ExtendedTimestamp::LOCATION_CLIENT] = mFramesRead;
+    const unsigned sampleRate = Format_sampleRate(mFormat);
+    timestamp.mTimeNs[ExtendedTimestamp::LOCATION_CLIENT] = sampleRate == 0 ? 0 :
+            timeNs + (mFramesRead - position) * 1000000000LL / (int64_t) sampleRate;
+    return OK;
+}
+
 }   // namespace android
@@ -48,6 +48,10 @@ public:
 
     virtual ssize_t read(void *buffer, size_t count);
 
+    // Returns the HAL capture position in LOCATION_KERNEL.  Not to be called concurrently
+    // with read(), as the HAL may block on the stream lock.
+    virtual status_t getTimestamp(ExtendedTimestamp &timestamp);
+
     // NBAIO_Sink end
 
 #if 0   // until necessary
@@ -316,6 +316,11 @@ public:
     //  < 0     status_t error occurred prior to the first frame transfer during this callback.
     virtual ssize_t readVia(readVia_t via, size_t total, void *user, size_t block = 0);
 
+    // Returns NO_ERROR if a timestamp is available.  The timestamp includes the total number
+    // of frames captured at the source, together with the value of CLOCK_MONOTONIC
+    // as of this capture count.  The timestamp parameter is undefined if error is returned.
+    virtual status_t getTimestamp(ExtendedTimestamp& /*timestamp*/) { return INVALID_OPERATION; }
+
     // Invoked asynchronously by corresponding sink when a new timestamp is available.
     // Default implementation ignores the timestamp.
     virtual void    onTimestamp(const ExtendedTimestamp& /*timestamp*/) { }
@@ -24,6 +24,7 @@
 #include <utils/Mutex.h>
 #include <utils/threads.h>
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <vector>
@@ -221,7 +222,8 @@ struct Entry {
     /*virtual*/ ~Entry() { }
 
     // used during writing to format Entry information as follows: [type][length][data ... ][length]
-    int     copyEntryDataAt(size_t offset) const;
+    // dst must have room for mLength + kOverhead bytes
+    void    copyTo(uint8_t *dst) const;
 
 private:
     friend class Writer;
@@ -315,7 +317,8 @@ private:
 // ---------------------------------------------------------------------------
 
 // Writer is thread-safe with respect to Reader, but not with respect to multiple threads
-// calling Writer methods.  If you need multi-thread safety for writing, use LockedWriter.
+// calling Writer methods.  If you need multi-thread safety for writing, use LockedWriter,
+// or MultiWriter which gives each thread its own segment rather than taking a lock.
 class Writer : public RefBase {
 public:
     Writer();                   // dummy nop implementation without shared memory
@@ -353,6 +356,9 @@ public:
 
     sp<IMemory>     getIMemory() const  { return mIMemory; }
 
+protected:
+    sp<IMemory>     mIMemory;   // ref-counted version, initialized in constructor and then const
+
 private:
     // 0 <= length <= kMaxLength
     // writes a single Entry to the FIFO
@@ -360,8 +366,14 @@ private:
     // checks validity of an event before calling log above this one
     void    log(const Entry *entry, bool trusted = false);
 
+    // While a batch is active, log() appends entries to the batch buffer instead of the FIFO,
+    // so that a complete format entry is published with a single FIFO write.
+    void    startBatch(uint8_t *buffer);
+    void    flushBatch();
+    void    endBatch();
+    static const size_t kBatchSize = 4 * (Entry::kMaxLength + Entry::kOverhead);
+
     Shared* const   mShared;    // raw pointer to shared memory
-    sp<IMemory>     mIMemory;   // ref-counted version, initialized in constructor and then const
     audio_utils_fifo * const mFifo;                 // FIFO itself,
                                                     // non-NULL unless constructor fails
     audio_utils_fifo_writer * const mFifoWriter;    // used to write to FIFO,
@@ -372,6 +384,9 @@ private:
     // total tag length is mPidTagSize and process name is not zero terminated
     char   *mPidTag;
     size_t  mPidTagSize;
+
+    uint8_t *mBatch;            // batch buffer of kBatchSize bytes, or NULL if no batch active
+    size_t   mBatchLength;      // number of bytes used in mBatch
 };
 
 // ---------------------------------------------------------------------------
@@ -403,6 +418,64 @@ private:
 
 // ---------------------------------------------------------------------------
 
+// Similar to LockedWriter, but wait-free: instead of serializing threads through a mutex,
+// each writing thread is assigned its own segment of the shared memory, and so each segment
+// has exactly one producer.  Segments are merged by timestamp when read, see MultiReader.
+// A thread that finds no free segment drops its entries rather than blocking.
+class MultiWriter : public Writer {
+public:
+    // The shared memory must be at least sharedSize(size, segments) bytes; the constructor
+    // initializes the Shared header of every segment.
+    MultiWriter(void *shared, size_t size, size_t segments);
+    MultiWriter(const sp<IMemory>& iMemory, size_t size, size_t segments);
+
+    virtual ~MultiWriter();
+
+    // Input parameter 'size' is the desired size of each segment in byte units.
+    // Returns the total shared memory size for 'segments' segments.
+    static size_t sharedSize(size_t size, size_t segments);
+
+    virtual void    log(const char *string);
+    virtual void    logf(const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+    virtual void    logvf(const char *fmt, va_list ap);
+    virtual void    logTimestamp();
+    virtual void    logTimestamp(const int64_t ts);
+    virtual void    logInteger(const int x);
+    virtual void    logFloat(const float x);
+    virtual void    logPID();
+    virtual void    logFormat(const char *fmt, log_hash_t hash, ...);
+    virtual void    logVFormat(const char *fmt, log_hash_t hash, va_list ap);
+    virtual void    logStart(const char *fmt);
+    virtual void    logEnd();
+    virtual void    logHash(log_hash_t hash);
+    virtual void    logHistTS(log_hash_t hash);
+    virtual void    logHistFlush(log_hash_t hash);
+
+    virtual bool    isEnabled() const;
+    virtual bool    setEnabled(bool enabled);
+
+    // Releases the calling thread's segment, so that it can be reused by another thread.
+    // Must be called by the owning thread, after its last log call.
+    void            releaseThread();
+
+    // number of log calls dropped because all segments were in use
+    uint32_t        dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+    // number of segments currently owned by thread 'tid', which is at most 1
+    size_t          segmentsOwnedBy(pid_t tid) const;
+
+private:
+    // returns the segment writer owned by the calling thread, claiming a free one if needed,
+    // or NULL if all segments are owned by other threads.
+    Writer*         threadWriter();
+
+    std::vector<sp<Writer>>             mSegments;  // one single-producer Writer per segment
+    std::unique_ptr<std::atomic<pid_t>[]> mOwners;  // tid owning each segment, or 0 if free
+    std::atomic<uint32_t>               mDropped;
+};
+
+// ---------------------------------------------------------------------------
+
 class Reader : public RefBase {
 public:
 
@@ -440,6 +513,8 @@ public:
     // The size of the shared memory must be at least Timeline::sharedSize(size).
     Reader(const void *shared, size_t size);
     Reader(const sp<IMemory>& iMemory, size_t size);
+    // reads segment 'segment' of the shared memory of a MultiWriter, see MultiWriter::sharedSize()
+    Reader(const sp<IMemory>& iMemory, size_t size, size_t segment);
 
     virtual ~Reader();
 
@@ -450,20 +525,26 @@ public:
     // dump a particular snapshot of the reader
     void     dump(int fd, size_t indent, Snapshot & snap);
     // dump the current content of the reader's buffer (call getSnapshot() and previous dump())
-    void     dump(int fd, size_t indent = 0);
-    bool     isIMemory(const sp<IMemory>& iMemory) const;
+    virtual void dump(int fd, size_t indent = 0);
+    virtual bool isIMemory(const sp<IMemory>& iMemory) const;
     // if findGlitch is true, log warning when buffer periods caused glitch
     void     setFindGlitch(bool s);
     bool     isFindGlitch() const;
 
+protected:
+    // dumps the entry starting at 'entry', returns iterator to the following entry
+    EntryIterator   dumpEntry(const EntryIterator &entry, String8 *timestamp, String8 *body);
+    void            dumpLine(const String8& timestamp, String8& body);
+
+    int     mFd;                // file descriptor
+    int     mIndent;            // indentation level
+
 private:
     static const std::set<Event> startingTypes;
     static const std::set<Event> endingTypes;
     /*const*/ Shared* const mShared;    // raw pointer to shared memory, actually const but not
                                         // declared as const because audio_utils_fifo() constructor
     sp<IMemory> mIMemory;       // ref-counted version, assigned only in constructor
-    int     mFd;                // file descriptor
-    int     mIndent;            // indentation level
     audio_utils_fifo * const mFifo;                 // FIFO itself,
                                                     // non-NULL unless constructor fails
     audio_utils_fifo_reader * const mFifoReader;    // used to read from FIFO,
@@ -477,7 +558,6 @@ private:
     // timestamps, if we instead first mapped from source location to an object that
     // represented that location. And one_of its fields would be a vector of timestamps.
     // That would allow us to record other information about the source location beyond timestamps.
-    void    dumpLine(const String8& timestamp, String8& body);
 
     EntryIterator   handleFormat(const FormatEntry &fmtEntry,
                                          String8 *timestamp,
@@ -552,6 +632,24 @@ private:
     void handleAuthor(const AbstractEntry &fmtEntry, String8 *body);
 };
 
+// Reader for the segments of a MultiWriter.  The segments are merged by timestamp while
+// dumping, so entries are decoded in place from the segment snapshots and never copied
+// into an intermediate merge buffer.
+class MultiReader : public Reader {
+public:
+    MultiReader(const void *shared, size_t size, size_t segments);
+    // reads the first 'segments' segments of the shared memory of a MultiWriter
+    MultiReader(const sp<IMemory>& iMemory, size_t size, size_t segments);
+
+    virtual void dump(int fd, size_t indent = 0) override;
+    virtual bool isIMemory(const sp<IMemory>& iMemory) const override;
+private:
+    std::vector<sp<Reader>> mSegments;
+    int mSegment;               // segment of the entry being dumped
+    // prefixes the body with the segment that originated the entry
+    virtual void handleAuthor(const AbstractEntry &fmtEntry, String8 *body) override;
+};
+
 // MergeThread is a thread that contains a Merger. It works as a retriggerable one-shot:
 // when triggered, it awakes for a lapse of time, during which it periodically merges; if
 // retriggered, the timeout is reset.
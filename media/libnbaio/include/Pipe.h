@@ -17,6 +17,7 @@
 #ifndef ANDROID_AUDIO_PIPE_H
 #define ANDROID_AUDIO_PIPE_H
 
+#include <atomic>
 #include <audio_utils/fifo.h>
 #include "NBAIO.h"
 
@@ -25,6 +26,8 @@ namespace android {
 // Pipe is multi-thread safe for readers (see PipeReader), but safe for only a single writer thread.
 // It cannot UNDERRUN on write, unless we allow designation of a master reader that provides the
 // time-base. Readers can be added and removed dynamically, and it's OK to have no readers.
+// Each reader has its own position and overrun accounting, and reads directly from the shared
+// buffer, so fanning out to N readers costs the writer a single copy.
 class Pipe : public NBAIO_Sink {
 
     friend class PipeReader;
@@ -57,13 +60,30 @@ public:
     virtual ssize_t write(const void *buffer, size_t count);
     //virtual ssize_t writeVia(writeVia_t via, size_t total, void *user, size_t block);
 
+    // Returns the most recent timestamp passed to setTimestamp(), if any.
+    virtual status_t getTimestamp(ExtendedTimestamp &timestamp);
+
+    // Publish a presentation timestamp for the data in this pipe, to be observed by all readers
+    // via PipeReader::getTimestamp().  LOCATION_KERNEL is the frame position relative to
+    // framesWritten() and the time at which that frame is (or was) presented.
+    // Lock-free; must only be called by the single writer thread.
+            void    setTimestamp(const ExtendedTimestamp &timestamp);
+
 private:
+    // Lock-free snapshot of the published timestamp; returns false if none has been published
+    // or the writer kept updating it during the attempt.  Safe for any number of readers.
+            bool    readTimestamp(ExtendedTimestamp &timestamp) const;
+
     const size_t    mMaxFrames;     // always a power of 2
     void * const    mBuffer;
     audio_utils_fifo        mFifo;
     audio_utils_fifo_writer mFifoWriter;
     volatile int32_t mReaders;      // number of PipeReader clients currently attached to this Pipe
     const bool      mFreeBufferInDestructor;
+
+    // Sequence lock for mTimestamp: odd while the writer is updating it, 0 if never published.
+    std::atomic<uint32_t> mTimestampSequence;
+    ExtendedTimestamp mTimestamp;
 };
 
 }   // namespace android
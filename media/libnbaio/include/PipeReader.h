@@ -47,10 +47,21 @@ public:
 
     virtual ssize_t read(void *buffer, size_t count);
 
+    // Zero-copy: the callback consumes directly from the pipe buffer, in up to two contiguous
+    // parts per obtained region.  As with read(), the writer is not throttled, so a reader that
+    // falls behind by more than the pipe capacity may observe overwritten data; that overrun is
+    // reported by the next call.
+    virtual ssize_t readVia(readVia_t via, size_t total, void *user, size_t block = 0);
+
     virtual ssize_t flush();
 
     // NBAIO_Source end
 
+    // Returns the pipe's most recent timestamp (see Pipe::setTimestamp) in LOCATION_KERNEL,
+    // and this reader's position with its estimated presentation time in LOCATION_CLIENT.
+    // Returns INVALID_OPERATION if the writer has not yet published a timestamp.
+    virtual status_t getTimestamp(ExtendedTimestamp &timestamp);
+
 #if 0   // until necessary
     Pipe& pipe() const { return mPipe; }
 #endif
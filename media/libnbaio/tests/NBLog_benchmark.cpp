@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Producer cost of one log call, with 1 to kMaxThreads threads logging at the same time,
+ * as FastMixer, FastCapture and the normal mixer threads do. The threads share either a
+ * LockedWriter, which serializes them through its mutex, or a MultiWriter, which gives
+ * each thread its own segment. Nothing reads the logs, so the FIFOs just wrap around.
+ */
+
+#include <stdlib.h>
+
+#include <benchmark/benchmark.h>
+
+#include <media/nbaio/NBLog.h>
+
+using namespace android;
+
+static const size_t kSize = 0x1000;     // per writer thread, as used by AudioFlinger
+static const int kMaxThreads = 4;
+
+static NBLog::LockedWriter *lockedWriter()
+{
+    static void *shared = calloc(1, NBLog::Timeline::sharedSize(kSize));
+    static NBLog::LockedWriter *writer = new NBLog::LockedWriter(shared, kSize);
+    return writer;
+}
+
+static NBLog::MultiWriter *multiWriter()
+{
+    static void *shared = calloc(1, NBLog::MultiWriter::sharedSize(kSize, kMaxThreads));
+    static NBLog::MultiWriter *writer = new NBLog::MultiWriter(shared, kSize, kMaxThreads);
+    return writer;
+}
+
+static void BM_LockedWriterLogInteger(benchmark::State& state)
+{
+    NBLog::LockedWriter *writer = lockedWriter();
+    int i = 0;
+    while (state.KeepRunning()) {
+        writer->logInteger(i++);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_MultiWriterLogInteger(benchmark::State& state)
+{
+    NBLog::MultiWriter *writer = multiWriter();
+    int i = 0;
+    while (state.KeepRunning()) {
+        writer->logInteger(i++);
+    }
+    // so that the segment is free for the next run
+    writer->releaseThread();
+    state.SetItemsProcessed(state.iterations());
+}
+
+// A whole format entry: start, timestamp, hash, arguments and end
+static void BM_MultiWriterLogFormat(benchmark::State& state)
+{
+    NBLog::MultiWriter *writer = multiWriter();
+    int i = 0;
+    while (state.KeepRunning()) {
+        writer->logFormat("underrun %d frames %f ms", 0 /*hash*/, i++, 2.5f);
+    }
+    writer->releaseThread();
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_LockedWriterLogInteger)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_MultiWriterLogInteger)->ThreadRange(1, kMaxThreads);
+BENCHMARK(BM_MultiWriterLogFormat)->ThreadRange(1, kMaxThreads);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "NBLog_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <media/nbaio/NBLog.h>
+
+namespace android {
+
+static const size_t kSegmentSize = 0x1000;
+
+class MultiWriterTest : public ::testing::Test {
+protected:
+    void init(size_t segments) {
+        mShared = malloc(NBLog::MultiWriter::sharedSize(kSegmentSize, segments));
+        ASSERT_TRUE(mShared != NULL);
+        mWriter = new NBLog::MultiWriter(mShared, kSegmentSize, segments);
+    }
+
+    virtual void TearDown() {
+        mWriter.clear();
+        free(mShared);
+    }
+
+    void *mShared = NULL;
+    sp<NBLog::MultiWriter> mWriter;
+};
+
+TEST_F(MultiWriterTest, ThreadKeepsSegmentAfterLowerSegmentIsReleased) {
+    init(2);
+
+    // another thread claims segment 0 ...
+    std::promise<void> claimed, release, released;
+    std::thread other([&]() {
+        mWriter->log("other");
+        claimed.set_value();
+        release.get_future().wait();
+        mWriter->releaseThread();
+        released.set_value();
+    });
+    claimed.get_future().wait();
+
+    // ... so this thread gets segment 1
+    const pid_t tid = gettid();
+    mWriter->log("first");
+    EXPECT_EQ(1u, mWriter->segmentsOwnedBy(tid));
+
+    // segment 0 is now free, but must not be claimed by a thread which already has a segment
+    release.set_value();
+    released.get_future().wait();
+    other.join();
+    mWriter->log("second");
+    EXPECT_EQ(1u, mWriter->segmentsOwnedBy(tid));
+
+    // so that it is still available to a new thread
+    std::thread third([&]() {
+        mWriter->log("third");
+        EXPECT_EQ(1u, mWriter->segmentsOwnedBy(gettid()));
+        mWriter->releaseThread();
+        EXPECT_EQ(0u, mWriter->segmentsOwnedBy(gettid()));
+    });
+    third.join();
+    EXPECT_EQ(0u, mWriter->dropped());
+
+    mWriter->releaseThread();
+    EXPECT_EQ(0u, mWriter->segmentsOwnedBy(tid));
+}
+
+TEST_F(MultiWriterTest, ConcurrentClaimReleaseReclaim) {
+    static const size_t kThreads = 8;
+    static const int kIterations = 2000;
+    init(kThreads);
+
+    std::vector<pid_t> tids(kThreads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; ++t) {
+        threads.emplace_back([this, t, &tids]() {
+            const pid_t tid = gettid();
+            tids[t] = tid;
+            for (int i = 0; i < kIterations; ++i) {
+                mWriter->logInteger(i);
+                ASSERT_EQ(1u, mWriter->segmentsOwnedBy(tid));
+                // threads release at different rates, so that segments are freed below and
+                // above the ones owned by the other threads
+                if (i % (t + 2) == 0) {
+                    mWriter->releaseThread();
+                    ASSERT_EQ(0u, mWriter->segmentsOwnedBy(tid));
+                }
+            }
+            mWriter->releaseThread();
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // with as many segments as threads, and at most one segment per thread,
+    // a thread always finds a free segment
+    EXPECT_EQ(0u, mWriter->dropped());
+    for (pid_t tid : tids) {
+        EXPECT_EQ(0u, mWriter->segmentsOwnedBy(tid));
+    }
+}
+
+TEST_F(MultiWriterTest, DropsWhenAllSegmentsAreOwned) {
+    init(1);
+
+    std::promise<void> claimed, done;
+    std::thread other([&]() {
+        mWriter->log("other");
+        claimed.set_value();
+        done.get_future().wait();
+        mWriter->releaseThread();
+    });
+    claimed.get_future().wait();
+
+    mWriter->log("dropped");
+    EXPECT_EQ(0u, mWriter->segmentsOwnedBy(gettid()));
+    EXPECT_EQ(1u, mWriter->dropped());
+
+    done.set_value();
+    other.join();
+    mWriter->log("kept");
+    EXPECT_EQ(1u, mWriter->segmentsOwnedBy(gettid()));
+    EXPECT_EQ(1u, mWriter->dropped());
+    mWriter->releaseThread();
+}
+
+class MultiReaderTest : public MultiWriterTest {
+protected:
+    void init(size_t segments) {
+        MultiWriterTest::init(segments);
+        mReader = new NBLog::MultiReader(mShared, kSegmentSize, segments);
+    }
+
+    // Logs "seq <first>" to "seq <first + count - 1>" from 'threads' threads taking turns,
+    // so that consecutive entries come from different segments.
+    void logRoundRobin(size_t threads, int first, int count) {
+        std::mutex lock;
+        std::condition_variable turnChanged;
+        int turn = first;
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < threads; ++t) {
+            writers.emplace_back([&, t]() {
+                for (int i = first + t; i < first + count; i += threads) {
+                    std::unique_lock<std::mutex> l(lock);
+                    turnChanged.wait(l, [&]() { return turn == i; });
+                    mWriter->logFormat("seq %d", 0 /*hash*/, i);
+                    ++turn;
+                    turnChanged.notify_all();
+                }
+                mWriter->releaseThread();
+            });
+        }
+        for (auto &writer : writers) {
+            writer.join();
+        }
+    }
+
+    // Dumps the reader, and returns the logged sequence numbers in dump order, the segment
+    // of each, and the number of lines reporting lost events.
+    void dump(std::vector<int> *seqs, std::vector<int> *segments, int *lostLines) {
+        FILE *f = tmpfile();
+        ASSERT_TRUE(f != NULL);
+        mReader->dump(fileno(f));
+        rewind(f);
+        char line[256];
+        *lostLines = 0;
+        while (fgets(line, sizeof(line), f) != NULL) {
+            int segment, seq;
+            const char *author = strstr(line, "segment ");
+            if (strstr(line, "lost") != NULL) {
+                ++*lostLines;
+            } else if (author != NULL &&
+                    sscanf(author, "segment %d: seq <%d>", &segment, &seq) == 2) {
+                seqs->push_back(seq);
+                segments->push_back(segment);
+            }
+        }
+        fclose(f);
+    }
+
+    virtual void TearDown() {
+        mReader.clear();
+        MultiWriterTest::TearDown();
+    }
+
+    sp<NBLog::MultiReader> mReader;
+};
+
+TEST_F(MultiReaderTest, MergesSegmentsInTimestampOrder) {
+    static const int kEntries = 30;
+    init(3);
+    logRoundRobin(3, 0, kEntries);
+
+    std::vector<int> seqs, segments;
+    int lostLines;
+    dump(&seqs, &segments, &lostLines);
+    EXPECT_EQ(0, lostLines);
+    ASSERT_EQ((size_t) kEntries, seqs.size());
+    for (int i = 0; i < kEntries; ++i) {
+        EXPECT_EQ(i, seqs[i]);
+    }
+    // the entries came from several segments
+    std::sort(segments.begin(), segments.end());
+    EXPECT_EQ(3, std::unique(segments.begin(), segments.end()) - segments.begin());
+
+    // dumping consumes the entries
+    seqs.clear();
+    dump(&seqs, &segments, &lostLines);
+    EXPECT_TRUE(seqs.empty());
+}
+
+TEST_F(MultiReaderTest, KeepsOrderAcrossWrapAround) {
+    // each round is less than a segment, but together they wrap around each segment FIFO
+    static const int kRounds = 6;
+    static const int kEntriesPerRound = 60;
+    init(2);
+
+    for (int round = 0; round < kRounds; ++round) {
+        logRoundRobin(2, round * kEntriesPerRound, kEntriesPerRound);
+        std::vector<int> seqs, segments;
+        int lostLines;
+        dump(&seqs, &segments, &lostLines);
+        EXPECT_EQ(0, lostLines);
+        ASSERT_EQ((size_t) kEntriesPerRound, seqs.size());
+        for (int i = 0; i < kEntriesPerRound; ++i) {
+            EXPECT_EQ(round * kEntriesPerRound + i, seqs[i]);
+        }
+    }
+}
+
+TEST_F(MultiReaderTest, ReportsLostEventsAfterOverrun) {
+    static const int kEntries = 500;
+    init(2);
+    logRoundRobin(1, 0, kEntries);
+
+    std::vector<int> seqs, segments;
+    int lostLines;
+    dump(&seqs, &segments, &lostLines);
+    EXPECT_EQ(1, lostLines);
+    // the oldest entries were overwritten, the newest ones are dumped in order
+    ASSERT_FALSE(seqs.empty());
+    ASSERT_LT(seqs.size(), (size_t) kEntries);
+    for (size_t i = 0; i < seqs.size(); ++i) {
+        EXPECT_EQ(kEntries - (int) seqs.size() + (int) i, seqs[i]);
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "Pipe_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <media/nbaio/Pipe.h>
+#include <media/nbaio/PipeReader.h>
+
+namespace android {
+
+static const size_t kPipeFrames = 16;
+static const unsigned kSampleRate = 48000;
+
+// Collects the frames handed out by PipeReader::readVia(), and the size of each part.
+struct Collector {
+    std::vector<int16_t> mFrames;
+    std::vector<size_t> mParts;
+    size_t mLimit = SIZE_MAX;   // frames accepted before reporting the consumer as full
+};
+
+static ssize_t collect(void *user, const void *buffer, size_t count)
+{
+    Collector *collector = (Collector *) user;
+    const size_t room = collector->mLimit - collector->mFrames.size();
+    if (count > room) {
+        count = room;
+    }
+    const int16_t *frames = (const int16_t *) buffer;
+    collector->mFrames.insert(collector->mFrames.end(), frames, frames + count);
+    collector->mParts.push_back(count);
+    return count;
+}
+
+class PipeTest : public ::testing::Test {
+protected:
+    PipeTest()
+        : mFormat(Format_from_SR_C(kSampleRate, 1, AUDIO_FORMAT_PCM_16_BIT)),
+          mPipe(kPipeFrames, mFormat),
+          mNext(0) {
+        negotiate(&mPipe);
+    }
+
+    template <typename Port>
+    void negotiate(Port *port) {
+        const NBAIO_Format offers[1] = {mFormat};
+        size_t numCounterOffers = 0;
+        ASSERT_EQ(0, port->negotiate(offers, 1, NULL, numCounterOffers));
+    }
+
+    // writes 'count' frames, each frame holding its own index since the pipe was created
+    void writeFrames(size_t count) {
+        std::vector<int16_t> frames(count);
+        for (auto &frame : frames) {
+            frame = mNext++;
+        }
+        ASSERT_EQ((ssize_t) count, mPipe.write(frames.data(), count));
+    }
+
+    static void expectSequence(const std::vector<int16_t> &frames, int16_t first) {
+        for (size_t i = 0; i < frames.size(); ++i) {
+            EXPECT_EQ((int16_t) (first + i), frames[i]) << "at frame " << i;
+        }
+    }
+
+    const NBAIO_Format mFormat;
+    Pipe mPipe;
+    int16_t mNext;
+};
+
+TEST_F(PipeTest, ReadViaWrapsAround) {
+    PipeReader reader(mPipe);
+    negotiate(&reader);
+
+    writeFrames(12);
+    Collector first;
+    EXPECT_EQ(12, reader.readVia(collect, 12, &first, 5 /*block*/));
+    expectSequence(first.mFrames, 0);
+    EXPECT_EQ((std::vector<size_t>{5, 5, 2}), first.mParts);
+
+    // frames 12..23 end at index 7 of the 16 frame buffer, so they are handed out in two parts
+    writeFrames(12);
+    Collector second;
+    EXPECT_EQ(12, reader.readVia(collect, 12, &second));
+    expectSequence(second.mFrames, 12);
+    EXPECT_EQ((std::vector<size_t>{4, 8}), second.mParts);
+
+    EXPECT_EQ(24, reader.framesRead());
+    EXPECT_EQ(0, reader.overruns());
+}
+
+TEST_F(PipeTest, ReadViaStopsWhenConsumerIsFull) {
+    PipeReader reader(mPipe);
+    negotiate(&reader);
+
+    writeFrames(10);
+    Collector collector;
+    collector.mLimit = 6;
+    EXPECT_EQ(6, reader.readVia(collect, 10, &collector));
+    expectSequence(collector.mFrames, 0);
+
+    // the frames refused by the consumer are still available
+    Collector rest;
+    EXPECT_EQ(4, reader.readVia(collect, 10, &rest));
+    expectSequence(rest.mFrames, 6);
+}
+
+TEST_F(PipeTest, ReadViaReportsOverrun) {
+    PipeReader reader(mPipe);
+    negotiate(&reader);
+
+    // the writer is not throttled, so writing more than the pipe holds overruns the reader
+    writeFrames(kPipeFrames);
+    writeFrames(8);
+    Collector overrun;
+    EXPECT_EQ((ssize_t) OVERRUN, reader.readVia(collect, kPipeFrames, &overrun));
+    EXPECT_TRUE(overrun.mFrames.empty());
+    EXPECT_EQ(1, reader.overruns());
+    EXPECT_GT(reader.framesOverrun(), 0);
+
+    // PipeReader flushes on overrun, so it resumes with the frames written after the overrun
+    writeFrames(4);
+    Collector recovered;
+    EXPECT_EQ(4, reader.readVia(collect, kPipeFrames, &recovered));
+    expectSequence(recovered.mFrames, kPipeFrames + 8);
+    EXPECT_EQ(1, reader.overruns());
+}
+
+TEST_F(PipeTest, ReadersFanOutIndependently) {
+    PipeReader fast(mPipe);
+    negotiate(&fast);
+    PipeReader slow(mPipe);
+    negotiate(&slow);
+
+    writeFrames(8);
+    Collector fastFrames, slowFrames;
+    EXPECT_EQ(8, fast.readVia(collect, 8, &fastFrames));
+    writeFrames(4);
+    EXPECT_EQ(4, fast.readVia(collect, 8, &fastFrames));
+    EXPECT_EQ(12, slow.readVia(collect, 12, &slowFrames));
+    expectSequence(fastFrames.mFrames, 0);
+    EXPECT_EQ(fastFrames.mFrames, slowFrames.mFrames);
+}
+
+TEST_F(PipeTest, TimestampNotPublished) {
+    PipeReader reader(mPipe);
+    negotiate(&reader);
+    ExtendedTimestamp timestamp;
+    EXPECT_EQ(INVALID_OPERATION, mPipe.getTimestamp(timestamp));
+    EXPECT_EQ(INVALID_OPERATION, reader.getTimestamp(timestamp));
+}
+
+TEST_F(PipeTest, TimestampReaderPosition) {
+    PipeReader reader(mPipe);
+    negotiate(&reader);
+
+    writeFrames(8);
+    Collector collector;
+    ASSERT_EQ(4, reader.readVia(collect, 4, &collector));
+
+    // frame 8 is presented at 1 s
+    ExtendedTimestamp published;
+    published.mPosition[ExtendedTimestamp::LOCATION_KERNEL] = 8;
+    published.mTimeNs[ExtendedTimestamp::LOCATION_KERNEL] = 1000000000LL;
+    mPipe.setTimestamp(published);
+
+    ExtendedTimestamp timestamp;
+    ASSERT_EQ(OK, reader.getTimestamp(timestamp));
+    EXPECT_EQ(8, timestamp.mPosition[ExtendedTimestamp::LOCATION_KERNEL]);
+    EXPECT_EQ(1000000000LL, timestamp.mTimeNs[ExtendedTimestamp::LOCATION_KERNEL]);
+    EXPECT_EQ(4, timestamp.mPosition[ExtendedTimestamp::LOCATION_CLIENT]);
+    EXPECT_EQ(1000000000LL - 4 * 1000000000LL / kSampleRate,
+            timestamp.mTimeNs[ExtendedTimestamp::LOCATION_CLIENT]);
+}
+
+// Readers polling the sequence lock while the writer publishes must never see a torn timestamp.
+TEST_F(PipeTest, ConcurrentTimestampReaders) {
+    static const int kReaders = 4;
+    static const int64_t kUpdates = 200000;
+
+    // every published timestamp satisfies timeNs == position * 1000, with the same relation
+    // in every location, so a mix of two updates is detected
+    auto makeTimestamp = [](int64_t position) {
+        ExtendedTimestamp timestamp;
+        for (int i = 0; i < ExtendedTimestamp::LOCATION_MAX; ++i) {
+            timestamp.mPosition[i] = position;
+            timestamp.mTimeNs[i] = position * 1000;
+        }
+        return timestamp;
+    };
+    mPipe.setTimestamp(makeTimestamp(0));
+
+    std::atomic<bool> done(false);
+    std::atomic<int> torn(0);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < kReaders; ++r) {
+        readers.emplace_back([&]() {
+            int64_t last = 0;
+            while (!done.load()) {
+                ExtendedTimestamp timestamp;
+                if (mPipe.getTimestamp(timestamp) != OK) {
+                    // the writer kept updating during every attempt
+                    continue;
+                }
+                const int64_t position = timestamp.mPosition[0];
+                for (int i = 0; i < ExtendedTimestamp::LOCATION_MAX; ++i) {
+                    if (timestamp.mPosition[i] != position ||
+                            timestamp.mTimeNs[i] != position * 1000) {
+                        torn++;
+                    }
+                }
+                // a single writer publishes increasing positions
+                if (position < last) {
+                    torn++;
+                }
+                last = position;
+            }
+        });
+    }
+
+    for (int64_t position = 1; position <= kUpdates; ++position) {
+        mPipe.setTimestamp(makeTimestamp(position));
+    }
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(0, torn.load());
+
+    ExtendedTimestamp timestamp;
+    ASSERT_EQ(OK, mPipe.getTimestamp(timestamp));
+    EXPECT_EQ(kUpdates, timestamp.mPosition[ExtendedTimestamp::LOCATION_KERNEL]);
+}
+
+}  // namespace android
@@ -2368,6 +2368,22 @@ status_t ACodec::configureCodec(
         }
     }
 
+    if (!video && !encoder && pcmEncoding == kAudioEncodingPcmFloat
+            && strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_RAW)) {
+        // ask the decoder for float output. Decoders that only produce 16-bit PCM reject this,
+        // and their output is converted below (verified via readback of the output format.)
+        OMX_AUDIO_PARAM_PCMMODETYPE pcmParams;
+        InitOMXParams(&pcmParams);
+        pcmParams.nPortIndex = kPortIndexOutput;
+        if (mOMXNode->getParameter(
+                OMX_IndexParamAudioPcm, &pcmParams, sizeof(pcmParams)) == OK) {
+            pcmParams.eNumData = OMX_NumericalDataFloat;
+            pcmParams.nBitPerSample = 32;
+            (void)mOMXNode->setParameter(
+                    OMX_IndexParamAudioPcm, &pcmParams, sizeof(pcmParams)); // ignore errors
+        }
+    }
+
     if (!msg->findInt32("encoder-delay", &mEncoderDelay)) {
         mEncoderDelay = 0;
     }
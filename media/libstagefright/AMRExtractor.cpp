@@ -51,6 +51,12 @@ protected:
     virtual ~AMRSource();
 
 private:
+    enum {
+        kMaxFrameSize = 128,
+        // Packed buffers of up to one second; fits the input buffers of the soft decoders.
+        kMaxFramesPerBuffer = 50,
+    };
+
     sp<DataSource> mDataSource;
     sp<MetaData> mMeta;
     bool mIsWide;
@@ -58,6 +64,7 @@ private:
     off64_t mOffset;
     int64_t mCurrentTimeUs;
     bool mStarted;
+    size_t mFramesPerBuffer;
     MediaBufferGroup *mGroup;
 
     off64_t mOffsetTable[OFFSET_TABLE_LEN];
@@ -214,6 +221,7 @@ AMRSource::AMRSource(
       mOffset(mIsWide ? 9 : 6),
       mCurrentTimeUs(0),
       mStarted(false),
+      mFramesPerBuffer(1),
       mGroup(NULL),
       mOffsetTableLength(offset_table_length) {
     if (mOffsetTableLength > 0 && mOffsetTableLength <= OFFSET_TABLE_LEN) {
@@ -227,13 +235,25 @@ AMRSource::~AMRSource() {
     }
 }
 
-status_t AMRSource::start(MetaData * /* params */) {
+status_t AMRSource::start(MetaData *params) {
     CHECK(!mStarted);
 
+    // By default every buffer holds a single 20ms frame. Bulk decoders can ask for buffers
+    // with several consecutive frames; the frames are in storage format, so the size of each
+    // of them follows from its header byte.
+    int32_t framesPerBuffer;
+    if (params && params->findInt32(kKeyFramesPerBuffer, &framesPerBuffer)
+            && framesPerBuffer > 1) {
+        mFramesPerBuffer = framesPerBuffer < kMaxFramesPerBuffer
+                ? framesPerBuffer : kMaxFramesPerBuffer;
+    } else {
+        mFramesPerBuffer = 1;
+    }
+
     mOffset = mIsWide ? 9 : 6;
     mCurrentTimeUs = 0;
     mGroup = new MediaBufferGroup;
-    mGroup->add_buffer(new MediaBuffer(128));
+    mGroup->add_buffer(new MediaBuffer(kMaxFrameSize * mFramesPerBuffer));
     mStarted = true;
 
     return OK;
@@ -281,55 +301,70 @@ status_t AMRSource::read(
         }
     }
 
-    uint8_t header;
-    ssize_t n = mDataSource->readAt(mOffset, &header, 1);
-
-    if (n < 1) {
-        return ERROR_END_OF_STREAM;
-    }
-
-    if (header & 0x83) {
-        // Padding bits must be 0.
-
-        ALOGE("padding bits must be 0, header is 0x%02x", header);
-
-        return ERROR_MALFORMED;
-    }
-
-    unsigned FT = (header >> 3) & 0x0f;
-
-    size_t frameSize = getFrameSize(mIsWide, FT);
-    if (frameSize == 0) {
-        return ERROR_MALFORMED;
-    }
-
     MediaBuffer *buffer;
     status_t err = mGroup->acquire_buffer(&buffer);
     if (err != OK) {
         return err;
     }
 
-    n = mDataSource->readAt(mOffset, buffer->data(), frameSize);
+    // Read up to mFramesPerBuffer frames at once and split them by their header bytes.
+    uint8_t *data = (uint8_t *)buffer->data();
+    ssize_t n = mDataSource->readAt(mOffset, data, buffer->size());
 
-    if (n != (ssize_t)frameSize) {
+    if (n < 1) {
         buffer->release();
         buffer = NULL;
 
-        if (n < 0) {
-            return ERROR_IO;
+        return ERROR_END_OF_STREAM;
+    }
+
+    size_t length = 0;
+    size_t numFrames = 0;
+    while (numFrames < mFramesPerBuffer && length < (size_t)n) {
+        uint8_t header = data[length];
+
+        size_t frameSize = 0;
+        if (header & 0x83) {
+            // Padding bits must be 0.
+            ALOGE("padding bits must be 0, header is 0x%02x", header);
         } else {
+            unsigned FT = (header >> 3) & 0x0f;
+            frameSize = getFrameSize(mIsWide, FT);
+        }
+
+        if (frameSize == 0) {
+            if (numFrames > 0) {
+                // return the frames before it; the next read fails on this one
+                break;
+            }
+            buffer->release();
+            buffer = NULL;
+
+            return ERROR_MALFORMED;
+        }
+
+        if (length + frameSize > (size_t)n) {
+            if (numFrames > 0) {
+                break;
+            }
+            buffer->release();
+            buffer = NULL;
+
             // only partial frame is available, treat it as EOS.
             mOffset += n;
             return ERROR_END_OF_STREAM;
         }
+
+        length += frameSize;
+        ++numFrames;
     }
 
-    buffer->set_range(0, frameSize);
+    buffer->set_range(0, length);
     buffer->meta_data()->setInt64(kKeyTime, mCurrentTimeUs);
     buffer->meta_data()->setInt32(kKeyIsSyncFrame, 1);
 
-    mOffset += frameSize;
-    mCurrentTimeUs += 20000;  // Each frame is 20ms
+    mOffset += length;
+    mCurrentTimeUs += 20000 * numFrames;  // Each frame is 20ms
 
     *out = buffer;
 
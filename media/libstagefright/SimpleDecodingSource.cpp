@@ -116,14 +116,14 @@ SimpleDecodingSource::~SimpleDecodingSource() {
 }
 
 status_t SimpleDecodingSource::start(MetaData *params) {
-    (void)params;
     Mutexed<ProtectedState>::Locked me(mProtectedState);
     if (me->mState != INIT) {
         return -EINVAL;
     }
     status_t res = mCodec->start();
     if (res == OK) {
-        res = mSource->start();
+        // e.g. kKeyFramesPerBuffer for bulk decoding
+        res = mSource->start(params);
     }
 
     if (res == OK) {
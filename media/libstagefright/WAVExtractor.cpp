@@ -462,9 +462,10 @@ status_t WAVSource::read(
 
     if (mWaveFormat == WAVE_FORMAT_MSGSM) {
         // Microsoft packs 2 frames into 65 bytes, rather than using separate 33-byte frames,
-        // so read multiples of 65, and use smaller buffers to account for ~10:1 expansion ratio
-        if (maxBytesToRead > 1024) {
-            maxBytesToRead = 1024;
+        // so read multiples of 65. Buffers of one second (50 * 65 bytes) decode into a single
+        // output buffer of the soft decoder despite the ~10:1 expansion ratio.
+        if (maxBytesToRead > 50 * 65) {
+            maxBytesToRead = 50 * 65;
         }
         maxBytesToRead = (maxBytesToRead / 65) * 65;
     } else {
@@ -3,11 +3,20 @@ include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES:= \
         C2.cpp    \
+        vndk/C2AllocatorMemfd.cpp \
+        vndk/C2Buffer.cpp \
+        vndk/C2PooledBlockAllocator.cpp \
 
 LOCAL_C_INCLUDES += \
         $(TOP)/frameworks/av/media/libstagefright/codec2/include \
+        $(TOP)/frameworks/av/media/libstagefright/codec2/vndk/include \
         $(TOP)/frameworks/native/include/media/hardware \
 
+LOCAL_SHARED_LIBRARIES := \
+        libcutils \
+        liblog \
+        libutils \
+
 LOCAL_MODULE:= libstagefright_codec2
 LOCAL_CFLAGS += -Werror -Wall
 LOCAL_CLANG := true
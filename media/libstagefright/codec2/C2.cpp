@@ -32,5 +32,7 @@ namespace android {
  * Codec2 clients.
  */
 
+C2ComponentListener::~C2ComponentListener() = default;
+
 } // namespace android
 
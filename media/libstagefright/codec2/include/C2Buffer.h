@@ -405,6 +405,13 @@ protected:
  */
 
 class C2LinearAllocation;
+class C2GraphicAllocation;
+
+/**
+ * Creates blocks from allocations. This is provided by the implementation (and used by block
+ * allocators), as blocks cannot be created directly.
+ */
+struct _C2BlockFactory;
 
 class C2Block1D : public _C2LinearRangeAspect {
 public:
@@ -415,6 +422,7 @@ protected:
     C2Block1D(std::shared_ptr<C2LinearAllocation> alloc, size_t offset, size_t size);
 
 private:
+    friend struct _C2BlockFactory;
     class Impl;
     std::shared_ptr<Impl> mImpl;
 };
@@ -448,7 +456,11 @@ public:
     C2Error error();
 
 private:
+    friend class C2ConstLinearBlock;
     class Impl;
+    C2ReadView(std::shared_ptr<Impl> impl, uint32_t capacity);
+    explicit C2ReadView(C2Error error);
+
     std::shared_ptr<Impl> mImpl;
 };
 
@@ -477,7 +489,11 @@ public:
     C2Error error();
 
 private:
+    friend class C2LinearBlock;
     class Impl;
+    C2WriteView(std::shared_ptr<Impl> impl, const _C2LinearRangeAspect *block);
+    explicit C2WriteView(C2Error error);
+
     /// \todo should this be unique_ptr to make this movable only - to avoid inconsistent regions
     /// between copies.
     std::shared_ptr<Impl> mImpl;
@@ -517,6 +533,11 @@ public:
     C2Fence fence() const { return mFence; }
 
 private:
+    friend struct _C2BlockFactory;
+    friend class C2LinearBlock;
+    C2ConstLinearBlock(
+            std::shared_ptr<C2LinearAllocation> alloc, size_t offset, size_t size, C2Fence fence);
+
     C2Fence mFence;
 };
 
@@ -544,6 +565,10 @@ public:
      *    The block shall be modified only until firing the event for the fence.
      */
     C2ConstLinearBlock share(size_t offset, size_t size, C2Fence fence);
+
+private:
+    friend struct _C2BlockFactory;
+    C2LinearBlock(std::shared_ptr<C2LinearAllocation> alloc, size_t offset, size_t size);
 };
 
 /// @}
@@ -895,19 +920,41 @@ class _C2PlanarSection : public _C2PlanarCapacityAspect {
 public:
     // crop can be an empty rect, does not have to line up with subsampling
     // NOTE: we do not support floating-point crop
-    inline const C2Rect crop() { return mCrop; }
+    inline const C2Rect crop() const { return mCrop; }
 
     /**
      *  Sets crop to crop intersected with [(0,0) .. (width, height)]
      */
-    inline void setCrop_be(const C2Rect &crop);
+    inline void setCrop_be(const C2Rect &crop) {
+        uint32_t left = c2_min(crop.mLeft, width());
+        uint32_t top = c2_min(crop.mTop, height());
+        mCrop = C2Rect(
+                c2_min(crop.mWidth, width() - left), c2_min(crop.mHeight, height() - top),
+                left, top);
+    }
 
     /**
      * If crop is within the dimensions of this object, it sets crop to it.
      *
      * \return true iff crop is within the dimensions of this object
      */
-    inline bool setCrop(const C2Rect &crop);
+    inline bool setCrop(const C2Rect &crop) {
+        if (crop.mLeft > width() || crop.mTop > height()
+                || crop.mWidth > width() - crop.mLeft || crop.mHeight > height() - crop.mTop) {
+            return false;
+        }
+        mCrop = crop;
+        return true;
+    }
+
+protected:
+    inline explicit _C2PlanarSection(const _C2PlanarCapacityAspect *parent)
+        : _C2PlanarCapacityAspect(parent), mCrop(width(), height()) { }
+
+    inline _C2PlanarSection(const _C2PlanarCapacityAspect *parent, const C2Rect &crop)
+        : _C2PlanarSection(parent) {
+        setCrop_be(crop);
+    }
 
 private:
     C2Rect mCrop;
@@ -918,7 +965,12 @@ class C2Block2D : public _C2PlanarSection {
 public:
     const C2Handle *handle() const;
 
+protected:
+    C2Block2D(std::shared_ptr<C2GraphicAllocation> alloc);
+    C2Block2D(std::shared_ptr<C2GraphicAllocation> alloc, const C2Rect &crop);
+
 private:
+    friend struct _C2BlockFactory;
     class Impl;
     std::shared_ptr<Impl> mImpl;
 };
@@ -954,13 +1006,34 @@ public:
     const C2GraphicView subView(const C2Rect &rect) const;
     C2GraphicView subView(const C2Rect &rect);
 
+    /**
+     * Returns the address of a plane of this view. data() is the same as plane(0).
+     *
+     * \param index   the index of the plane (less than layout().mNumPlanes)
+     *
+     * \return pointer to the top-left pixel of the crop in the plane or nullptr on error.
+     */
+    const uint8_t *plane(uint32_t index) const;
+    uint8_t *plane(uint32_t index);
+
+    /**
+     * \return the layout of the planes of this view.
+     */
+    const C2PlaneLayout layout() const;
+
     /**
      * \return error during the creation/mapping of this view.
      */
     C2Error error() const;
 
 private:
+    friend class C2ConstGraphicBlock;
+    friend class C2GraphicBlock;
     class Impl;
+    C2GraphicView(
+            std::shared_ptr<Impl> impl, const _C2PlanarCapacityAspect *parent, const C2Rect &crop);
+    explicit C2GraphicView(C2Error error);
+
     std::shared_ptr<Impl> mImpl;
 };
 
@@ -997,6 +1070,10 @@ public:
     C2Fence fence() const { return mFence; }
 
 private:
+    friend class C2GraphicBlock;
+    C2ConstGraphicBlock(
+            std::shared_ptr<C2GraphicAllocation> alloc, const C2Rect &crop, C2Fence fence);
+
     C2Fence mFence;
 };
 
@@ -1024,6 +1101,10 @@ public:
      *    The block shall be modified only until firing the event for the fence.
      */
     C2ConstGraphicBlock share(const C2Rect &crop, C2Fence fence);
+
+private:
+    friend struct _C2BlockFactory;
+    C2GraphicBlock(std::shared_ptr<C2GraphicAllocation> alloc, const C2Rect &crop);
 };
 
 /// @}
@@ -1084,12 +1165,14 @@ public:
     const std::list<C2ConstGraphicBlock> graphicBlocks() const;
 
 private:
+    friend class C2Buffer;
     class Impl;
     std::shared_ptr<Impl> mImpl;
 
 protected:
     // no public constructor
-    // C2BufferData(const std::shared_ptr<const Impl> &impl) : mImpl(impl) {}
+    explicit C2BufferData(const std::list<C2ConstLinearBlock> &blocks);
+    explicit C2BufferData(const std::list<C2ConstGraphicBlock> &blocks);
 };
 
 /**
@@ -1198,10 +1281,12 @@ public:
 
 protected:
     // no public constructor
-    inline C2Buffer() = default;
+    explicit C2Buffer(const std::list<C2ConstLinearBlock> &blocks);
+    explicit C2Buffer(const std::list<C2ConstGraphicBlock> &blocks);
 
 private:
-//    Type _mType;
+    friend struct _C2BlockFactory;
+    C2BufferData mData;
 };
 
 /**
@@ -1428,6 +1513,8 @@ public:
     virtual bool equals(const std::shared_ptr<const C2GraphicAllocation> &other) = 0;
 
 protected:
+    C2GraphicAllocation(uint32_t width, uint32_t height)
+        : _C2PlanarCapacityAspect(width, height) {}
     virtual ~C2GraphicAllocation();
 };
 
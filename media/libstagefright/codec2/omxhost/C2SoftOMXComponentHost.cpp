@@ -0,0 +1,1077 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "C2SoftOMXComponentHost"
+#include <utils/Log.h>
+
+#include <atomic>
+#include <chrono>
+
+#include <system/graphics.h>
+
+#include <C2AllocatorMemfd.h>
+#include <C2BufferPriv.h>
+#include <C2SoftOMXComponentHost.h>
+
+#include "SoftOMXPlugin.h"
+
+namespace android {
+
+namespace {
+
+// the Codec2 API requires state changes to complete within 500ms
+constexpr std::chrono::milliseconds kStateChangeTimeout(500);
+
+template<class T>
+void InitOMXParams(T *params) {
+    memset(params, 0, sizeof(T));
+    params->nSize = sizeof(T);
+    params->nVersion.s.nVersionMajor = 1;
+    params->nVersion.s.nVersionMinor = 0;
+    params->nVersion.s.nRevision = 0;
+    params->nVersion.s.nStep = 0;
+}
+
+status_t toC2Error(OMX_ERRORTYPE err) {
+    switch (err) {
+        case OMX_ErrorNone:                 return C2_OK;
+        case OMX_ErrorInsufficientResources: return C2_NO_MEMORY;
+        case OMX_ErrorBadParameter:         return C2_BAD_VALUE;
+        case OMX_ErrorUnsupportedIndex:     return C2_BAD_INDEX;
+        case OMX_ErrorUnsupportedSetting:   return C2_BAD_VALUE;
+        case OMX_ErrorIncorrectStateOperation: return C2_BAD_STATE;
+        default:                            return C2_CORRUPTED;
+    }
+}
+
+/**
+ * Copies a |width| x |height| plane of 8-bit samples into a plane of a graphic view.
+ */
+void copyPlane(
+        uint8_t *dst, const C2PlaneInfo &info, const uint8_t *src, size_t srcStride,
+        uint32_t width, uint32_t height) {
+    for (uint32_t y = 0; y < height; ++y) {
+        if (info.mColInc == 1) {
+            memcpy(dst, src, width);
+        } else {
+            for (uint32_t x = 0; x < width; ++x) {
+                dst[x * info.mColInc] = src[x];
+            }
+        }
+        dst += info.mRowInc;
+        src += srcStride;
+    }
+}
+
+} // unnamed namespace
+
+/**
+ * Component interface of the host. The OMX parameters of the component are not mapped to Codec2
+ * parameters, so it only has a name and an id.
+ */
+class C2SoftOMXComponentHost::Interface : public C2ComponentInterface {
+public:
+    Interface(const std::string &name, node_id id) : mName(name), mId(id) { }
+
+    virtual C2String getName() const override {
+        return mName;
+    }
+
+    virtual node_id getId() const override {
+        return mId;
+    }
+
+    virtual status_t query_nb(
+            const std::vector<C2Param* const> &stackParams,
+            const std::vector<C2Param::Index> &heapParamIndices,
+            std::vector<std::unique_ptr<C2Param>>* const heapParams __unused) const override {
+        for (C2Param* const param : stackParams) {
+            if (param != nullptr) {
+                param->invalidate();
+            }
+        }
+        return stackParams.empty() && heapParamIndices.empty() ? C2_OK : C2_BAD_INDEX;
+    }
+
+    virtual status_t config_nb(
+            const std::vector<C2Param* const> &params,
+            std::vector<std::unique_ptr<C2SettingResult>>* const failures __unused) override {
+        return params.empty() ? C2_OK : C2_BAD_INDEX;
+    }
+
+    virtual status_t commit_sm(
+            const std::vector<C2Param* const> &params,
+            std::vector<std::unique_ptr<C2SettingResult>>* const failures) override {
+        return config_nb(params, failures);
+    }
+
+    virtual status_t createTunnel_sm(node_id targetComponent __unused) override {
+        return C2_UNSUPPORTED;
+    }
+
+    virtual status_t releaseTunnel_sm(node_id targetComponent __unused) override {
+        return C2_NOT_FOUND;
+    }
+
+    virtual std::shared_ptr<C2ParamReflector> getParamReflector() const override {
+        return nullptr;
+    }
+
+    virtual status_t getSupportedParams(
+            std::vector<std::shared_ptr<C2ParamDescriptor>> * const params __unused)
+            const override {
+        return C2_OK;
+    }
+
+    virtual status_t getSupportedValues(
+            const std::vector<const C2ParamField> fields,
+            std::vector<C2FieldSupportedValues>* const values __unused) const override {
+        return fields.empty() ? C2_OK : C2_BAD_INDEX;
+    }
+
+private:
+    const std::string mName;
+    const node_id mId;
+};
+
+// static
+const OMX_CALLBACKTYPE C2SoftOMXComponentHost::kCallbacks = {
+    &OnEvent, &OnEmptyBufferDone, &OnFillBufferDone
+};
+
+// static
+status_t C2SoftOMXComponentHost::Create(
+        const char *name, const std::shared_ptr<C2ComponentListener> &listener,
+        std::shared_ptr<C2SoftOMXComponentHost> *component) {
+    return Create(name, std::unique_ptr<OMXPluginBase>(new SoftOMXPlugin), listener, component);
+}
+
+// static
+status_t C2SoftOMXComponentHost::Create(
+        const char *name, std::unique_ptr<OMXPluginBase> plugin,
+        const std::shared_ptr<C2ComponentListener> &listener,
+        std::shared_ptr<C2SoftOMXComponentHost> *component) {
+    *component = nullptr;
+    std::shared_ptr<C2SoftOMXComponentHost> host(
+            new C2SoftOMXComponentHost(name, std::move(plugin), listener));
+    OMX_ERRORTYPE err = host->mPlugin->makeComponentInstance(
+            name, &kCallbacks, host.get(), &host->mOMXComponent);
+    if (err != OMX_ErrorNone) {
+        ALOGE("failed to instantiate %s (%d)", name, err);
+        host->mOMXComponent = nullptr;
+        return err == OMX_ErrorInvalidComponentName ? C2_NOT_FOUND : C2_CORRUPTED;
+    }
+    for (OMX_U32 portIndex : { kPortIndexInput, kPortIndexOutput }) {
+        OMX_PARAM_PORTDEFINITIONTYPE *def = &host->mPorts[portIndex].mDef;
+        InitOMXParams(def);
+        def->nPortIndex = portIndex;
+        err = OMX_GetParameter(host->mOMXComponent, OMX_IndexParamPortDefinition, def);
+        if (err != OMX_ErrorNone || def->eDir != (portIndex == kPortIndexInput ? OMX_DirInput
+                                                                             : OMX_DirOutput)) {
+            ALOGE("%s does not have the expected ports", name);
+            return C2_CORRUPTED;
+        }
+    }
+    host->mSelf = host;
+    *component = host;
+    return C2_OK;
+}
+
+C2SoftOMXComponentHost::C2SoftOMXComponentHost(
+        const char *name, std::unique_ptr<OMXPluginBase> plugin,
+        const std::shared_ptr<C2ComponentListener> &listener)
+    : mName(name),
+      mId([] {
+          static std::atomic<node_id> sNextId(1);
+          return sNextId++;
+      }()),
+      mListener(listener),
+      mIntf(std::make_shared<Interface>(mName, mId)),
+      mPlugin(std::move(plugin)),
+      mOMXComponent(nullptr),
+      mDefaultAllocator(std::make_shared<C2PooledBlockAllocator>(
+              std::make_shared<C2AllocatorMemfd>())),
+      mFlushRequests(0),
+      mRunning(false),
+      mExiting(false),
+      mHostThreadDestroyed(nullptr),
+      mCompletions(0),
+      mLastOutputTimestamp(0),
+      mReconfiguring(false),
+      mDraining(false),
+      mFlushesPending(0),
+      mFlushing(false) {
+    InitOMXParams(&mCrop);
+}
+
+C2SoftOMXComponentHost::~C2SoftOMXComponentHost() {
+    release();
+
+    std::unique_lock<std::mutex> lock(mLock);
+    if (mHostThreadDestroyed != nullptr && std::this_thread::get_id() == mHostThreadId) {
+        // the listener released the host from a callback: the host thread returns right away
+        *mHostThreadDestroyed = true;
+        return;
+    }
+    // a host thread detached by stop() may still be returning from a callback
+    while (mHostThreadDestroyed != nullptr) {
+        mCondition.wait(lock);
+    }
+}
+
+status_t C2SoftOMXComponentHost::getOMXParameter(OMX_INDEXTYPE index, void *params) {
+    if (mOMXComponent == nullptr) {
+        return C2_BAD_STATE;
+    }
+    return toC2Error(OMX_GetParameter(mOMXComponent, index, params));
+}
+
+status_t C2SoftOMXComponentHost::setOMXParameter(OMX_INDEXTYPE index, const void *params) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mOMXComponent == nullptr || mRunning) {
+        return C2_BAD_STATE;
+    }
+    status_t err = toC2Error(OMX_SetParameter(mOMXComponent, index, const_cast<void *>(params)));
+    if (err == C2_OK) {
+        // the parameter may have changed the buffer requirements of the ports
+        for (OMX_U32 portIndex : { kPortIndexInput, kPortIndexOutput }) {
+            (void)OMX_GetParameter(
+                    mOMXComponent, OMX_IndexParamPortDefinition, &mPorts[portIndex].mDef);
+        }
+    }
+    return err;
+}
+
+/* ======================================= OMX CALLBACKS ====================================== */
+
+// static
+OMX_ERRORTYPE C2SoftOMXComponentHost::OnEvent(
+        OMX_HANDLETYPE component __unused, OMX_PTR appData, OMX_EVENTTYPE event,
+        OMX_U32 data1, OMX_U32 data2, OMX_PTR eventData __unused) {
+    C2SoftOMXComponentHost *host = static_cast<C2SoftOMXComponentHost *>(appData);
+    switch (event) {
+        case OMX_EventCmdComplete:
+            host->postEvent({ Event::COMMAND_COMPLETE, nullptr, data1, data2 });
+            break;
+        case OMX_EventPortSettingsChanged:
+            host->postEvent({ Event::PORT_SETTINGS_CHANGED, nullptr, data1, data2 });
+            break;
+        case OMX_EventError:
+            host->postEvent({ Event::ERROR, nullptr, data1, data2 });
+            break;
+        default:
+            ALOGV("ignoring event %d (%u, %u)", event, data1, data2);
+            break;
+    }
+    return OMX_ErrorNone;
+}
+
+// static
+OMX_ERRORTYPE C2SoftOMXComponentHost::OnEmptyBufferDone(
+        OMX_HANDLETYPE component __unused, OMX_PTR appData, OMX_BUFFERHEADERTYPE *header) {
+    static_cast<C2SoftOMXComponentHost *>(appData)->postEvent(
+            { Event::EMPTY_BUFFER_DONE, header, 0, 0 });
+    return OMX_ErrorNone;
+}
+
+// static
+OMX_ERRORTYPE C2SoftOMXComponentHost::OnFillBufferDone(
+        OMX_HANDLETYPE component __unused, OMX_PTR appData, OMX_BUFFERHEADERTYPE *header) {
+    static_cast<C2SoftOMXComponentHost *>(appData)->postEvent(
+            { Event::FILL_BUFFER_DONE, header, 0, 0 });
+    return OMX_ErrorNone;
+}
+
+void C2SoftOMXComponentHost::postEvent(const Event &event) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mEvents.push_back(event);
+    mCondition.notify_all();
+}
+
+/* ===================================== STATE TRANSITIONS ==================================== */
+
+status_t C2SoftOMXComponentHost::allocateBuffers(OMX_U32 portIndex) {
+    Port *port = &mPorts[portIndex];
+    for (OMX_U32 i = 0; i < port->mDef.nBufferCountActual; ++i) {
+        OMX_BUFFERHEADERTYPE *header;
+        OMX_ERRORTYPE err = OMX_AllocateBuffer(
+                mOMXComponent, &header, portIndex, nullptr, port->mDef.nBufferSize);
+        if (err != OMX_ErrorNone) {
+            ALOGE("failed to allocate buffer on port %u (%d)", portIndex, err);
+            return toC2Error(err);
+        }
+        port->mBuffers.push_back(header);
+        port->mOwned.push_back(header);
+    }
+    return C2_OK;
+}
+
+void C2SoftOMXComponentHost::freeBuffers(OMX_U32 portIndex) {
+    Port *port = &mPorts[portIndex];
+    for (OMX_BUFFERHEADERTYPE *header : port->mBuffers) {
+        (void)OMX_FreeBuffer(mOMXComponent, portIndex, header);
+    }
+    port->mBuffers.clear();
+    port->mOwned.clear();
+}
+
+status_t C2SoftOMXComponentHost::waitForCommand(OMX_COMMANDTYPE cmd, OMX_U32 param) {
+    std::unique_lock<std::mutex> lock(mLock);
+    std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + kStateChangeTimeout;
+    for (;;) {
+        while (!mEvents.empty()) {
+            Event event = mEvents.front();
+            mEvents.pop_front();
+            switch (event.mType) {
+                case Event::COMMAND_COMPLETE:
+                    if (event.mData1 == (OMX_U32)cmd && event.mData2 == param) {
+                        return C2_OK;
+                    }
+                    break;
+                case Event::ERROR:
+                    ALOGE("error %#x while waiting for command %d(%u)", event.mData1, cmd, param);
+                    return C2_CORRUPTED;
+                case Event::EMPTY_BUFFER_DONE:
+                    mPorts[kPortIndexInput].mOwned.push_back(event.mHeader);
+                    break;
+                case Event::FILL_BUFFER_DONE:
+                    mPorts[kPortIndexOutput].mOwned.push_back(event.mHeader);
+                    break;
+                default:
+                    break;
+            }
+        }
+        if (mCondition.wait_until(lock, deadline) == std::cv_status::timeout
+                && mEvents.empty()) {
+            ALOGE("timed out waiting for command %d(%u)", cmd, param);
+            return C2_TIMED_OUT;
+        }
+    }
+}
+
+status_t C2SoftOMXComponentHost::setState(OMX_STATETYPE state) {
+    OMX_ERRORTYPE err = OMX_SendCommand(mOMXComponent, OMX_CommandStateSet, state, nullptr);
+    if (err != OMX_ErrorNone) {
+        return toC2Error(err);
+    }
+    // the transitions from and to the loaded state complete once all buffers are (de)allocated
+    status_t res = C2_OK;
+    if (state == OMX_StateIdle && mPorts[kPortIndexInput].mBuffers.empty()) {
+        res = allocateBuffers(kPortIndexInput);
+        if (res == C2_OK) {
+            res = allocateBuffers(kPortIndexOutput);
+        }
+    } else if (state == OMX_StateLoaded) {
+        freeBuffers(kPortIndexInput);
+        freeBuffers(kPortIndexOutput);
+    }
+    if (res != C2_OK) {
+        return res;
+    }
+    return waitForCommand(OMX_CommandStateSet, state);
+}
+
+status_t C2SoftOMXComponentHost::start() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mOMXComponent == nullptr || mRunning || mHostThreadDestroyed != nullptr) {
+            // the host thread of the previous run may not have returned from a callback yet
+            return C2_BAD_STATE;
+        }
+    }
+    status_t err = setState(OMX_StateIdle);
+    if (err == C2_OK) {
+        err = setState(OMX_StateExecuting);
+    }
+    if (err != C2_OK) {
+        ALOGE("failed to start %s (%d)", mName.c_str(), err);
+        (void)setState(OMX_StateLoaded);
+        return err;
+    }
+
+    const OMX_PARAM_PORTDEFINITIONTYPE &def = mPorts[kPortIndexOutput].mDef;
+    InitOMXParams(&mCrop);
+    mCrop.nPortIndex = kPortIndexOutput;
+    if (def.eDomain == OMX_PortDomainVideo) {
+        mCrop.nWidth = def.format.video.nFrameWidth;
+        mCrop.nHeight = def.format.video.nFrameHeight;
+    }
+    mReconfiguring = false;
+    mDraining = false;
+    mFlushing = false;
+    mFlushesPending = 0;
+
+    std::lock_guard<std::mutex> lock(mLock);
+    mFlushRequests = 0;
+    mExiting = false;
+    mRunning = true;
+    mThread = std::thread(&C2SoftOMXComponentHost::threadLoop, this);
+    return C2_OK;
+}
+
+status_t C2SoftOMXComponentHost::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (!mRunning) {
+            return C2_BAD_STATE;
+        }
+        mExiting = true;
+        mCondition.notify_all();
+        if (std::this_thread::get_id() == mThread.get_id()) {
+            // called by the listener on the host thread, which exits once the callback returns
+            mThread.detach();
+        }
+    }
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    // the component returns all buffers when moving to the idle state
+    status_t err = setState(OMX_StateIdle);
+    if (err == C2_OK) {
+        err = setState(OMX_StateLoaded);
+    }
+    if (err != C2_OK) {
+        ALOGE("failed to stop %s (%d)", mName.c_str(), err);
+    }
+
+    // pending work is abandoned
+    mPending.clear();
+    mInputWork.clear();
+    mDone.clear();
+    mErrors.clear();
+    std::lock_guard<std::mutex> lock(mLock);
+    mQueue.clear();
+    mEvents.clear();
+    mRunning = false;
+    return err;
+}
+
+void C2SoftOMXComponentHost::reset() {
+    bool running;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        running = mRunning;
+    }
+    if (running) {
+        (void)stop();
+    }
+}
+
+void C2SoftOMXComponentHost::release() {
+    reset();
+    if (mOMXComponent != nullptr) {
+        (void)mPlugin->destroyComponentInstance(mOMXComponent);
+        mOMXComponent = nullptr;
+    }
+}
+
+std::shared_ptr<C2ComponentInterface> C2SoftOMXComponentHost::intf() {
+    return mIntf;
+}
+
+/* ======================================== CLIENT CALLS ====================================== */
+
+status_t C2SoftOMXComponentHost::queue_nb(std::list<std::unique_ptr<C2Work>>* const items) {
+    for (const std::unique_ptr<C2Work> &work : *items) {
+        if (work == nullptr || work->worklets.empty() || work->worklets.front() == nullptr) {
+            return C2_BAD_VALUE;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mRunning) {
+        return C2_BAD_STATE;
+    }
+    mQueue.splice(mQueue.end(), *items);
+    mCondition.notify_all();
+    return C2_OK;
+}
+
+status_t C2SoftOMXComponentHost::announce_nb(const std::vector<C2WorkOutline> &items __unused) {
+    return C2_UNSUPPORTED;
+}
+
+status_t C2SoftOMXComponentHost::flush_sm(
+        bool flushThrough __unused, std::list<std::unique_ptr<C2Work>>* const flushedWork) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mRunning) {
+        return C2_BAD_STATE;
+    }
+    // work that has not been fed to the component is returned immediately, and work in flight
+    // once the component has returned its buffers
+    for (std::unique_ptr<C2Work> &work : mQueue) {
+        if (work != nullptr) {
+            work->worklets_processed = 0;
+            work->result = C2_NOT_FOUND;
+            flushedWork->push_back(std::move(work));
+        }
+    }
+    mQueue.clear();
+    ++mFlushRequests;
+    mCondition.notify_all();
+    return C2_OK;
+}
+
+status_t C2SoftOMXComponentHost::drain_nb(bool drainThrough __unused) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mRunning) {
+        return C2_BAD_STATE;
+    }
+    if (!mQueue.empty() && mQueue.back() != nullptr) {
+        std::unique_ptr<C2Work> &last = mQueue.back();
+        last->input.flags = (flags_t)(last->input.flags | BUFFERFLAG_END_OF_STREAM);
+    } else {
+        // everything queued has been fed to the component already: queue an empty buffer
+        mQueue.push_back(nullptr);
+    }
+    mCondition.notify_all();
+    return C2_OK;
+}
+
+/* ======================================== HOST THREAD ======================================= */
+
+void C2SoftOMXComponentHost::threadLoop() {
+    // set by the destructor if the listener destroys the host from a callback on this thread
+    bool destroyed = false;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mHostThreadId = std::this_thread::get_id();
+        mHostThreadDestroyed = &destroyed;
+    }
+    fillOwnedOutputBuffers();
+
+    std::unique_lock<std::mutex> lock(mLock);
+    for (;;) {
+        const bool canFlush = mFlushRequests > 0 && !mFlushing && !mReconfiguring;
+        const bool canDispatch = !mQueue.empty() && !mPorts[kPortIndexInput].mOwned.empty()
+                && !mDraining && !mFlushing;
+        if (mExiting) {
+            break;
+        } else if (mEvents.empty() && !canFlush && !canDispatch) {
+            mCondition.wait(lock);
+            continue;
+        }
+
+        std::list<Event> events;
+        events.swap(mEvents);
+        if (canFlush) {
+            --mFlushRequests;
+        }
+        lock.unlock();
+        for (const Event &event : events) {
+            handleEvent(event);
+        }
+        if (canFlush) {
+            startFlush();
+        }
+        lock.lock();
+
+        // feed as much work as there are free input buffers; input is not fed past the end of
+        // the stream until the component has been reset
+        std::list<std::unique_ptr<C2Work>> works;
+        size_t available = mPorts[kPortIndexInput].mOwned.size();
+        while (!mQueue.empty() && available > 0 && !mDraining && !mFlushing) {
+            std::unique_ptr<C2Work> &work = mQueue.front();
+            mDraining = work == nullptr || (work->input.flags & BUFFERFLAG_END_OF_STREAM);
+            works.push_back(std::move(work));
+            mQueue.pop_front();
+            --available;
+        }
+        lock.unlock();
+        for (std::unique_ptr<C2Work> &work : works) {
+            dispatchInput(std::move(work));
+        }
+        if (!notifyListener(destroyed)) {
+            return;
+        }
+        lock.lock();
+    }
+    mHostThreadDestroyed = nullptr;
+    mCondition.notify_all();
+}
+
+void C2SoftOMXComponentHost::handleEvent(const Event &event) {
+    switch (event.mType) {
+        case Event::EMPTY_BUFFER_DONE:
+        {
+            mPorts[kPortIndexInput].mOwned.push_back(event.mHeader);
+            auto it = mInputWork.find(event.mHeader);
+            if (it != mInputWork.end()) {
+                it->second->mConsumed = true;
+                mInputWork.erase(it);
+                completeReady();
+            }
+            break;
+        }
+
+        case Event::FILL_BUFFER_DONE:
+            handleOutput(event.mHeader);
+            break;
+
+        case Event::COMMAND_COMPLETE:
+            if (event.mData1 == OMX_CommandFlush) {
+                if (mFlushesPending > 0 && --mFlushesPending == 0) {
+                    mFlushing = false;
+                    mDraining = false;
+                    completeAll(C2_NOT_FOUND, false /* eos */);
+                    fillOwnedOutputBuffers();
+                }
+            } else if (event.mData1 == OMX_CommandPortDisable
+                    && event.mData2 == kPortIndexOutput) {
+                Port *port = &mPorts[kPortIndexOutput];
+                (void)OMX_GetParameter(mOMXComponent, OMX_IndexParamPortDefinition, &port->mDef);
+                if (port->mDef.eDomain == OMX_PortDomainVideo) {
+                    mCrop.nLeft = mCrop.nTop = 0;
+                    mCrop.nWidth = port->mDef.format.video.nFrameWidth;
+                    mCrop.nHeight = port->mDef.format.video.nFrameHeight;
+                    (void)OMX_GetConfig(mOMXComponent, OMX_IndexConfigCommonOutputCrop, &mCrop);
+                }
+                (void)OMX_SendCommand(
+                        mOMXComponent, OMX_CommandPortEnable, kPortIndexOutput, nullptr);
+                if (allocateBuffers(kPortIndexOutput) != C2_OK) {
+                    mErrors.push_back(C2_NO_MEMORY);
+                }
+            } else if (event.mData1 == OMX_CommandPortEnable
+                    && event.mData2 == kPortIndexOutput) {
+                mReconfiguring = false;
+                fillOwnedOutputBuffers();
+            }
+            break;
+
+        case Event::PORT_SETTINGS_CHANGED:
+            if (event.mData1 != kPortIndexOutput) {
+                break;
+            }
+            if (event.mData2 == OMX_IndexConfigCommonOutputCrop) {
+                (void)OMX_GetConfig(mOMXComponent, OMX_IndexConfigCommonOutputCrop, &mCrop);
+            } else if (event.mData2 == 0 || event.mData2 == OMX_IndexParamPortDefinition) {
+                startReconfiguration();
+            }
+            break;
+
+        case Event::ERROR:
+            ALOGE("%s signaled error %#x", mName.c_str(), event.mData1);
+            mErrors.push_back(toC2Error((OMX_ERRORTYPE)event.mData1));
+            break;
+    }
+}
+
+void C2SoftOMXComponentHost::dispatchInput(std::unique_ptr<C2Work> work) {
+    Port *port = &mPorts[kPortIndexInput];
+    OMX_BUFFERHEADERTYPE *header = port->mOwned.front();
+    header->nOffset = 0;
+    header->nFilledLen = 0;
+    header->nFlags = OMX_BUFFERFLAG_ENDOFFRAME;
+    header->nTimeStamp = mLastOutputTimestamp;
+
+    std::unique_ptr<PendingWork> pending(new PendingWork);
+    pending->mTimestamp = 0;
+    pending->mConsumed = false;
+    pending->mCompletionsAtDispatch = mCompletions;
+    const bool eos = work == nullptr || (work->input.flags & BUFFERFLAG_END_OF_STREAM);
+    if (eos) {
+        header->nFlags |= OMX_BUFFERFLAG_EOS;
+    }
+
+    if (work != nullptr) {
+        // copy the input; the blocks of the client are released right away
+        status_t err = C2_OK;
+        for (std::shared_ptr<C2Buffer> &buffer : work->input.buffers) {
+            if (buffer == nullptr) {
+                continue;
+            }
+            for (const C2ConstLinearBlock &block : buffer->data().linearBlocks()) {
+                C2ReadView view = block.map().get();
+                if (view.error() != C2_OK) {
+                    err = view.error();
+                } else if (view.capacity() > header->nAllocLen - header->nFilledLen) {
+                    ALOGE("input of %u bytes does not fit in %u bytes",
+                          view.capacity(), header->nAllocLen);
+                    err = C2_BAD_VALUE;
+                }
+                if (err != C2_OK) {
+                    break;
+                }
+                memcpy(header->pBuffer + header->nFilledLen, view.data(), view.capacity());
+                header->nFilledLen += view.capacity();
+            }
+            buffer.reset();
+        }
+        if (work->input.flags & BUFFERFLAG_CODEC_CONFIG) {
+            header->nFlags |= OMX_BUFFERFLAG_CODECCONFIG;
+        }
+        header->nTimeStamp = (OMX_TICKS)work->input.ordinal.timestamp;
+        pending->mTimestamp = header->nTimeStamp;
+        if (err == C2_OK) {
+            pending->mWork = std::move(work);
+        } else {
+            work->result = err;
+            work->worklets_processed = 0;
+            mDone.push_back(std::move(work));
+            if (!eos) {
+                return;
+            }
+            // still signal the end of stream to the component
+            header->nFilledLen = 0;
+            header->nFlags &= ~OMX_BUFFERFLAG_CODECCONFIG;
+        }
+    }
+
+    OMX_ERRORTYPE err = OMX_EmptyThisBuffer(mOMXComponent, header);
+    if (err != OMX_ErrorNone) {
+        ALOGE("failed to queue input (%d)", err);
+        if (pending->mWork != nullptr) {
+            pending->mWork->result = toC2Error(err);
+            pending->mWork->worklets_processed = 0;
+            mDone.push_back(std::move(pending->mWork));
+        }
+        if (eos) {
+            mDraining = false;
+        }
+        return;
+    }
+    port->mOwned.pop_front();
+    mInputWork[header] = pending.get();
+    mPending.push_back(std::move(pending));
+}
+
+void C2SoftOMXComponentHost::handleOutput(OMX_BUFFERHEADERTYPE *header) {
+    Port *port = &mPorts[kPortIndexOutput];
+    const bool eos = header->nFlags & OMX_BUFFERFLAG_EOS;
+    if (mFlushing) {
+        // flushed output is dropped
+        port->mOwned.push_back(header);
+        return;
+    }
+
+    if (header->nFilledLen > 0) {
+        const int64_t timestamp = header->nTimeStamp;
+
+        // the work with the same timestamp (preferring one without output yet), or the latest
+        // one before it, or the oldest work if the output precedes all of them
+        PendingWork *target = nullptr;
+        PendingWork *exact = nullptr;
+        PendingWork *before = nullptr;
+        PendingWork *oldest = nullptr;
+        for (const std::unique_ptr<PendingWork> &pending : mPending) {
+            if (pending->mWork == nullptr
+                    || (pending->mWork->input.flags & BUFFERFLAG_CODEC_CONFIG)) {
+                continue;
+            }
+            if (oldest == nullptr) {
+                oldest = pending.get();
+            }
+            if (pending->mTimestamp == timestamp) {
+                if (exact == nullptr || (!exact->mLinearOutput.empty()
+                        || !exact->mGraphicOutput.empty())) {
+                    exact = pending.get();
+                }
+            } else if (pending->mTimestamp < timestamp
+                    && (before == nullptr || pending->mTimestamp >= before->mTimestamp)) {
+                before = pending.get();
+            }
+        }
+        target = exact != nullptr ? exact : before != nullptr ? before : oldest;
+
+        std::unique_ptr<PendingWork> orphan;
+        if (target == nullptr) {
+            // all works have been completed; return the output in a work of its own
+            ALOGV("output at %lld has no work", (long long)timestamp);
+            orphan.reset(new PendingWork);
+            orphan->mWork.reset(new C2Work);
+            orphan->mWork->input.flags = (flags_t)0;
+            orphan->mWork->input.ordinal.timestamp = timestamp;
+            orphan->mWork->input.ordinal.frame_index = 0;
+            orphan->mWork->input.ordinal.custom_ordinal = 0;
+            orphan->mWork->worklets.emplace_back(new C2Worklet);
+            orphan->mWork->worklets.front()->component = mId;
+            orphan->mTimestamp = timestamp;
+            orphan->mConsumed = true;
+            orphan->mCompletionsAtDispatch = mCompletions;
+            target = orphan.get();
+        }
+
+        const std::vector<std::shared_ptr<C2BlockAllocator>> &allocators =
+                target->mWork->worklets.front()->allocators;
+        status_t err = copyOutput(
+                header, allocators.empty() || allocators.front() == nullptr
+                        ? mDefaultAllocator : allocators.front(),
+                target);
+        if (err != C2_OK) {
+            ALOGE("failed to copy output (%d)", err);
+            mErrors.push_back(err);
+        }
+        mLastOutputTimestamp = timestamp;
+        if (orphan != nullptr) {
+            mPending.push_back(std::move(orphan));
+        }
+    }
+
+    if (eos) {
+        completeAll(C2_OK, true /* eos */);
+    }
+    if (mReconfiguring) {
+        // buffers returned while the output port is being disabled are freed
+        (void)OMX_FreeBuffer(mOMXComponent, kPortIndexOutput, header);
+        for (auto it = port->mBuffers.begin(); it != port->mBuffers.end(); ++it) {
+            if (*it == header) {
+                port->mBuffers.erase(it);
+                break;
+            }
+        }
+        if (eos) {
+            // the component is reset once the port is enabled again
+            std::lock_guard<std::mutex> lock(mLock);
+            ++mFlushRequests;
+        }
+    } else if (eos) {
+        // reset the component with a flush so that it accepts input after the end of stream
+        port->mOwned.push_back(header);
+        startFlush();
+        return;
+    } else {
+        header->nOffset = 0;
+        header->nFilledLen = 0;
+        header->nFlags = 0;
+        if (OMX_FillThisBuffer(mOMXComponent, header) != OMX_ErrorNone) {
+            port->mOwned.push_back(header);
+        }
+    }
+    completeReady();
+}
+
+status_t C2SoftOMXComponentHost::copyOutput(
+        const OMX_BUFFERHEADERTYPE *header, const std::shared_ptr<C2BlockAllocator> &allocator,
+        PendingWork *target) {
+    const C2MemoryUsage usage = { C2MemoryUsage::kSoftwareRead, C2MemoryUsage::kSoftwareWrite };
+    const OMX_PARAM_PORTDEFINITIONTYPE &def = mPorts[kPortIndexOutput].mDef;
+    const uint8_t *data = header->pBuffer + header->nOffset;
+
+    if (def.eDomain != OMX_PortDomainVideo) {
+        std::shared_ptr<C2LinearBlock> block;
+        C2Error err = allocator->allocateLinearBlock(header->nFilledLen, usage, &block);
+        if (err != C2_OK) {
+            return err;
+        }
+        C2WriteView view = block->map().get();
+        if (view.error() != C2_OK) {
+            return view.error();
+        }
+        memcpy(view.data(), data, header->nFilledLen);
+        target->mLinearOutput.push_back(block->share(0, header->nFilledLen, C2Fence()));
+        return C2_OK;
+    }
+
+    // the soft video decoders output planar YUV 4:2:0
+    const OMX_VIDEO_PORTDEFINITIONTYPE &video = def.format.video;
+    const uint32_t width = video.nFrameWidth;
+    const uint32_t height = video.nFrameHeight;
+    const size_t stride = video.nStride;
+    const size_t sliceHeight = video.nSliceHeight;
+    if (stride < width || sliceHeight < height
+            || header->nFilledLen < stride * sliceHeight * 3 / 2) {
+        ALOGE("unexpected output frame (%ux%u, stride %zu, slice height %zu, %u bytes)",
+              width, height, stride, sliceHeight, header->nFilledLen);
+        return C2_CORRUPTED;
+    }
+    std::shared_ptr<C2GraphicBlock> block;
+    C2Error err = allocator->allocateGraphicBlock(
+            width, height, HAL_PIXEL_FORMAT_YV12, usage, &block);
+    if (err != C2_OK) {
+        return err;
+    }
+    C2GraphicView view = block->map().get();
+    if (view.error() != C2_OK) {
+        return view.error();
+    }
+    const C2PlaneLayout layout = view.layout();
+    const uint8_t *u = data + stride * sliceHeight;
+    const uint8_t *v = u + (stride / 2) * (sliceHeight / 2);
+    copyPlane(view.plane(C2PlaneLayout::Y), layout.mPlanes[C2PlaneLayout::Y],
+              data, stride, width, height);
+    copyPlane(view.plane(C2PlaneLayout::U), layout.mPlanes[C2PlaneLayout::U],
+              u, stride / 2, (width + 1) / 2, (height + 1) / 2);
+    copyPlane(view.plane(C2PlaneLayout::V), layout.mPlanes[C2PlaneLayout::V],
+              v, stride / 2, (width + 1) / 2, (height + 1) / 2);
+    target->mGraphicOutput.push_back(block->share(
+            C2Rect(mCrop.nWidth, mCrop.nHeight, mCrop.nLeft, mCrop.nTop), C2Fence()));
+    return C2_OK;
+}
+
+void C2SoftOMXComponentHost::startReconfiguration() {
+    if (mReconfiguring) {
+        return;
+    }
+    ALOGV("reconfiguring output port");
+    mReconfiguring = true;
+    (void)OMX_SendCommand(mOMXComponent, OMX_CommandPortDisable, kPortIndexOutput, nullptr);
+    // the port is disabled once all buffers are freed; the rest are freed as they are returned
+    Port *port = &mPorts[kPortIndexOutput];
+    for (OMX_BUFFERHEADERTYPE *header : port->mOwned) {
+        (void)OMX_FreeBuffer(mOMXComponent, kPortIndexOutput, header);
+        for (auto it = port->mBuffers.begin(); it != port->mBuffers.end(); ++it) {
+            if (*it == header) {
+                port->mBuffers.erase(it);
+                break;
+            }
+        }
+    }
+    port->mOwned.clear();
+}
+
+void C2SoftOMXComponentHost::startFlush() {
+    if (mFlushing) {
+        return;
+    }
+    mFlushing = true;
+    mFlushesPending = 2;    // one completion per port
+    if (OMX_SendCommand(mOMXComponent, OMX_CommandFlush, OMX_ALL, nullptr) != OMX_ErrorNone) {
+        mFlushing = false;
+        mFlushesPending = 0;
+        mDraining = false;
+        completeAll(C2_NOT_FOUND, false /* eos */);
+        mErrors.push_back(C2_CORRUPTED);
+    }
+}
+
+void C2SoftOMXComponentHost::fillOwnedOutputBuffers() {
+    Port *port = &mPorts[kPortIndexOutput];
+    while (!port->mOwned.empty()) {
+        OMX_BUFFERHEADERTYPE *header = port->mOwned.front();
+        header->nOffset = 0;
+        header->nFilledLen = 0;
+        header->nFlags = 0;
+        if (OMX_FillThisBuffer(mOMXComponent, header) != OMX_ErrorNone) {
+            break;
+        }
+        port->mOwned.pop_front();
+    }
+}
+
+std::list<std::unique_ptr<C2SoftOMXComponentHost::PendingWork>>::iterator
+C2SoftOMXComponentHost::complete(
+        std::list<std::unique_ptr<PendingWork>>::iterator it, status_t result, bool eos) {
+    PendingWork *pending = it->get();
+    std::unique_ptr<C2Work> &work = pending->mWork;
+    if (work != nullptr) {
+        C2Worklet *worklet = work->worklets.front().get();
+        worklet->output.flags = eos ? BUFFERFLAG_END_OF_STREAM : (flags_t)0;
+        worklet->output.ordinal = work->input.ordinal;
+        worklet->output.buffers.clear();
+        if (result == C2_OK) {
+            if (!pending->mLinearOutput.empty()) {
+                worklet->output.buffers.push_back(
+                        _C2BlockFactory::CreateLinearBuffer(pending->mLinearOutput));
+            }
+            for (const C2ConstGraphicBlock &block : pending->mGraphicOutput) {
+                worklet->output.buffers.push_back(_C2BlockFactory::CreateGraphicBuffer({ block }));
+            }
+        }
+        work->worklets_processed = result == C2_OK ? 1 : 0;
+        work->result = result;
+        mDone.push_back(std::move(work));
+        ++mCompletions;
+    }
+    for (auto entry = mInputWork.begin(); entry != mInputWork.end(); ++entry) {
+        if (entry->second == pending) {
+            mInputWork.erase(entry);
+            break;
+        }
+    }
+    return mPending.erase(it);
+}
+
+void C2SoftOMXComponentHost::completeReady() {
+    // walk backwards to know whether any later work has output already
+    bool laterHasOutput = false;
+    for (auto it = mPending.end(); it != mPending.begin(); ) {
+        --it;
+        const PendingWork *pending = it->get();
+        const bool hasOutput =
+                !pending->mLinearOutput.empty() || !pending->mGraphicOutput.empty();
+        bool ready = false;
+        if (pending->mConsumed && pending->mWork != nullptr) {
+            if (pending->mWork->input.flags & BUFFERFLAG_CODEC_CONFIG) {
+                ready = true;
+            } else if (hasOutput) {
+                // a video frame is complete; audio may continue into another output buffer
+                ready = laterHasOutput || !pending->mGraphicOutput.empty();
+            } else {
+                ready = (laterHasOutput && pending->mTimestamp < mLastOutputTimestamp)
+                        || mCompletions - pending->mCompletionsAtDispatch > kMaxReorderDepth;
+            }
+        }
+        laterHasOutput = laterHasOutput || hasOutput;
+        if (ready) {
+            it = complete(it, C2_OK, false /* eos */);
+        }
+    }
+}
+
+void C2SoftOMXComponentHost::completeAll(status_t result, bool eos) {
+    // the end of stream is signaled on the last work
+    auto last = mPending.end();
+    for (auto it = mPending.begin(); it != mPending.end(); ++it) {
+        if ((*it)->mWork != nullptr) {
+            last = it;
+        }
+    }
+    if (eos && last == mPending.end()) {
+        // all works have been returned: signal the end of stream in an empty work
+        std::unique_ptr<PendingWork> pending(new PendingWork);
+        pending->mWork.reset(new C2Work);
+        pending->mWork->input.flags = BUFFERFLAG_END_OF_STREAM;
+        pending->mWork->input.ordinal.timestamp = mLastOutputTimestamp;
+        pending->mWork->input.ordinal.frame_index = 0;
+        pending->mWork->input.ordinal.custom_ordinal = 0;
+        pending->mWork->worklets.emplace_back(new C2Worklet);
+        pending->mWork->worklets.front()->component = mId;
+        pending->mTimestamp = mLastOutputTimestamp;
+        pending->mConsumed = true;
+        pending->mCompletionsAtDispatch = mCompletions;
+        mPending.push_back(std::move(pending));
+        last = --mPending.end();
+    }
+    for (auto it = mPending.begin(); it != mPending.end(); ) {
+        const bool isLast = it == last;
+        it = complete(it, result, eos && isLast);
+    }
+    mInputWork.clear();
+}
+
+bool C2SoftOMXComponentHost::notifyListener(const bool &destroyed) {
+    std::vector<status_t> errors;
+    errors.swap(mErrors);
+    std::vector<std::unique_ptr<C2Work>> done;
+    done.swap(mDone);
+    // the host may be destroyed by any of the callbacks; nothing of it is used after them
+    const std::shared_ptr<C2ComponentListener> listener = mListener;
+    const std::weak_ptr<C2Component> self = mSelf;
+    for (status_t err : errors) {
+        listener->onError(self, err);
+        if (destroyed) {
+            return false;
+        }
+    }
+    if (!done.empty()) {
+        listener->onWorkDone(self, std::move(done));
+    }
+    return !destroyed;
+}
+
+} // namespace android
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STAGEFRIGHT_CODEC2_SOFT_OMX_COMPONENT_HOST_H_
+#define STAGEFRIGHT_CODEC2_SOFT_OMX_COMPONENT_HOST_H_
+
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <C2Component.h>
+#include <C2Work.h>
+
+#include <OMX_Component.h>
+
+namespace android {
+
+struct OMXPluginBase;
+
+/**
+ * Runs a software OMX component (any component of SoftOMXPlugin, e.g. OMX.google.aac.decoder,
+ * OMX.google.h264.decoder or OMX.google.vp8.decoder) as a Codec2 component.
+ *
+ * The host drives the OMX component through the OMX IL calls from a thread of its own. Work
+ * queued by the client is fed into the free input buffers of the component as soon as they are
+ * returned, so that there is a work in flight for every input buffer of the component, and
+ * queueing a list of works costs a single wake-up of the host thread. Completed works are
+ * returned to the listener in batches: every wake-up of the host thread returns all works
+ * completed by the events it handled in a single onWorkDone() call.
+ *
+ * Input buffers are copied into the buffers of the component. Output is copied into blocks of
+ * the first allocator of the worklet, or of a pooled shared memory allocator if the worklet has
+ * none: audio (and other non-video) output is returned as a linear buffer containing a block
+ * for each output buffer of the component, and video output as a YV12 graphic buffer per frame.
+ *
+ * OMX does not carry the work ordinal through the component, so output is matched to works by
+ * timestamp: a frame is attached to the work with the same timestamp, or to the latest work
+ * with an earlier timestamp (for decoders that interpolate timestamps of frames within an input
+ * buffer.) A work is completed when its input has been consumed and output with a later
+ * timestamp (or from a later work) has been produced, so that works can be completed out of
+ * order when the component reorders frames. Codec config works are completed as soon as they
+ * are consumed; works that never get output are completed at the end of stream, at a flush, or
+ * after kMaxReorderDepth later works have been completed.
+ *
+ * Flushed works are returned with a result of C2_NOT_FOUND. Errors signaled by the OMX component
+ * are mapped to Codec2 errors before they are reported to the listener.
+ *
+ * The listener is called on the host thread, and may release the last reference to the host
+ * from a callback; the host is then destroyed on its own thread.
+ *
+ * The component interface does not support any Codec2 parameters; the OMX component can be
+ * configured through getOMXParameter() and setOMXParameter() while it is stopped.
+ */
+class C2SoftOMXComponentHost : public C2Component {
+public:
+    enum : uint32_t {
+        kMaxReorderDepth = 16,
+    };
+
+    /**
+     * Creates a host for the software OMX component |name|.
+     *
+     * \retval C2_OK        the component was created
+     * \retval C2_NOT_FOUND there is no software component with this name
+     * \retval C2_CORRUPTED the component could not be instantiated
+     */
+    static status_t Create(
+            const char *name, const std::shared_ptr<C2ComponentListener> &listener,
+            std::shared_ptr<C2SoftOMXComponentHost> *component /* nonnull */);
+
+    /**
+     * Creates a host for the component |name| of |plugin| instead of SoftOMXPlugin, e.g. for
+     * testing. The host takes ownership of the plugin.
+     */
+    static status_t Create(
+            const char *name, std::unique_ptr<OMXPluginBase> plugin,
+            const std::shared_ptr<C2ComponentListener> &listener,
+            std::shared_ptr<C2SoftOMXComponentHost> *component /* nonnull */);
+
+    virtual ~C2SoftOMXComponentHost();
+
+    /**
+     * Gets or sets a parameter of the OMX component. Setting parameters is only supported while
+     * the component is stopped.
+     */
+    status_t getOMXParameter(OMX_INDEXTYPE index, void *params);
+    status_t setOMXParameter(OMX_INDEXTYPE index, const void *params);
+
+    // C2Component
+    virtual status_t queue_nb(std::list<std::unique_ptr<C2Work>>* const items) override;
+    virtual status_t announce_nb(const std::vector<C2WorkOutline> &items) override;
+    virtual status_t flush_sm(
+            bool flushThrough, std::list<std::unique_ptr<C2Work>>* const flushedWork) override;
+    virtual status_t drain_nb(bool drainThrough) override;
+    virtual status_t start() override;
+    virtual status_t stop() override;
+    virtual void reset() override;
+    virtual void release() override;
+    virtual std::shared_ptr<C2ComponentInterface> intf() override;
+
+private:
+    class Interface;
+
+    /** OMX callback, as posted to the host thread. */
+    struct Event {
+        enum Type {
+            EMPTY_BUFFER_DONE,
+            FILL_BUFFER_DONE,
+            COMMAND_COMPLETE,
+            PORT_SETTINGS_CHANGED,
+            ERROR,
+        } mType;
+        OMX_BUFFERHEADERTYPE *mHeader;
+        OMX_U32 mData1;
+        OMX_U32 mData2;
+    };
+
+    /** Work that has been (or is being) fed to the component. */
+    struct PendingWork {
+        std::unique_ptr<C2Work> mWork;      // null for the end-of-stream buffer of a drain
+        int64_t mTimestamp;
+        bool mConsumed;
+        std::list<C2ConstLinearBlock> mLinearOutput;
+        std::list<C2ConstGraphicBlock> mGraphicOutput;
+        uint64_t mCompletionsAtDispatch;
+    };
+
+    struct Port {
+        OMX_PARAM_PORTDEFINITIONTYPE mDef;
+        std::vector<OMX_BUFFERHEADERTYPE *> mBuffers;
+        std::list<OMX_BUFFERHEADERTYPE *> mOwned;   // buffers not held by the component
+    };
+
+    enum : OMX_U32 {
+        kPortIndexInput = 0,
+        kPortIndexOutput = 1,
+    };
+
+    C2SoftOMXComponentHost(
+            const char *name, std::unique_ptr<OMXPluginBase> plugin,
+            const std::shared_ptr<C2ComponentListener> &listener);
+
+    // OMX callbacks; called on the looper thread of the OMX component
+    static OMX_ERRORTYPE OnEvent(
+            OMX_HANDLETYPE component, OMX_PTR appData, OMX_EVENTTYPE event,
+            OMX_U32 data1, OMX_U32 data2, OMX_PTR eventData);
+    static OMX_ERRORTYPE OnEmptyBufferDone(
+            OMX_HANDLETYPE component, OMX_PTR appData, OMX_BUFFERHEADERTYPE *header);
+    static OMX_ERRORTYPE OnFillBufferDone(
+            OMX_HANDLETYPE component, OMX_PTR appData, OMX_BUFFERHEADERTYPE *header);
+    static const OMX_CALLBACKTYPE kCallbacks;
+
+    void postEvent(const Event &event);
+
+    // state transitions; called on the client thread while the host thread is not running
+    status_t allocateBuffers(OMX_U32 portIndex);
+    void freeBuffers(OMX_U32 portIndex);
+    status_t waitForCommand(OMX_COMMANDTYPE cmd, OMX_U32 param);
+    status_t setState(OMX_STATETYPE state);
+
+    // host thread
+    void threadLoop();
+    void handleEvent(const Event &event);
+    void dispatchInput(std::unique_ptr<C2Work> work);
+    void handleOutput(OMX_BUFFERHEADERTYPE *header);
+    status_t copyOutput(
+            const OMX_BUFFERHEADERTYPE *header, const std::shared_ptr<C2BlockAllocator> &allocator,
+            PendingWork *target);
+    void startReconfiguration();
+    void startFlush();
+    void fillOwnedOutputBuffers();
+    std::list<std::unique_ptr<PendingWork>>::iterator complete(
+            std::list<std::unique_ptr<PendingWork>>::iterator it, status_t result, bool eos);
+    void completeReady();
+    void completeAll(status_t result, bool eos);
+    bool notifyListener(const bool &destroyed);
+
+    const std::string mName;
+    const node_id mId;
+    const std::shared_ptr<C2ComponentListener> mListener;
+    std::weak_ptr<C2Component> mSelf;
+    std::shared_ptr<Interface> mIntf;
+    std::unique_ptr<OMXPluginBase> mPlugin;
+    OMX_COMPONENTTYPE *mOMXComponent;
+    std::shared_ptr<C2BlockAllocator> mDefaultAllocator;
+
+    // shared between the client, the OMX component and the host thread
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::list<Event> mEvents;
+    std::list<std::unique_ptr<C2Work>> mQueue;      // null entries are drain requests
+    uint32_t mFlushRequests;
+    bool mRunning;
+    bool mExiting;
+    std::thread mThread;
+    std::thread::id mHostThreadId;
+    bool *mHostThreadDestroyed;     // non-null while the host thread runs, see threadLoop()
+
+    // owned by the host thread while it is running
+    Port mPorts[2];
+    std::list<std::unique_ptr<PendingWork>> mPending;
+    std::map<OMX_BUFFERHEADERTYPE *, PendingWork *> mInputWork;
+    std::vector<std::unique_ptr<C2Work>> mDone;
+    std::vector<status_t> mErrors;
+    uint64_t mCompletions;
+    int64_t mLastOutputTimestamp;
+    OMX_CONFIG_RECTTYPE mCrop;
+    bool mReconfiguring;    // output port is being disabled and enabled with new settings
+    bool mDraining;         // end of stream has been queued to the component
+    uint32_t mFlushesPending;
+    bool mFlushing;
+};
+
+} // namespace android
+
+#endif // STAGEFRIGHT_CODEC2_SOFT_OMX_COMPONENT_HOST_H_
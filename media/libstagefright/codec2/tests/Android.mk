@@ -10,6 +10,7 @@ LOCAL_MODULE_TAGS := tests
 LOCAL_SRC_FILES := \
 	vndk/C2UtilTest.cpp \
 	C2_test.cpp \
+	C2Buffer_test.cpp \
 	C2Param_test.cpp \
 
 LOCAL_SHARED_LIBRARIES := \
@@ -27,6 +28,38 @@ LOCAL_CLANG := true
 
 include $(BUILD_NATIVE_TEST)
 
+include $(CLEAR_VARS)
+LOCAL_ADDITIONAL_DEPENDENCIES := $(LOCAL_PATH)/Android.mk
+
+LOCAL_MODULE := codec2_omxhost_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	C2SoftOMXComponentHost_test.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	libstagefright_codec2 \
+	libstagefright_codec2_omxhost \
+	libstagefright_foundation \
+	libstagefright_omx \
+	liblog \
+	libutils
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/media/libstagefright/codec2/include \
+	frameworks/av/media/libstagefright/codec2/vndk/include \
+	frameworks/av/media/libstagefright/codec2/omxhost/include \
+	frameworks/av/media/libstagefright/include \
+	$(TOP)/frameworks/native/include/media/hardware \
+	$(TOP)/frameworks/native/include/media/openmax \
+
+LOCAL_CFLAGS += -Werror -Wall -std=c++14
+LOCAL_CLANG := true
+
+include $(BUILD_NATIVE_TEST)
+
 # Include subdirectory makefiles
 # ============================================================
 
@@ -0,0 +1,575 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "C2SoftOMXComponentHost_test"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <C2AllocatorMemfd.h>
+#include <C2BufferPriv.h>
+#include <C2SoftOMXComponentHost.h>
+
+#include <OMXPluginBase.h>
+#include <SimpleSoftOMXComponent.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+namespace {
+
+const char *kComponentName = "OMX.test.fake.audio.decoder";
+const OMX_U32 kNumBuffers = 4;
+const OMX_U32 kBufferSize = 1024;
+const size_t kPayloadSize = 64;
+const uint8_t kErrorMarker = 0xEE;  // input that makes the fake component signal an error
+const std::chrono::seconds kTimeout(2);
+const C2MemoryUsage kReadWrite = { C2MemoryUsage::kSoftwareRead, C2MemoryUsage::kSoftwareWrite };
+
+template<class T>
+void InitOMXParams(T *params) {
+    memset(params, 0, sizeof(T));
+    params->nSize = sizeof(T);
+    params->nVersion.s.nVersionMajor = 1;
+    params->nVersion.s.nVersionMinor = 0;
+    params->nVersion.s.nRevision = 0;
+    params->nVersion.s.nStep = 0;
+}
+
+/** Shared between a test and the fake component it runs. */
+struct FakeBehavior {
+    size_t mReorderDepth = 0;           // frames held back to be output in timestamp order
+    std::atomic<bool> mHold { false };  // input is not consumed until the component is flushed
+    std::atomic<bool> mDestroyed { false };
+};
+
+/**
+ * Audio "decoder" that outputs a copy of each input buffer with its timestamp. Up to
+ * mReorderDepth frames are held back and output in timestamp order, like a video decoder that
+ * reorders frames; the held frames are output at the end of stream, with the end-of-stream flag
+ * on the last one.
+ */
+struct FakeAudioDecoder : public SimpleSoftOMXComponent {
+    FakeAudioDecoder(
+            const std::shared_ptr<FakeBehavior> &behavior,
+            const OMX_CALLBACKTYPE *callbacks,
+            OMX_PTR appData,
+            OMX_COMPONENTTYPE **component)
+        : SimpleSoftOMXComponent(kComponentName, callbacks, appData, component),
+          mBehavior(behavior),
+          mDraining(false) {
+        for (OMX_U32 portIndex : { kPortIndexInput, kPortIndexOutput }) {
+            OMX_PARAM_PORTDEFINITIONTYPE def;
+            InitOMXParams(&def);
+            def.nPortIndex = portIndex;
+            def.eDir = portIndex == kPortIndexInput ? OMX_DirInput : OMX_DirOutput;
+            def.nBufferCountMin = kNumBuffers;
+            def.nBufferCountActual = kNumBuffers;
+            def.nBufferSize = kBufferSize;
+            def.bEnabled = OMX_TRUE;
+            def.bPopulated = OMX_FALSE;
+            def.eDomain = OMX_PortDomainAudio;
+            def.bBuffersContiguous = OMX_FALSE;
+            def.nBufferAlignment = 1;
+            def.format.audio.cMIMEType = const_cast<char *>("audio/raw");
+            def.format.audio.pNativeRender = NULL;
+            def.format.audio.bFlagErrorConcealment = OMX_FALSE;
+            def.format.audio.eEncoding = OMX_AUDIO_CodingPCM;
+            addPort(def);
+        }
+    }
+
+protected:
+    virtual void onQueueFilled(OMX_U32 /* portIndex */) override {
+        if (mBehavior->mHold) {
+            return;
+        }
+        List<BufferInfo *> &inQueue = getPortQueue(kPortIndexInput);
+        List<BufferInfo *> &outQueue = getPortQueue(kPortIndexOutput);
+        for (;;) {
+            while (!mFrames.empty() && !outQueue.empty()
+                    && (mDraining || mFrames.size() > mBehavior->mReorderDepth)) {
+                outputFrame(*outQueue.begin(), mDraining && mFrames.size() == 1);
+                outQueue.erase(outQueue.begin());
+            }
+            if (mDraining && mFrames.empty()) {
+                if (outQueue.empty()) {
+                    return;
+                }
+                // nothing was held back: signal the end of stream in an empty buffer
+                BufferInfo *outInfo = *outQueue.begin();
+                outQueue.erase(outQueue.begin());
+                outInfo->mHeader->nFilledLen = 0;
+                outInfo->mHeader->nFlags = OMX_BUFFERFLAG_EOS;
+                outInfo->mOwnedByUs = false;
+                notifyFillBufferDone(outInfo->mHeader);
+                mDraining = false;
+                continue;
+            }
+            if (inQueue.empty() || mDraining || mFrames.size() > mBehavior->mReorderDepth) {
+                return;
+            }
+
+            BufferInfo *inInfo = *inQueue.begin();
+            inQueue.erase(inQueue.begin());
+            OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
+            const uint8_t *data = inHeader->pBuffer + inHeader->nOffset;
+            if (inHeader->nFilledLen > 0 && data[0] == kErrorMarker) {
+                notify(OMX_EventError, OMX_ErrorInsufficientResources, 0, NULL);
+            } else if (inHeader->nFilledLen > 0) {
+                mFrames.push_back(
+                        Frame { inHeader->nTimeStamp,
+                                std::vector<uint8_t>(data, data + inHeader->nFilledLen) });
+                std::stable_sort(mFrames.begin(), mFrames.end(),
+                        [](const Frame &a, const Frame &b) {
+                            return a.mTimestamp < b.mTimestamp;
+                        });
+            }
+            mDraining = inHeader->nFlags & OMX_BUFFERFLAG_EOS;
+            inInfo->mOwnedByUs = false;
+            notifyEmptyBufferDone(inHeader);
+        }
+    }
+
+    virtual void onPortFlushCompleted(OMX_U32 portIndex) override {
+        if (portIndex == kPortIndexInput) {
+            mFrames.clear();
+            mDraining = false;
+        }
+    }
+
+    virtual void onReset() override {
+        mFrames.clear();
+        mDraining = false;
+    }
+
+private:
+    enum : OMX_U32 {
+        kPortIndexInput = 0,
+        kPortIndexOutput = 1,
+    };
+
+    struct Frame {
+        OMX_TICKS mTimestamp;
+        std::vector<uint8_t> mData;
+    };
+
+    void outputFrame(BufferInfo *outInfo, bool eos) {
+        const Frame &frame = mFrames.front();
+        OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
+        memcpy(outHeader->pBuffer, frame.mData.data(), frame.mData.size());
+        outHeader->nOffset = 0;
+        outHeader->nFilledLen = frame.mData.size();
+        outHeader->nTimeStamp = frame.mTimestamp;
+        outHeader->nFlags = eos ? OMX_BUFFERFLAG_EOS : 0;
+        mFrames.erase(mFrames.begin());
+        if (eos) {
+            mDraining = false;
+        }
+        outInfo->mOwnedByUs = false;
+        notifyFillBufferDone(outHeader);
+    }
+
+    const std::shared_ptr<FakeBehavior> mBehavior;
+    std::vector<Frame> mFrames;     // in timestamp order
+    bool mDraining;
+
+    DISALLOW_EVIL_CONSTRUCTORS(FakeAudioDecoder);
+};
+
+struct FakePlugin : public OMXPluginBase {
+    explicit FakePlugin(const std::shared_ptr<FakeBehavior> &behavior) : mBehavior(behavior) { }
+
+    virtual OMX_ERRORTYPE makeComponentInstance(
+            const char *name, const OMX_CALLBACKTYPE *callbacks, OMX_PTR appData,
+            OMX_COMPONENTTYPE **component) override {
+        if (strcmp(name, kComponentName)) {
+            return OMX_ErrorInvalidComponentName;
+        }
+        sp<SoftOMXComponent> codec = new FakeAudioDecoder(mBehavior, callbacks, appData, component);
+        codec->incStrong(this);
+        return OMX_ErrorNone;
+    }
+
+    virtual OMX_ERRORTYPE destroyComponentInstance(OMX_COMPONENTTYPE *component) override {
+        SoftOMXComponent *me = (SoftOMXComponent *)component->pComponentPrivate;
+        me->prepareForDestruction();
+        me->decStrong(this);
+        mBehavior->mDestroyed = true;
+        return OMX_ErrorNone;
+    }
+
+    virtual OMX_ERRORTYPE enumerateComponents(
+            OMX_STRING name, size_t size, OMX_U32 index) override {
+        if (index > 0) {
+            return OMX_ErrorNoMore;
+        }
+        strlcpy(name, kComponentName, size);
+        return OMX_ErrorNone;
+    }
+
+    virtual OMX_ERRORTYPE getRolesOfComponent(
+            const char * /* name */, Vector<String8> *roles) override {
+        roles->clear();
+        return OMX_ErrorNone;
+    }
+
+private:
+    const std::shared_ptr<FakeBehavior> mBehavior;
+};
+
+/** Collects the works and errors returned by the host. */
+class Listener : public C2ComponentListener {
+public:
+    virtual void onWorkDone(
+            std::weak_ptr<C2Component> component __unused,
+            std::vector<std::unique_ptr<C2Work>> workItems) override {
+        std::shared_ptr<C2Component> released;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            for (std::unique_ptr<C2Work> &work : workItems) {
+                if (!work->worklets.empty()
+                        && (work->worklets.front()->output.flags & BUFFERFLAG_END_OF_STREAM)) {
+                    released = std::move(mReleaseAtEos);
+                }
+                mDone.push_back(std::move(work));
+            }
+            mCondition.notify_all();
+        }
+        // may destroy the host on its own thread
+        released.reset();
+    }
+
+    virtual void onTripped(
+            std::weak_ptr<C2Component> component __unused,
+            std::vector<std::shared_ptr<C2SettingResult>> settingResult __unused) override {
+    }
+
+    virtual void onError(std::weak_ptr<C2Component> component __unused,
+                         uint32_t errorCode) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        mErrors.push_back(errorCode);
+        mCondition.notify_all();
+    }
+
+    bool waitForWorks(size_t count) {
+        std::unique_lock<std::mutex> lock(mLock);
+        return mCondition.wait_for(lock, kTimeout, [this, count] {
+            return mDone.size() >= count;
+        });
+    }
+
+    std::vector<std::unique_ptr<C2Work>> takeWorks() {
+        std::lock_guard<std::mutex> lock(mLock);
+        std::vector<std::unique_ptr<C2Work>> done;
+        done.swap(mDone);
+        return done;
+    }
+
+    std::vector<uint32_t> errors() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mErrors;
+    }
+
+    /** Makes the listener drop the last reference to |component| once the stream ends. */
+    void releaseAtEos(std::shared_ptr<C2Component> component) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mReleaseAtEos = std::move(component);
+    }
+
+private:
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::vector<std::unique_ptr<C2Work>> mDone;
+    std::vector<uint32_t> mErrors;
+    std::shared_ptr<C2Component> mReleaseAtEos;
+};
+
+bool isEos(const C2Work &work) {
+    return work.worklets.front()->output.flags & BUFFERFLAG_END_OF_STREAM;
+}
+
+/** \return the output of |work|, or an empty vector if it has none. */
+std::vector<uint8_t> outputOf(const C2Work &work) {
+    std::vector<uint8_t> output;
+    for (const std::shared_ptr<C2Buffer> &buffer : work.worklets.front()->output.buffers) {
+        for (const C2ConstLinearBlock &block : buffer->data().linearBlocks()) {
+            C2ReadView view = block.map().get();
+            output.insert(output.end(), view.data(), view.data() + view.capacity());
+        }
+    }
+    return output;
+}
+
+} // unnamed namespace
+
+class C2SoftOMXComponentHostTest : public ::testing::Test {
+protected:
+    virtual void SetUp() override {
+        mBehavior = std::make_shared<FakeBehavior>();
+        mListener = std::make_shared<Listener>();
+        mBlockAllocator = std::make_shared<C2PooledBlockAllocator>(
+                std::make_shared<C2AllocatorMemfd>());
+    }
+
+    virtual void TearDown() override {
+        if (mHost != nullptr) {
+            mHost->release();
+            mHost.reset();
+        }
+    }
+
+    void createAndStart() {
+        ASSERT_EQ(C2_OK, C2SoftOMXComponentHost::Create(
+                kComponentName, std::unique_ptr<OMXPluginBase>(new FakePlugin(mBehavior)),
+                mListener, &mHost));
+        ASSERT_EQ(C2_OK, mHost->start());
+    }
+
+    /** Creates a work with |kPayloadSize| bytes of |value| as input. */
+    std::unique_ptr<C2Work> makeWork(uint64_t timestamp, uint8_t value) {
+        std::unique_ptr<C2Work> work(new C2Work);
+        work->input.flags = (flags_t)0;
+        work->input.ordinal.timestamp = timestamp;
+        work->input.ordinal.frame_index = mFrameIndex++;
+        work->input.ordinal.custom_ordinal = 0;
+        std::shared_ptr<C2LinearBlock> block;
+        EXPECT_EQ(C2_OK, mBlockAllocator->allocateLinearBlock(kPayloadSize, kReadWrite, &block));
+        C2WriteView view = block->map().get();
+        memset(view.data(), value, kPayloadSize);
+        work->input.buffers.push_back(
+                _C2BlockFactory::CreateLinearBuffer({ block->share(0, kPayloadSize, C2Fence()) }));
+        work->worklets.emplace_back(new C2Worklet);
+        work->worklets_processed = 0;
+        return work;
+    }
+
+    /** Queues a work for each timestamp, with input (i + 1) for the i-th one. */
+    void queue(const std::vector<uint64_t> &timestamps) {
+        std::list<std::unique_ptr<C2Work>> items;
+        for (uint64_t timestamp : timestamps) {
+            items.push_back(makeWork(timestamp, (uint8_t)(mFrameIndex + 1)));
+        }
+        ASSERT_EQ(C2_OK, mHost->queue_nb(&items));
+    }
+
+    /** Checks that |work| completed with |kPayloadSize| bytes of its input value as output. */
+    static void expectOwnOutput(const C2Work &work) {
+        EXPECT_EQ(C2_OK, work.result);
+        EXPECT_EQ(1u, work.worklets_processed);
+        EXPECT_EQ(std::vector<uint8_t>(kPayloadSize, (uint8_t)(work.input.ordinal.frame_index + 1)),
+                  outputOf(work)) << "work at " << work.input.ordinal.timestamp;
+    }
+
+    std::shared_ptr<FakeBehavior> mBehavior;
+    std::shared_ptr<Listener> mListener;
+    std::shared_ptr<C2PooledBlockAllocator> mBlockAllocator;
+    std::shared_ptr<C2SoftOMXComponentHost> mHost;
+    uint64_t mFrameIndex = 0;
+};
+
+TEST_F(C2SoftOMXComponentHostTest, QueueAndDrain) {
+    createAndStart();
+
+    // more works than the component has input buffers
+    const size_t kNumWorks = 3 * kNumBuffers;
+    std::vector<uint64_t> timestamps;
+    for (size_t i = 0; i < kNumWorks; ++i) {
+        timestamps.push_back(i * 1000);
+    }
+    queue(timestamps);
+    ASSERT_EQ(C2_OK, mHost->drain_nb(false /* drainThrough */));
+    ASSERT_TRUE(mListener->waitForWorks(kNumWorks));
+
+    std::vector<std::unique_ptr<C2Work>> done = mListener->takeWorks();
+    ASSERT_EQ(kNumWorks, done.size());
+    for (size_t i = 0; i < kNumWorks; ++i) {
+        EXPECT_EQ(i, done[i]->input.ordinal.frame_index);
+        EXPECT_EQ(i * 1000, done[i]->worklets.front()->output.ordinal.timestamp);
+        EXPECT_TRUE(done[i]->input.buffers.front() == nullptr);
+        expectOwnOutput(*done[i]);
+        EXPECT_EQ(i + 1 == kNumWorks, isEos(*done[i])) << "work " << i;
+    }
+    EXPECT_TRUE(mListener->errors().empty());
+}
+
+TEST_F(C2SoftOMXComponentHostTest, DrainReturnsHeldFrameAndResets) {
+    mBehavior->mReorderDepth = 1;
+    createAndStart();
+
+    // the last frame is held by the component until the end of stream, and the work before it
+    // until there is later output
+    queue({ 0, 1000, 2000 });
+    ASSERT_TRUE(mListener->waitForWorks(1));
+    ASSERT_EQ(C2_OK, mHost->drain_nb(false /* drainThrough */));
+    ASSERT_TRUE(mListener->waitForWorks(3));
+    std::vector<std::unique_ptr<C2Work>> done = mListener->takeWorks();
+    ASSERT_EQ(3u, done.size());
+    for (const std::unique_ptr<C2Work> &work : done) {
+        expectOwnOutput(*work);
+    }
+    EXPECT_EQ(2000u, done.back()->input.ordinal.timestamp);
+    EXPECT_TRUE(isEos(*done.back()));
+
+    // the component accepts input after the end of stream
+    queue({ 3000 });
+    ASSERT_EQ(C2_OK, mHost->drain_nb(false /* drainThrough */));
+    ASSERT_TRUE(mListener->waitForWorks(1));
+    done = mListener->takeWorks();
+    ASSERT_EQ(1u, done.size());
+    expectOwnOutput(*done.front());
+    EXPECT_TRUE(isEos(*done.front()));
+}
+
+TEST_F(C2SoftOMXComponentHostTest, ReorderedOutputCompletesWorksOutOfOrder) {
+    mBehavior->mReorderDepth = 2;
+    createAndStart();
+
+    // decode order of frames with B-frames: every work must get the frame of its own timestamp
+    const std::vector<uint64_t> timestamps = { 0, 3000, 1000, 2000, 6000, 4000, 5000 };
+    queue(timestamps);
+    ASSERT_EQ(C2_OK, mHost->drain_nb(false /* drainThrough */));
+    ASSERT_TRUE(mListener->waitForWorks(timestamps.size()));
+
+    std::vector<std::unique_ptr<C2Work>> done = mListener->takeWorks();
+    ASSERT_EQ(timestamps.size(), done.size());
+    std::vector<uint64_t> completed;
+    size_t eosCount = 0;
+    for (const std::unique_ptr<C2Work> &work : done) {
+        expectOwnOutput(*work);
+        completed.push_back(work->input.ordinal.timestamp);
+        eosCount += isEos(*work);
+    }
+    EXPECT_EQ(1u, eosCount);
+    EXPECT_TRUE(isEos(*done.back()));
+
+    // every work is returned once, and the work at 1000 before the one at 3000 queued earlier
+    std::vector<uint64_t> sorted = completed;
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_EQ(std::vector<uint64_t>({ 0, 1000, 2000, 3000, 4000, 5000, 6000 }), sorted);
+    EXPECT_LT(std::find(completed.begin(), completed.end(), 1000),
+              std::find(completed.begin(), completed.end(), 3000));
+}
+
+TEST_F(C2SoftOMXComponentHostTest, FlushReturnsAllWorks) {
+    mBehavior->mHold = true;
+    createAndStart();
+
+    // some of the works are held by the component, the rest are still queued in the host
+    const size_t kNumWorks = kNumBuffers + 2;
+    std::vector<uint64_t> timestamps;
+    for (size_t i = 0; i < kNumWorks; ++i) {
+        timestamps.push_back(i * 1000);
+    }
+    queue(timestamps);
+    std::list<std::unique_ptr<C2Work>> flushed;
+    ASSERT_EQ(C2_OK, mHost->flush_sm(false /* flushThrough */, &flushed));
+    ASSERT_LE(flushed.size(), kNumWorks);
+    ASSERT_TRUE(mListener->waitForWorks(kNumWorks - flushed.size()));
+
+    std::vector<std::unique_ptr<C2Work>> done = mListener->takeWorks();
+    EXPECT_EQ(kNumWorks, flushed.size() + done.size());
+    std::vector<uint64_t> frameIndices;
+    for (const std::unique_ptr<C2Work> &work : flushed) {
+        EXPECT_EQ(C2_NOT_FOUND, work->result);
+        EXPECT_EQ(0u, work->worklets_processed);
+        frameIndices.push_back(work->input.ordinal.frame_index);
+    }
+    for (const std::unique_ptr<C2Work> &work : done) {
+        EXPECT_EQ(C2_NOT_FOUND, work->result);
+        EXPECT_EQ(0u, work->worklets_processed);
+        EXPECT_TRUE(outputOf(*work).empty());
+        frameIndices.push_back(work->input.ordinal.frame_index);
+    }
+    std::sort(frameIndices.begin(), frameIndices.end());
+    for (size_t i = 0; i < frameIndices.size(); ++i) {
+        EXPECT_EQ(i, frameIndices[i]);
+    }
+
+    // work queued after the flush is processed normally
+    mBehavior->mHold = false;
+    queue({ 10000, 11000 });
+    ASSERT_EQ(C2_OK, mHost->drain_nb(false /* drainThrough */));
+    ASSERT_TRUE(mListener->waitForWorks(2));
+    done = mListener->takeWorks();
+    ASSERT_EQ(2u, done.size());
+    for (const std::unique_ptr<C2Work> &work : done) {
+        expectOwnOutput(*work);
+    }
+    EXPECT_TRUE(isEos(*done.back()));
+}
+
+TEST_F(C2SoftOMXComponentHostTest, ComponentErrorIsMapped) {
+    createAndStart();
+
+    std::list<std::unique_ptr<C2Work>> items;
+    items.push_back(makeWork(0, 1));
+    items.push_back(makeWork(1000, kErrorMarker));
+    items.push_back(makeWork(2000, 3));
+    ASSERT_EQ(C2_OK, mHost->queue_nb(&items));
+    ASSERT_EQ(C2_OK, mHost->drain_nb(false /* drainThrough */));
+    ASSERT_TRUE(mListener->waitForWorks(3));
+
+    // OMX_ErrorInsufficientResources is reported as C2_NO_MEMORY
+    EXPECT_EQ(std::vector<uint32_t>({ (uint32_t)C2_NO_MEMORY }), mListener->errors());
+
+    // the work of the failed input completes without output; the others are not affected
+    std::vector<std::unique_ptr<C2Work>> done = mListener->takeWorks();
+    ASSERT_EQ(3u, done.size());
+    std::sort(done.begin(), done.end(),
+            [](const std::unique_ptr<C2Work> &a, const std::unique_ptr<C2Work> &b) {
+                return a->input.ordinal.frame_index < b->input.ordinal.frame_index;
+            });
+    expectOwnOutput(*done[0]);
+    EXPECT_EQ(1000u, done[1]->input.ordinal.timestamp);
+    EXPECT_TRUE(outputOf(*done[1]).empty());
+    expectOwnOutput(*done[2]);
+}
+
+TEST_F(C2SoftOMXComponentHostTest, ListenerMayReleaseHost) {
+    createAndStart();
+
+    // the listener holds the only reference, and drops it on the host thread at the end of
+    // stream; the host thread must not join itself
+    std::weak_ptr<C2Component> host = mHost;
+    mListener->releaseAtEos(std::move(mHost));
+    std::list<std::unique_ptr<C2Work>> items;
+    items.push_back(makeWork(0, 1));
+    items.push_back(makeWork(1000, 2));
+    ASSERT_EQ(C2_OK, host.lock()->queue_nb(&items));
+    ASSERT_EQ(C2_OK, host.lock()->drain_nb(false /* drainThrough */));
+    ASSERT_TRUE(mListener->waitForWorks(2));
+    const std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + kTimeout;
+    while (!mBehavior->mDestroyed && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(mBehavior->mDestroyed);
+}
+
+} // namespace android
@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "C2AllocatorMemfd"
+#include <utils/Log.h>
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+
+#include <cutils/ashmem.h>
+#include <cutils/native_handle.h>
+#include <system/graphics.h>
+
+#include <C2AllocatorMemfd.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+namespace android {
+
+namespace {
+
+/**
+ * Layout of the integers of the native handle of a memfd allocation. The handle contains a
+ * single file descriptor: the shared memory.
+ */
+enum : int {
+    kHandleMagic,       // kMagic
+    kHandleCapacity,    // size of the shared memory
+    kHandleWidth,       // 0 for linear allocations
+    kHandleHeight,      // 0 for linear allocations
+    kHandleFormat,      // 0 for linear allocations
+    kHandleNumInts,
+};
+
+enum : int {
+    kMagic = 0x43326d66, // 'C2mf'
+};
+
+C2Error errnoToC2(int err) {
+    switch (err) {
+        case ENOMEM:
+        case EMFILE:
+        case ENFILE:
+            return C2_NO_MEMORY;
+        case EPERM:
+        case EACCES:
+            return C2_NO_PERMISSION;
+        case EINVAL:
+            return C2_BAD_VALUE;
+        default:
+            return C2_CORRUPTED;
+    }
+}
+
+/**
+ * Creates a shared memory region of |size| bytes. Uses memfd if the kernel supports it, and
+ * ashmem otherwise.
+ *
+ * \return the file descriptor of the region, or a negative errno on failure.
+ */
+int createSharedMemory(const char *name, size_t size) {
+#ifdef __NR_memfd_create
+    int fd = syscall(__NR_memfd_create, name, MFD_CLOEXEC);
+    if (fd >= 0) {
+        if (ftruncate(fd, size) < 0) {
+            int err = errno;
+            close(fd);
+            return -err;
+        }
+        return fd;
+    } else if (errno != ENOSYS) {
+        return -errno;
+    }
+#endif
+    int ashmemFd = ashmem_create_region(name, size);
+    return ashmemFd >= 0 ? ashmemFd : -errno;
+}
+
+/**
+ * \return the size of the shared memory region |fd|, or -1 on failure.
+ */
+off_t getSharedMemorySize(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        return -1;
+    }
+    // ashmem regions are character devices that do not report their size
+    return S_ISREG(st.st_mode) ? st.st_size : ashmem_get_size_region(fd);
+}
+
+/**
+ * Shared memory of an allocation, mapped for its lifetime.
+ */
+class SharedMemory {
+public:
+    /**
+     * Wraps a handle of a memfd allocation (taking ownership of it) and maps it.
+     */
+    explicit SharedMemory(native_handle_t *handle)
+        : mHandle(handle), mBase(nullptr), mSize(0) {
+        mInitCheck = C2_BAD_VALUE;
+        if (handle == nullptr || handle->numFds != 1 || handle->numInts != kHandleNumInts
+                || handle->data[1 + kHandleMagic] != kMagic) {
+            ALOGD("invalid handle");
+            return;
+        }
+        mSize = (uint32_t)handle->data[1 + kHandleCapacity];
+        if (getSharedMemorySize(fd()) < (off_t)mSize) {
+            ALOGD("shared memory is smaller than %u bytes", mSize);
+            return;
+        }
+        // empty allocations are backed by (and map) one byte, so that they are valid too
+        void *base = mmap(
+                nullptr, c2_max(mSize, 1u), PROT_READ | PROT_WRITE, MAP_SHARED, fd(), 0);
+        if (base == MAP_FAILED) {
+            mInitCheck = errnoToC2(errno);
+            ALOGD("failed to map %u bytes (%d)", mSize, errno);
+            return;
+        }
+        mBase = (uint8_t *)base;
+        mInitCheck = C2_OK;
+    }
+
+    ~SharedMemory() {
+        if (mBase != nullptr) {
+            munmap(mBase, c2_max(mSize, 1u));
+        }
+        if (mHandle != nullptr) {
+            native_handle_close(mHandle);
+            native_handle_delete(mHandle);
+        }
+    }
+
+    /**
+     * Creates and maps a new region of |size| bytes, and stores its handle (with the allocation
+     * parameters) into |memory|.
+     */
+    static C2Error Create(
+            uint32_t size, uint32_t width, uint32_t height, uint32_t format,
+            std::unique_ptr<SharedMemory> *memory) {
+        memory->reset();
+        int fd = createSharedMemory("C2AllocatorMemfd", c2_max(size, 1u));
+        if (fd < 0) {
+            ALOGD("failed to create %u bytes of shared memory (%d)", size, -fd);
+            return errnoToC2(-fd);
+        }
+        native_handle_t *handle = native_handle_create(1, kHandleNumInts);
+        if (handle == nullptr) {
+            close(fd);
+            return C2_NO_MEMORY;
+        }
+        handle->data[0] = fd;
+        handle->data[1 + kHandleMagic] = kMagic;
+        handle->data[1 + kHandleCapacity] = (int)size;
+        handle->data[1 + kHandleWidth] = (int)width;
+        handle->data[1 + kHandleHeight] = (int)height;
+        handle->data[1 + kHandleFormat] = (int)format;
+        memory->reset(new SharedMemory(handle));
+        C2Error err = (*memory)->initCheck();
+        if (err != C2_OK) {
+            memory->reset();
+        }
+        return err;
+    }
+
+    /**
+     * Maps the shared memory of the allocation described by |handle|, and stores it into
+     * |memory|. |handle| is not modified; its file descriptor is duplicated.
+     */
+    static C2Error Recreate(const C2Handle *handle, std::unique_ptr<SharedMemory> *memory) {
+        memory->reset();
+        if (handle == nullptr || handle->numFds != 1 || handle->numInts != kHandleNumInts
+                || handle->data[1 + kHandleMagic] != kMagic) {
+            return C2_BAD_VALUE;
+        }
+        native_handle_t *copy = native_handle_create(1, kHandleNumInts);
+        if (copy == nullptr) {
+            return C2_NO_MEMORY;
+        }
+        copy->data[0] = dup(handle->data[0]);
+        if (copy->data[0] < 0) {
+            int err = errno;
+            native_handle_delete(copy);
+            return errnoToC2(err);
+        }
+        for (int i = 0; i < kHandleNumInts; ++i) {
+            copy->data[1 + i] = handle->data[1 + i];
+        }
+        memory->reset(new SharedMemory(copy));
+        C2Error err = (*memory)->initCheck();
+        if (err != C2_OK) {
+            memory->reset();
+        }
+        return err;
+    }
+
+    C2Error initCheck() const { return mInitCheck; }
+    int fd() const { return mHandle->data[0]; }
+    uint8_t *base() const { return mBase; }
+    uint32_t size() const { return mSize; }
+    uint32_t width() const { return (uint32_t)mHandle->data[1 + kHandleWidth]; }
+    uint32_t height() const { return (uint32_t)mHandle->data[1 + kHandleHeight]; }
+    uint32_t format() const { return (uint32_t)mHandle->data[1 + kHandleFormat]; }
+    const C2Handle *handle() const { return mHandle; }
+
+    /**
+     * \return true iff |handle| refers to the same shared memory as this object.
+     */
+    bool sameAs(const C2Handle *handle) const {
+        if (handle == mHandle) {
+            return true;
+        }
+        if (handle == nullptr || handle->numFds != 1 || handle->numInts != kHandleNumInts
+                || handle->data[1 + kHandleMagic] != kMagic) {
+            return false;
+        }
+        // all ashmem regions share the inode of the ashmem device, so only memfd regions can be
+        // compared
+        struct stat st, other;
+        return fstat(fd(), &st) == 0 && fstat(handle->data[0], &other) == 0
+                && S_ISREG(st.st_mode) && st.st_dev == other.st_dev && st.st_ino == other.st_ino;
+    }
+
+private:
+    native_handle_t *mHandle;
+    uint8_t *mBase;
+    uint32_t mSize;
+    C2Error mInitCheck;
+
+    C2_DO_NOT_COPY(SharedMemory);
+};
+
+C2Error checkUsage(C2MemoryUsage usage) {
+    // shared memory cannot be protected
+    if ((usage.mConsumer & C2MemoryUsage::kProtectedRead)
+            || (usage.mProducer & C2MemoryUsage::kProtectedWrite)) {
+        return C2_BAD_VALUE;
+    }
+    return C2_OK;
+}
+
+class C2MemfdLinearAllocation : public C2LinearAllocation {
+public:
+    explicit C2MemfdLinearAllocation(std::unique_ptr<SharedMemory> memory)
+        : C2LinearAllocation(memory->size()), mMemory(std::move(memory)) { }
+
+    virtual ~C2MemfdLinearAllocation() = default;
+
+    virtual C2Error map(
+            size_t offset, size_t size, C2MemoryUsage usage, int *fenceFd,
+            void **addr /* nonnull */) override {
+        *addr = nullptr;
+        if (fenceFd != nullptr) {
+            *fenceFd = -1;
+        }
+        if (offset > capacity() || size > capacity() - offset || checkUsage(usage) != C2_OK) {
+            return C2_BAD_VALUE;
+        }
+        // the memory is always mapped, so this is always synchronous
+        *addr = mMemory->base() + offset;
+        return C2_OK;
+    }
+
+    virtual C2Error unmap(void *addr, size_t size, int *fenceFd) override {
+        if (fenceFd != nullptr) {
+            *fenceFd = -1;
+        }
+        uint8_t *start = (uint8_t *)addr;
+        if (start < mMemory->base() || start > mMemory->base() + capacity()
+                || size > (size_t)(mMemory->base() + capacity() - start)) {
+            return C2_BAD_VALUE;
+        }
+        return C2_OK;
+    }
+
+    virtual bool isValid() const override {
+        return mMemory->base() != nullptr;
+    }
+
+    virtual const C2Handle *handle() const override {
+        return mMemory->handle();
+    }
+
+    virtual bool equals(const std::shared_ptr<C2LinearAllocation> &other) const override {
+        return other != nullptr && mMemory->sameAs(other->handle());
+    }
+
+private:
+    std::unique_ptr<SharedMemory> mMemory;
+};
+
+/**
+ * Plane layout of a YUV 4:2:0 planar graphic allocation.
+ */
+struct PlanarLayout {
+    uint32_t mStride;
+    uint32_t mChromaStride;
+    uint32_t mOffset[3];  // Y, U, V
+    uint32_t mSize;       // total size, or 0 if the dimensions are too large
+
+    PlanarLayout(uint32_t width, uint32_t height, uint32_t format) {
+        uint64_t stride = ((uint64_t)width + 15) & ~15ull;
+        uint64_t chromaStride = ((stride >> 1) + 15) & ~15ull;
+        uint64_t chromaHeight = ((uint64_t)height + 1) >> 1;
+        uint64_t lumaSize = stride * height;
+        uint64_t chromaSize = chromaStride * chromaHeight;
+        uint64_t size = lumaSize + 2 * chromaSize;
+        mStride = (uint32_t)stride;
+        mChromaStride = (uint32_t)chromaStride;
+        mOffset[C2PlaneLayout::Y] = 0;
+        if (format == HAL_PIXEL_FORMAT_YV12) {
+            // YV12 has the Cr plane first
+            mOffset[C2PlaneLayout::V] = (uint32_t)lumaSize;
+            mOffset[C2PlaneLayout::U] = (uint32_t)(lumaSize + chromaSize);
+        } else {
+            mOffset[C2PlaneLayout::U] = (uint32_t)lumaSize;
+            mOffset[C2PlaneLayout::V] = (uint32_t)(lumaSize + chromaSize);
+        }
+        mSize = size > UINT32_MAX ? 0 : (uint32_t)size;
+    }
+
+    static bool IsSupported(uint32_t format) {
+        return format == HAL_PIXEL_FORMAT_YV12 || format == HAL_PIXEL_FORMAT_YCbCr_420_888;
+    }
+};
+
+class C2MemfdGraphicAllocation : public C2GraphicAllocation {
+public:
+    explicit C2MemfdGraphicAllocation(std::unique_ptr<SharedMemory> memory)
+        : C2GraphicAllocation(memory->width(), memory->height()),
+          mMemory(std::move(memory)),
+          mLayout(width(), height(), mMemory->format()),
+          mMapCount(0) { }
+
+    virtual ~C2MemfdGraphicAllocation() = default;
+
+    virtual C2Error map(
+            C2Rect rect, C2MemoryUsage usage, int *fenceFd,
+            C2PlaneLayout *layout /* nonnull */, uint8_t **addr /* nonnull */) override {
+        if (fenceFd != nullptr) {
+            *fenceFd = -1;
+        }
+        if (!C2Rect(width(), height()).contains(rect) || checkUsage(usage) != C2_OK) {
+            return C2_BAD_VALUE;
+        }
+        layout->mType = C2PlaneLayout::MEDIA_IMAGE_TYPE_YUV;
+        layout->mNumPlanes = 3;
+        static const C2PlaneInfo::Channel kChannels[3] = {
+            C2PlaneInfo::Y, C2PlaneInfo::Cb, C2PlaneInfo::Cr
+        };
+        for (uint32_t i = 0; i < 3; ++i) {
+            C2PlaneInfo &info = layout->mPlanes[i];
+            uint32_t subsampling = i == C2PlaneLayout::Y ? 1 : 2;
+            info.mChannel = kChannels[i];
+            info.mColInc = 1;
+            info.mRowInc = i == C2PlaneLayout::Y ? mLayout.mStride : mLayout.mChromaStride;
+            info.mHorizSubsampling = subsampling;
+            info.mVertSubsampling = subsampling;
+            info.mBitDepth = 8;
+            info.mAllocatedDepth = 8;
+            addr[i] = mMemory->base() + mLayout.mOffset[i]
+                    + (size_t)(rect.mTop / subsampling) * info.mRowInc
+                    + rect.mLeft / subsampling;
+        }
+        // the memory is always mapped, so this is always synchronous
+        ++mMapCount;
+        return C2_OK;
+    }
+
+    virtual C2Error unmap(C2Fence *fenceFd __unused) override {
+        if (mMapCount == 0) {
+            return C2_NOT_FOUND;
+        }
+        --mMapCount;
+        return C2_OK;
+    }
+
+    virtual bool isValid() const override {
+        return mMemory->base() != nullptr;
+    }
+
+    virtual const C2Handle *handle() const override {
+        return mMemory->handle();
+    }
+
+    virtual bool equals(const std::shared_ptr<const C2GraphicAllocation> &other) override {
+        return other != nullptr && mMemory->sameAs(other->handle());
+    }
+
+private:
+    std::unique_ptr<SharedMemory> mMemory;
+    const PlanarLayout mLayout;
+    std::atomic<uint32_t> mMapCount;
+};
+
+} // namespace
+
+C2Error C2AllocatorMemfd::allocateLinearBuffer(
+        uint32_t capacity, C2MemoryUsage usage,
+        std::shared_ptr<C2LinearAllocation> *allocation) {
+    *allocation = nullptr;
+    C2Error err = checkUsage(usage);
+    if (err != C2_OK) {
+        return err;
+    }
+    std::unique_ptr<SharedMemory> memory;
+    err = SharedMemory::Create(capacity, 0, 0, 0, &memory);
+    if (err != C2_OK) {
+        return err;
+    }
+    *allocation = std::make_shared<C2MemfdLinearAllocation>(std::move(memory));
+    return C2_OK;
+}
+
+C2Error C2AllocatorMemfd::recreateLinearBuffer(
+        const C2Handle *handle, std::shared_ptr<C2LinearAllocation> *allocation) {
+    *allocation = nullptr;
+    std::unique_ptr<SharedMemory> memory;
+    C2Error err = SharedMemory::Recreate(handle, &memory);
+    if (err != C2_OK) {
+        return err;
+    }
+    if (memory->format() != 0) {
+        return C2_BAD_VALUE;
+    }
+    *allocation = std::make_shared<C2MemfdLinearAllocation>(std::move(memory));
+    return C2_OK;
+}
+
+C2Error C2AllocatorMemfd::allocateGraphicBuffer(
+        uint32_t width, uint32_t height, uint32_t format, C2MemoryUsage usage,
+        std::shared_ptr<C2GraphicAllocation> *allocation) {
+    *allocation = nullptr;
+    C2Error err = checkUsage(usage);
+    if (err != C2_OK) {
+        return err;
+    }
+    PlanarLayout layout(width, height, format);
+    if (width == 0 || height == 0 || !PlanarLayout::IsSupported(format) || layout.mSize == 0) {
+        return C2_BAD_VALUE;
+    }
+    std::unique_ptr<SharedMemory> memory;
+    err = SharedMemory::Create(layout.mSize, width, height, format, &memory);
+    if (err != C2_OK) {
+        return err;
+    }
+    *allocation = std::make_shared<C2MemfdGraphicAllocation>(std::move(memory));
+    return C2_OK;
+}
+
+C2Error C2AllocatorMemfd::recreateGraphicBuffer(
+        const C2Handle *handle, std::shared_ptr<C2GraphicAllocation> *allocation) {
+    *allocation = nullptr;
+    std::unique_ptr<SharedMemory> memory;
+    C2Error err = SharedMemory::Recreate(handle, &memory);
+    if (err != C2_OK) {
+        return err;
+    }
+    PlanarLayout layout(memory->width(), memory->height(), memory->format());
+    if (!PlanarLayout::IsSupported(memory->format()) || layout.mSize == 0
+            || layout.mSize > memory->size()) {
+        return C2_BAD_VALUE;
+    }
+    *allocation = std::make_shared<C2MemfdGraphicAllocation>(std::move(memory));
+    return C2_OK;
+}
+
+} // namespace android
@@ -0,0 +1,545 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "C2Buffer"
+#include <utils/Log.h>
+
+#include <C2BufferPriv.h>
+
+namespace android {
+
+namespace {
+
+/**
+ * Helper to construct acquirable objects, as their constructor is protected.
+ */
+template<typename T>
+struct _C2AcquirableT : public C2Acquirable<T> {
+    _C2AcquirableT(C2Error error, C2Fence fence, T t) : C2Acquirable<T>(error, fence, t) { }
+};
+
+/**
+ * Mapped portion of a linear allocation. The portion is unmapped when the last view using it is
+ * destroyed.
+ */
+class LinearMapping {
+public:
+    LinearMapping(
+            const std::shared_ptr<C2LinearAllocation> &alloc, size_t offset, size_t size,
+            C2MemoryUsage usage)
+        : mAllocation(alloc), mAddr(nullptr), mSize(size) {
+        if (alloc == nullptr) {
+            mError = C2_NO_MEMORY;
+            return;
+        }
+        // a null fence pointer requests a synchronous mapping
+        mError = alloc->map(offset, size, usage, nullptr /* fenceFd */, &mAddr);
+        if (mError != C2_OK) {
+            ALOGD("failed to map linear allocation (%d)", mError);
+            mAddr = nullptr;
+        }
+    }
+
+    ~LinearMapping() {
+        if (mAddr != nullptr) {
+            (void)mAllocation->unmap(mAddr, mSize, nullptr /* fenceFd */);
+        }
+    }
+
+    uint8_t *addr() const { return (uint8_t *)mAddr; }
+    C2Error error() const { return mError; }
+
+private:
+    std::shared_ptr<C2LinearAllocation> mAllocation;
+    void *mAddr;
+    size_t mSize;
+    C2Error mError;
+
+    C2_DO_NOT_COPY(LinearMapping);
+};
+
+/**
+ * Mapped graphic allocation. Views map the whole allocation, and compute the address of their
+ * crop rectangle from the plane layout.
+ */
+class GraphicMapping {
+public:
+    GraphicMapping(const std::shared_ptr<C2GraphicAllocation> &alloc, C2MemoryUsage usage)
+        : mAllocation(alloc), mMapped(false) {
+        for (uint8_t *&addr : mAddr) {
+            addr = nullptr;
+        }
+        mLayout.mType = C2PlaneLayout::MEDIA_IMAGE_TYPE_UNKNOWN;
+        mLayout.mNumPlanes = 0;
+        if (alloc == nullptr) {
+            mError = C2_NO_MEMORY;
+            return;
+        }
+        mError = alloc->map(
+                C2Rect(alloc->width(), alloc->height()), usage, nullptr /* fenceFd */,
+                &mLayout, mAddr);
+        if (mError != C2_OK) {
+            ALOGD("failed to map graphic allocation (%d)", mError);
+        } else {
+            mMapped = true;
+        }
+    }
+
+    ~GraphicMapping() {
+        if (mMapped) {
+            (void)mAllocation->unmap(nullptr /* fenceFd */);
+        }
+    }
+
+    /**
+     * \return the address of the pixel at (|left|, |top|) in |plane|.
+     */
+    uint8_t *addr(uint32_t plane, uint32_t left, uint32_t top) const {
+        if (!mMapped || plane >= mLayout.mNumPlanes || mAddr[plane] == nullptr) {
+            return nullptr;
+        }
+        const C2PlaneInfo &info = mLayout.mPlanes[plane];
+        return mAddr[plane]
+                + (ssize_t)(left / info.mHorizSubsampling) * info.mColInc
+                + (ssize_t)(top / info.mVertSubsampling) * info.mRowInc;
+    }
+
+    const C2PlaneLayout &layout() const { return mLayout; }
+    C2Error error() const { return mError; }
+
+private:
+    std::shared_ptr<C2GraphicAllocation> mAllocation;
+    C2PlaneLayout mLayout;
+    uint8_t *mAddr[C2PlaneLayout::MAX_NUM_PLANES];
+    bool mMapped;
+    C2Error mError;
+
+    C2_DO_NOT_COPY(GraphicMapping);
+};
+
+C2Rect intersect(const C2Rect &a, const C2Rect &b) {
+    uint64_t left = c2_max(a.mLeft, b.mLeft);
+    uint64_t top = c2_max(a.mTop, b.mTop);
+    uint64_t right = c2_min((uint64_t)a.mLeft + a.mWidth, (uint64_t)b.mLeft + b.mWidth);
+    uint64_t bottom = c2_min((uint64_t)a.mTop + a.mHeight, (uint64_t)b.mTop + b.mHeight);
+    if (right <= left || bottom <= top) {
+        return C2Rect(0, 0, left, top);
+    }
+    return C2Rect(right - left, bottom - top, left, top);
+}
+
+} // namespace
+
+/* ========================================== FENCES ========================================== */
+
+/// \todo Only already signaled fences (with no implementation) are supported for now, as all
+/// mappings are synchronous.
+
+C2Error C2Fence::wait(nsecs_t timeoutNs __unused) {
+    return mImpl == nullptr ? C2_OK : C2_UNSUPPORTED;
+}
+
+bool C2Fence::valid() const {
+    return mImpl == nullptr;
+}
+
+bool C2Fence::ready() const {
+    return mImpl == nullptr;
+}
+
+int C2Fence::fd() const {
+    return -1;
+}
+
+bool C2Fence::isHW() const {
+    return false;
+}
+
+template<typename T>
+T C2Acquirable<T>::get() {
+    // \todo propagate fence errors into the object once fences can fail
+    return mT;
+}
+
+template class C2Acquirable<C2ReadView>;
+template class C2Acquirable<C2WriteView>;
+template class C2Acquirable<C2GraphicView>;
+template class C2Acquirable<const C2GraphicView>;
+
+/* ====================================== LINEAR BLOCKS ======================================= */
+
+class C2Block1D::Impl {
+public:
+    explicit Impl(const std::shared_ptr<C2LinearAllocation> &alloc) : mAllocation(alloc) { }
+
+    const std::shared_ptr<C2LinearAllocation> mAllocation;
+};
+
+C2Block1D::C2Block1D(std::shared_ptr<C2LinearAllocation> alloc)
+    : _C2LinearRangeAspect(alloc.get()), mImpl(std::make_shared<Impl>(alloc)) { }
+
+C2Block1D::C2Block1D(std::shared_ptr<C2LinearAllocation> alloc, size_t offset, size_t size)
+    : _C2LinearRangeAspect(alloc.get(), offset, size), mImpl(std::make_shared<Impl>(alloc)) { }
+
+const C2Handle *C2Block1D::handle() const {
+    return mImpl->mAllocation == nullptr ? nullptr : mImpl->mAllocation->handle();
+}
+
+class C2ReadView::Impl {
+public:
+    Impl(const std::shared_ptr<LinearMapping> &mapping, const uint8_t *data)
+        : mMapping(mapping), mData(data), mError(C2_OK) { }
+
+    explicit Impl(C2Error error) : mData(nullptr), mError(error) { }
+
+    const std::shared_ptr<LinearMapping> mMapping;
+    const uint8_t *const mData;
+    const C2Error mError;
+};
+
+C2ReadView::C2ReadView(std::shared_ptr<Impl> impl, uint32_t capacity)
+    : _C2LinearCapacityAspect(capacity), mImpl(impl) { }
+
+C2ReadView::C2ReadView(C2Error error)
+    : _C2LinearCapacityAspect(0u), mImpl(std::make_shared<Impl>(error)) { }
+
+const uint8_t *C2ReadView::data() {
+    return mImpl->mData;
+}
+
+C2ReadView C2ReadView::subView(size_t offset, size_t size) const {
+    if (mImpl->mData == nullptr) {
+        return *this;
+    }
+    uint32_t subOffset = c2_min(offset, capacity());
+    uint32_t subSize = c2_min(size, capacity() - subOffset);
+    return C2ReadView(
+            std::make_shared<Impl>(mImpl->mMapping, mImpl->mData + subOffset), subSize);
+}
+
+C2Error C2ReadView::error() {
+    return mImpl->mError;
+}
+
+class C2WriteView::Impl {
+public:
+    Impl(const std::shared_ptr<LinearMapping> &mapping)
+        : mMapping(mapping), mBase(mapping->addr()), mError(C2_OK) { }
+
+    explicit Impl(C2Error error) : mBase(nullptr), mError(error) { }
+
+    const std::shared_ptr<LinearMapping> mMapping;
+    uint8_t *const mBase;
+    const C2Error mError;
+};
+
+C2WriteView::C2WriteView(std::shared_ptr<Impl> impl, const _C2LinearRangeAspect *block)
+    : _C2EditableLinearRange(block, block->offset(), block->size()), mImpl(impl) { }
+
+C2WriteView::C2WriteView(C2Error error)
+    : _C2EditableLinearRange(nullptr), mImpl(std::make_shared<Impl>(error)) { }
+
+uint8_t *C2WriteView::base() {
+    return mImpl->mBase;
+}
+
+uint8_t *C2WriteView::data() {
+    return mImpl->mBase == nullptr ? nullptr : mImpl->mBase + offset();
+}
+
+C2Error C2WriteView::error() {
+    return mImpl->mError;
+}
+
+C2ConstLinearBlock::C2ConstLinearBlock(
+        std::shared_ptr<C2LinearAllocation> alloc, size_t offset, size_t size, C2Fence fence)
+    : C2Block1D(alloc, offset, size), mFence(fence) { }
+
+C2Acquirable<C2ReadView> C2ConstLinearBlock::map() const {
+    std::shared_ptr<LinearMapping> mapping = std::make_shared<LinearMapping>(
+            _C2BlockFactory::GetLinearAllocation(*this), offset(), size(),
+            C2MemoryUsage { C2MemoryUsage::kSoftwareRead, 0 });
+    if (mapping->error() != C2_OK) {
+        return _C2AcquirableT<C2ReadView>(
+                mapping->error(), mFence, C2ReadView(mapping->error()));
+    }
+    return _C2AcquirableT<C2ReadView>(
+            C2_OK, mFence,
+            C2ReadView(std::make_shared<C2ReadView::Impl>(mapping, mapping->addr()), size()));
+}
+
+C2ConstLinearBlock C2ConstLinearBlock::subBlock(size_t offset, size_t size) const {
+    uint32_t subOffset = c2_min(offset, this->size());
+    uint32_t subSize = c2_min(size, this->size() - subOffset);
+    return C2ConstLinearBlock(
+            _C2BlockFactory::GetLinearAllocation(*this), this->offset() + subOffset, subSize,
+            mFence);
+}
+
+C2LinearBlock::C2LinearBlock(
+        std::shared_ptr<C2LinearAllocation> alloc, size_t offset, size_t size)
+    : C2Block1D(alloc, offset, size) { }
+
+C2Acquirable<C2WriteView> C2LinearBlock::map() {
+    // the write view spans the whole allocation, so that base() is the start of the block
+    std::shared_ptr<LinearMapping> mapping = std::make_shared<LinearMapping>(
+            _C2BlockFactory::GetLinearAllocation(*this), 0, capacity(),
+            C2MemoryUsage { C2MemoryUsage::kSoftwareRead, C2MemoryUsage::kSoftwareWrite });
+    if (mapping->error() != C2_OK) {
+        return _C2AcquirableT<C2WriteView>(
+                mapping->error(), C2Fence(), C2WriteView(mapping->error()));
+    }
+    return _C2AcquirableT<C2WriteView>(
+            C2_OK, C2Fence(), C2WriteView(std::make_shared<C2WriteView::Impl>(mapping), this));
+}
+
+C2ConstLinearBlock C2LinearBlock::share(size_t offset, size_t size, C2Fence fence) {
+    return C2ConstLinearBlock(_C2BlockFactory::GetLinearAllocation(*this), offset, size, fence);
+}
+
+/* ====================================== GRAPHIC BLOCKS ====================================== */
+
+C2GraphicAllocation::~C2GraphicAllocation() = default;
+
+class C2Block2D::Impl {
+public:
+    explicit Impl(const std::shared_ptr<C2GraphicAllocation> &alloc) : mAllocation(alloc) { }
+
+    const std::shared_ptr<C2GraphicAllocation> mAllocation;
+};
+
+C2Block2D::C2Block2D(std::shared_ptr<C2GraphicAllocation> alloc)
+    : _C2PlanarSection(alloc.get()), mImpl(std::make_shared<Impl>(alloc)) { }
+
+C2Block2D::C2Block2D(std::shared_ptr<C2GraphicAllocation> alloc, const C2Rect &crop)
+    : _C2PlanarSection(alloc.get(), crop), mImpl(std::make_shared<Impl>(alloc)) { }
+
+const C2Handle *C2Block2D::handle() const {
+    return mImpl->mAllocation == nullptr ? nullptr : mImpl->mAllocation->handle();
+}
+
+class C2GraphicView::Impl {
+public:
+    Impl(const std::shared_ptr<GraphicMapping> &mapping, const C2Rect &crop)
+        : mMapping(mapping), mError(C2_OK) {
+        for (uint32_t i = 0; i < C2PlaneLayout::MAX_NUM_PLANES; ++i) {
+            mPlanes[i] = mapping->addr(i, crop.mLeft, crop.mTop);
+        }
+    }
+
+    explicit Impl(C2Error error) : mError(error) {
+        for (uint8_t *&plane : mPlanes) {
+            plane = nullptr;
+        }
+    }
+
+    const std::shared_ptr<GraphicMapping> mMapping;
+    uint8_t *mPlanes[C2PlaneLayout::MAX_NUM_PLANES];
+    const C2Error mError;
+};
+
+C2GraphicView::C2GraphicView(
+        std::shared_ptr<Impl> impl, const _C2PlanarCapacityAspect *parent, const C2Rect &crop)
+    : _C2PlanarSection(parent, crop), mImpl(impl) { }
+
+C2GraphicView::C2GraphicView(C2Error error)
+    : _C2PlanarSection(nullptr), mImpl(std::make_shared<Impl>(error)) { }
+
+const uint8_t *C2GraphicView::data() const {
+    return mImpl->mPlanes[0];
+}
+
+uint8_t *C2GraphicView::data() {
+    return mImpl->mPlanes[0];
+}
+
+const uint8_t *C2GraphicView::plane(uint32_t index) const {
+    return index < C2PlaneLayout::MAX_NUM_PLANES ? mImpl->mPlanes[index] : nullptr;
+}
+
+uint8_t *C2GraphicView::plane(uint32_t index) {
+    return index < C2PlaneLayout::MAX_NUM_PLANES ? mImpl->mPlanes[index] : nullptr;
+}
+
+const C2PlaneLayout C2GraphicView::layout() const {
+    if (mImpl->mMapping == nullptr) {
+        C2PlaneLayout layout;
+        layout.mType = C2PlaneLayout::MEDIA_IMAGE_TYPE_UNKNOWN;
+        layout.mNumPlanes = 0;
+        return layout;
+    }
+    return mImpl->mMapping->layout();
+}
+
+const C2GraphicView C2GraphicView::subView(const C2Rect &rect) const {
+    return const_cast<C2GraphicView *>(this)->subView(rect);
+}
+
+C2GraphicView C2GraphicView::subView(const C2Rect &rect) {
+    if (mImpl->mMapping == nullptr) {
+        return *this;
+    }
+    C2Rect subCrop = intersect(crop(), rect);
+    return C2GraphicView(std::make_shared<Impl>(mImpl->mMapping, subCrop), this, subCrop);
+}
+
+C2Error C2GraphicView::error() const {
+    return mImpl->mError;
+}
+
+C2ConstGraphicBlock::C2ConstGraphicBlock(
+        std::shared_ptr<C2GraphicAllocation> alloc, const C2Rect &crop, C2Fence fence)
+    : C2Block2D(alloc, crop), mFence(fence) { }
+
+C2Acquirable<const C2GraphicView> C2ConstGraphicBlock::map() const {
+    std::shared_ptr<C2GraphicAllocation> alloc = _C2BlockFactory::GetGraphicAllocation(*this);
+    std::shared_ptr<GraphicMapping> mapping = std::make_shared<GraphicMapping>(
+            alloc, C2MemoryUsage { C2MemoryUsage::kSoftwareRead, 0 });
+    if (mapping->error() != C2_OK) {
+        return _C2AcquirableT<const C2GraphicView>(
+                mapping->error(), mFence, C2GraphicView(mapping->error()));
+    }
+    return _C2AcquirableT<const C2GraphicView>(
+            C2_OK, mFence,
+            C2GraphicView(std::make_shared<C2GraphicView::Impl>(mapping, crop()), alloc.get(),
+                          crop()));
+}
+
+C2ConstGraphicBlock C2ConstGraphicBlock::subBlock(const C2Rect &rect) const {
+    return C2ConstGraphicBlock(
+            _C2BlockFactory::GetGraphicAllocation(*this), intersect(crop(), rect), mFence);
+}
+
+C2GraphicBlock::C2GraphicBlock(std::shared_ptr<C2GraphicAllocation> alloc, const C2Rect &crop)
+    : C2Block2D(alloc, crop) { }
+
+C2Acquirable<C2GraphicView> C2GraphicBlock::map() {
+    std::shared_ptr<C2GraphicAllocation> alloc = _C2BlockFactory::GetGraphicAllocation(*this);
+    std::shared_ptr<GraphicMapping> mapping = std::make_shared<GraphicMapping>(
+            alloc, C2MemoryUsage { C2MemoryUsage::kSoftwareRead, C2MemoryUsage::kSoftwareWrite });
+    if (mapping->error() != C2_OK) {
+        return _C2AcquirableT<C2GraphicView>(
+                mapping->error(), C2Fence(), C2GraphicView(mapping->error()));
+    }
+    return _C2AcquirableT<C2GraphicView>(
+            C2_OK, C2Fence(),
+            C2GraphicView(std::make_shared<C2GraphicView::Impl>(mapping, crop()), alloc.get(),
+                          crop()));
+}
+
+C2ConstGraphicBlock C2GraphicBlock::share(const C2Rect &crop, C2Fence fence) {
+    return C2ConstGraphicBlock(
+            _C2BlockFactory::GetGraphicAllocation(*this), intersect(this->crop(), crop), fence);
+}
+
+/* ========================================== BUFFER ========================================== */
+
+class C2BufferData::Impl {
+public:
+    explicit Impl(const std::list<C2ConstLinearBlock> &blocks)
+        : mType(blocks.size() == 1 ? LINEAR : LINEAR_CHUNKS), mLinearBlocks(blocks) { }
+
+    explicit Impl(const std::list<C2ConstGraphicBlock> &blocks)
+        : mType(blocks.size() == 1 ? GRAPHIC : GRAPHIC_CHUNKS), mGraphicBlocks(blocks) { }
+
+    Type type() const { return mType; }
+    const std::list<C2ConstLinearBlock> &linearBlocks() const { return mLinearBlocks; }
+    const std::list<C2ConstGraphicBlock> &graphicBlocks() const { return mGraphicBlocks; }
+
+private:
+    Type mType;
+    std::list<C2ConstLinearBlock> mLinearBlocks;
+    std::list<C2ConstGraphicBlock> mGraphicBlocks;
+};
+
+C2BufferData::C2BufferData(const std::list<C2ConstLinearBlock> &blocks)
+    : mImpl(std::make_shared<Impl>(blocks)) { }
+
+C2BufferData::C2BufferData(const std::list<C2ConstGraphicBlock> &blocks)
+    : mImpl(std::make_shared<Impl>(blocks)) { }
+
+C2BufferData::Type C2BufferData::type() const {
+    return mImpl->type();
+}
+
+const std::list<C2ConstLinearBlock> C2BufferData::linearBlocks() const {
+    return mImpl->linearBlocks();
+}
+
+const std::list<C2ConstGraphicBlock> C2BufferData::graphicBlocks() const {
+    return mImpl->graphicBlocks();
+}
+
+C2Buffer::C2Buffer(const std::list<C2ConstLinearBlock> &blocks) : mData(blocks) { }
+
+C2Buffer::C2Buffer(const std::list<C2ConstGraphicBlock> &blocks) : mData(blocks) { }
+
+const C2BufferData C2Buffer::data() const {
+    return mData;
+}
+
+namespace {
+
+/**
+ * Helper to construct buffers, as their constructor is protected.
+ */
+struct _C2BufferT : public C2Buffer {
+    explicit _C2BufferT(const std::list<C2ConstLinearBlock> &blocks) : C2Buffer(blocks) { }
+    explicit _C2BufferT(const std::list<C2ConstGraphicBlock> &blocks) : C2Buffer(blocks) { }
+};
+
+} // unnamed namespace
+
+/* ====================================== BLOCK FACTORY ======================================= */
+
+// static
+C2LinearBlock _C2BlockFactory::CreateLinearBlock(
+        const std::shared_ptr<C2LinearAllocation> &alloc, size_t offset, size_t size) {
+    return C2LinearBlock(alloc, offset, size);
+}
+
+// static
+C2GraphicBlock _C2BlockFactory::CreateGraphicBlock(
+        const std::shared_ptr<C2GraphicAllocation> &alloc, const C2Rect &crop) {
+    return C2GraphicBlock(alloc, crop);
+}
+
+// static
+std::shared_ptr<C2Buffer> _C2BlockFactory::CreateLinearBuffer(
+        const std::list<C2ConstLinearBlock> &blocks) {
+    return std::make_shared<_C2BufferT>(blocks);
+}
+
+// static
+std::shared_ptr<C2Buffer> _C2BlockFactory::CreateGraphicBuffer(
+        const std::list<C2ConstGraphicBlock> &blocks) {
+    return std::make_shared<_C2BufferT>(blocks);
+}
+
+// static
+std::shared_ptr<C2LinearAllocation> _C2BlockFactory::GetLinearAllocation(
+        const C2Block1D &block) {
+    return block.mImpl->mAllocation;
+}
+
+// static
+std::shared_ptr<C2GraphicAllocation> _C2BlockFactory::GetGraphicAllocation(
+        const C2Block2D &block) {
+    return block.mImpl->mAllocation;
+}
+
+} // namespace android
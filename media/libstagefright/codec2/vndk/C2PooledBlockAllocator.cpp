@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "C2PooledBlockAllocator"
+#include <utils/Log.h>
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include <C2BufferPriv.h>
+
+namespace android {
+
+/**
+ * Free lists of the pool. Blocks refer to their allocation through a shared pointer whose
+ * deleter returns the allocation to these lists (if the pool still exists.)
+ */
+class C2PooledBlockAllocator::Impl : public std::enable_shared_from_this<Impl> {
+public:
+    // size class, consumer usage, producer usage
+    typedef std::tuple<uint32_t, uint64_t, uint64_t> LinearKey;
+    // width, height, format, consumer usage, producer usage
+    typedef std::tuple<uint32_t, uint32_t, uint32_t, uint64_t, uint64_t> GraphicKey;
+
+    Impl(const std::shared_ptr<C2Allocator> &allocator, size_t maxCachedPerClass)
+        : mAllocator(allocator), mMaxCachedPerClass(maxCachedPerClass) { }
+
+    C2Error allocateLinear(
+            uint32_t capacity, C2MemoryUsage usage, std::shared_ptr<C2LinearAllocation> *alloc) {
+        LinearKey key(SizeClass(capacity), usage.mConsumer, usage.mProducer);
+        std::shared_ptr<C2LinearAllocation> cached = take(&mLinear, key);
+        if (cached == nullptr) {
+            C2Error err = mAllocator->allocateLinearBuffer(std::get<0>(key), usage, &cached);
+            if (err != C2_OK) {
+                *alloc = nullptr;
+                return err;
+            }
+        }
+        *alloc = wrap(&Impl::recycleLinear, key, cached);
+        return C2_OK;
+    }
+
+    C2Error allocateGraphic(
+            uint32_t width, uint32_t height, uint32_t format, C2MemoryUsage usage,
+            std::shared_ptr<C2GraphicAllocation> *alloc) {
+        GraphicKey key(width, height, format, usage.mConsumer, usage.mProducer);
+        std::shared_ptr<C2GraphicAllocation> cached = take(&mGraphic, key);
+        if (cached == nullptr) {
+            C2Error err = mAllocator->allocateGraphicBuffer(
+                    width, height, format, usage, &cached);
+            if (err != C2_OK) {
+                *alloc = nullptr;
+                return err;
+            }
+        }
+        *alloc = wrap(&Impl::recycleGraphic, key, cached);
+        return C2_OK;
+    }
+
+    void clear() {
+        // free the allocations outside of the lock
+        std::map<LinearKey, std::list<std::shared_ptr<C2LinearAllocation>>> linear;
+        std::map<GraphicKey, std::list<std::shared_ptr<C2GraphicAllocation>>> graphic;
+        std::lock_guard<std::mutex> lock(mLock);
+        std::swap(linear, mLinear);
+        std::swap(graphic, mGraphic);
+    }
+
+    size_t numCached() const {
+        std::lock_guard<std::mutex> lock(mLock);
+        size_t count = 0;
+        for (const auto &entry : mLinear) {
+            count += entry.second.size();
+        }
+        for (const auto &entry : mGraphic) {
+            count += entry.second.size();
+        }
+        return count;
+    }
+
+private:
+    template<typename K, typename T>
+    std::shared_ptr<T> take(std::map<K, std::list<std::shared_ptr<T>>> *cache, const K &key) {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = cache->find(key);
+        if (it == cache->end() || it->second.empty()) {
+            return nullptr;
+        }
+        std::shared_ptr<T> alloc = it->second.front();
+        it->second.pop_front();
+        return alloc;
+    }
+
+    template<typename K, typename T>
+    void recycle(
+            std::map<K, std::list<std::shared_ptr<T>>> *cache, const K &key,
+            const std::shared_ptr<T> &alloc) {
+        std::lock_guard<std::mutex> lock(mLock);
+        std::list<std::shared_ptr<T>> &list = (*cache)[key];
+        if (list.size() < mMaxCachedPerClass) {
+            list.push_back(alloc);
+        }
+    }
+
+    void recycleLinear(const LinearKey &key, const std::shared_ptr<C2LinearAllocation> &alloc) {
+        recycle(&mLinear, key, alloc);
+    }
+
+    void recycleGraphic(
+            const GraphicKey &key, const std::shared_ptr<C2GraphicAllocation> &alloc) {
+        recycle(&mGraphic, key, alloc);
+    }
+
+    /**
+     * Returns a shared pointer to |alloc| that calls |recycle| once the last copy of it is
+     * destroyed.
+     */
+    template<typename K, typename T>
+    std::shared_ptr<T> wrap(
+            void (Impl::*recycle)(const K &, const std::shared_ptr<T> &), const K &key,
+            const std::shared_ptr<T> &alloc) {
+        std::weak_ptr<Impl> weakPool = shared_from_this();
+        return std::shared_ptr<T>(alloc.get(), [weakPool, recycle, key, alloc](T *) {
+            std::shared_ptr<Impl> pool = weakPool.lock();
+            if (pool != nullptr) {
+                ((*pool).*recycle)(key, alloc);
+            }
+        });
+    }
+
+    const std::shared_ptr<C2Allocator> mAllocator;
+    const size_t mMaxCachedPerClass;
+    mutable std::mutex mLock;
+    std::map<LinearKey, std::list<std::shared_ptr<C2LinearAllocation>>> mLinear;
+    std::map<GraphicKey, std::list<std::shared_ptr<C2GraphicAllocation>>> mGraphic;
+};
+
+C2PooledBlockAllocator::C2PooledBlockAllocator(
+        const std::shared_ptr<C2Allocator> &allocator, size_t maxCachedPerClass)
+    : mImpl(std::make_shared<Impl>(allocator, maxCachedPerClass)) { }
+
+C2PooledBlockAllocator::~C2PooledBlockAllocator() {
+    // allocations still used by blocks are freed when released
+    mImpl->clear();
+}
+
+C2Error C2PooledBlockAllocator::allocateLinearBlock(
+        uint32_t capacity, C2MemoryUsage usage, std::shared_ptr<C2LinearBlock> *block) {
+    *block = nullptr;
+    std::shared_ptr<C2LinearAllocation> alloc;
+    C2Error err = mImpl->allocateLinear(capacity, usage, &alloc);
+    if (err != C2_OK) {
+        return err;
+    }
+    *block = std::make_shared<C2LinearBlock>(
+            _C2BlockFactory::CreateLinearBlock(alloc, 0, capacity));
+    return C2_OK;
+}
+
+C2Error C2PooledBlockAllocator::allocateGraphicBlock(
+        uint32_t width, uint32_t height, uint32_t format, C2MemoryUsage usage,
+        std::shared_ptr<C2GraphicBlock> *block) {
+    *block = nullptr;
+    std::shared_ptr<C2GraphicAllocation> alloc;
+    C2Error err = mImpl->allocateGraphic(width, height, format, usage, &alloc);
+    if (err != C2_OK) {
+        return err;
+    }
+    *block = std::make_shared<C2GraphicBlock>(
+            _C2BlockFactory::CreateGraphicBlock(alloc, C2Rect(width, height)));
+    return C2_OK;
+}
+
+void C2PooledBlockAllocator::clear() {
+    mImpl->clear();
+}
+
+size_t C2PooledBlockAllocator::numCachedAllocations() const {
+    return mImpl->numCached();
+}
+
+// static
+uint32_t C2PooledBlockAllocator::SizeClass(uint32_t capacity) {
+    if (capacity <= kMinSizeClass) {
+        return kMinSizeClass;
+    }
+    // four classes per power of two: 1, 1.25, 1.5 and 1.75 times 2^n
+    uint32_t order = 31 - __builtin_clz(capacity - 1);
+    uint64_t step = 1ull << (order - 2);
+    uint64_t sizeClass = ((uint64_t)capacity + step - 1) & ~(step - 1);
+    return sizeClass > UINT32_MAX ? capacity : (uint32_t)sizeClass;
+}
+
+} // namespace android
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STAGEFRIGHT_CODEC2_ALLOCATOR_MEMFD_H_
+#define STAGEFRIGHT_CODEC2_ALLOCATOR_MEMFD_H_
+
+#include <C2Buffer.h>
+
+namespace android {
+
+/**
+ * Allocator for software-only buffers backed by shared memory (memfd, or ashmem on kernels
+ * without memfd.)
+ *
+ * Allocations can be shared with other processes via their handle, which contains the shared
+ * memory file descriptor, and recreated from it.
+ *
+ * Allocations are mapped into the process once, when they are created, so mapping is
+ * synchronous and never returns a fence; it only computes the address of the mapped portion.
+ * Unlike gralloc, any number of portions of an allocation can be mapped at the same time.
+ *
+ * Graphic allocations support the HAL_PIXEL_FORMAT_YV12 and HAL_PIXEL_FORMAT_YCbCr_420_888
+ * formats, and use the YV12 layout (16-byte aligned luma and chroma strides), with the chroma
+ * planes in Cb, Cr order for the latter.
+ */
+class C2AllocatorMemfd : public C2Allocator {
+public:
+    C2AllocatorMemfd() = default;
+
+    virtual ~C2AllocatorMemfd() = default;
+
+    virtual C2Error allocateLinearBuffer(
+            uint32_t capacity, C2MemoryUsage usage,
+            std::shared_ptr<C2LinearAllocation> *allocation) override;
+
+    virtual C2Error recreateLinearBuffer(
+            const C2Handle *handle,
+            std::shared_ptr<C2LinearAllocation> *allocation) override;
+
+    virtual C2Error allocateGraphicBuffer(
+            uint32_t width, uint32_t height, uint32_t format, C2MemoryUsage usage,
+            std::shared_ptr<C2GraphicAllocation> *allocation) override;
+
+    virtual C2Error recreateGraphicBuffer(
+            const C2Handle *handle,
+            std::shared_ptr<C2GraphicAllocation> *allocation) override;
+};
+
+} // namespace android
+
+#endif // STAGEFRIGHT_CODEC2_ALLOCATOR_MEMFD_H_
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STAGEFRIGHT_CODEC2_BUFFER_PRIV_H_
+#define STAGEFRIGHT_CODEC2_BUFFER_PRIV_H_
+
+#include <C2Buffer.h>
+
+#include <list>
+#include <memory>
+
+/** \file
+ * Block creation and block allocators to be used by Codec2 implementations.
+ */
+
+namespace android {
+
+/**
+ * Creates blocks for allocations and buffers for blocks, and gives access to the allocation of a
+ * block.
+ */
+struct _C2BlockFactory {
+    /**
+     * Creates a writeable linear block for the [|offset|, |offset| + |size|) portion of |alloc|.
+     */
+    static C2LinearBlock CreateLinearBlock(
+            const std::shared_ptr<C2LinearAllocation> &alloc, size_t offset, size_t size);
+
+    /**
+     * Creates a writeable graphic block for the |crop| section of |alloc|.
+     */
+    static C2GraphicBlock CreateGraphicBlock(
+            const std::shared_ptr<C2GraphicAllocation> &alloc, const C2Rect &crop);
+
+    /**
+     * Creates a buffer containing |blocks|. A buffer with more than one block is of the
+     * LINEAR_CHUNKS type.
+     */
+    static std::shared_ptr<C2Buffer> CreateLinearBuffer(
+            const std::list<C2ConstLinearBlock> &blocks);
+
+    /**
+     * Creates a buffer containing |blocks|. A buffer with more than one block is of the
+     * GRAPHIC_CHUNKS type.
+     */
+    static std::shared_ptr<C2Buffer> CreateGraphicBuffer(
+            const std::list<C2ConstGraphicBlock> &blocks);
+
+    /**
+     * \return the allocation a linear (or const linear) block is based on.
+     */
+    static std::shared_ptr<C2LinearAllocation> GetLinearAllocation(const C2Block1D &block);
+
+    /**
+     * \return the allocation a graphic (or const graphic) block is based on.
+     */
+    static std::shared_ptr<C2GraphicAllocation> GetGraphicAllocation(const C2Block2D &block);
+};
+
+/**
+ * Block allocator that recycles the allocations of released blocks.
+ *
+ * Linear blocks are allocated from size classes: the requested capacity is rounded up to one of
+ * four classes per power of two, starting at one page (so at most 25% of an allocation is
+ * wasted), and an allocation released by a block can serve any later request of the same class
+ * and usage. The returned block spans the requested capacity, even though its allocation (and
+ * thus its capacity()) may be larger. Graphic allocations are recycled for requests of the same
+ * dimensions, format and usage.
+ *
+ * An allocation is returned to the pool when the last block or view referring to it is
+ * destroyed. At most |maxCachedPerClass| unused allocations are kept per class; the rest are
+ * freed. Allocations outliving the pool are freed when released.
+ *
+ * This class is thread-safe.
+ */
+class C2PooledBlockAllocator : public C2BlockAllocator {
+public:
+    enum : size_t {
+        kDefaultMaxCachedPerClass = 8,
+    };
+
+    enum : uint32_t {
+        kMinSizeClass = 4096,
+    };
+
+    explicit C2PooledBlockAllocator(
+            const std::shared_ptr<C2Allocator> &allocator,
+            size_t maxCachedPerClass = kDefaultMaxCachedPerClass);
+
+    virtual ~C2PooledBlockAllocator();
+
+    virtual C2Error allocateLinearBlock(
+            uint32_t capacity, C2MemoryUsage usage,
+            std::shared_ptr<C2LinearBlock> *block /* nonnull */) override;
+
+    virtual C2Error allocateGraphicBlock(
+            uint32_t width, uint32_t height, uint32_t format, C2MemoryUsage usage,
+            std::shared_ptr<C2GraphicBlock> *block /* nonnull */) override;
+
+    /**
+     * Frees all unused allocations held by this pool.
+     */
+    void clear();
+
+    /**
+     * \return the number of unused allocations held by this pool.
+     */
+    size_t numCachedAllocations() const;
+
+    /**
+     * \return the size class (allocation size) used for a linear block of |capacity|.
+     */
+    static uint32_t SizeClass(uint32_t capacity);
+
+private:
+    class Impl;
+    std::shared_ptr<Impl> mImpl;
+};
+
+} // namespace android
+
+#endif // STAGEFRIGHT_CODEC2_BUFFER_PRIV_H_
@@ -22,6 +22,7 @@
 #include <OMX_AudioExt.h>
 #include <OMX_IndexExt.h>
 
+#include <audio_utils/primitives.h>
 #include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/hexdump.h>
@@ -77,6 +78,7 @@ SoftAAC2::SoftAAC2(
       mInputBufferCount(0),
       mOutputBufferCount(0),
       mSignalledError(false),
+      mOutputFloat(false),
       mLastInHeader(NULL),
       mOutputPortSettingsChange(NONE) {
     initPorts();
@@ -114,7 +116,7 @@ void SoftAAC2::initPorts() {
     def.eDir = OMX_DirOutput;
     def.nBufferCountMin = kNumOutputBuffers;
     def.nBufferCountActual = def.nBufferCountMin;
-    def.nBufferSize = 4096 * MAX_CHANNEL_COUNT;
+    def.nBufferSize = 2048 * MAX_CHANNEL_COUNT * sizeof(int16_t);
     def.bEnabled = OMX_TRUE;
     def.bPopulated = OMX_FALSE;
     def.eDomain = OMX_PortDomainAudio;
@@ -270,10 +272,11 @@ OMX_ERRORTYPE SoftAAC2::internalGetParameter(
                 return OMX_ErrorUndefined;
             }
 
-            pcmParams->eNumData = OMX_NumericalDataSigned;
+            pcmParams->eNumData =
+                    mOutputFloat ? OMX_NumericalDataFloat : OMX_NumericalDataSigned;
             pcmParams->eEndian = OMX_EndianBig;
             pcmParams->bInterleaved = OMX_TRUE;
-            pcmParams->nBitPerSample = 16;
+            pcmParams->nBitPerSample = 8 * outputSampleSize();
             pcmParams->ePCMMode = OMX_AUDIO_PCMModeLinear;
             pcmParams->eChannelMapping[0] = OMX_AUDIO_ChannelLF;
             pcmParams->eChannelMapping[1] = OMX_AUDIO_ChannelRF;
@@ -450,6 +453,19 @@ OMX_ERRORTYPE SoftAAC2::internalSetParameter(
                 return OMX_ErrorUndefined;
             }
 
+            // FDK only decodes to 16-bit PCM; float output is converted from it.
+            if (pcmParams->eNumData == OMX_NumericalDataFloat
+                    && pcmParams->nBitPerSample == 32) {
+                mOutputFloat = true;
+            } else if (pcmParams->eNumData == OMX_NumericalDataSigned
+                    && pcmParams->nBitPerSample == 16) {
+                mOutputFloat = false;
+            } else {
+                return OMX_ErrorUnsupportedSetting;
+            }
+            editPortInfo(1)->mDef.nBufferSize =
+                    2048 * MAX_CHANNEL_COUNT * outputSampleSize();
+
             return OMX_ErrorNone;
         }
 
@@ -891,7 +907,7 @@ void SoftAAC2::onQueueFilled(OMX_U32 /* portIndex */) {
 
             INT_PCM *outBuffer =
                     reinterpret_cast<INT_PCM *>(outHeader->pBuffer + outHeader->nOffset);
-            int samplesize = mStreamInfo->numChannels * sizeof(int16_t);
+            int samplesize = mStreamInfo->numChannels * outputSampleSize();
             if (outHeader->nOffset
                     + mStreamInfo->frameSize * samplesize
                     > outHeader->nAllocLen) {
@@ -903,7 +919,7 @@ void SoftAAC2::onQueueFilled(OMX_U32 /* portIndex */) {
             }
 
             int available = outputDelayRingBufferSamplesAvailable();
-            int numSamples = outHeader->nAllocLen / sizeof(int16_t);
+            int numSamples = outHeader->nAllocLen / outputSampleSize();
             if (numSamples > available) {
                 numSamples = available;
             }
@@ -960,7 +976,11 @@ void SoftAAC2::onQueueFilled(OMX_U32 /* portIndex */) {
                 }
             }
 
-            outHeader->nFilledLen = numSamples * sizeof(int16_t);
+            if (mOutputFloat) {
+                // expand in place, the 16-bit samples occupy the first half of the buffer
+                memcpy_to_float_from_i16((float *)outBuffer, outBuffer, numSamples);
+            }
+            outHeader->nFilledLen = numSamples * outputSampleSize();
 
             if (mEndOfInput && !outQueue.empty() && outputDelayRingBufferSamplesAvailable() == 0) {
                 outHeader->nFlags = OMX_BUFFERFLAG_EOS;
@@ -996,7 +1016,10 @@ void SoftAAC2::onQueueFilled(OMX_U32 /* portIndex */) {
                     if (ns < 0) {
                         ns = 0;
                     }
-                    outHeader->nFilledLen = ns;
+                    if (mOutputFloat) {
+                        memcpy_to_float_from_i16((float *)outBuffer, outBuffer, ns);
+                    }
+                    outHeader->nFilledLen = ns * outputSampleSize();
                     outHeader->nFlags = OMX_BUFFERFLAG_EOS;
 
                     outHeader->nTimeStamp = mBufferTimestamps.itemAt(0);
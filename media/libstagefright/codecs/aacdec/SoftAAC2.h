@@ -51,6 +51,10 @@ private:
         kNumDelayBlocksMax      = 8,
     };
 
+    size_t outputSampleSize() const {
+        return mOutputFloat ? sizeof(float) : sizeof(int16_t);
+    }
+
     HANDLE_AACDECODER mAACDecoder;
     CStreamInfo *mStreamInfo;
     bool mIsADTS;
@@ -58,6 +62,7 @@ private:
     size_t mInputBufferCount;
     size_t mOutputBufferCount;
     bool mSignalledError;
+    bool mOutputFloat;  // output float PCM instead of 16-bit PCM
     OMX_BUFFERHEADERTYPE *mLastInHeader;
     Vector<int32_t> mBufferSizes;
     Vector<int32_t> mDecodedSizes;
@@ -58,6 +58,7 @@ SoftAMR::SoftAMR(
     }
 
     initPorts();
+    setBatchedQueueFilled(true);
     CHECK_EQ(initDecoder(), (status_t)OK);
 }
 
@@ -105,8 +106,8 @@ void SoftAMR::initPorts() {
     def.nBufferCountMin = kNumBuffers;
     def.nBufferCountActual = def.nBufferCountMin;
 
-    def.nBufferSize =
-        (mMode == MODE_NARROW ? kNumSamplesPerFrameNB : kNumSamplesPerFrameWB)
+    def.nBufferSize = kMaxFramesPerOutputBuffer
+        * (mMode == MODE_NARROW ? kNumSamplesPerFrameNB : kNumSamplesPerFrameWB)
             * sizeof(int16_t);
 
     def.bEnabled = OMX_TRUE;
@@ -294,6 +295,102 @@ static size_t getFrameSize(unsigned FT) {
     return frameSize;
 }
 
+bool SoftAMR::decodeFrame(
+        const uint8_t *inputPtr, size_t inputSize, int16_t *outPtr, size_t *numBytesRead) {
+    if (mMode == MODE_NARROW) {
+        int16 mode = ((inputPtr[0] >> 3) & 0x0f);
+        // for WMF since MIME_IETF is used when calling AMRDecode.
+        size_t frameSize = WmfDecBytesPerFrame[mode] + 1;
+
+        if (inputSize < frameSize) {
+            ALOGE("b/27662364: expected %zu bytes vs %zu", frameSize, inputSize);
+            notify(OMX_EventError, OMX_ErrorStreamCorrupt, 0, NULL);
+            mSignalledError = true;
+            return false;
+        }
+
+        int32_t numBytes =
+            AMRDecode(mState,
+              (Frame_Type_3GPP)((inputPtr[0] >> 3) & 0x0f),
+              (UWord8 *)&inputPtr[1],
+              outPtr,
+              MIME_IETF);
+
+        if (numBytes == -1) {
+            ALOGE("PV AMR decoder AMRDecode() call failed");
+
+            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+            mSignalledError = true;
+
+            return false;
+        }
+
+        ++numBytes;  // Include the frame type header byte.
+
+        if (static_cast<size_t>(numBytes) > inputSize) {
+            // This is bad, should never have happened, but did. Abort now.
+
+            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+            mSignalledError = true;
+
+            return false;
+        }
+
+        *numBytesRead = numBytes;
+        return true;
+    }
+
+    int16 mode = ((inputPtr[0] >> 3) & 0x0f);
+
+    if (mode >= 10 && mode <= 13) {
+        ALOGE("encountered illegal frame type %d in AMR WB content.",
+              mode);
+
+        notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+        mSignalledError = true;
+
+        return false;
+    }
+
+    size_t frameSize = getFrameSize(mode);
+    if (inputSize < frameSize) {
+        ALOGE("b/27662364: expected %zu bytes vs %zu", frameSize, inputSize);
+        notify(OMX_EventError, OMX_ErrorStreamCorrupt, 0, NULL);
+        mSignalledError = true;
+        return false;
+    }
+
+    if (mode >= 9) {
+        // Produce silence instead of comfort noise and for
+        // speech lost/no data.
+        memset(outPtr, 0, kNumSamplesPerFrameWB * sizeof(int16_t));
+    } else if (mode < 9) {
+        int16 frameType;
+        RX_State_wb rx_state;
+        mime_unsorting(
+                const_cast<uint8_t *>(&inputPtr[1]),
+                mInputSampleBuffer,
+                &frameType, &mode, 1, &rx_state);
+
+        int16_t numSamplesOutput;
+        pvDecoder_AmrWb(
+                mode, mInputSampleBuffer,
+                outPtr,
+                &numSamplesOutput,
+                mDecoderBuf, frameType, mDecoderCookie);
+
+        CHECK_EQ((int)numSamplesOutput, (int)kNumSamplesPerFrameWB);
+
+        for (int i = 0; i < kNumSamplesPerFrameWB; ++i) {
+            /* Delete the 2 LSBs (14-bit output) */
+            outPtr[i] &= 0xfffC;
+        }
+    }
+
+    *numBytesRead = frameSize;
+    return true;
+}
+
 void SoftAMR::onQueueFilled(OMX_U32 /* portIndex */) {
     List<BufferInfo *> &inQueue = getPortQueue(0);
     List<BufferInfo *> &outQueue = getPortQueue(1);
@@ -302,6 +399,11 @@ void SoftAMR::onQueueFilled(OMX_U32 /* portIndex */) {
         return;
     }
 
+    const size_t numSamplesPerFrame =
+        mMode == MODE_NARROW ? kNumSamplesPerFrameNB : kNumSamplesPerFrameWB;
+    const size_t frameBytes = numSamplesPerFrame * sizeof(int16_t);
+    const int32_t sampleRate = mMode == MODE_NARROW ? kSampleRateNB : kSampleRateWB;
+
     while (!inQueue.empty() && !outQueue.empty()) {
         BufferInfo *inInfo = *inQueue.begin();
         OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
@@ -335,140 +437,38 @@ void SoftAMR::onQueueFilled(OMX_U32 /* portIndex */) {
             mNumSamplesOutput = 0;
         }
 
-        const uint8_t *inputPtr = inHeader->pBuffer + inHeader->nOffset;
-        int32_t numBytesRead;
-
-        if (mMode == MODE_NARROW) {
-            if (outHeader->nAllocLen < kNumSamplesPerFrameNB * sizeof(int16_t)) {
-                ALOGE("b/27662364: NB expected output buffer %zu bytes vs %u",
-                       kNumSamplesPerFrameNB * sizeof(int16_t), outHeader->nAllocLen);
-                android_errorWriteLog(0x534e4554, "27662364");
-                notify(OMX_EventError, OMX_ErrorOverflow, 0, NULL);
-                mSignalledError = true;
-                return;
-            }
-
-            int16 mode = ((inputPtr[0] >> 3) & 0x0f);
-            // for WMF since MIME_IETF is used when calling AMRDecode.
-            size_t frameSize = WmfDecBytesPerFrame[mode] + 1;
-
-            if (inHeader->nFilledLen < frameSize) {
-                ALOGE("b/27662364: expected %zu bytes vs %u", frameSize, inHeader->nFilledLen);
-                notify(OMX_EventError, OMX_ErrorStreamCorrupt, 0, NULL);
-                mSignalledError = true;
-                return;
-            }
-
-            numBytesRead =
-                AMRDecode(mState,
-                  (Frame_Type_3GPP)((inputPtr[0] >> 3) & 0x0f),
-                  (UWord8 *)&inputPtr[1],
-                  reinterpret_cast<int16_t *>(outHeader->pBuffer),
-                  MIME_IETF);
-
-            if (numBytesRead == -1) {
-                ALOGE("PV AMR decoder AMRDecode() call failed");
-
-                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
-                mSignalledError = true;
-
-                return;
-            }
-
-            ++numBytesRead;  // Include the frame type header byte.
-
-            if (static_cast<size_t>(numBytesRead) > inHeader->nFilledLen) {
-                // This is bad, should never have happened, but did. Abort now.
-
-                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
-                mSignalledError = true;
-
-                return;
-            }
-        } else {
-            if (outHeader->nAllocLen < kNumSamplesPerFrameWB * sizeof(int16_t)) {
-                ALOGE("b/27662364: WB expected output buffer %zu bytes vs %u",
-                       kNumSamplesPerFrameWB * sizeof(int16_t), outHeader->nAllocLen);
-                android_errorWriteLog(0x534e4554, "27662364");
-                notify(OMX_EventError, OMX_ErrorOverflow, 0, NULL);
-                mSignalledError = true;
-                return;
-            }
-
-            int16 mode = ((inputPtr[0] >> 3) & 0x0f);
-
-            if (mode >= 10 && mode <= 13) {
-                ALOGE("encountered illegal frame type %d in AMR WB content.",
-                      mode);
-
-                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
-                mSignalledError = true;
-
-                return;
-            }
-
-            size_t frameSize = getFrameSize(mode);
-            if (inHeader->nFilledLen < frameSize) {
-                ALOGE("b/27662364: expected %zu bytes vs %u", frameSize, inHeader->nFilledLen);
-                notify(OMX_EventError, OMX_ErrorStreamCorrupt, 0, NULL);
-                mSignalledError = true;
-                return;
-            }
-
-            int16_t *outPtr = (int16_t *)outHeader->pBuffer;
-
-            if (mode >= 9) {
-                // Produce silence instead of comfort noise and for
-                // speech lost/no data.
-                memset(outPtr, 0, kNumSamplesPerFrameWB * sizeof(int16_t));
-            } else if (mode < 9) {
-                int16 frameType;
-                RX_State_wb rx_state;
-                mime_unsorting(
-                        const_cast<uint8_t *>(&inputPtr[1]),
-                        mInputSampleBuffer,
-                        &frameType, &mode, 1, &rx_state);
-
-                int16_t numSamplesOutput;
-                pvDecoder_AmrWb(
-                        mode, mInputSampleBuffer,
-                        outPtr,
-                        &numSamplesOutput,
-                        mDecoderBuf, frameType, mDecoderCookie);
-
-                CHECK_EQ((int)numSamplesOutput, (int)kNumSamplesPerFrameWB);
-
-                for (int i = 0; i < kNumSamplesPerFrameWB; ++i) {
-                    /* Delete the 2 LSBs (14-bit output) */
-                    outPtr[i] &= 0xfffC;
-                }
-            }
-
-            numBytesRead = frameSize;
+        if (outHeader->nAllocLen < frameBytes) {
+            ALOGE("b/27662364: %s expected output buffer %zu bytes vs %u",
+                   mMode == MODE_NARROW ? "NB" : "WB", frameBytes, outHeader->nAllocLen);
+            android_errorWriteLog(0x534e4554, "27662364");
+            notify(OMX_EventError, OMX_ErrorOverflow, 0, NULL);
+            mSignalledError = true;
+            return;
         }
 
-        inHeader->nOffset += numBytesRead;
-        inHeader->nFilledLen -= numBytesRead;
-
         outHeader->nFlags = 0;
         outHeader->nOffset = 0;
+        outHeader->nFilledLen = 0;
+        outHeader->nTimeStamp =
+            mAnchorTimeUs + (mNumSamplesOutput * 1000000ll) / sampleRate;
+
+        // Decode all frames of a (packed) input buffer that fit into the output buffer, so
+        // that a buffer of N frames costs one buffer round-trip rather than N.
+        while (inHeader->nFilledLen > 0
+                && outHeader->nFilledLen + frameBytes <= outHeader->nAllocLen) {
+            size_t numBytesRead;
+            if (!decodeFrame(
+                    inHeader->pBuffer + inHeader->nOffset, inHeader->nFilledLen,
+                    reinterpret_cast<int16_t *>(outHeader->pBuffer + outHeader->nFilledLen),
+                    &numBytesRead)) {
+                return;
+            }
 
-        if (mMode == MODE_NARROW) {
-            outHeader->nFilledLen = kNumSamplesPerFrameNB * sizeof(int16_t);
-
-            outHeader->nTimeStamp =
-                mAnchorTimeUs
-                    + (mNumSamplesOutput * 1000000ll) / kSampleRateNB;
-
-            mNumSamplesOutput += kNumSamplesPerFrameNB;
-        } else {
-            outHeader->nFilledLen = kNumSamplesPerFrameWB * sizeof(int16_t);
-
-            outHeader->nTimeStamp =
-                mAnchorTimeUs
-                    + (mNumSamplesOutput * 1000000ll) / kSampleRateWB;
+            inHeader->nOffset += numBytesRead;
+            inHeader->nFilledLen -= numBytesRead;
 
-            mNumSamplesOutput += kNumSamplesPerFrameWB;
+            outHeader->nFilledLen += frameBytes;
+            mNumSamplesOutput += numSamplesPerFrame;
         }
 
         if (inHeader->nFilledLen == 0 && (inHeader->nFlags & OMX_BUFFERFLAG_EOS) == 0) {
@@ -49,6 +49,8 @@ private:
         kSampleRateWB           = 16000,
         kNumSamplesPerFrameNB   = 160,
         kNumSamplesPerFrameWB   = 320,
+        // output buffers hold the frames of packed input buffers of up to 320ms
+        kMaxFramesPerOutputBuffer = 16,
     };
 
     enum {
@@ -77,6 +79,11 @@ private:
 
     void initPorts();
     status_t initDecoder();
+
+    // Decodes the frame at |inputPtr| into a frame of samples at |outPtr|. Signals an error
+    // and returns false if the frame is corrupt.
+    bool decodeFrame(
+            const uint8_t *inputPtr, size_t inputSize, int16_t *outPtr, size_t *numBytesRead);
     bool isConfigured() const;
 
     DISALLOW_EVIL_CONSTRUCTORS(SoftAMR);
@@ -166,11 +166,18 @@ SoftAVC::SoftAVC(
       mSawInputEOS(false),
       mSawOutputEOS(false),
       mSignalledError(false),
-      mCodecCtx(NULL) {
+      mCodecCtx(NULL),
+      mLookahead(0),
+      mPrevGridValid(false),
+      mAvgFrameDiff(0),
+      mFramesSinceIDR(0),
+      mLookaheadBuffer(NULL) {
 
     initPorts(kNumBuffers, kNumBuffers, ((mWidth * mHeight * 3) >> 1),
             MEDIA_MIMETYPE_VIDEO_AVC, 2);
 
+    addInt32VendorExtension("android.lookahead", &mLookahead, 0, kMaxLookahead);
+
     // If dump is enabled, then open create an empty file
     GENERATE_FILE_NAMES();
     CREATE_DUMP_FILE(mInFile);
@@ -917,6 +924,10 @@ OMX_ERRORTYPE SoftAVC::releaseEncoder() {
         }
     }
 
+    free(mLookaheadBuffer);
+    mLookaheadBuffer = NULL;
+    resetLookahead();
+
     // clear other pointers into the space being free()d
     mCodecCtx = NULL;
 
@@ -1145,8 +1156,17 @@ OMX_ERRORTYPE SoftAVC::setConfig(
             return OMX_ErrorNone;
         }
 
+        case OMX_IndexConfigAndroidVendorExtension:
+        {
+            OMX_ERRORTYPE err = SoftVideoEncoderOMXComponent::setConfig(index, _params);
+            if (err == OMX_ErrorNone) {
+                updateLookaheadBufferCount();
+            }
+            return err;
+        }
+
         default:
-            return SimpleSoftOMXComponent::setConfig(index, _params);
+            return SoftVideoEncoderOMXComponent::setConfig(index, _params);
     }
 }
 
@@ -1286,6 +1306,165 @@ OMX_ERRORTYPE SoftAVC::setEncodeArgs(
     return OMX_ErrorNone;
 }
 
+void SoftAVC::updateLookaheadBufferCount() {
+    // The lookahead window is kept in the input queue, so the client must be able to queue
+    // the frames of the window on top of the buffers held by the encoder. The buffer count
+    // cannot change once the buffers are allocated; getLookaheadDepth() clamps the window.
+    OMX_PARAM_PORTDEFINITIONTYPE *def = &editPortInfo(kInputPortIndex)->mDef;
+    if (def->bPopulated) {
+        return;
+    }
+    def->nBufferCountMin = kNumBuffers + mLookahead;
+    if (def->nBufferCountActual < def->nBufferCountMin) {
+        def->nBufferCountActual = def->nBufferCountMin;
+    }
+}
+
+size_t SoftAVC::getLookaheadDepth() {
+    const OMX_PARAM_PORTDEFINITIONTYPE *def = &editPortInfo(kInputPortIndex)->mDef;
+    if (mLookahead <= 0 || def->nBufferCountActual <= kNumBuffers) {
+        return 0;
+    }
+    size_t depth = def->nBufferCountActual - kNumBuffers;
+    return depth < (size_t)mLookahead ? depth : (size_t)mLookahead;
+}
+
+bool SoftAVC::computeLookaheadGrid(const OMX_BUFFERHEADERTYPE *header, uint8_t *grid) {
+    if (header->nFilledLen == 0 || mIvVideoColorFormat == IV_YUV_422ILE
+            || mWidth < 2 * kLookaheadGridSize || mHeight < 2 * kLookaheadGridSize) {
+        return false;
+    }
+
+    const uint8_t *luma = header->pBuffer + header->nOffset;
+    size_t stride = mStride;
+    if (mInputDataIsMeta) {
+        size_t frameSize = mWidth * mHeight * 3 / 2;
+        if (mLookaheadBuffer == NULL) {
+            mLookaheadBuffer = (uint8_t *)malloc(frameSize);
+            if (mLookaheadBuffer == NULL) {
+                ALOGE("Allocating lookahead buffer failed.");
+                return false;
+            }
+        }
+        luma = extractGraphicBuffer(
+                mLookaheadBuffer, frameSize, luma, header->nFilledLen, mWidth, mHeight);
+        if (luma == NULL) {
+            return false;
+        }
+        stride = mWidth;
+    } else if (header->nFilledLen < (size_t)mStride * mHeight) {
+        return false;
+    }
+
+    // Average every other pixel of every other row of each cell.
+    const size_t cellWidth = mWidth / kLookaheadGridSize;
+    const size_t cellHeight = mHeight / kLookaheadGridSize;
+    const uint32_t samplesPerCell = ((cellWidth + 1) / 2) * ((cellHeight + 1) / 2);
+    for (size_t cellY = 0; cellY < kLookaheadGridSize; cellY++) {
+        const uint8_t *cellRow = luma + cellY * cellHeight * stride;
+        for (size_t cellX = 0; cellX < kLookaheadGridSize; cellX++) {
+            uint32_t sum = 0;
+            for (size_t y = 0; y < cellHeight; y += 2) {
+                const uint8_t *src = cellRow + y * stride + cellX * cellWidth;
+                for (size_t x = 0; x < cellWidth; x += 2) {
+                    sum += src[x];
+                }
+            }
+            *grid++ = sum / samplesPerCell;
+        }
+    }
+    return true;
+}
+
+bool SoftAVC::fillLookahead(List<BufferInfo *> &inQueue) {
+    if (!mLookaheadFrames.empty()
+            && (*mLookaheadFrames.begin()).mHeader != (*inQueue.begin())->mHeader) {
+        ALOGW("Lookahead window is out of sync with the input queue");
+        mLookaheadFrames.clear();
+    }
+
+    const size_t depth = getLookaheadDepth();
+    List<BufferInfo *>::iterator it = inQueue.begin();
+    for (size_t i = 0; it != inQueue.end() && i <= depth; ++it, ++i) {
+        OMX_BUFFERHEADERTYPE *header = (*it)->mHeader;
+        if (i >= mLookaheadFrames.size()) {
+            LookaheadFrame frame;
+            frame.mHeader = header;
+            frame.mValid = computeLookaheadGrid(header, frame.mGrid);
+            frame.mFlash = false;
+            mLookaheadFrames.push_back(frame);
+        }
+        if (header->nFlags & OMX_BUFFERFLAG_EOS) {
+            // No frames follow the end of stream.
+            return true;
+        }
+    }
+    return mLookaheadFrames.size() > depth;
+}
+
+// Returns the mean absolute difference of two lookahead grids.
+static uint32_t GetGridDiff(const uint8_t *a, const uint8_t *b, size_t size) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < size; i++) {
+        sum += (a[i] > b[i]) ? (a[i] - b[i]) : (b[i] - a[i]);
+    }
+    return sum / size;
+}
+
+bool SoftAVC::isSceneCut() {
+    LookaheadFrame &frame = *mLookaheadFrames.begin();
+    if (!frame.mValid || !mPrevGridValid) {
+        return false;
+    }
+
+    const size_t gridSize = sizeof(frame.mGrid);
+    uint32_t diff = GetGridDiff(mPrevGrid, frame.mGrid, gridSize);
+    bool cut = diff >= kSceneCutMinDiff
+            && (diff << 4) >= kSceneCutAvgRatio * mAvgFrameDiff
+            && mFramesSinceIDR >= kSceneCutMinDistance;
+
+    if (cut) {
+        // A flash or a short occlusion is followed by frames that are closer to the previous
+        // frame than to this one; those are not worth an IDR.
+        List<LookaheadFrame>::iterator it = mLookaheadFrames.begin();
+        for (++it; it != mLookaheadFrames.end(); ++it) {
+            if ((*it).mValid && GetGridDiff(mPrevGrid, (*it).mGrid, gridSize)
+                    <= GetGridDiff(frame.mGrid, (*it).mGrid, gridSize)) {
+                frame.mFlash = true;
+                return false;
+            }
+        }
+    }
+
+    if (!cut) {
+        mAvgFrameDiff = (mAvgFrameDiff * 7 + (diff << 4)) / 8;
+    }
+    return cut;
+}
+
+void SoftAVC::advanceLookahead() {
+    if (mLookaheadFrames.empty()) {
+        return;
+    }
+    const LookaheadFrame &frame = *mLookaheadFrames.begin();
+    if (!frame.mFlash) {
+        // The frame after a flash is compared to the frame before it, so that it is not
+        // taken for a cut back to the interrupted scene.
+        mPrevGridValid = frame.mValid;
+        if (frame.mValid) {
+            memcpy(mPrevGrid, frame.mGrid, sizeof(mPrevGrid));
+        }
+    }
+    mLookaheadFrames.erase(mLookaheadFrames.begin());
+}
+
+void SoftAVC::resetLookahead() {
+    mLookaheadFrames.clear();
+    mPrevGridValid = false;
+    mAvgFrameDiff = 0;
+    mFramesSinceIDR = 0;
+}
+
 void SoftAVC::onQueueFilled(OMX_U32 portIndex) {
     IV_STATUS_T status;
     WORD32 timeDelay, timeTaken;
@@ -1377,6 +1556,17 @@ void SoftAVC::onQueueFilled(OMX_U32 portIndex) {
             return;
         }
 
+        if ((inputBufferHeader != NULL) && (mLookahead > 0)) {
+            if (!fillLookahead(inQueue)) {
+                // wait for the lookahead window to fill up
+                return;
+            }
+            if (isSceneCut()) {
+                ALOGV("Scene cut at %lld", (long long)inputBufferHeader->nTimeStamp);
+                mUpdateFlag |= kRequestKeyFrame;
+            }
+        }
+
         if (mUpdateFlag) {
             if (mUpdateFlag & kUpdateBitrate) {
                 setBitRate();
@@ -1473,10 +1663,13 @@ void SoftAVC::onQueueFilled(OMX_U32 portIndex) {
 
         if (IV_IDR_FRAME == s_encode_op.u4_encoded_frame_type) {
             outputBufferHeader->nFlags |= OMX_BUFFERFLAG_SYNCFRAME;
+            mFramesSinceIDR = 0;
         }
 
         if (inputBufferHeader != NULL) {
             inQueue.erase(inQueue.begin());
+            advanceLookahead();
+            mFramesSinceIDR++;
 
             /* If in meta data, call EBD on input */
             /* In case of normal mode, EBD will be done once encoder
@@ -1512,6 +1705,14 @@ void SoftAVC::onQueueFilled(OMX_U32 portIndex) {
     return;
 }
 
+void SoftAVC::onPortFlushCompleted(OMX_U32 portIndex) {
+    SoftVideoEncoderOMXComponent::onPortFlushCompleted(portIndex);
+
+    if (portIndex == kInputPortIndex) {
+        resetLookahead();
+    }
+}
+
 void SoftAVC::onReset() {
     SoftVideoEncoderOMXComponent::onReset();
 
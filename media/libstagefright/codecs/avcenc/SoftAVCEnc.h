@@ -19,6 +19,7 @@
 
 
 #include <media/stagefright/foundation/ABase.h>
+#include <utils/List.h>
 #include <utils/Vector.h>
 
 #include "SoftVideoEncoderOMXComponent.h"
@@ -136,6 +137,7 @@ struct SoftAVC : public SoftVideoEncoderOMXComponent {
 protected:
     virtual ~SoftAVC();
 
+    virtual void onPortFlushCompleted(OMX_U32 portIndex);
     virtual void onReset();
 
 private:
@@ -143,6 +145,27 @@ private:
         kNumBuffers = 2,
     };
 
+    enum {
+        // Maximum number of frames that can be analysed ahead of the frame being encoded.
+        kMaxLookahead             = 16,
+        // Frames are analysed as a grid of kLookaheadGridSize^2 average luma values.
+        kLookaheadGridSize        = 32,
+        // A frame is a scene cut if its mean luma grid difference to the previous frame is
+        // at least kSceneCutMinDiff and kSceneCutAvgRatio times the running average.
+        kSceneCutMinDiff          = 12,
+        kSceneCutAvgRatio         = 4,
+        // Minimum distance in frames between an IDR and a scene cut IDR.
+        kSceneCutMinDistance      = 4,
+    };
+
+    // Frame in the lookahead window, in input queue order.
+    struct LookaheadFrame {
+        OMX_BUFFERHEADERTYPE *mHeader;
+        bool mValid;    // mGrid holds the luma grid of the frame
+        bool mFlash;    // the frame differs from the scene it interrupts
+        uint8_t mGrid[kLookaheadGridSize * kLookaheadGridSize];
+    };
+
     enum {
         kUpdateBitrate            = 1 << 0,
         kRequestKeyFrame          = 1 << 1,
@@ -206,6 +229,15 @@ private:
     IVE_AIR_MODE_T mAIRMode;
     UWORD32 mAIRRefreshPeriod;
 
+    // Lookahead scene cut detection; set through the "vendor.android.lookahead.value" key.
+    int32_t mLookahead;                     // requested lookahead window in frames
+    List<LookaheadFrame> mLookaheadFrames;  // analysed frames at the head of the input queue
+    uint8_t mPrevGrid[kLookaheadGridSize * kLookaheadGridSize];
+    bool mPrevGridValid;
+    uint32_t mAvgFrameDiff;                 // running average of frame differences, Q4
+    uint32_t mFramesSinceIDR;
+    uint8_t *mLookaheadBuffer;              // holds extracted frames in metadata mode
+
     void initEncParams();
     OMX_ERRORTYPE initEncoder();
     OMX_ERRORTYPE releaseEncoder();
@@ -253,6 +285,22 @@ private:
         OMX_BUFFERHEADERTYPE *inputBufferHeader,
         OMX_BUFFERHEADERTYPE *outputBufferHeader);
 
+    // Raises the input buffer count so that the lookahead window fits in the input queue.
+    void updateLookaheadBufferCount();
+    // Returns the lookahead window that fits in the input buffers in use.
+    size_t getLookaheadDepth();
+    // Analyses the frames entering the lookahead window. Returns true if the window is full
+    // (or holds the end of stream) and the frame at the head of the input queue can be encoded.
+    bool fillLookahead(List<BufferInfo *> &inQueue);
+    bool computeLookaheadGrid(const OMX_BUFFERHEADERTYPE *header, uint8_t *grid);
+    // Returns true if the frame at the head of the lookahead window starts a new scene. Marks
+    // the frame as a flash if it differs from its neighbours but does not start a new scene.
+    bool isSceneCut();
+    // Drops the frame at the head of the lookahead window once it has been queued for encoding.
+    // Flash frames do not become the reference of the following frame.
+    void advanceLookahead();
+    void resetLookahead();
+
     DISALLOW_EVIL_CONSTRUCTORS(SoftAVC);
 };
 
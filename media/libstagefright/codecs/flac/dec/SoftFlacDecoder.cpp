@@ -48,6 +48,7 @@ SoftFlacDecoder::SoftFlacDecoder(
       mHasStreamInfo(false),
       mInputBufferCount(0),
       mSignalledError(false),
+      mOutputFloat(false),
       mOutputPortSettingsChange(NONE) {
     ALOGV("ctor:");
     memset(&mStreamInfo, 0, sizeof(mStreamInfo));
@@ -86,7 +87,7 @@ void SoftFlacDecoder::initPorts() {
     def.eDir = OMX_DirOutput;
     def.nBufferCountMin = kNumOutputBuffers;
     def.nBufferCountActual = def.nBufferCountMin;
-    def.nBufferSize = 4096 * FLACDecoder::kMaxChannels;
+    def.nBufferSize = 2048 * FLACDecoder::kMaxChannels * sizeof(short);
     def.bEnabled = OMX_TRUE;
     def.bPopulated = OMX_FALSE;
     def.eDomain = OMX_PortDomainAudio;
@@ -169,10 +170,11 @@ OMX_ERRORTYPE SoftFlacDecoder::internalGetParameter(
                 return OMX_ErrorBadPortIndex;
             }
 
-            pcmParams->eNumData = OMX_NumericalDataSigned;
+            pcmParams->eNumData =
+                    mOutputFloat ? OMX_NumericalDataFloat : OMX_NumericalDataSigned;
             pcmParams->eEndian = OMX_EndianBig;
             pcmParams->bInterleaved = OMX_TRUE;
-            pcmParams->nBitPerSample = 16;
+            pcmParams->nBitPerSample = 8 * outputSampleSize();
             pcmParams->ePCMMode = OMX_AUDIO_PCMModeLinear;
             pcmParams->eChannelMapping[0] = OMX_AUDIO_ChannelLF;
             pcmParams->eChannelMapping[1] = OMX_AUDIO_ChannelRF;
@@ -232,6 +234,28 @@ OMX_ERRORTYPE SoftFlacDecoder::internalSetParameter(
                 return OMX_ErrorBadPortIndex;
             }
 
+            // float output is converted straight from the decoded samples, keeping the full
+            // resolution of 24-bit streams
+            if (pcmParams->eNumData == OMX_NumericalDataFloat
+                    && pcmParams->nBitPerSample == 32) {
+                mOutputFloat = true;
+            } else if (pcmParams->eNumData == OMX_NumericalDataSigned
+                    && pcmParams->nBitPerSample == 16) {
+                mOutputFloat = false;
+            } else {
+                ALOGE("internalSetParameter(OMX_IndexParamAudioPcm): unsupported %u-bit %d",
+                        pcmParams->nBitPerSample, pcmParams->eNumData);
+                return OMX_ErrorUnsupportedSetting;
+            }
+            PortInfo *info = editPortInfo(1 /* portIndex */);
+            if (isConfigured()) {
+                info->mDef.nBufferSize =
+                        mStreamInfo.max_blocksize * mStreamInfo.channels * outputSampleSize();
+            } else {
+                info->mDef.nBufferSize =
+                        2048 * FLACDecoder::kMaxChannels * outputSampleSize();
+            }
+
             return OMX_ErrorNone;
         }
 
@@ -299,12 +323,11 @@ void SoftFlacDecoder::onQueueFilled(OMX_U32 /* portIndex */) {
 
         BufferInfo *outInfo = *outQueue.begin();
         OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
-        short *outBuffer =
-                reinterpret_cast<short *>(outHeader->pBuffer + outHeader->nOffset);
+        void *outBuffer = outHeader->pBuffer + outHeader->nOffset;
         size_t outBufferSize = outHeader->nAllocLen - outHeader->nOffset;
 
         status_t decoderErr = mFLACDecoder->decodeOneFrame(
-                inBuffer, inBufferLength, outBuffer, &outBufferSize);
+                inBuffer, inBufferLength, outBuffer, &outBufferSize, mOutputFloat);
         if (decoderErr != OK) {
             ALOGE("onQueueFilled: FLACDecoder decodeOneFrame returns error %d", decoderErr);
             mSignalledError = true;
@@ -372,7 +395,8 @@ void SoftFlacDecoder::onPortEnableCompleted(OMX_U32 portIndex, bool enabled) {
             mOutputPortSettingsChange = AWAITING_ENABLED;
             PortInfo *info = editPortInfo(1 /* portIndex */);
             if (!info->mDef.bEnabled) {
-                info->mDef.nBufferSize = mStreamInfo.max_blocksize * mStreamInfo.channels * 2;
+                info->mDef.nBufferSize =
+                        mStreamInfo.max_blocksize * mStreamInfo.channels * outputSampleSize();
             }
             break;
         }
@@ -55,6 +55,7 @@ private:
     bool mHasStreamInfo;
     size_t mInputBufferCount;
     bool mSignalledError;
+    bool mOutputFloat;  // output float PCM instead of 16-bit PCM
 
     enum {
         NONE,
@@ -67,6 +68,10 @@ private:
     bool isConfigured() const;
     void drainDecoder();
 
+    size_t outputSampleSize() const {
+        return mOutputFloat ? sizeof(float) : sizeof(short);
+    }
+
     DISALLOW_EVIL_CONSTRUCTORS(SoftFlacDecoder);
 };
 
@@ -51,6 +51,7 @@ SoftG711::SoftG711(
     }
 
     initPorts();
+    setBatchedQueueFilled(true);
 }
 
 SoftG711::~SoftG711() {
@@ -36,6 +36,9 @@ static void InitOMXParams(T *params) {
 
 // Microsoft WAV GSM encoding packs two GSM frames into 65 bytes.
 static const int kMSGSMFrameSize = 65;
+// ... which decode to 320 samples at 8kHz.
+static const int kMSGSMSamplesPerFrame = 320;
+static const int kSampleRate = 8000;
 
 SoftGSM::SoftGSM(
         const char *name,
@@ -43,7 +46,9 @@ SoftGSM::SoftGSM(
         OMX_PTR appData,
         OMX_COMPONENTTYPE **component)
     : SimpleSoftOMXComponent(name, callbacks, appData, component),
-      mSignalledError(false) {
+      mSignalledError(false),
+      mAnchorTimeUs(0),
+      mNumSamplesOutput(0) {
 
     CHECK(!strcmp(name, "OMX.google.gsm.decoder"));
 
@@ -53,6 +58,7 @@ SoftGSM::SoftGSM(
     gsm_option(mGsm, GSM_OPT_WAV49, &msopt);
 
     initPorts();
+    setBatchedQueueFilled(true);
 }
 
 SoftGSM::~SoftGSM() {
@@ -67,7 +73,7 @@ void SoftGSM::initPorts() {
     def.eDir = OMX_DirInput;
     def.nBufferCountMin = kNumBuffers;
     def.nBufferCountActual = def.nBufferCountMin;
-    def.nBufferSize = 1024 / kMSGSMFrameSize * kMSGSMFrameSize;
+    def.nBufferSize = kMaxFramesPerBuffer * kMSGSMFrameSize;
     def.bEnabled = OMX_TRUE;
     def.bPopulated = OMX_FALSE;
     def.eDomain = OMX_PortDomainAudio;
@@ -216,39 +222,49 @@ void SoftGSM::onQueueFilled(OMX_U32 /* portIndex */) {
             return;
         }
 
-        if (inHeader->nFilledLen > kMaxNumSamplesPerFrame) {
-            ALOGE("input buffer too large (%d).", inHeader->nFilledLen);
-            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
-            mSignalledError = true;
-        }
-
         if(((inHeader->nFilledLen / kMSGSMFrameSize) * kMSGSMFrameSize) != inHeader->nFilledLen) {
             ALOGE("input buffer not multiple of %d (%d).", kMSGSMFrameSize, inHeader->nFilledLen);
             notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
             mSignalledError = true;
+            return;
         }
 
-        if (outHeader->nAllocLen < (inHeader->nFilledLen / kMSGSMFrameSize) * 320) {
+        // Packed input buffers are decoded into as many output buffers as needed.
+        size_t numFrames = outHeader->nAllocLen / (kMSGSMSamplesPerFrame * sizeof(int16_t));
+        if (numFrames == 0) {
             ALOGE("output buffer is not large enough (%d).", outHeader->nAllocLen);
             android_errorWriteLog(0x534e4554, "27793367");
             notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
             mSignalledError = true;
             return;
         }
+        if (numFrames > inHeader->nFilledLen / kMSGSMFrameSize) {
+            numFrames = inHeader->nFilledLen / kMSGSMFrameSize;
+        }
+
+        if (inHeader->nOffset == 0) {
+            mAnchorTimeUs = inHeader->nTimeStamp;
+            mNumSamplesOutput = 0;
+        }
 
         uint8_t *inputptr = inHeader->pBuffer + inHeader->nOffset;
 
-        int n = mSignalledError ? 0 : DecodeGSM(mGsm,
-                  reinterpret_cast<int16_t *>(outHeader->pBuffer), inputptr, inHeader->nFilledLen);
+        int n = DecodeGSM(mGsm,
+                  reinterpret_cast<int16_t *>(outHeader->pBuffer), inputptr,
+                  numFrames * kMSGSMFrameSize);
 
-        outHeader->nTimeStamp = inHeader->nTimeStamp;
+        outHeader->nTimeStamp =
+            mAnchorTimeUs + (mNumSamplesOutput * 1000000ll) / kSampleRate;
         outHeader->nOffset = 0;
         outHeader->nFilledLen = n * sizeof(int16_t);
         outHeader->nFlags = 0;
 
-        if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
-            inHeader->nFilledLen = 0;
-        } else {
+        mNumSamplesOutput += n;
+        inHeader->nOffset += numFrames * kMSGSMFrameSize;
+        inHeader->nFilledLen -= numFrames * kMSGSMFrameSize;
+
+        // keep the input buffer if it has more frames than fit into the output buffer
+        if (inHeader->nFilledLen == 0 && (inHeader->nFlags & OMX_BUFFERFLAG_EOS) == 0) {
             inInfo->mOwnedByUs = false;
             inQueue.erase(inQueue.begin());
             inInfo = NULL;
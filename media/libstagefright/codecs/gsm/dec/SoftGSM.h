@@ -50,10 +50,14 @@ private:
     enum {
         kNumBuffers = 4,
         kMaxNumSamplesPerFrame = 16384,
+        // input buffers of up to one second of packed frames
+        kMaxFramesPerBuffer = 50,
     };
 
     bool mSignalledError;
     gsm mGsm;
+    int64_t mAnchorTimeUs;
+    int64_t mNumSamplesOutput;
 
     void initPorts();
 
@@ -103,6 +103,12 @@
 #include "idct.h"
 #include "motion_comp.h"
 
+#if defined(PV_DEC_SSE2)
+#include <emmintrin.h>
+#elif defined(PV_DEC_NEON)
+#include <arm_neon.h>
+#endif
+
 #define OSCL_DISABLE_WARNING_CONV_POSSIBLE_LOSS_OF_DATA
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -120,9 +126,15 @@
 ; Function Prototype declaration
 ----------------------------------------------------------------------------*/
 /* private prototypes */
+static void idctcol(int16 *blk);
+#ifndef PV_DEC_SIMD
 static void idctrow(int16 *blk, uint8 *pred, uint8 *dst, int width);
 static void idctrow_intra(int16 *blk, PIXEL *, int width);
-static void idctcol(int16 *blk);
+#elif defined(FAST_IDCT)
+static void idctcol_simd(int16 *blk, uint8 *bitmapcol);
+static void idctrow_simd(int16 *blk, uint8 *pred, uint8 *dst, int width);
+static void idctrow_intra_simd(int16 *blk, PIXEL *comp, int width);
+#endif
 
 #ifdef FAST_IDCT
 // mapping from nz_coefs to functions to be used
@@ -256,7 +268,10 @@ void BlockIDCT_intra(
     int16 *coeff_in = mblock->block[comp];
 #ifdef INTEGER_IDCT
 #ifdef FAST_IDCT  /* VCA IDCT using nzcoefs and bitmaps*/
-    int i, bmapr;
+    int bmapr;
+#ifndef PV_DEC_SIMD
+    int i;
+#endif
     int nz_coefs = mblock->no_coeff[comp];
     uint8 *bitmapcol = mblock->bitmapcol[comp];
     uint8 bitmaprow = mblock->bitmaprow[comp];
@@ -277,6 +292,9 @@ void BlockIDCT_intra(
     }
     else
     {
+#ifdef PV_DEC_SIMD
+        idctcol_simd(coeff_in, bitmapcol);
+#else
         i = 8;
         while (i--)
         {
@@ -293,6 +311,7 @@ void BlockIDCT_intra(
                 }
             }
         }
+#endif
         if ((bitmapcol[4] | bitmapcol[5] | bitmapcol[6] | bitmapcol[7]) == 0)
         {
             bitmaprow >>= 4;
@@ -300,7 +319,11 @@ void BlockIDCT_intra(
         }
         else
         {
+#ifdef PV_DEC_SIMD
+            idctrow_intra_simd(coeff_in, c_comp, width);
+#else
             idctrow_intra(coeff_in, c_comp, width);
+#endif
         }
     }
 #else
@@ -357,7 +380,10 @@ void BlockIDCT(
 {
 #ifdef INTEGER_IDCT
 #ifdef FAST_IDCT  /* VCA IDCT using nzcoefs and bitmaps*/
-    int i, bmapr;
+    int bmapr;
+#ifndef PV_DEC_SIMD
+    int i;
+#endif
     /*----------------------------------------------------------------------------
     ; Function body here
     ----------------------------------------------------------------------------*/
@@ -374,6 +400,9 @@ void BlockIDCT(
     }
     else
     {
+#ifdef PV_DEC_SIMD
+        idctcol_simd(coeff_in, bitmapcol);
+#else
         i = 8;
 
         while (i--)
@@ -391,13 +420,18 @@ void BlockIDCT(
                 }
             }
         }
+#endif
         if ((bitmapcol[4] | bitmapcol[5] | bitmapcol[6] | bitmapcol[7]) == 0)
         {
             (*(idctrowVCA2[bitmaprow>>4]))(coeff_in, pred, dst, width);
         }
         else
         {
+#ifdef PV_DEC_SIMD
+            idctrow_simd(coeff_in, pred, dst, width);
+#else
             idctrow(coeff_in, pred, dst, width);
+#endif
         }
         return ;
     }
@@ -503,6 +537,7 @@ void BlockIDCT(
 ------------------------------------------------------------------------------
 */
 
+#ifndef PV_DEC_SIMD /* replaced by idctrow_simd and idctrow_intra_simd */
 /*----------------------------------------------------------------------------
 ; Function Code FOR idctrow
 ----------------------------------------------------------------------------*/
@@ -737,6 +772,7 @@ void idctrow_intra(
 /*----------------------------------------------------------------------------
 ; End Function: idctrow
 ----------------------------------------------------------------------------*/
+#endif /* !PV_DEC_SIMD */
 
 
 /****************************************************************************/
@@ -909,3 +945,492 @@ void idctcol(
 ;  End Function: idctcol
 ----------------------------------------------------------------------------*/
 
+
+#if defined(FAST_IDCT) && defined(PV_DEC_SIMD)
+/*----------------------------------------------------------------------------
+; SSE2/NEON versions of idctcol, idctrow and idctrow_intra, for the blocks
+; with more than 10 coefficients. Eight columns (or rows, after a transpose)
+; are transformed at once with 32-bit intermediates, using the same integer
+; arithmetic as the C code with the first stage products regrouped, e.g.
+; W7*(x4+x5) + (W1-W7)*x4 == W1*x4 + W7*x5. The results are identical.
+----------------------------------------------------------------------------*/
+#if defined(PV_DEC_SSE2)
+
+/* 181*x, _mm_mullo_epi32 is SSE4.1 */
+static inline __m128i mul181_sse2(__m128i x)
+{
+    __m128i y = _mm_add_epi32(x, _mm_slli_epi32(x, 2));
+    y = _mm_add_epi32(y, _mm_slli_epi32(x, 4));
+    y = _mm_add_epi32(y, _mm_slli_epi32(x, 5));
+    return _mm_add_epi32(y, _mm_slli_epi32(x, 7));
+}
+
+/* 8-point IDCT of v[0..7] (int16), lane by lane. row selects the rounding of */
+/* idctrow (outputs >> 14, saturated) over that of idctcol (outputs >> 8,    */
+/* truncated to 16 bits as the int16 stores of idctcol do).                  */
+static inline void idct8_sse2(__m128i v[8], int row)
+{
+    const __m128i w17 = _mm_set_epi16(W7, W1, W7, W1, W7, W1, W7, W1);
+    const __m128i w71 = _mm_set_epi16(-W1, W7, -W1, W7, -W1, W7, -W1, W7);
+    const __m128i w53 = _mm_set_epi16(W3, W5, W3, W5, W3, W5, W3, W5);
+    const __m128i w35 = _mm_set_epi16(-W5, W3, -W5, W3, -W5, W3, -W5, W3);
+    const __m128i w62 = _mm_set_epi16(-W2, W6, -W2, W6, -W2, W6, -W2, W6);
+    const __m128i w26 = _mm_set_epi16(W6, W2, W6, W2, W6, W2, W6, W2);
+    const __m128i four = _mm_set1_epi32(4);
+    const __m128i r128 = _mm_set1_epi32(128);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, p17, p53, p26;
+    __m128i out[2][8];
+    int h, k;
+
+    for (h = 0; h < 2; h++)
+    {
+        if (h == 0)
+        {
+            p17 = _mm_unpacklo_epi16(v[1], v[7]);
+            p53 = _mm_unpacklo_epi16(v[5], v[3]);
+            p26 = _mm_unpacklo_epi16(v[2], v[6]);
+            x0 = _mm_unpacklo_epi16(zero, v[0]);
+            x1 = _mm_unpacklo_epi16(zero, v[4]);
+        }
+        else
+        {
+            p17 = _mm_unpackhi_epi16(v[1], v[7]);
+            p53 = _mm_unpackhi_epi16(v[5], v[3]);
+            p26 = _mm_unpackhi_epi16(v[2], v[6]);
+            x0 = _mm_unpackhi_epi16(zero, v[0]);
+            x1 = _mm_unpackhi_epi16(zero, v[4]);
+        }
+
+        /* first stage */
+        x4 = _mm_madd_epi16(p17, w17);
+        x5 = _mm_madd_epi16(p17, w71);
+        x6 = _mm_madd_epi16(p53, w53);
+        x7 = _mm_madd_epi16(p53, w35);
+        x2 = _mm_madd_epi16(p26, w62);
+        x3 = _mm_madd_epi16(p26, w26);
+        if (row)
+        {
+            x4 = _mm_srai_epi32(_mm_add_epi32(x4, four), 3);
+            x5 = _mm_srai_epi32(_mm_add_epi32(x5, four), 3);
+            x6 = _mm_srai_epi32(_mm_add_epi32(x6, four), 3);
+            x7 = _mm_srai_epi32(_mm_add_epi32(x7, four), 3);
+            x2 = _mm_srai_epi32(_mm_add_epi32(x2, four), 3);
+            x3 = _mm_srai_epi32(_mm_add_epi32(x3, four), 3);
+            /* (x << 16) >> 8 sign extends and scales by 256 */
+            x0 = _mm_add_epi32(_mm_srai_epi32(x0, 8), _mm_set1_epi32(8192));
+            x1 = _mm_srai_epi32(x1, 8);
+        }
+        else
+        {
+            x0 = _mm_add_epi32(_mm_srai_epi32(x0, 5), r128);
+            x1 = _mm_srai_epi32(x1, 5);
+        }
+
+        /* second stage */
+        x8 = _mm_add_epi32(x0, x1);
+        x0 = _mm_sub_epi32(x0, x1);
+        x1 = _mm_add_epi32(x4, x6);
+        x4 = _mm_sub_epi32(x4, x6);
+        x6 = _mm_add_epi32(x5, x7);
+        x5 = _mm_sub_epi32(x5, x7);
+
+        /* third stage */
+        x7 = _mm_add_epi32(x8, x3);
+        x8 = _mm_sub_epi32(x8, x3);
+        x3 = _mm_add_epi32(x0, x2);
+        x0 = _mm_sub_epi32(x0, x2);
+        x2 = _mm_srai_epi32(_mm_add_epi32(mul181_sse2(_mm_add_epi32(x4, x5)), r128), 8);
+        x4 = _mm_srai_epi32(_mm_add_epi32(mul181_sse2(_mm_sub_epi32(x4, x5)), r128), 8);
+
+        /* fourth stage */
+        out[h][0] = _mm_add_epi32(x7, x1);
+        out[h][1] = _mm_add_epi32(x3, x2);
+        out[h][2] = _mm_add_epi32(x0, x4);
+        out[h][3] = _mm_add_epi32(x8, x6);
+        out[h][4] = _mm_sub_epi32(x8, x6);
+        out[h][5] = _mm_sub_epi32(x0, x4);
+        out[h][6] = _mm_sub_epi32(x3, x2);
+        out[h][7] = _mm_sub_epi32(x7, x1);
+    }
+
+    for (k = 0; k < 8; k++)
+    {
+        if (row)
+        {
+            v[k] = _mm_packs_epi32(_mm_srai_epi32(out[0][k], 14), _mm_srai_epi32(out[1][k], 14));
+        }
+        else
+        {
+            x0 = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(out[0][k], 8), 16), 16);
+            x1 = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(out[1][k], 8), 16), 16);
+            v[k] = _mm_packs_epi32(x0, x1);
+        }
+    }
+}
+
+static inline void transpose8x8_sse2(__m128i v[8])
+{
+    __m128i a0, a1, a2, a3, a4, a5, a6, a7, b0, b1, b2, b3, b4, b5, b6, b7;
+
+    a0 = _mm_unpacklo_epi16(v[0], v[1]);
+    a1 = _mm_unpackhi_epi16(v[0], v[1]);
+    a2 = _mm_unpacklo_epi16(v[2], v[3]);
+    a3 = _mm_unpackhi_epi16(v[2], v[3]);
+    a4 = _mm_unpacklo_epi16(v[4], v[5]);
+    a5 = _mm_unpackhi_epi16(v[4], v[5]);
+    a6 = _mm_unpacklo_epi16(v[6], v[7]);
+    a7 = _mm_unpackhi_epi16(v[6], v[7]);
+
+    b0 = _mm_unpacklo_epi32(a0, a2);
+    b1 = _mm_unpackhi_epi32(a0, a2);
+    b2 = _mm_unpacklo_epi32(a1, a3);
+    b3 = _mm_unpackhi_epi32(a1, a3);
+    b4 = _mm_unpacklo_epi32(a4, a6);
+    b5 = _mm_unpackhi_epi32(a4, a6);
+    b6 = _mm_unpacklo_epi32(a5, a7);
+    b7 = _mm_unpackhi_epi32(a5, a7);
+
+    v[0] = _mm_unpacklo_epi64(b0, b4);
+    v[1] = _mm_unpackhi_epi64(b0, b4);
+    v[2] = _mm_unpacklo_epi64(b1, b5);
+    v[3] = _mm_unpackhi_epi64(b1, b5);
+    v[4] = _mm_unpacklo_epi64(b2, b6);
+    v[5] = _mm_unpackhi_epi64(b2, b6);
+    v[6] = _mm_unpacklo_epi64(b3, b7);
+    v[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+static void idctcol_x8(int16 *blk, uint8 *bitmapcol)
+{
+    __m128i v[8], keep;
+    int16 mask[8];
+    int i, bmapr, special = 0;
+
+    for (i = 0; i < 8; i++)
+    {
+        v[i] = _mm_loadu_si128((const __m128i*)(blk + (i << 3)));
+    }
+    idct8_sse2(v, 0);
+
+    /* columns with only the first 4 coefficients keep their reduced IDCT,  */
+    /* whose rounding differs from idctcol. Empty columns give 0 either way. */
+    for (i = 0; i < 8; i++)
+    {
+        bmapr = (int)bitmapcol[i];
+        mask[i] = 0;
+        if (bmapr && (bmapr&0xf) == 0)
+        {
+            (*(idctcolVCA2[bmapr>>4]))(blk + i);
+            mask[i] = -1;
+            special = 1;
+        }
+    }
+
+    if (special)
+    {
+        keep = _mm_loadu_si128((const __m128i*)mask);
+        for (i = 0; i < 8; i++)
+        {
+            v[i] = _mm_or_si128(_mm_andnot_si128(keep, v[i]),
+                                _mm_and_si128(keep, _mm_loadu_si128((const __m128i*)(blk + (i << 3)))));
+        }
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        _mm_storeu_si128((__m128i*)(blk + (i << 3)), v[i]);
+    }
+}
+
+void idctrow_simd(int16 *blk, uint8 *pred, uint8 *dst, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v[8], p;
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        v[i] = _mm_loadu_si128((const __m128i*)(blk + (i << 3)));
+        _mm_storeu_si128((__m128i*)(blk + (i << 3)), zero);
+    }
+    transpose8x8_sse2(v);
+    idct8_sse2(v, 1);
+    transpose8x8_sse2(v);
+
+    for (i = 0; i < 8; i++)
+    {
+        p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)pred), zero);
+        p = _mm_adds_epi16(v[i], p);
+        _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(p, p));
+        pred += 16;
+        dst += width;
+    }
+}
+
+void idctrow_intra_simd(int16 *blk, PIXEL *comp, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        v[i] = _mm_loadu_si128((const __m128i*)(blk + (i << 3)));
+        _mm_storeu_si128((__m128i*)(blk + (i << 3)), zero);
+    }
+    transpose8x8_sse2(v);
+    idct8_sse2(v, 1);
+    transpose8x8_sse2(v);
+
+    for (i = 0; i < 8; i++)
+    {
+        _mm_storel_epi64((__m128i*)comp, _mm_packus_epi16(v[i], v[i]));
+        comp += width;
+    }
+}
+
+#else /* PV_DEC_NEON */
+
+/* same as idct8_sse2, on NEON */
+static inline void idct8_neon(int16x8_t v[8], int row)
+{
+    int32x4_t x0, x1, x2, x3, x4, x5, x6, x7, x8;
+    int32x4_t out[2][8];
+    int16x4_t r0, r1, r2, r3, r4, r5, r6, r7;
+    int h, k;
+
+    for (h = 0; h < 2; h++)
+    {
+        if (h == 0)
+        {
+            r0 = vget_low_s16(v[0]);
+            r1 = vget_low_s16(v[1]);
+            r2 = vget_low_s16(v[2]);
+            r3 = vget_low_s16(v[3]);
+            r4 = vget_low_s16(v[4]);
+            r5 = vget_low_s16(v[5]);
+            r6 = vget_low_s16(v[6]);
+            r7 = vget_low_s16(v[7]);
+        }
+        else
+        {
+            r0 = vget_high_s16(v[0]);
+            r1 = vget_high_s16(v[1]);
+            r2 = vget_high_s16(v[2]);
+            r3 = vget_high_s16(v[3]);
+            r4 = vget_high_s16(v[4]);
+            r5 = vget_high_s16(v[5]);
+            r6 = vget_high_s16(v[6]);
+            r7 = vget_high_s16(v[7]);
+        }
+
+        /* first stage */
+        x4 = vmlal_n_s16(vmull_n_s16(r1, W1), r7, W7);
+        x5 = vmlsl_n_s16(vmull_n_s16(r1, W7), r7, W1);
+        x6 = vmlal_n_s16(vmull_n_s16(r5, W5), r3, W3);
+        x7 = vmlsl_n_s16(vmull_n_s16(r5, W3), r3, W5);
+        x2 = vmlsl_n_s16(vmull_n_s16(r2, W6), r6, W2);
+        x3 = vmlal_n_s16(vmull_n_s16(r2, W2), r6, W6);
+        if (row)
+        {
+            x4 = vshrq_n_s32(vaddq_s32(x4, vdupq_n_s32(4)), 3);
+            x5 = vshrq_n_s32(vaddq_s32(x5, vdupq_n_s32(4)), 3);
+            x6 = vshrq_n_s32(vaddq_s32(x6, vdupq_n_s32(4)), 3);
+            x7 = vshrq_n_s32(vaddq_s32(x7, vdupq_n_s32(4)), 3);
+            x2 = vshrq_n_s32(vaddq_s32(x2, vdupq_n_s32(4)), 3);
+            x3 = vshrq_n_s32(vaddq_s32(x3, vdupq_n_s32(4)), 3);
+            x0 = vaddq_s32(vshll_n_s16(r0, 8), vdupq_n_s32(8192));
+            x1 = vshll_n_s16(r4, 8);
+        }
+        else
+        {
+            x0 = vaddq_s32(vshll_n_s16(r0, 11), vdupq_n_s32(128));
+            x1 = vshll_n_s16(r4, 11);
+        }
+
+        /* second stage */
+        x8 = vaddq_s32(x0, x1);
+        x0 = vsubq_s32(x0, x1);
+        x1 = vaddq_s32(x4, x6);
+        x4 = vsubq_s32(x4, x6);
+        x6 = vaddq_s32(x5, x7);
+        x5 = vsubq_s32(x5, x7);
+
+        /* third stage */
+        x7 = vaddq_s32(x8, x3);
+        x8 = vsubq_s32(x8, x3);
+        x3 = vaddq_s32(x0, x2);
+        x0 = vsubq_s32(x0, x2);
+        x2 = vshrq_n_s32(vmlaq_n_s32(vdupq_n_s32(128), vaddq_s32(x4, x5), 181), 8);
+        x4 = vshrq_n_s32(vmlaq_n_s32(vdupq_n_s32(128), vsubq_s32(x4, x5), 181), 8);
+
+        /* fourth stage */
+        out[h][0] = vaddq_s32(x7, x1);
+        out[h][1] = vaddq_s32(x3, x2);
+        out[h][2] = vaddq_s32(x0, x4);
+        out[h][3] = vaddq_s32(x8, x6);
+        out[h][4] = vsubq_s32(x8, x6);
+        out[h][5] = vsubq_s32(x0, x4);
+        out[h][6] = vsubq_s32(x3, x2);
+        out[h][7] = vsubq_s32(x7, x1);
+    }
+
+    for (k = 0; k < 8; k++)
+    {
+        if (row)
+        {
+            v[k] = vcombine_s16(vqmovn_s32(vshrq_n_s32(out[0][k], 14)),
+                                vqmovn_s32(vshrq_n_s32(out[1][k], 14)));
+        }
+        else
+        {
+            v[k] = vcombine_s16(vmovn_s32(vshrq_n_s32(out[0][k], 8)),
+                                vmovn_s32(vshrq_n_s32(out[1][k], 8)));
+        }
+    }
+}
+
+static inline void transpose8x8_neon(int16x8_t v[8])
+{
+    int16x8x2_t t0 = vtrnq_s16(v[0], v[1]);
+    int16x8x2_t t1 = vtrnq_s16(v[2], v[3]);
+    int16x8x2_t t2 = vtrnq_s16(v[4], v[5]);
+    int16x8x2_t t3 = vtrnq_s16(v[6], v[7]);
+    int32x4x2_t u0 = vtrnq_s32(vreinterpretq_s32_s16(t0.val[0]), vreinterpretq_s32_s16(t1.val[0]));
+    int32x4x2_t u1 = vtrnq_s32(vreinterpretq_s32_s16(t0.val[1]), vreinterpretq_s32_s16(t1.val[1]));
+    int32x4x2_t u2 = vtrnq_s32(vreinterpretq_s32_s16(t2.val[0]), vreinterpretq_s32_s16(t3.val[0]));
+    int32x4x2_t u3 = vtrnq_s32(vreinterpretq_s32_s16(t2.val[1]), vreinterpretq_s32_s16(t3.val[1]));
+
+    v[0] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u0.val[0]), vget_low_s32(u2.val[0])));
+    v[1] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u1.val[0]), vget_low_s32(u3.val[0])));
+    v[2] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u0.val[1]), vget_low_s32(u2.val[1])));
+    v[3] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u1.val[1]), vget_low_s32(u3.val[1])));
+    v[4] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u0.val[0]), vget_high_s32(u2.val[0])));
+    v[5] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u1.val[0]), vget_high_s32(u3.val[0])));
+    v[6] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u0.val[1]), vget_high_s32(u2.val[1])));
+    v[7] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u1.val[1]), vget_high_s32(u3.val[1])));
+}
+
+static void idctcol_x8(int16 *blk, uint8 *bitmapcol)
+{
+    int16x8_t v[8];
+    uint16x8_t keep;
+    uint16 mask[8];
+    int i, bmapr, special = 0;
+
+    for (i = 0; i < 8; i++)
+    {
+        v[i] = vld1q_s16(blk + (i << 3));
+    }
+    idct8_neon(v, 0);
+
+    /* columns with only the first 4 coefficients keep their reduced IDCT,  */
+    /* whose rounding differs from idctcol. Empty columns give 0 either way. */
+    for (i = 0; i < 8; i++)
+    {
+        bmapr = (int)bitmapcol[i];
+        mask[i] = 0;
+        if (bmapr && (bmapr&0xf) == 0)
+        {
+            (*(idctcolVCA2[bmapr>>4]))(blk + i);
+            mask[i] = 0xFFFF;
+            special = 1;
+        }
+    }
+
+    if (special)
+    {
+        keep = vld1q_u16(mask);
+        for (i = 0; i < 8; i++)
+        {
+            v[i] = vbslq_s16(keep, vld1q_s16(blk + (i << 3)), v[i]);
+        }
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        vst1q_s16(blk + (i << 3), v[i]);
+    }
+}
+
+void idctrow_simd(int16 *blk, uint8 *pred, uint8 *dst, int width)
+{
+    int16x8_t v[8], p;
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        v[i] = vld1q_s16(blk + (i << 3));
+        vst1q_s16(blk + (i << 3), vdupq_n_s16(0));
+    }
+    transpose8x8_neon(v);
+    idct8_neon(v, 1);
+    transpose8x8_neon(v);
+
+    for (i = 0; i < 8; i++)
+    {
+        p = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pred)));
+        vst1_u8(dst, vqmovun_s16(vqaddq_s16(v[i], p)));
+        pred += 16;
+        dst += width;
+    }
+}
+
+void idctrow_intra_simd(int16 *blk, PIXEL *comp, int width)
+{
+    int16x8_t v[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        v[i] = vld1q_s16(blk + (i << 3));
+        vst1q_s16(blk + (i << 3), vdupq_n_s16(0));
+    }
+    transpose8x8_neon(v);
+    idct8_neon(v, 1);
+    transpose8x8_neon(v);
+
+    for (i = 0; i < 8; i++)
+    {
+        vst1_u8(comp, vqmovun_s16(v[i]));
+        comp += width;
+    }
+}
+
+#endif /* PV_DEC_SSE2 */
+
+void idctcol_simd(int16 *blk, uint8 *bitmapcol)
+{
+    int i, bmapr, full = 0;
+
+    /* transforming all 8 columns only pays off if most need idctcol */
+    for (i = 0; i < 8; i++)
+    {
+        bmapr = (int)bitmapcol[i];
+        full += (bmapr & 0xf) != 0;
+    }
+
+    if (full >= 4)
+    {
+        idctcol_x8(blk, bitmapcol);
+        return;
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        bmapr = (int)bitmapcol[i];
+        if (bmapr)
+        {
+            if ((bmapr&0xf) == 0)
+            {
+                (*(idctcolVCA2[bmapr>>4]))(blk + i);
+            }
+            else
+            {
+                idctcol(blk + i);
+            }
+        }
+    }
+}
+#endif /* FAST_IDCT && PV_DEC_SIMD */
@@ -77,6 +77,12 @@
 #include "mp4dec_lib.h"
 #include "motion_comp.h"
 
+#if defined(PV_DEC_SSE2)
+#include <emmintrin.h>
+#elif defined(PV_DEC_NEON)
+#include <arm_neon.h>
+#endif
+
 #define OSCL_DISABLE_WARNING_CONV_POSSIBLE_LOSS_OF_DATA
 
 int GetPredAdvancedBy0x0(
@@ -1187,4 +1193,164 @@ int GetPredAdvancedBy1x1(
     }
 }
 
+#ifdef PV_DEC_SIMD
+/**************************************************************************/
+/*  SSE2/NEON versions of the above. Rows of the 8x8 block are handled as  */
+/*  a whole, so no alignment cases are needed. Only the 9x9 pixels used   */
+/*  by the prediction are read, where the C versions may read up to 3     */
+/*  bytes on either side of them. The results are identical: a half-pel  */
+/*  sample is (a + b + rnd1) >> 1 and a quarter one                      */
+/*  (a + b + c + d + rnd1 + 1) >> 2, with rnd1 = pred_width_rnd & 1.      */
+/**************************************************************************/
+int GetPredAdvancedBy0x0_SIMD(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    int i;
+    int pred_width = pred_width_rnd >> 1;
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+#if defined(PV_DEC_SSE2)
+        _mm_storel_epi64((__m128i*)pred_block, _mm_loadl_epi64((const __m128i*)prev));
+#else
+        vst1_u8(pred_block, vld1_u8(prev));
+#endif
+        prev += width;
+        pred_block += pred_width;
+    }
+
+    return 1;
+}
+
+int GetPredAdvancedBy0x1_SIMD(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    int i;
+    int pred_width = pred_width_rnd >> 1;
+    int rnd1 = pred_width_rnd & 1;
+
+#if defined(PV_DEC_SSE2)
+    /* _mm_avg_epu8 rounds up, remove the carried bit when rnd1 == 0 */
+    const __m128i lsb = _mm_set1_epi8(rnd1 ? 0 : 1);
+    __m128i a, b;
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        a = _mm_loadl_epi64((const __m128i*)prev);
+        b = _mm_loadl_epi64((const __m128i*)(prev + 1));
+        a = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), lsb));
+        _mm_storel_epi64((__m128i*)pred_block, a);
+        prev += width;
+        pred_block += pred_width;
+    }
+#else
+    uint8x8_t a, b;
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        a = vld1_u8(prev);
+        b = vld1_u8(prev + 1);
+        vst1_u8(pred_block, rnd1 ? vrhadd_u8(a, b) : vhadd_u8(a, b));
+        prev += width;
+        pred_block += pred_width;
+    }
+#endif
+
+    return 1;
+}
 
+int GetPredAdvancedBy1x0_SIMD(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    int i;
+    int pred_width = pred_width_rnd >> 1;
+    int rnd1 = pred_width_rnd & 1;
+
+#if defined(PV_DEC_SSE2)
+    const __m128i lsb = _mm_set1_epi8(rnd1 ? 0 : 1);
+    __m128i a, b, c;
+
+    a = _mm_loadl_epi64((const __m128i*)prev);
+    for (i = B_SIZE; i > 0; i--)
+    {
+        b = _mm_loadl_epi64((const __m128i*)(prev += width));
+        c = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), lsb));
+        _mm_storel_epi64((__m128i*)pred_block, c);
+        a = b;
+        pred_block += pred_width;
+    }
+#else
+    uint8x8_t a, b;
+
+    a = vld1_u8(prev);
+    for (i = B_SIZE; i > 0; i--)
+    {
+        b = vld1_u8(prev += width);
+        vst1_u8(pred_block, rnd1 ? vrhadd_u8(a, b) : vhadd_u8(a, b));
+        a = b;
+        pred_block += pred_width;
+    }
+#endif
+
+    return 1;
+}
+
+int GetPredAdvancedBy1x1_SIMD(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    int i;
+    int pred_width = pred_width_rnd >> 1;
+    int rnd2 = (pred_width_rnd & 1) + 1;
+
+    /* horizontal pair sums of a row are reused for the next output row */
+#if defined(PV_DEC_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rnd = _mm_set1_epi16(rnd2);
+    __m128i s0, s1, out;
+
+    s0 = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)prev), zero),
+                       _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(prev + 1)), zero));
+    for (i = B_SIZE; i > 0; i--)
+    {
+        prev += width;
+        s1 = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)prev), zero),
+                           _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(prev + 1)), zero));
+        out = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(s0, s1), rnd), 2);
+        _mm_storel_epi64((__m128i*)pred_block, _mm_packus_epi16(out, out));
+        s0 = s1;
+        pred_block += pred_width;
+    }
+#else
+    const uint16x8_t rnd = vdupq_n_u16(rnd2);
+    uint16x8_t s0, s1;
+
+    s0 = vaddl_u8(vld1_u8(prev), vld1_u8(prev + 1));
+    for (i = B_SIZE; i > 0; i--)
+    {
+        prev += width;
+        s1 = vaddl_u8(vld1_u8(prev), vld1_u8(prev + 1));
+        vst1_u8(pred_block, vshrn_n_u16(vaddq_u16(vaddq_u16(s0, s1), rnd), 2));
+        s0 = s1;
+        pred_block += pred_width;
+    }
+#endif
+
+    return 1;
+}
+#endif /* PV_DEC_SIMD */
@@ -74,8 +74,13 @@ extern "C"
 
     static int (*const GetPredAdvBTable[2][2])(uint8*, uint8*, int, int) =
     {
+#ifdef PV_DEC_SIMD
+        {&GetPredAdvancedBy0x0_SIMD, &GetPredAdvancedBy0x1_SIMD},
+        {&GetPredAdvancedBy1x0_SIMD, &GetPredAdvancedBy1x1_SIMD}
+#else
         {&GetPredAdvancedBy0x0, &GetPredAdvancedBy0x1},
         {&GetPredAdvancedBy1x0, &GetPredAdvancedBy1x1}
+#endif
     };
 
     /*----------------------------------------------------------------------------
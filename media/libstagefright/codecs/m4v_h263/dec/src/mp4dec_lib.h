@@ -242,6 +242,13 @@ extern "C"
         int pred_width_rnd /* i */
     );
 
+#ifdef PV_DEC_SIMD
+    int GetPredAdvancedBy0x0_SIMD(uint8 *c_prev, uint8 *pred_block, int width, int pred_width_rnd);
+    int GetPredAdvancedBy0x1_SIMD(uint8 *c_prev, uint8 *pred_block, int width, int pred_width_rnd);
+    int GetPredAdvancedBy1x0_SIMD(uint8 *c_prev, uint8 *pred_block, int width, int pred_width_rnd);
+    int GetPredAdvancedBy1x1_SIMD(uint8 *c_prev, uint8 *pred_block, int width, int pred_width_rnd);
+#endif
+
     /*--------------------------------------------------------------------------*/
     /* defined in get_pred_outside.c */
     int GetPredOutside(
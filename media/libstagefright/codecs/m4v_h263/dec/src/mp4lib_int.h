@@ -27,6 +27,18 @@
 #define FAST_IDCT            /* , for fast Variable complexity IDCT */
 //#define PV_DEC_EXTERNAL_IDCT  /*  for separate IDCT (i.e. no direct access to output frame) */
 #define PV_ANNEX_IJKT_SUPPORT
+
+/* SSE2/NEON motion compensation, IDCT and deblocking, bit-exact with the C code. */
+/* Both are part of the ABI on the targets that have them; define PV_DEC_NO_SIMD  */
+/* to build the C versions only.                                                 */
+#if !defined(PV_DEC_NO_SIMD) && defined(__SSE2__)
+#define PV_DEC_SSE2
+#elif !defined(PV_DEC_NO_SIMD) && (defined(__ARM_NEON__) || defined(__aarch64__))
+#define PV_DEC_NEON
+#endif
+#if defined(PV_DEC_SSE2) || defined(PV_DEC_NEON)
+#define PV_DEC_SIMD
+#endif
 #define mid_gray 1024
 
 typedef struct tagBitstream
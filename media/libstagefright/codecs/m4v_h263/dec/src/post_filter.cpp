@@ -21,6 +21,11 @@
 #ifdef PV_ANNEX_IJKT_SUPPORT
 #include    "motion_comp.h"
 #include "mbtype_mode.h"
+#if defined(PV_DEC_SSE2)
+#include <emmintrin.h>
+#elif defined(PV_DEC_NEON)
+#include <arm_neon.h>
+#endif
 const static int STRENGTH_tab[] = {0, 1, 1, 2, 2, 3, 3, 4, 4, 4, 5, 5, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 10, 11, 11, 11, 12, 12, 12};
 #endif
 
@@ -173,6 +178,269 @@ void PostFilter(
 
 
 #ifdef PV_ANNEX_IJKT_SUPPORT
+/* Annex J filter of one pixel position across an edge: C = rec[0] is the first */
+/* pixel after the edge, B, A before it and D after it, step bytes apart.       */
+static inline void H263_FilterPel(uint8 *rec, int step, int strength)
+{
+    int tmpvar;
+    int A_D, d1_2, d1, d2, A, B, C, D, d;
+
+    A =  *(rec - (step << 1));
+    D = *(rec + step);
+    A_D = A - D;
+    C = *rec;
+    B = *(rec - step);
+    d = (((C - B) << 2) + A_D);
+
+    if (d < 0)
+    {
+        d1 = -(-d >> 3);
+        if (d1 < -(strength << 1))
+        {
+            d1 = 0;
+        }
+        else if (d1 < -strength)
+        {
+            d1 = -d1 - (strength << 1);
+        }
+        d1_2 = -d1 >> 1;
+    }
+    else
+    {
+        d1 = d >> 3;
+        if (d1 > (strength << 1))
+        {
+            d1 = 0;
+        }
+        else if (d1 > strength)
+        {
+            d1 = (strength << 1) - d1;
+        }
+        d1_2 = d1 >> 1;
+    }
+
+    if (A_D < 0)
+    {
+        d2 = -(-A_D >> 2);
+        if (d2 < -d1_2)
+        {
+            d2 = -d1_2;
+        }
+    }
+    else
+    {
+        d2 = A_D >> 2;
+        if (d2 > d1_2)
+        {
+            d2 = d1_2;
+        }
+    }
+
+    *(rec - (step << 1)) = A - d2;
+    tmpvar = B + d1;
+    CLIP_RESULT(tmpvar)
+    *(rec - step) = tmpvar;
+    tmpvar = C - d1;
+    CLIP_RESULT(tmpvar)
+    *rec = tmpvar;
+    *(rec + step) = D + d2;
+}
+
+#if defined(PV_DEC_SSE2)
+/* H263_FilterPel on 8 positions, as 16-bit lanes. With m = |d| >> 3 the        */
+/* strength limiting gives |d1| = max(0, m - 2 * max(0, m - strength)). A and D */
+/* wrap around as in the C code, B and C are clipped.                          */
+static inline void H263_FilterPel8(__m128i *A, __m128i *B, __m128i *C, __m128i *D, __m128i strength)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i A_D, d, sign, m, d1, d1_2, d2;
+
+    A_D = _mm_sub_epi16(*A, *D);
+    d = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(*C, *B), 2), A_D);
+
+    sign = _mm_srai_epi16(d, 15);
+    m = _mm_srli_epi16(_mm_sub_epi16(_mm_xor_si128(d, sign), sign), 3);
+    d1 = _mm_max_epi16(_mm_sub_epi16(m, strength), zero);
+    d1 = _mm_max_epi16(_mm_sub_epi16(m, _mm_add_epi16(d1, d1)), zero);
+    d1_2 = _mm_srli_epi16(d1, 1);
+    d1 = _mm_sub_epi16(_mm_xor_si128(d1, sign), sign);
+
+    sign = _mm_srai_epi16(A_D, 15);
+    d2 = _mm_srli_epi16(_mm_sub_epi16(_mm_xor_si128(A_D, sign), sign), 2);
+    d2 = _mm_min_epi16(d2, d1_2);
+    d2 = _mm_sub_epi16(_mm_xor_si128(d2, sign), sign);
+
+    *A = _mm_and_si128(_mm_sub_epi16(*A, d2), _mm_set1_epi16(0xFF));
+    *B = _mm_add_epi16(*B, d1);
+    *C = _mm_sub_epi16(*C, d1);
+    *D = _mm_and_si128(_mm_add_epi16(*D, d2), _mm_set1_epi16(0xFF));
+}
+#elif defined(PV_DEC_NEON)
+/* same as the SSE2 version */
+static inline void H263_FilterPel8(int16x8_t *A, int16x8_t *B, int16x8_t *C, int16x8_t *D, int16x8_t strength)
+{
+    const int16x8_t zero = vdupq_n_s16(0);
+    int16x8_t A_D, d, sign, m, d1, d1_2, d2;
+
+    A_D = vsubq_s16(*A, *D);
+    d = vaddq_s16(vshlq_n_s16(vsubq_s16(*C, *B), 2), A_D);
+
+    sign = vshrq_n_s16(d, 15);
+    m = vshrq_n_s16(vabsq_s16(d), 3);
+    d1 = vmaxq_s16(vsubq_s16(m, strength), zero);
+    d1 = vmaxq_s16(vsubq_s16(m, vaddq_s16(d1, d1)), zero);
+    d1_2 = vshrq_n_s16(d1, 1);
+    d1 = vsubq_s16(veorq_s16(d1, sign), sign);
+
+    sign = vshrq_n_s16(A_D, 15);
+    d2 = vminq_s16(vshrq_n_s16(vabsq_s16(A_D), 2), d1_2);
+    d2 = vsubq_s16(veorq_s16(d2, sign), sign);
+
+    *A = vandq_s16(vsubq_s16(*A, d2), vdupq_n_s16(0xFF));
+    *B = vaddq_s16(*B, d1);
+    *C = vsubq_s16(*C, d1);
+    *D = vandq_s16(vaddq_s16(*D, d2), vdupq_n_s16(0xFF));
+}
+#endif
+
+/* VERTICAL FILTERING of n pixels across the horizontal edge above rec */
+static void H263_FilterVertical(uint8 *rec, int width, int strength, int n)
+{
+#if defined(PV_DEC_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i str = _mm_set1_epi16(strength);
+    __m128i A, B, C, D;
+
+    for (; n > 0; n -= 8, rec += 8)
+    {
+        A = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rec - (width << 1))), zero);
+        B = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rec - width)), zero);
+        C = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)rec), zero);
+        D = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rec + width)), zero);
+        H263_FilterPel8(&A, &B, &C, &D, str);
+        _mm_storel_epi64((__m128i*)(rec - (width << 1)), _mm_packus_epi16(A, A));
+        _mm_storel_epi64((__m128i*)(rec - width), _mm_packus_epi16(B, B));
+        _mm_storel_epi64((__m128i*)rec, _mm_packus_epi16(C, C));
+        _mm_storel_epi64((__m128i*)(rec + width), _mm_packus_epi16(D, D));
+    }
+#elif defined(PV_DEC_NEON)
+    const int16x8_t str = vdupq_n_s16(strength);
+    int16x8_t A, B, C, D;
+
+    for (; n > 0; n -= 8, rec += 8)
+    {
+        A = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rec - (width << 1))));
+        B = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rec - width)));
+        C = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rec)));
+        D = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rec + width)));
+        H263_FilterPel8(&A, &B, &C, &D, str);
+        vst1_u8(rec - (width << 1), vqmovun_s16(A));
+        vst1_u8(rec - width, vqmovun_s16(B));
+        vst1_u8(rec, vqmovun_s16(C));
+        vst1_u8(rec + width, vqmovun_s16(D));
+    }
+#else
+    while (n--)
+    {
+        H263_FilterPel(rec++, width, strength);
+    }
+#endif
+}
+
+/* HORIZONTAL FILTERING of n rows across the vertical edge left of rec */
+static void H263_FilterHorizontal(uint8 *rec, int width, int strength, int n)
+{
+#if defined(PV_DEC_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i str = _mm_set1_epi16(strength);
+    __m128i r[8], AB, CD, A, B, C, D;
+    int32 word;
+    int k;
+
+    for (; n > 0; n -= 8)
+    {
+        /* gather A B C D of 8 rows and transpose them to one vector each */
+        for (k = 0; k < 8; k++)
+        {
+            oscl_memcpy(&word, rec - 2 + k * width, 4);
+            r[k] = _mm_cvtsi32_si128(word);
+        }
+        r[0] = _mm_unpacklo_epi16(_mm_unpacklo_epi8(r[0], r[1]), _mm_unpacklo_epi8(r[2], r[3]));
+        r[4] = _mm_unpacklo_epi16(_mm_unpacklo_epi8(r[4], r[5]), _mm_unpacklo_epi8(r[6], r[7]));
+        AB = _mm_unpacklo_epi32(r[0], r[4]);
+        CD = _mm_unpackhi_epi32(r[0], r[4]);
+        A = _mm_unpacklo_epi8(AB, zero);
+        B = _mm_unpackhi_epi8(AB, zero);
+        C = _mm_unpacklo_epi8(CD, zero);
+        D = _mm_unpackhi_epi8(CD, zero);
+
+        H263_FilterPel8(&A, &B, &C, &D, str);
+
+        AB = _mm_packus_epi16(A, B);
+        CD = _mm_packus_epi16(C, D);
+        /* A0 C0 A1 C1 .., B0 D0 B1 D1 .. -> A0 B0 C0 D0 A1 B1 C1 D1 .. */
+        A = _mm_unpacklo_epi8(AB, CD);
+        B = _mm_unpacklo_epi8(_mm_srli_si128(AB, 8), _mm_srli_si128(CD, 8));
+        r[0] = _mm_unpacklo_epi8(A, B);
+        r[4] = _mm_unpackhi_epi8(A, B);
+        for (k = 0; k < 4; k++)
+        {
+            word = _mm_cvtsi128_si32(r[0]);
+            oscl_memcpy(rec - 2 + k * width, &word, 4);
+            word = _mm_cvtsi128_si32(r[4]);
+            oscl_memcpy(rec - 2 + (k + 4) * width, &word, 4);
+            r[0] = _mm_srli_si128(r[0], 4);
+            r[4] = _mm_srli_si128(r[4], 4);
+        }
+        rec += (width << 3);
+    }
+#elif defined(PV_DEC_NEON)
+    const int16x8_t str = vdupq_n_s16(strength);
+    uint8x8x4_t pel;
+    int16x8_t A, B, C, D;
+
+    pel.val[0] = pel.val[1] = pel.val[2] = pel.val[3] = vdup_n_u8(0);
+    for (; n > 0; n -= 8)
+    {
+        /* vld4 lane loads de-interleave A B C D of each row */
+        pel = vld4_lane_u8(rec - 2, pel, 0);
+        pel = vld4_lane_u8(rec - 2 + width, pel, 1);
+        pel = vld4_lane_u8(rec - 2 + 2 * width, pel, 2);
+        pel = vld4_lane_u8(rec - 2 + 3 * width, pel, 3);
+        pel = vld4_lane_u8(rec - 2 + 4 * width, pel, 4);
+        pel = vld4_lane_u8(rec - 2 + 5 * width, pel, 5);
+        pel = vld4_lane_u8(rec - 2 + 6 * width, pel, 6);
+        pel = vld4_lane_u8(rec - 2 + 7 * width, pel, 7);
+        A = vreinterpretq_s16_u16(vmovl_u8(pel.val[0]));
+        B = vreinterpretq_s16_u16(vmovl_u8(pel.val[1]));
+        C = vreinterpretq_s16_u16(vmovl_u8(pel.val[2]));
+        D = vreinterpretq_s16_u16(vmovl_u8(pel.val[3]));
+
+        H263_FilterPel8(&A, &B, &C, &D, str);
+
+        pel.val[0] = vqmovun_s16(A);
+        pel.val[1] = vqmovun_s16(B);
+        pel.val[2] = vqmovun_s16(C);
+        pel.val[3] = vqmovun_s16(D);
+        vst4_lane_u8(rec - 2, pel, 0);
+        vst4_lane_u8(rec - 2 + width, pel, 1);
+        vst4_lane_u8(rec - 2 + 2 * width, pel, 2);
+        vst4_lane_u8(rec - 2 + 3 * width, pel, 3);
+        vst4_lane_u8(rec - 2 + 4 * width, pel, 4);
+        vst4_lane_u8(rec - 2 + 5 * width, pel, 5);
+        vst4_lane_u8(rec - 2 + 6 * width, pel, 6);
+        vst4_lane_u8(rec - 2 + 7 * width, pel, 7);
+        rec += (width << 3);
+    }
+#else
+    while (n--)
+    {
+        H263_FilterPel(rec, 1, strength);
+        rec += width;
+    }
+#endif
+}
+
 void H263_Deblock(uint8 *rec,
                   int width,
                   int height,
@@ -183,11 +451,10 @@ void H263_Deblock(uint8 *rec,
     /*----------------------------------------------------------------------------
     ; Define all local variables
     ----------------------------------------------------------------------------*/
-    int i, j, k;
+    int i, j;
     uint8 *rec_y;
-    int tmpvar;
-    int mbnum, strength, A_D, d1_2, d1, d2, A, B, C, D, b_size;
-    int d, offset, nMBPerRow, nMBPerCol, width2 = (width << 1);
+    int mbnum, strength, b_size;
+    int nMBPerRow, nMBPerCol;
     /* MAKE SURE I-VOP INTRA MACROBLOCKS ARE SET TO NON-SKIPPED MODE*/
     mbnum = 0;
 
@@ -216,76 +483,10 @@ void H263_Deblock(uint8 *rec,
             {
                 if (mode[mbnum] != MODE_SKIPPED)
                 {
-                    k = 16;
                     strength = STRENGTH_tab[QP_store[mbnum]];
-                    while (k--)
-                    {
-                        A =  *(rec_y - width2);
-                        D = *(rec_y + width);
-                        A_D = A - D;
-                        C = *rec_y;
-                        B = *(rec_y - width);
-                        d = (((C - B) << 2) + A_D);
-
-                        if (d < 0)
-                        {
-                            d1 = -(-d >> 3);
-                            if (d1 < -(strength << 1))
-                            {
-                                d1 = 0;
-                            }
-                            else if (d1 < -strength)
-                            {
-                                d1 = -d1 - (strength << 1);
-                            }
-                            d1_2 = -d1 >> 1;
-                        }
-                        else
-                        {
-                            d1 = d >> 3;
-                            if (d1 > (strength << 1))
-                            {
-                                d1 = 0;
-                            }
-                            else if (d1 > strength)
-                            {
-                                d1 = (strength << 1) - d1;
-                            }
-                            d1_2 = d1 >> 1;
-                        }
-
-                        if (A_D < 0)
-                        {
-                            d2 = -(-A_D >> 2);
-                            if (d2 < -d1_2)
-                            {
-                                d2 = -d1_2;
-                            }
-                        }
-                        else
-                        {
-                            d2 = A_D >> 2;
-                            if (d2 > d1_2)
-                            {
-                                d2 = d1_2;
-                            }
-                        }
-
-                        *(rec_y - width2) = A - d2;
-                        tmpvar = B + d1;
-                        CLIP_RESULT(tmpvar)
-                        *(rec_y - width) = tmpvar;
-                        tmpvar = C - d1;
-                        CLIP_RESULT(tmpvar)
-                        *rec_y = tmpvar;
-                        *(rec_y + width) = D + d2;
-                        rec_y++;
-                    }
-                }
-                else
-                {
-                    rec_y += b_size;
+                    H263_FilterVertical(rec_y, width, strength, 16);
                 }
+                rec_y += b_size;
                 mbnum++;
             }
             rec_y += (15 * width);
@@ -305,7 +506,6 @@ void H263_Deblock(uint8 *rec,
         {
             if (mode[mbnum] != MODE_SKIPPED || mode[mbnum - nMBPerRow] != MODE_SKIPPED)
             {
-                k = b_size;
                 if (mode[mbnum] != MODE_SKIPPED)
                 {
                     strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum]] : QP_store[mbnum])];
@@ -315,74 +515,9 @@ void H263_Deblock(uint8 *rec,
                     strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum - nMBPerRow]] : QP_store[mbnum - nMBPerRow])];
                 }
 
-                while (k--)
-                {
-                    A =  *(rec_y - width2);
-                    D =  *(rec_y + width);
-                    A_D = A - D;
-                    C = *rec_y;
-                    B = *(rec_y - width);
-                    d = (((C - B) << 2) + A_D);
-
-                    if (d < 0)
-                    {
-                        d1 = -(-d >> 3);
-                        if (d1 < -(strength << 1))
-                        {
-                            d1 = 0;
-                        }
-                        else if (d1 < -strength)
-                        {
-                            d1 = -d1 - (strength << 1);
-                        }
-                        d1_2 = -d1 >> 1;
-                    }
-                    else
-                    {
-                        d1 = d >> 3;
-                        if (d1 > (strength << 1))
-                        {
-                            d1 = 0;
-                        }
-                        else if (d1 > strength)
-                        {
-                            d1 = (strength << 1) - d1;
-                        }
-                        d1_2 = d1 >> 1;
-                    }
-
-                    if (A_D < 0)
-                    {
-                        d2 = -(-A_D >> 2);
-                        if (d2 < -d1_2)
-                        {
-                            d2 = -d1_2;
-                        }
-                    }
-                    else
-                    {
-                        d2 = A_D >> 2;
-                        if (d2 > d1_2)
-                        {
-                            d2 = d1_2;
-                        }
-                    }
-
-                    *(rec_y - width2) = A - d2;
-                    tmpvar = B + d1;
-                    CLIP_RESULT(tmpvar)
-                    *(rec_y - width) = tmpvar;
-                    tmpvar = C - d1;
-                    CLIP_RESULT(tmpvar)
-                    *rec_y = tmpvar;
-                    *(rec_y + width) = D + d2;
-                    rec_y++;
-                }
-            }
-            else
-            {
-                rec_y += b_size;
+                H263_FilterVertical(rec_y, width, strength, b_size);
             }
+            rec_y += b_size;
             mbnum++;
         }
         rec_y += ((b_size - 1) * width);
@@ -396,7 +531,6 @@ void H263_Deblock(uint8 *rec,
     if (!chr)
     {
         rec_y = rec + 8;
-        offset = width * b_size - b_size;
 
         for (i = 0; i < nMBPerCol; i++)
         {
@@ -404,77 +538,10 @@ void H263_Deblock(uint8 *rec,
             {
                 if (mode[mbnum] != MODE_SKIPPED)
                 {
-                    k = 16;
                     strength = STRENGTH_tab[QP_store[mbnum]];
-                    while (k--)
-                    {
-                        A =  *(rec_y - 2);
-                        D =  *(rec_y + 1);
-                        A_D = A - D;
-                        C = *rec_y;
-                        B = *(rec_y - 1);
-                        d = (((C - B) << 2) + A_D);
-
-                        if (d < 0)
-                        {
-                            d1 = -(-d >> 3);
-                            if (d1 < -(strength << 1))
-                            {
-                                d1 = 0;
-                            }
-                            else if (d1 < -strength)
-                            {
-                                d1 = -d1 - (strength << 1);
-                            }
-                            d1_2 = -d1 >> 1;
-                        }
-                        else
-                        {
-                            d1 = d >> 3;
-                            if (d1 > (strength << 1))
-                            {
-                                d1 = 0;
-                            }
-                            else if (d1 > strength)
-                            {
-                                d1 = (strength << 1) - d1;
-                            }
-                            d1_2 = d1 >> 1;
-                        }
-
-                        if (A_D < 0)
-                        {
-                            d2 = -(-A_D >> 2);
-                            if (d2 < -d1_2)
-                            {
-                                d2 = -d1_2;
-                            }
-                        }
-                        else
-                        {
-                            d2 = A_D >> 2;
-                            if (d2 > d1_2)
-                            {
-                                d2 = d1_2;
-                            }
-                        }
-
-                        *(rec_y - 2) = A - d2;
-                        tmpvar = B + d1;
-                        CLIP_RESULT(tmpvar)
-                        *(rec_y - 1) = tmpvar;
-                        tmpvar = C - d1;
-                        CLIP_RESULT(tmpvar)
-                        *rec_y = tmpvar;
-                        *(rec_y + 1) = D + d2;
-                        rec_y += width;
-                    }
-                    rec_y -= offset;
-                }
-                else
-                {
-                    rec_y += b_size;
+                    H263_FilterHorizontal(rec_y, width, strength, 16);
                 }
+                rec_y += b_size;
                 mbnum++;
             }
             rec_y += (15 * width);
@@ -486,7 +553,6 @@ void H263_Deblock(uint8 *rec,
 
     /* HORIZONTAL EDGE */
     rec_y = rec + b_size;
-    offset = width * b_size - b_size;
     mbnum = 1;
     for (i = 0; i < nMBPerCol; i++)
     {
@@ -494,7 +560,6 @@ void H263_Deblock(uint8 *rec,
         {
             if (mode[mbnum] != MODE_SKIPPED || mode[mbnum-1] != MODE_SKIPPED)
             {
-                k = b_size;
                 if (mode[mbnum] != MODE_SKIPPED)
                 {
                     strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum]] : QP_store[mbnum])];
@@ -504,75 +569,9 @@ void H263_Deblock(uint8 *rec,
                     strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum - 1]] : QP_store[mbnum - 1])];
                 }
 
-                while (k--)
-                {
-                    A =  *(rec_y - 2);
-                    D =  *(rec_y + 1);
-                    A_D = A - D;
-                    C = *rec_y;
-                    B = *(rec_y - 1);
-                    d = (((C - B) << 2) + A_D);
-
-                    if (d < 0)
-                    {
-                        d1 = -(-d >> 3);
-                        if (d1 < -(strength << 1))
-                        {
-                            d1 = 0;
-                        }
-                        else if (d1 < -strength)
-                        {
-                            d1 = -d1 - (strength << 1);
-                        }
-                        d1_2 = -d1 >> 1;
-                    }
-                    else
-                    {
-                        d1 = d >> 3;
-                        if (d1 > (strength << 1))
-                        {
-                            d1 = 0;
-                        }
-                        else if (d1 > strength)
-                        {
-                            d1 = (strength << 1) - d1;
-                        }
-                        d1_2 = d1 >> 1;
-                    }
-
-                    if (A_D < 0)
-                    {
-                        d2 = -(-A_D >> 2);
-                        if (d2 < -d1_2)
-                        {
-                            d2 = -d1_2;
-                        }
-                    }
-                    else
-                    {
-                        d2 = A_D >> 2;
-                        if (d2 > d1_2)
-                        {
-                            d2 = d1_2;
-                        }
-                    }
-
-                    *(rec_y - 2) = A - d2;
-                    tmpvar = B + d1;
-                    CLIP_RESULT(tmpvar)
-                    *(rec_y - 1) = tmpvar;
-                    tmpvar = C - d1;
-                    CLIP_RESULT(tmpvar)
-                    *rec_y = tmpvar;
-                    *(rec_y + 1) = D + d2;
-                    rec_y += width;
-                }
-                rec_y -= offset;
-            }
-            else
-            {
-                rec_y += b_size;
+                H263_FilterHorizontal(rec_y, width, strength, b_size);
             }
+            rec_y += b_size;
             mbnum++;
         }
         rec_y += ((width * (b_size - 1)) + b_size);
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Decodes an elementary MPEG-4 or H.263 stream, as written by
+// libstagefright_m4vh263enc_test, and reports the decoding speed. The decoded
+// frames of the first pass are written to the output file, further passes
+// decode the same stream again for timing only.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mp4dec_api.h"
+
+// Constants.
+enum {
+    kMaxWidth   = 720,
+    kMaxHeight  = 480,
+    kMaxPasses  = 1000,
+};
+
+static int64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+// Returns the offset of the frame following the one at offset, or size.
+// MPEG-4 frames start with a VOP start code, or with the GOV header or user
+// data in front of it. H.263 frames start with a picture start code.
+static int32_t nextFrame(uint8_t *data, int32_t size, int32_t offset, bool isH263) {
+    if (isH263) {
+        offset += 3;
+        if (offset >= size) {
+            return size;
+        }
+        return offset + PVLocateH263FrameHeader(data + offset, size - offset);
+    }
+
+    int32_t header = -1;
+    for (int32_t i = offset + 4; i + 3 < size; i++) {
+        if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) {
+            continue;
+        }
+        if (data[i + 3] == 0xB6) {
+            return header >= 0 ? header : i;
+        }
+        if (header < 0) {
+            header = i;
+        }
+    }
+    return size;
+}
+
+static void writeFrame(FILE *fp, uint8_t *yuv, int32_t bufWidth, int32_t bufHeight,
+        int32_t width, int32_t height) {
+    uint8_t *plane = yuv;
+    for (int32_t i = 0; i < height; i++) {
+        fwrite(plane + i * bufWidth, 1, width, fp);
+    }
+    for (int32_t c = 0; c < 2; c++) {
+        plane = yuv + bufWidth * bufHeight + c * ((bufWidth * bufHeight) >> 2);
+        for (int32_t i = 0; i < (height >> 1); i++) {
+            fwrite(plane + i * (bufWidth >> 1), 1, width >> 1, fp);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 6) {
+        fprintf(stderr, "Usage %s <input bitstream> <output yuv> <mode> <width> "
+                        "<height> [<passes>]\n", argv[0]);
+        fprintf(stderr, "mode : h263 or mpeg4\n");
+        fprintf(stderr, "Max width %d\n", kMaxWidth);
+        fprintf(stderr, "Max height %d\n", kMaxHeight);
+        fprintf(stderr, "Max passes %d\n", kMaxPasses);
+        return EXIT_FAILURE;
+    }
+
+    // Read mode.
+    bool isH263mode;
+    if (strcmp(argv[3], "mpeg4") == 0) {
+        isH263mode = false;
+    } else if (strcmp(argv[3], "h263") == 0) {
+        isH263mode = true;
+    } else {
+        fprintf(stderr, "Unsupported mode %s\n", argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    // Read height and width.
+    int32_t width = atoi(argv[4]);
+    int32_t height = atoi(argv[5]);
+    if (width > kMaxWidth || height > kMaxHeight || width <= 0 || height <= 0) {
+        fprintf(stderr, "Unsupported dimensions %dx%d\n", width, height);
+        return EXIT_FAILURE;
+    }
+
+    // Read number of passes.
+    int32_t numPasses = 1;
+    if (argc > 6) {
+        numPasses = atoi(argv[6]);
+        if (numPasses > kMaxPasses || numPasses <= 0) {
+            fprintf(stderr, "Unsupported number of passes %d\n", numPasses);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Read the whole bitstream.
+    FILE *fpInput = fopen(argv[1], "rb");
+    if (fpInput == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    fseek(fpInput, 0, SEEK_END);
+    int32_t inputSize = ftell(fpInput);
+    fseek(fpInput, 0, SEEK_SET);
+    uint8_t *inputBuf = (uint8_t *)malloc(inputSize > 0 ? inputSize : 1);
+    if (inputBuf == NULL || (int32_t)fread(inputBuf, 1, inputSize, fpInput) != inputSize) {
+        fprintf(stderr, "Could not read %s\n", argv[1]);
+        free(inputBuf);
+        fclose(fpInput);
+        return EXIT_FAILURE;
+    }
+    fclose(fpInput);
+
+    // The VOL header is whatever precedes the first VOP.
+    int32_t firstFrame = 0;
+    if (!isH263mode) {
+        while (firstFrame + 3 < inputSize && (inputBuf[firstFrame] != 0 ||
+                inputBuf[firstFrame + 1] != 0 || inputBuf[firstFrame + 2] != 1 ||
+                inputBuf[firstFrame + 3] != 0xB6)) {
+            firstFrame++;
+        }
+        if (firstFrame + 3 >= inputSize) {
+            fprintf(stderr, "No VOP found in %s\n", argv[1]);
+            free(inputBuf);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Open the output file.
+    FILE *fpOutput = fopen(argv[2], "wb");
+    if (fpOutput == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[2]);
+        free(inputBuf);
+        return EXIT_FAILURE;
+    }
+
+    int32_t retVal = EXIT_SUCCESS;
+    int32_t numFramesDecoded = 0;
+    int64_t totalTimeUs = 0;
+    int32_t displayWidth = 0;
+    int32_t displayHeight = 0;
+
+    for (int32_t pass = 0; pass < numPasses && retVal == EXIT_SUCCESS; pass++) {
+        // Initialize the decoder.
+        VideoDecControls handle;
+        memset(&handle, 0, sizeof(handle));
+
+        uint8_t *volData[1] = { isH263mode ? NULL : inputBuf };
+        int32_t volSize = firstFrame;
+        if (!PVInitVideoDecoder(&handle, volData, &volSize, 1, width, height,
+                isH263mode ? H263_MODE : MPEG4_MODE)) {
+            fprintf(stderr, "Failed to initialize the decoder\n");
+            retVal = EXIT_FAILURE;
+            break;
+        }
+        PVSetPostProcType(&handle, 0);
+
+        int32_t bufWidth, bufHeight;
+        PVGetBufferDimensions(&handle, &bufWidth, &bufHeight);
+
+        // The previous output frame is the reference of the next one.
+        int32_t frameSize = (handle.size * 3) / 2;
+        uint8_t *frames[2];
+        frames[0] = (uint8_t *)malloc(frameSize);
+        frames[1] = (uint8_t *)malloc(frameSize);
+        if (frames[0] == NULL || frames[1] == NULL) {
+            fprintf(stderr, "Could not allocate %d bytes\n", frameSize);
+            free(frames[0]);
+            free(frames[1]);
+            PVCleanUpVideoDecoder(&handle);
+            retVal = EXIT_FAILURE;
+            break;
+        }
+        memset(frames[1], 0, frameSize);
+        PVSetReferenceYUV(&handle, frames[1]);
+
+        int32_t numFrames = 0;
+        int64_t startUs = nowUs();
+        for (int32_t offset = firstFrame; offset < inputSize; ) {
+            int32_t end = nextFrame(inputBuf, inputSize, offset, isH263mode);
+            uint8_t *bitstream = inputBuf + offset;
+            int32_t bufferSize = end - offset;
+            uint32_t timestamp = numFrames;
+            uint32_t useExtTimestamp = 1;
+            uint8_t *outFrame = frames[numFrames & 1];
+
+            if (!PVDecodeVideoFrame(&handle, &bitstream, &timestamp, &bufferSize,
+                    &useExtTimestamp, outFrame)) {
+                fprintf(stderr, "Failed to decode frame %d\n", numFrames);
+                retVal = EXIT_FAILURE;
+                break;
+            }
+
+            PVGetVideoDimensions(&handle, &displayWidth, &displayHeight);
+            if (displayWidth > bufWidth || displayHeight > bufHeight) {
+                fprintf(stderr, "Stream is %dx%d, larger than %dx%d\n",
+                        displayWidth, displayHeight, width, height);
+                retVal = EXIT_FAILURE;
+                break;
+            }
+
+            if (pass == 0) {
+                int64_t writeStartUs = nowUs();
+                writeFrame(fpOutput, outFrame, bufWidth, bufHeight,
+                        displayWidth, displayHeight);
+                startUs += nowUs() - writeStartUs;
+            }
+            numFrames++;
+            offset = end;
+        }
+        totalTimeUs += nowUs() - startUs;
+        numFramesDecoded += numFrames;
+
+        PVCleanUpVideoDecoder(&handle);
+        free(frames[0]);
+        free(frames[1]);
+    }
+
+    if (retVal == EXIT_SUCCESS) {
+        printf("Decoded %d frames of %dx%d in %.1f ms, %.1f fps\n",
+                numFramesDecoded, displayWidth, displayHeight, totalTimeUs / 1000.0,
+                totalTimeUs > 0 ? numFramesDecoded * 1e6 / totalTimeUs : 0.0);
+    }
+
+    fclose(fpOutput);
+    free(inputBuf);
+    return retVal;
+}
@@ -34,6 +34,7 @@
 #include "SoftMPEG4Encoder.h"
 
 #include <inttypes.h>
+#include <unistd.h>
 
 #ifndef INT32_MAX
 #define INT32_MAX   2147483647
@@ -58,6 +59,25 @@ static const CodecProfileLevel kH263ProfileLevels[] = {
     { OMX_VIDEO_H263ProfileBaseline, OMX_VIDEO_H263Level45 },
 };
 
+// Motion estimation threads, the encoder output does not depend on this. The default is
+// one per core up to kDefaultMaxNumThreads; clients may ask for up to kMaxNumThreads, the
+// encoder library's limit.
+static const size_t kDefaultMaxNumThreads = 4;
+static const int32_t kMaxNumThreads = 8;
+
+static size_t GetCPUCoreCount() {
+    long cpuCoreCount = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    // _SC_NPROC_ONLN must be defined...
+    cpuCoreCount = sysconf(_SC_NPROC_ONLN);
+#endif
+    CHECK(cpuCoreCount >= 1);
+    ALOGV("Number of CPU cores: %ld", cpuCoreCount);
+    return (size_t)cpuCoreCount;
+}
+
 SoftMPEG4Encoder::SoftMPEG4Encoder(
             const char *name,
             const char *componentRole,
@@ -79,6 +99,7 @@ SoftMPEG4Encoder::SoftMPEG4Encoder(
       mStarted(false),
       mSawInputEOS(false),
       mSignalledError(false),
+      mNumThreads(min(GetCPUCoreCount(), kDefaultMaxNumThreads)),
       mHandle(new tagvideoEncControls),
       mEncParams(new tagvideoEncOptions),
       mInputFrameData(NULL) {
@@ -92,6 +113,8 @@ SoftMPEG4Encoder::SoftMPEG4Encoder(
 
     initPorts(kNumBuffers, kNumBuffers, kOutputBufferSize, mime);
 
+    addInt32VendorExtension("android.threads", &mNumThreads, 1, kMaxNumThreads);
+
     ALOGI("Construct SoftMPEG4Encoder");
 }
 
@@ -171,6 +194,7 @@ OMX_ERRORTYPE SoftMPEG4Encoder::initEncParams() {
     mEncParams->gobHeaderInterval = 0;
     mEncParams->useACPred = PV_ON;
     mEncParams->intraDCVlcTh = 0;
+    mEncParams->numThreads = mNumThreads;
 
     return OMX_ErrorNone;
 }
@@ -71,6 +71,9 @@ private:
     bool     mStarted;
     bool     mSawInputEOS;
     bool     mSignalledError;
+    // Number of threads used for motion estimation; set through the
+    // "vendor.android.threads.value" key, and read when the encoder starts.
+    int32_t  mNumThreads;
 
     tagvideoEncControls   *mHandle;
     tagvideoEncOptions    *mEncParams;
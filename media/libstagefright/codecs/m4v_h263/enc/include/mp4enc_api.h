@@ -234,6 +234,11 @@ typedef struct tagvideoEncOptions
     /** @brief This flag turns on the use of AC prediction */
     Bool                useACPred;
 
+    /** @brief  Sets the number of threads used for motion estimation. Macroblock rows are searched in parallel
+    *           and the bitstream is identical to the single-threaded one. Values below 2 disable threading.
+    *           The default is 1.*/
+    Int                 numThreads;
+
 } VideoEncOptions;
 
 #ifdef __cplusplus
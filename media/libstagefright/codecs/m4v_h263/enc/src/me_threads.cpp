@@ -0,0 +1,325 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+#include <pthread.h>
+
+#include "mp4def.h"
+#include "mp4enc_lib.h"
+#include "mp4lib_int.h"
+#include "m4venc_oscl.h"
+
+/*
+    Row-parallel motion estimation.
+
+    The candidate selection of MBMotionSearch reads the MVs of the left,
+    upper-left, upper and upper-right neighbors from the current VOP, and of
+    the right and lower neighbors from the previous VOP (mot[] is updated in
+    place). Rows are therefore searched as a wavefront: MB (i,j) starts once
+    row j-1 is done up to column i+1. Row j+1 cannot overtake row j for the
+    same reason, so every MB sees exactly the MVs it sees in the single
+    threaded raster scan and the bitstream does not depend on the number of
+    threads.
+
+    Each worker searches with a private copy of VideoEncData, for mbnum,
+    currYMB and the HTFM statistics, and accumulates into its own MEWorkData.
+    The calling thread takes part in the search using the original data.
+*/
+
+#define ME_MAX_THREADS  8
+
+typedef struct tagMEThread
+{
+    struct tagMEThreadPool *pool;
+    pthread_t thread;
+    VideoEncData video;     /* private copy, refreshed for every pass */
+#ifdef HTFM
+    HTFM_Stat htfm_stat;
+#endif
+    MEWorkData work;
+} METhread;
+
+typedef struct tagMEThreadPool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        /* new pass, row progress, and worker done */
+    Int numWorkers;             /* threads besides the caller */
+    METhread *workers;
+    Int *rowProgress;           /* per MB row, columns done in this pass */
+    Int maxRows;
+
+    /* current pass, protected by lock */
+    UInt passId;
+    Int quit;
+    Int numActive;              /* workers not done with this pass */
+    Int nextRow;
+    Int start_i;
+    Int incr_i;
+    Int type_pred;
+    Int mbwidth;
+    Int mbheight;
+} METhreadPool;
+
+static void SearchRows(METhreadPool *pool, VideoEncData *video, MEWorkData *work)
+{
+    Int mbwidth = pool->mbwidth;
+    Int mbheight = pool->mbheight;
+    Int incr_i = pool->incr_i;
+    Int type_pred = pool->type_pred;
+    Int *rowProgress = pool->rowProgress;
+    Int i, j, need;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        j = pool->nextRow++;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (j >= mbheight)
+            break;
+
+        /* same as toggling start_i once per row in MotionEstimation */
+        i = (incr_i > 1) ? ((pool->start_i + j + 1) & 1) : 0;
+
+        for (; i < mbwidth; i += incr_i)
+        {
+            pthread_mutex_lock(&pool->lock);
+            if (j > 0)
+            {
+                need = PV_MIN(i + 2, mbwidth);
+                while (rowProgress[j-1] < need)
+                    pthread_cond_wait(&pool->cond, &pool->lock);
+            }
+            pthread_mutex_unlock(&pool->lock);
+
+            MBMotionEstimation(video, work, i, j, type_pred);
+
+            pthread_mutex_lock(&pool->lock);
+            rowProgress[j] = i + 1;
+            pthread_cond_broadcast(&pool->cond);
+            pthread_mutex_unlock(&pool->lock);
+        }
+
+        /* columns skipped by the checkerboard pass count as done */
+        pthread_mutex_lock(&pool->lock);
+        rowProgress[j] = mbwidth;
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return ;
+}
+
+static void *METhreadMain(void *arg)
+{
+    METhread *thread = (METhread*) arg;
+    METhreadPool *pool = thread->pool;
+    UInt passId = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->quit && pool->passId == passId)
+            pthread_cond_wait(&pool->cond, &pool->lock);
+
+        if (pool->quit)
+            break;
+
+        passId = pool->passId;
+        pthread_mutex_unlock(&pool->lock);
+
+        SearchRows(pool, &thread->video, &thread->work);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->numActive == 0)
+            pthread_cond_broadcast(&pool->cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  Function : METhreadPoolCreate()                                         */
+/*  Purpose  : Start numThreads-1 workers for row-parallel motion search.   */
+/*  In/out   :                                                              */
+/*  Return   : PV_TRUE if successful, PV_FALSE otherwise, in which case     */
+/*             motion estimation stays single-threaded.                     */
+/* ======================================================================== */
+Bool METhreadPoolCreate(VideoEncData *video, Int numThreads)
+{
+    METhreadPool *pool;
+    Int idx, maxRows = 0;
+
+    if (numThreads > ME_MAX_THREADS)
+        numThreads = ME_MAX_THREADS;
+    if (numThreads < 2)
+        return PV_FALSE;
+
+    for (idx = 0; idx < video->encParams->nLayers; idx++)
+    {
+        if (video->vol[idx]->nMBPerCol > maxRows)
+            maxRows = video->vol[idx]->nMBPerCol;
+    }
+    if (maxRows < 2)
+        return PV_FALSE;
+
+    pool = (METhreadPool*) M4VENC_MALLOC(sizeof(METhreadPool));
+    if (pool == NULL)
+        return PV_FALSE;
+    M4VENC_MEMSET(pool, 0, sizeof(METhreadPool));
+
+    pool->workers = (METhread*) M4VENC_MALLOC(sizeof(METhread) * (numThreads - 1));
+    pool->rowProgress = (Int*) M4VENC_MALLOC(sizeof(Int) * maxRows);
+    if (pool->workers == NULL || pool->rowProgress == NULL)
+    {
+        if (pool->workers) M4VENC_FREE(pool->workers);
+        if (pool->rowProgress) M4VENC_FREE(pool->rowProgress);
+        M4VENC_FREE(pool);
+        return PV_FALSE;
+    }
+    pool->maxRows = maxRows;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+
+    for (idx = 0; idx < numThreads - 1; idx++)
+    {
+        pool->workers[idx].pool = pool;
+        if (pthread_create(&pool->workers[idx].thread, NULL, METhreadMain, &pool->workers[idx]) != 0)
+            break;
+        pool->numWorkers++;
+    }
+
+    video->meThreadPool = (void*) pool;
+
+    if (pool->numWorkers == 0)
+    {
+        METhreadPoolDestroy(video);
+        return PV_FALSE;
+    }
+
+    return PV_TRUE;
+}
+
+/* ======================================================================== */
+/*  Function : METhreadPoolDestroy()                                        */
+/*  Purpose  : Stop the motion estimation workers and free the pool.        */
+/* ======================================================================== */
+void METhreadPoolDestroy(VideoEncData *video)
+{
+    METhreadPool *pool = (METhreadPool*) video->meThreadPool;
+    Int idx;
+
+    if (pool == NULL)
+        return ;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (idx = 0; idx < pool->numWorkers; idx++)
+        pthread_join(pool->workers[idx].thread, NULL);
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+
+    M4VENC_FREE(pool->rowProgress);
+    M4VENC_FREE(pool->workers);
+    M4VENC_FREE(pool);
+    video->meThreadPool = NULL;
+
+    return ;
+}
+
+/* ======================================================================== */
+/*  Function : MotionEstimationRows()                                       */
+/*  Purpose  : One pass of the P-VOP motion search of MotionEstimation(),   */
+/*             with MB rows spread over the pool. start_i and incr_i are    */
+/*             those of the serial loop, results are added to work.         */
+/* ======================================================================== */
+void MotionEstimationRows(VideoEncData *video, MEWorkData *work, Int start_i, Int incr_i, Int type_pred)
+{
+    METhreadPool *pool = (METhreadPool*) video->meThreadPool;
+    Vol *currVol = video->vol[video->currLayer];
+    METhread *thread;
+    Int idx;
+
+    for (idx = 0; idx < pool->numWorkers; idx++)
+    {
+        thread = &pool->workers[idx];
+
+        M4VENC_MEMCPY(&thread->video, video, sizeof(VideoEncData));
+        thread->video.meThreadPool = NULL;
+
+        thread->work.totalSAD = 0;
+        thread->work.numIntra = 0;
+        thread->work.max_mag = 0;
+        thread->work.min_mag = 0;
+#ifdef HTFM
+        thread->work.htfm_stat = &thread->htfm_stat;
+        if (video->sad_extra_info == (void*) work->htfm_stat) /* collecting statistics */
+        {
+            thread->htfm_stat = *work->htfm_stat;
+            thread->htfm_stat.abs_dif_mad_avg = 0;
+            thread->htfm_stat.countbreak = 0;
+            thread->video.sad_extra_info = (void*) &thread->htfm_stat;
+        }
+#endif
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    M4VENC_MEMSET(pool->rowProgress, 0, sizeof(Int) * currVol->nMBPerCol);
+    pool->mbwidth = currVol->nMBPerRow;
+    pool->mbheight = currVol->nMBPerCol;
+    pool->start_i = start_i;
+    pool->incr_i = incr_i;
+    pool->type_pred = type_pred;
+    pool->nextRow = 0;
+    pool->numActive = pool->numWorkers;
+    pool->passId++;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    SearchRows(pool, video, work);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->numActive > 0)
+        pthread_cond_wait(&pool->cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (idx = 0; idx < pool->numWorkers; idx++)
+    {
+        thread = &pool->workers[idx];
+
+        work->totalSAD += thread->work.totalSAD;
+        work->numIntra += thread->work.numIntra;
+        if (thread->work.max_mag > work->max_mag)
+            work->max_mag = thread->work.max_mag;
+        if (thread->work.min_mag < work->min_mag)
+            work->min_mag = thread->work.min_mag;
+#ifdef HTFM
+        if (thread->video.sad_extra_info == (void*) &thread->htfm_stat)
+        {
+            work->htfm_stat->abs_dif_mad_avg += thread->htfm_stat.abs_dif_mad_avg;
+            work->htfm_stat->countbreak += thread->htfm_stat.countbreak;
+        }
+#endif
+    }
+
+    return ;
+}
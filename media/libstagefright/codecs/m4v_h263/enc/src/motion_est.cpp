@@ -135,33 +135,26 @@ ULong num_hp_not_zero = 0;
 
 void MotionEstimation(VideoEncData *video)
 {
-    UChar use_4mv = video->encParams->MV8x8_Enabled;
     Vol *currVol = video->vol[video->currLayer];
     Vop *currVop = video->currVop;
     VideoEncFrameIO *currFrame = video->input;
-    Int i, j, comp;
+    Int i, j;
     Int mbwidth = currVol->nMBPerRow;
     Int mbheight = currVol->nMBPerCol;
     Int totalMB = currVol->nTotalMB;
     Int width = currFrame->pitch;
-    UChar *mode_mb, *Mode = video->headerInfo.Mode;
+    UChar *Mode = video->headerInfo.Mode;
     MOT *mot_mb, **mot = video->mot;
     UChar *intraArray = video->intraArray;
-    Int FS_en = video->encParams->FullSearch_Enabled;
     void (*ComputeMBSum)(UChar *, Int, MOT *) = video->functionPointer->ComputeMBSum;
-    void (*ChooseMode)(UChar*, UChar*, Int, Int) = video->functionPointer->ChooseMode;
 
-    Int numIntra, start_i, numLoop, incr_i;
-    Int mbnum, offset;
-    UChar *cur, *best_cand[5];
-    Int sad8 = 0, sad16 = 0;
+    Int start_i, numLoop, incr_i;
+    Int mbnum;
+    UChar *cur;
     Int totalSAD = 0;   /* average SAD for rate control */
-    Int skip_halfpel_4mv;
-    Int f_code_p, f_code_n, max_mag = 0, min_mag = 0;
+    Int f_code_p, f_code_n, max_mag, min_mag;
     Int type_pred;
-    Int xh[5] = {0, 0, 0, 0, 0};
-    Int yh[5] = {0, 0, 0, 0, 0}; /* half-pel */
-    UChar hp_mem4MV[17*17*4];
+    MEWorkData work;    /* SAD, intra count and MV range of the P-VOP search */
 
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/  /* 2/28/01 */
@@ -171,16 +164,10 @@ void MotionEstimation(VideoEncData *video)
     double exp_lamda[15];
     /*********************************/
 #endif
-    Int hp_guess = 0;
-#ifdef PRINT_MV
-    FILE *fp_debug;
-#endif
 
 //  FILE *fstat;
 //  static int frame_num = 0;
 
-    offset = 0;
-
     if (video->currVop->predictionType == I_VOP)
     {   /* compute the SAV */
         mbnum = 0;
@@ -250,218 +237,42 @@ void MotionEstimation(VideoEncData *video)
         type_pred = 2;
     }
 
+    work.totalSAD = 0;
+    work.numIntra = 0;
+    work.max_mag = 0;
+    work.min_mag = 0;
+#ifdef HTFM
+    work.htfm_stat = &htfm_stat;
+#endif
+
     /* First pass, loop thru half the macroblock */
     /* determine scene change */
     /* Second pass, for the rest of macroblocks */
-    numIntra = 0;
     while (numLoop--)
     {
-        for (j = 0; j < mbheight; j++)
+        if (video->meThreadPool)
         {
-            if (incr_i > 1)
-                start_i = (start_i == 0 ? 1 : 0) ; /* toggle 0 and 1 */
-
-            offset = width * (j << 4) + (start_i << 4);
-
-            mbnum = j * mbwidth + start_i;
-
-            for (i = start_i; i < mbwidth; i += incr_i)
+            /* search MB rows in parallel, see me_threads.cpp */
+            MotionEstimationRows(video, &work, start_i, incr_i, type_pred);
+        }
+        else
+        {
+            for (j = 0; j < mbheight; j++)
             {
-                video->mbnum = mbnum;
-                mot_mb = mot[mbnum];
-                mode_mb = Mode + mbnum;
-
-                cur = currFrame->yChan + offset;
+                if (incr_i > 1)
+                    start_i = (start_i == 0 ? 1 : 0) ; /* toggle 0 and 1 */
 
-
-                if (*mode_mb != MODE_INTRA)
+                for (i = start_i; i < mbwidth; i += incr_i)
                 {
-#if defined(HTFM)
-                    HTFMPrepareCurMB(video, &htfm_stat, cur);
-#else
-                    PrepareCurMB(video, cur);
-#endif
-                    /************************************************************/
-                    /******** full-pel 1MV and 4MVs search **********************/
-
-#ifdef _SAD_STAT
-                    num_MB++;
-#endif
-                    MBMotionSearch(video, cur, best_cand, i << 4, j << 4, type_pred,
-                                   FS_en, &hp_guess);
-
-#ifdef PRINT_MV
-                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                    fprintf(fp_debug, "#%d (%d,%d,%d) : ", mbnum, mot_mb[0].x, mot_mb[0].y, mot_mb[0].sad);
-                    fprintf(fp_debug, "(%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : ==>\n",
-                            mot_mb[1].x, mot_mb[1].y, mot_mb[1].sad,
-                            mot_mb[2].x, mot_mb[2].y, mot_mb[2].sad,
-                            mot_mb[3].x, mot_mb[3].y, mot_mb[3].sad,
-                            mot_mb[4].x, mot_mb[4].y, mot_mb[4].sad);
-                    fclose(fp_debug);
-#endif
-                    sad16 = mot_mb[0].sad;
-#ifdef NO_INTER4V
-                    sad8 = sad16;
-#else
-                    sad8 = mot_mb[1].sad + mot_mb[2].sad + mot_mb[3].sad + mot_mb[4].sad;
-#endif
-
-                    /* choose between INTRA or INTER */
-                    (*ChooseMode)(mode_mb, cur, width, ((sad8 < sad16) ? sad8 : sad16));
-                }
-                else    /* INTRA update, use for prediction 3/23/01 */
-                {
-                    mot_mb[0].x = mot_mb[0].y = 0;
-                }
-
-                if (*mode_mb == MODE_INTRA)
-                {
-                    numIntra++ ;
-
-                    /* compute SAV for rate control and fast DCT, 11/28/00 */
-                    (*ComputeMBSum)(cur, width, mot_mb);
-
-                    /* leave mot_mb[0] as it is for fast motion search */
-                    /* set the 4 MVs to zeros */
-                    for (comp = 1; comp <= 4; comp++)
-                    {
-                        mot_mb[comp].x = 0;
-                        mot_mb[comp].y = 0;
-                    }
-#ifdef PRINT_MV
-                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                    fprintf(fp_debug, "\n");
-                    fclose(fp_debug);
-#endif
+                    MBMotionEstimation(video, &work, i, j, type_pred);
                 }
-                else /* *mode_mb = MODE_INTER;*/
-                {
-                    if (video->encParams->HalfPel_Enabled)
-                    {
-#ifdef _SAD_STAT
-                        num_HP_MB++;
-#endif
-                        /* find half-pel resolution motion vector */
-                        FindHalfPelMB(video, cur, mot_mb, best_cand[0],
-                                      i << 4, j << 4, xh, yh, hp_guess);
-#ifdef PRINT_MV
-                        fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                        fprintf(fp_debug, "(%d,%d), %d\n", mot_mb[0].x, mot_mb[0].y, mot_mb[0].sad);
-                        fclose(fp_debug);
-#endif
-                        skip_halfpel_4mv = ((sad16 - mot_mb[0].sad) <= (MB_Nb >> 1) + 1);
-                        sad16 = mot_mb[0].sad;
-
-#ifndef NO_INTER4V
-                        if (use_4mv && !skip_halfpel_4mv)
-                        {
-                            /* Also decide 1MV or 4MV !!!!!!!!*/
-                            sad8 = FindHalfPelBlk(video, cur, mot_mb, sad16,
-                                                  best_cand, mode_mb, i << 4, j << 4, xh, yh, hp_mem4MV);
-
-#ifdef PRINT_MV
-                            fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                            fprintf(fp_debug, " (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) \n",
-                                    mot_mb[1].x, mot_mb[1].y, mot_mb[1].sad,
-                                    mot_mb[2].x, mot_mb[2].y, mot_mb[2].sad,
-                                    mot_mb[3].x, mot_mb[3].y, mot_mb[3].sad,
-                                    mot_mb[4].x, mot_mb[4].y, mot_mb[4].sad);
-                            fclose(fp_debug);
-#endif
-                        }
-#endif /* NO_INTER4V */
-                    }
-                    else    /* HalfPel_Enabled ==0  */
-                    {
-#ifndef NO_INTER4V
-                        //if(sad16 < sad8-PREF_16_VEC)
-                        if (sad16 - PREF_16_VEC > sad8)
-                        {
-                            *mode_mb = MODE_INTER4V;
-                        }
-#endif
-                    }
-#if (ZERO_MV_PREF==2)   /* use mot_mb[7].sad as d0 computed in MBMotionSearch*/
-                    /******************************************************/
-                    if (mot_mb[7].sad - PREF_NULL_VEC < sad16 && mot_mb[7].sad - PREF_NULL_VEC < sad8)
-                    {
-                        mot_mb[0].sad = mot_mb[7].sad - PREF_NULL_VEC;
-                        mot_mb[0].x = mot_mb[0].y = 0;
-                        *mode_mb = MODE_INTER;
-                    }
-                    /******************************************************/
-#endif
-                    if (*mode_mb == MODE_INTER)
-                    {
-                        if (mot_mb[0].x == 0 && mot_mb[0].y == 0)   /* use zero vector */
-                            mot_mb[0].sad += PREF_NULL_VEC; /* add back the bias */
-
-                        mot_mb[1].sad = mot_mb[2].sad = mot_mb[3].sad = mot_mb[4].sad = (mot_mb[0].sad + 2) >> 2;
-                        mot_mb[1].x = mot_mb[2].x = mot_mb[3].x = mot_mb[4].x = mot_mb[0].x;
-                        mot_mb[1].y = mot_mb[2].y = mot_mb[3].y = mot_mb[4].y = mot_mb[0].y;
-
-                    }
-                }
-
-                /* find maximum magnitude */
-                /* compute average SAD for rate control, 11/28/00 */
-                if (*mode_mb == MODE_INTER)
-                {
-#ifdef PRINT_MV
-                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                    fprintf(fp_debug, "%d MODE_INTER\n", mbnum);
-                    fclose(fp_debug);
-#endif
-                    totalSAD += mot_mb[0].sad;
-                    if (mot_mb[0].x > max_mag)
-                        max_mag = mot_mb[0].x;
-                    if (mot_mb[0].y > max_mag)
-                        max_mag = mot_mb[0].y;
-                    if (mot_mb[0].x < min_mag)
-                        min_mag = mot_mb[0].x;
-                    if (mot_mb[0].y < min_mag)
-                        min_mag = mot_mb[0].y;
-                }
-                else if (*mode_mb == MODE_INTER4V)
-                {
-#ifdef PRINT_MV
-                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                    fprintf(fp_debug, "%d MODE_INTER4V\n", mbnum);
-                    fclose(fp_debug);
-#endif
-                    totalSAD += sad8;
-                    for (comp = 1; comp <= 4; comp++)
-                    {
-                        if (mot_mb[comp].x > max_mag)
-                            max_mag = mot_mb[comp].x;
-                        if (mot_mb[comp].y > max_mag)
-                            max_mag = mot_mb[comp].y;
-                        if (mot_mb[comp].x < min_mag)
-                            min_mag = mot_mb[comp].x;
-                        if (mot_mb[comp].y < min_mag)
-                            min_mag = mot_mb[comp].y;
-                    }
-                }
-                else    /* MODE_INTRA */
-                {
-#ifdef PRINT_MV
-                    fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
-                    fprintf(fp_debug, "%d MODE_INTRA\n", mbnum);
-                    fclose(fp_debug);
-#endif
-                    totalSAD += mot_mb[0].sad;
-                }
-                mbnum += incr_i;
-                offset += (incr_i << 4);
-
             }
         }
 
         if (incr_i > 1 && numLoop) /* scene change on and first loop */
         {
             //if(numIntra > ((totalMB>>3)<<1) + (totalMB>>3)) /* 75% of 50%MBs */
-            if (numIntra > (0.30*(totalMB / 2.0))) /* 15% of 50%MBs */
+            if (work.numIntra > (0.30*(totalMB / 2.0))) /* 15% of 50%MBs */
             {
                 /******** scene change detected *******************/
                 currVop->predictionType = I_VOP;
@@ -470,7 +281,6 @@ void MotionEstimation(VideoEncData *video)
 
                 /* compute the SAV for rate control & fast DCT */
                 totalSAD = 0;
-                offset = 0;
                 mbnum = 0;
                 cur = currFrame->yChan;
 
@@ -502,9 +312,11 @@ void MotionEstimation(VideoEncData *video)
         type_pred++; /* second pass */
     }
 
-    video->sumMAD = (float)totalSAD / (float)NumPixelMB;    /* avg SAD */
+    video->sumMAD = (float)work.totalSAD / (float)NumPixelMB;    /* avg SAD */
 
     /* find f_code , 10/27/2000 */
+    max_mag = work.max_mag;
+    min_mag = work.min_mag;
     f_code_p = 1;
     while ((max_mag >> (4 + f_code_p)) > 0)
         f_code_p++;
@@ -530,6 +342,227 @@ void MotionEstimation(VideoEncData *video)
 }
 
 
+/*==================================================================
+    Function:   MBMotionEstimation
+    Date:       10/3/2000
+    Purpose:    Motion search and mode decision for macroblock (i,j),
+                accumulating SAD, intra count and MV range in work.
+                Only reads the MVs of neighbors that have been searched
+                when rows are processed in a wavefront, see me_threads.cpp.
+====================================================================*/
+
+void MBMotionEstimation(VideoEncData *video, MEWorkData *work, Int i, Int j, Int type_pred)
+{
+    UChar use_4mv = video->encParams->MV8x8_Enabled;
+    Vol *currVol = video->vol[video->currLayer];
+    VideoEncFrameIO *currFrame = video->input;
+    Int comp;
+    Int mbwidth = currVol->nMBPerRow;
+    Int width = currFrame->pitch;
+    Int mbnum = j * mbwidth + i;
+    MOT *mot_mb = video->mot[mbnum];
+    UChar *mode_mb = video->headerInfo.Mode + mbnum;
+    UChar *cur = currFrame->yChan + width * (j << 4) + (i << 4);
+    Int FS_en = video->encParams->FullSearch_Enabled;
+    void (*ComputeMBSum)(UChar *, Int, MOT *) = video->functionPointer->ComputeMBSum;
+    void (*ChooseMode)(UChar*, UChar*, Int, Int) = video->functionPointer->ChooseMode;
+    UChar *best_cand[5];
+    Int sad8 = 0, sad16 = 0;
+    Int skip_halfpel_4mv;
+    Int xh[5] = {0, 0, 0, 0, 0};
+    Int yh[5] = {0, 0, 0, 0, 0}; /* half-pel */
+    Int hp_guess = 0;
+#ifdef PRINT_MV
+    FILE *fp_debug;
+#endif
+
+    video->mbnum = mbnum;
+
+
+
+    if (*mode_mb != MODE_INTRA)
+    {
+#if defined(HTFM)
+        HTFMPrepareCurMB(video, work->htfm_stat, cur);
+#else
+        PrepareCurMB(video, cur);
+#endif
+        /************************************************************/
+        /******** full-pel 1MV and 4MVs search **********************/
+
+#ifdef _SAD_STAT
+        num_MB++;
+#endif
+        MBMotionSearch(video, cur, best_cand, i << 4, j << 4, type_pred,
+                       FS_en, &hp_guess);
+
+#ifdef PRINT_MV
+        fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+        fprintf(fp_debug, "#%d (%d,%d,%d) : ", mbnum, mot_mb[0].x, mot_mb[0].y, mot_mb[0].sad);
+        fprintf(fp_debug, "(%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : ==>\n",
+                mot_mb[1].x, mot_mb[1].y, mot_mb[1].sad,
+                mot_mb[2].x, mot_mb[2].y, mot_mb[2].sad,
+                mot_mb[3].x, mot_mb[3].y, mot_mb[3].sad,
+                mot_mb[4].x, mot_mb[4].y, mot_mb[4].sad);
+        fclose(fp_debug);
+#endif
+        sad16 = mot_mb[0].sad;
+#ifdef NO_INTER4V
+        sad8 = sad16;
+#else
+        sad8 = mot_mb[1].sad + mot_mb[2].sad + mot_mb[3].sad + mot_mb[4].sad;
+#endif
+
+        /* choose between INTRA or INTER */
+        (*ChooseMode)(mode_mb, cur, width, ((sad8 < sad16) ? sad8 : sad16));
+    }
+    else    /* INTRA update, use for prediction 3/23/01 */
+    {
+        mot_mb[0].x = mot_mb[0].y = 0;
+    }
+
+    if (*mode_mb == MODE_INTRA)
+    {
+        work->numIntra++ ;
+
+        /* compute SAV for rate control and fast DCT, 11/28/00 */
+        (*ComputeMBSum)(cur, width, mot_mb);
+
+        /* leave mot_mb[0] as it is for fast motion search */
+        /* set the 4 MVs to zeros */
+        for (comp = 1; comp <= 4; comp++)
+        {
+            mot_mb[comp].x = 0;
+            mot_mb[comp].y = 0;
+        }
+#ifdef PRINT_MV
+        fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+        fprintf(fp_debug, "\n");
+        fclose(fp_debug);
+#endif
+    }
+    else /* *mode_mb = MODE_INTER;*/
+    {
+        if (video->encParams->HalfPel_Enabled)
+        {
+#ifdef _SAD_STAT
+            num_HP_MB++;
+#endif
+            /* find half-pel resolution motion vector */
+            FindHalfPelMB(video, cur, mot_mb, best_cand[0],
+                          i << 4, j << 4, xh, yh, hp_guess);
+#ifdef PRINT_MV
+            fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+            fprintf(fp_debug, "(%d,%d), %d\n", mot_mb[0].x, mot_mb[0].y, mot_mb[0].sad);
+            fclose(fp_debug);
+#endif
+            skip_halfpel_4mv = ((sad16 - mot_mb[0].sad) <= (MB_Nb >> 1) + 1);
+            sad16 = mot_mb[0].sad;
+
+#ifndef NO_INTER4V
+            if (use_4mv && !skip_halfpel_4mv)
+            {
+                /* Also decide 1MV or 4MV !!!!!!!!*/
+                sad8 = FindHalfPelBlk(video, cur, mot_mb, sad16,
+                                      best_cand, mode_mb, i << 4, j << 4, xh, yh, work->hp_mem4MV);
+
+#ifdef PRINT_MV
+                fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+                fprintf(fp_debug, " (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) : (%d,%d,%d) \n",
+                        mot_mb[1].x, mot_mb[1].y, mot_mb[1].sad,
+                        mot_mb[2].x, mot_mb[2].y, mot_mb[2].sad,
+                        mot_mb[3].x, mot_mb[3].y, mot_mb[3].sad,
+                        mot_mb[4].x, mot_mb[4].y, mot_mb[4].sad);
+                fclose(fp_debug);
+#endif
+            }
+#endif /* NO_INTER4V */
+        }
+        else    /* HalfPel_Enabled ==0  */
+        {
+#ifndef NO_INTER4V
+            //if(sad16 < sad8-PREF_16_VEC)
+            if (sad16 - PREF_16_VEC > sad8)
+            {
+                *mode_mb = MODE_INTER4V;
+            }
+#endif
+        }
+#if (ZERO_MV_PREF==2)   /* use mot_mb[7].sad as d0 computed in MBMotionSearch*/
+        /******************************************************/
+        if (mot_mb[7].sad - PREF_NULL_VEC < sad16 && mot_mb[7].sad - PREF_NULL_VEC < sad8)
+        {
+            mot_mb[0].sad = mot_mb[7].sad - PREF_NULL_VEC;
+            mot_mb[0].x = mot_mb[0].y = 0;
+            *mode_mb = MODE_INTER;
+        }
+        /******************************************************/
+#endif
+        if (*mode_mb == MODE_INTER)
+        {
+            if (mot_mb[0].x == 0 && mot_mb[0].y == 0)   /* use zero vector */
+                mot_mb[0].sad += PREF_NULL_VEC; /* add back the bias */
+
+            mot_mb[1].sad = mot_mb[2].sad = mot_mb[3].sad = mot_mb[4].sad = (mot_mb[0].sad + 2) >> 2;
+            mot_mb[1].x = mot_mb[2].x = mot_mb[3].x = mot_mb[4].x = mot_mb[0].x;
+            mot_mb[1].y = mot_mb[2].y = mot_mb[3].y = mot_mb[4].y = mot_mb[0].y;
+
+        }
+    }
+
+    /* find maximum magnitude */
+    /* compute average SAD for rate control, 11/28/00 */
+    if (*mode_mb == MODE_INTER)
+    {
+#ifdef PRINT_MV
+        fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+        fprintf(fp_debug, "%d MODE_INTER\n", mbnum);
+        fclose(fp_debug);
+#endif
+        work->totalSAD += mot_mb[0].sad;
+        if (mot_mb[0].x > work->max_mag)
+            work->max_mag = mot_mb[0].x;
+        if (mot_mb[0].y > work->max_mag)
+            work->max_mag = mot_mb[0].y;
+        if (mot_mb[0].x < work->min_mag)
+            work->min_mag = mot_mb[0].x;
+        if (mot_mb[0].y < work->min_mag)
+            work->min_mag = mot_mb[0].y;
+    }
+    else if (*mode_mb == MODE_INTER4V)
+    {
+#ifdef PRINT_MV
+        fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+        fprintf(fp_debug, "%d MODE_INTER4V\n", mbnum);
+        fclose(fp_debug);
+#endif
+        work->totalSAD += sad8;
+        for (comp = 1; comp <= 4; comp++)
+        {
+            if (mot_mb[comp].x > work->max_mag)
+                work->max_mag = mot_mb[comp].x;
+            if (mot_mb[comp].y > work->max_mag)
+                work->max_mag = mot_mb[comp].y;
+            if (mot_mb[comp].x < work->min_mag)
+                work->min_mag = mot_mb[comp].x;
+            if (mot_mb[comp].y < work->min_mag)
+                work->min_mag = mot_mb[comp].y;
+        }
+    }
+    else    /* MODE_INTRA */
+    {
+#ifdef PRINT_MV
+        fp_debug = fopen("c:\\bitstream\\mv1_debug.txt", "a");
+        fprintf(fp_debug, "%d MODE_INTRA\n", mbnum);
+        fclose(fp_debug);
+#endif
+        work->totalSAD += mot_mb[0].sad;
+    }
+
+    return ;
+}
+
+
 #ifdef HTFM
 void InitHTFM(VideoEncData *video, HTFM_Stat *htfm_stat, double *newvar, Int *collect)
 {
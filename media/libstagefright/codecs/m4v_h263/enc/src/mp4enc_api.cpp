@@ -165,7 +165,7 @@ OSCL_EXPORT_REF Bool PVGetDefaultEncOption(VideoEncOptions *encOption, Int encUs
 {
     VideoEncOptions defaultUseCase = {H263_MODE, profile_level_max_packet_size[SIMPLE_PROFILE_LEVEL0] >> 3,
                                       SIMPLE_PROFILE_LEVEL0, PV_OFF, 0, 1, 1000, 33, {144, 144}, {176, 176}, {15, 30}, {64000, 128000},
-                                      {10, 10}, {12, 12}, {0, 0}, CBR_1, 0.0, PV_OFF, -1, 0, PV_OFF, 16, PV_OFF, 0, PV_ON
+                                      {10, 10}, {12, 12}, {0, 0}, CBR_1, 0.0, PV_OFF, -1, 0, PV_OFF, 16, PV_OFF, 0, PV_ON, 1
                                      };
 
     OSCL_UNUSED_ARG(encUseCase); // unused for now. Later we can add more defaults setting and use this
@@ -337,6 +337,7 @@ OSCL_EXPORT_REF Bool    PVInitVideoEncoder(VideoEncControls *encoderControl, Vid
 
     encParams->HalfPel_Enabled = 1;
     encParams->SearchRange = encOption->searchRange; /* 4/16/2001 */
+    encParams->NumThreads = encOption->numThreads;
     encParams->FullSearch_Enabled = 0;
 #ifdef NO_INTER4V
     encParams->MV8x8_Enabled = 0;
@@ -1086,6 +1087,12 @@ OSCL_EXPORT_REF Bool    PVInitVideoEncoder(VideoEncControls *encoderControl, Vid
     video->functionPointer->GetHalfPelMBRegion = &GetHalfPelMBRegion_C;
 //  video->functionPointer->SAD_MB_PADDING = &SAD_MB_PADDING; /* 4/21/01 */
 
+    /* row-parallel motion estimation, falls back to a single thread on failure */
+    if (encParams->NumThreads > 1)
+    {
+        METhreadPoolCreate(video, encParams->NumThreads);
+    }
+
 
     encoderControl->videoEncoderInit = 1;  /* init done! */
 
@@ -1147,6 +1154,7 @@ OSCL_EXPORT_REF Bool    PVCleanUpVideoEncoder(VideoEncControls *encoderControl)
 
     if (video != NULL)
     {
+        METhreadPoolDestroy(video);
 
         if (video->QPMB) M4VENC_FREE(video->QPMB);
         if (video->headerInfo.Mode)M4VENC_FREE(video->headerInfo.Mode);
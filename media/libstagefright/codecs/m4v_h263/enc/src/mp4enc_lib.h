@@ -115,11 +115,17 @@ extern "C"
 
     /* defined in motion_est.c */
     void MotionEstimation(VideoEncData *video);
+    void MBMotionEstimation(VideoEncData *video, MEWorkData *work, Int i, Int j, Int type_pred);
 #ifdef HTFM
     void InitHTFM(VideoEncData *video, HTFM_Stat *htfm_stat, double *newvar, Int *collect);
     void UpdateHTFM(VideoEncData *video, double *newvar, double *exp_lamda, HTFM_Stat *htfm_stat);
 #endif
 
+    /* defined in me_threads.c */
+    Bool METhreadPoolCreate(VideoEncData *video, Int numThreads);
+    void METhreadPoolDestroy(VideoEncData *video);
+    void MotionEstimationRows(VideoEncData *video, MEWorkData *work, Int start_i, Int incr_i, Int type_pred);
+
     /* defined in ME_utils.c */
     void ChooseMode_C(UChar *Mode, UChar *cur, Int lx, Int min_SAD);
     void ChooseMode_MMX(UChar *Mode, UChar *cur, Int lx, Int min_SAD);
@@ -221,6 +221,7 @@ typedef struct tagVideoEncParams
     Bool    RD_opt_Enabled;         /* Enable operational R-D optimization */
     Int     GOB_Header_Interval;        /* Enable encoding GOB header in H263_WITH_ERR_RES and SHORT_HERDER_WITH_ERR_RES */
     Int     SearchRange;            /* Search range for 16x16 motion vector */
+    Int     NumThreads;             /* Number of threads for motion estimation */
     Int     MemoryUsage;            /* Amount of memory allocated */
     Int     GetVolHeader[2];        /* Flag to check if Vol Header has been retrieved */
     Int     BufferSize[2];          /* Buffer Size for Base and Enhance Layers */
@@ -314,6 +315,19 @@ typedef struct tagHTFM_Stat
 } HTFM_Stat;
 #endif
 
+/* per-thread state of the P-VOP motion search */
+typedef struct tagMEWorkData
+{
+    Int totalSAD;       /* sum of SAD for rate control */
+    Int numIntra;       /* number of INTRA MBs */
+    Int max_mag;        /* MV range for f_code */
+    Int min_mag;
+#ifdef HTFM
+    HTFM_Stat *htfm_stat;
+#endif
+    UChar hp_mem4MV[17*17*4];
+} MEWorkData;
+
 /* Global structure that can be passed around */
 typedef struct tagVideoEncData
 {
@@ -359,6 +373,7 @@ typedef struct tagVideoEncData
 
     /* to speedup the SAD calculation */
     void *sad_extra_info;
+    void *meThreadPool;     /* workers for row-parallel motion estimation, NULL if single-threaded */
 #ifdef HTFM
     Int nrmlz_th[48];       /* Threshold for fast SAD calculation using HTFM */
     HTFM_Stat htfm_stat;    /* For statistics collection */
@@ -109,8 +109,11 @@ extern "C"
         Int sad = 0;
         UChar *p1;
         Int lx4 = (dmin_lx << 2) & 0x3FFFC;
+#ifndef SAD_HTFM_SIMD
         ULong cur_word;
-        Int saddata[16], tmp, tmp2;    /* used when collecting flag (global) is on */
+        Int tmp, tmp2;
+#endif
+        Int saddata[16];    /* used when collecting flag (global) is on */
         Int difmad;
         HTFM_Stat *htfm_stat = (HTFM_Stat*) extra_info;
         Int *abs_dif_mad_avg = &(htfm_stat->abs_dif_mad_avg);
@@ -123,6 +126,10 @@ extern "C"
         for (i = 0; i < 16; i++)
         {
             p1 = ref + offsetRef[i];
+#ifdef SAD_HTFM_SIMD
+            sad += sad_htfm_16(p1, blk + 4, lx4);
+            blk += 16;
+#else
             cur_word = *((ULong*)(blk += 4));
             tmp = p1[12];
             tmp2 = (cur_word >> 24) & 0xFF;
@@ -182,6 +189,7 @@ extern "C"
             p1 += lx4;
             tmp2 = (cur_word & 0xFF);
             sad = SUB_SAD(sad, tmp, tmp2);
+#endif
 
             NUM_SAD_MB();
 
@@ -211,12 +219,14 @@ extern "C"
         UChar *p1;
 
         Int i;
+#ifndef SAD_HTFM_SIMD
         Int tmp, tmp2;
+        ULong cur_word;
+#endif
         Int lx4 = (dmin_lx << 2) & 0x3FFFC;
         Int sadstar = 0, madstar;
         Int *nrmlz_th = (Int*) extra_info;
         Int *offsetRef = (Int*) extra_info + 32;
-        ULong cur_word;
 
         madstar = (ULong)dmin_lx >> 20;
 
@@ -226,6 +236,10 @@ extern "C"
         for (i = 0; i < 16; i++)
         {
             p1 = ref + offsetRef[i];
+#ifdef SAD_HTFM_SIMD
+            sad += sad_htfm_16(p1, blk + 4, lx4);
+            blk += 16;
+#else
             cur_word = *((ULong*)(blk += 4));
             tmp = p1[12];
             tmp2 = (cur_word >> 24) & 0xFF;
@@ -285,6 +299,7 @@ extern "C"
             p1 += lx4;
             tmp2 = (cur_word & 0xFF);
             sad = SUB_SAD(sad, tmp, tmp2);
+#endif
 
             NUM_SAD_MB();
 
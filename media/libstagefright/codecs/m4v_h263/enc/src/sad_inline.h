@@ -23,6 +23,14 @@
 #ifndef _SAD_INLINE_H_
 #define _SAD_INLINE_H_
 
+#if defined(HTFM) && defined(__SSE2__)
+#define SAD_HTFM_SIMD
+#include <emmintrin.h>
+#elif defined(HTFM) && (defined(__ARM_NEON__) || defined(__aarch64__))
+#define SAD_HTFM_SIMD
+#include <arm_neon.h>
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -531,6 +539,40 @@ SadMBOffset1:
 
 #endif // OS
 
+#ifdef SAD_HTFM_SIMD
+    /* SAD of the pixels p1[0], p1[4], p1[8], p1[12] of 4 rows lx4 apart against
+       16 bytes of the HTFM-interleaved macroblock, as one step of SAD_MB_HTFM.
+       16 bytes are loaded per row; the luma plane of a Vop is followed by its
+       chroma planes, so the 3 bytes past p1[12] are always readable. */
+    __inline int32 sad_htfm_16(UChar *p1, UChar *blk, Int lx4)
+    {
+#if defined(__SSE2__)
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        __m128i r0 = _mm_and_si128(_mm_loadu_si128((const __m128i*)p1), mask);
+        __m128i r1 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(p1 + lx4)), mask);
+        __m128i r2 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(p1 + 2 * lx4)), mask);
+        __m128i r3 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(p1 + 3 * lx4)), mask);
+        __m128i ref = _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3));
+        __m128i sad = _mm_sad_epu8(ref, _mm_loadu_si128((const __m128i*)blk));
+
+        return _mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4);
+#else
+        uint16x4_t r0 = vmovn_u32(vreinterpretq_u32_u8(vld1q_u8(p1)));
+        uint16x4_t r1 = vmovn_u32(vreinterpretq_u32_u8(vld1q_u8(p1 + lx4)));
+        uint16x4_t r2 = vmovn_u32(vreinterpretq_u32_u8(vld1q_u8(p1 + 2 * lx4)));
+        uint16x4_t r3 = vmovn_u32(vreinterpretq_u32_u8(vld1q_u8(p1 + 3 * lx4)));
+        uint16x8_t sad = vabdl_u8(vmovn_u16(vcombine_u16(r0, r1)), vld1_u8(blk));
+        sad = vabal_u8(sad, vmovn_u16(vcombine_u16(r2, r3)), vld1_u8(blk + 8));
+#if defined(__aarch64__)
+        return vaddvq_u16(sad);
+#else
+        uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(sad));
+        return (int32)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+#endif
+#endif
+    }
+#endif // SAD_HTFM_SIMD
+
 #ifdef __cplusplus
 }
 #endif
@@ -41,18 +41,20 @@ enum {
     kMaxBitrate       = 2048, // in kbps.
     kOutputBufferSize = 250 * 1024,
     kIDRFrameRefreshIntervalInSec = 1, // in seconds.
+    kMaxThreads       = 8,
 };
 
 int main(int argc, char *argv[]) {
 
     if (argc < 8) {
         fprintf(stderr, "Usage %s <input yuv> <output file> <mode> <width> "
-                        "<height> <frame rate> <bitrate in kbps>\n", argv[0]);
+                        "<height> <frame rate> <bitrate in kbps> [<threads>]\n", argv[0]);
         fprintf(stderr, "mode : h263 or mpeg4\n");
         fprintf(stderr, "Max width %d\n", kMaxWidth);
         fprintf(stderr, "Max height %d\n", kMaxHeight);
         fprintf(stderr, "Max framerate %d\n", kMaxFrameRate);
         fprintf(stderr, "Max bitrate %d kbps\n", kMaxBitrate);
+        fprintf(stderr, "Max threads %d\n", kMaxThreads);
         return EXIT_FAILURE;
     }
 
@@ -99,6 +101,16 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    // Read number of threads.
+    int32_t numThreads = 1;
+    if (argc > 8) {
+        numThreads = atoi(argv[8]);
+        if (numThreads > kMaxThreads || numThreads <= 0) {
+            fprintf(stderr, "Unsupported number of threads %d\n", numThreads);
+            return EXIT_FAILURE;
+        }
+    }
+
     // Allocate input buffer.
     uint8_t *inputBuf = (uint8_t *)malloc((width * height * 3) / 2);
     assert(inputBuf != NULL);
@@ -175,6 +187,7 @@ int main(int argc, char *argv[]) {
     encParams.gobHeaderInterval = 0;
     encParams.useACPred = PV_ON;
     encParams.intraDCVlcTh = 0;
+    encParams.numThreads = numThreads;
 
     // Initialize the handle.
     tagvideoEncControls handle;
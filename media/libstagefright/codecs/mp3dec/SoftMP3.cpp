@@ -20,6 +20,7 @@
 
 #include "SoftMP3.h"
 
+#include <audio_utils/primitives.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaDefs.h>
 
@@ -49,6 +50,7 @@ SoftMP3::SoftMP3(
       mNumChannels(2),
       mSamplingRate(44100),
       mSignalledError(false),
+      mOutputFloat(false),
       mSawInputEos(false),
       mSignalledOutputEos(false),
       mOutputPortSettingsChange(NONE) {
@@ -147,10 +149,11 @@ OMX_ERRORTYPE SoftMP3::internalGetParameter(
                 return OMX_ErrorUndefined;
             }
 
-            pcmParams->eNumData = OMX_NumericalDataSigned;
+            pcmParams->eNumData =
+                    mOutputFloat ? OMX_NumericalDataFloat : OMX_NumericalDataSigned;
             pcmParams->eEndian = OMX_EndianBig;
             pcmParams->bInterleaved = OMX_TRUE;
-            pcmParams->nBitPerSample = 16;
+            pcmParams->nBitPerSample = 8 * outputSampleSize();
             pcmParams->ePCMMode = OMX_AUDIO_PCMModeLinear;
             pcmParams->eChannelMapping[0] = OMX_AUDIO_ChannelLF;
             pcmParams->eChannelMapping[1] = OMX_AUDIO_ChannelRF;
@@ -221,6 +224,19 @@ OMX_ERRORTYPE SoftMP3::internalSetParameter(
                 return OMX_ErrorUndefined;
             }
 
+            // the decoder only produces 16-bit PCM; float output is converted from it.
+            if (pcmParams->eNumData == OMX_NumericalDataFloat
+                    && pcmParams->nBitPerSample == 32) {
+                mOutputFloat = true;
+            } else if (pcmParams->eNumData == OMX_NumericalDataSigned
+                    && pcmParams->nBitPerSample == 16) {
+                mOutputFloat = false;
+            } else {
+                return OMX_ErrorUnsupportedSetting;
+            }
+            editPortInfo(1)->mDef.nBufferSize =
+                    kOutputBufferSize / sizeof(int16_t) * outputSampleSize();
+
             mNumChannels = pcmParams->nChannels;
             mSamplingRate = pcmParams->nSamplingRate;
 
@@ -274,7 +290,9 @@ void SoftMP3::onQueueFilled(OMX_U32 /* portIndex */) {
         mConfig->inputBufferUsedLength = 0;
 
         mConfig->outputFrameSize = kOutputBufferSize / sizeof(int16_t);
-        if ((int32_t)outHeader->nAllocLen < mConfig->outputFrameSize) {
+        if ((int32_t)outHeader->nAllocLen < mConfig->outputFrameSize
+                || (mOutputFloat && outHeader->nAllocLen
+                        < mConfig->outputFrameSize * sizeof(float))) {
             ALOGE("input buffer too small: got %u, expected %u",
                 outHeader->nAllocLen, mConfig->outputFrameSize);
             android_errorWriteLog(0x534e4554, "27793371");
@@ -309,7 +327,8 @@ void SoftMP3::onQueueFilled(OMX_U32 /* portIndex */) {
                     // pad the end of the stream with 529 samples, since that many samples
                     // were trimmed off the beginning when decoding started
                     outHeader->nOffset = 0;
-                    outHeader->nFilledLen = kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
+                    outHeader->nFilledLen =
+                        kPVMP3DecoderDelay * mNumChannels * outputSampleSize();
 
                     if (!memsetSafe(outHeader, 0, outHeader->nFilledLen)) {
                         return;
@@ -326,7 +345,7 @@ void SoftMP3::onQueueFilled(OMX_U32 /* portIndex */) {
                 // if mIsFirst is true as we may not have a valid
                 // mConfig->samplingRate and mConfig->num_channels?
                 ALOGV_IF(mIsFirst, "insufficient data for first frame, sending silence");
-                if (!memsetSafe(outHeader, 0, mConfig->outputFrameSize * sizeof(int16_t))) {
+                if (!memsetSafe(outHeader, 0, mConfig->outputFrameSize * outputSampleSize())) {
                     return;
                 }
 
@@ -344,19 +363,25 @@ void SoftMP3::onQueueFilled(OMX_U32 /* portIndex */) {
             return;
         }
 
+        if (mOutputFloat && decoderErr == NO_DECODING_ERROR) {
+            // expand in place, the 16-bit samples occupy the first half of the buffer
+            memcpy_to_float_from_i16((float *)outHeader->pBuffer,
+                    (const int16_t *)outHeader->pBuffer, mConfig->outputFrameSize);
+        }
+
         if (mIsFirst) {
             mIsFirst = false;
             // The decoder delay is 529 samples, so trim that many samples off
             // the start of the first output buffer. This essentially makes this
             // decoder have zero delay, which the rest of the pipeline assumes.
             outHeader->nOffset =
-                kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
+                kPVMP3DecoderDelay * mNumChannels * outputSampleSize();
 
             outHeader->nFilledLen =
-                mConfig->outputFrameSize * sizeof(int16_t) - outHeader->nOffset;
+                mConfig->outputFrameSize * outputSampleSize() - outHeader->nOffset;
         } else if (!mSignalledOutputEos) {
             outHeader->nOffset = 0;
-            outHeader->nFilledLen = mConfig->outputFrameSize * sizeof(int16_t);
+            outHeader->nFilledLen = mConfig->outputFrameSize * outputSampleSize();
         }
 
         outHeader->nTimeStamp =
@@ -61,6 +61,7 @@ private:
 
     bool mIsFirst;
     bool mSignalledError;
+    bool mOutputFloat;  // output float PCM instead of 16-bit PCM
     bool mSawInputEos;
     bool mSignalledOutputEos;
 
@@ -74,6 +75,10 @@ private:
     void initDecoder();
     void *memsetSafe(OMX_BUFFERHEADERTYPE *outHeader, int c, size_t len);
 
+    size_t outputSampleSize() const {
+        return mOutputFloat ? sizeof(float) : sizeof(int16_t);
+    }
+
     DISALLOW_EVIL_CONSTRUCTORS(SoftMP3);
 };
 
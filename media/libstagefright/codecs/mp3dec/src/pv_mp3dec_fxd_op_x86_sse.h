@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SSE4.1 counterparts of the fixed point operations in
+ * pv_mp3dec_fxd_op_c_equivalent.h, four lanes at a time.
+ *
+ * Each lane computes exactly what the scalar operation computes: the high 32 bits
+ * of the full 64-bit product, with 32-bit wrap-around accumulation. Kernels using
+ * these are therefore bit-exact with the C code, whatever order they accumulate in.
+ *
+ * Functions using these must be compiled with PV_MP3DEC_SSE41_TARGET, and only be
+ * called after pv_mp3dec_has_sse41() returned true.
+ */
+
+#ifndef PV_MP3DEC_FXD_OP_X86_SSE_H
+#define PV_MP3DEC_FXD_OP_X86_SSE_H
+
+#if (defined(__i386__) || defined(__x86_64__)) && !defined(PV_MP3DEC_NO_SSE41)
+
+#define PV_MP3DEC_SSE41
+
+#include <smmintrin.h>
+
+#define PV_MP3DEC_SSE41_TARGET __attribute__((target("sse4.1")))
+
+static inline bool pv_mp3dec_has_sse41()
+{
+    static const bool hasSse41 = __builtin_cpu_supports("sse4.1");
+    return hasSse41;
+}
+
+/* fxp_mul32_Q32 per lane: (int32)(((int64)a * b) >> 32) */
+PV_MP3DEC_SSE41_TARGET
+static inline __m128i fxp_mul32_Q32_x4(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epi32(a, b);
+    __m128i odd  = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC);
+}
+
+PV_MP3DEC_SSE41_TARGET
+static inline __m128i fxp_mac32_Q32_x4(__m128i L_add, __m128i a, __m128i b)
+{
+    return _mm_add_epi32(L_add, fxp_mul32_Q32_x4(a, b));
+}
+
+PV_MP3DEC_SSE41_TARGET
+static inline __m128i fxp_msb32_Q32_x4(__m128i L_sub, __m128i a, __m128i b)
+{
+    return _mm_sub_epi32(L_sub, fxp_mul32_Q32_x4(a, b));
+}
+
+/* Load 4 values ending at p[0] in reverse order: { p[0], p[-1], p[-2], p[-3] } */
+PV_MP3DEC_SSE41_TARGET
+static inline __m128i load_reversed_x4(const int32 *p)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *)(p - 3));
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+PV_MP3DEC_SSE41_TARGET
+static inline void store_reversed_x4(int32 *p, __m128i v)
+{
+    _mm_storeu_si128((__m128i *)(p - 3), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+}
+
+#endif
+
+#endif  /* PV_MP3DEC_FXD_OP_X86_SSE_H */
@@ -94,6 +94,7 @@ Input
 
 #include "pvmp3_alias_reduction.h"
 #include "pv_mp3dec_fxd_op.h"
+#include "pv_mp3dec_fxd_op_x86_sse.h"
 
 
 /*----------------------------------------------------------------------------
@@ -154,6 +155,43 @@ const int32 c_alias [ NUM_BUTTERFLIES ] =
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
 
+#ifdef PV_MP3DEC_SSE41
+
+/*
+ *  Same butterflies as the C loop below, one sub-band boundary at a time: the
+ *  8 lower values just below the boundary (in reverse) and the 8 upper values
+ *  just above it form two vectors of 4 butterflies each.
+ */
+PV_MP3DEC_SSE41_TARGET
+static void pvmp3_alias_reduction_sse41(int32 *input_buffer, int32 sblim)
+{
+    const __m128i csi_lo = _mm_loadu_si128((const __m128i *)&c_signal[0]);
+    const __m128i csi_hi = _mm_loadu_si128((const __m128i *)&c_signal[4]);
+    const __m128i csa_lo = _mm_loadu_si128((const __m128i *)&c_alias[0]);
+    const __m128i csa_hi = _mm_loadu_si128((const __m128i *)&c_alias[4]);
+
+    for (int32 sb = 1; sb <= sblim; sb++)
+    {
+        int32 *lower = &input_buffer[18 * sb - 1];
+        int32 *upper = &input_buffer[18 * sb];
+
+        for (int32 h = 0; h < 2; h++)
+        {
+            const __m128i csi = h ? csi_hi : csi_lo;
+            const __m128i csa = h ? csa_hi : csa_lo;
+            __m128i x = _mm_slli_epi32(load_reversed_x4(lower - 4 * h), 1);
+            __m128i y = _mm_slli_epi32(_mm_loadu_si128((const __m128i *)(upper + 4 * h)), 1);
+
+            store_reversed_x4(lower - 4 * h,
+                              fxp_msb32_Q32_x4(fxp_mul32_Q32_x4(x, csi), y, csa));
+            _mm_storeu_si128((__m128i *)(upper + 4 * h),
+                             fxp_mac32_Q32_x4(fxp_mul32_Q32_x4(y, csi), x, csa));
+        }
+    }
+}
+
+#endif // PV_MP3DEC_SSE41
+
 void pvmp3_alias_reduction(int32 *input_buffer,         /* Ptr to spec values of current channel */
                            granuleInfo *gr_info,
                            int32  *used_freq_lines,
@@ -195,6 +233,14 @@ void pvmp3_alias_reduction(int32 *input_buffer,         /* Ptr to spec values of
     }
 
 
+#ifdef PV_MP3DEC_SSE41
+    if (pv_mp3dec_has_sse41())
+    {
+        pvmp3_alias_reduction_sse41(input_buffer, sblim);
+        return;
+    }
+#endif
+
     ptr3 = &input_buffer[17];
     ptr4 = &input_buffer[18];
     ptr_csi = c_signal;
@@ -75,6 +75,7 @@ Input
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_dec_defs.h"
 #include "pvmp3_tables.h"
+#include "pv_mp3dec_fxd_op_x86_sse.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -112,17 +113,22 @@ Input
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
 
-void pvmp3_polyphase_filter_window(int32 *synth_buffer,
-                                   int16 *outPcm,
-                                   int32 numChannels)
+/*
+ *  Scalar window for the subband pairs j = first_subband..15, followed by the
+ *  two middle outputs. The SIMD version only hands the last pairs over to it.
+ */
+static void pvmp3_polyphase_filter_window_from(int32 *synth_buffer,
+        int16 *outPcm,
+        int32 numChannels,
+        int32 first_subband)
 {
     int32 sum1;
     int32 sum2;
-    const int32 *winPtr = pqmfSynthWin;
+    const int32 *winPtr = &pqmfSynthWin[(first_subband - 1) << 4];
     int32 i;
 
 
-    for (int16 j = 1; j < SUBBANDS_NUMBER / 2; j++)
+    for (int32 j = first_subband; j < SUBBANDS_NUMBER / 2; j++)
     {
         sum1 = 0x00000020;
         sum2 = 0x00000020;
@@ -231,8 +237,112 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
 
     outPcm[0] = saturate16(sum1 >> 6);
     outPcm[(SUBBANDS_NUMBER/2)<<(numChannels-1)] = saturate16(sum2 >> 6);
+}
+
+#ifdef PV_MP3DEC_SSE41
+
+/*
+ *  Window coefficients for j = 1..12, regrouped so that coefficient n of four
+ *  consecutive j's forms one vector.
+ */
+struct TransposedSynthWin
+{
+    alignas(16) int32 coef[3][16][4];
+
+    TransposedSynthWin()
+    {
+        for (int32 g = 0; g < 3; g++)
+        {
+            for (int32 n = 0; n < 16; n++)
+            {
+                for (int32 l = 0; l < 4; l++)
+                {
+                    coef[g][n][l] = pqmfSynthWin[((g << 2) + l) * 16 + n];
+                }
+            }
+        }
+    }
+};
+
+/*
+ *  Same computation as pvmp3_polyphase_filter_window_from(). Subband pairs j = 1..12 are computed
+ *  four at a time: synth_buffer[i + j] for consecutive j are adjacent, and
+ *  synth_buffer[i - j] are adjacent in reverse.
+ */
+PV_MP3DEC_SSE41_TARGET
+static void pvmp3_polyphase_filter_window_sse41(int32 *synth_buffer,
+        int16 *outPcm,
+        int32 numChannels)
+{
+    static const TransposedSynthWin transposed;
+
+    const int32 i = SUBBANDS_NUMBER >> 1;
+    const __m128i rounding = _mm_set1_epi32(0x00000020);
+    int32 j;
+
+    for (j = 1; j < 13; j += 4)
+    {
+        const __m128i *win = (const __m128i *)transposed.coef[(j - 1) >> 2];
+        const int32 *pt_1 = &synth_buffer[i + j];
+        const int32 *pt_2 = &synth_buffer[i - j];
+        __m128i sum1 = rounding;
+        __m128i sum2 = rounding;
+
+        for (int32 g = 0; g < 4; g++)
+        {
+            __m128i temp1 = _mm_loadu_si128((const __m128i *)&pt_1[SUBBANDS_NUMBER * (2 * g)]);
+            __m128i temp3 = load_reversed_x4(&pt_2[SUBBANDS_NUMBER * (15 - 2 * g)]);
+            __m128i temp2 = load_reversed_x4(&pt_2[SUBBANDS_NUMBER * (2 * g + 1)]);
+            __m128i temp4 = _mm_loadu_si128((const __m128i *)&pt_1[SUBBANDS_NUMBER * (14 - 2 * g)]);
+            __m128i w0 = _mm_load_si128(&win[4 * g]);
+            __m128i w1 = _mm_load_si128(&win[4 * g + 1]);
+            __m128i w2 = _mm_load_si128(&win[4 * g + 2]);
+            __m128i w3 = _mm_load_si128(&win[4 * g + 3]);
+
+            sum1 = fxp_mac32_Q32_x4(sum1, temp1, w0);
+            sum2 = fxp_mac32_Q32_x4(sum2, temp3, w0);
+            sum2 = fxp_mac32_Q32_x4(sum2, temp1, w1);
+            sum1 = fxp_msb32_Q32_x4(sum1, temp3, w1);
+            sum1 = fxp_mac32_Q32_x4(sum1, temp2, w2);
+            sum2 = fxp_msb32_Q32_x4(sum2, temp4, w2);
+            sum2 = fxp_mac32_Q32_x4(sum2, temp2, w3);
+            sum1 = fxp_mac32_Q32_x4(sum1, temp4, w3);
+        }
+
+        /* saturate16() clamps like the signed pack */
+        __m128i pcm = _mm_packs_epi32(_mm_srai_epi32(sum1, 6), _mm_srai_epi32(sum2, 6));
+        int32 k = j << (numChannels - 1);
+        int32 step = 1 << (numChannels - 1);
+        int32 mirror = numChannels << 5;
+        outPcm[k]                     = (int16)_mm_extract_epi16(pcm, 0);
+        outPcm[k + step]              = (int16)_mm_extract_epi16(pcm, 1);
+        outPcm[k + 2 * step]          = (int16)_mm_extract_epi16(pcm, 2);
+        outPcm[k + 3 * step]          = (int16)_mm_extract_epi16(pcm, 3);
+        outPcm[mirror - k]            = (int16)_mm_extract_epi16(pcm, 4);
+        outPcm[mirror - k - step]     = (int16)_mm_extract_epi16(pcm, 5);
+        outPcm[mirror - k - 2 * step] = (int16)_mm_extract_epi16(pcm, 6);
+        outPcm[mirror - k - 3 * step] = (int16)_mm_extract_epi16(pcm, 7);
+    }
 
+    /* j = 13..15 and the middle outputs */
+    pvmp3_polyphase_filter_window_from(synth_buffer, outPcm, numChannels, j);
+}
+
+#endif // PV_MP3DEC_SSE41
+
+void pvmp3_polyphase_filter_window(int32 *synth_buffer,
+                                   int16 *outPcm,
+                                   int32 numChannels)
+{
+#ifdef PV_MP3DEC_SSE41
+    if (pv_mp3dec_has_sse41())
+    {
+        pvmp3_polyphase_filter_window_sse41(synth_buffer, outPcm, numChannels);
+        return;
+    }
+#endif
 
+    pvmp3_polyphase_filter_window_from(synth_buffer, outPcm, numChannels, 1);
 }
 
 #endif // If not assembly
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Micro-benchmarks for the decoder kernels that have SIMD versions. The same
+ * source is built twice, as mp3dec_kernel_benchmark and, with PV_MP3DEC_NO_SSE41,
+ * as mp3dec_kernel_benchmark_scalar. Each benchmark labels its result with a
+ * checksum of one pass over fixed input, so the two builds must report the same
+ * labels.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <benchmark/benchmark.h>
+
+#include "pvmp3_alias_reduction.h"
+#include "pvmp3_dec_defs.h"
+#include "pvmp3_polyphase_filter_window.h"
+
+// Same layout as tmp3dec_chan::circ_buffer
+static const int kCircBufferSize = 480 + 576;
+
+static void fillRandom(int32 *buffer, size_t count, uint32_t seed)
+{
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525 + 1013904223;
+        // Subband samples stay well inside Q31 after the DCT
+        buffer[i] = (int32) seed >> 4;
+    }
+}
+
+static uint32_t checksum(const void *data, size_t size)
+{
+    // FNV-1a
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void setChecksumLabel(benchmark::State& state, uint32_t sum)
+{
+    char label[16];
+    snprintf(label, sizeof(label), "%08x", sum);
+    state.SetLabel(label);
+}
+
+// The 18 window steps of one granule, as pvmp3_poly_phase_synthesis() runs them
+static void windowGranule(int32 *circBuffer, int16 *outPcm, int32 numChannels)
+{
+    for (int32 band = 0; band < FILTERBANK_BANDS; band++) {
+        pvmp3_polyphase_filter_window(&circBuffer[544 - (band << 5)],
+                                      &outPcm[band * (numChannels << 5)],
+                                      numChannels);
+    }
+}
+
+static void BM_PolyphaseFilterWindow(benchmark::State& state)
+{
+    const int32 numChannels = state.range(0);
+    int32 circBuffer[kCircBufferSize];
+    int16 outPcm[FILTERBANK_BANDS * SUBBANDS_NUMBER * 2];
+    fillRandom(circBuffer, kCircBufferSize, 1);
+    memset(outPcm, 0, sizeof(outPcm));
+
+    windowGranule(circBuffer, outPcm, numChannels);
+    uint32_t sum = checksum(outPcm, sizeof(outPcm));
+
+    while (state.KeepRunning()) {
+        windowGranule(circBuffer, outPcm, numChannels);
+        benchmark::DoNotOptimize(outPcm);
+    }
+    state.SetItemsProcessed(state.iterations() * FILTERBANK_BANDS * SUBBANDS_NUMBER);
+    setChecksumLabel(state, sum);
+}
+BENCHMARK(BM_PolyphaseFilterWindow)->Arg(1)->Arg(2);
+
+static void BM_AliasReduction(benchmark::State& state)
+{
+    int32 input[SUBBANDS_NUMBER * FILTERBANK_BANDS];
+    int32 reference[SUBBANDS_NUMBER * FILTERBANK_BANDS];
+    granuleInfo grInfo;
+    mp3Header info;
+    memset(&grInfo, 0, sizeof(grInfo));
+    memset(&info, 0, sizeof(info));
+    fillRandom(reference, SUBBANDS_NUMBER * FILTERBANK_BANDS, 2);
+
+    // All 575 boundaries of a long block granule
+    int32 usedFreqLines = SUBBANDS_NUMBER * FILTERBANK_BANDS - 1;
+    memcpy(input, reference, sizeof(input));
+    pvmp3_alias_reduction(input, &grInfo, &usedFreqLines, &info);
+    uint32_t sum = checksum(input, sizeof(input));
+
+    while (state.KeepRunning()) {
+        // the reduction works in place, restart from the same input every time
+        memcpy(input, reference, sizeof(input));
+        usedFreqLines = SUBBANDS_NUMBER * FILTERBANK_BANDS - 1;
+        pvmp3_alias_reduction(input, &grInfo, &usedFreqLines, &info);
+        benchmark::DoNotOptimize(input);
+    }
+    state.SetItemsProcessed(state.iterations() * (SUBBANDS_NUMBER - 1));
+    setChecksumLabel(state, sum);
+}
+BENCHMARK(BM_AliasReduction);
+
+BENCHMARK_MAIN();
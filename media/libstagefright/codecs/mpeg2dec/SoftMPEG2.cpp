@@ -71,7 +71,10 @@ SoftMPEG2::SoftMPEG2(
       mNewHeight(mHeight),
       mChangingResolution(false),
       mSignalledError(false),
-      mStride(mWidth) {
+      mStride(mWidth),
+      mShareOutputBuffers(sharedOutputBuffersAllowed()),
+      mDisplayBuffersSet(false),
+      mNumDisplayBuffers(0) {
     initPorts(kNumBuffers, INPUT_BUF_SIZE, kNumBuffers, CODEC_MIME_TYPE);
 
     // If input dump is enabled, then open create an empty file
@@ -205,6 +208,10 @@ status_t SoftMPEG2::resetDecoder() {
     mStride = 0;
     mSignalledError = false;
 
+    /* The codec forgets the display buffers on reset */
+    mDisplayBuffersSet = false;
+    clearSharedOutputBuffers();
+
     return OK;
 }
 
@@ -265,7 +272,7 @@ status_t SoftMPEG2::initDecoder() {
     /* Initialize number of ref and reorder modes (for MPEG2) */
     u4_num_reorder_frames = 16;
     u4_num_ref_frames = 16;
-    u4_share_disp_buf = 0;
+    u4_share_disp_buf = mShareOutputBuffers ? 1 : 0;
 
     uint32_t displayStride = outputBufferWidth();
     uint32_t displayHeight = outputBufferHeight();
@@ -406,9 +413,134 @@ status_t SoftMPEG2::initDecoder() {
 
     mInitNeeded = false;
     mFlushNeeded = false;
+    mDisplayBuffersSet = false;
+    clearSharedOutputBuffers();
+
+    if (mShareOutputBuffers && !canShareOutputBuffers()) {
+        ALOGI("Cannot decode into the output buffers, copying frames instead");
+        mShareOutputBuffers = false;
+        deInitDecoder();
+        return initDecoder();
+    }
     return OK;
 }
 
+bool SoftMPEG2::canShareOutputBuffers() {
+    ivd_ctl_getbufinfo_ip_t s_ctl_ip;
+    ivd_ctl_getbufinfo_op_t s_ctl_op;
+    ivd_set_display_frame_ip_t s_set_disp_ip;
+    IV_API_CALL_STATUS_T status;
+
+    s_ctl_ip.e_cmd = IVD_CMD_VIDEO_CTL;
+    s_ctl_ip.e_sub_cmd = IVD_CMD_CTL_GETBUFINFO;
+    s_ctl_ip.u4_size = sizeof(ivd_ctl_getbufinfo_ip_t);
+    s_ctl_op.u4_size = sizeof(ivd_ctl_getbufinfo_op_t);
+
+    status = ivdec_api_function(mCodecCtx, (void *)&s_ctl_ip, (void *)&s_ctl_op);
+    if (status != IV_SUCCESS) {
+        ALOGE("Error in getting buffer info: 0x%x", s_ctl_op.u4_error_code);
+        return false;
+    }
+
+    /* The codec asks for a single display buffer when it does not share them,
+     * e.g. for output formats it has to convert to */
+    mNumDisplayBuffers = s_ctl_op.u4_num_disp_bufs;
+    if (mNumDisplayBuffers <= 1) {
+        return false;
+    }
+
+    /* Keep at least one buffer for the client to render from */
+    size_t numOutputBuffers = editPortInfo(kOutputPortIndex)->mDef.nBufferCountActual;
+    if (mNumDisplayBuffers >= numOutputBuffers
+            || mNumDisplayBuffers > ARRAY_SIZE(s_set_disp_ip.s_disp_buffer)) {
+        ALOGV("Codec needs %zu display buffers, have %zu",
+                mNumDisplayBuffers, numOutputBuffers);
+        return false;
+    }
+
+    /* The codec writes the frames with our stride, but may need its rows aligned
+     * and its planes no larger than ours */
+    size_t sizeY = outputBufferWidth() * outputBufferHeight();
+    size_t sizeUV = sizeY / 4;
+    if ((outputBufferWidth() & 15) != 0
+            || s_ctl_op.u4_min_out_buf_size[0] > sizeY
+            || s_ctl_op.u4_min_out_buf_size[1] > sizeUV
+            || s_ctl_op.u4_min_out_buf_size[2] > sizeUV) {
+        return false;
+    }
+    return true;
+}
+
+status_t SoftMPEG2::setDisplayBuffers() {
+    ivd_set_display_frame_ip_t s_set_disp_ip;
+    ivd_set_display_frame_op_t s_set_disp_op;
+    IV_API_CALL_STATUS_T status;
+    size_t sizeY = outputBufferWidth() * outputBufferHeight();
+    size_t sizeUV = sizeY / 4;
+
+    /* The codec only ever gets the buffers registered here, so wait for all output
+     * buffers, or at least for the ones the client queued before its first input.
+     * Registering just mNumDisplayBuffers would stall as soon as the client holds one. */
+    size_t numOwned = getPortQueue(kOutputPortIndex).size();
+    if (numOwned < mNumDisplayBuffers
+            || (numOwned < editPortInfo(kOutputPortIndex)->mDef.nBufferCountActual
+                    && getPortQueue(kInputPortIndex).empty())) {
+        return WOULD_BLOCK;
+    }
+
+    size_t numBuffers = registerSharedOutputBuffers(ARRAY_SIZE(s_set_disp_ip.s_disp_buffer));
+    for (size_t i = 0; i < numBuffers; i++) {
+        OMX_BUFFERHEADERTYPE *header = sharedOutputBuffer(i);
+        ivd_out_bufdesc_t *ps_disp_buf = &s_set_disp_ip.s_disp_buffer[i];
+
+        if (header->nAllocLen < sizeY + (sizeUV * 2)
+                || ((uintptr_t)header->pBuffer & 15) != 0) {
+            clearSharedOutputBuffers();
+            return BAD_VALUE;
+        }
+
+        ps_disp_buf->u4_min_out_buf_size[0] = sizeY;
+        ps_disp_buf->u4_min_out_buf_size[1] = sizeUV;
+        ps_disp_buf->u4_min_out_buf_size[2] = sizeUV;
+        ps_disp_buf->pu1_bufs[0] = header->pBuffer;
+        ps_disp_buf->pu1_bufs[1] = header->pBuffer + sizeY;
+        ps_disp_buf->pu1_bufs[2] = header->pBuffer + sizeY + sizeUV;
+        ps_disp_buf->u4_num_bufs = 3;
+    }
+
+    s_set_disp_ip.e_cmd = IVD_CMD_SET_DISPLAY_FRAME;
+    s_set_disp_ip.u4_size = sizeof(ivd_set_display_frame_ip_t);
+    s_set_disp_ip.num_disp_bufs = numBuffers;
+    s_set_disp_op.u4_size = sizeof(ivd_set_display_frame_op_t);
+
+    status = ivdec_api_function(mCodecCtx, (void *)&s_set_disp_ip, (void *)&s_set_disp_op);
+    if (status != IV_SUCCESS) {
+        ALOGE("Error in setting the display buffers: 0x%x", s_set_disp_op.u4_error_code);
+        clearSharedOutputBuffers();
+        return UNKNOWN_ERROR;
+    }
+
+    ALOGV("Decoding into %zu output buffers", numBuffers);
+    mDisplayBuffersSet = true;
+    return OK;
+}
+
+void SoftMPEG2::releaseSharedOutputBuffer(size_t id) {
+    ivd_rel_display_frame_ip_t s_rel_ip;
+    ivd_rel_display_frame_op_t s_rel_op;
+    IV_API_CALL_STATUS_T status;
+
+    s_rel_ip.e_cmd = IVD_CMD_REL_DISPLAY_FRAME;
+    s_rel_ip.u4_size = sizeof(ivd_rel_display_frame_ip_t);
+    s_rel_ip.u4_disp_buf_id = id;
+    s_rel_op.u4_size = sizeof(ivd_rel_display_frame_op_t);
+
+    status = ivdec_api_function(mCodecCtx, (void *)&s_rel_ip, (void *)&s_rel_op);
+    if (status != IV_SUCCESS) {
+        ALOGE("Error in releasing display buffer %zu: 0x%x", id, s_rel_op.u4_error_code);
+    }
+}
+
 status_t SoftMPEG2::deInitDecoder() {
     size_t i;
 
@@ -434,6 +566,8 @@ status_t SoftMPEG2::deInitDecoder() {
     mInitNeeded = true;
     mChangingResolution = false;
     mCodecCtx = NULL;
+    mDisplayBuffersSet = false;
+    clearSharedOutputBuffers();
 
     return OK;
 }
@@ -582,6 +716,12 @@ void SoftMPEG2::onPortFlushCompleted(OMX_U32 portIndex) {
                 break;
             }
         }
+
+        /* The client has all output buffers now, give the codec the ones it
+         * returns from scratch */
+        if (mShareOutputBuffers) {
+            resetDecoder();
+        }
     }
 }
 
@@ -613,6 +753,34 @@ void SoftMPEG2::onQueueFilled(OMX_U32 portIndex) {
         setParams(mStride);
     }
 
+    if (mShareOutputBuffers && !mInitNeeded) {
+        if (numSharedOutputBuffers() == 0) {
+            /* The output buffers changed under the codec */
+            if (mDisplayBuffersSet) {
+                resetDecoder();
+                mStride = outputBufferWidth();
+                setParams(mStride);
+            }
+
+            status_t err = setDisplayBuffers();
+            if (err == WOULD_BLOCK) {
+                return;
+            } else if (err != OK) {
+                ALOGI("Cannot decode into the output buffers, copying frames instead");
+                mShareOutputBuffers = false;
+                if (OK != reInitDecoder()) {
+                    ALOGE("Failed to reinitialize decoder");
+                    notify(OMX_EventError, OMX_ErrorUnsupportedSetting, 0, NULL);
+                    mSignalledError = true;
+                    return;
+                }
+            }
+        }
+
+        /* Hand back the buffers the client returned since the last call */
+        releaseSharedOutputBuffers();
+    }
+
     while (!outQueue.empty()) {
         BufferInfo *inInfo;
         OMX_BUFFERHEADERTYPE *inHeader;
@@ -631,6 +799,12 @@ void SoftMPEG2::onQueueFilled(OMX_U32 portIndex) {
             } else {
                 break;
             }
+
+            /* The codec needs this many free or reference buffers to decode into */
+            if (mShareOutputBuffers && mDisplayBuffersSet
+                    && numSharedOutputBuffersWithCodec() < mNumDisplayBuffers) {
+                break;
+            }
         }
 
         outInfo = *outQueue.begin();
@@ -736,7 +910,10 @@ void SoftMPEG2::onQueueFilled(OMX_U32 portIndex) {
                     return;
                 }
 
-                if (setDecodeArgs(&s_dec_ip, &s_dec_op, inHeader, outHeader, timeStampIx)) {
+                /* In shared mode the codec has no display buffers yet, it parses
+                 * the same input again once they are set */
+                if (!mShareOutputBuffers
+                        && setDecodeArgs(&s_dec_ip, &s_dec_op, inHeader, outHeader, timeStampIx)) {
                     ivdec_api_function(mCodecCtx, (void *)&s_dec_ip, (void *)&s_dec_op);
                 }
                 return;
@@ -789,12 +966,30 @@ void SoftMPEG2::onQueueFilled(OMX_U32 portIndex) {
 
             if (s_dec_op.u4_output_present) {
                 ssize_t timeStampIdx;
+
+                if (mShareOutputBuffers) {
+                    /* The frame was decoded in place, in one of the buffers we own */
+                    outInfo = takeSharedOutputBuffer(s_dec_op.u4_disp_buf_id);
+                    if (outInfo == NULL) {
+                        ALOGE("Invalid display buffer %u", s_dec_op.u4_disp_buf_id);
+                        notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+                        mSignalledError = true;
+                        return;
+                    }
+                    outHeader = outInfo->mHeader;
+                    outHeader->nFlags = 0;
+                    outHeader->nOffset = 0;
+                }
                 outHeader->nFilledLen = (mWidth * mHeight * 3) / 2;
 
                 timeStampIdx = getMinTimestampIdx(mTimeStamps, mTimeStampsValid);
                 if (timeStampIdx < 0) {
                     ALOGE("b/62872863, Invalid timestamp index!");
                     android_errorWriteLog(0x534e4554, "62872863");
+                    if (mShareOutputBuffers) {
+                        outQueue.push_front(outInfo);
+                        releaseSharedOutputBuffers();
+                    }
                     return;
                 }
                 outHeader->nTimeStamp = mTimeStamps[timeStampIdx];
@@ -806,12 +1001,19 @@ void SoftMPEG2::onQueueFilled(OMX_U32 portIndex) {
 
                 if (mWaitForI) {
                     s_dec_op.u4_output_present = false;
+                    if (mShareOutputBuffers) {
+                        /* Not shown, the codec can have it back right away */
+                        outQueue.push_front(outInfo);
+                        releaseSharedOutputBuffers();
+                    }
                 } else {
                     ALOGV("Output timestamp: %lld, res: %ux%u",
                             (long long)outHeader->nTimeStamp, mWidth, mHeight);
                     DUMP_TO_FILE(mOutFile, outHeader->pBuffer, outHeader->nFilledLen);
                     outInfo->mOwnedByUs = false;
-                    outQueue.erase(outQueue.begin());
+                    if (!mShareOutputBuffers) {
+                        outQueue.erase(outQueue.begin());
+                    }
                     outInfo = NULL;
                     notifyFillBufferDone(outHeader);
                     outHeader = NULL;
@@ -833,6 +1035,11 @@ void SoftMPEG2::onQueueFilled(OMX_U32 portIndex) {
                     notifyFillBufferDone(outHeader);
                     outHeader = NULL;
                     resetPlugin();
+
+                    /* The codec may still count the EOS buffer as free */
+                    if (mShareOutputBuffers) {
+                        resetDecoder();
+                    }
                 }
             }
         }
@@ -65,6 +65,7 @@ protected:
     virtual void onReset();
     virtual int getColorAspectPreference();
     virtual OMX_ERRORTYPE internalSetParameter(OMX_INDEXTYPE index, const OMX_PTR params);
+    virtual void releaseSharedOutputBuffer(size_t id);
 private:
     // Number of input and output buffers
     enum {
@@ -110,6 +111,14 @@ private:
     bool mWaitForI;
     size_t mStride;
 
+    // The codec decodes into the output buffers (shared display buffer mode) instead
+    // of copying each frame out of its own buffers.
+    bool mShareOutputBuffers;
+    // The output buffers were given to the codec since it was last initialized or reset.
+    bool mDisplayBuffersSet;
+    // Number of display buffers the codec uses at a time in shared mode.
+    size_t mNumDisplayBuffers;
+
     status_t initDecoder();
     status_t deInitDecoder();
     status_t setFlushMode();
@@ -119,6 +128,8 @@ private:
     status_t resetDecoder();
     status_t resetPlugin();
     status_t reInitDecoder();
+    bool canShareOutputBuffers();
+    status_t setDisplayBuffers();
 
     bool setDecodeArgs(
             ivd_video_decode_ip_t *ps_dec_ip,
@@ -27,6 +27,7 @@
 #include <media/hardware/HardwareAPI.h>
 #include <media/hardware/MetadataBufferType.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MediaDefs.h>
 
 #ifndef INT32_MAX
@@ -86,7 +87,14 @@ SoftVPXEncoder::SoftVPXEncoder(const char *name,
       mTemporalPatternIdx(0),
       mLastTimestamp(0x7FFFFFFFFFFFFFFFLL),
       mConversionBuffer(NULL),
-      mKeyFrameRequested(false) {
+      mKeyFrameRequested(false),
+      mLookahead(0),
+      mPass(kPassOne),
+      mTwoPassStats(NULL),
+      mTwoPassStatsSize(0),
+      mTwoPassStatsCapacity(0),
+      mSawInputEOS(false),
+      mSawOutputEOS(false) {
     memset(mTemporalLayerBitrateRatio, 0, sizeof(mTemporalLayerBitrateRatio));
     mTemporalLayerBitrateRatio[0] = 100;
 
@@ -95,10 +103,14 @@ SoftVPXEncoder::SoftVPXEncoder(const char *name,
     initPorts(
             kNumBuffers, kNumBuffers, kMinOutputBufferSize,
             mimeType, minCompressionRatio);
+
+    addInt32VendorExtension("android.lookahead", &mLookahead, 0, kMaxLookahead);
+    addInt32VendorExtension("android.vpx-pass", &mPass, kPassOne, kPassLast);
 }
 
 SoftVPXEncoder::~SoftVPXEncoder() {
     releaseEncoder();
+    free(mTwoPassStats);
 }
 
 status_t SoftVPXEncoder::initEncoder() {
@@ -109,9 +121,10 @@ status_t SoftVPXEncoder::initEncoder() {
     if (mCodecInterface == NULL) {
         goto CLEAN_UP;
     }
-    ALOGD("VPx: initEncoder. BRMode: %u. TSLayers: %zu. KF: %u. QP: %u - %u",
+    ALOGD("VPx: initEncoder. BRMode: %u. TSLayers: %zu. KF: %u. QP: %u - %u."
+          " Lookahead: %d. Pass: %d",
           (uint32_t)mBitrateControlMode, mTemporalLayers, mKeyFrameInterval,
-          mMinQuantizer, mMaxQuantizer);
+          mMinQuantizer, mMaxQuantizer, mLookahead, mPass);
 
     mCodecConfiguration = new vpx_codec_enc_cfg_t;
     codec_return = vpx_codec_enc_config_default(mCodecInterface,
@@ -137,8 +150,17 @@ status_t SoftVPXEncoder::initEncoder() {
     mCodecConfiguration->rc_end_usage = mBitrateControlMode;
     // Disable frame drop - not allowed in MediaCodec now.
     mCodecConfiguration->rc_dropframe_thresh = 0;
-    // Disable lagged encoding.
+    // Lagged encoding lets the encoder look ahead for key frame and alt-ref
+    // placement, but CBR and temporal layering need every frame to be encoded
+    // as it arrives.
     mCodecConfiguration->g_lag_in_frames = 0;
+    if (mLookahead > 0) {
+        if (mBitrateControlMode == VPX_CBR || mTemporalLayers > 0) {
+            ALOGW("Ignoring lookahead with CBR or temporal layers.");
+        } else {
+            mCodecConfiguration->g_lag_in_frames = mLookahead;
+        }
+    }
     if (mBitrateControlMode == VPX_CBR) {
         // Disable spatial resizing.
         mCodecConfiguration->rc_resize_allowed = 0;
@@ -164,6 +186,17 @@ status_t SoftVPXEncoder::initEncoder() {
         // Encoder determines optimal key frame placement automatically.
         mCodecConfiguration->kf_mode = VPX_KF_AUTO;
     }
+    if (mPass == kPassFirst) {
+        mCodecConfiguration->g_pass = VPX_RC_FIRST_PASS;
+    } else if (mPass == kPassLast) {
+        if (mTwoPassStatsSize == 0) {
+            ALOGE("No first pass statistics for the last pass.");
+            goto CLEAN_UP;
+        }
+        mCodecConfiguration->g_pass = VPX_RC_LAST_PASS;
+        mCodecConfiguration->rc_twopass_stats_in.buf = mTwoPassStats;
+        mCodecConfiguration->rc_twopass_stats_in.sz = mTwoPassStatsSize;
+    }
 
     // Frames temporal pattern - for now WebRTC like pattern is only supported.
     switch (mTemporalLayers) {
@@ -441,7 +474,7 @@ OMX_ERRORTYPE SoftVPXEncoder::setConfig(
         }
 
         default:
-            return SimpleSoftOMXComponent::setConfig(index, _params);
+            return SoftVideoEncoderOMXComponent::setConfig(index, _params);
     }
 }
 
@@ -614,9 +647,183 @@ vpx_enc_frame_flags_t SoftVPXEncoder::getEncodeFlags() {
     return flags;
 }
 
+bool SoftVPXEncoder::readTwoPassStats() {
+    List<BufferInfo *> &inputBufferInfoQueue = getPortQueue(kInputPortIndex);
+
+    while (!inputBufferInfoQueue.empty()) {
+        BufferInfo *inputBufferInfo = *inputBufferInfoQueue.begin();
+        OMX_BUFFERHEADERTYPE *inputBufferHeader = inputBufferInfo->mHeader;
+
+        if (!(inputBufferHeader->nFlags & OMX_BUFFERFLAG_CODECCONFIG)) {
+            return true;
+        }
+
+        size_t size = mTwoPassStatsSize + inputBufferHeader->nFilledLen;
+        if (size > mTwoPassStatsCapacity) {
+            size_t capacity = mTwoPassStatsCapacity * 2;
+            if (capacity < size) {
+                capacity = size;
+            }
+            uint8_t *stats = (uint8_t *)realloc(mTwoPassStats, capacity);
+            if (stats == NULL) {
+                ALOGE("Allocating first pass statistics buffer failed.");
+                notify(OMX_EventError, OMX_ErrorInsufficientResources, 0, 0);
+                return false;
+            }
+            mTwoPassStats = stats;
+            mTwoPassStatsCapacity = capacity;
+        }
+        memcpy(mTwoPassStats + mTwoPassStatsSize,
+               inputBufferHeader->pBuffer + inputBufferHeader->nOffset,
+               inputBufferHeader->nFilledLen);
+        mTwoPassStatsSize = size;
+
+        inputBufferInfoQueue.erase(inputBufferInfoQueue.begin());
+        inputBufferInfo->mOwnedByUs = false;
+        notifyEmptyBufferDone(inputBufferHeader);
+    }
+    return false;
+}
+
+bool SoftVPXEncoder::fillOutputBuffer(
+        const void *data, size_t size, OMX_TICKS timeUs, OMX_U32 flags) {
+    List<BufferInfo *> &outputBufferInfoQueue = getPortQueue(kOutputPortIndex);
+    BufferInfo *outputBufferInfo = *outputBufferInfoQueue.begin();
+    OMX_BUFFERHEADERTYPE *outputBufferHeader = outputBufferInfo->mHeader;
+
+    outputBufferHeader->nTimeStamp = timeUs;
+    outputBufferHeader->nFlags = flags;
+    outputBufferHeader->nOffset = 0;
+    outputBufferHeader->nFilledLen = size;
+    if (outputBufferHeader->nFilledLen > outputBufferHeader->nAllocLen) {
+        android_errorWriteLog(0x534e4554, "27569635");
+        notify(OMX_EventError, OMX_ErrorUndefined, 0, 0);
+        return false;
+    }
+    memcpy(outputBufferHeader->pBuffer, data, size);
+    outputBufferInfo->mOwnedByUs = false;
+    outputBufferInfoQueue.erase(outputBufferInfoQueue.begin());
+    notifyFillBufferDone(outputBufferHeader);
+    return true;
+}
+
+bool SoftVPXEncoder::queueOutput(
+        const void *data, size_t size, OMX_TICKS timeUs, OMX_U32 flags) {
+    if (mPendingOutput.empty() && !getPortQueue(kOutputPortIndex).empty()) {
+        return fillOutputBuffer(data, size, timeUs, flags);
+    }
+
+    // A single encode call can return several packets when the encoder
+    // flushes lagged frames.
+    sp<ABuffer> buffer = new ABuffer(size);
+    memcpy(buffer->data(), data, size);
+    buffer->meta()->setInt64("timeUs", timeUs);
+    buffer->meta()->setInt32("flags", flags);
+    mPendingOutput.push_back(buffer);
+    return true;
+}
+
+bool SoftVPXEncoder::flushPendingOutput() {
+    List<BufferInfo *> &outputBufferInfoQueue = getPortQueue(kOutputPortIndex);
+
+    while (!mPendingOutput.empty() && !outputBufferInfoQueue.empty()) {
+        sp<ABuffer> buffer = *mPendingOutput.begin();
+        mPendingOutput.erase(mPendingOutput.begin());
+
+        int64_t timeUs;
+        int32_t flags;
+        CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
+        CHECK(buffer->meta()->findInt32("flags", &flags));
+        if (!fillOutputBuffer(buffer->data(), buffer->size(), timeUs, flags)) {
+            return false;
+        }
+    }
+    return mPendingOutput.empty();
+}
+
+bool SoftVPXEncoder::queueEncodedPackets(
+        OMX_TICKS statsTimeUs, OMX_U32 extraFlags, size_t *numPackets) {
+    vpx_codec_iter_t encoded_packet_iterator = NULL;
+    const vpx_codec_cx_pkt_t* encoded_packet;
+
+    *numPackets = 0;
+    while ((encoded_packet = vpx_codec_get_cx_data(
+                    mCodecContext, &encoded_packet_iterator))) {
+        if (encoded_packet->kind == VPX_CODEC_CX_FRAME_PKT) {
+            OMX_U32 flags = extraFlags;
+            if (encoded_packet->data.frame.flags & VPX_FRAME_IS_KEY)
+                flags |= OMX_BUFFERFLAG_SYNCFRAME;
+            if (!queueOutput(encoded_packet->data.frame.buf,
+                             encoded_packet->data.frame.sz,
+                             encoded_packet->data.frame.pts,
+                             flags)) {
+                return false;
+            }
+        } else if (encoded_packet->kind == VPX_CODEC_STATS_PKT) {
+            // The first pass outputs statistics instead of frames.
+            if (!queueOutput(encoded_packet->data.twopass_stats.buf,
+                             encoded_packet->data.twopass_stats.sz,
+                             statsTimeUs,
+                             extraFlags)) {
+                return false;
+            }
+        } else {
+            continue;
+        }
+        (*numPackets)++;
+    }
+    return true;
+}
+
+void SoftVPXEncoder::drainEncoder(unsigned long deadline) {
+    List<BufferInfo *> &outputBufferInfoQueue = getPortQueue(kOutputPortIndex);
+
+    while (!mSawOutputEOS && !outputBufferInfoQueue.empty()) {
+        vpx_codec_err_t codec_return = vpx_codec_encode(
+                mCodecContext,
+                NULL,  // flush
+                0,  // pts
+                0,  // duration
+                0,  // flags
+                deadline);
+        if (codec_return != VPX_CODEC_OK) {
+            ALOGE("vpx encoder failed to flush");
+            notify(OMX_EventError, OMX_ErrorUndefined, 0, 0);
+            return;
+        }
+
+        size_t numPackets;
+        if (!queueEncodedPackets(mLastTimestamp, 0, &numPackets)) {
+            return;
+        }
+        if (numPackets > 0) {
+            if (!mPendingOutput.empty()) {
+                return;
+            }
+            continue;
+        }
+
+        // The encoder is drained; no output buffer was used by this flush.
+        BufferInfo *outputBufferInfo = *outputBufferInfoQueue.begin();
+        OMX_BUFFERHEADERTYPE *outputBufferHeader = outputBufferInfo->mHeader;
+
+        outputBufferHeader->nFilledLen = 0;
+        outputBufferHeader->nFlags = OMX_BUFFERFLAG_EOS;
+
+        outputBufferInfoQueue.erase(outputBufferInfoQueue.begin());
+        outputBufferInfo->mOwnedByUs = false;
+        notifyFillBufferDone(outputBufferHeader);
+        mSawOutputEOS = true;
+    }
+}
+
 void SoftVPXEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
     // Initialize encoder if not already
     if (mCodecContext == NULL) {
+        if (mPass == kPassLast && !readTwoPassStats()) {
+            // Wait for the first frame.
+            return;
+        }
         if (OK != initEncoder()) {
             ALOGE("Failed to initialize encoder");
             notify(OMX_EventError,
@@ -627,23 +834,41 @@ void SoftVPXEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
         }
     }
 
+    if (!flushPendingOutput()) {
+        return;
+    }
+
     vpx_codec_err_t codec_return;
     List<BufferInfo *> &inputBufferInfoQueue = getPortQueue(kInputPortIndex);
     List<BufferInfo *> &outputBufferInfoQueue = getPortQueue(kOutputPortIndex);
 
-    while (!inputBufferInfoQueue.empty() && !outputBufferInfoQueue.empty()) {
+    // With lagged encoding, and in two-pass mode for the final statistics of
+    // the first pass, the encoder holds output until it is drained at the end
+    // of stream.
+    const bool drainAtEOS = mCodecConfiguration->g_lag_in_frames > 0
+            || mCodecConfiguration->g_pass != VPX_RC_ONE_PASS;
+    const unsigned long deadline =
+            drainAtEOS ? VPX_DL_GOOD_QUALITY : VPX_DL_REALTIME;
+
+    while (!mSawInputEOS
+            && !inputBufferInfoQueue.empty() && !outputBufferInfoQueue.empty()) {
         BufferInfo *inputBufferInfo = *inputBufferInfoQueue.begin();
         OMX_BUFFERHEADERTYPE *inputBufferHeader = inputBufferInfo->mHeader;
 
-        BufferInfo *outputBufferInfo = *outputBufferInfoQueue.begin();
-        OMX_BUFFERHEADERTYPE *outputBufferHeader = outputBufferInfo->mHeader;
-
         if ((inputBufferHeader->nFlags & OMX_BUFFERFLAG_EOS) &&
                 inputBufferHeader->nFilledLen == 0) {
             inputBufferInfoQueue.erase(inputBufferInfoQueue.begin());
             inputBufferInfo->mOwnedByUs = false;
             notifyEmptyBufferDone(inputBufferHeader);
 
+            if (drainAtEOS) {
+                mSawInputEOS = true;
+                break;
+            }
+
+            BufferInfo *outputBufferInfo = *outputBufferInfoQueue.begin();
+            OMX_BUFFERHEADERTYPE *outputBufferHeader = outputBufferInfo->mHeader;
+
             outputBufferHeader->nFilledLen = 0;
             outputBufferHeader->nFlags = OMX_BUFFERFLAG_EOS;
 
@@ -723,7 +948,7 @@ void SoftVPXEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
                 inputBufferHeader->nTimeStamp,  // in timebase units
                 frameDuration,  // frame duration in timebase units
                 flags,  // frame flags
-                VPX_DL_REALTIME);  // encoding deadline
+                deadline);  // encoding deadline
         if (codec_return != VPX_CODEC_OK) {
             ALOGE("vpx encoder failed to encode frame");
             notify(OMX_EventError,
@@ -733,44 +958,60 @@ void SoftVPXEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
             return;
         }
 
-        vpx_codec_iter_t encoded_packet_iterator = NULL;
-        const vpx_codec_cx_pkt_t* encoded_packet;
-
-        while ((encoded_packet = vpx_codec_get_cx_data(
-                        mCodecContext, &encoded_packet_iterator))) {
-            if (encoded_packet->kind == VPX_CODEC_CX_FRAME_PKT) {
-                outputBufferHeader->nTimeStamp = encoded_packet->data.frame.pts;
-                outputBufferHeader->nFlags = 0;
-                if (encoded_packet->data.frame.flags & VPX_FRAME_IS_KEY)
-                    outputBufferHeader->nFlags |= OMX_BUFFERFLAG_SYNCFRAME;
-                outputBufferHeader->nOffset = 0;
-                outputBufferHeader->nFilledLen = encoded_packet->data.frame.sz;
-                if (outputBufferHeader->nFilledLen > outputBufferHeader->nAllocLen) {
-                    android_errorWriteLog(0x534e4554, "27569635");
-                    notify(OMX_EventError, OMX_ErrorUndefined, 0, 0);
-                    return;
-                }
-                memcpy(outputBufferHeader->pBuffer,
-                       encoded_packet->data.frame.buf,
-                       encoded_packet->data.frame.sz);
-                outputBufferInfo->mOwnedByUs = false;
-                outputBufferInfoQueue.erase(outputBufferInfoQueue.begin());
-                if (inputBufferHeader->nFlags & OMX_BUFFERFLAG_EOS) {
-                    outputBufferHeader->nFlags |= OMX_BUFFERFLAG_EOS;
-                }
-                notifyFillBufferDone(outputBufferHeader);
+        OMX_U32 eosFlag = 0;
+        if (inputBufferHeader->nFlags & OMX_BUFFERFLAG_EOS) {
+            if (drainAtEOS) {
+                mSawInputEOS = true;
+            } else {
+                eosFlag = OMX_BUFFERFLAG_EOS;
             }
         }
 
+        size_t numPackets;
+        if (!queueEncodedPackets(
+                    inputBufferHeader->nTimeStamp, eosFlag, &numPackets)) {
+            return;
+        }
+
         inputBufferInfo->mOwnedByUs = false;
         inputBufferInfoQueue.erase(inputBufferInfoQueue.begin());
         notifyEmptyBufferDone(inputBufferHeader);
+
+        if (!mPendingOutput.empty()) {
+            // Wait for output buffers.
+            return;
+        }
+    }
+
+    if (mSawInputEOS) {
+        drainEncoder(deadline);
+    }
+}
+
+void SoftVPXEncoder::onPortFlushCompleted(OMX_U32 portIndex) {
+    if (portIndex == kOutputPortIndex) {
+        mPendingOutput.clear();
+    } else if (portIndex == kInputPortIndex && mCodecConfiguration != NULL
+            && (mCodecConfiguration->g_lag_in_frames > 0
+                    || mCodecConfiguration->g_pass != VPX_RC_ONE_PASS)) {
+        // Drop the frames held by the encoder; it is initialized again with
+        // the next frame.
+        releaseEncoder();
     }
+    mSawInputEOS = false;
+    mSawOutputEOS = false;
 }
 
 void SoftVPXEncoder::onReset() {
     releaseEncoder();
     mLastTimestamp = 0x7FFFFFFFFFFFFFFFLL;
+    mPendingOutput.clear();
+    mSawInputEOS = false;
+    mSawOutputEOS = false;
+    free(mTwoPassStats);
+    mTwoPassStats = NULL;
+    mTwoPassStatsSize = 0;
+    mTwoPassStatsCapacity = 0;
 }
 
 }  // namespace android
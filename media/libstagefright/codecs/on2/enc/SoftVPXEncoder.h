@@ -25,6 +25,9 @@
 
 #include <hardware/gralloc.h>
 
+#include <media/stagefright/foundation/ABuffer.h>
+#include <utils/List.h>
+
 #include "vpx/vpx_encoder.h"
 #include "vpx/vpx_codec.h"
 #include "vpx/vp8cx.h"
@@ -50,8 +53,18 @@ namespace android {
 //    - YUV420SemiPlanar
 //    - AndroidOpaque
 //
+// Following settings are available through Android vendor extensions
+//    - lookahead in frames ("vendor.android.lookahead.value"), which lets
+// the encoder lag behind the input for key frame and alt-ref placement
+//    - rate control pass ("vendor.android.vpx-pass.value"): 0 for single
+// pass, 1 for the first pass of two-pass encoding, which outputs the first
+// pass statistics instead of frames, and 2 for the last pass, which takes
+// the statistics as codec config input buffers queued ahead of the first
+// frame (so it requires ByteBuffer input)
+//
 // Following settings are not configurable by the client
-//    - encoding deadline is realtime
+//    - encoding deadline is realtime, or good quality with lookahead or
+// two-pass encoding
 //    - multithreaded encoding utilizes a number of threads equal
 // to online cpu's available
 //    - the algorithm interface for encoder is decided by the sub-class in use
@@ -93,6 +106,8 @@ protected:
     // encoding of the frame
     virtual void onQueueFilled(OMX_U32 portIndex);
 
+    virtual void onPortFlushCompleted(OMX_U32 portIndex);
+
     virtual void onReset();
 
     // Initializes vpx encoder with available settings.
@@ -133,6 +148,28 @@ protected:
     OMX_ERRORTYPE internalSetAndroidVpxParams(
             const OMX_VIDEO_PARAM_ANDROID_VP8ENCODERTYPE *vpxAndroidParams);
 
+    // Collects the first pass statistics queued ahead of the first frame
+    // for the last pass. Returns true once the first frame is queued.
+    bool readTwoPassStats();
+
+    // Queues the packets produced by the last vpx_codec_encode() call for
+    // output; |numPackets| is set to their number. Returns false on error.
+    bool queueEncodedPackets(
+            OMX_TICKS statsTimeUs, OMX_U32 extraFlags, size_t *numPackets);
+
+    // Copies encoded data to the next output buffer, or holds it in
+    // mPendingOutput until one is available. Returns false on error.
+    bool queueOutput(
+            const void *data, size_t size, OMX_TICKS timeUs, OMX_U32 flags);
+    bool fillOutputBuffer(
+            const void *data, size_t size, OMX_TICKS timeUs, OMX_U32 flags);
+
+    // Returns held output. Returns false if output is still held.
+    bool flushPendingOutput();
+
+    // Flushes the frames held by the encoder at the end of stream.
+    void drainEncoder(unsigned long deadline);
+
     enum TemporalReferences {
         // For 1 layer case: reference all (last, golden, and alt ref), but only
         // update last.
@@ -169,6 +206,15 @@ protected:
     enum {
         kMaxTemporalPattern = 8
     };
+    enum {
+        // libvpx does not lag by more than this number of frames
+        kMaxLookahead = 25
+    };
+    enum {
+        kPassOne = 0,
+        kPassFirst = 1,
+        kPassLast = 2,
+    };
 
     // number of buffers allocated per port
     static const uint32_t kNumBuffers = 4;
@@ -245,6 +291,25 @@ protected:
 
     bool mKeyFrameRequested;
 
+    // Number of frames the encoder may lag behind the input
+    int32_t mLookahead;
+
+    // Rate control pass: kPassOne, kPassFirst or kPassLast
+    int32_t mPass;
+
+    // First pass statistics for the last pass
+    uint8_t* mTwoPassStats;
+    size_t mTwoPassStatsSize;
+    size_t mTwoPassStatsCapacity;
+
+    // End of stream has been queued to, and returned from, the encoder when
+    // it holds frames until it is drained
+    bool mSawInputEOS;
+    bool mSawOutputEOS;
+
+    // Encoded data waiting for an output buffer
+    List<sp<ABuffer> > mPendingOutput;
+
     DISALLOW_EVIL_CONSTRUCTORS(SoftVPXEncoder);
 };
 
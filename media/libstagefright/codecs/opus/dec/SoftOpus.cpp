@@ -62,6 +62,7 @@ SoftOpus::SoftOpus(
       mSeekPreRoll(0),
       mAnchorTimeUs(0),
       mNumFramesOutput(0),
+      mOutputFloat(false),
       mOutputPortSettingsChange(NONE) {
     initPorts();
     CHECK_EQ(initDecoder(), (status_t)OK);
@@ -168,10 +169,11 @@ OMX_ERRORTYPE SoftOpus::internalGetParameter(
                 return OMX_ErrorUndefined;
             }
 
-            pcmParams->eNumData = OMX_NumericalDataSigned;
+            pcmParams->eNumData =
+                    mOutputFloat ? OMX_NumericalDataFloat : OMX_NumericalDataSigned;
             pcmParams->eEndian = OMX_EndianBig;
             pcmParams->bInterleaved = OMX_TRUE;
-            pcmParams->nBitPerSample = 16;
+            pcmParams->nBitPerSample = 8 * outputSampleSize();
             pcmParams->ePCMMode = OMX_AUDIO_PCMModeLinear;
             pcmParams->eChannelMapping[0] = OMX_AUDIO_ChannelLF;
             pcmParams->eChannelMapping[1] = OMX_AUDIO_ChannelRF;
@@ -228,6 +230,35 @@ OMX_ERRORTYPE SoftOpus::internalSetParameter(
             return OMX_ErrorNone;
         }
 
+        case OMX_IndexParamAudioPcm:
+        {
+            const OMX_AUDIO_PARAM_PCMMODETYPE *pcmParams =
+                (const OMX_AUDIO_PARAM_PCMMODETYPE *)params;
+
+            if (!isValidOMXParam(pcmParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (pcmParams->nPortIndex != 1) {
+                return OMX_ErrorUndefined;
+            }
+
+            // libopus decodes to float natively
+            if (pcmParams->eNumData == OMX_NumericalDataFloat
+                    && pcmParams->nBitPerSample == 32) {
+                mOutputFloat = true;
+            } else if (pcmParams->eNumData == OMX_NumericalDataSigned
+                    && pcmParams->nBitPerSample == 16) {
+                mOutputFloat = false;
+            } else {
+                return OMX_ErrorUnsupportedSetting;
+            }
+            editPortInfo(1)->mDef.nBufferSize =
+                    kMaxNumSamplesPerBuffer * outputSampleSize() * kMaxChannels;
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return SimpleSoftOMXComponent::internalSetParameter(index, params);
     }
@@ -459,17 +490,27 @@ void SoftOpus::onQueueFilled(OMX_U32 portIndex) {
         const uint8_t *data = inHeader->pBuffer + inHeader->nOffset;
         const uint32_t size = inHeader->nFilledLen;
         size_t frameSize = kMaxOpusOutputPacketSizeSamples;
-        if (frameSize > outHeader->nAllocLen / sizeof(int16_t) / mHeader->channels) {
-            frameSize = outHeader->nAllocLen / sizeof(int16_t) / mHeader->channels;
+        if (frameSize > outHeader->nAllocLen / outputSampleSize() / mHeader->channels) {
+            frameSize = outHeader->nAllocLen / outputSampleSize() / mHeader->channels;
             android_errorWriteLog(0x534e4554, "27833616");
         }
 
-        int numFrames = opus_multistream_decode(mDecoder,
+        int numFrames;
+        if (mOutputFloat) {
+            numFrames = opus_multistream_decode_float(mDecoder,
+                                                      data,
+                                                      size,
+                                                      (float *)outHeader->pBuffer,
+                                                      frameSize,
+                                                      0);
+        } else {
+            numFrames = opus_multistream_decode(mDecoder,
                                                 data,
                                                 size,
                                                 (int16_t *)outHeader->pBuffer,
                                                 frameSize,
                                                 0);
+        }
         if (numFrames < 0) {
             ALOGE("opus_multistream_decode returned %d", numFrames);
             notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
@@ -483,13 +524,13 @@ void SoftOpus::onQueueFilled(OMX_U32 portIndex) {
                 numFrames = 0;
             } else {
                 numFrames -= mSamplesToDiscard;
-                outHeader->nOffset = mSamplesToDiscard * sizeof(int16_t) *
+                outHeader->nOffset = mSamplesToDiscard * outputSampleSize() *
                                      mHeader->channels;
                 mSamplesToDiscard = 0;
             }
         }
 
-        outHeader->nFilledLen = numFrames * sizeof(int16_t) * mHeader->channels;
+        outHeader->nFilledLen = numFrames * outputSampleSize() * mHeader->channels;
         outHeader->nFlags = 0;
 
         outHeader->nTimeStamp = mAnchorTimeUs +
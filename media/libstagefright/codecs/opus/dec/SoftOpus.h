@@ -75,6 +75,7 @@ private:
     int64_t mSamplesToDiscard;
     int64_t mAnchorTimeUs;
     int64_t mNumFramesOutput;
+    bool mOutputFloat;  // output float PCM instead of 16-bit PCM
 
     enum {
         NONE,
@@ -86,6 +87,10 @@ private:
     status_t initDecoder();
     bool isConfigured() const;
 
+    size_t outputSampleSize() const {
+        return mOutputFloat ? sizeof(float) : sizeof(int16_t);
+    }
+
     DISALLOW_EVIL_CONSTRUCTORS(SoftOpus);
 };
 
@@ -47,6 +47,7 @@ SoftRaw::SoftRaw(
       mNumericalData(OMX_NumericalDataSigned),
       mBitsPerSample(16) {
     initPorts();
+    setBatchedQueueFilled(true);
     CHECK_EQ(initDecoder(), (status_t)OK);
 }
 
@@ -20,6 +20,7 @@
 
 #include "SoftVorbis.h"
 
+#include <audio_utils/primitives.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaDefs.h>
 
@@ -60,6 +61,7 @@ SoftVorbis::SoftVorbis(
       mSawInputEos(false),
       mSignalledOutputEos(false),
       mSignalledError(false),
+      mOutputFloat(false),
       mOutputPortSettingsChange(NONE) {
     initPorts();
     CHECK_EQ(initDecoder(), (status_t)OK);
@@ -176,10 +178,11 @@ OMX_ERRORTYPE SoftVorbis::internalGetParameter(
                 return OMX_ErrorUndefined;
             }
 
-            pcmParams->eNumData = OMX_NumericalDataSigned;
+            pcmParams->eNumData =
+                    mOutputFloat ? OMX_NumericalDataFloat : OMX_NumericalDataSigned;
             pcmParams->eEndian = OMX_EndianBig;
             pcmParams->bInterleaved = OMX_TRUE;
-            pcmParams->nBitPerSample = 16;
+            pcmParams->nBitPerSample = 8 * outputSampleSize();
             pcmParams->ePCMMode = OMX_AUDIO_PCMModeLinear;
             pcmParams->eChannelMapping[0] = OMX_AUDIO_ChannelLF;
             pcmParams->eChannelMapping[1] = OMX_AUDIO_ChannelRF;
@@ -237,6 +240,35 @@ OMX_ERRORTYPE SoftVorbis::internalSetParameter(
             return OMX_ErrorNone;
         }
 
+        case OMX_IndexParamAudioPcm:
+        {
+            const OMX_AUDIO_PARAM_PCMMODETYPE *pcmParams =
+                (const OMX_AUDIO_PARAM_PCMMODETYPE *)params;
+
+            if (!isValidOMXParam(pcmParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (pcmParams->nPortIndex != 1) {
+                return OMX_ErrorUndefined;
+            }
+
+            // Tremolo is fixed point and only produces 16-bit PCM; float output is
+            // converted from it.
+            if (pcmParams->eNumData == OMX_NumericalDataFloat
+                    && pcmParams->nBitPerSample == 32) {
+                mOutputFloat = true;
+            } else if (pcmParams->eNumData == OMX_NumericalDataSigned
+                    && pcmParams->nBitPerSample == 16) {
+                mOutputFloat = false;
+            } else {
+                return OMX_ErrorUnsupportedSetting;
+            }
+            editPortInfo(1)->mDef.nBufferSize = kMaxNumSamplesPerBuffer * outputSampleSize();
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return SimpleSoftOMXComponent::internalSetParameter(index, params);
     }
@@ -409,8 +441,8 @@ void SoftVorbis::onQueueFilled(OMX_U32 portIndex) {
 #endif
         } else {
             size_t numSamplesPerBuffer = kMaxNumSamplesPerBuffer;
-            if (numSamplesPerBuffer > outHeader->nAllocLen / sizeof(int16_t)) {
-                numSamplesPerBuffer = outHeader->nAllocLen / sizeof(int16_t);
+            if (numSamplesPerBuffer > outHeader->nAllocLen / outputSampleSize()) {
+                numSamplesPerBuffer = outHeader->nAllocLen / outputSampleSize();
                 android_errorWriteLog(0x534e4554, "27833616");
             }
             numFrames = vorbis_dsp_pcmout(
@@ -420,6 +452,10 @@ void SoftVorbis::onQueueFilled(OMX_U32 portIndex) {
             if (numFrames < 0) {
                 ALOGE("vorbis_dsp_pcmout returned %d", numFrames);
                 numFrames = 0;
+            } else if (mOutputFloat) {
+                // expand in place, the 16-bit samples occupy the first half of the buffer
+                memcpy_to_float_from_i16((float *)outHeader->pBuffer,
+                        (const int16_t *)outHeader->pBuffer, numFrames * mVi->channels);
             }
         }
 
@@ -440,7 +476,7 @@ void SoftVorbis::onQueueFilled(OMX_U32 portIndex) {
             mNumFramesLeftOnPage -= numFrames;
         }
 
-        outHeader->nFilledLen = numFrames * sizeof(int16_t) * mVi->channels;
+        outHeader->nFilledLen = numFrames * outputSampleSize() * mVi->channels;
         outHeader->nOffset = 0;
 
         outHeader->nTimeStamp =
@@ -62,6 +62,7 @@ private:
     bool mSawInputEos;
     bool mSignalledOutputEos;
     bool mSignalledError;
+    bool mOutputFloat;  // output float PCM instead of 16-bit PCM
 
     enum {
         NONE,
@@ -73,6 +74,10 @@ private:
     status_t initDecoder();
     bool isConfigured() const;
 
+    size_t outputSampleSize() const {
+        return mOutputFloat ? sizeof(float) : sizeof(int16_t);
+    }
+
     DISALLOW_EVIL_CONSTRUCTORS(SoftVorbis);
 };
 
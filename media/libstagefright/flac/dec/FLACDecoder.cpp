@@ -219,6 +219,29 @@ static void copyMultiCh24(
     }
 }
 
+// Copy samples from FLAC native 32-bit non-interleaved to float interleaved, keeping the full
+// resolution of the stream.
+static void copyToFloat(
+        float *dst,
+        const int * src[FLACDecoder::kMaxChannels],
+        unsigned nSamples,
+        unsigned nChannels,
+        unsigned bitsPerSample) {
+    const float scale = 1.0f / (1 << (bitsPerSample - 1));
+    if (nChannels == 2) {
+        for (unsigned i = 0; i < nSamples; ++i) {
+            *dst++ = src[0][i] * scale;
+            *dst++ = src[1][i] * scale;
+        }
+        return;
+    }
+    for (unsigned i = 0; i < nSamples; ++i) {
+        for (unsigned c = 0; c < nChannels; ++c) {
+            *dst++ = src[c][i] * scale;
+        }
+    }
+}
+
 // static
 sp<FLACDecoder> FLACDecoder::Create() {
     sp<FLACDecoder> decoder = new FLACDecoder();
@@ -419,7 +442,7 @@ status_t FLACDecoder::parseMetadata(const uint8_t *inBuffer, size_t inBufferLen)
 }
 
 status_t FLACDecoder::decodeOneFrame(const uint8_t *inBuffer, size_t inBufferLen,
-        short *outBuffer, size_t *outBufferLen) {
+        void *outBuffer, size_t *outBufferLen, bool outputFloat) {
     ALOGV("decodeOneFrame: input size(%zu)", inBufferLen);
 
     if (inBufferLen == 0) {
@@ -474,12 +497,13 @@ status_t FLACDecoder::decodeOneFrame(const uint8_t *inBuffer, size_t inBufferLen
         return ERROR_MALFORMED;
     }
 
-    size_t bufferSize = blocksize * getChannels() * sizeof(short);
+    const size_t sampleSize = outputFloat ? sizeof(float) : sizeof(short);
+    size_t bufferSize = blocksize * getChannels() * sampleSize;
     if (bufferSize > *outBufferLen) {
         ALOGW("decodeOneFrame: output buffer holds only partial frame %zu:%zu",
                 *outBufferLen, bufferSize);
-        blocksize = *outBufferLen / (getChannels() * sizeof(short));
-        bufferSize = blocksize * getChannels() * sizeof(short);
+        blocksize = *outBufferLen / (getChannels() * sampleSize);
+        bufferSize = blocksize * getChannels() * sampleSize;
     }
 
     if (mCopy == nullptr) {
@@ -488,7 +512,12 @@ status_t FLACDecoder::decodeOneFrame(const uint8_t *inBuffer, size_t inBufferLen
         return ERROR_UNSUPPORTED;
     }
     // copy PCM from FLAC write buffer to output buffer, with interleaving
-    (*mCopy)(outBuffer, mWriteBuffer, blocksize, getChannels());
+    if (outputFloat) {
+        copyToFloat((float *)outBuffer, mWriteBuffer, blocksize, getChannels(),
+                getBitsPerSample());
+    } else {
+        (*mCopy)((short *)outBuffer, mWriteBuffer, blocksize, getChannels());
+    }
     *outBufferLen = bufferSize;
     return OK;
 }
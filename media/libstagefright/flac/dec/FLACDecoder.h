@@ -40,8 +40,10 @@ public:
     }
 
     status_t parseMetadata(const uint8_t *inBuffer, size_t inBufferLen);
+    // decodes a frame into |outBuffer| as interleaved 16-bit PCM, or as interleaved float PCM
+    // in [-1, 1) if |outputFloat| is set.
     status_t decodeOneFrame(const uint8_t *inBuffer, size_t inBufferLen,
-            short *outBuffer, size_t *outBufferLen);
+            void *outBuffer, size_t *outBufferLen, bool outputFloat = false);
     void flush();
 
 protected:
@@ -85,15 +85,50 @@ protected:
 
     PortInfo *editPortInfo(OMX_U32 portIndex);
 
+    // By default onQueueFilled() is called once for every buffer queued to a port. In batched
+    // mode all buffers queued since the last wake-up are added to the port queues first, and
+    // onQueueFilled() is called once per port that got buffers. Only components whose
+    // onQueueFilled() processes all the buffers it can from the port queues (regardless of
+    // the port index it is called for) may enable it. Must be called from the constructor.
+    void setBatchedQueueFilled(bool batched);
+
 private:
     enum {
-        kWhatSendCommand,
-        kWhatEmptyThisBuffer,
-        kWhatFillThisBuffer,
+        kWhatProcessCalls,
+    };
+
+    // emptyThisBuffer, fillThisBuffer or sendCommand call, as queued for the looper thread
+    struct PendingCall {
+        enum Type {
+            SEND_COMMAND,
+            EMPTY_THIS_BUFFER,
+            FILL_THIS_BUFFER,
+        } mType;
+        OMX_COMMANDTYPE mCmd;
+        OMX_U32 mParam;
+        OMX_BUFFERHEADERTYPE *mHeader;
+        int64_t mQueuedUs;      // only set if mQueueStatsEnabled
+    };
+
+    // Framework overhead per buffer (from the OMX call until the buffer is added to its port
+    // queue) versus the time spent in the codec, logged at destruction if the
+    // debug.stagefright.omx.queue-stats property is set.
+    struct QueueStats {
+        uint64_t mWakeUps;
+        uint64_t mBuffers;
+        uint64_t mQueueFilledCalls;
+        int64_t mDispatchUs;
+        int64_t mCodecUs;
     };
 
     Mutex mLock;
 
+    // Calls are queued here and processed in order by a single kWhatProcessCalls message, which
+    // is only posted if there is none pending; so a burst of calls costs one wake-up of the
+    // looper thread.
+    Mutex mCallLock;
+    Vector<PendingCall> mPendingCalls;
+
     sp<ALooper> mLooper;
     sp<AHandlerReflector<SimpleSoftOMXComponent> > mHandler;
 
@@ -102,6 +137,10 @@ private:
 
     Vector<PortInfo> mPorts;
 
+    bool mBatchedQueueFilled;
+    const bool mQueueStatsEnabled;
+    QueueStats mQueueStats;
+
     bool isSetParameterAllowed(
             OMX_INDEXTYPE index, const OMX_PTR params) const;
 
@@ -139,6 +178,10 @@ private:
 
     virtual OMX_ERRORTYPE getState(OMX_STATETYPE *state);
 
+    void postCall(const PendingCall &call);
+    OMX_U32 onBufferQueued(const PendingCall &call);
+    void callQueueFilled(OMX_U32 portIndex);
+
     void onSendCommand(OMX_COMMANDTYPE cmd, OMX_U32 param);
     void onChangeState(OMX_STATETYPE state);
     void onPortEnable(OMX_U32 portIndex, bool enable);
@@ -119,6 +119,30 @@ protected:
             uint8_t *dst, const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV,
             size_t srcYStride, size_t srcUStride, size_t srcVStride);
 
+    // Shared (zero-copy) output buffers, for codecs that can decode into the output
+    // buffers directly and keep their reference frames there.
+    //
+    // registerSharedOutputBuffers() gives the codec (up to |maxCount| of) the output
+    // buffers we currently own, which it then identifies by their index in that set. The codec may write to these
+    // until it outputs them; takeSharedOutputBuffer() removes the one it output from the
+    // output queue so that it can be sent to the client. Once the client returns it,
+    // releaseSharedOutputBuffers() hands it back to the codec through
+    // releaseSharedOutputBuffer(), and the codec reuses it when it no longer needs it as
+    // a reference. Buffers the client held at registration time are not used.
+    bool sharedOutputBuffersAllowed();
+    size_t registerSharedOutputBuffers(size_t maxCount);
+    size_t numSharedOutputBuffers() const;
+    OMX_BUFFERHEADERTYPE *sharedOutputBuffer(size_t id) const;
+    size_t numSharedOutputBuffersWithCodec() const;
+    void releaseSharedOutputBuffers();
+    BufferInfo *takeSharedOutputBuffer(size_t id);
+    void clearSharedOutputBuffers();
+
+    // Returns buffer |id| to the codec. Only called for buffers registered through
+    // registerSharedOutputBuffers(), so decoders that don't share output buffers never
+    // get here and can keep this no-op.
+    virtual void releaseSharedOutputBuffer(size_t /* id */) {}
+
     enum {
         kInputPortIndex  = 0,
         kOutputPortIndex = 1,
@@ -160,6 +184,10 @@ protected:
     void dumpColorAspects(const ColorAspects &colorAspects);
 
 private:
+    // Registered output buffers, and whether the codec may use each of them.
+    Vector<OMX_BUFFERHEADERTYPE *> mSharedOutputBuffers;
+    Vector<bool> mSharedOutputBufferWithCodec;
+
     uint32_t mMinInputBufferSize;
     uint32_t mMinCompressionRatio;
 
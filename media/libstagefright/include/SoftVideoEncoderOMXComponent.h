@@ -67,6 +67,15 @@ protected:
 
     virtual OMX_ERRORTYPE getExtensionIndex(const char *name, OMX_INDEXTYPE *index);
 
+    virtual OMX_ERRORTYPE getConfig(OMX_INDEXTYPE index, OMX_PTR params);
+    virtual OMX_ERRORTYPE setConfig(OMX_INDEXTYPE index, const OMX_PTR params);
+
+    // Adds an Android vendor extension |name| holding a single int32 value in the range
+    // [minValue, maxValue], which clients can set through the "vendor.<name>.value" format key.
+    // The extension reads and writes |*value|. Must be called from the constructor.
+    void addInt32VendorExtension(
+            const char *name, int32_t *value, int32_t minValue, int32_t maxValue);
+
     enum {
         kInputPortIndex = 0,
         kOutputPortIndex = 1,
@@ -96,6 +105,14 @@ private:
     const CodecProfileLevel *mProfileLevels;
     size_t mNumProfileLevels;
 
+    struct Int32VendorExtension {
+        const char *mName;
+        int32_t *mValue;
+        int32_t mMinValue;
+        int32_t mMaxValue;
+    };
+    Vector<Int32VendorExtension> mVendorExtensions;
+
     DISALLOW_EVIL_CONSTRUCTORS(SoftVideoEncoderOMXComponent);
 };
 
@@ -54,7 +54,8 @@ public:
 
     virtual ~SimpleDecodingSource();
 
-    // starts this source (and it's underlying source). |params| is ignored.
+    // starts this source (and it's underlying source). |params| are passed on to the
+    // underlying source.
     virtual status_t start(MetaData *params = NULL);
 
     // stops this source (and it's underlying source).
@@ -20,6 +20,8 @@
 
 #include "include/SimpleSoftOMXComponent.h"
 
+#include <cutils/properties.h>
+#include <inttypes.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
@@ -35,7 +37,11 @@ SimpleSoftOMXComponent::SimpleSoftOMXComponent(
       mLooper(new ALooper),
       mHandler(new AHandlerReflector<SimpleSoftOMXComponent>(this)),
       mState(OMX_StateLoaded),
-      mTargetState(OMX_StateLoaded) {
+      mTargetState(OMX_StateLoaded),
+      mBatchedQueueFilled(false),
+      mQueueStatsEnabled(property_get_bool("debug.stagefright.omx.queue-stats", false)) {
+    memset(&mQueueStats, 0, sizeof(mQueueStats));
+
     mLooper->setName(name);
     mLooper->registerHandler(mHandler);
 
@@ -52,16 +58,40 @@ void SimpleSoftOMXComponent::prepareForDestruction() {
 
     mLooper->unregisterHandler(mHandler->id());
     mLooper->stop();
+
+    if (mQueueStatsEnabled && mQueueStats.mBuffers > 0) {
+        ALOGI("%s: %" PRIu64 " buffers in %" PRIu64 " wake-ups, %" PRIu64 " onQueueFilled calls; "
+                "%.1f us dispatch latency and %.1f us codec time per buffer",
+                name(), mQueueStats.mBuffers, mQueueStats.mWakeUps,
+                mQueueStats.mQueueFilledCalls,
+                (double)mQueueStats.mDispatchUs / mQueueStats.mBuffers,
+                (double)mQueueStats.mCodecUs / mQueueStats.mBuffers);
+    }
+}
+
+void SimpleSoftOMXComponent::setBatchedQueueFilled(bool batched) {
+    mBatchedQueueFilled = batched;
+}
+
+void SimpleSoftOMXComponent::postCall(const PendingCall &call) {
+    Mutex::Autolock autoLock(mCallLock);
+    mPendingCalls.push_back(call);
+    if (mPendingCalls.size() == 1) {
+        (new AMessage(kWhatProcessCalls, mHandler))->post();
+    }
 }
 
 OMX_ERRORTYPE SimpleSoftOMXComponent::sendCommand(
         OMX_COMMANDTYPE cmd, OMX_U32 param, OMX_PTR data) {
     CHECK(data == NULL);
 
-    sp<AMessage> msg = new AMessage(kWhatSendCommand, mHandler);
-    msg->setInt32("cmd", cmd);
-    msg->setInt32("param", param);
-    msg->post();
+    PendingCall call;
+    call.mType = PendingCall::SEND_COMMAND;
+    call.mCmd = cmd;
+    call.mParam = param;
+    call.mHeader = NULL;
+    call.mQueuedUs = 0;
+    postCall(call);
 
     return OMX_ErrorNone;
 }
@@ -335,18 +365,26 @@ OMX_ERRORTYPE SimpleSoftOMXComponent::freeBuffer(
 
 OMX_ERRORTYPE SimpleSoftOMXComponent::emptyThisBuffer(
         OMX_BUFFERHEADERTYPE *buffer) {
-    sp<AMessage> msg = new AMessage(kWhatEmptyThisBuffer, mHandler);
-    msg->setPointer("header", buffer);
-    msg->post();
+    PendingCall call;
+    call.mType = PendingCall::EMPTY_THIS_BUFFER;
+    call.mCmd = OMX_CommandMax;
+    call.mParam = 0;
+    call.mHeader = buffer;
+    call.mQueuedUs = mQueueStatsEnabled ? ALooper::GetNowUs() : 0;
+    postCall(call);
 
     return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE SimpleSoftOMXComponent::fillThisBuffer(
         OMX_BUFFERHEADERTYPE *buffer) {
-    sp<AMessage> msg = new AMessage(kWhatFillThisBuffer, mHandler);
-    msg->setPointer("header", buffer);
-    msg->post();
+    PendingCall call;
+    call.mType = PendingCall::FILL_THIS_BUFFER;
+    call.mCmd = OMX_CommandMax;
+    call.mParam = 0;
+    call.mHeader = buffer;
+    call.mQueuedUs = mQueueStatsEnabled ? ALooper::GetNowUs() : 0;
+    postCall(call);
 
     return OMX_ErrorNone;
 }
@@ -360,61 +398,104 @@ OMX_ERRORTYPE SimpleSoftOMXComponent::getState(OMX_STATETYPE *state) {
 }
 
 void SimpleSoftOMXComponent::onMessageReceived(const sp<AMessage> &msg) {
+    CHECK_EQ(msg->what(), (uint32_t)kWhatProcessCalls);
+
+    Vector<PendingCall> calls;
+    {
+        Mutex::Autolock autoLock(mCallLock);
+        calls = mPendingCalls;
+        mPendingCalls.clear();
+    }
+
     Mutex::Autolock autoLock(mLock);
-    uint32_t msgType = msg->what();
-    ALOGV("msgType = %d", msgType);
-    switch (msgType) {
-        case kWhatSendCommand:
-        {
-            int32_t cmd, param;
-            CHECK(msg->findInt32("cmd", &cmd));
-            CHECK(msg->findInt32("param", &param));
 
-            onSendCommand((OMX_COMMANDTYPE)cmd, (OMX_U32)param);
-            break;
+    if (mQueueStatsEnabled) {
+        ++mQueueStats.mWakeUps;
+    }
+
+    // ports with buffers queued since their last onQueueFilled() in batched mode
+    uint32_t filledPorts = 0;
+
+    for (size_t i = 0; i < calls.size(); ++i) {
+        const PendingCall &call = calls.itemAt(i);
+        ALOGV("call type = %d", call.mType);
+
+        if (call.mType == PendingCall::SEND_COMMAND) {
+            // the codec sees all buffers queued before a command before processing it
+            for (OMX_U32 portIndex = 0; filledPorts != 0; ++portIndex, filledPorts >>= 1) {
+                if (filledPorts & 1) {
+                    callQueueFilled(portIndex);
+                }
+            }
+            onSendCommand(call.mCmd, call.mParam);
+            continue;
         }
 
-        case kWhatEmptyThisBuffer:
-        case kWhatFillThisBuffer:
-        {
-            OMX_BUFFERHEADERTYPE *header;
-            CHECK(msg->findPointer("header", (void **)&header));
+        OMX_U32 portIndex = onBufferQueued(call);
+        if (mBatchedQueueFilled) {
+            CHECK_LT(portIndex, 32u);
+            filledPorts |= 1u << portIndex;
+        } else {
+            callQueueFilled(portIndex);
+        }
+    }
 
-            CHECK(mState == OMX_StateExecuting && mTargetState == mState);
+    for (OMX_U32 portIndex = 0; filledPorts != 0; ++portIndex, filledPorts >>= 1) {
+        if (filledPorts & 1) {
+            callQueueFilled(portIndex);
+        }
+    }
+}
 
-            bool found = false;
-            size_t portIndex = (kWhatEmptyThisBuffer == msgType)?
-                    header->nInputPortIndex: header->nOutputPortIndex;
-            PortInfo *port = &mPorts.editItemAt(portIndex);
+OMX_U32 SimpleSoftOMXComponent::onBufferQueued(const PendingCall &call) {
+    OMX_BUFFERHEADERTYPE *header = call.mHeader;
 
-            for (size_t j = 0; j < port->mBuffers.size(); ++j) {
-                BufferInfo *buffer = &port->mBuffers.editItemAt(j);
+    CHECK(mState == OMX_StateExecuting && mTargetState == mState);
+
+    bool found = false;
+    size_t portIndex = (call.mType == PendingCall::EMPTY_THIS_BUFFER)?
+            header->nInputPortIndex: header->nOutputPortIndex;
+    PortInfo *port = &mPorts.editItemAt(portIndex);
 
-                if (buffer->mHeader == header) {
-                    CHECK(!buffer->mOwnedByUs);
+    for (size_t j = 0; j < port->mBuffers.size(); ++j) {
+        BufferInfo *buffer = &port->mBuffers.editItemAt(j);
 
-                    buffer->mOwnedByUs = true;
+        if (buffer->mHeader == header) {
+            CHECK(!buffer->mOwnedByUs);
 
-                    CHECK((msgType == kWhatEmptyThisBuffer
-                            && port->mDef.eDir == OMX_DirInput)
-                            || (port->mDef.eDir == OMX_DirOutput));
+            buffer->mOwnedByUs = true;
 
-                    port->mQueue.push_back(buffer);
-                    onQueueFilled(portIndex);
+            CHECK((call.mType == PendingCall::EMPTY_THIS_BUFFER
+                    && port->mDef.eDir == OMX_DirInput)
+                    || (port->mDef.eDir == OMX_DirOutput));
 
-                    found = true;
-                    break;
-                }
-            }
+            port->mQueue.push_back(buffer);
 
-            CHECK(found);
+            found = true;
             break;
         }
+    }
 
-        default:
-            TRESPASS();
-            break;
+    CHECK(found);
+
+    if (mQueueStatsEnabled) {
+        ++mQueueStats.mBuffers;
+        mQueueStats.mDispatchUs += ALooper::GetNowUs() - call.mQueuedUs;
     }
+
+    return portIndex;
+}
+
+void SimpleSoftOMXComponent::callQueueFilled(OMX_U32 portIndex) {
+    if (!mQueueStatsEnabled) {
+        onQueueFilled(portIndex);
+        return;
+    }
+
+    int64_t startUs = ALooper::GetNowUs();
+    onQueueFilled(portIndex);
+    ++mQueueStats.mQueueFilledCalls;
+    mQueueStats.mCodecUs += ALooper::GetNowUs() - startUs;
 }
 
 void SimpleSoftOMXComponent::onSendCommand(
@@ -22,6 +22,7 @@
 
 #include "include/SoftVideoDecoderOMXComponent.h"
 
+#include <cutils/properties.h>
 #include <media/hardware/HardwareAPI.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
@@ -302,6 +303,24 @@ status_t SoftVideoDecoderOMXComponent::handleColorAspectsChange() {
     return OK;
 }
 
+// Copies |height| rows of |width| bytes, in one go when both sides are contiguous.
+static void copyPlane(
+        uint8_t *dst, size_t dstStride, const uint8_t *src, size_t srcStride,
+        size_t width, size_t height) {
+    if (height == 0) {
+        return;
+    }
+    if (srcStride == dstStride) {
+        memcpy(dst, src, dstStride * (height - 1) + width);
+        return;
+    }
+    for (size_t i = 0; i < height; ++i) {
+        memcpy(dst, src, width);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
 void SoftVideoDecoderOMXComponent::copyYV12FrameToOutputBuffer(
         uint8_t *dst, const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV,
         size_t srcYStride, size_t srcUStride, size_t srcVStride) {
@@ -310,27 +329,87 @@ void SoftVideoDecoderOMXComponent::copyYV12FrameToOutputBuffer(
     size_t dstHeight = outputBufferHeight();
     uint8_t *dstStart = dst;
 
-    for (size_t i = 0; i < mHeight; ++i) {
-         memcpy(dst, srcY, mWidth);
-         srcY += srcYStride;
-         dst += dstYStride;
-    }
+    copyPlane(dst, dstYStride, srcY, srcYStride, mWidth, mHeight);
 
     dst = dstStart + dstYStride * dstHeight;
-    for (size_t i = 0; i < mHeight / 2; ++i) {
-         memcpy(dst, srcU, mWidth / 2);
-         srcU += srcUStride;
-         dst += dstUVStride;
-    }
+    copyPlane(dst, dstUVStride, srcU, srcUStride, mWidth / 2, mHeight / 2);
 
     dst = dstStart + (5 * dstYStride * dstHeight) / 4;
-    for (size_t i = 0; i < mHeight / 2; ++i) {
-         memcpy(dst, srcV, mWidth / 2);
-         srcV += srcVStride;
-         dst += dstUVStride;
+    copyPlane(dst, dstUVStride, srcV, srcVStride, mWidth / 2, mHeight / 2);
+}
+
+bool SoftVideoDecoderOMXComponent::sharedOutputBuffersAllowed() {
+    // Off by default: the client must not write to output buffers it holds, as the codec
+    // may still read its reference frames from them.
+    return property_get_bool("debug.stagefright.swcodec.share-output", false);
+}
+
+size_t SoftVideoDecoderOMXComponent::registerSharedOutputBuffers(size_t maxCount) {
+    clearSharedOutputBuffers();
+
+    List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
+    for (List<BufferInfo *>::iterator it = outQueue.begin();
+            it != outQueue.end() && mSharedOutputBuffers.size() < maxCount; ++it) {
+        mSharedOutputBuffers.push_back((*it)->mHeader);
+        mSharedOutputBufferWithCodec.push_back(true);
+    }
+    return mSharedOutputBuffers.size();
+}
+
+size_t SoftVideoDecoderOMXComponent::numSharedOutputBuffers() const {
+    return mSharedOutputBuffers.size();
+}
+
+OMX_BUFFERHEADERTYPE *SoftVideoDecoderOMXComponent::sharedOutputBuffer(size_t id) const {
+    return id < mSharedOutputBuffers.size() ? mSharedOutputBuffers[id] : NULL;
+}
+
+size_t SoftVideoDecoderOMXComponent::numSharedOutputBuffersWithCodec() const {
+    size_t count = 0;
+    for (size_t id = 0; id < mSharedOutputBufferWithCodec.size(); ++id) {
+        count += mSharedOutputBufferWithCodec[id];
+    }
+    return count;
+}
+
+void SoftVideoDecoderOMXComponent::releaseSharedOutputBuffers() {
+    List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
+    for (List<BufferInfo *>::iterator it = outQueue.begin(); it != outQueue.end(); ++it) {
+        for (size_t id = 0; id < mSharedOutputBuffers.size(); ++id) {
+            if (mSharedOutputBuffers[id] == (*it)->mHeader) {
+                if (!mSharedOutputBufferWithCodec[id]) {
+                    mSharedOutputBufferWithCodec.editItemAt(id) = true;
+                    releaseSharedOutputBuffer(id);
+                }
+                break;
+            }
+        }
     }
 }
 
+SimpleSoftOMXComponent::BufferInfo *SoftVideoDecoderOMXComponent::takeSharedOutputBuffer(
+        size_t id) {
+    if (id >= mSharedOutputBuffers.size() || !mSharedOutputBufferWithCodec[id]) {
+        return NULL;
+    }
+
+    List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
+    for (List<BufferInfo *>::iterator it = outQueue.begin(); it != outQueue.end(); ++it) {
+        if ((*it)->mHeader == mSharedOutputBuffers[id]) {
+            BufferInfo *info = *it;
+            outQueue.erase(it);
+            mSharedOutputBufferWithCodec.editItemAt(id) = false;
+            return info;
+        }
+    }
+    return NULL;
+}
+
+void SoftVideoDecoderOMXComponent::clearSharedOutputBuffers() {
+    mSharedOutputBuffers.clear();
+    mSharedOutputBufferWithCodec.clear();
+}
+
 OMX_ERRORTYPE SoftVideoDecoderOMXComponent::internalGetParameter(
         OMX_INDEXTYPE index, OMX_PTR params) {
     switch (index) {
@@ -625,6 +704,7 @@ int SoftVideoDecoderOMXComponent::getColorAspectPreference() {
 
 void SoftVideoDecoderOMXComponent::onReset() {
     mOutputPortSettingsChange = NONE;
+    clearSharedOutputBuffers();
 }
 
 void SoftVideoDecoderOMXComponent::onPortEnableCompleted(OMX_U32 portIndex, bool enabled) {
@@ -632,6 +712,9 @@ void SoftVideoDecoderOMXComponent::onPortEnableCompleted(OMX_U32 portIndex, bool
         return;
     }
 
+    // The output buffers were freed or reallocated.
+    clearSharedOutputBuffers();
+
     switch (mOutputPortSettingsChange) {
         case NONE:
             break;
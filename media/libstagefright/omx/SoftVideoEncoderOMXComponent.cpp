@@ -667,4 +667,99 @@ OMX_ERRORTYPE SoftVideoEncoderOMXComponent::getExtensionIndex(
     return SimpleSoftOMXComponent::getExtensionIndex(name, index);
 }
 
+void SoftVideoEncoderOMXComponent::addInt32VendorExtension(
+        const char *name, int32_t *value, int32_t minValue, int32_t maxValue) {
+    Int32VendorExtension ext;
+    ext.mName = name;
+    ext.mValue = value;
+    ext.mMinValue = minValue;
+    ext.mMaxValue = maxValue;
+    mVendorExtensions.push_back(ext);
+}
+
+// The vendor extension config is variable-sized: it holds |nParamSizeUsed| params.
+static bool isValidVendorExtension(const OMX_CONFIG_ANDROID_VENDOR_EXTENSIONTYPE *ext) {
+    if (!isValidOMXParam(ext)) {
+        return false;
+    }
+    if (ext->nParamSizeUsed < 1 || ext->nParamSizeUsed > OMX_MAX_ANDROID_VENDOR_PARAMCOUNT
+            || ext->nSize < sizeof(*ext) + (ext->nParamSizeUsed - 1) * sizeof(ext->param[0])) {
+        ALOGE("invalid vendor extension size %u for %u params",
+                ext->nSize, ext->nParamSizeUsed);
+        return false;
+    }
+    return true;
+}
+
+OMX_ERRORTYPE SoftVideoEncoderOMXComponent::getConfig(
+        OMX_INDEXTYPE index, OMX_PTR params) {
+    if ((int)index != OMX_IndexConfigAndroidVendorExtension || mVendorExtensions.isEmpty()) {
+        return SimpleSoftOMXComponent::getConfig(index, params);
+    }
+
+    OMX_CONFIG_ANDROID_VENDOR_EXTENSIONTYPE *ext =
+        (OMX_CONFIG_ANDROID_VENDOR_EXTENSIONTYPE *)params;
+
+    if (!isValidVendorExtension(ext)) {
+        return OMX_ErrorBadParameter;
+    }
+
+    if (ext->nIndex >= mVendorExtensions.size()) {
+        return OMX_ErrorNoMore;
+    }
+
+    const Int32VendorExtension &info = mVendorExtensions[ext->nIndex];
+    strncpy((char *)ext->cName, info.mName, sizeof(ext->cName));
+    ext->cName[sizeof(ext->cName) - 1] = '\0';
+    ext->eDir = OMX_DirInput;
+    ext->nParamCount = 1;
+
+    OMX_CONFIG_ANDROID_VENDOR_PARAMTYPE *param = &ext->param[0];
+    strncpy((char *)param->cKey, "value", sizeof(param->cKey));
+    param->eValueType = OMX_AndroidVendorValueInt32;
+    param->bSet = OMX_TRUE;
+    param->nInt32 = *info.mValue;
+    return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE SoftVideoEncoderOMXComponent::setConfig(
+        OMX_INDEXTYPE index, const OMX_PTR params) {
+    if ((int)index != OMX_IndexConfigAndroidVendorExtension || mVendorExtensions.isEmpty()) {
+        return SimpleSoftOMXComponent::setConfig(index, params);
+    }
+
+    const OMX_CONFIG_ANDROID_VENDOR_EXTENSIONTYPE *ext =
+        (const OMX_CONFIG_ANDROID_VENDOR_EXTENSIONTYPE *)params;
+
+    if (!isValidVendorExtension(ext)) {
+        return OMX_ErrorBadParameter;
+    }
+
+    if (ext->nIndex >= mVendorExtensions.size()) {
+        return OMX_ErrorBadParameter;
+    }
+
+    const Int32VendorExtension &info = mVendorExtensions[ext->nIndex];
+    if (strncmp((const char *)ext->cName, info.mName, sizeof(ext->cName))) {
+        return OMX_ErrorBadParameter;
+    }
+
+    const OMX_CONFIG_ANDROID_VENDOR_PARAMTYPE *param = &ext->param[0];
+    if (!param->bSet) {
+        // the client did not specify the value; keep the current one
+        return OMX_ErrorNone;
+    }
+    if (param->eValueType != OMX_AndroidVendorValueInt32) {
+        return OMX_ErrorBadParameter;
+    }
+    if (param->nInt32 < info.mMinValue || param->nInt32 > info.mMaxValue) {
+        ALOGE("%s: value %d is not in [%d, %d]",
+                info.mName, param->nInt32, info.mMinValue, info.mMaxValue);
+        return OMX_ErrorUnsupportedSetting;
+    }
+
+    *info.mValue = param->nInt32;
+    return OMX_ErrorNone;
+}
+
 }  // namespace android
@@ -17,6 +17,7 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "OMXHarness"
 #include <inttypes.h>
+#include <math.h>
 #include <utils/Log.h>
 
 #include "OMXHarness.h"
@@ -28,16 +29,19 @@
 #include <binder/MemoryDealer.h>
 #include <media/IMediaHTTPService.h>
 #include <media/IMediaCodecService.h>
+#include <media/MediaCodecBuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/DataSource.h>
 #include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaCodec.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/MediaExtractor.h>
 #include <media/stagefright/MediaSource.h>
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/SimpleDecodingSource.h>
+#include <media/stagefright/Utils.h>
 #include <media/OMXBuffer.h>
 #include <android/hardware/media/omx/1.0/IOmx.h>
 #include <media/omx/1.0/WOmx.h>
@@ -770,6 +774,203 @@ status_t Harness::testSeek(
     return OK;
 }
 
+static void InitPcmParams(OMX_AUDIO_PARAM_PCMMODETYPE *params) {
+    params->nSize = sizeof(*params);
+    params->nVersion.s.nVersionMajor = 1;
+    params->nVersion.s.nVersionMinor = 0;
+    params->nVersion.s.nRevision = 0;
+    params->nVersion.s.nStep = 0;
+    params->nPortIndex = 1;
+}
+
+status_t Harness::testFloatOutput(
+        const char *componentName, const char *componentRole) {
+    // the software audio decoders that can output float PCM
+    static const char *kFloatDecoders[] = {
+        "OMX.google.aac.decoder",
+        "OMX.google.mp3.decoder",
+        "OMX.google.vorbis.decoder",
+        "OMX.google.opus.decoder",
+        "OMX.google.flac.decoder",
+    };
+
+    bool supportsFloat = false;
+    for (size_t i = 0; i < sizeof(kFloatDecoders) / sizeof(kFloatDecoders[0]); ++i) {
+        supportsFloat = supportsFloat || !strcmp(componentName, kFloatDecoders[i]);
+    }
+    if (!supportsFloat || strncmp(componentRole, "audio_decoder.", 14)) {
+        return OK;
+    }
+
+    {
+        sp<CodecObserver> observer = new CodecObserver(this, ++mCurGeneration);
+
+        status_t err = mOMX->allocateNode(componentName, observer, &mOMXNode);
+        EXPECT_SUCCESS(err, "allocateNode");
+
+        NodeReaper reaper(this, mOMXNode);
+
+        err = setRole(componentRole);
+        EXPECT_SUCCESS(err, "setRole");
+
+        OMX_PARAM_PORTDEFINITIONTYPE def;
+        err = getPortDefinition(1, &def);
+        EXPECT_SUCCESS(err, "getPortDefinition");
+        const OMX_U32 pcm16BufferSize = def.nBufferSize;
+
+        OMX_AUDIO_PARAM_PCMMODETYPE params;
+        InitPcmParams(&params);
+        err = mOMXNode->getParameter(OMX_IndexParamAudioPcm, &params, sizeof(params));
+        EXPECT_SUCCESS(err, "getParameter(OMX_IndexParamAudioPcm)");
+        EXPECT(params.eNumData == OMX_NumericalDataSigned && params.nBitPerSample == 16,
+               "Expected 16-bit PCM output by default.");
+
+        // other sample formats are rejected and leave the output format alone
+        params.eNumData = OMX_NumericalDataSigned;
+        params.nBitPerSample = 24;
+        err = mOMXNode->setParameter(OMX_IndexParamAudioPcm, &params, sizeof(params));
+        EXPECT(err != OK, "Expected 24-bit PCM output to be rejected.");
+
+        params.eNumData = OMX_NumericalDataFloat;
+        params.nBitPerSample = 32;
+        err = mOMXNode->setParameter(OMX_IndexParamAudioPcm, &params, sizeof(params));
+        EXPECT_SUCCESS(err, "setParameter(OMX_IndexParamAudioPcm, float)");
+
+        InitPcmParams(&params);
+        err = mOMXNode->getParameter(OMX_IndexParamAudioPcm, &params, sizeof(params));
+        EXPECT_SUCCESS(err, "getParameter(OMX_IndexParamAudioPcm)");
+        EXPECT(params.eNumData == OMX_NumericalDataFloat && params.nBitPerSample == 32,
+               "Expected float PCM output to be reported back.");
+
+        err = getPortDefinition(1, &def);
+        EXPECT_SUCCESS(err, "getPortDefinition");
+        EXPECT(def.nBufferSize >= 2 * pcm16BufferSize,
+               "Expected the output buffers to grow for float PCM.");
+    }
+
+    // decode the test content to float, if there is any
+    const char *mime = GetMimeFromComponentRole(componentRole);
+    if (mime == NULL) {
+        return OK;
+    }
+    sp<IMediaSource> source = CreateSourceForMime(mime);
+    if (source == NULL) {
+        printf("  * Unable to open test content for type '%s', "
+               "skipping float sample range test of componentRole %s\n",
+               mime, componentRole);
+        return OK;
+    }
+
+    sp<AMessage> format;
+    CHECK_EQ(convertMetaDataToMessage(source->getFormat(), &format), (status_t)OK);
+    format->setInt32("pcm-encoding", kAudioEncodingPcmFloat);
+
+    sp<ALooper> looper = new ALooper;
+    looper->start();
+
+    sp<MediaCodec> codec = MediaCodec::CreateByComponentName(looper, componentName);
+    EXPECT(codec != NULL, "Unable to create a MediaCodec for the component.");
+    status_t err = codec->configure(format, NULL /* nativeWindow */, NULL /* crypto */, 0);
+    EXPECT_SUCCESS(err, "configure");
+    CHECK_EQ(codec->start(), (status_t)OK);
+    CHECK_EQ(source->start(), (status_t)OK);
+
+    Vector<sp<MediaCodecBuffer> > inBuffers;
+    Vector<sp<MediaCodecBuffer> > outBuffers;
+    CHECK_EQ(codec->getInputBuffers(&inBuffers), (status_t)OK);
+    CHECK_EQ(codec->getOutputBuffers(&outBuffers), (status_t)OK);
+
+    static const int64_t kTimeoutUs = 10000ll;
+    static const size_t kMaxSamples = 10 * 48000 * 2;   // about 10 seconds of stereo audio
+    static const int64_t kMaxDurationUs = 30000000ll;
+    const int64_t deadlineUs = ALooper::GetNowUs() + kMaxDurationUs;
+
+    int32_t pcmEncoding = kAudioEncodingPcm16bit;
+    size_t numSamples = 0;
+    size_t numOutOfRange = 0;
+    float peak = 0.0f;
+    bool sawInputEOS = false;
+    bool sawOutputEOS = false;
+    status_t result = OK;
+    while (!sawOutputEOS && numSamples < kMaxSamples && result == OK) {
+        size_t index;
+        if (!sawInputEOS && codec->dequeueInputBuffer(&index, kTimeoutUs) == OK) {
+            const sp<MediaCodecBuffer> &buffer = inBuffers.itemAt(index);
+            MediaBuffer *mediaBuffer;
+            uint32_t flags = 0;
+            int64_t timeUs = 0;
+            size_t size = 0;
+            if (source->read(&mediaBuffer) == OK) {
+                size = mediaBuffer->range_length();
+                CHECK_LE(size, buffer->capacity());
+                memcpy(buffer->base(),
+                       (const uint8_t *)mediaBuffer->data() + mediaBuffer->range_offset(), size);
+                CHECK(mediaBuffer->meta_data()->findInt64(kKeyTime, &timeUs));
+                mediaBuffer->release();
+            } else {
+                flags = MediaCodec::BUFFER_FLAG_EOS;
+                sawInputEOS = true;
+            }
+            CHECK_EQ(codec->queueInputBuffer(index, 0 /* offset */, size, timeUs, flags),
+                     (status_t)OK);
+        }
+
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        err = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags, kTimeoutUs);
+        if (err == INFO_FORMAT_CHANGED) {
+            sp<AMessage> outputFormat;
+            CHECK_EQ(codec->getOutputFormat(&outputFormat), (status_t)OK);
+            (void)outputFormat->findInt32("pcm-encoding", &pcmEncoding);
+        } else if (err == INFO_OUTPUT_BUFFERS_CHANGED) {
+            CHECK_EQ(codec->getOutputBuffers(&outBuffers), (status_t)OK);
+        } else if (err == OK) {
+            if (pcmEncoding != kAudioEncodingPcmFloat) {
+                printf("\n  * Expected float output, got pcm-encoding %d\n", pcmEncoding);
+                result = UNKNOWN_ERROR;
+            } else if (size % sizeof(float) != 0) {
+                printf("\n  * Output buffer of %zu bytes is not made of floats\n", size);
+                result = UNKNOWN_ERROR;
+            } else {
+                const float *samples = (const float *)outBuffers.itemAt(index)->data();
+                for (size_t i = 0; i < size / sizeof(float); ++i) {
+                    if (!(fabsf(samples[i]) <= 1.0f)) {
+                        ++numOutOfRange;
+                    } else if (fabsf(samples[i]) > peak) {
+                        peak = fabsf(samples[i]);
+                    }
+                }
+                numSamples += size / sizeof(float);
+            }
+            sawOutputEOS = flags & MediaCodec::BUFFER_FLAG_EOS;
+            CHECK_EQ(codec->releaseOutputBuffer(index), (status_t)OK);
+        } else {
+            CHECK_EQ(err, -EAGAIN);
+            if (ALooper::GetNowUs() > deadlineUs) {
+                printf("\n  * Timed out waiting for float output\n");
+                result = TIMED_OUT;
+            }
+        }
+    }
+
+    CHECK_EQ(source->stop(), (status_t)OK);
+    CHECK_EQ(codec->release(), (status_t)OK);
+    looper->stop();
+
+    if (result != OK) {
+        return result;
+    }
+    EXPECT(numSamples > 0, "Expected float output.");
+    EXPECT(numOutOfRange == 0, "Expected float samples within [-1.0, 1.0].");
+    // 16-bit samples scaled twice would not get above 2^-15
+    EXPECT(peak > 0.001f, "Expected float samples scaled to [-1.0, 1.0].");
+
+    return OK;
+}
+
 status_t Harness::test(
         const char *componentName, const char *componentRole) {
     printf("testing %s [%s] ... ", componentName, componentRole);
@@ -777,12 +978,17 @@ status_t Harness::test(
 
     status_t err1 = testStateTransitions(componentName, componentRole);
     status_t err2 = testSeek(componentName, componentRole);
+    status_t err3 = testFloatOutput(componentName, componentRole);
 
     if (err1 != OK) {
         return err1;
     }
 
-    return err2;
+    if (err2 != OK) {
+        return err2;
+    }
+
+    return err3;
 }
 
 status_t Harness::testAll() {
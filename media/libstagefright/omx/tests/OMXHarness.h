@@ -70,6 +70,9 @@ struct Harness : public RefBase {
     status_t testSeek(
             const char *componentName, const char *componentRole);
 
+    status_t testFloatOutput(
+            const char *componentName, const char *componentRole);
+
     status_t test(
             const char *componentName, const char *componentRole);
 
@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SimpleSoftOMXComponent_test"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Condition.h>
+#include <utils/Mutex.h>
+#include <utils/Vector.h>
+
+#include <OMX_Core.h>
+#include <SimpleSoftOMXComponent.h>
+
+namespace android {
+
+static const size_t kNumBuffers = 4;
+static const size_t kBufferSize = 1024;
+static const nsecs_t kTimeoutNs = 1000000000LL;
+
+// Component that only records what the framework calls it with. onQueueFilled() leaves the
+// buffers queued and logs the port and the queue sizes it sees, onPortFlushCompleted() logs
+// the flushed port. It can hold the looper thread in onQueueFilled(), so that the calls the
+// test makes meanwhile are all picked up by the next wake-up.
+struct RecordingComponent : public SimpleSoftOMXComponent {
+    RecordingComponent(
+            bool batched,
+            const OMX_CALLBACKTYPE *callbacks,
+            OMX_PTR appData,
+            OMX_COMPONENTTYPE **component)
+        : SimpleSoftOMXComponent("OMX.test.recording", callbacks, appData, component),
+          mHold(false),
+          mHeld(false) {
+        addPort(0 /* portIndex */, OMX_DirInput);
+        addPort(1 /* portIndex */, OMX_DirOutput);
+        setBatchedQueueFilled(batched);
+    }
+
+    // Makes the next onQueueFilled() wait for release()
+    void holdNextQueueFilled() {
+        Mutex::Autolock autoLock(mEventLock);
+        mHold = true;
+        mHeld = false;
+    }
+
+    bool waitUntilHeld() {
+        Mutex::Autolock autoLock(mEventLock);
+        while (!mHeld) {
+            if (mCondition.waitRelative(mEventLock, kTimeoutNs) != OK) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void release() {
+        Mutex::Autolock autoLock(mEventLock);
+        mHold = false;
+        mCondition.broadcast();
+    }
+
+    // Waits until |count| events were logged, and returns and clears the log
+    std::vector<std::string> takeEvents(size_t count) {
+        Mutex::Autolock autoLock(mEventLock);
+        while (mEvents.size() < count) {
+            if (mCondition.waitRelative(mEventLock, kTimeoutNs) != OK) {
+                break;
+            }
+        }
+        std::vector<std::string> events;
+        events.swap(mEvents);
+        return events;
+    }
+
+protected:
+    virtual void onQueueFilled(OMX_U32 portIndex) {
+        Mutex::Autolock autoLock(mEventLock);
+        mEvents.push_back("filled " + std::to_string(portIndex) +
+                " in=" + std::to_string(getPortQueue(0).size()) +
+                " out=" + std::to_string(getPortQueue(1).size()));
+        mCondition.broadcast();
+        if (mHold) {
+            mHeld = true;
+            mCondition.broadcast();
+            while (mHold) {
+                mCondition.wait(mEventLock);
+            }
+        }
+    }
+
+    virtual void onPortFlushCompleted(OMX_U32 portIndex) {
+        Mutex::Autolock autoLock(mEventLock);
+        mEvents.push_back("flushed " + std::to_string(portIndex));
+        mCondition.broadcast();
+    }
+
+private:
+    Mutex mEventLock;
+    Condition mCondition;
+    std::vector<std::string> mEvents;
+    bool mHold;
+    bool mHeld;
+
+    void addPort(OMX_U32 portIndex, OMX_DIRTYPE dir) {
+        OMX_PARAM_PORTDEFINITIONTYPE def;
+        memset(&def, 0, sizeof(def));
+        def.nSize = sizeof(def);
+        def.nVersion.s.nVersionMajor = 1;
+        def.nPortIndex = portIndex;
+        def.eDir = dir;
+        def.nBufferCountMin = kNumBuffers;
+        def.nBufferCountActual = kNumBuffers;
+        def.nBufferSize = kBufferSize;
+        def.bEnabled = OMX_TRUE;
+        def.bPopulated = OMX_FALSE;
+        def.eDomain = OMX_PortDomainOther;
+        def.nBufferAlignment = 1;
+        SimpleSoftOMXComponent::addPort(def);
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(RecordingComponent);
+};
+
+// Plays the client side of the component: collects callbacks for the test thread.
+struct Client {
+    Mutex mLock;
+    Condition mCondition;
+    Vector<OMX_BUFFERHEADERTYPE *> mEmptied;
+    Vector<OMX_U32> mStates;
+    Vector<OMX_U32> mFlushed;
+    size_t mErrors = 0;
+
+    static OMX_ERRORTYPE OnEvent(
+            OMX_HANDLETYPE, OMX_PTR appData, OMX_EVENTTYPE event,
+            OMX_U32 data1, OMX_U32 data2, OMX_PTR) {
+        Client *client = (Client *)appData;
+        Mutex::Autolock autoLock(client->mLock);
+        if (event == OMX_EventCmdComplete && data1 == OMX_CommandStateSet) {
+            client->mStates.push_back(data2);
+        } else if (event == OMX_EventCmdComplete && data1 == OMX_CommandFlush) {
+            client->mFlushed.push_back(data2);
+        } else if (event == OMX_EventError) {
+            client->mErrors++;
+        }
+        client->mCondition.signal();
+        return OMX_ErrorNone;
+    }
+
+    static OMX_ERRORTYPE OnEmptyBufferDone(
+            OMX_HANDLETYPE, OMX_PTR appData, OMX_BUFFERHEADERTYPE *header) {
+        Client *client = (Client *)appData;
+        Mutex::Autolock autoLock(client->mLock);
+        client->mEmptied.push_back(header);
+        client->mCondition.signal();
+        return OMX_ErrorNone;
+    }
+
+    static OMX_ERRORTYPE OnFillBufferDone(
+            OMX_HANDLETYPE, OMX_PTR, OMX_BUFFERHEADERTYPE *) {
+        return OMX_ErrorNone;
+    }
+
+    // Waits for |value| to show up in |events| and removes it
+    bool waitFor(Vector<OMX_U32> *events, OMX_U32 value) {
+        Mutex::Autolock autoLock(mLock);
+        while (true) {
+            for (size_t i = 0; i < events->size(); ++i) {
+                if ((*events)[i] == value) {
+                    events->removeAt(i);
+                    return true;
+                }
+            }
+            if (mCondition.waitRelative(mLock, kTimeoutNs) != OK) {
+                return false;
+            }
+        }
+    }
+};
+
+// The component keeps a pointer to these
+static const OMX_CALLBACKTYPE kCallbacks = {
+    Client::OnEvent, Client::OnEmptyBufferDone, Client::OnFillBufferDone };
+
+class SimpleSoftOMXComponentTest : public ::testing::TestWithParam<bool> {
+protected:
+    virtual void SetUp() {
+        mComponentImpl = new RecordingComponent(GetParam(), &kCallbacks, &mClient, &mComponent);
+        ASSERT_EQ(OMX_ErrorNone, mComponentImpl->initCheck());
+
+        ASSERT_EQ(OMX_ErrorNone, OMX_SendCommand(
+                mComponent, OMX_CommandStateSet, OMX_StateIdle, NULL));
+        allocateBuffers(0 /* input */, &mInputBuffers);
+        allocateBuffers(1 /* output */, &mOutputBuffers);
+        ASSERT_TRUE(mClient.waitFor(&mClient.mStates, OMX_StateIdle));
+
+        ASSERT_EQ(OMX_ErrorNone, OMX_SendCommand(
+                mComponent, OMX_CommandStateSet, OMX_StateExecuting, NULL));
+        ASSERT_TRUE(mClient.waitFor(&mClient.mStates, OMX_StateExecuting));
+    }
+
+    virtual void TearDown() {
+        if (mComponentImpl == NULL) {
+            return;
+        }
+        mComponentImpl->release();
+        OMX_SendCommand(mComponent, OMX_CommandStateSet, OMX_StateIdle, NULL);
+        EXPECT_TRUE(mClient.waitFor(&mClient.mStates, OMX_StateIdle));
+        OMX_SendCommand(mComponent, OMX_CommandStateSet, OMX_StateLoaded, NULL);
+        for (size_t i = 0; i < mInputBuffers.size(); ++i) {
+            OMX_FreeBuffer(mComponent, 0, mInputBuffers[i]);
+        }
+        for (size_t i = 0; i < mOutputBuffers.size(); ++i) {
+            OMX_FreeBuffer(mComponent, 1, mOutputBuffers[i]);
+        }
+        EXPECT_TRUE(mClient.waitFor(&mClient.mStates, OMX_StateLoaded));
+        {
+            Mutex::Autolock autoLock(mClient.mLock);
+            EXPECT_EQ(0u, mClient.mErrors);
+        }
+
+        mComponentImpl->prepareForDestruction();
+        mComponentImpl.clear();
+    }
+
+    void allocateBuffers(OMX_U32 portIndex, Vector<OMX_BUFFERHEADERTYPE *> *buffers) {
+        for (size_t i = 0; i < kNumBuffers; ++i) {
+            OMX_BUFFERHEADERTYPE *header;
+            ASSERT_EQ(OMX_ErrorNone, OMX_AllocateBuffer(
+                    mComponent, &header, portIndex, NULL, kBufferSize));
+            buffers->push_back(header);
+        }
+    }
+
+    // Queues one output buffer and holds the looper thread in the onQueueFilled() call for
+    // it, so that the calls made until release() are processed in a single wake-up
+    void holdLooper() {
+        mComponentImpl->holdNextQueueFilled();
+        ASSERT_EQ(OMX_ErrorNone, OMX_FillThisBuffer(mComponent, mOutputBuffers[0]));
+        ASSERT_TRUE(mComponentImpl->waitUntilHeld());
+    }
+
+    Client mClient;
+    OMX_COMPONENTTYPE *mComponent = NULL;
+    sp<RecordingComponent> mComponentImpl;
+    Vector<OMX_BUFFERHEADERTYPE *> mInputBuffers;
+    Vector<OMX_BUFFERHEADERTYPE *> mOutputBuffers;
+};
+
+TEST_P(SimpleSoftOMXComponentTest, QueueFilledPerWakeUp) {
+    holdLooper();
+    // All of these are processed in one wake-up
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_EQ(OMX_ErrorNone, OMX_EmptyThisBuffer(mComponent, mInputBuffers[i]));
+        ASSERT_EQ(OMX_ErrorNone, OMX_FillThisBuffer(mComponent, mOutputBuffers[i + 1]));
+    }
+    mComponentImpl->release();
+
+    std::vector<std::string> expected;
+    if (GetParam()) {
+        // Every buffer is queued before onQueueFilled() is called once per port
+        expected = {
+            "filled 1 in=0 out=1",
+            "filled 0 in=3 out=4",
+            "filled 1 in=3 out=4",
+        };
+    } else {
+        expected = {
+            "filled 1 in=0 out=1",
+            "filled 0 in=1 out=1",
+            "filled 1 in=1 out=2",
+            "filled 0 in=2 out=2",
+            "filled 1 in=2 out=3",
+            "filled 0 in=3 out=3",
+            "filled 1 in=3 out=4",
+        };
+    }
+    EXPECT_EQ(expected, mComponentImpl->takeEvents(expected.size()));
+}
+
+TEST_P(SimpleSoftOMXComponentTest, CommandBetweenBuffersKeepsOrder) {
+    holdLooper();
+    ASSERT_EQ(OMX_ErrorNone, OMX_EmptyThisBuffer(mComponent, mInputBuffers[0]));
+    ASSERT_EQ(OMX_ErrorNone, OMX_EmptyThisBuffer(mComponent, mInputBuffers[1]));
+    ASSERT_EQ(OMX_ErrorNone, OMX_FillThisBuffer(mComponent, mOutputBuffers[1]));
+    ASSERT_EQ(OMX_ErrorNone, OMX_SendCommand(mComponent, OMX_CommandFlush, 0, NULL));
+    ASSERT_EQ(OMX_ErrorNone, OMX_EmptyThisBuffer(mComponent, mInputBuffers[2]));
+    ASSERT_EQ(OMX_ErrorNone, OMX_FillThisBuffer(mComponent, mOutputBuffers[2]));
+    mComponentImpl->release();
+
+    std::vector<std::string> expected;
+    if (GetParam()) {
+        // The buffers queued before the flush reach the component before it, and the ones
+        // queued after it survive it
+        expected = {
+            "filled 1 in=0 out=1",
+            "filled 0 in=2 out=2",
+            "filled 1 in=2 out=2",
+            "flushed 0",
+            "filled 0 in=1 out=3",
+            "filled 1 in=1 out=3",
+        };
+    } else {
+        expected = {
+            "filled 1 in=0 out=1",
+            "filled 0 in=1 out=1",
+            "filled 0 in=2 out=1",
+            "filled 1 in=2 out=2",
+            "flushed 0",
+            "filled 0 in=1 out=2",
+            "filled 1 in=1 out=3",
+        };
+    }
+    EXPECT_EQ(expected, mComponentImpl->takeEvents(expected.size()));
+
+    // The flush returned exactly the input buffers queued before it
+    ASSERT_TRUE(mClient.waitFor(&mClient.mFlushed, 0));
+    Mutex::Autolock autoLock(mClient.mLock);
+    ASSERT_EQ(2u, mClient.mEmptied.size());
+    EXPECT_EQ(mInputBuffers[0], mClient.mEmptied[0]);
+    EXPECT_EQ(mInputBuffers[1], mClient.mEmptied[1]);
+}
+
+INSTANTIATE_TEST_CASE_P(BatchedQueueFilled, SimpleSoftOMXComponentTest, ::testing::Bool());
+
+}  // namespace android
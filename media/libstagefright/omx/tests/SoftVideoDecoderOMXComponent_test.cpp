@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SoftVideoDecoderOMXComponent_test"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <cutils/properties.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Condition.h>
+#include <utils/Mutex.h>
+#include <utils/Vector.h>
+
+#include <OMX_Core.h>
+#include <SoftVideoDecoderOMXComponent.h>
+
+namespace android {
+
+static const uint32_t kWidth = 64;
+static const uint32_t kHeight = 64;
+static const size_t kNumBuffers = 4;
+static const size_t kInputBufferSize = 1024;
+static const size_t kNumFrames = 32;
+static const nsecs_t kTimeoutNs = 1000000000LL;
+
+// Decoder that "decodes" input buffer i by filling a whole output buffer with the byte
+// frameByte(i), which it reads from the start of the input buffer. In shared mode it keeps
+// the last frame it output as its reference, like a real codec, and never writes to a
+// buffer the client holds or to its reference.
+struct FakeSharedOutputDecoder : public SoftVideoDecoderOMXComponent {
+    FakeSharedOutputDecoder(
+            bool share,
+            const OMX_CALLBACKTYPE *callbacks,
+            OMX_PTR appData,
+            OMX_COMPONENTTYPE **component)
+        : SoftVideoDecoderOMXComponent(
+                "OMX.test.fake.video.decoder", "video_decoder.mpeg2", OMX_VIDEO_CodingMPEG2,
+                NULL /* profileLevels */, 0 /* numProfileLevels */, kWidth, kHeight,
+                callbacks, appData, component),
+          mShare(share),
+          mReference(-1),
+          mRegistered(0) {
+        initPorts(kNumBuffers, kInputBufferSize, kNumBuffers, "video/mpeg2");
+    }
+
+    using SoftVideoDecoderOMXComponent::sharedOutputBuffersAllowed;
+
+    // Buffers handed back to the codec through releaseSharedOutputBuffer(), in order
+    Vector<OMX_BUFFERHEADERTYPE *> released() {
+        Mutex::Autolock autoLock(mStatsLock);
+        return mReleased;
+    }
+
+    size_t registered() {
+        Mutex::Autolock autoLock(mStatsLock);
+        return mRegistered;
+    }
+
+protected:
+    virtual void onQueueFilled(OMX_U32 /* portIndex */) {
+        List<BufferInfo *> &inQueue = getPortQueue(kInputPortIndex);
+        List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
+
+        if (mShare) {
+            if (numSharedOutputBuffers() == 0) {
+                // Wait until we own every output buffer
+                if (outQueue.size() < kNumBuffers) {
+                    return;
+                }
+                size_t count = registerSharedOutputBuffers(kNumBuffers);
+                mAvailable.clear();
+                mAvailable.insertAt(true, 0, count);
+                Mutex::Autolock autoLock(mStatsLock);
+                mRegistered = count;
+            }
+            releaseSharedOutputBuffers();
+        }
+
+        while (!inQueue.empty()) {
+            BufferInfo *outInfo;
+            if (mShare) {
+                ssize_t id = pickSharedOutputBuffer();
+                if (id < 0) {
+                    return;
+                }
+                mAvailable.editItemAt(id) = false;
+                mReference = id;
+                outInfo = takeSharedOutputBuffer(id);
+                CHECK(outInfo != NULL);
+            } else {
+                if (outQueue.empty()) {
+                    return;
+                }
+                outInfo = *outQueue.begin();
+                outQueue.erase(outQueue.begin());
+            }
+
+            BufferInfo *inInfo = *inQueue.begin();
+            inQueue.erase(inQueue.begin());
+            OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
+            OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
+
+            memset(outHeader->pBuffer, inHeader->pBuffer[inHeader->nOffset],
+                    outHeader->nAllocLen);
+            outHeader->nOffset = 0;
+            outHeader->nFilledLen = outHeader->nAllocLen;
+            outHeader->nTimeStamp = inHeader->nTimeStamp;
+            outHeader->nFlags = 0;
+
+            inInfo->mOwnedByUs = false;
+            notifyEmptyBufferDone(inHeader);
+            outInfo->mOwnedByUs = false;
+            notifyFillBufferDone(outHeader);
+        }
+    }
+
+    virtual void releaseSharedOutputBuffer(size_t id) {
+        mAvailable.editItemAt(id) = true;
+        Mutex::Autolock autoLock(mStatsLock);
+        mReleased.push_back(sharedOutputBuffer(id));
+    }
+
+    virtual void onReset() {
+        SoftVideoDecoderOMXComponent::onReset();
+        clearSharedOutputBuffers();
+        mAvailable.clear();
+        mReference = -1;
+    }
+
+private:
+    const bool mShare;
+    Vector<bool> mAvailable;    // returned to the codec, by shared buffer id
+    ssize_t mReference;
+
+    Mutex mStatsLock;
+    Vector<OMX_BUFFERHEADERTYPE *> mReleased;
+    size_t mRegistered;
+
+    ssize_t pickSharedOutputBuffer() const {
+        for (size_t id = 0; id < mAvailable.size(); ++id) {
+            if (mAvailable[id] && (ssize_t)id != mReference) {
+                return id;
+            }
+        }
+        return -1;
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(FakeSharedOutputDecoder);
+};
+
+static uint8_t frameByte(size_t frame) {
+    return (uint8_t)(frame + 1);
+}
+
+// Plays the client side of the component: collects callbacks for the test thread.
+struct Client {
+    Mutex mLock;
+    Condition mCondition;
+    Vector<OMX_BUFFERHEADERTYPE *> mEmptied;
+    Vector<OMX_BUFFERHEADERTYPE *> mFilled;
+    Vector<OMX_U32> mStates;
+    size_t mErrors = 0;
+
+    static OMX_ERRORTYPE OnEvent(
+            OMX_HANDLETYPE, OMX_PTR appData, OMX_EVENTTYPE event,
+            OMX_U32 data1, OMX_U32 data2, OMX_PTR) {
+        Client *client = (Client *)appData;
+        Mutex::Autolock autoLock(client->mLock);
+        if (event == OMX_EventCmdComplete && data1 == OMX_CommandStateSet) {
+            client->mStates.push_back(data2);
+        } else if (event == OMX_EventError) {
+            client->mErrors++;
+        }
+        client->mCondition.signal();
+        return OMX_ErrorNone;
+    }
+
+    static OMX_ERRORTYPE OnEmptyBufferDone(
+            OMX_HANDLETYPE, OMX_PTR appData, OMX_BUFFERHEADERTYPE *header) {
+        Client *client = (Client *)appData;
+        Mutex::Autolock autoLock(client->mLock);
+        client->mEmptied.push_back(header);
+        client->mCondition.signal();
+        return OMX_ErrorNone;
+    }
+
+    static OMX_ERRORTYPE OnFillBufferDone(
+            OMX_HANDLETYPE, OMX_PTR appData, OMX_BUFFERHEADERTYPE *header) {
+        Client *client = (Client *)appData;
+        Mutex::Autolock autoLock(client->mLock);
+        client->mFilled.push_back(header);
+        client->mCondition.signal();
+        return OMX_ErrorNone;
+    }
+
+    bool waitForState(OMX_STATETYPE state) {
+        Mutex::Autolock autoLock(mLock);
+        while (true) {
+            for (size_t i = 0; i < mStates.size(); ++i) {
+                if (mStates[i] == (OMX_U32)state) {
+                    mStates.removeAt(i);
+                    return true;
+                }
+            }
+            if (mCondition.waitRelative(mLock, kTimeoutNs) != OK) {
+                return false;
+            }
+        }
+    }
+
+    // Waits for buffers to come back, and moves them to |emptied| and |filled|
+    bool waitForBuffers(
+            Vector<OMX_BUFFERHEADERTYPE *> *emptied, Vector<OMX_BUFFERHEADERTYPE *> *filled) {
+        Mutex::Autolock autoLock(mLock);
+        while (mEmptied.empty() && mFilled.empty()) {
+            if (mCondition.waitRelative(mLock, kTimeoutNs) != OK) {
+                return false;
+            }
+        }
+        emptied->appendVector(mEmptied);
+        filled->appendVector(mFilled);
+        mEmptied.clear();
+        mFilled.clear();
+        return true;
+    }
+};
+
+// The component keeps a pointer to these
+static const OMX_CALLBACKTYPE kCallbacks = {
+    Client::OnEvent, Client::OnEmptyBufferDone, Client::OnFillBufferDone };
+
+static bool bufferHolds(const OMX_BUFFERHEADERTYPE *header, uint8_t value) {
+    for (size_t i = 0; i < header->nAllocLen; ++i) {
+        if (header->pBuffer[i] != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class SoftVideoDecoderSharedOutputTest : public ::testing::TestWithParam<bool> {
+protected:
+    virtual void SetUp() {
+        mDecoder = new FakeSharedOutputDecoder(GetParam(), &kCallbacks, &mClient, &mComponent);
+        ASSERT_EQ(OMX_ErrorNone, mDecoder->initCheck());
+
+        ASSERT_EQ(OMX_ErrorNone, OMX_SendCommand(
+                mComponent, OMX_CommandStateSet, OMX_StateIdle, NULL));
+        allocateBuffers(0 /* input */, &mInputBuffers);
+        allocateBuffers(1 /* output */, &mOutputBuffers);
+        ASSERT_TRUE(mClient.waitForState(OMX_StateIdle));
+
+        ASSERT_EQ(OMX_ErrorNone, OMX_SendCommand(
+                mComponent, OMX_CommandStateSet, OMX_StateExecuting, NULL));
+        ASSERT_TRUE(mClient.waitForState(OMX_StateExecuting));
+    }
+
+    virtual void TearDown() {
+        if (mDecoder == NULL) {
+            return;
+        }
+        OMX_SendCommand(mComponent, OMX_CommandStateSet, OMX_StateIdle, NULL);
+        EXPECT_TRUE(mClient.waitForState(OMX_StateIdle));
+        OMX_SendCommand(mComponent, OMX_CommandStateSet, OMX_StateLoaded, NULL);
+        for (size_t i = 0; i < mInputBuffers.size(); ++i) {
+            OMX_FreeBuffer(mComponent, 0, mInputBuffers[i]);
+        }
+        for (size_t i = 0; i < mOutputBuffers.size(); ++i) {
+            OMX_FreeBuffer(mComponent, 1, mOutputBuffers[i]);
+        }
+        EXPECT_TRUE(mClient.waitForState(OMX_StateLoaded));
+        {
+            Mutex::Autolock autoLock(mClient.mLock);
+            EXPECT_EQ(0u, mClient.mErrors);
+        }
+
+        mDecoder->prepareForDestruction();
+        mDecoder.clear();
+    }
+
+    void allocateBuffers(OMX_U32 portIndex, Vector<OMX_BUFFERHEADERTYPE *> *buffers) {
+        OMX_PARAM_PORTDEFINITIONTYPE def;
+        memset(&def, 0, sizeof(def));
+        def.nSize = sizeof(def);
+        def.nVersion.s.nVersionMajor = 1;
+        def.nPortIndex = portIndex;
+        ASSERT_EQ(OMX_ErrorNone, OMX_GetParameter(
+                mComponent, OMX_IndexParamPortDefinition, &def));
+        ASSERT_EQ(kNumBuffers, def.nBufferCountActual);
+        for (size_t i = 0; i < def.nBufferCountActual; ++i) {
+            OMX_BUFFERHEADERTYPE *header;
+            ASSERT_EQ(OMX_ErrorNone, OMX_AllocateBuffer(
+                    mComponent, &header, portIndex, NULL, def.nBufferSize));
+            buffers->push_back(header);
+        }
+    }
+
+    // Decodes kNumFrames frames. The client holds up to two output buffers at a time and
+    // returns them newest first; |returned| gets them in the order they were returned.
+    void decode(Vector<OMX_BUFFERHEADERTYPE *> *returned) {
+        for (size_t i = 0; i < mOutputBuffers.size(); ++i) {
+            ASSERT_EQ(OMX_ErrorNone, OMX_FillThisBuffer(mComponent, mOutputBuffers[i]));
+        }
+
+        Vector<OMX_BUFFERHEADERTYPE *> freeInputs = mInputBuffers;
+        Vector<OMX_BUFFERHEADERTYPE *> held;
+        Vector<size_t> heldFrames;
+        size_t nextInput = 0;
+        size_t nextOutput = 0;
+        while (nextOutput < kNumFrames) {
+            while (!freeInputs.empty() && nextInput < kNumFrames) {
+                OMX_BUFFERHEADERTYPE *header = freeInputs.top();
+                freeInputs.pop();
+                header->pBuffer[0] = frameByte(nextInput);
+                header->nOffset = 0;
+                header->nFilledLen = 1;
+                header->nTimeStamp = nextInput * 1000;
+                header->nFlags = 0;
+                ASSERT_EQ(OMX_ErrorNone, OMX_EmptyThisBuffer(mComponent, header));
+                nextInput++;
+            }
+
+            Vector<OMX_BUFFERHEADERTYPE *> emptied, filled;
+            ASSERT_TRUE(mClient.waitForBuffers(&emptied, &filled)) <<
+                    "decoder stalled at frame " << nextOutput;
+            freeInputs.appendVector(emptied);
+
+            for (size_t i = 0; i < filled.size(); ++i) {
+                OMX_BUFFERHEADERTYPE *header = filled[i];
+                // Frames come out in decode order
+                ASSERT_EQ((OMX_TICKS)(nextOutput * 1000), header->nTimeStamp);
+                ASSERT_TRUE(bufferHolds(header, frameByte(nextOutput))) <<
+                        "frame " << nextOutput;
+                held.push_back(header);
+                heldFrames.push_back(nextOutput);
+                nextOutput++;
+
+                if (held.size() == 2) {
+                    for (ssize_t j = 1; j >= 0; --j) {
+                        // The codec must not write to buffers the client holds
+                        ASSERT_TRUE(bufferHolds(held[j], frameByte(heldFrames[j]))) <<
+                                "held frame " << heldFrames[j] << " was overwritten";
+                        returned->push_back(held[j]);
+                        ASSERT_EQ(OMX_ErrorNone, OMX_FillThisBuffer(mComponent, held[j]));
+                    }
+                    held.clear();
+                    heldFrames.clear();
+                }
+            }
+        }
+    }
+
+    Client mClient;
+    OMX_COMPONENTTYPE *mComponent = NULL;
+    sp<FakeSharedOutputDecoder> mDecoder;
+    Vector<OMX_BUFFERHEADERTYPE *> mInputBuffers;
+    Vector<OMX_BUFFERHEADERTYPE *> mOutputBuffers;
+};
+
+TEST_P(SoftVideoDecoderSharedOutputTest, DecodesInOrder) {
+    const bool share = GetParam();
+    Vector<OMX_BUFFERHEADERTYPE *> returned;
+    decode(&returned);
+
+    // Returned buffers go back to the codec when it next runs; moving to idle runs it for
+    // every buffer returned before.
+    ASSERT_EQ(OMX_ErrorNone, OMX_SendCommand(
+            mComponent, OMX_CommandStateSet, OMX_StateIdle, NULL));
+    ASSERT_TRUE(mClient.waitForState(OMX_StateIdle));
+    OMX_SendCommand(mComponent, OMX_CommandStateSet, OMX_StateExecuting, NULL);
+    ASSERT_TRUE(mClient.waitForState(OMX_StateExecuting));
+
+    Vector<OMX_BUFFERHEADERTYPE *> released = mDecoder->released();
+    if (share) {
+        EXPECT_EQ(kNumBuffers, mDecoder->registered());
+        // Every returned buffer is given back to the codec once, in the order the client
+        // returned it
+        ASSERT_EQ(returned.size(), released.size());
+        for (size_t i = 0; i < returned.size(); ++i) {
+            EXPECT_EQ(returned[i], released[i]) << "at release " << i;
+        }
+    } else {
+        EXPECT_EQ(0u, mDecoder->registered());
+        EXPECT_EQ(0u, released.size());
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(ShareOutput, SoftVideoDecoderSharedOutputTest,
+        ::testing::Values(false, true));
+
+TEST(SoftVideoDecoderSharedOutputPropertyTest, FollowsProperty) {
+    static const char *kProperty = "debug.stagefright.swcodec.share-output";
+    char saved[PROPERTY_VALUE_MAX];
+    property_get(kProperty, saved, "");
+
+    Client client;
+    OMX_COMPONENTTYPE *component;
+    sp<FakeSharedOutputDecoder> decoder =
+            new FakeSharedOutputDecoder(false, &kCallbacks, &client, &component);
+
+    if (property_set(kProperty, "1") != 0) {
+        ALOGW("Can't set %s, skipping", kProperty);
+    } else {
+        EXPECT_TRUE(decoder->sharedOutputBuffersAllowed());
+        ASSERT_EQ(0, property_set(kProperty, "0"));
+        EXPECT_FALSE(decoder->sharedOutputBuffersAllowed());
+        property_set(kProperty, saved);
+    }
+
+    decoder->prepareForDestruction();
+}
+
+}  // namespace android
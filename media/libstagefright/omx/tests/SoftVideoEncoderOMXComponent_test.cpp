@@ -0,0 +1,565 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SoftVideoEncoderOMXComponent_test"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include <media/hardware/HardwareAPI.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Condition.h>
+#include <utils/Mutex.h>
+#include <utils/Vector.h>
+
+#include <OMX_Core.h>
+#include <OMX_IndexExt.h>
+#include <SoftOMXPlugin.h>
+
+namespace android {
+
+// The default frame size of the software encoders
+static const uint32_t kWidth = 176;
+static const uint32_t kHeight = 144;
+static const OMX_TICKS kFrameDurationUs = 33333;
+static const nsecs_t kTimeoutNs = 5000000000LL;
+
+static const OMX_U32 kInputPortIndex = 0;
+static const OMX_U32 kOutputPortIndex = 1;
+
+// Synthetic clip: a panning scene, interrupted by a one-frame flash, then a cut to another
+// scene. It is shorter than the default AVC IDR interval of 30 frames, so the only IDRs are
+// the first frame and the ones placed by scene cut detection.
+static const size_t kClipFrames = 28;
+static const size_t kFlashFrame = 8;
+static const size_t kCutFrame = 16;
+
+static const int32_t kLookahead = 4;
+
+template<class T>
+static void InitOMXParams(T *params) {
+    memset(params, 0, sizeof(T));
+    params->nSize = sizeof(T);
+    params->nVersion.s.nVersionMajor = 1;
+}
+
+enum Scene {
+    kSceneA,    // horizontal gradient panning right
+    kSceneB,    // vertical gradient panning down
+    kFlash,     // white frame
+};
+
+struct Input {
+    std::vector<uint8_t> mData;
+    OMX_TICKS mTimeUs;
+    OMX_U32 mFlags;
+};
+
+struct Output {
+    std::vector<uint8_t> mData;
+    OMX_TICKS mTimeUs;
+    OMX_U32 mFlags;
+};
+
+// Returns frame |t| of |scene| in YUV420Planar
+static Input makeFrame(Scene scene, uint32_t t, OMX_TICKS timeUs) {
+    Input input;
+    input.mData.assign(kWidth * kHeight * 3 / 2, 128);
+    for (uint32_t y = 0; y < kHeight; ++y) {
+        for (uint32_t x = 0; x < kWidth; ++x) {
+            uint8_t luma;
+            switch (scene) {
+                case kSceneA:
+                    luma = 40 + (x + 2 * t) * 100 / kWidth;
+                    break;
+                case kSceneB:
+                    luma = 200 - (y + t) * 120 / kHeight;
+                    break;
+                default:
+                    luma = 235;
+                    break;
+            }
+            input.mData[y * kWidth + x] = luma;
+        }
+    }
+    input.mTimeUs = timeUs;
+    input.mFlags = 0;
+    return input;
+}
+
+static Input makeEOS(OMX_TICKS timeUs) {
+    Input input;
+    input.mTimeUs = timeUs;
+    input.mFlags = OMX_BUFFERFLAG_EOS;
+    return input;
+}
+
+// Returns the synthetic clip, starting at |startUs|, followed by the end of stream
+static std::vector<Input> makeClip(OMX_TICKS startUs) {
+    std::vector<Input> clip;
+    for (size_t i = 0; i < kClipFrames; ++i) {
+        Scene scene = i < kCutFrame ? kSceneA : kSceneB;
+        if (i == kFlashFrame) {
+            scene = kFlash;
+        }
+        clip.push_back(makeFrame(scene, i, startUs + i * kFrameDurationUs));
+    }
+    clip.push_back(makeEOS(startUs + kClipFrames * kFrameDurationUs));
+    return clip;
+}
+
+// Returns |count| frames of a panning scene, followed by the end of stream
+static std::vector<Input> makeFrames(size_t count) {
+    std::vector<Input> frames;
+    for (size_t i = 0; i < count; ++i) {
+        frames.push_back(makeFrame(kSceneA, i, i * kFrameDurationUs));
+    }
+    frames.push_back(makeEOS(count * kFrameDurationUs));
+    return frames;
+}
+
+// Plays the client side of the component: collects callbacks for the test thread.
+struct Client {
+    struct Command {
+        OMX_U32 mCommand;
+        OMX_U32 mParam;
+    };
+
+    Mutex mLock;
+    Condition mCondition;
+    Vector<OMX_BUFFERHEADERTYPE *> mEmptied;
+    Vector<OMX_BUFFERHEADERTYPE *> mFilled;
+    Vector<Command> mCompleted;
+    size_t mErrors = 0;
+
+    static OMX_ERRORTYPE OnEvent(
+            OMX_HANDLETYPE, OMX_PTR appData, OMX_EVENTTYPE event,
+            OMX_U32 data1, OMX_U32 data2, OMX_PTR) {
+        Client *client = (Client *)appData;
+        Mutex::Autolock autoLock(client->mLock);
+        if (event == OMX_EventCmdComplete) {
+            Command command = { data1, data2 };
+            client->mCompleted.push_back(command);
+        } else if (event == OMX_EventError) {
+            ALOGE("component error %#x", data1);
+            client->mErrors++;
+        }
+        client->mCondition.signal();
+        return OMX_ErrorNone;
+    }
+
+    static OMX_ERRORTYPE OnEmptyBufferDone(
+            OMX_HANDLETYPE, OMX_PTR appData, OMX_BUFFERHEADERTYPE *header) {
+        Client *client = (Client *)appData;
+        Mutex::Autolock autoLock(client->mLock);
+        client->mEmptied.push_back(header);
+        client->mCondition.signal();
+        return OMX_ErrorNone;
+    }
+
+    static OMX_ERRORTYPE OnFillBufferDone(
+            OMX_HANDLETYPE, OMX_PTR appData, OMX_BUFFERHEADERTYPE *header) {
+        Client *client = (Client *)appData;
+        Mutex::Autolock autoLock(client->mLock);
+        client->mFilled.push_back(header);
+        client->mCondition.signal();
+        return OMX_ErrorNone;
+    }
+
+    // Waits for a state change (OMX_CommandStateSet, state) or a flush
+    // (OMX_CommandFlush, port) to complete
+    bool waitForCommand(OMX_COMMANDTYPE command, OMX_U32 param) {
+        Mutex::Autolock autoLock(mLock);
+        while (true) {
+            for (size_t i = 0; i < mCompleted.size(); ++i) {
+                if (mCompleted[i].mCommand == (OMX_U32)command
+                        && mCompleted[i].mParam == param) {
+                    mCompleted.removeAt(i);
+                    return true;
+                }
+            }
+            if (mCondition.waitRelative(mLock, kTimeoutNs) != OK) {
+                return false;
+            }
+        }
+    }
+
+    // Waits for buffers to come back, and moves them to |emptied| and |filled|
+    bool waitForBuffers(
+            Vector<OMX_BUFFERHEADERTYPE *> *emptied, Vector<OMX_BUFFERHEADERTYPE *> *filled) {
+        Mutex::Autolock autoLock(mLock);
+        while (mEmptied.empty() && mFilled.empty()) {
+            if (mCondition.waitRelative(mLock, kTimeoutNs) != OK) {
+                return false;
+            }
+        }
+        emptied->appendVector(mEmptied);
+        filled->appendVector(mFilled);
+        mEmptied.clear();
+        mFilled.clear();
+        return true;
+    }
+};
+
+// The component keeps a pointer to these
+static const OMX_CALLBACKTYPE kCallbacks = {
+    Client::OnEvent, Client::OnEmptyBufferDone, Client::OnFillBufferDone };
+
+// Drives one of the software video encoders through the OMX interface, as ACodec does.
+class SoftVideoEncoderTest : public ::testing::Test {
+protected:
+    virtual void TearDown() {
+        release();
+    }
+
+    // Frees the component, so that the test can create another one
+    void release() {
+        if (mComponent == NULL) {
+            return;
+        }
+        if (mStarted) {
+            OMX_SendCommand(mComponent, OMX_CommandStateSet, OMX_StateIdle, NULL);
+            EXPECT_TRUE(mClient.waitForCommand(OMX_CommandStateSet, OMX_StateIdle));
+            OMX_SendCommand(mComponent, OMX_CommandStateSet, OMX_StateLoaded, NULL);
+            for (size_t i = 0; i < mInputBuffers.size(); ++i) {
+                OMX_FreeBuffer(mComponent, kInputPortIndex, mInputBuffers[i]);
+            }
+            for (size_t i = 0; i < mOutputBuffers.size(); ++i) {
+                OMX_FreeBuffer(mComponent, kOutputPortIndex, mOutputBuffers[i]);
+            }
+            EXPECT_TRUE(mClient.waitForCommand(OMX_CommandStateSet, OMX_StateLoaded));
+        }
+        {
+            Mutex::Autolock autoLock(mClient.mLock);
+            EXPECT_EQ(0u, mClient.mErrors);
+            mClient.mEmptied.clear();
+            mClient.mFilled.clear();
+            mClient.mCompleted.clear();
+        }
+        EXPECT_EQ(OMX_ErrorNone, mPlugin.destroyComponentInstance(mComponent));
+        mComponent = NULL;
+        mStarted = false;
+        mInputBuffers.clear();
+        mOutputBuffers.clear();
+        mFreeInputs.clear();
+        mFreeOutputs.clear();
+    }
+
+    void create(const char *name) {
+        ASSERT_EQ(OMX_ErrorNone,
+                mPlugin.makeComponentInstance(name, &kCallbacks, &mClient, &mComponent));
+    }
+
+    // Sets the int32 vendor extension |name|, as ACodec does for "vendor.<name>.value"
+    void setVendorExtension(const char *name, int32_t value) {
+        OMX_CONFIG_ANDROID_VENDOR_EXTENSIONTYPE ext;
+        for (OMX_U32 index = 0;; ++index) {
+            InitOMXParams(&ext);
+            ext.nIndex = index;
+            ext.nParamSizeUsed = 1;
+            ASSERT_EQ(OMX_ErrorNone, OMX_GetConfig(mComponent,
+                    (OMX_INDEXTYPE)OMX_IndexConfigAndroidVendorExtension, &ext)) <<
+                    name << " not found";
+            if (!strcmp((const char *)ext.cName, name)) {
+                break;
+            }
+        }
+        // ACodec only looks for the input settings among the input extensions
+        EXPECT_EQ(OMX_DirInput, ext.eDir);
+        ASSERT_EQ(1u, ext.nParamCount);
+        ASSERT_EQ(OMX_AndroidVendorValueInt32, ext.param[0].eValueType);
+
+        ext.param[0].bSet = OMX_TRUE;
+        ext.param[0].nInt32 = value;
+        ASSERT_EQ(OMX_ErrorNone, OMX_SetConfig(mComponent,
+                (OMX_INDEXTYPE)OMX_IndexConfigAndroidVendorExtension, &ext));
+    }
+
+    void getPortDefinition(OMX_U32 portIndex, OMX_PARAM_PORTDEFINITIONTYPE *def) {
+        InitOMXParams(def);
+        def->nPortIndex = portIndex;
+        ASSERT_EQ(OMX_ErrorNone, OMX_GetParameter(
+                mComponent, OMX_IndexParamPortDefinition, def));
+    }
+
+    void allocateBuffers(OMX_U32 portIndex, Vector<OMX_BUFFERHEADERTYPE *> *buffers) {
+        OMX_PARAM_PORTDEFINITIONTYPE def;
+        ASSERT_NO_FATAL_FAILURE(getPortDefinition(portIndex, &def));
+        for (size_t i = 0; i < def.nBufferCountActual; ++i) {
+            OMX_BUFFERHEADERTYPE *header;
+            ASSERT_EQ(OMX_ErrorNone, OMX_AllocateBuffer(
+                    mComponent, &header, portIndex, NULL, def.nBufferSize));
+            buffers->push_back(header);
+        }
+    }
+
+    void start() {
+        ASSERT_EQ(OMX_ErrorNone, OMX_SendCommand(
+                mComponent, OMX_CommandStateSet, OMX_StateIdle, NULL));
+        mStarted = true;
+        ASSERT_NO_FATAL_FAILURE(allocateBuffers(kInputPortIndex, &mInputBuffers));
+        ASSERT_NO_FATAL_FAILURE(allocateBuffers(kOutputPortIndex, &mOutputBuffers));
+        ASSERT_TRUE(mClient.waitForCommand(OMX_CommandStateSet, OMX_StateIdle));
+
+        ASSERT_EQ(OMX_ErrorNone, OMX_SendCommand(
+                mComponent, OMX_CommandStateSet, OMX_StateExecuting, NULL));
+        ASSERT_TRUE(mClient.waitForCommand(OMX_CommandStateSet, OMX_StateExecuting));
+        mFreeInputs = mInputBuffers;
+        mFreeOutputs = mOutputBuffers;
+    }
+
+    // Queues |inputs| and appends the non-empty output buffers to |outputs|. If the last
+    // input is the end of stream, returns once the end of stream is output; otherwise
+    // returns as soon as every input is queued.
+    void encode(const std::vector<Input> &inputs, std::vector<Output> *outputs) {
+        const bool toEOS = !inputs.empty() && (inputs.back().mFlags & OMX_BUFFERFLAG_EOS);
+        size_t next = 0;
+        while (true) {
+            while (!mFreeOutputs.empty()) {
+                OMX_BUFFERHEADERTYPE *header = mFreeOutputs.top();
+                mFreeOutputs.pop();
+                ASSERT_EQ(OMX_ErrorNone, OMX_FillThisBuffer(mComponent, header));
+            }
+            while (!mFreeInputs.empty() && next < inputs.size()) {
+                OMX_BUFFERHEADERTYPE *header = mFreeInputs.top();
+                mFreeInputs.pop();
+                const Input &input = inputs[next++];
+                ASSERT_LE(input.mData.size(), header->nAllocLen);
+                if (!input.mData.empty()) {
+                    memcpy(header->pBuffer, input.mData.data(), input.mData.size());
+                }
+                header->nOffset = 0;
+                header->nFilledLen = input.mData.size();
+                header->nTimeStamp = input.mTimeUs;
+                header->nFlags = input.mFlags;
+                ASSERT_EQ(OMX_ErrorNone, OMX_EmptyThisBuffer(mComponent, header));
+            }
+            if (!toEOS && next == inputs.size()) {
+                return;
+            }
+
+            Vector<OMX_BUFFERHEADERTYPE *> emptied, filled;
+            ASSERT_TRUE(mClient.waitForBuffers(&emptied, &filled)) <<
+                    "encoder stalled after " << next << " inputs";
+            mFreeInputs.appendVector(emptied);
+            if (collectOutputs(filled, outputs)) {
+                EXPECT_EQ(inputs.size(), next) << "end of stream before the last input";
+                return;
+            }
+        }
+    }
+
+    // Appends the non-empty buffers of |filled| to |outputs|, and takes the buffers back for
+    // the next frames. Returns true if one of them is the end of stream.
+    bool collectOutputs(
+            const Vector<OMX_BUFFERHEADERTYPE *> &filled, std::vector<Output> *outputs) {
+        bool sawEOS = false;
+        for (size_t i = 0; i < filled.size(); ++i) {
+            OMX_BUFFERHEADERTYPE *header = filled[i];
+            if (header->nFilledLen > 0) {
+                Output output;
+                output.mData.assign(header->pBuffer + header->nOffset,
+                        header->pBuffer + header->nOffset + header->nFilledLen);
+                output.mTimeUs = header->nTimeStamp;
+                output.mFlags = header->nFlags;
+                outputs->push_back(output);
+            }
+            if (header->nFlags & OMX_BUFFERFLAG_EOS) {
+                sawEOS = true;
+            }
+            mFreeOutputs.push_back(header);
+        }
+        return sawEOS;
+    }
+
+    // Flushes both ports, and appends the output returned before the flush to |outputs|.
+    // Every buffer must come back to the client.
+    void flush(std::vector<Output> *outputs) {
+        ASSERT_EQ(OMX_ErrorNone, OMX_SendCommand(
+                mComponent, OMX_CommandFlush, OMX_ALL, NULL));
+        ASSERT_TRUE(mClient.waitForCommand(OMX_CommandFlush, OMX_ALL));
+
+        Mutex::Autolock autoLock(mClient.mLock);
+        mFreeInputs.appendVector(mClient.mEmptied);
+        EXPECT_FALSE(collectOutputs(mClient.mFilled, outputs));
+        mClient.mEmptied.clear();
+        mClient.mFilled.clear();
+        EXPECT_EQ(mInputBuffers.size(), mFreeInputs.size());
+        EXPECT_EQ(mOutputBuffers.size(), mFreeOutputs.size());
+    }
+
+    SoftOMXPlugin mPlugin;
+    Client mClient;
+    OMX_COMPONENTTYPE *mComponent = NULL;
+    bool mStarted = false;
+    Vector<OMX_BUFFERHEADERTYPE *> mInputBuffers;
+    Vector<OMX_BUFFERHEADERTYPE *> mOutputBuffers;
+    Vector<OMX_BUFFERHEADERTYPE *> mFreeInputs;
+    Vector<OMX_BUFFERHEADERTYPE *> mFreeOutputs;
+};
+
+// Returns the frames of |outputs|, skipping codec config
+static std::vector<Output> framesOf(const std::vector<Output> &outputs) {
+    std::vector<Output> frames;
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        if (!(outputs[i].mFlags & OMX_BUFFERFLAG_CODECCONFIG)) {
+            frames.push_back(outputs[i]);
+        }
+    }
+    return frames;
+}
+
+// Checks that |outputs| hold one frame for each frame of |inputs|, in order, and returns
+// the indices of the sync frames
+static std::vector<size_t> syncFramesOf(
+        const std::vector<Input> &inputs, const std::vector<Output> &outputs) {
+    std::vector<Output> frames = framesOf(outputs);
+    std::vector<size_t> syncFrames;
+    size_t numInputFrames = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (!inputs[i].mData.empty()) {
+            numInputFrames++;
+        }
+    }
+    EXPECT_EQ(numInputFrames, frames.size());
+    for (size_t i = 0; i < frames.size() && i < numInputFrames; ++i) {
+        EXPECT_EQ(inputs[i].mTimeUs, frames[i].mTimeUs) << "frame " << i;
+        if (frames[i].mFlags & OMX_BUFFERFLAG_SYNCFRAME) {
+            syncFrames.push_back(i);
+        }
+    }
+    return syncFrames;
+}
+
+TEST_F(SoftVideoEncoderTest, AvcLookaheadRaisesInputBufferCount) {
+    ASSERT_NO_FATAL_FAILURE(create("OMX.google.h264.encoder"));
+    OMX_PARAM_PORTDEFINITIONTYPE def;
+    ASSERT_NO_FATAL_FAILURE(getPortDefinition(kInputPortIndex, &def));
+    const OMX_U32 bufferCount = def.nBufferCountActual;
+
+    ASSERT_NO_FATAL_FAILURE(setVendorExtension("android.lookahead", kLookahead));
+    ASSERT_NO_FATAL_FAILURE(getPortDefinition(kInputPortIndex, &def));
+    EXPECT_EQ(bufferCount + kLookahead, def.nBufferCountMin);
+    EXPECT_EQ(bufferCount + kLookahead, def.nBufferCountActual);
+}
+
+TEST_F(SoftVideoEncoderTest, AvcSceneCutIsIDR) {
+    ASSERT_NO_FATAL_FAILURE(create("OMX.google.h264.encoder"));
+    ASSERT_NO_FATAL_FAILURE(setVendorExtension("android.lookahead", kLookahead));
+    ASSERT_NO_FATAL_FAILURE(start());
+
+    std::vector<Input> clip = makeClip(0);
+    std::vector<Output> outputs;
+    ASSERT_NO_FATAL_FAILURE(encode(clip, &outputs));
+
+    // Neither the flash nor the return to the scene after it is an IDR
+    EXPECT_EQ(std::vector<size_t>({0, kCutFrame}), syncFramesOf(clip, outputs));
+}
+
+TEST_F(SoftVideoEncoderTest, AvcWithoutLookaheadIgnoresSceneCut) {
+    ASSERT_NO_FATAL_FAILURE(create("OMX.google.h264.encoder"));
+    ASSERT_NO_FATAL_FAILURE(start());
+
+    std::vector<Input> clip = makeClip(0);
+    std::vector<Output> outputs;
+    ASSERT_NO_FATAL_FAILURE(encode(clip, &outputs));
+
+    EXPECT_EQ(std::vector<size_t>({0}), syncFramesOf(clip, outputs));
+}
+
+TEST_F(SoftVideoEncoderTest, AvcFlushResetsLookahead) {
+    ASSERT_NO_FATAL_FAILURE(create("OMX.google.h264.encoder"));
+    ASSERT_NO_FATAL_FAILURE(setVendorExtension("android.lookahead", kLookahead));
+    ASSERT_NO_FATAL_FAILURE(start());
+
+    // Fewer frames than the lookahead window are queued, so the flush catches them all in
+    // the window. The buffers are queued again after the flush with other frames.
+    std::vector<Input> flushed;
+    for (size_t i = 0; i + 1 < (size_t)kLookahead; ++i) {
+        flushed.push_back(makeFrame(kSceneB, i, (100 + i) * kFrameDurationUs));
+    }
+    std::vector<Output> outputs;
+    ASSERT_NO_FATAL_FAILURE(encode(flushed, &outputs));
+    ASSERT_NO_FATAL_FAILURE(flush(&outputs));
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        EXPECT_TRUE(outputs[i].mFlags & OMX_BUFFERFLAG_CODECCONFIG) <<
+                "flushed frame at " << outputs[i].mTimeUs << " was encoded";
+    }
+
+    std::vector<Input> clip = makeClip(0);
+    outputs.clear();
+    ASSERT_NO_FATAL_FAILURE(encode(clip, &outputs));
+    EXPECT_EQ(std::vector<size_t>({0, kCutFrame}), syncFramesOf(clip, outputs));
+}
+
+TEST_F(SoftVideoEncoderTest, VpxLookaheadDrainsAtEOS) {
+    static const size_t kNumFrames = 12;
+    ASSERT_NO_FATAL_FAILURE(create("OMX.google.vp8.encoder"));
+    ASSERT_NO_FATAL_FAILURE(setVendorExtension("android.lookahead", 8));
+    ASSERT_NO_FATAL_FAILURE(start());
+
+    // The encoder lags behind the input; the frames it holds come out at the end of stream
+    std::vector<Input> frames = makeFrames(kNumFrames);
+    std::vector<Output> outputs;
+    ASSERT_NO_FATAL_FAILURE(encode(frames, &outputs));
+    std::vector<size_t> syncFrames = syncFramesOf(frames, outputs);
+    ASSERT_FALSE(syncFrames.empty());
+    EXPECT_EQ(0u, syncFrames[0]);
+}
+
+TEST_F(SoftVideoEncoderTest, VpxTwoPass) {
+    static const size_t kNumFrames = 10;
+    std::vector<Input> frames = makeFrames(kNumFrames);
+
+    // The first pass outputs statistics, including the final ones it is drained of at the
+    // end of stream
+    ASSERT_NO_FATAL_FAILURE(create("OMX.google.vp8.encoder"));
+    ASSERT_NO_FATAL_FAILURE(setVendorExtension("android.vpx-pass", 1));
+    ASSERT_NO_FATAL_FAILURE(start());
+    std::vector<Output> stats;
+    ASSERT_NO_FATAL_FAILURE(encode(frames, &stats));
+    EXPECT_LT(kNumFrames, stats.size());
+    for (size_t i = 0; i < stats.size(); ++i) {
+        EXPECT_EQ(0u, stats[i].mFlags & OMX_BUFFERFLAG_SYNCFRAME) << "packet " << i;
+    }
+    release();
+
+    // The last pass takes the statistics as codec config ahead of the frames
+    std::vector<Input> inputs;
+    for (size_t i = 0; i < stats.size(); ++i) {
+        Input input;
+        input.mData = stats[i].mData;
+        input.mTimeUs = 0;
+        input.mFlags = OMX_BUFFERFLAG_CODECCONFIG;
+        inputs.push_back(input);
+    }
+    ASSERT_NO_FATAL_FAILURE(create("OMX.google.vp8.encoder"));
+    ASSERT_NO_FATAL_FAILURE(setVendorExtension("android.vpx-pass", 2));
+    ASSERT_NO_FATAL_FAILURE(start());
+    std::vector<Output> outputs;
+    inputs.insert(inputs.end(), frames.begin(), frames.end());
+    ASSERT_NO_FATAL_FAILURE(encode(inputs, &outputs));
+
+    std::vector<size_t> syncFrames = syncFramesOf(frames, outputs);
+    ASSERT_FALSE(syncFrames.empty());
+    EXPECT_EQ(0u, syncFrames[0]);
+}
+
+}  // namespace android
@@ -579,14 +579,14 @@ sp<AudioFlinger::Client> AudioFlinger::registerPid(pid_t pid)
     return client;
 }
 
-sp<NBLog::Writer> AudioFlinger::newWriter_l(size_t size, const char *name)
+sp<IMemory> AudioFlinger::allocateLogMemory_l(size_t sharedSize)
 {
-    // If there is no memory allocated for logs, return a dummy writer that does nothing.
-    // Similarly if we can't contact the media.log service, also return a dummy writer.
+    // If there is no memory allocated for logs, or we can't contact the media.log service,
+    // the caller returns a dummy writer that does nothing.
     if (mLogMemoryDealer == 0 || sMediaLogService == 0) {
-        return new NBLog::Writer();
+        return 0;
     }
-    sp<IMemory> shared = mLogMemoryDealer->allocate(NBLog::Timeline::sharedSize(size));
+    sp<IMemory> shared = mLogMemoryDealer->allocate(sharedSize);
     // If allocation fails, consult the vector of previously unregistered writers
     // and garbage-collect one or more them until an allocation succeeds
     if (shared == 0) {
@@ -602,16 +602,22 @@ sp<NBLog::Writer> AudioFlinger::newWriter_l(size_t size, const char *name)
                 // the IMemory destructor will deallocate the region from mLogMemoryDealer.
             }
             // Re-attempt the allocation
-            shared = mLogMemoryDealer->allocate(NBLog::Timeline::sharedSize(size));
+            shared = mLogMemoryDealer->allocate(sharedSize);
             if (shared != 0) {
-                goto success;
+                break;
             }
         }
-        // Even after garbage-collecting all old writers, there is still not enough memory,
-        // so return a dummy writer
+        // Even after garbage-collecting all old writers, there may still not be enough memory
+    }
+    return shared;
+}
+
+sp<NBLog::Writer> AudioFlinger::newWriter_l(size_t size, const char *name)
+{
+    sp<IMemory> shared = allocateLogMemory_l(NBLog::Timeline::sharedSize(size));
+    if (shared == 0) {
         return new NBLog::Writer();
     }
-success:
     NBLog::Shared *sharedRawPtr = (NBLog::Shared *) shared->pointer();
     new((void *) sharedRawPtr) NBLog::Shared(); // placement new here, but the corresponding
                                                 // explicit destructor not needed since it is POD
@@ -619,6 +625,21 @@ success:
     return new NBLog::Writer(shared, size);
 }
 
+sp<NBLog::MultiWriter> AudioFlinger::newMultiWriter_l(size_t size, size_t segments,
+        const char *name)
+{
+    sp<IMemory> shared = allocateLogMemory_l(NBLog::MultiWriter::sharedSize(size, segments));
+    if (shared == 0) {
+        // dummy writer without shared memory, every log call is dropped
+        return new NBLog::MultiWriter(NULL, size, 0 /*segments*/);
+    }
+    // the MultiWriter constructor initializes the Shared header of each segment,
+    // so it must exist before media.log starts reading
+    sp<NBLog::MultiWriter> writer = new NBLog::MultiWriter(shared, size, segments);
+    sMediaLogService->registerWriter(shared, size, name);
+    return writer;
+}
+
 void AudioFlinger::unregisterWriter(const sp<NBLog::Writer>& writer)
 {
     if (writer == 0) {
@@ -3256,6 +3277,33 @@ int comparEntry(const void *p1, const void *p2)
 }
 
 #ifdef TEE_SINK
+struct TeeFile {
+    int     mFd;
+    size_t  mFrameSize;
+};
+
+// readVia_t callback for dumpTee(), writes directly from the tee pipe buffer to the file
+static ssize_t writeTeeFile(void *user, const void *buffer, size_t count)
+{
+    const TeeFile *teeFile = (const TeeFile *) user;
+    const size_t total = count * teeFile->mFrameSize;
+    // write whole frames only, so that the data stays aligned with the frame count in the header
+    for (size_t written = 0; written < total; ) {
+        ssize_t actual = write(teeFile->mFd, (const char *) buffer + written, total - written);
+        if (actual < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (actual == 0) {
+            return -EIO;
+        }
+        written += actual;
+    }
+    return count;
+}
+
 void AudioFlinger::dumpTee(int fd, const sp<NBAIO_Source>& source, audio_io_handle_t id, char suffix)
 {
     NBAIO_Source *teeSource = source.get();
@@ -3341,10 +3389,12 @@ void AudioFlinger::dumpTee(int fd, const sp<NBAIO_Source>& source, audio_io_hand
             size_t total = 0;
             bool firstRead = true;
 #define TEE_SINK_READ 1024                      // frames per I/O operation
-            void *buffer = malloc(TEE_SINK_READ * frameSize);
+            // The tee source is a PipeReader, whose readVia() hands out the pipe buffer
+            // itself, so the frames are written to the file without an intermediate copy.
+            TeeFile teeFile = { teeFd, frameSize };
             for (;;) {
                 size_t count = TEE_SINK_READ;
-                ssize_t actual = teeSource->read(buffer, count);
+                ssize_t actual = teeSource->readVia(writeTeeFile, count, &teeFile);
                 bool wasFirstRead = firstRead;
                 firstRead = false;
                 if (actual <= 0) {
@@ -3354,10 +3404,8 @@ void AudioFlinger::dumpTee(int fd, const sp<NBAIO_Source>& source, audio_io_hand
                     break;
                 }
                 ALOG_ASSERT(actual <= (ssize_t)count);
-                write(teeFd, buffer, actual * frameSize);
                 total += actual;
             }
-            free(buffer);
             lseek(teeFd, (off_t) 4, SEEK_SET);
             uint32_t temp = 44 + total * frameSize - 8;
             // FIXME not big-endian safe
@@ -288,6 +288,8 @@ public:
     // end of IAudioFlinger interface
 
     sp<NBLog::Writer>   newWriter_l(size_t size, const char *name);
+    // Like newWriter_l(), but the writer may be shared by up to 'segments' threads
+    sp<NBLog::MultiWriter> newMultiWriter_l(size_t size, size_t segments, const char *name);
     void                unregisterWriter(const sp<NBLog::Writer>& writer);
     sp<EffectsFactoryHalInterface> getEffectsFactory();
 
@@ -303,6 +305,9 @@ private:
     // FIXME The 400 is temporarily too high until a leak of writers in media.log is fixed.
     static const size_t kLogMemorySize = 400 * 1024;
     sp<MemoryDealer>    mLogMemoryDealer;   // == 0 when NBLog is disabled
+    // Allocates 'sharedSize' bytes of log memory, garbage-collecting unregistered writers
+    // as needed.  Returns 0 if NBLog is disabled or the memory is exhausted.
+    sp<IMemory>         allocateLogMemory_l(size_t sharedSize);
     // When a log writer is unregistered, it is done lazily so that media.log can continue to see it
     // for as long as possible.  The memory is only freed when it is needed for another log writer.
     Vector< sp<NBLog::Writer> > mUnregisteredWriters;
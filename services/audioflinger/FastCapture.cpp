@@ -193,6 +193,12 @@ void FastCapture::onWork()
         }
         if (mReadBufferState > 0) {
             ssize_t framesWritten = mPipeSink->write(mReadBuffer, mReadBufferState);
+            // The normal capture thread can't query the HAL capture position while we may be
+            // blocked in read(), so publish it to the pipe readers from here, after the read.
+            ExtendedTimestamp timestamp;
+            if (framesWritten > 0 && mInputSource->getTimestamp(timestamp) == OK) {
+                mPipeSink->setTimestamp(timestamp);
+            }
             // FIXME This supports at most one fast capture client.
             //       To handle multiple clients this could be converted to an array,
             //       or with a lot more work the control block could be shared by all clients.
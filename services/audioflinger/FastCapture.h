@@ -52,7 +52,7 @@ private:
     // FIXME by renaming, could pull up many of these to FastThread
     NBAIO_Source*       mInputSource;
     int                 mInputSourceGen;
-    NBAIO_Sink*         mPipeSink;
+    Pipe*               mPipeSink;
     int                 mPipeSinkGen;
     void*               mReadBuffer;
     ssize_t             mReadBufferState;   // number of initialized frames in readBuffer,
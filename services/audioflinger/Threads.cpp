@@ -1657,7 +1657,7 @@ AudioFlinger::PlaybackThread::PlaybackThread(const sp<AudioFlinger>& audioFlinge
         mHwSupportsPause(false), mHwPaused(false), mFlushPending(false)
 {
     snprintf(mThreadName, kThreadNameLength, "AudioOut_%X", id);
-    mNBLogWriter = audioFlinger->newWriter_l(kLogSize, mThreadName);
+    mNBLogWriter = audioFlinger->newMultiWriter_l(kLogSize, kLogSegments, mThreadName);
 
     // Assumes constructor is called by AudioFlinger with it's mLock held, but
     // it would be safer to explicitly pass initial masterVolume/masterMute as
@@ -2043,6 +2043,11 @@ sp<AudioFlinger::PlaybackThread::Track> AudioFlinger::PlaybackThread::createTrac
     lStatus = NO_ERROR;
 
 Exit:
+    // called on a binder thread, which must not keep a segment of the thread's log
+    mNBLogWriter->logTimestamp();
+    mNBLogWriter->logf("createTrack_l session %d flags %#x status %d",
+            sessionId, *flags, lStatus);
+    mNBLogWriter->releaseThread();
     *status = lStatus;
     return track;
 }
@@ -2948,14 +2953,9 @@ bool AudioFlinger::PlaybackThread::threadLoop()
 
     acquireWakeLock();
 
-    // mNBLogWriter logging APIs can only be called by a single thread, typically the
-    // thread associated with this PlaybackThread.
-    // If you want to share the mNBLogWriter with other threads (for example, binder threads)
-    // then all such threads must agree to hold a common mutex before logging.
-    // So if you need to log when mutex is unlocked, set logString to a non-NULL string,
-    // and then that string will be logged at the next convenient opportunity.
-    // See reference to logString below.
-    const char *logString = NULL;
+    // mNBLogWriter is a MultiWriter, so binder threads can log to it directly without
+    // holding a common mutex: each thread logs to its own segment.  This thread keeps its
+    // segment for its lifetime; binder threads release theirs after each use.
 
     // Estimated time for next buffer to be written to hal. This is used only on
     // suspended mode (for now) to help schedule the wait time until next iteration.
@@ -2979,13 +2979,6 @@ bool AudioFlinger::PlaybackThread::threadLoop()
 
             processConfigEvents_l();
 
-            // See comment at declaration of logString for why this is done under mLock
-            if (logString != NULL) {
-                mNBLogWriter->logTimestamp();
-                mNBLogWriter->log(logString);
-                logString = NULL;
-            }
-
             // Gather the framesReleased counters for all active tracks,
             // and associate with the sink frames written out.  We need
             // this to convert the sink timestamp to the track timestamp.
@@ -5941,7 +5934,7 @@ AudioFlinger::RecordThread::RecordThread(const sp<AudioFlinger>& audioFlinger,
     , mBtNrecSuspended(false)
 {
     snprintf(mThreadName, kThreadNameLength, "AudioIn_%X", id);
-    mNBLogWriter = audioFlinger->newWriter_l(kLogSize, mThreadName);
+    mNBLogWriter = audioFlinger->newMultiWriter_l(kLogSize, kLogSegments, mThreadName);
 
     readInputParameters_l();
 
@@ -6360,6 +6353,15 @@ reacquire_wakelock:
                 // Also, it is not advantageous to call get_presentation_position during the read
                 // as the read obtains a lock, preventing the timestamp call from executing.
             }
+        } else {
+            // FastCapture publishes the capture position in the pipe after each read
+            ExtendedTimestamp pipeTimestamp;
+            if (mPipeSource->getTimestamp(pipeTimestamp) == NO_ERROR) {
+                mTimestamp.mPosition[ExtendedTimestamp::LOCATION_KERNEL] =
+                        pipeTimestamp.mPosition[ExtendedTimestamp::LOCATION_KERNEL];
+                mTimestamp.mTimeNs[ExtendedTimestamp::LOCATION_KERNEL] =
+                        pipeTimestamp.mTimeNs[ExtendedTimestamp::LOCATION_KERNEL];
+            }
         }
         // Use this to track timestamp information
         // ALOGD("%s", mTimestamp.toString().c_str());
@@ -486,7 +486,9 @@ protected:
                 KeyedVector< audio_session_t, KeyedVector< int, sp<SuspendedSessionDesc> > >
                                         mSuspendedSessions;
                 static const size_t     kLogSize = 4 * 1024;
-                sp<NBLog::Writer>       mNBLogWriter;
+                // the thread itself plus binder threads, see NBLog::MultiWriter
+                static const size_t     kLogSegments = 3;
+                sp<NBLog::MultiWriter>  mNBLogWriter;
                 bool                    mSystemReady;
                 ExtendedTimestamp       mTimestamp;
                 // A condition that must be evaluated by the thread loop has changed and
@@ -36,6 +36,7 @@ LOCAL_SRC_FILES :=  \
     api1/client2/StreamingProcessor.cpp \
     api1/client2/JpegProcessor.cpp \
     api1/client2/CallbackProcessor.cpp \
+    api1/client2/FlexibleYuvConverter.cpp \
     api1/client2/JpegCompressor.cpp \
     api1/client2/CaptureSequencer.cpp \
     api1/client2/ZslProcessor.cpp \
@@ -51,6 +52,7 @@ LOCAL_SRC_FILES :=  \
     device3/StatusTracker.cpp \
     device3/Camera3BufferManager.cpp \
     device3/Camera3StreamSplitter.cpp \
+    device3/ResultMetadataPool.cpp \
     gui/RingBufferConsumer.cpp \
     utils/CameraTraces.cpp \
     utils/AutoConditionLock.cpp \
@@ -1506,6 +1506,11 @@ status_t Camera2Client::setParameters(const String8& params) {
 
     SharedParameters::Lock l(mParameters);
 
+    if (l.mParameters.isUnchanged(params)) {
+        ALOGV("%s: Camera %d: Parameters unchanged", __FUNCTION__, mCameraId);
+        return OK;
+    }
+
     Parameters::focusMode_t focusModeBefore = l.mParameters.focusMode;
     res = l.mParameters.set(params);
     if (res != OK) return res;
@@ -25,6 +25,7 @@
 #include "common/CameraDeviceBase.h"
 #include "api1/Camera2Client.h"
 #include "api1/client2/CallbackProcessor.h"
+#include "api1/client2/FlexibleYuvConverter.h"
 
 #define ALIGN(x, mask) ( ((x) + (mask) - 1) & ~((mask) - 1) )
 
@@ -462,88 +463,7 @@ status_t CallbackProcessor::convertFromFlexibleYuv(int32_t previewFormat,
         return INVALID_OPERATION;
     }
 
-    // Copy Y plane, adjusting for stride
-    const uint8_t *ySrc = src.data;
-    uint8_t *yDst = dst;
-    for (size_t row = 0; row < src.height; row++) {
-        memcpy(yDst, ySrc, src.width);
-        ySrc += src.stride;
-        yDst += dstYStride;
-    }
-
-    // Copy/swizzle chroma planes, 4:2:0 subsampling
-    const uint8_t *cbSrc = src.dataCb;
-    const uint8_t *crSrc = src.dataCr;
-    size_t chromaHeight = src.height / 2;
-    size_t chromaWidth = src.width / 2;
-    ssize_t chromaGap = src.chromaStride -
-            (chromaWidth * src.chromaStep);
-    size_t dstChromaGap = dstCStride - chromaWidth;
-
-    if (previewFormat == HAL_PIXEL_FORMAT_YCrCb_420_SP) {
-        // Flexible YUV chroma to NV21 chroma
-        uint8_t *crcbDst = yDst;
-        // Check for shortcuts
-        if (cbSrc == crSrc + 1 && src.chromaStep == 2) {
-            ALOGV("%s: Fast NV21->NV21", __FUNCTION__);
-            // Source has semiplanar CrCb chroma layout, can copy by rows
-            for (size_t row = 0; row < chromaHeight; row++) {
-                memcpy(crcbDst, crSrc, src.width);
-                crcbDst += src.width;
-                crSrc += src.chromaStride;
-            }
-        } else {
-            ALOGV("%s: Generic->NV21", __FUNCTION__);
-            // Generic copy, always works but not very efficient
-            for (size_t row = 0; row < chromaHeight; row++) {
-                for (size_t col = 0; col < chromaWidth; col++) {
-                    *(crcbDst++) = *crSrc;
-                    *(crcbDst++) = *cbSrc;
-                    crSrc += src.chromaStep;
-                    cbSrc += src.chromaStep;
-                }
-                crSrc += chromaGap;
-                cbSrc += chromaGap;
-            }
-        }
-    } else {
-        // flexible YUV chroma to YV12 chroma
-        ALOG_ASSERT(previewFormat == HAL_PIXEL_FORMAT_YV12,
-                "Unexpected preview format 0x%x", previewFormat);
-        uint8_t *crDst = yDst;
-        uint8_t *cbDst = yDst + chromaHeight * dstCStride;
-        if (src.chromaStep == 1) {
-            ALOGV("%s: Fast YV12->YV12", __FUNCTION__);
-            // Source has planar chroma layout, can copy by row
-            for (size_t row = 0; row < chromaHeight; row++) {
-                memcpy(crDst, crSrc, chromaWidth);
-                crDst += dstCStride;
-                crSrc += src.chromaStride;
-            }
-            for (size_t row = 0; row < chromaHeight; row++) {
-                memcpy(cbDst, cbSrc, chromaWidth);
-                cbDst += dstCStride;
-                cbSrc += src.chromaStride;
-            }
-        } else {
-            ALOGV("%s: Generic->YV12", __FUNCTION__);
-            // Generic copy, always works but not very efficient
-            for (size_t row = 0; row < chromaHeight; row++) {
-                for (size_t col = 0; col < chromaWidth; col++) {
-                    *(crDst++) = *crSrc;
-                    *(cbDst++) = *cbSrc;
-                    crSrc += src.chromaStep;
-                    cbSrc += src.chromaStep;
-                }
-                crSrc += chromaGap;
-                cbSrc += chromaGap;
-                crDst += dstChromaGap;
-                cbDst += dstChromaGap;
-            }
-        }
-    }
-
-    return OK;
+    return convertFlexibleYuv(previewFormat, dst, src, dstYStride, dstCStride);
 }
 
 }; // namespace camera2
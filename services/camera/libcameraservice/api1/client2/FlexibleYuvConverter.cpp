@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Camera2-FlexibleYuvConverter"
+//#define LOG_NDEBUG 0
+
+#include <string.h>
+
+#include <utils/Log.h>
+#include <system/graphics.h>
+
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON
+#endif
+
+#include "api1/client2/FlexibleYuvConverter.h"
+
+namespace android {
+namespace camera2 {
+
+namespace {
+
+// Row kernels for the flexible YUV conversion. The NEON versions handle 16 chroma
+// samples per iteration; the scalar loops are simple enough for the compiler to
+// vectorize on other targets.
+
+// Copy a plane row by row, as a single copy when neither side has padding
+void copyPlane(uint8_t *dst, size_t dstStride, const uint8_t *src, size_t srcStride,
+        size_t width, size_t height) {
+    if (height == 0) return;
+    if (dstStride == srcStride && (srcStride == width || height == 1)) {
+        memcpy(dst, src, srcStride * (height - 1) + width);
+        return;
+    }
+    for (size_t row = 0; row < height; row++) {
+        memcpy(dst, src, width);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+// Interleave two planar chroma rows: dst = u0 v0 u1 v1 ...
+void interleaveRow(uint8_t * __restrict dst, const uint8_t * __restrict u,
+        const uint8_t * __restrict v, size_t width) {
+    size_t col = 0;
+#ifdef USE_NEON
+    for (; col + 16 <= width; col += 16) {
+        uint8x16x2_t uv;
+        uv.val[0] = vld1q_u8(u + col);
+        uv.val[1] = vld1q_u8(v + col);
+        vst2q_u8(dst + 2 * col, uv);
+    }
+#endif
+    for (; col < width; col++) {
+        dst[2 * col] = u[col];
+        dst[2 * col + 1] = v[col];
+    }
+}
+
+// Split a semiplanar chroma row: u = src[0] src[2] ..., v = src[1] src[3] ...
+void deinterleaveRow(uint8_t * __restrict u, uint8_t * __restrict v,
+        const uint8_t * __restrict src, size_t width) {
+    size_t col = 0;
+#ifdef USE_NEON
+    for (; col + 16 <= width; col += 16) {
+        uint8x16x2_t uv = vld2q_u8(src + 2 * col);
+        vst1q_u8(u + col, uv.val[0]);
+        vst1q_u8(v + col, uv.val[1]);
+    }
+#endif
+    for (; col < width; col++) {
+        u[col] = src[2 * col];
+        v[col] = src[2 * col + 1];
+    }
+}
+
+// Swap the samples of each pair in a semiplanar chroma row (NV12 <-> NV21)
+void swapPairsRow(uint8_t * __restrict dst, const uint8_t * __restrict src, size_t width) {
+    size_t col = 0;
+#ifdef USE_NEON
+    for (; col + 16 <= width; col += 16) {
+        vst1q_u8(dst + 2 * col, vrev16q_u8(vld1q_u8(src + 2 * col)));
+        vst1q_u8(dst + 2 * col + 16, vrev16q_u8(vld1q_u8(src + 2 * col + 16)));
+    }
+#endif
+    for (; col < width; col++) {
+        dst[2 * col] = src[2 * col + 1];
+        dst[2 * col + 1] = src[2 * col];
+    }
+}
+
+// Per-sample chroma copies, for any chroma step and plane order
+void genericChromaToNv21(uint8_t *crcbDst, const CpuConsumer::LockedBuffer &src) {
+    const uint8_t *cbSrc = src.dataCb;
+    const uint8_t *crSrc = src.dataCr;
+    size_t chromaHeight = src.height / 2;
+    size_t chromaWidth = src.width / 2;
+    ssize_t chromaGap = src.chromaStride - (chromaWidth * src.chromaStep);
+    for (size_t row = 0; row < chromaHeight; row++) {
+        for (size_t col = 0; col < chromaWidth; col++) {
+            *(crcbDst++) = *crSrc;
+            *(crcbDst++) = *cbSrc;
+            crSrc += src.chromaStep;
+            cbSrc += src.chromaStep;
+        }
+        crSrc += chromaGap;
+        cbSrc += chromaGap;
+    }
+}
+
+void genericChromaToYv12(uint8_t *crDst, uint8_t *cbDst, uint32_t dstCStride,
+        const CpuConsumer::LockedBuffer &src) {
+    const uint8_t *cbSrc = src.dataCb;
+    const uint8_t *crSrc = src.dataCr;
+    size_t chromaHeight = src.height / 2;
+    size_t chromaWidth = src.width / 2;
+    ssize_t chromaGap = src.chromaStride - (chromaWidth * src.chromaStep);
+    size_t dstChromaGap = dstCStride - chromaWidth;
+    for (size_t row = 0; row < chromaHeight; row++) {
+        for (size_t col = 0; col < chromaWidth; col++) {
+            *(crDst++) = *crSrc;
+            *(cbDst++) = *cbSrc;
+            crSrc += src.chromaStep;
+            cbSrc += src.chromaStep;
+        }
+        crSrc += chromaGap;
+        cbSrc += chromaGap;
+        crDst += dstChromaGap;
+        cbDst += dstChromaGap;
+    }
+}
+
+} // anonymous namespace
+
+status_t convertFlexibleYuv(int32_t previewFormat, uint8_t *dst,
+        const CpuConsumer::LockedBuffer &src, uint32_t dstYStride, uint32_t dstCStride) {
+    if (previewFormat != HAL_PIXEL_FORMAT_YCrCb_420_SP &&
+            previewFormat != HAL_PIXEL_FORMAT_YV12) {
+        return INVALID_OPERATION;
+    }
+
+    // Copy Y plane, adjusting for stride
+    copyPlane(dst, dstYStride, src.data, src.stride, src.width, src.height);
+    uint8_t *yDst = dst + src.height * dstYStride;
+
+    // Copy/swizzle chroma planes, 4:2:0 subsampling
+    const uint8_t *cbSrc = src.dataCb;
+    const uint8_t *crSrc = src.dataCr;
+    size_t chromaHeight = src.height / 2;
+    size_t chromaWidth = src.width / 2;
+
+    if (previewFormat == HAL_PIXEL_FORMAT_YCrCb_420_SP) {
+        // Flexible YUV chroma to NV21 chroma
+        uint8_t *crcbDst = yDst;
+        // Check for shortcuts
+        if (cbSrc == crSrc + 1 && src.chromaStep == 2) {
+            ALOGV("%s: Fast NV21->NV21", __FUNCTION__);
+            // Source has semiplanar CrCb chroma layout, can copy by rows
+            copyPlane(crcbDst, chromaWidth * 2, crSrc, src.chromaStride, chromaWidth * 2,
+                    chromaHeight);
+        } else if (crSrc == cbSrc + 1 && src.chromaStep == 2) {
+            ALOGV("%s: Fast NV12->NV21", __FUNCTION__);
+            // Source has semiplanar CbCr chroma layout, swap each pair
+            for (size_t row = 0; row < chromaHeight; row++) {
+                swapPairsRow(crcbDst, cbSrc, chromaWidth);
+                crcbDst += chromaWidth * 2;
+                cbSrc += src.chromaStride;
+            }
+        } else if (src.chromaStep == 1) {
+            ALOGV("%s: Fast YV12->NV21", __FUNCTION__);
+            // Source has planar chroma layout, interleave by rows
+            for (size_t row = 0; row < chromaHeight; row++) {
+                interleaveRow(crcbDst, crSrc, cbSrc, chromaWidth);
+                crcbDst += chromaWidth * 2;
+                crSrc += src.chromaStride;
+                cbSrc += src.chromaStride;
+            }
+        } else {
+            ALOGV("%s: Generic->NV21", __FUNCTION__);
+            genericChromaToNv21(crcbDst, src);
+        }
+    } else {
+        // flexible YUV chroma to YV12 chroma
+        uint8_t *crDst = yDst;
+        uint8_t *cbDst = yDst + chromaHeight * dstCStride;
+        if (src.chromaStep == 1) {
+            ALOGV("%s: Fast YV12->YV12", __FUNCTION__);
+            // Source has planar chroma layout, can copy by row
+            copyPlane(crDst, dstCStride, crSrc, src.chromaStride, chromaWidth, chromaHeight);
+            copyPlane(cbDst, dstCStride, cbSrc, src.chromaStride, chromaWidth, chromaHeight);
+        } else if (src.chromaStep == 2 && (cbSrc == crSrc + 1 || crSrc == cbSrc + 1)) {
+            ALOGV("%s: Fast NV21/NV12->YV12", __FUNCTION__);
+            // Source has semiplanar chroma layout, split by rows
+            bool crFirst = crSrc < cbSrc;
+            const uint8_t *chromaSrc = crFirst ? crSrc : cbSrc;
+            for (size_t row = 0; row < chromaHeight; row++) {
+                if (crFirst) {
+                    deinterleaveRow(crDst, cbDst, chromaSrc, chromaWidth);
+                } else {
+                    deinterleaveRow(cbDst, crDst, chromaSrc, chromaWidth);
+                }
+                chromaSrc += src.chromaStride;
+                crDst += dstCStride;
+                cbDst += dstCStride;
+            }
+        } else {
+            ALOGV("%s: Generic->YV12", __FUNCTION__);
+            genericChromaToYv12(crDst, cbDst, dstCStride, src);
+        }
+    }
+
+    return OK;
+}
+
+status_t convertFlexibleYuvGeneric(int32_t previewFormat, uint8_t *dst,
+        const CpuConsumer::LockedBuffer &src, uint32_t dstYStride, uint32_t dstCStride) {
+    if (previewFormat != HAL_PIXEL_FORMAT_YCrCb_420_SP &&
+            previewFormat != HAL_PIXEL_FORMAT_YV12) {
+        return INVALID_OPERATION;
+    }
+
+    const uint8_t *ySrc = src.data;
+    uint8_t *yDst = dst;
+    for (size_t row = 0; row < src.height; row++) {
+        memcpy(yDst, ySrc, src.width);
+        ySrc += src.stride;
+        yDst += dstYStride;
+    }
+
+    if (previewFormat == HAL_PIXEL_FORMAT_YCrCb_420_SP) {
+        genericChromaToNv21(yDst, src);
+    } else {
+        genericChromaToYv12(yDst, yDst + (src.height / 2) * dstCStride, dstCStride, src);
+    }
+    return OK;
+}
+
+}; // namespace camera2
+}; // namespace android
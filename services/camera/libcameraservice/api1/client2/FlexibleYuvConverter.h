@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SERVERS_CAMERA_CAMERA2_FLEXIBLEYUVCONVERTER_H
+#define ANDROID_SERVERS_CAMERA_CAMERA2_FLEXIBLEYUVCONVERTER_H
+
+#include <utils/Errors.h>
+#include <gui/CpuConsumer.h>
+
+namespace android {
+namespace camera2 {
+
+/**
+ * Convert a flexible YUV 4:2:0 buffer to NV21 (HAL_PIXEL_FORMAT_YCrCb_420_SP) or YV12
+ * preview callback data, with the given destination strides. Semiplanar and planar
+ * sources are repacked by rows; any other chroma layout is copied sample by sample.
+ * Returns INVALID_OPERATION for any other preview format.
+ */
+status_t convertFlexibleYuv(int32_t previewFormat, uint8_t *dst,
+        const CpuConsumer::LockedBuffer &src, uint32_t dstYStride, uint32_t dstCStride);
+
+/**
+ * Same as convertFlexibleYuv, but always copies sample by sample. Reference for tests
+ * and benchmarks of the row repacking.
+ */
+status_t convertFlexibleYuvGeneric(int32_t previewFormat, uint8_t *dst,
+        const CpuConsumer::LockedBuffer &src, uint32_t dstYStride, uint32_t dstCStride);
+
+}; // namespace camera2
+}; // namespace android
+
+#endif
@@ -1267,6 +1267,13 @@ camera_metadata_ro_entry_t Parameters::staticInfo(uint32_t tag,
     return entry;
 }
 
+bool Parameters::isUnchanged(const String8& paramString) const {
+    // Apps often write back the settings they just read. Those match the flattened
+    // parameters exactly, unless an autofocus run has temporarily overridden the
+    // focus mode, which set() would then restore.
+    return shadowFocusMode == FOCUS_MODE_INVALID && paramString == paramsFlattened;
+}
+
 status_t Parameters::set(const String8& paramString) {
     status_t res;
 
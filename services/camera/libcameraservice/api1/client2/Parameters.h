@@ -270,6 +270,10 @@ struct Parameters {
     // Validate and update camera parameters based on new settings
     status_t set(const String8 &paramString);
 
+    // Whether set() with these settings would leave the parameters as they are,
+    // so validation can be skipped
+    bool isUnchanged(const String8 &paramString) const;
+
     // Retrieve the current settings
     String8 get() const;
 
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Cost of converting one flexible YUV preview frame to the NV21 or YV12 data of an API1
+ * preview callback, for each common source chroma layout, at the usual preview sizes.
+ * Each layout is run through convertFlexibleYuv() and through the per-sample copy it
+ * replaces, convertFlexibleYuvGeneric().
+ */
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <system/graphics.h>
+
+#include "api1/client2/FlexibleYuvConverter.h"
+
+using namespace android;
+using namespace android::camera2;
+
+enum ChromaLayout {
+    LAYOUT_NV21,    // semiplanar, Cr first
+    LAYOUT_NV12,    // semiplanar, Cb first
+    LAYOUT_PLANAR,  // separate Cr and Cb planes
+};
+
+static const int kSizes[][2] = { { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+
+typedef status_t (*ConvertFn)(int32_t, uint8_t *, const CpuConsumer::LockedBuffer &,
+        uint32_t, uint32_t);
+
+static void convert(benchmark::State& state, ConvertFn convertFn, int32_t format) {
+    const uint32_t width = kSizes[state.range(0)][0];
+    const uint32_t height = kSizes[state.range(0)][1];
+    const ChromaLayout layout = (ChromaLayout) state.range(1);
+
+    // Source as a HAL would lay it out, with 64-aligned rows
+    const uint32_t stride = (width + 63) & ~63;
+    const uint32_t chromaStep = (layout == LAYOUT_PLANAR) ? 1 : 2;
+    const uint32_t chromaStride = (layout == LAYOUT_PLANAR) ? stride / 2 : stride;
+    const size_t chromaSize = chromaStride * (height / 2);
+    std::vector<uint8_t> source(stride * height + 2 * chromaSize);
+    for (size_t i = 0; i < source.size(); i++) {
+        source[i] = (uint8_t) i;
+    }
+    CpuConsumer::LockedBuffer buffer;
+    buffer.data = source.data();
+    buffer.width = width;
+    buffer.height = height;
+    buffer.stride = stride;
+    buffer.chromaStride = chromaStride;
+    buffer.chromaStep = chromaStep;
+    uint8_t *chroma = source.data() + stride * height;
+    buffer.dataCr = (layout == LAYOUT_NV12) ? chroma + 1 : chroma;
+    buffer.dataCb = (layout == LAYOUT_NV21) ? chroma + 1 :
+            (layout == LAYOUT_NV12) ? chroma : chroma + chromaSize;
+
+    // Callback strides, as CallbackProcessor computes them
+    uint32_t yStride = width;
+    uint32_t cStride = width / 2;
+    if (format == HAL_PIXEL_FORMAT_YV12) {
+        yStride = (width + 15) & ~15;
+        cStride = ((yStride / 2) + 15) & ~15;
+    }
+    std::vector<uint8_t> dst(yStride * height + 2 * cStride * (height / 2));
+
+    while (state.KeepRunning()) {
+        convertFn(format, dst.data(), buffer, yStride, cStride);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t) (width * height * 3 / 2));
+}
+
+static void BM_ToNV21(benchmark::State& state) {
+    convert(state, convertFlexibleYuv, HAL_PIXEL_FORMAT_YCrCb_420_SP);
+}
+
+static void BM_ToNV21Generic(benchmark::State& state) {
+    convert(state, convertFlexibleYuvGeneric, HAL_PIXEL_FORMAT_YCrCb_420_SP);
+}
+
+static void BM_ToYV12(benchmark::State& state) {
+    convert(state, convertFlexibleYuv, HAL_PIXEL_FORMAT_YV12);
+}
+
+static void BM_ToYV12Generic(benchmark::State& state) {
+    convert(state, convertFlexibleYuvGeneric, HAL_PIXEL_FORMAT_YV12);
+}
+
+// Args: index into kSizes, source ChromaLayout
+static void sizesAndLayouts(benchmark::internal::Benchmark* b) {
+    for (int size = 0; size < 3; size++) {
+        for (int layout = LAYOUT_NV21; layout <= LAYOUT_PLANAR; layout++) {
+            b->Args({size, layout});
+        }
+    }
+}
+
+BENCHMARK(BM_ToNV21)->Apply(sizesAndLayouts);
+BENCHMARK(BM_ToNV21Generic)->Apply(sizesAndLayouts);
+BENCHMARK(BM_ToYV12)->Apply(sizesAndLayouts);
+BENCHMARK(BM_ToYV12Generic)->Apply(sizesAndLayouts);
+
+BENCHMARK_MAIN();
@@ -249,6 +249,10 @@ class CameraDeviceBase : public virtual RefBase {
      * Get next capture result frame from the result queue. Returns NOT_ENOUGH_DATA
      * if the queue is empty; caller takes ownership of the metadata buffer inside
      * the capture result object's metadata field.
+     * Any metadata already in frame->mMetadata is taken back by the device on
+     * every call, including ones that return an error, and may be reused for a
+     * later result; callers must copy or swap out metadata they want to keep
+     * before calling again.
      * May be called concurrently to most methods, except for waitForNextFrame.
      */
     virtual status_t getNextResult(CaptureResult *frame) = 0;
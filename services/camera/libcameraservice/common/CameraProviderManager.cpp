@@ -24,6 +24,7 @@
 #include <inttypes.h>
 #include <hidl/ServiceManagement.h>
 #include <functional>
+#include <thread>
 #include <camera_metadata_hidden.h>
 
 namespace android {
@@ -517,14 +518,42 @@ status_t CameraProviderManager::ProviderInfo::initialize() {
         return mapToStatusT(status);
     }
 
-    sp<StatusListener> listener = mManager->getStatusListener();
-    for (auto& device : devices) {
+    // Querying each device's interface, resource cost and static metadata is a
+    // series of round trips to the provider, so do it for all devices concurrently
+    // and then add them in the order the provider listed them. Passthrough providers
+    // wrap legacy HAL modules that aren't required to be thread-safe, so query those
+    // one device at a time.
+    std::vector<std::unique_ptr<DeviceInfo>> deviceInfos(devices.size());
+    std::vector<status_t> results(devices.size(), OK);
+    size_t threadCount = 1;
+    if (mInterface->isRemote()) {
+        threadCount = devices.size() < kMaxEnumerationThreads ?
+                devices.size() : kMaxEnumerationThreads;
+    }
+    auto enumerate = [&](size_t first) {
+        for (size_t i = first; i < devices.size(); i += threadCount) {
+            results[i] = createDevice(devices[i], &deviceInfos[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < threadCount; t++) {
+        threads.emplace_back(enumerate, t);
+    }
+    enumerate(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < devices.size(); i++) {
         std::string id;
-        status_t res = addDevice(device,
-                hardware::camera::common::V1_0::CameraDeviceStatus::PRESENT, &id);
+        status_t res = results[i];
+        if (res == OK) {
+            res = addCreatedDevice(std::move(deviceInfos[i]),
+                    hardware::camera::common::V1_0::CameraDeviceStatus::PRESENT, &id);
+        }
         if (res != OK) {
             ALOGE("%s: Unable to enumerate camera device '%s': %s (%d)",
-                    __FUNCTION__, device.c_str(), strerror(-res), res);
+                    __FUNCTION__, devices[i].c_str(), strerror(-res), res);
             continue;
         }
     }
@@ -549,6 +578,16 @@ const std::string& CameraProviderManager::ProviderInfo::getType() const {
 
 status_t CameraProviderManager::ProviderInfo::addDevice(const std::string& name,
         CameraDeviceStatus initialStatus, /*out*/ std::string* parsedId) {
+    std::unique_ptr<DeviceInfo> deviceInfo;
+    status_t res = createDevice(name, &deviceInfo);
+    if (res != OK) {
+        return res;
+    }
+    return addCreatedDevice(std::move(deviceInfo), initialStatus, parsedId);
+}
+
+status_t CameraProviderManager::ProviderInfo::createDevice(const std::string& name,
+        /*out*/ std::unique_ptr<DeviceInfo> *deviceInfo) const {
 
     ALOGI("Enumerating new camera device: %s", name.c_str());
 
@@ -564,20 +603,14 @@ status_t CameraProviderManager::ProviderInfo::addDevice(const std::string& name,
                 type.c_str(), mType.c_str());
         return BAD_VALUE;
     }
-    if (mManager->isValidDeviceLocked(id, major)) {
-        ALOGE("%s: Device %s: ID %s is already in use for device major version %d", __FUNCTION__,
-                name.c_str(), id.c_str(), major);
-        return BAD_VALUE;
-    }
 
-    std::unique_ptr<DeviceInfo> deviceInfo;
     switch (major) {
         case 1:
-            deviceInfo = initializeDeviceInfo<DeviceInfo1>(name, mProviderTagid,
+            *deviceInfo = initializeDeviceInfo<DeviceInfo1>(name, mProviderTagid,
                     id, minor);
             break;
         case 3:
-            deviceInfo = initializeDeviceInfo<DeviceInfo3>(name, mProviderTagid,
+            *deviceInfo = initializeDeviceInfo<DeviceInfo3>(name, mProviderTagid,
                     id, minor);
             break;
         default:
@@ -585,14 +618,25 @@ status_t CameraProviderManager::ProviderInfo::addDevice(const std::string& name,
                     name.c_str(), major);
             return BAD_VALUE;
     }
-    if (deviceInfo == nullptr) return BAD_VALUE;
-    deviceInfo->mStatus = initialStatus;
+    if (*deviceInfo == nullptr) return BAD_VALUE;
+    return OK;
+}
 
-    mDevices.push_back(std::move(deviceInfo));
+status_t CameraProviderManager::ProviderInfo::addCreatedDevice(
+        std::unique_ptr<DeviceInfo> deviceInfo, CameraDeviceStatus initialStatus,
+        /*out*/ std::string* parsedId) {
+    uint16_t major = deviceInfo->mVersion.get_major();
+    if (mManager->isValidDeviceLocked(deviceInfo->mId, major)) {
+        ALOGE("%s: Device %s: ID %s is already in use for device major version %d", __FUNCTION__,
+                deviceInfo->mName.c_str(), deviceInfo->mId.c_str(), major);
+        return BAD_VALUE;
+    }
+    deviceInfo->mStatus = initialStatus;
 
     if (parsedId != nullptr) {
-        *parsedId = id;
+        *parsedId = deviceInfo->mId;
     }
+    mDevices.push_back(std::move(deviceInfo));
     return OK;
 }
 
@@ -363,6 +363,20 @@ private:
 
         CameraProviderManager *mManager;
 
+        // Upper bound on threads used to query devices while enumerating a provider
+        static const size_t kMaxEnumerationThreads = 8;
+
+        // Parse the device name and query the provider for the device's static info.
+        // Doesn't touch the provider's device list, so it may run concurrently for
+        // different devices.
+        status_t createDevice(const std::string& name,
+                /*out*/ std::unique_ptr<DeviceInfo> *deviceInfo) const;
+
+        // Add a device created by createDevice to the device list
+        status_t addCreatedDevice(std::unique_ptr<DeviceInfo> deviceInfo,
+                hardware::camera::common::V1_0::CameraDeviceStatus initialStatus,
+                /*out*/ std::string *parsedId);
+
         // Templated method to instantiate the right kind of DeviceInfo and call the
         // right CameraProvider getCameraDeviceInterface_* method.
         template<class DeviceInfoT>
@@ -144,7 +144,9 @@ void FrameProcessorBase::processNewFrames(const sp<CameraDeviceBase> &device) {
 
         if (!result.mMetadata.isEmpty()) {
             Mutex::Autolock al(mLastFrameMutex);
-            mLastFrame.acquire(result.mMetadata);
+            // Hand the previous frame back to the device with the next
+            // getNextResult call, so it can reuse the buffer.
+            mLastFrame.swap(result.mMetadata);
         }
     }
     if (res != NOT_ENOUGH_DATA) {
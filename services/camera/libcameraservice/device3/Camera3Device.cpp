@@ -623,21 +623,30 @@ status_t Camera3Device::dump(int fd, const Vector<String16> &args) {
     if (mInFlightMap.size() == 0) {
         lines.append("      None\n");
     } else {
-        for (size_t i = 0; i < mInFlightMap.size(); i++) {
-            InFlightRequest r = mInFlightMap.valueAt(i);
+        mInFlightMap.forEachIndex([&](size_t i) {
+            const InFlightRequest &r = mInFlightMap.valueAt(i);
             lines.appendFormat("      Frame %d |  Timestamp: %" PRId64 ", metadata"
                     " arrived: %s, buffers left: %d\n", mInFlightMap.keyAt(i),
                     r.shutterTimestamp, r.haveResultMetadata ? "true" : "false",
                     r.numBuffersLeft);
-        }
+        });
     }
     write(fd, lines.string(), lines.size());
 
+    dumpInFlightStats(fd);
+    dumpLatencyTracing(fd);
+
+    lines = String8("    Result metadata pool:\n");
+    write(fd, lines.string(), lines.size());
+    mResultMetadataPool.dump(fd, "      ");
+
     if (mRequestThread != NULL) {
         mRequestThread->dumpCaptureRequestLatency(fd,
                 "    ProcessCaptureRequest latency histogram:");
     }
 
+    mInterface->dumpRequestSettingsStats(fd);
+
     {
         lines = String8("    Last request sent:\n");
         write(fd, lines.string(), lines.size());
@@ -1462,6 +1471,7 @@ status_t Camera3Device::deleteStream(int id) {
     }
     mDeletedStreams.add(deletedStream);
     mNeedConfig = true;
+    removeStreamBufferLatency(id);
 
     return res;
 }
@@ -1711,15 +1721,18 @@ status_t Camera3Device::getNextResult(CaptureResult *frame) {
     ATRACE_CALL();
     Mutex::Autolock l(mOutputLock);
 
-    if (mResultQueue.empty()) {
-        return NOT_ENOUGH_DATA;
-    }
-
     if (frame == NULL) {
         ALOGE("%s: argument cannot be NULL", __FUNCTION__);
         return BAD_VALUE;
     }
 
+    // The caller is done with the previous result, if any.
+    mResultMetadataPool.recycle(&frame->mMetadata);
+
+    if (mResultQueue.empty()) {
+        return NOT_ENOUGH_DATA;
+    }
+
     CaptureResult &result = *(mResultQueue.begin());
     frame->mResultExtras = result.mResultExtras;
     frame->mMetadata.acquire(result.mMetadata);
@@ -2248,6 +2261,9 @@ status_t Camera3Device::configureStreamsLocked(int operatingMode) {
     ALOGV("%s: Camera %s: Stream configuration complete", __FUNCTION__, mId.string());
 
     // tear down the deleted streams after configure streams.
+    for (size_t i = 0; i < mDeletedStreams.size(); i++) {
+        removeStreamBufferLatency(mDeletedStreams[i]->getId());
+    }
     mDeletedStreams.clear();
 
     return OK;
@@ -2371,15 +2387,124 @@ void Camera3Device::setErrorStateLockedV(const char *fmt, va_list args) {
  * In-flight request management
  */
 
+Camera3Device::InFlightAutolock::InFlightAutolock(Camera3Device *parent) :
+        mParent(parent) {
+    if (mParent->mInFlightLock.tryLock() != NO_ERROR) {
+        nsecs_t waitStart = systemTime();
+        mParent->mInFlightLock.lock();
+        nsecs_t waitEnd = systemTime();
+        mParent->mInFlightLockContendedCount++;
+        mParent->mInFlightLockWaitTotal += waitEnd - waitStart;
+        mParent->mInFlightLockWaitLatency.add(waitEnd - waitStart);
+    }
+    mParent->mInFlightLockCount++;
+}
+
+Camera3Device::InFlightAutolock::~InFlightAutolock() {
+    mParent->mInFlightLock.unlock();
+}
+
+void Camera3Device::dumpInFlightStats(int fd) {
+    // Read without mInFlightLock like the rest of dump, so values may be slightly stale.
+    String8 lines;
+    lines.appendFormat("    In-flight map: capacity %zu, lookups %" PRIu64 " (%" PRIu64
+            " misses), grown %u times, %u requests spilled to overflow\n",
+            mInFlightMap.capacity(), mInFlightMap.lookupCount(),
+            mInFlightMap.lookupMissCount(), mInFlightMap.growCount(),
+            mInFlightMap.spillCount());
+    lines.appendFormat("    In-flight lock: %" PRIu64 " acquisitions, %" PRIu64
+            " contended, average contended wait %" PRId64 " us\n", mInFlightLockCount,
+            mInFlightLockContendedCount, mInFlightLockContendedCount > 0 ?
+            mInFlightLockWaitTotal / static_cast<nsecs_t>(mInFlightLockContendedCount) / 1000 :
+            0);
+    write(fd, lines.string(), lines.size());
+    mInFlightLockWaitLatency.dump(fd, "    In-flight lock wait histogram:");
+}
+
+void Camera3Device::addStageLatencyLocked(const InFlightRequest &request,
+        LatencyStage stage) {
+    size_t intent = request.captureIntent < kLatencyIntentCount ? request.captureIntent : 0;
+    mStageLatency[intent][stage].add(systemTime() - request.submitTime);
+}
+
+void Camera3Device::addStreamBufferLatencyLocked(const InFlightRequest &request,
+        const camera3_stream_buffer_t *buffers, size_t numBuffers) {
+    nsecs_t latency = systemTime() - request.submitTime;
+    for (size_t i = 0; i < numBuffers; i++) {
+        int streamId = Camera3Stream::cast(buffers[i].stream)->getId();
+        std::unique_ptr<CameraLogLatencyHistogram> &histogram = mStreamBufferLatency[streamId];
+        if (histogram == nullptr) {
+            histogram.reset(new CameraLogLatencyHistogram());
+        }
+        histogram->add(latency);
+    }
+}
+
+void Camera3Device::removeStreamBufferLatency(int streamId) {
+    // Stream IDs are never reused, so a deleted stream's histogram would only grow the map
+    InFlightAutolock l(this);
+    mStreamBufferLatency.erase(streamId);
+}
+
+void Camera3Device::dumpLatencyTracing(int fd) {
+    static const char *kIntentNames[kLatencyIntentCount] = {
+        "custom", "preview", "still_capture", "video_record", "video_snapshot",
+        "zero_shutter_lag", "manual"
+    };
+    static const char *kStageNames[LATENCY_STAGE_COUNT] = {
+        "shutter", "partial_result", "final_result", "buffers_returned"
+    };
+
+    String8 lines("    Latency from HAL submission:\n");
+    write(fd, lines.string(), lines.size());
+    for (size_t intent = 0; intent < kLatencyIntentCount; intent++) {
+        for (size_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+            String8 name = String8::format("      %s %s", kIntentNames[intent],
+                    kStageNames[stage]);
+            mStageLatency[intent][stage].dump(fd, name.string());
+        }
+    }
+    // dump() may hold mLock, which registerInFlight() takes with mInFlightLock held, so
+    // only try the lock here.
+    bool gotInFlightLock = mInFlightLock.tryLock() == NO_ERROR;
+    if (gotInFlightLock) {
+        for (const auto &entry : mStreamBufferLatency) {
+            String8 name = String8::format("      stream %d buffers_returned", entry.first);
+            entry.second->dump(fd, name.string());
+        }
+    } else {
+        lines = String8("      Per-stream latency skipped, in-flight lock busy\n");
+        write(fd, lines.string(), lines.size());
+    }
+
+    // Raw bins in CSV form for scripts; bin i counts latencies in [2^i, 2^(i+1)) us
+    lines = String8("    Latency histograms (name,count,sum_us,bins...):\n");
+    write(fd, lines.string(), lines.size());
+    for (size_t intent = 0; intent < kLatencyIntentCount; intent++) {
+        for (size_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+            String8 name = String8::format("      %s.%s", kIntentNames[intent],
+                    kStageNames[stage]);
+            mStageLatency[intent][stage].dumpCsv(fd, name.string());
+        }
+    }
+    if (gotInFlightLock) {
+        for (const auto &entry : mStreamBufferLatency) {
+            String8 name = String8::format("      stream%d.buffers_returned", entry.first);
+            entry.second->dumpCsv(fd, name.string());
+        }
+        mInFlightLock.unlock();
+    }
+}
+
 status_t Camera3Device::registerInFlight(uint32_t frameNumber,
         int32_t numBuffers, CaptureResultExtras resultExtras, bool hasInput,
-        bool hasAppCallback, nsecs_t maxExpectedDuration) {
+        bool hasAppCallback, nsecs_t maxExpectedDuration, uint8_t captureIntent) {
     ATRACE_CALL();
-    Mutex::Autolock l(mInFlightLock);
+    InFlightAutolock l(this);
 
     ssize_t res;
     res = mInFlightMap.add(frameNumber, InFlightRequest(numBuffers, resultExtras, hasInput,
-            hasAppCallback, maxExpectedDuration));
+            hasAppCallback, maxExpectedDuration, captureIntent));
     if (res < 0) return res;
 
     if (mInFlightMap.size() == 1) {
@@ -2412,7 +2537,7 @@ void Camera3Device::returnOutputBuffers(
 
 void Camera3Device::removeInFlightMapEntryLocked(int idx) {
     nsecs_t duration = mInFlightMap.valueAt(idx).maxExpectedDuration;
-    mInFlightMap.removeItemsAt(idx, 1);
+    mInFlightMap.removeAt(idx);
 
     // Indicate idle inFlightMap to the status tracker
     if (mInFlightMap.size() == 0) {
@@ -2496,12 +2621,12 @@ void Camera3Device::removeInFlightRequestIfReadyLocked(int idx) {
 
 void Camera3Device::flushInflightRequests() {
     { // First return buffers cached in mInFlightMap
-        Mutex::Autolock l(mInFlightLock);
-        for (size_t idx = 0; idx < mInFlightMap.size(); idx++) {
+        InFlightAutolock l(this);
+        mInFlightMap.forEachIndex([this](size_t idx) {
             const InFlightRequest &request = mInFlightMap.valueAt(idx);
             returnOutputBuffers(request.pendingOutputBuffers.array(),
                 request.pendingOutputBuffers.size(), 0);
-        }
+        });
         mInFlightMap.clear();
         mExpectedInflightDuration = 0;
     }
@@ -2606,9 +2731,11 @@ void Camera3Device::insertResultLocked(CaptureResult *result,
         return;
     }
 
-    // Valid result, insert into queue
+    // Valid result, move into queue
     List<CaptureResult>::iterator queuedResult =
-            mResultQueue.insert(mResultQueue.end(), CaptureResult(*result));
+            mResultQueue.insert(mResultQueue.end(), CaptureResult());
+    queuedResult->mResultExtras = result->mResultExtras;
+    queuedResult->mMetadata.acquire(result->mMetadata);
     ALOGVV("%s: result requestId = %" PRId32 ", frameNumber = %" PRId64
            ", burstId = %" PRId32, __FUNCTION__,
            queuedResult->mResultExtras.requestId,
@@ -2625,18 +2752,24 @@ void Camera3Device::sendPartialCaptureResult(const camera_metadata_t * partialRe
 
     CaptureResult captureResult;
     captureResult.mResultExtras = resultExtras;
-    captureResult.mMetadata = partialResult;
+    if (mResultMetadataPool.obtain(
+            get_camera_metadata_entry_count(partialResult) + kResultExtraEntries,
+            get_camera_metadata_data_count(partialResult), &captureResult.mMetadata) != OK) {
+        SET_ERR("Unable to allocate partial result for frame %d", frameNumber);
+        return;
+    }
+    captureResult.mMetadata.append(partialResult);
 
     insertResultLocked(&captureResult, frameNumber);
 }
 
 
-void Camera3Device::sendCaptureResult(CameraMetadata &pendingMetadata,
+void Camera3Device::sendCaptureResult(const camera_metadata_t *pendingMetadata,
         CaptureResultExtras &resultExtras,
         CameraMetadata &collectedPartialResult,
         uint32_t frameNumber,
         bool reprocess) {
-    if (pendingMetadata.isEmpty())
+    if (pendingMetadata == nullptr || get_camera_metadata_entry_count(pendingMetadata) == 0)
         return;
 
     Mutex::Autolock l(mOutputLock);
@@ -2662,12 +2795,34 @@ void Camera3Device::sendCaptureResult(CameraMetadata &pendingMetadata,
 
     CaptureResult captureResult;
     captureResult.mResultExtras = resultExtras;
-    captureResult.mMetadata = pendingMetadata;
 
-    // Append any previous partials to form a complete result
+    size_t entryCount = get_camera_metadata_entry_count(pendingMetadata) + kResultExtraEntries;
+    size_t dataCount = get_camera_metadata_data_count(pendingMetadata);
+    bool fitsInPartials = false;
     if (mUsePartialResult && !collectedPartialResult.isEmpty()) {
-        captureResult.mMetadata.append(collectedPartialResult);
+        const camera_metadata_t *partials = collectedPartialResult.getAndLock();
+        entryCount += get_camera_metadata_entry_count(partials);
+        dataCount += get_camera_metadata_data_count(partials);
+        fitsInPartials = entryCount <= get_camera_metadata_entry_capacity(partials) &&
+                dataCount <= get_camera_metadata_data_capacity(partials);
+        collectedPartialResult.unlock(partials);
+    }
+
+    // Complete the result in place in the buffer collecting the partials when it has
+    // room, which it normally does since both come from mResultMetadataPool.
+    if (fitsInPartials) {
+        captureResult.mMetadata.acquire(collectedPartialResult);
+        mResultMetadataPool.reserve(entryCount, dataCount);
+    } else {
+        if (mResultMetadataPool.obtain(entryCount, dataCount, &captureResult.mMetadata) != OK) {
+            SET_ERR("Unable to allocate result for frame %d", frameNumber);
+            return;
+        }
+        if (mUsePartialResult && !collectedPartialResult.isEmpty()) {
+            captureResult.mMetadata.append(collectedPartialResult);
+        }
     }
+    captureResult.mMetadata.append(pendingMetadata);
 
     captureResult.mMetadata.sort();
 
@@ -2725,7 +2880,7 @@ void Camera3Device::processCaptureResult(const camera3_capture_result *result) {
     nsecs_t shutterTimestamp = 0;
 
     {
-        Mutex::Autolock l(mInFlightLock);
+        InFlightAutolock l(this);
         ssize_t idx = mInFlightMap.indexOfKey(frameNumber);
         if (idx == NAME_NOT_FOUND) {
             SET_ERR("Unknown frame number for capture result: %d",
@@ -2754,7 +2909,20 @@ void Camera3Device::processCaptureResult(const camera3_capture_result *result) {
                 return;
             }
             isPartialResult = (result->partial_result < mNumPartialResults);
+            if (isPartialResult && !request.havePartialResult) {
+                request.havePartialResult = true;
+                addStageLatencyLocked(request, LATENCY_STAGE_PARTIAL_RESULT);
+            }
             if (isPartialResult) {
+                // Collect partials in a pooled buffer large enough for the whole result.
+                if (request.collectedPartialResult.isEmpty() &&
+                        mResultMetadataPool.obtain(
+                                get_camera_metadata_entry_count(result->result),
+                                get_camera_metadata_data_count(result->result),
+                                &request.collectedPartialResult) != OK) {
+                    SET_ERR("Unable to allocate partial results for frame %d", frameNumber);
+                    return;
+                }
                 request.collectedPartialResult.append(result->result);
             }
 
@@ -2781,6 +2949,7 @@ void Camera3Device::processCaptureResult(const camera3_capture_result *result) {
                     request.collectedPartialResult);
             }
             request.haveResultMetadata = true;
+            addStageLatencyLocked(request, LATENCY_STAGE_FINAL_RESULT);
         }
 
         uint32_t numBuffersReturned = result->num_output_buffers;
@@ -2799,6 +2968,11 @@ void Camera3Device::processCaptureResult(const camera3_capture_result *result) {
                     frameNumber);
             return;
         }
+        addStreamBufferLatencyLocked(request, result->output_buffers,
+                result->num_output_buffers);
+        if (numBuffersReturned > 0 && request.numBuffersLeft == 0) {
+            addStageLatencyLocked(request, LATENCY_STAGE_BUFFERS_RETURNED);
+        }
 
         camera_metadata_ro_entry_t entry;
         res = find_camera_metadata_ro_entry(result->result,
@@ -2821,11 +2995,9 @@ void Camera3Device::processCaptureResult(const camera3_capture_result *result) {
         if (result->result != NULL && !isPartialResult) {
             if (shutterTimestamp == 0) {
                 request.pendingMetadata = result->result;
-                request.collectedPartialResult = collectedPartialResult;
+                request.collectedPartialResult.acquire(collectedPartialResult);
             } else if (request.hasCallback) {
-                CameraMetadata metadata;
-                metadata = result->result;
-                sendCaptureResult(metadata, request.resultExtras,
+                sendCaptureResult(result->result, request.resultExtras,
                     collectedPartialResult, frameNumber,
                     hasInputBufferInRequest);
             }
@@ -2926,7 +3098,7 @@ void Camera3Device::notifyError(const camera3_error_msg_t &msg,
         case hardware::camera2::ICameraDeviceCallbacks::ERROR_CAMERA_RESULT:
         case hardware::camera2::ICameraDeviceCallbacks::ERROR_CAMERA_BUFFER:
             {
-                Mutex::Autolock l(mInFlightLock);
+                InFlightAutolock l(this);
                 ssize_t idx = mInFlightMap.indexOfKey(msg.frame_number);
                 if (idx >= 0) {
                     InFlightRequest &r = mInFlightMap.editValueAt(idx);
@@ -2967,7 +3139,7 @@ void Camera3Device::notifyShutter(const camera3_shutter_msg_t &msg,
     // Set timestamp for the request in the in-flight tracking
     // and get the request ID to send upstream
     {
-        Mutex::Autolock l(mInFlightLock);
+        InFlightAutolock l(this);
         idx = mInFlightMap.indexOfKey(msg.frame_number);
         if (idx >= 0) {
             InFlightRequest &r = mInFlightMap.editValueAt(idx);
@@ -2996,6 +3168,7 @@ void Camera3Device::notifyShutter(const camera3_shutter_msg_t &msg,
             }
 
             r.shutterTimestamp = msg.timestamp;
+            addStageLatencyLocked(r, LATENCY_STAGE_SHUTTER);
             if (r.hasCallback) {
                 ALOGVV("Camera %s: %s: Shutter fired for frame %d (id %d) at %" PRId64,
                     mId.string(), __FUNCTION__,
@@ -3005,9 +3178,11 @@ void Camera3Device::notifyShutter(const camera3_shutter_msg_t &msg,
                     listener->notifyShutter(r.resultExtras, msg.timestamp);
                 }
                 // send pending result and buffers
-                sendCaptureResult(r.pendingMetadata, r.resultExtras,
+                const camera_metadata_t *pendingMetadata = r.pendingMetadata.getAndLock();
+                sendCaptureResult(pendingMetadata, r.resultExtras,
                     r.collectedPartialResult, msg.frame_number,
                     r.hasInputBuffer);
+                r.pendingMetadata.unlock(pendingMetadata);
             }
             returnOutputBuffers(r.pendingOutputBuffers.array(),
                 r.pendingOutputBuffers.size(), r.shutterTimestamp);
@@ -3393,6 +3568,7 @@ status_t Camera3Device::HalInterface::processBatchCaptureRequests(
         camera3_capture_request_t* request = requests[i];
         device::V3_2::CaptureRequest* captureRequest = &captureRequests[i];
 
+        countRequestSettings(request->settings);
         if (request->settings != nullptr) {
             size_t settingsSize = get_camera_metadata_size(request->settings);
             if (mRequestMetadataQueue != nullptr && mRequestMetadataQueue->write(
@@ -3402,6 +3578,7 @@ status_t Camera3Device::HalInterface::processBatchCaptureRequests(
             } else {
                 if (mRequestMetadataQueue != nullptr) {
                     ALOGW("%s: couldn't utilize fmq, fallback to hwbinder", __FUNCTION__);
+                    mFmqFallbackCount++;
                 }
                 captureRequest->settings.setToExternal(
                         reinterpret_cast<uint8_t*>(const_cast<camera_metadata_t*>(request->settings)),
@@ -3442,6 +3619,7 @@ status_t Camera3Device::HalInterface::processCaptureRequest(
     status_t res = OK;
 
     if (mHal3Device != nullptr) {
+        countRequestSettings(request->settings);
         res = mHal3Device->ops->process_capture_request(mHal3Device, request);
     } else {
         uint32_t numRequestProcessed = 0;
@@ -3452,6 +3630,29 @@ status_t Camera3Device::HalInterface::processCaptureRequest(
     return res;
 }
 
+void Camera3Device::HalInterface::countRequestSettings(const camera_metadata_t *settings) {
+    mRequestCount++;
+    if (settings != nullptr) {
+        mSettingsCount++;
+        mSettingsBytes += get_camera_metadata_size(settings);
+    }
+}
+
+void Camera3Device::HalInterface::dumpRequestSettingsStats(int fd) {
+    uint64_t requests = mRequestCount;
+    uint64_t settings = mSettingsCount;
+    uint64_t bytes = mSettingsBytes;
+    String8 lines("    Request settings sent to HAL:\n");
+    lines.appendFormat("      Requests: %" PRIu64 ", with new settings: %" PRIu64
+            ", reusing last settings: %" PRIu64 "\n", requests, settings, requests - settings);
+    lines.appendFormat("      Settings bytes: %" PRIu64 " total, %" PRIu64 " per request, %"
+            PRIu64 " per new settings\n", bytes,
+            requests > 0 ? bytes / requests : 0, settings > 0 ? bytes / settings : 0);
+    lines.appendFormat("      FMQ fallbacks to hwbinder: %" PRIu64 "\n",
+            mFmqFallbackCount.load());
+    write(fd, lines.string(), lines.size());
+}
+
 status_t Camera3Device::HalInterface::flush() {
     ATRACE_NAME("CameraHal::flush");
     if (!valid()) return INVALID_OPERATION;
@@ -3987,6 +4188,33 @@ bool Camera3Device::RequestThread::sendRequestsOneByOne() {
     return true;
 }
 
+bool Camera3Device::RequestThread::hasPrevSettings(const sp<CaptureRequest> &request) {
+    if (mPrevRequest == nullptr || mPrevSettings.empty()) {
+        return false;
+    }
+    CameraMetadata &settings = request->mSettings;
+    // Triggers must not be repeated, so always send settings that have one set.
+    camera_metadata_entry_t e = settings.find(ANDROID_CONTROL_AF_TRIGGER);
+    if (e.count > 0 && e.data.u8[0] != ANDROID_CONTROL_AF_TRIGGER_IDLE) {
+        return false;
+    }
+    e = settings.find(ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER);
+    if (e.count > 0 && e.data.u8[0] != ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER_IDLE) {
+        return false;
+    }
+
+    // The last settings sent were sorted, so sort the same way before comparing.
+    settings.sort();
+    const camera_metadata_t *buffer = settings.getAndLock();
+    if (buffer == nullptr) {
+        return false;
+    }
+    size_t size = get_camera_metadata_size(buffer);
+    bool same = size == mPrevSettings.size() && memcmp(buffer, mPrevSettings.data(), size) == 0;
+    settings.unlock(buffer);
+    return same;
+}
+
 nsecs_t Camera3Device::RequestThread::calculateMaxExpectedDuration(const camera_metadata_t *request) {
     nsecs_t maxExpectedDuration = kDefaultExpectedDuration;
     camera_metadata_ro_entry_t e = camera_metadata_ro_entry_t();
@@ -4134,6 +4362,13 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
         bool triggersMixedIn = (triggerCount > 0 || mPrevTriggers > 0);
         mPrevTriggers = triggerCount;
 
+        // A different request with exactly the same settings as the last ones sent can
+        // also reuse them, e.g. a repeating request that a client has rebuilt.
+        if (mPrevRequest != captureRequest && !triggersMixedIn &&
+                hasPrevSettings(captureRequest)) {
+            mPrevRequest = captureRequest;
+        }
+
         // If the request is the same as last, or we had triggers last time
         if (mPrevRequest != captureRequest || triggersMixedIn) {
             /**
@@ -4155,6 +4390,9 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
             captureRequest->mSettings.sort();
             halRequest->settings = captureRequest->mSettings.getAndLock();
             mPrevRequest = captureRequest;
+            const uint8_t *settings = reinterpret_cast<const uint8_t*>(halRequest->settings);
+            mPrevSettings.assign(settings,
+                    settings + get_camera_metadata_size(halRequest->settings));
             ALOGVV("%s: Request settings are NEW", __FUNCTION__);
 
             IF_ALOGV() {
@@ -4240,11 +4478,18 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
         if (mNextRequests[0].captureRequest->mBatchSize > 1 && i != mNextRequests.size()-1) {
             hasCallback = false;
         }
+        // Settings are locked at this point, so look up the intent through the const
+        // interface.
+        const CameraMetadata &settings = captureRequest->mSettings;
+        camera_metadata_ro_entry_t intentEntry = settings.find(ANDROID_CONTROL_CAPTURE_INTENT);
+        uint8_t captureIntent = intentEntry.count > 0 ? intentEntry.data.u8[0] :
+                static_cast<uint8_t>(ANDROID_CONTROL_CAPTURE_INTENT_CUSTOM);
         res = parent->registerInFlight(halRequest->frame_number,
                 totalNumBuffers, captureRequest->mResultExtras,
                 /*hasInput*/halRequest->input_buffer != NULL,
                 hasCallback,
-                calculateMaxExpectedDuration(halRequest->settings));
+                calculateMaxExpectedDuration(halRequest->settings),
+                captureIntent);
         ALOGVV("%s: registered in flight requestId = %" PRId32 ", frameNumber = %" PRId64
                ", burstId = %" PRId32 ".",
                 __FUNCTION__,
@@ -4299,7 +4544,7 @@ bool Camera3Device::RequestThread::isStreamPending(
 }
 
 nsecs_t Camera3Device::getExpectedInFlightDuration() {
-    Mutex::Autolock al(mInFlightLock);
+    InFlightAutolock al(this);
     return mExpectedInflightDuration > kMinInflightDuration ?
             mExpectedInflightDuration : kMinInflightDuration;
 }
@@ -4354,7 +4599,7 @@ void Camera3Device::RequestThread::cleanUpFailedRequests(bool sendRequestError)
         {
           sp<Camera3Device> parent = mParent.promote();
           if (parent != NULL) {
-              Mutex::Autolock l(parent->mInFlightLock);
+              InFlightAutolock l(parent.get());
               ssize_t idx = parent->mInFlightMap.indexOfKey(captureRequest->mResultExtras.frameNumber);
               if (idx >= 0) {
                   ALOGV("%s: Remove inflight request from queue: frameNumber %" PRId64,
@@ -4485,6 +4730,7 @@ sp<Camera3Device::CaptureRequest>
     // request if so. Can't use 'NULL request == repeat' across configure calls.
     if (mReconfigured) {
         mPrevRequest.clear();
+        mPrevSettings.clear();
         mReconfigured = false;
     }
 
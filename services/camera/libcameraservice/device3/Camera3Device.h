@@ -17,8 +17,12 @@
 #ifndef ANDROID_SERVERS_CAMERA3DEVICE_H
 #define ANDROID_SERVERS_CAMERA3DEVICE_H
 
+#include <atomic>
+#include <map>
+#include <memory>
 #include <utility>
 #include <unordered_map>
+#include <vector>
 
 #include <utils/Condition.h>
 #include <utils/Errors.h>
@@ -39,6 +43,8 @@
 #include "common/CameraDeviceBase.h"
 #include "device3/StatusTracker.h"
 #include "device3/Camera3BufferManager.h"
+#include "device3/InFlightRequestRing.h"
+#include "device3/ResultMetadataPool.h"
 #include "utils/TagMonitor.h"
 #include "utils/LatencyHistogram.h"
 #include <camera_metadata_hidden.h>
@@ -270,11 +276,22 @@ class Camera3Device :
         // buffers
         void getInflightBufferKeys(std::vector<std::pair<int32_t, int32_t>>* out);
 
+        // Dump how much request settings metadata has been sent to the HAL
+        void dumpRequestSettingsStats(int fd);
+
       private:
         camera3_device_t *mHal3Device;
         sp<hardware::camera::device::V3_2::ICameraDeviceSession> mHidlSession;
         std::shared_ptr<RequestMetadataQueue> mRequestMetadataQueue;
 
+        // Request settings transport counters, updated by the request thread only
+        std::atomic<uint64_t> mRequestCount{0};
+        std::atomic<uint64_t> mSettingsCount{0};      // requests not reusing the last settings
+        std::atomic<uint64_t> mSettingsBytes{0};
+        std::atomic<uint64_t> mFmqFallbackCount{0};   // settings sent over hwbinder instead
+
+        void countRequestSettings(const camera_metadata_t *settings);
+
         std::mutex mInflightLock;
 
         // The output HIDL request still depends on input camera3_capture_request_t
@@ -728,6 +745,10 @@ class Camera3Device :
         // a trigger does
         status_t          addDummyTriggerIds(const sp<CaptureRequest> &request);
 
+        // Whether the request's settings are identical to the last settings sent to
+        // the HAL, so it can be sent with NULL settings to reuse them.
+        bool              hasPrevSettings(const sp<CaptureRequest> &request);
+
         static const nsecs_t kRequestTimeout = 50e6; // 50 ms
 
         // Used to prepare a batch of requests.
@@ -813,6 +834,9 @@ class Camera3Device :
 
         sp<CaptureRequest> mPrevRequest;
         int32_t            mPrevTriggers;
+        // Copy of the last settings sent to the HAL, which may belong to a request
+        // other than mPrevRequest's current contents.
+        std::vector<uint8_t> mPrevSettings;
 
         uint32_t           mFrameNumber;
 
@@ -886,7 +910,13 @@ class Camera3Device :
         // For auto-exposure modes, equal to 1/(lower end of target FPS range)
         nsecs_t maxExpectedDuration;
 
-        // Default constructor needed by KeyedVector
+        // For latency tracing: when the request was registered for submission to the HAL,
+        // its capture intent, and whether a partial result has arrived yet.
+        nsecs_t submitTime;
+        uint8_t captureIntent;
+        bool havePartialResult;
+
+        // Default constructor needed by InFlightRequestRing
         InFlightRequest() :
                 shutterTimestamp(0),
                 sensorTimestamp(0),
@@ -895,11 +925,14 @@ class Camera3Device :
                 numBuffersLeft(0),
                 hasInputBuffer(false),
                 hasCallback(true),
-                maxExpectedDuration(kDefaultExpectedDuration) {
+                maxExpectedDuration(kDefaultExpectedDuration),
+                submitTime(0),
+                captureIntent(ANDROID_CONTROL_CAPTURE_INTENT_CUSTOM),
+                havePartialResult(false) {
         }
 
         InFlightRequest(int numBuffers, CaptureResultExtras extras, bool hasInput,
-                bool hasAppCallback, nsecs_t maxDuration) :
+                bool hasAppCallback, nsecs_t maxDuration, uint8_t intent) :
                 shutterTimestamp(0),
                 sensorTimestamp(0),
                 requestStatus(OK),
@@ -908,24 +941,70 @@ class Camera3Device :
                 resultExtras(extras),
                 hasInputBuffer(hasInput),
                 hasCallback(hasAppCallback),
-                maxExpectedDuration(maxDuration) {
+                maxExpectedDuration(maxDuration),
+                submitTime(systemTime()),
+                captureIntent(intent),
+                havePartialResult(false) {
         }
     };
 
     // Map from frame number to the in-flight request state
-    typedef KeyedVector<uint32_t, InFlightRequest> InFlightMap;
+    typedef camera3::InFlightRequestRing<InFlightRequest> InFlightMap;
 
+    // Lock holder for mInFlightLock, which also records how often and for how long
+    // callers had to wait for it.
+    class InFlightAutolock {
+      public:
+        explicit InFlightAutolock(Camera3Device *parent);
+        ~InFlightAutolock();
+      private:
+        Camera3Device *mParent;
+    };
 
-    Mutex                  mInFlightLock; // Protects mInFlightMap and
-                                          // mExpectedInflightDuration
+    Mutex                  mInFlightLock; // Protects mInFlightMap,
+                                          // mExpectedInflightDuration and the
+                                          // in-flight lock statistics
     InFlightMap            mInFlightMap;
     nsecs_t                mExpectedInflightDuration = 0;
     int                    mInFlightStatusId;
 
+    uint64_t               mInFlightLockCount = 0;
+    uint64_t               mInFlightLockContendedCount = 0;
+    nsecs_t                mInFlightLockWaitTotal = 0;
+    // Waits are typically microseconds, so use power-of-two microsecond bins
+    CameraLogLatencyHistogram mInFlightLockWaitLatency;
+
+    void dumpInFlightStats(int fd);
+
+    /**
+     * Per-stage latency tracing, measured from registration of a request for HAL
+     * submission. Histograms are split by capture intent so that preview and still
+     * capture latencies don't mix.
+     */
+    enum LatencyStage {
+        LATENCY_STAGE_SHUTTER = 0,
+        LATENCY_STAGE_PARTIAL_RESULT,
+        LATENCY_STAGE_FINAL_RESULT,
+        LATENCY_STAGE_BUFFERS_RETURNED,
+        LATENCY_STAGE_COUNT
+    };
+    static const size_t kLatencyIntentCount = ANDROID_CONTROL_CAPTURE_INTENT_MANUAL + 1;
+
+    // Lock-free; indexed by capture intent, CUSTOM and unknown intents share slot 0
+    CameraLogLatencyHistogram mStageLatency[kLatencyIntentCount][LATENCY_STAGE_COUNT];
+    // Submission to buffer return, by stream ID. Protected by mInFlightLock.
+    std::map<int, std::unique_ptr<CameraLogLatencyHistogram>> mStreamBufferLatency;
+
+    void addStageLatencyLocked(const InFlightRequest &request, LatencyStage stage);
+    void addStreamBufferLatencyLocked(const InFlightRequest &request,
+            const camera3_stream_buffer_t *buffers, size_t numBuffers);
+    // Drop the per-stream histogram of a deleted stream. Takes mInFlightLock.
+    void removeStreamBufferLatency(int streamId);
+    void dumpLatencyTracing(int fd);
 
     status_t registerInFlight(uint32_t frameNumber,
             int32_t numBuffers, CaptureResultExtras resultExtras, bool hasInput,
-            bool callback, nsecs_t maxExpectedDuration);
+            bool callback, nsecs_t maxExpectedDuration, uint8_t captureIntent);
 
     /**
      * Returns the maximum expected time it'll take for all currently in-flight
@@ -1007,6 +1086,11 @@ class Camera3Device :
 
     /**** End scope for mOutputLock ****/
 
+    // Buffers for capture result metadata, returned through getNextResult. Thread-safe.
+    camera3::ResultMetadataPool mResultMetadataPool;
+    // Room left in results for the entries added by insertResultLocked
+    static const size_t    kResultExtraEntries = 2;
+
     /**
      * Callback functions from HAL device
      */
@@ -1029,20 +1113,21 @@ class Camera3Device :
             const CaptureResultExtras &resultExtras, uint32_t frameNumber);
 
     // Send a total capture result given the pending metadata and result extras,
-    // partial results, and the frame number to the result queue.
-    void sendCaptureResult(CameraMetadata &pendingMetadata,
+    // partial results, and the frame number to the result queue. The collected
+    // partial results are consumed.
+    void sendCaptureResult(const camera_metadata_t *pendingMetadata,
             CaptureResultExtras &resultExtras,
             CameraMetadata &collectedPartialResult, uint32_t frameNumber,
             bool reprocess);
 
     // Insert the result to the result queue after updating frame number and overriding AE
-    // trigger cancel.
+    // trigger cancel. The result metadata is moved into the queue.
     // mOutputLock must be held when calling this function.
     void insertResultLocked(CaptureResult *result, uint32_t frameNumber);
 
     /**** Scope for mInFlightLock ****/
 
-    // Remove the in-flight map entry of the given index from mInFlightMap.
+    // Remove the in-flight map entry of the given slot index from mInFlightMap.
     // It must only be called with mInFlightLock held.
     void removeInFlightMapEntryLocked(int idx);
     // Remove the in-flight request of the given index from mInFlightMap
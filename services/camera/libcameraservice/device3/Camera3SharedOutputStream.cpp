@@ -191,6 +191,20 @@ status_t Camera3SharedOutputStream::disconnectLocked() {
     return res;
 }
 
+void Camera3SharedOutputStream::dump(int fd, const Vector<String16> &args) const {
+    Camera3OutputStream::dump(fd, args);
+
+    // The splitter takes its own lock while dumping, so only hold mLock to read the pointer
+    sp<Camera3StreamSplitter> splitter;
+    {
+        Mutex::Autolock l(mLock);
+        splitter = mStreamSplitter;
+    }
+    if (splitter != nullptr) {
+        splitter->dump(fd);
+    }
+}
+
 status_t Camera3SharedOutputStream::getEndpointUsage(uint32_t *usage) const {
 
     status_t res = OK;
@@ -46,6 +46,8 @@ public:
 
     virtual status_t setConsumers(const std::vector<sp<Surface>>& consumers);
 
+    virtual void     dump(int fd, const Vector<String16> &args) const;
+
 private:
     // Surfaces passed in constructor from app
     std::vector<sp<Surface> > mSurfaces;
@@ -120,7 +120,7 @@ void Camera3StreamSplitter::disconnect() {
         output->disconnect(NATIVE_WINDOW_API_CAMERA);
     }
     mOutputs.clear();
-    mOutputSlots.clear();
+    mOutputStates.clear();
 
     mConsumer->consumerDisconnect();
 
@@ -210,9 +210,9 @@ status_t Camera3StreamSplitter::addOutputLocked(const sp<Surface>& outputQueue)
     }
 
     // Add new entry into mOutputs
+    mOutputStates[gbp] = std::make_unique<OutputState>(mOutputs.size(), totalBufferCount);
     mOutputs.push_back(gbp);
     mNotifiers[gbp] = listener;
-    mOutputSlots[gbp] = std::make_unique<OutputSlots>(totalBufferCount);
 
     mMaxConsumerBuffers += maxConsumerBuffers;
     return NO_ERROR;
@@ -231,8 +231,7 @@ status_t Camera3StreamSplitter::outputBufferLocked(const sp<IGraphicBufferProduc
     IGraphicBufferProducer::QueueBufferOutput queueOutput;
 
     uint64_t bufferId = bufferItem.mGraphicBuffer->getId();
-    const BufferTracker& tracker = *(mBuffers[bufferId]);
-    int slot = getSlotForOutputLocked(output, tracker.getBuffer());
+    int slot = getSlotForOutputLocked(output, bufferItem.mGraphicBuffer);
 
     // In case the output BufferQueue has its own lock, if we hold splitter lock while calling
     // queueBuffer (which will try to acquire the output lock), the output could be holding its
@@ -252,10 +251,15 @@ status_t Camera3StreamSplitter::outputBufferLocked(const sp<IGraphicBufferProduc
         // that, increment the release count so that we still release this
         // buffer eventually, and move on to the next output
         onAbandonedLocked();
-        decrementBufRefCountLocked(bufferItem.mGraphicBuffer->getId(), output);
+        decrementBufRefCountLocked(bufferId, output);
         return res;
     }
 
+    auto it = mOutputStates.find(output);
+    if (it != mOutputStates.end()) {
+        it->second->queueTime[bufferId] = systemTime();
+    }
+
     // If the queued buffer replaces a pending buffer in the async
     // queue, no onBufferReleased is called by the buffer queue.
     // Proactively trigger the callback to avoid buffer loss.
@@ -278,16 +282,20 @@ status_t Camera3StreamSplitter::notifyBufferReleased(const sp<GraphicBuffer>& bu
     Mutex::Autolock lock(mMutex);
 
     uint64_t bufferId = buffer->getId();
-    std::unique_ptr<BufferTracker> tracker_ptr = std::move(mBuffers[bufferId]);
-    mBuffers.erase(bufferId);
+    auto trackerIt = mBuffers.find(bufferId);
+    if (trackerIt == mBuffers.end()) {
+        SP_LOGE("%s: Buffer %" PRIu64 " is not tracked", __FUNCTION__, bufferId);
+        return BAD_VALUE;
+    }
+    std::unique_ptr<BufferTracker> tracker_ptr = std::move(trackerIt->second);
+    mBuffers.erase(trackerIt);
 
     for (const auto surface : tracker_ptr->requestedSurfaces()) {
         sp<IGraphicBufferProducer>& gbp = mOutputs[surface];
-        OutputSlots& outputSlots = *(mOutputSlots[gbp]);
         int slot = getSlotForOutputLocked(gbp, buffer);
         if (slot != BufferItem::INVALID_BUFFER_SLOT) {
              gbp->detachBuffer(slot);
-             outputSlots[slot].clear();
+             removeSlotForOutputLocked(gbp, buffer);
         }
     }
 
@@ -304,34 +312,85 @@ status_t Camera3StreamSplitter::attachBufferToOutputs(ANativeWindowBuffer* anb,
     sp<GraphicBuffer> gb(static_cast<GraphicBuffer*>(anb));
     uint64_t bufferId = gb->getId();
 
+    // Validate every output up front, so that an invalid id doesn't leave the buffer
+    // attached to some of the outputs.
+    for (auto& surface_id : surface_ids) {
+        if (surface_id >= mOutputs.size()) {
+            SP_LOGE("%s: Invalid surface id %zu", __FUNCTION__, surface_id);
+            return BAD_VALUE;
+        }
+    }
+
     // Initialize buffer tracker for this input buffer
     auto tracker = std::make_unique<BufferTracker>(gb, surface_ids);
 
+    // Outputs the buffer is attached to so far, to undo the attach if a later output fails
+    std::vector<sp<IGraphicBufferProducer>> attached;
+    auto detachAttached = [&]() {
+        for (const auto& output : attached) {
+            int slot = getSlotForOutputLocked(output, gb);
+            if (slot != BufferItem::INVALID_BUFFER_SLOT) {
+                output->detachBuffer(slot);
+                removeSlotForOutputLocked(output, gb);
+            }
+        }
+    };
+
     for (auto& surface_id : surface_ids) {
-        sp<IGraphicBufferProducer>& gbp = mOutputs[surface_id];
+        if (surface_id >= mOutputs.size()) {
+            // The outputs changed while the lock was dropped for a previous attach
+            SP_LOGE("%s: Invalid surface id %zu", __FUNCTION__, surface_id);
+            detachAttached();
+            return BAD_VALUE;
+        }
+        // Hold a reference, the output may be removed by disconnect() while unlocked.
+        sp<IGraphicBufferProducer> gbp = mOutputs[surface_id];
         int slot = BufferItem::INVALID_BUFFER_SLOT;
         //Temporarly Unlock the mutex when trying to attachBuffer to the output
         //queue, because attachBuffer could block in case of a slow consumer. If
         //we block while holding the lock, onFrameAvailable and onBufferReleased
         //will block as well because they need to acquire the same lock.
+        nsecs_t attachStart = systemTime();
         mMutex.unlock();
         res = gbp->attachBuffer(&slot, gb);
         mMutex.lock();
+        nsecs_t attachEnd = systemTime();
         if (res != OK) {
             SP_LOGE("%s: Cannot acquireBuffer from GraphicBufferProducer %p: %s (%d)",
                     __FUNCTION__, gbp.get(), strerror(-res), res);
+            detachAttached();
             return res;
         }
-        auto& outputSlots = *mOutputSlots[gbp];
-        if (outputSlots[slot] != nullptr) {
+        auto stateIt = mOutputStates.find(gbp);
+        if (stateIt == mOutputStates.end()) {
+            SP_LOGE("%s: Output %p disconnected during attach", __FUNCTION__, gbp.get());
+            // The slot isn't tracked for a disconnected output, detach it directly
+            gbp->detachBuffer(slot);
+            detachAttached();
+            return NO_INIT;
+        }
+        OutputState& output = *stateIt->second;
+        output.attachCount++;
+        output.attachLatency.add(attachStart, attachEnd);
+        if (attachEnd - attachStart > output.maxAttachTime) {
+            output.maxAttachTime = attachEnd - attachStart;
+        }
+        if (attachEnd - attachStart > kAttachStallThreshold) {
+            output.stallCount++;
+            ATRACE_INT(String8::format("%s-stall-%zu", mConsumerName.string(),
+                    output.surfaceId).string(), (attachEnd - attachStart) / 1000);
+        }
+
+        if (output.slots[slot] != nullptr) {
             // If the buffer is attached to a slot which already contains a buffer,
             // the previous buffer will be removed from the output queue. Decrement
             // the reference count accordingly.
-            decrementBufRefCountLocked(outputSlots[slot]->getId(), gbp);
+            decrementBufRefCountLocked(output.slots[slot]->getId(), gbp);
         }
         SP_LOGV("%s: Attached buffer %p to slot %d on output %p.",__FUNCTION__, gb.get(),
                 slot, gbp.get());
-        outputSlots[slot] = gb;
+        setSlotForOutputLocked(output, slot, gb);
+        attached.push_back(gbp);
     }
 
     mBuffers[bufferId] = std::move(tracker);
@@ -368,12 +427,15 @@ void Camera3StreamSplitter::onFrameAvailable(const BufferItem& /*item*/) {
         return;
     }
 
-    // Attach and queue the buffer to each of the outputs
-    BufferTracker& tracker = *(mBuffers[bufferItem.mGraphicBuffer->getId()]);
+    // Attach and queue the buffer to each of the outputs. Copy the surface list, since
+    // the tracker can go away once the lock is dropped for a queue and the buffer is
+    // released by every output.
+    std::vector<size_t> requestedSurfaces =
+            mBuffers[bufferItem.mGraphicBuffer->getId()]->requestedSurfaces();
 
     SP_LOGV("%s: BufferTracker for buffer %" PRId64 ", number of requests %zu",
-           __FUNCTION__, bufferItem.mGraphicBuffer->getId(), tracker.requestedSurfaces().size());
-    for (const auto id : tracker.requestedSurfaces()) {
+           __FUNCTION__, bufferItem.mGraphicBuffer->getId(), requestedSurfaces.size());
+    for (const auto id : requestedSurfaces) {
 
         LOG_ALWAYS_FATAL_IF(id >= mOutputs.size(),
                 "requested surface id exceeding max registered ids");
@@ -394,10 +456,28 @@ void Camera3StreamSplitter::onFrameAvailable(const BufferItem& /*item*/) {
 void Camera3StreamSplitter::decrementBufRefCountLocked(uint64_t id,
         const sp<IGraphicBufferProducer>& from) {
     ATRACE_CALL();
-    size_t referenceCount = mBuffers[id]->decrementReferenceCountLocked();
+    auto trackerIt = mBuffers.find(id);
+    auto stateIt = mOutputStates.find(from);
+    if (trackerIt == mBuffers.end() || stateIt == mOutputStates.end()) {
+        SP_LOGE("%s: Buffer %" PRIu64 " or output %p is not tracked", __FUNCTION__, id,
+                from.get());
+        return;
+    }
+    OutputState& output = *stateIt->second;
+    if (!trackerIt->second->releaseByOutputLocked(output.surfaceId)) {
+        SP_LOGW("%s: Output %zu released buffer %" PRIu64 " it doesn't hold", __FUNCTION__,
+                output.surfaceId, id);
+        return;
+    }
 
-    removeSlotForOutputLocked(from, mBuffers[id]->getBuffer());
-    if (referenceCount > 0) {
+    output.releaseCount++;
+    auto queueIt = output.queueTime.find(id);
+    if (queueIt != output.queueTime.end()) {
+        output.holdLatency.add(queueIt->second, systemTime());
+        output.queueTime.erase(queueIt);
+    }
+    removeSlotForOutputLocked(from, trackerIt->second->getBuffer());
+    if (trackerIt->second->getReferenceCount() > 0) {
         return;
     }
 
@@ -466,7 +546,13 @@ void Camera3StreamSplitter::onBufferReleasedByOutputLocked(
         return;
     }
 
-    BufferTracker& tracker = *(mBuffers[buffer->getId()]);
+    auto trackerIt = mBuffers.find(buffer->getId());
+    if (trackerIt == mBuffers.end()) {
+        SP_LOGE("%s: Detached buffer %" PRIu64 " is not tracked", __FUNCTION__,
+                buffer->getId());
+        return;
+    }
+    BufferTracker& tracker = *trackerIt->second;
     // Merge the release fence of the incoming buffer so that the fence we send
     // back to the input includes all of the outputs' fences
     if (fence != nullptr && fence->isValid()) {
@@ -495,11 +581,11 @@ void Camera3StreamSplitter::onAbandonedLocked() {
 
 int Camera3StreamSplitter::getSlotForOutputLocked(const sp<IGraphicBufferProducer>& gbp,
         const sp<GraphicBuffer>& gb) {
-    auto& outputSlots = *mOutputSlots[gbp];
-
-    for (size_t i = 0; i < outputSlots.size(); i++) {
-        if (outputSlots[i] == gb) {
-            return (int)i;
+    auto stateIt = mOutputStates.find(gbp);
+    if (stateIt != mOutputStates.end()) {
+        auto slotIt = stateIt->second->slotForBuffer.find(gb->getId());
+        if (slotIt != stateIt->second->slotForBuffer.end()) {
+            return slotIt->second;
         }
     }
 
@@ -508,14 +594,25 @@ int Camera3StreamSplitter::getSlotForOutputLocked(const sp<IGraphicBufferProduce
     return BufferItem::INVALID_BUFFER_SLOT;
 }
 
-status_t Camera3StreamSplitter::removeSlotForOutputLocked(const sp<IGraphicBufferProducer>& gbp,
+void Camera3StreamSplitter::setSlotForOutputLocked(OutputState& output, int slot,
         const sp<GraphicBuffer>& gb) {
-    auto& outputSlots = *mOutputSlots[gbp];
+    if (output.slots[slot] != nullptr) {
+        output.slotForBuffer.erase(output.slots[slot]->getId());
+    }
+    output.slots[slot] = gb;
+    output.slotForBuffer[gb->getId()] = slot;
+}
 
-    for (size_t i = 0; i < outputSlots.size(); i++) {
-        if (outputSlots[i] == gb) {
-           outputSlots[i].clear();
-           return NO_ERROR;
+status_t Camera3StreamSplitter::removeSlotForOutputLocked(const sp<IGraphicBufferProducer>& gbp,
+        const sp<GraphicBuffer>& gb) {
+    auto stateIt = mOutputStates.find(gbp);
+    if (stateIt != mOutputStates.end()) {
+        OutputState& output = *stateIt->second;
+        auto slotIt = output.slotForBuffer.find(gb->getId());
+        if (slotIt != output.slotForBuffer.end()) {
+            output.slots[slotIt->second].clear();
+            output.slotForBuffer.erase(slotIt);
+            return NO_ERROR;
         }
     }
 
@@ -524,6 +621,25 @@ status_t Camera3StreamSplitter::removeSlotForOutputLocked(const sp<IGraphicBuffe
     return BAD_VALUE;
 }
 
+void Camera3StreamSplitter::dump(int fd) {
+    Mutex::Autolock lock(mMutex);
+    String8 lines;
+    lines.appendFormat("      Stream splitter %s: %zu buffers in flight\n",
+            mConsumerName.string(), mBuffers.size());
+    write(fd, lines.string(), lines.size());
+    for (const auto& gbp : mOutputs) {
+        const OutputState& output = *mOutputStates[gbp];
+        lines = String8::format("        Output %zu: %" PRIu64 " attached, %" PRIu64
+                " stalls over %" PRId64 " ms (max %" PRId64 " us), %" PRIu64 " released\n",
+                output.surfaceId, output.attachCount, output.stallCount,
+                ns2ms(kAttachStallThreshold), ns2us(output.maxAttachTime),
+                output.releaseCount);
+        write(fd, lines.string(), lines.size());
+        output.attachLatency.dump(fd, "          AttachBuffer latency histogram:");
+        output.holdLatency.dump(fd, "          Consumer hold time histogram:");
+    }
+}
+
 Camera3StreamSplitter::OutputListener::OutputListener(
         wp<Camera3StreamSplitter> splitter,
         wp<IGraphicBufferProducer> output)
@@ -549,16 +665,22 @@ void Camera3StreamSplitter::OutputListener::binderDied(const wp<IBinder>& /* who
 Camera3StreamSplitter::BufferTracker::BufferTracker(
         const sp<GraphicBuffer>& buffer, const std::vector<size_t>& requestedSurfaces)
       : mBuffer(buffer), mMergedFence(Fence::NO_FENCE), mRequestedSurfaces(requestedSurfaces),
+        mHeld(requestedSurfaces.size(), true),
         mReferenceCount(requestedSurfaces.size()) {}
 
 void Camera3StreamSplitter::BufferTracker::mergeFence(const sp<Fence>& with) {
     mMergedFence = Fence::merge(String8("Camera3StreamSplitter"), mMergedFence, with);
 }
 
-size_t Camera3StreamSplitter::BufferTracker::decrementReferenceCountLocked() {
-    if (mReferenceCount > 0)
-        --mReferenceCount;
-    return mReferenceCount;
+bool Camera3StreamSplitter::BufferTracker::releaseByOutputLocked(size_t surfaceId) {
+    for (size_t i = 0; i < mRequestedSurfaces.size(); i++) {
+        if (mRequestedSurfaces[i] == surfaceId && mHeld[i]) {
+            mHeld[i] = false;
+            --mReferenceCount;
+            return true;
+        }
+    }
+    return false;
 }
 
 } // namespace android
@@ -26,6 +26,8 @@
 #include <utils/StrongPointer.h>
 #include <utils/Timers.h>
 
+#include "utils/LatencyHistogram.h"
+
 #define SP_LOGV(x, ...) ALOGV("[%s] " x, mConsumerName.string(), ##__VA_ARGS__)
 #define SP_LOGI(x, ...) ALOGI("[%s] " x, mConsumerName.string(), ##__VA_ARGS__)
 #define SP_LOGW(x, ...) ALOGW("[%s] " x, mConsumerName.string(), ##__VA_ARGS__)
@@ -86,6 +88,10 @@ public:
     // Disconnect the buffer queue from output surfaces.
     void disconnect();
 
+    // Dump per-output buffer flow statistics, including how long each consumer
+    // stalled the producer.
+    void dump(int fd);
+
 private:
     // From IConsumerListener
     //
@@ -129,8 +135,8 @@ private:
     // acquire. This must be called with mMutex locked.
     void onAbandonedLocked();
 
-    // Decrement the buffer's reference count. Once the reference count becomes
-    // 0, return the buffer back to the input BufferQueue.
+    // Drop the reference held on the buffer by the given output. Once no output
+    // holds a reference, return the buffer back to the input BufferQueue.
     void decrementBufRefCountLocked(uint64_t id, const sp<IGraphicBufferProducer>& from);
 
     // This is a thin wrapper class that lets us determine which BufferQueue
@@ -166,11 +172,15 @@ private:
 
         void mergeFence(const sp<Fence>& with);
 
-        // Returns the new value
+        // Drop the reference held by the given output. Returns false if that output
+        // holds no reference, so a repeated or stray release can't return the buffer
+        // to the input while other outputs still use it.
         // Only called while mMutex is held
-        size_t decrementReferenceCountLocked();
+        bool releaseByOutputLocked(size_t surfaceId);
 
-        const std::vector<size_t> requestedSurfaces() const { return mRequestedSurfaces; }
+        size_t getReferenceCount() const { return mReferenceCount; }
+
+        const std::vector<size_t>& requestedSurfaces() const { return mRequestedSurfaces; }
 
     private:
 
@@ -185,9 +195,36 @@ private:
         // available from the input queue, the registered surfaces are used to decide
         // which output is the buffer sent to.
         std::vector<size_t> mRequestedSurfaces;
+        // Whether each requested surface still holds the buffer
+        std::vector<bool> mHeld;
         size_t mReferenceCount;
     };
 
+    typedef std::vector<sp<GraphicBuffer>> OutputSlots;
+
+    // Per-output state. Accessed with mMutex held, but the BufferQueue calls that can
+    // block on a slow consumer are made without it, so one consumer doesn't hold up
+    // buffer flow to the others.
+    struct OutputState {
+        OutputState(size_t id, size_t slotCount) : surfaceId(id), slots(slotCount) {}
+
+        const size_t surfaceId;
+        OutputSlots slots;
+        // Slot of each attached buffer, by GraphicBuffer ID
+        std::unordered_map<uint64_t, int> slotForBuffer;
+        // When each buffer in the output queue was queued, by GraphicBuffer ID
+        std::unordered_map<uint64_t, nsecs_t> queueTime;
+
+        // Time the producer spent in attachBuffer waiting for this consumer to free
+        // a slot, and time the consumer held each queued buffer.
+        uint64_t attachCount = 0;
+        uint64_t stallCount = 0;
+        nsecs_t maxAttachTime = 0;
+        uint64_t releaseCount = 0;
+        CameraLatencyHistogram attachLatency{kAttachLatencyBinSize};
+        CameraLatencyHistogram holdLatency{kHoldLatencyBinSize};
+    };
+
     // Must be accessed through RefBase
     virtual ~Camera3StreamSplitter();
 
@@ -205,6 +242,8 @@ private:
     // Helper function to get the BufferQueue slot where a particular buffer is attached to.
     int getSlotForOutputLocked(const sp<IGraphicBufferProducer>& gbp,
             const sp<GraphicBuffer>& gb);
+    // Record a buffer attached to an output slot
+    void setSlotForOutputLocked(OutputState& output, int slot, const sp<GraphicBuffer>& gb);
     // Helper function to remove the buffer from the BufferQueue slot
     status_t removeSlotForOutputLocked(const sp<IGraphicBufferProducer>& gbp,
             const sp<GraphicBuffer>& gb);
@@ -215,6 +254,10 @@ private:
     size_t mMaxHalBuffers = 0;
 
     static const nsecs_t kDequeueBufferTimeout   = s2ns(1); // 1 sec
+    // attachBuffer calls longer than this count as a consumer stall
+    static const nsecs_t kAttachStallThreshold   = ms2ns(5);
+    static const int32_t kAttachLatencyBinSize   = 1;  // in ms
+    static const int32_t kHoldLatencyBinSize     = 10; // in ms
 
     Mutex mMutex;
 
@@ -238,9 +281,8 @@ private:
     std::unordered_map<sp<IGraphicBufferProducer>, sp<OutputListener>,
             GBPHash> mNotifiers;
 
-    typedef std::vector<sp<GraphicBuffer>> OutputSlots;
-    std::unordered_map<sp<IGraphicBufferProducer>, std::unique_ptr<OutputSlots>,
-            GBPHash> mOutputSlots;
+    std::unordered_map<sp<IGraphicBufferProducer>, std::unique_ptr<OutputState>,
+            GBPHash> mOutputStates;
 
     // Latest onFrameAvailable return value
     std::atomic<status_t> mOnFrameAvailableRes{0};
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SERVERS_CAMERA3_INFLIGHTREQUESTRING_H
+#define ANDROID_SERVERS_CAMERA3_INFLIGHTREQUESTRING_H
+
+#include <utility>
+#include <vector>
+
+#include <utils/Errors.h>
+#include <utils/Log.h>
+
+namespace android {
+
+namespace camera3 {
+
+/**
+ * Map from frame number to in-flight request state, stored in a ring of slots indexed
+ * by frame number modulo the ring capacity.
+ *
+ * Frame numbers are handed out in increasing order, so as long as the oldest and newest
+ * live frames are less than capacity apart every live frame owns a distinct slot, and
+ * lookups, inserts and removals touch only that slot. When a new frame collides with a
+ * live one, the ring doubles in size only if it is at least half full, i.e. the pipeline
+ * really is deeper than the ring, and never beyond kMaxCapacity. Otherwise the older
+ * entry, typically a request the HAL is holding on to much longer than the others, is
+ * moved to a small overflow list that is searched only when its slot misses.
+ *
+ * Indices returned by add() and indexOfKey() are valid until the next add(). Not
+ * thread-safe; callers serialize access like they did for the KeyedVector this replaces.
+ */
+template <typename T>
+class InFlightRequestRing {
+  public:
+    static const size_t kDefaultCapacity = 64;
+    static const size_t kMaxCapacity = 4096;
+
+    explicit InFlightRequestRing(size_t capacity = kDefaultCapacity) :
+            mSlots(roundUpToPowerOf2(capacity)),
+            mMask(mSlots.size() - 1) {
+    }
+
+    // Insert or replace the entry for the frame number. Returns the entry index.
+    ssize_t add(uint32_t frameNumber, const T& value) {
+        compactOverflow();
+        ssize_t index = find(frameNumber);
+        if (index < 0) {
+            while (mSlots[frameNumber & mMask].used) {
+                if (mSize - mOverflow.size() >= mSlots.size() / 2 &&
+                        mSlots.size() < kMaxCapacity) {
+                    grow();
+                } else {
+                    if (mSlots.size() >= kMaxCapacity && !mMaxCapacityLogged) {
+                        ALOGE("%s: %zu requests in flight with the ring at its maximum "
+                                "capacity %zu, spilling to the overflow list", __FUNCTION__,
+                                mSize, mSlots.size());
+                        mMaxCapacityLogged = true;
+                    }
+                    spill(frameNumber & mMask);
+                }
+            }
+            index = frameNumber & mMask;
+            Slot &slot = mSlots[index];
+            slot.used = true;
+            slot.frameNumber = frameNumber;
+            mSize++;
+            if (mSize == 1 || static_cast<int32_t>(frameNumber - mNewestFrameNumber) > 0) {
+                mNewestFrameNumber = frameNumber;
+            }
+        }
+        slotAt(index).value = value;
+        return index;
+    }
+
+    // Returns the index of the frame number, or NAME_NOT_FOUND.
+    ssize_t indexOfKey(uint32_t frameNumber) const {
+        mLookupCount++;
+        ssize_t index = find(frameNumber);
+        if (index < 0) {
+            mLookupMissCount++;
+        }
+        return index;
+    }
+
+    const T& valueAt(size_t index) const { return slotAt(index).value; }
+    T& editValueAt(size_t index) { return slotAt(index).value; }
+    uint32_t keyAt(size_t index) const { return slotAt(index).frameNumber; }
+
+    void removeAt(size_t index) {
+        Slot &slot = slotAt(index);
+        if (!slot.used) return;
+        // Release whatever the request still references (metadata, buffers). Overflow
+        // entries are compacted by the next add(), so that indices stay valid until then.
+        slot.value = T();
+        slot.used = false;
+        mSize--;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < mSlots.size(); i++) {
+            removeAt(i);
+        }
+        mOverflow.clear();
+        mSize = 0;
+    }
+
+    size_t size() const { return mSize; }
+    size_t capacity() const { return mSlots.size(); }
+
+    // Visit the indices of all live entries: overflow entries first, in the order they were
+    // spilled, then ring entries in frame number order for entries within one ring capacity
+    // of the newest frame.
+    template <typename Func>
+    void forEachIndex(Func func) const {
+        size_t remaining = mSize;
+        for (size_t i = 0; i < mOverflow.size() && remaining > 0; i++) {
+            if (mOverflow[i].used) {
+                remaining--;
+                func(mSlots.size() + i);
+            }
+        }
+        for (size_t i = 1; i <= mSlots.size() && remaining > 0; i++) {
+            size_t index = (mNewestFrameNumber + i) & mMask;
+            if (mSlots[index].used) {
+                remaining--;
+                func(index);
+            }
+        }
+    }
+
+    uint64_t lookupCount() const { return mLookupCount; }
+    uint64_t lookupMissCount() const { return mLookupMissCount; }
+    uint32_t growCount() const { return mGrowCount; }
+    uint32_t spillCount() const { return mSpillCount; }
+
+  private:
+    struct Slot {
+        bool used = false;
+        uint32_t frameNumber = 0;
+        T value;
+    };
+
+    // Indices below mSlots.size() are ring slots, the rest are overflow entries
+    std::vector<Slot> mSlots;
+    std::vector<Slot> mOverflow;
+    size_t mMask;
+    size_t mSize = 0;
+    uint32_t mNewestFrameNumber = 0;
+
+    mutable uint64_t mLookupCount = 0;
+    mutable uint64_t mLookupMissCount = 0;
+    uint32_t mGrowCount = 0;
+    uint32_t mSpillCount = 0;
+    bool mMaxCapacityLogged = false;
+
+    static size_t roundUpToPowerOf2(size_t n) {
+        size_t capacity = 1;
+        while (capacity < n) capacity <<= 1;
+        return capacity;
+    }
+
+    Slot& slotAt(size_t index) {
+        return index < mSlots.size() ? mSlots[index] : mOverflow[index - mSlots.size()];
+    }
+
+    const Slot& slotAt(size_t index) const {
+        return index < mSlots.size() ? mSlots[index] : mOverflow[index - mSlots.size()];
+    }
+
+    ssize_t find(uint32_t frameNumber) const {
+        const Slot &slot = mSlots[frameNumber & mMask];
+        if (slot.used && slot.frameNumber == frameNumber) {
+            return frameNumber & mMask;
+        }
+        for (size_t i = 0; i < mOverflow.size(); i++) {
+            if (mOverflow[i].used && mOverflow[i].frameNumber == frameNumber) {
+                return mSlots.size() + i;
+            }
+        }
+        return NAME_NOT_FOUND;
+    }
+
+    // Move the entry in the given ring slot to the overflow list, freeing the slot
+    void spill(size_t index) {
+        mOverflow.push_back(std::move(mSlots[index]));
+        mSlots[index] = Slot();
+        mSpillCount++;
+    }
+
+    void compactOverflow() {
+        size_t used = 0;
+        for (size_t i = 0; i < mOverflow.size(); i++) {
+            if (mOverflow[i].used) {
+                if (used != i) {
+                    mOverflow[used] = std::move(mOverflow[i]);
+                }
+                used++;
+            }
+        }
+        mOverflow.resize(used);
+    }
+
+    // Doubling keeps distinct slots distinct: slot i moves to either i or i + old size
+    void grow() {
+        std::vector<Slot> old;
+        old.swap(mSlots);
+        mSlots.resize(old.size() * 2);
+        mMask = mSlots.size() - 1;
+        mGrowCount++;
+        for (Slot &slot : old) {
+            if (slot.used) {
+                mSlots[slot.frameNumber & mMask] = std::move(slot);
+            }
+        }
+    }
+};
+
+}; // namespace camera3
+
+}; // namespace android
+
+#endif
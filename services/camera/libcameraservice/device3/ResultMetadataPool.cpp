@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Camera3-ResultMetadataPool"
+//#define LOG_NDEBUG 0
+
+#include <inttypes.h>
+
+#include <utils/Log.h>
+#include <utils/String8.h>
+
+#include "ResultMetadataPool.h"
+
+namespace android {
+
+namespace camera3 {
+
+ResultMetadataPool::ResultMetadataPool(size_t maxBuffers) :
+        mMaxBuffers(maxBuffers) {
+}
+
+ResultMetadataPool::~ResultMetadataPool() {
+    for (camera_metadata_t *buffer : mBuffers) {
+        free_camera_metadata(buffer);
+    }
+}
+
+status_t ResultMetadataPool::obtain(size_t entryCapacity, size_t dataCapacity,
+        CameraMetadata *metadata) {
+    if (metadata == nullptr) return BAD_VALUE;
+    recycle(metadata);
+
+    camera_metadata_t *buffer = nullptr;
+    {
+        Mutex::Autolock l(mLock);
+        mObtainCount++;
+        reserveLocked(entryCapacity, dataCapacity);
+
+        for (auto it = mBuffers.begin(); it != mBuffers.end(); it++) {
+            if (get_camera_metadata_entry_capacity(*it) >= mEntryCapacity &&
+                    get_camera_metadata_data_capacity(*it) >= mDataCapacity) {
+                buffer = *it;
+                mBuffers.erase(it);
+                break;
+            }
+        }
+        if (buffer == nullptr) {
+            mAllocationCount++;
+            // Leave some room for frame-to-frame variation in result size.
+            entryCapacity = mEntryCapacity + mEntryCapacity / 4;
+            dataCapacity = mDataCapacity + mDataCapacity / 4;
+        }
+    }
+
+    if (buffer != nullptr) {
+        // Reset the buffer in place, keeping its full capacity.
+        size_t entries = get_camera_metadata_entry_capacity(buffer);
+        size_t data = get_camera_metadata_data_capacity(buffer);
+        buffer = place_camera_metadata(buffer, calculate_camera_metadata_size(entries, data),
+                entries, data);
+    } else {
+        buffer = allocate_camera_metadata(entryCapacity, dataCapacity);
+    }
+    if (buffer == nullptr) {
+        ALOGE("%s: Unable to allocate result metadata (%zu entries, %zu bytes)",
+                __FUNCTION__, entryCapacity, dataCapacity);
+        return NO_MEMORY;
+    }
+    metadata->acquire(buffer);
+    return OK;
+}
+
+void ResultMetadataPool::recycle(CameraMetadata *metadata) {
+    if (metadata == nullptr) return;
+    camera_metadata_t *buffer = metadata->release();
+    if (buffer == nullptr) return;
+
+    {
+        Mutex::Autolock l(mLock);
+        // Buffers smaller than the largest result can't be handed out again.
+        if (mBuffers.size() < mMaxBuffers &&
+                get_camera_metadata_entry_capacity(buffer) >= mEntryCapacity &&
+                get_camera_metadata_data_capacity(buffer) >= mDataCapacity) {
+            mBuffers.push_back(buffer);
+            return;
+        }
+        mFreeCount++;
+    }
+    free_camera_metadata(buffer);
+}
+
+void ResultMetadataPool::reserve(size_t entryCapacity, size_t dataCapacity) {
+    Mutex::Autolock l(mLock);
+    reserveLocked(entryCapacity, dataCapacity);
+}
+
+void ResultMetadataPool::reserveLocked(size_t entryCapacity, size_t dataCapacity) {
+    if (entryCapacity > mEntryCapacity) mEntryCapacity = entryCapacity;
+    if (dataCapacity > mDataCapacity) mDataCapacity = dataCapacity;
+}
+
+uint64_t ResultMetadataPool::getAllocationCount() const {
+    Mutex::Autolock l(mLock);
+    return mAllocationCount;
+}
+
+void ResultMetadataPool::dump(int fd, const char *prefix) const {
+    Mutex::Autolock l(mLock);
+    String8 lines;
+    lines.appendFormat("%s%zu/%zu buffers pooled, result size %zu entries %zu bytes\n",
+            prefix, mBuffers.size(), mMaxBuffers, mEntryCapacity, mDataCapacity);
+    lines.appendFormat("%s%" PRIu64 " obtained, %" PRIu64 " allocated, %" PRIu64 " freed\n",
+            prefix, mObtainCount, mAllocationCount, mFreeCount);
+    write(fd, lines.string(), lines.size());
+}
+
+}; // namespace camera3
+
+}; // namespace android
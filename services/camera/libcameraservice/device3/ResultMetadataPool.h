@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SERVERS_CAMERA3_RESULT_METADATA_POOL_H
+#define ANDROID_SERVERS_CAMERA3_RESULT_METADATA_POOL_H
+
+#include <vector>
+
+#include <utils/Errors.h>
+#include <utils/Mutex.h>
+#include <camera/CameraMetadata.h>
+
+namespace android {
+
+namespace camera3 {
+
+/**
+ * A pool of camera_metadata_t buffers for capture results.
+ *
+ * Capture results are built once per frame, and with CameraMetadata's grow-by-doubling
+ * append a complete result with partials typically costs several allocations. The pool
+ * hands out empty buffers sized to the largest result seen so far, so results are
+ * assembled in place without reallocation, and takes back buffers once the consumer of
+ * the result queue is done with them.
+ *
+ * Thread-safe.
+ */
+class ResultMetadataPool {
+  public:
+    static const size_t kDefaultMaxBuffers = 8;
+
+    explicit ResultMetadataPool(size_t maxBuffers = kDefaultMaxBuffers);
+    ~ResultMetadataPool();
+
+    /**
+     * Replace the contents of metadata with an empty buffer with room for at least
+     * entryCapacity entries and dataCapacity bytes of data, and no less than the
+     * largest request seen so far. Any previous contents are recycled.
+     */
+    status_t obtain(size_t entryCapacity, size_t dataCapacity, CameraMetadata *metadata);
+
+    /**
+     * Take back the buffer owned by metadata, leaving it empty. The buffer is freed
+     * instead if the pool is full.
+     */
+    void recycle(CameraMetadata *metadata);
+
+    // Make buffers handed out from now on at least this large.
+    void reserve(size_t entryCapacity, size_t dataCapacity);
+
+    // Number of buffers allocated by obtain() because none in the pool was large enough.
+    uint64_t getAllocationCount() const;
+
+    void dump(int fd, const char *prefix) const;
+
+  private:
+    mutable Mutex mLock;
+    const size_t mMaxBuffers;
+    std::vector<camera_metadata_t*> mBuffers;
+
+    size_t mEntryCapacity = 0;
+    size_t mDataCapacity = 0;
+
+    uint64_t mObtainCount = 0;
+    uint64_t mAllocationCount = 0;
+    uint64_t mFreeCount = 0;
+
+    void reserveLocked(size_t entryCapacity, size_t dataCapacity);
+};
+
+}; // namespace camera3
+
+}; // namespace android
+
+#endif
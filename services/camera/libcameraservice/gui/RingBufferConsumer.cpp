@@ -106,17 +106,57 @@ sp<PinnedBufferItem> RingBufferConsumer::pinSelectedBuffer(
     } // end scope of mMutex autolock
 
     if (waitForFence) {
-        status_t err = pinnedBuffer->getBufferItem().mFence->waitForever(
-                "RingBufferConsumer::pinSelectedBuffer");
-        if (err != OK) {
-            BI_LOGE("Failed to wait for fence of acquired buffer: %s (%d)",
-                    strerror(-err), err);
+        waitForPinnedBufferFence(pinnedBuffer);
+    }
+
+    return pinnedBuffer;
+}
+
+sp<PinnedBufferItem> RingBufferConsumer::pinBufferByTimestamp(nsecs_t timestamp,
+        bool waitForFence) {
+
+    sp<PinnedBufferItem> pinnedBuffer;
+
+    {
+        Mutex::Autolock _l(mMutex);
+
+        if (mTimestampIndex.empty()) {
+            return NULL;
+        }
+
+        // First buffer at or after the timestamp; an exact match if there is one.
+        // Otherwise prefer the closest earlier buffer, then the closest later one.
+        auto indexIt = mTimestampIndex.lower_bound(timestamp);
+        if (indexIt == mTimestampIndex.end() || indexIt->first != timestamp) {
+            if (indexIt != mTimestampIndex.begin()) {
+                --indexIt;
+            }
         }
+
+        RingBufferItem& item = *indexIt->second;
+        item.mPinCount++;
+        pinnedBuffer = new PinnedBufferItem(this, item);
+
+        BI_LOGV("Pinned buffer (frame %" PRIu64 ", timestamp %" PRId64 ")",
+                item.mFrameNumber, item.mTimestamp);
+    } // end scope of mMutex autolock
+
+    if (waitForFence) {
+        waitForPinnedBufferFence(pinnedBuffer);
     }
 
     return pinnedBuffer;
 }
 
+void RingBufferConsumer::waitForPinnedBufferFence(const sp<PinnedBufferItem>& pinnedBuffer) {
+    status_t err = pinnedBuffer->getBufferItem().mFence->waitForever(
+            "RingBufferConsumer::pinBuffer");
+    if (err != OK) {
+        BI_LOGE("Failed to wait for fence of acquired buffer: %s (%d)",
+                strerror(-err), err);
+    }
+}
+
 status_t RingBufferConsumer::clear() {
 
     status_t err;
@@ -161,24 +201,25 @@ nsecs_t RingBufferConsumer::getLatestTimestamp() {
     return mLatestTimestamp;
 }
 
-void RingBufferConsumer::pinBufferLocked(const BufferItem& item) {
-    List<RingBufferItem>::iterator it, end;
-
-    for (it = mBufferItemList.begin(), end = mBufferItemList.end();
-         it != end;
-         ++it) {
-
-        RingBufferItem& find = *it;
-        if (item.mGraphicBuffer == find.mGraphicBuffer) {
-            find.mPinCount++;
-            break;
+RingBufferConsumer::RingBufferItemIterator RingBufferConsumer::findBufferLocked(
+        const BufferItem& item) {
+    auto range = mTimestampIndex.equal_range(item.mTimestamp);
+    for (auto indexIt = range.first; indexIt != range.second; ++indexIt) {
+        if (indexIt->second->mGraphicBuffer == item.mGraphicBuffer) {
+            return indexIt->second;
         }
     }
+    return mBufferItemList.end();
+}
+
+void RingBufferConsumer::pinBufferLocked(const BufferItem& item) {
+    RingBufferItemIterator it = findBufferLocked(item);
 
-    if (it == end) {
+    if (it == mBufferItemList.end()) {
         BI_LOGE("Failed to pin buffer (timestamp %" PRId64 ", framenumber %" PRIu64 ")",
                  item.mTimestamp, item.mFrameNumber);
     } else {
+        it->mPinCount++;
         BI_LOGV("Pinned buffer (frame %" PRIu64 ", timestamp %" PRId64 ")",
                 item.mFrameNumber, item.mTimestamp);
     }
@@ -187,13 +228,7 @@ void RingBufferConsumer::pinBufferLocked(const BufferItem& item) {
 status_t RingBufferConsumer::releaseOldestBufferLocked(size_t* pinnedFrames) {
     status_t err = OK;
 
-    List<RingBufferItem>::iterator it, end, accIt;
-
-    it = mBufferItemList.begin();
-    end = mBufferItemList.end();
-    accIt = end;
-
-    if (it == end) {
+    if (mBufferItemList.empty()) {
         /**
          * This is fine. We really care about being able to acquire a buffer
          * successfully after this function completes, not about it releasing
@@ -204,23 +239,19 @@ status_t RingBufferConsumer::releaseOldestBufferLocked(size_t* pinnedFrames) {
         return NOT_ENOUGH_DATA;
     }
 
-    for (; it != end; ++it) {
-        RingBufferItem& find = *it;
-
-        if (find.mPinCount > 0) {
-            if (pinnedFrames != NULL) {
-                ++(*pinnedFrames);
-            }
-            // Filter out pinned frame when searching for buffer to release
-            continue;
+    // The oldest unpinned buffer is the first unpinned one in timestamp order
+    auto indexIt = mTimestampIndex.begin();
+    for (; indexIt != mTimestampIndex.end(); ++indexIt) {
+        if (indexIt->second->mPinCount == 0) {
+            break;
         }
-
-        if (find.mTimestamp < accIt->mTimestamp || accIt == end) {
-            accIt = it;
+        if (pinnedFrames != NULL) {
+            ++(*pinnedFrames);
         }
     }
 
-    if (accIt != end) {
+    if (indexIt != mTimestampIndex.end()) {
+        RingBufferItemIterator accIt = indexIt->second;
         RingBufferItem& item = *accIt;
 
         // In case the object was never pinned, pass the acquire fence
@@ -256,6 +287,7 @@ status_t RingBufferConsumer::releaseOldestBufferLocked(size_t* pinnedFrames) {
         BI_LOGV("Buffer timestamp %" PRId64 ", frame %" PRIu64 " evicted",
                 item.mTimestamp, item.mFrameNumber);
 
+        mTimestampIndex.erase(indexIt);
         mBufferItemList.erase(accIt);
     } else {
         BI_LOGW("All buffers pinned, could not find any to release");
@@ -317,6 +349,8 @@ void RingBufferConsumer::onFrameAvailable(const BufferItem& item) {
         mLatestTimestamp = item.mTimestamp;
 
         item.mGraphicBuffer = mSlots[item.mSlot].mGraphicBuffer;
+
+        mTimestampIndex.emplace(item.mTimestamp, --mBufferItemList.end());
     } // end of mMutex lock
 
     ConsumerBase::onFrameAvailable(item);
@@ -325,30 +359,22 @@ void RingBufferConsumer::onFrameAvailable(const BufferItem& item) {
 void RingBufferConsumer::unpinBuffer(const BufferItem& item) {
     Mutex::Autolock _l(mMutex);
 
-    List<RingBufferItem>::iterator it, end, accIt;
-
-    for (it = mBufferItemList.begin(), end = mBufferItemList.end();
-         it != end;
-         ++it) {
-
-        RingBufferItem& find = *it;
-        if (item.mGraphicBuffer == find.mGraphicBuffer) {
-            status_t res = addReleaseFenceLocked(item.mSlot,
-                    item.mGraphicBuffer, item.mFence);
-
-            if (res != OK) {
-                BI_LOGE("Failed to add release fence to buffer "
-                        "(timestamp %" PRId64 ", framenumber %" PRIu64,
-                        item.mTimestamp, item.mFrameNumber);
-                return;
-            }
+    RingBufferItemIterator it = findBufferLocked(item);
+    if (it != mBufferItemList.end()) {
+        status_t res = addReleaseFenceLocked(item.mSlot,
+                item.mGraphicBuffer, item.mFence);
 
-            find.mPinCount--;
-            break;
+        if (res != OK) {
+            BI_LOGE("Failed to add release fence to buffer "
+                    "(timestamp %" PRId64 ", framenumber %" PRIu64,
+                    item.mTimestamp, item.mFrameNumber);
+            return;
         }
+
+        it->mPinCount--;
     }
 
-    if (it == end) {
+    if (it == mBufferItemList.end()) {
         // This should never happen. If it happens, we have a bug.
         BI_LOGE("Failed to unpin buffer (timestamp %" PRId64 ", framenumber %" PRIu64 ")",
                  item.mTimestamp, item.mFrameNumber);
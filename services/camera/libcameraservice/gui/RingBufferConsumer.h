@@ -23,6 +23,8 @@
 
 #include <utils/List.h>
 
+#include <map>
+
 #define ANDROID_GRAPHICS_RINGBUFFERCONSUMER_JNI_ID "mRingBufferConsumer"
 
 namespace android {
@@ -153,6 +155,17 @@ class RingBufferConsumer : public ConsumerBase,
     sp<PinnedBufferItem> pinSelectedBuffer(const RingBufferComparator& filter,
                                            bool waitForFence = true);
 
+    // Find the buffer best matching the timestamp, then pin it before returning it.
+    //
+    // Match priority from best to worst:
+    //  1) Timestamps match.
+    //  2) Timestamp is closest to the requested one (and lower).
+    //  3) Timestamp is closest to the requested one (and higher).
+    //
+    // Unlike pinSelectedBuffer, this doesn't visit every buffer in the ring.
+    sp<PinnedBufferItem> pinBufferByTimestamp(nsecs_t timestamp,
+                                              bool waitForFence = true);
+
     // Release all the non-pinned buffers in the ring buffer
     status_t clear();
 
@@ -176,11 +189,22 @@ class RingBufferConsumer : public ConsumerBase,
         RingBufferItem() : BufferItem(), mPinCount(0) {}
         int mPinCount;
     };
+    typedef List<RingBufferItem>::iterator RingBufferItemIterator;
+
+    // Look up a buffer of the ring by timestamp and graphic buffer. Returns
+    // mBufferItemList.end() if not found.
+    RingBufferItemIterator findBufferLocked(const BufferItem& item);
+
+    // Wait for the acquire fence of a buffer returned by the pin methods
+    void waitForPinnedBufferFence(const sp<PinnedBufferItem>& pinnedBuffer);
 
     // List of acquired buffers in our ring buffer
     List<RingBufferItem>       mBufferItemList;
     const int                  mBufferCount;
 
+    // mBufferItemList indexed by timestamp, for selection and eviction
+    std::multimap<int64_t, RingBufferItemIterator> mTimestampIndex;
+
     // Timestamp of latest buffer
     nsecs_t mLatestTimestamp;
 };
@@ -25,6 +25,11 @@
 #include <camera_metadata_hidden.h>
 #include <gtest/gtest.h>
 
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
 using namespace android;
 using namespace android::hardware::camera;
 using android::hardware::camera::common::V1_0::Status;
@@ -93,6 +98,18 @@ struct TestICameraProvider : virtual public provider::V2_4::ICameraProvider {
     sp<device::V3_2::ICameraDevice> mDeviceInterface;
     hardware::hidl_vec<common::V1_0::VendorTagSection> mVendorTagSections;
 
+    // Providers are passthrough unless the test says otherwise
+    bool mRemote = false;
+
+    // Device interface queries in progress, and the most seen at once. When mOverlap is set,
+    // each query waits (up to a bound) for another one to start, so that concurrent
+    // enumeration is observed reliably.
+    std::mutex mQueryLock;
+    std::condition_variable mQueryCond;
+    size_t mQueriesInFlight = 0;
+    size_t mMaxQueriesInFlight = 0;
+    bool mOverlap = false;
+
     TestICameraProvider(const std::vector<hardware::hidl_string> &devices,
             const hardware::hidl_vec<common::V1_0::VendorTagSection> &vendorSection) :
         mDeviceNames(devices),
@@ -144,10 +161,27 @@ struct TestICameraProvider : virtual public provider::V2_4::ICameraProvider {
     virtual hardware::Return<void> getCameraDeviceInterface_V3_x(
             const hardware::hidl_string&,
             getCameraDeviceInterface_V3_x_cb _hidl_cb) override {
+        {
+            std::unique_lock<std::mutex> l(mQueryLock);
+            mQueriesInFlight++;
+            if (mQueriesInFlight > mMaxQueriesInFlight) {
+                mMaxQueriesInFlight = mQueriesInFlight;
+            }
+            mQueryCond.notify_all();
+            if (mOverlap) {
+                mQueryCond.wait_for(l, std::chrono::milliseconds(200),
+                        [this]() { return mMaxQueriesInFlight > 1; });
+            }
+            mQueriesInFlight--;
+        }
         _hidl_cb(Status::OK, mDeviceInterface);
         return hardware::Void();
     }
 
+    bool isRemote() const override {
+        return mRemote;
+    }
+
 };
 
 /**
@@ -365,3 +399,86 @@ TEST(CameraProviderManagerTest, MultipleVendorTagTest) {
     metadataCopy.dump(1, 2);
     secondMetadata.dump(1, 2);
 }
+
+TEST(CameraProviderManagerTest, ManyDevicesTest) {
+    const size_t kDeviceCount = 12;
+    // List the devices in descending order, so that the order they end up in can't be
+    // the result of sorting by ID
+    std::vector<hardware::hidl_string> deviceNames;
+    for (size_t i = kDeviceCount; i > 0; i--) {
+        deviceNames.push_back(std::string("device@3.2/test/") + std::to_string(i - 1));
+    }
+    hardware::hidl_vec<common::V1_0::VendorTagSection> vendorSection;
+
+    sp<CameraProviderManager> providerManager = new CameraProviderManager();
+    sp<TestStatusListener> statusListener = new TestStatusListener();
+    TestInteractionProxy serviceProxy;
+    sp<TestICameraProvider> provider =  new TestICameraProvider(deviceNames,
+            vendorSection);
+    // Only remote providers are enumerated on multiple threads
+    provider->mRemote = true;
+    provider->mOverlap = true;
+    serviceProxy.setProvider(provider);
+
+    auto res = providerManager->initialize(statusListener, &serviceProxy);
+    ASSERT_EQ(res, OK) << "Unable to initialize provider manager";
+
+    EXPECT_GT(provider->mMaxQueriesInFlight, 1u) <<
+            "Devices of a remote provider were not enumerated concurrently";
+    EXPECT_EQ(0u, provider->mQueriesInFlight);
+
+    ASSERT_EQ(static_cast<int>(kDeviceCount), providerManager->getCameraCount()) <<
+            "Not all devices were enumerated";
+    for (size_t i = 0; i < kDeviceCount; i++) {
+        EXPECT_TRUE(providerManager->isValidDevice(std::to_string(i), /*majorVersion*/ 3)) <<
+                "Device " << i << " missing";
+    }
+
+    // The dump lists devices in the order they were added to the provider, which must be
+    // the order the provider listed them in
+    FILE *dumpFile = tmpfile();
+    ASSERT_NE(nullptr, dumpFile);
+    Vector<String16> args;
+    ASSERT_EQ(OK, providerManager->dump(fileno(dumpFile), args));
+    rewind(dumpFile);
+    std::vector<std::string> dumpedNames;
+    const std::string devicePrefix = "== Camera HAL device ";
+    char line[256];
+    while (fgets(line, sizeof(line), dumpFile) != nullptr) {
+        std::string dumpLine(line);
+        if (dumpLine.compare(0, devicePrefix.size(), devicePrefix) == 0) {
+            size_t end = dumpLine.find(' ', devicePrefix.size());
+            dumpedNames.push_back(dumpLine.substr(devicePrefix.size(),
+                    end - devicePrefix.size()));
+        }
+    }
+    fclose(dumpFile);
+    ASSERT_EQ(kDeviceCount, dumpedNames.size());
+    for (size_t i = 0; i < kDeviceCount; i++) {
+        EXPECT_EQ(std::string(deviceNames[i]), dumpedNames[i]) << "at position " << i;
+    }
+}
+
+TEST(CameraProviderManagerTest, PassthroughDevicesTest) {
+    const size_t kDeviceCount = 4;
+    std::vector<hardware::hidl_string> deviceNames;
+    for (size_t i = 0; i < kDeviceCount; i++) {
+        deviceNames.push_back(std::string("device@3.2/test/") + std::to_string(i));
+    }
+    hardware::hidl_vec<common::V1_0::VendorTagSection> vendorSection;
+
+    sp<CameraProviderManager> providerManager = new CameraProviderManager();
+    sp<TestStatusListener> statusListener = new TestStatusListener();
+    TestInteractionProxy serviceProxy;
+    sp<TestICameraProvider> provider =  new TestICameraProvider(deviceNames,
+            vendorSection);
+    serviceProxy.setProvider(provider);
+
+    auto res = providerManager->initialize(statusListener, &serviceProxy);
+    ASSERT_EQ(res, OK) << "Unable to initialize provider manager";
+
+    // Passthrough HAL modules aren't required to be thread-safe
+    EXPECT_EQ(1u, provider->mMaxQueriesInFlight) <<
+            "Devices of a passthrough provider were enumerated concurrently";
+    ASSERT_EQ(static_cast<int>(kDeviceCount), providerManager->getCameraCount());
+}
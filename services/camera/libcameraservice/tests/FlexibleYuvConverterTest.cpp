@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "FlexibleYuvConverterTest"
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <system/graphics.h>
+
+#include "../api1/client2/FlexibleYuvConverter.h"
+#include <gtest/gtest.h>
+
+using namespace android;
+using namespace android::camera2;
+
+namespace {
+
+enum ChromaLayout {
+    LAYOUT_NV21,    // semiplanar, Cr first
+    LAYOUT_NV12,    // semiplanar, Cb first
+    LAYOUT_PLANAR,  // separate Cr and Cb planes
+    LAYOUT_STEP2,   // chroma step 2, but Cr and Cb not adjacent: only the generic copy applies
+};
+
+// A flexible YUV 4:2:0 source image filled with a position-dependent pattern
+struct SourceImage {
+    std::vector<uint8_t> storage;
+    CpuConsumer::LockedBuffer buffer;
+
+    SourceImage(uint32_t width, uint32_t height, uint32_t padding, ChromaLayout layout) {
+        const uint32_t stride = width + padding;
+        const uint32_t chromaWidth = width / 2;
+        const uint32_t chromaHeight = height / 2;
+        const uint32_t chromaStep = (layout == LAYOUT_PLANAR) ? 1 : 2;
+        const uint32_t chromaStride = chromaWidth * chromaStep + padding;
+        const size_t chromaSize = chromaStride * chromaHeight;
+        storage.resize(stride * height + 2 * chromaSize + 1);
+        for (size_t i = 0; i < storage.size(); i++) {
+            storage[i] = (uint8_t) (i * 7 + (i >> 8));
+        }
+
+        uint8_t *y = storage.data();
+        uint8_t *chroma = y + stride * height;
+        buffer.data = y;
+        buffer.width = width;
+        buffer.height = height;
+        buffer.stride = stride;
+        buffer.chromaStride = chromaStride;
+        buffer.chromaStep = chromaStep;
+        switch (layout) {
+            case LAYOUT_NV21:
+                buffer.dataCr = chroma;
+                buffer.dataCb = chroma + 1;
+                break;
+            case LAYOUT_NV12:
+                buffer.dataCb = chroma;
+                buffer.dataCr = chroma + 1;
+                break;
+            case LAYOUT_PLANAR:
+                buffer.dataCr = chroma;
+                buffer.dataCb = chroma + chromaSize;
+                break;
+            case LAYOUT_STEP2:
+                buffer.dataCr = chroma;
+                buffer.dataCb = chroma + chromaSize + 1;
+                break;
+        }
+    }
+};
+
+// Converts with both paths into destinations prefilled with the same pattern, so that
+// bytes the conversion should not touch are compared too
+void expectSameAsGeneric(int32_t format, uint32_t width, uint32_t height, uint32_t padding,
+        ChromaLayout layout) {
+    SCOPED_TRACE(testing::Message() << "format 0x" << std::hex << format << std::dec
+            << " " << width << "x" << height << " padding " << padding
+            << " layout " << layout);
+    SourceImage source(width, height, padding, layout);
+
+    // YV12 callbacks use 16-aligned strides, NV21 callbacks are packed
+    uint32_t yStride = width;
+    uint32_t cStride = width / 2;
+    if (format == HAL_PIXEL_FORMAT_YV12) {
+        yStride = (width + 15) & ~15;
+        cStride = ((yStride / 2) + 15) & ~15;
+    }
+    const size_t size = yStride * height + 2 * cStride * (height / 2) + 64;
+    std::vector<uint8_t> fast(size, 0xA5), generic(size, 0xA5);
+
+    ASSERT_EQ(OK, convertFlexibleYuv(format, fast.data(), source.buffer, yStride, cStride));
+    ASSERT_EQ(OK, convertFlexibleYuvGeneric(format, generic.data(), source.buffer, yStride,
+            cStride));
+    EXPECT_EQ(generic, fast);
+}
+
+} // anonymous namespace
+
+TEST(FlexibleYuvConverterTest, MatchesGenericCopy) {
+    const int32_t formats[] = { HAL_PIXEL_FORMAT_YCrCb_420_SP, HAL_PIXEL_FORMAT_YV12 };
+    const ChromaLayout layouts[] = { LAYOUT_NV21, LAYOUT_NV12, LAYOUT_PLANAR, LAYOUT_STEP2 };
+    for (int32_t format : formats) {
+        for (ChromaLayout layout : layouts) {
+            // Widths around the 16 and 32 sample kernel blocks, with and without row padding
+            for (uint32_t width = 2; width <= 72; width += 2) {
+                for (uint32_t padding : { 0u, 4u, 64u }) {
+                    expectSameAsGeneric(format, width, 6, padding, layout);
+                }
+            }
+            expectSameAsGeneric(format, 640, 480, 0, layout);
+            expectSameAsGeneric(format, 1920, 1080, 128, layout);
+        }
+    }
+}
+
+TEST(FlexibleYuvConverterTest, RejectsOtherFormats) {
+    SourceImage source(16, 16, 0, LAYOUT_NV21);
+    std::vector<uint8_t> dst(16 * 16 * 2);
+    EXPECT_EQ(INVALID_OPERATION, convertFlexibleYuv(HAL_PIXEL_FORMAT_RGBA_8888, dst.data(),
+            source.buffer, 16, 8));
+}
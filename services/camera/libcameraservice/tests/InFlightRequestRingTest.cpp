@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "InFlightRequestRingTest"
+
+#include <vector>
+
+#include "../device3/InFlightRequestRing.h"
+#include <gtest/gtest.h>
+
+using namespace android;
+using android::camera3::InFlightRequestRing;
+
+TEST(InFlightRequestRingTest, AddLookupRemove) {
+    InFlightRequestRing<int> ring(8);
+
+    for (uint32_t frame = 0; frame < 6; frame++) {
+        ssize_t index = ring.add(frame, frame * 10);
+        ASSERT_GE(index, 0);
+        EXPECT_EQ(frame, ring.keyAt(index));
+    }
+    EXPECT_EQ(6u, ring.size());
+
+    ssize_t index = ring.indexOfKey(3);
+    ASSERT_GE(index, 0);
+    EXPECT_EQ(30, ring.valueAt(index));
+    ring.removeAt(index);
+    EXPECT_EQ(NAME_NOT_FOUND, ring.indexOfKey(3));
+    EXPECT_EQ(5u, ring.size());
+
+    // Adding an existing frame replaces its value
+    index = ring.add(4, 44);
+    EXPECT_EQ(44, ring.valueAt(ring.indexOfKey(4)));
+    EXPECT_EQ(5u, ring.size());
+}
+
+TEST(InFlightRequestRingTest, StuckRequestDoesNotGrowRing) {
+    InFlightRequestRing<int> ring(8);
+
+    // Frame 0 never completes, while a shallow pipeline of 2 requests keeps flowing
+    ring.add(0, 0);
+    for (uint32_t frame = 1; frame < 1000; frame++) {
+        ring.add(frame, frame);
+        if (frame >= 2) {
+            ring.removeAt(ring.indexOfKey(frame - 1));
+        }
+    }
+
+    EXPECT_EQ(8u, ring.capacity());
+    EXPECT_EQ(0u, ring.growCount());
+    EXPECT_EQ(1u, ring.spillCount());
+    ssize_t index = ring.indexOfKey(0);
+    ASSERT_GE(index, 0);
+    EXPECT_EQ(0u, ring.keyAt(index));
+    EXPECT_EQ(2u, ring.size());
+
+    ring.removeAt(index);
+    EXPECT_EQ(NAME_NOT_FOUND, ring.indexOfKey(0));
+    EXPECT_EQ(1u, ring.size());
+}
+
+TEST(InFlightRequestRingTest, DeepPipelineGrowsRing) {
+    InFlightRequestRing<int> ring(8);
+
+    // 20 requests in flight at once need a ring of 32 slots
+    for (uint32_t frame = 0; frame < 20; frame++) {
+        ring.add(frame, frame);
+    }
+    EXPECT_EQ(32u, ring.capacity());
+    EXPECT_EQ(2u, ring.growCount());
+    EXPECT_EQ(0u, ring.spillCount());
+    for (uint32_t frame = 0; frame < 20; frame++) {
+        ssize_t index = ring.indexOfKey(frame);
+        ASSERT_GE(index, 0);
+        EXPECT_EQ(static_cast<int>(frame), ring.valueAt(index));
+    }
+}
+
+TEST(InFlightRequestRingTest, GrowthIsCapped) {
+    const size_t max = InFlightRequestRing<int>::kMaxCapacity;
+    InFlightRequestRing<int> ring(max);
+
+    // Every request stays in flight; the ring stops growing and spills the oldest ones
+    for (uint32_t frame = 0; frame < max + 16; frame++) {
+        ring.add(frame, frame);
+    }
+    EXPECT_EQ(max, ring.capacity());
+    EXPECT_EQ(0u, ring.growCount());
+    EXPECT_EQ(16u, ring.spillCount());
+    EXPECT_EQ(max + 16, ring.size());
+    for (uint32_t frame = 0; frame < max + 16; frame++) {
+        ASSERT_GE(ring.indexOfKey(frame), 0) << "frame " << frame;
+    }
+}
+
+TEST(InFlightRequestRingTest, ForEachVisitsOverflowFirst) {
+    InFlightRequestRing<int> ring(4);
+
+    ring.add(0, 0);
+    ring.add(5, 5);
+    ring.removeAt(ring.indexOfKey(5));
+    // Frame 4 collides with the stuck frame 0 while the ring is mostly empty
+    ring.add(4, 4);
+    ring.add(6, 6);
+    EXPECT_EQ(1u, ring.spillCount());
+
+    std::vector<uint32_t> frames;
+    ring.forEachIndex([&](size_t index) { frames.push_back(ring.keyAt(index)); });
+    EXPECT_EQ((std::vector<uint32_t>{0, 4, 6}), frames);
+
+    // Removing an overflow entry keeps the other indices valid until the next add
+    ssize_t index4 = ring.indexOfKey(4);
+    ring.removeAt(ring.indexOfKey(0));
+    EXPECT_EQ(4u, ring.keyAt(index4));
+    ring.add(7, 7);
+    EXPECT_EQ(NAME_NOT_FOUND, ring.indexOfKey(0));
+    EXPECT_EQ(3u, ring.size());
+
+    ring.clear();
+    EXPECT_EQ(0u, ring.size());
+    EXPECT_EQ(NAME_NOT_FOUND, ring.indexOfKey(4));
+}
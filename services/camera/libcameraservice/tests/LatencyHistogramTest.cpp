@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LatencyHistogramTest"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <utils/String8.h>
+
+#include "../utils/LatencyHistogram.h"
+#include <gtest/gtest.h>
+
+using namespace android;
+
+// Runs one of the histogram dump methods and returns what it wrote
+template <typename DumpFn>
+static std::string capture(DumpFn dumpFn) {
+    FILE *file = tmpfile();
+    if (file == nullptr) {
+        return std::string();
+    }
+    dumpFn(fileno(file));
+    rewind(file);
+    std::string output;
+    char buffer[256];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        output.append(buffer, count);
+    }
+    fclose(file);
+    return output;
+}
+
+// Parses "name,count,sum_us,bin0,bin1,..." into the numeric fields
+static std::vector<uint64_t> csvFields(const CameraLogLatencyHistogram &histogram) {
+    std::string line = capture([&](int fd) { histogram.dumpCsv(fd, "test"); });
+    std::vector<uint64_t> fields;
+    std::stringstream stream(line);
+    std::string field;
+    std::getline(stream, field, ',');
+    while (std::getline(stream, field, ',')) {
+        fields.push_back(strtoull(field.c_str(), nullptr, 10));
+    }
+    return fields;
+}
+
+TEST(CameraLogLatencyHistogramTest, BinsArePowersOfTwoMicroseconds) {
+    CameraLogLatencyHistogram histogram;
+
+    histogram.add(-5000);       // negative durations count as 0 us
+    histogram.add(1999);        // 1 us
+    histogram.add(2000);        // 2 us
+    histogram.add(3999);        // 3 us
+    histogram.add(1000000);     // 1000 us, in [512, 1024)
+    histogram.add(1024000);     // 1024 us
+    histogram.add(3600 * 1000000000LL);   // an hour lands in the last bin
+    EXPECT_EQ(7u, histogram.count());
+
+    std::vector<uint64_t> fields = csvFields(histogram);
+    ASSERT_EQ(2 + CameraLogLatencyHistogram::kBinCount, fields.size());
+    EXPECT_EQ(7u, fields[0]);
+    EXPECT_EQ(0u + 1 + 2 + 3 + 1000 + 1024 + 3600000000ULL, fields[1]);
+
+    std::vector<uint64_t> expected(CameraLogLatencyHistogram::kBinCount, 0);
+    expected[0] = 2;
+    expected[1] = 2;
+    expected[9] = 1;
+    expected[10] = 1;
+    expected[CameraLogLatencyHistogram::kBinCount - 1] = 1;
+    EXPECT_EQ(expected, std::vector<uint64_t>(fields.begin() + 2, fields.end()));
+}
+
+TEST(CameraLogLatencyHistogramTest, DumpReportsPercentiles) {
+    CameraLogLatencyHistogram histogram;
+
+    // 90 samples of 100 us and 10 of 10 ms
+    for (int i = 0; i < 90; i++) {
+        histogram.add(100000);
+    }
+    for (int i = 0; i < 10; i++) {
+        histogram.add(10000000);
+    }
+
+    std::string summary = capture([&](int fd) { histogram.dump(fd, "test"); });
+    EXPECT_EQ("test (100) samples: mean 1090 us, p50 < 128 us, p90 < 16384 us, "
+            "p99 < 16384 us\n", summary);
+}
+
+TEST(CameraLogLatencyHistogramTest, EmptyHistogramDumpsNothing) {
+    CameraLogLatencyHistogram histogram;
+    EXPECT_EQ("", capture([&](int fd) { histogram.dump(fd, "test"); }));
+    EXPECT_EQ("", capture([&](int fd) { histogram.dumpCsv(fd, "test"); }));
+
+    histogram.add(5000);
+    EXPECT_NE("", capture([&](int fd) { histogram.dump(fd, "test"); }));
+    histogram.reset();
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ("", capture([&](int fd) { histogram.dump(fd, "test"); }));
+    EXPECT_EQ("", capture([&](int fd) { histogram.dumpCsv(fd, "test"); }));
+}
+
+TEST(CameraLogLatencyHistogramTest, ConcurrentAddsAreCounted) {
+    static const int kThreads = 4;
+    static const int kSamples = 10000;
+    CameraLogLatencyHistogram histogram;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&histogram, t]() {
+            for (int i = 0; i < kSamples; i++) {
+                histogram.add((t + 1) * 1000);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(static_cast<uint64_t>(kThreads * kSamples), histogram.count());
+    std::vector<uint64_t> fields = csvFields(histogram);
+    ASSERT_EQ(2 + CameraLogLatencyHistogram::kBinCount, fields.size());
+    EXPECT_EQ(static_cast<uint64_t>((1 + 2 + 3 + 4) * kSamples), fields[1]);
+    // 1 us in bin 0, 2 and 3 us in bin 1, 4 us in bin 2
+    EXPECT_EQ(static_cast<uint64_t>(kSamples), fields[2]);
+    EXPECT_EQ(static_cast<uint64_t>(2 * kSamples), fields[3]);
+    EXPECT_EQ(static_cast<uint64_t>(kSamples), fields[4]);
+}
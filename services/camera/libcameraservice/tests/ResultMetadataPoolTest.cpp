@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "ResultMetadataPoolTest"
+
+#include <vector>
+
+#include "../device3/ResultMetadataPool.h"
+#include <gtest/gtest.h>
+
+using namespace android;
+using android::camera3::ResultMetadataPool;
+
+namespace {
+
+// Build a HAL-style result with count entries, taking tags in order starting at first
+camera_metadata_t *makeResult(size_t first, size_t count) {
+    std::vector<uint32_t> tags;
+    for (uint32_t section = 0; section < ANDROID_SECTION_COUNT; section++) {
+        for (uint32_t tag = section << 16; get_camera_metadata_tag_type(tag) >= 0; tag++) {
+            tags.push_back(tag);
+        }
+    }
+    // Large enough for one value of any type
+    const int64_t value = 1;
+    camera_metadata_t *result = allocate_camera_metadata(count, count * sizeof(value));
+    for (size_t i = first; i < first + count && i < tags.size(); i++) {
+        add_camera_metadata_entry(result, tags[i], &value, 1);
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+TEST(ResultMetadataPoolTest, ObtainReturnsEmptyBuffer) {
+    ResultMetadataPool pool;
+    CameraMetadata metadata;
+
+    ASSERT_EQ(OK, pool.obtain(4, 32, &metadata));
+    EXPECT_TRUE(metadata.isEmpty());
+    int64_t value = 1;
+    ASSERT_EQ(OK, metadata.update(ANDROID_SENSOR_TIMESTAMP, &value, 1));
+
+    // A recycled buffer must come back empty
+    pool.recycle(&metadata);
+    EXPECT_TRUE(metadata.isEmpty());
+    ASSERT_EQ(OK, pool.obtain(4, 32, &metadata));
+    EXPECT_TRUE(metadata.isEmpty());
+    EXPECT_EQ(1u, pool.getAllocationCount());
+}
+
+/**
+ * Run a synthetic 60 fps session the way Camera3Device uses the pool: partial results
+ * collected into a pooled buffer, completed in place, queued, and returned by the
+ * consumer when it asks for the next result. Buffer allocations must not scale with
+ * the number of frames.
+ */
+TEST(ResultMetadataPoolTest, SixtyFpsSessionAllocations) {
+    const size_t kFrameCount = 60 * 10;
+    const size_t kPartialEntries = 8;
+    const size_t kFinalEntries = 48;
+
+    ResultMetadataPool pool;
+    CameraMetadata consumerFrame;
+    CameraMetadata lastFrame;
+
+    camera_metadata_t *partial = makeResult(0, kPartialEntries);
+    camera_metadata_t *finalResult = makeResult(kPartialEntries, kFinalEntries);
+
+    for (size_t frame = 0; frame < kFrameCount; frame++) {
+        CameraMetadata collected;
+        ASSERT_EQ(OK, pool.obtain(get_camera_metadata_entry_count(partial),
+                get_camera_metadata_data_count(partial), &collected));
+        ASSERT_EQ(OK, collected.append(partial));
+
+        size_t entries = kPartialEntries + kFinalEntries;
+        size_t data = get_camera_metadata_data_count(partial) +
+                get_camera_metadata_data_count(finalResult);
+        const camera_metadata_t *buffer = collected.getAndLock();
+        bool fits = entries <= get_camera_metadata_entry_capacity(buffer) &&
+                data <= get_camera_metadata_data_capacity(buffer);
+        collected.unlock(buffer);
+
+        CameraMetadata result;
+        if (fits) {
+            result.acquire(collected);
+            pool.reserve(entries, data);
+        } else {
+            ASSERT_EQ(OK, pool.obtain(entries, data, &result));
+            ASSERT_EQ(OK, result.append(collected));
+        }
+        ASSERT_EQ(OK, result.append(finalResult));
+        ASSERT_EQ(entries, result.entryCount());
+
+        // Consumer returns its previous frame and keeps the new one
+        pool.recycle(&consumerFrame);
+        consumerFrame.acquire(result);
+        lastFrame.swap(consumerFrame);
+    }
+
+    free_camera_metadata(partial);
+    free_camera_metadata(finalResult);
+
+    // The first frame sizes the pool; later frames should reuse its buffers.
+    EXPECT_LE(pool.getAllocationCount(), 4u);
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "TagMonitorTest"
+
+#include <stdio.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <camera/CameraMetadata.h>
+#include <utils/String8.h>
+
+#include "../utils/TagMonitor.h"
+#include <gtest/gtest.h>
+
+using namespace android;
+
+// Runs dumpMonitoredMetadata() and returns what it wrote
+static std::string dump(TagMonitor &monitor) {
+    FILE *file = tmpfile();
+    if (file == nullptr) {
+        return std::string();
+    }
+    monitor.dumpMonitoredMetadata(fileno(file));
+    rewind(file);
+    std::string output;
+    char buffer[256];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        output.append(buffer, count);
+    }
+    fclose(file);
+    return output;
+}
+
+// Returns the event log, oldest first, as "f<frame> REQ:<section>.<tag>", with " (Removed)"
+// appended for removals
+static std::vector<std::string> events(TagMonitor &monitor) {
+    std::string output = dump(monitor);
+    std::vector<std::string> events;
+    size_t start = 0;
+    while (start < output.size()) {
+        size_t end = output.find('\n', start);
+        if (end == std::string::npos) end = output.size();
+        std::string line = output.substr(start, end - start);
+        start = end + 1;
+
+        unsigned frame;
+        size_t source = line.find("REQ:");
+        if (source == std::string::npos) source = line.find("RES:");
+        if (sscanf(line.c_str(), " f%u:", &frame) != 1 || source == std::string::npos) {
+            continue;
+        }
+        size_t tagEnd = line.find(':', source + 4);
+        std::string event = "f" + std::to_string(frame) + " " +
+                line.substr(source, tagEnd - source);
+        if (line.find("(Removed)", tagEnd) != std::string::npos) {
+            event += " (Removed)";
+        }
+        // The log is dumped newest first
+        events.insert(events.begin(), event);
+    }
+    return events;
+}
+
+// A request with the two monitored control modes and two other tags
+static CameraMetadata makeRequest(uint8_t aeMode, uint8_t afMode) {
+    CameraMetadata request;
+    request.update(ANDROID_CONTROL_AE_MODE, &aeMode, 1);
+    request.update(ANDROID_CONTROL_AF_MODE, &afMode, 1);
+    const uint8_t flashMode = ANDROID_FLASH_MODE_OFF;
+    request.update(ANDROID_FLASH_MODE, &flashMode, 1);
+    const int64_t exposureTime = 10000000;
+    request.update(ANDROID_SENSOR_EXPOSURE_TIME, &exposureTime, 1);
+    return request;
+}
+
+// Frame 1 sets both modes, frame 2 repeats them, frame 3 changes the AE mode, and frame 4
+// drops the AF mode; returns the resulting event log
+static std::vector<std::string> runModeSequence(const char *tagNames) {
+    TagMonitor monitor;
+    monitor.parseTagsToMonitor(String8(tagNames));
+
+    monitor.monitorMetadata(TagMonitor::REQUEST, 1, 1000,
+            makeRequest(ANDROID_CONTROL_AE_MODE_ON, ANDROID_CONTROL_AF_MODE_AUTO));
+    monitor.monitorMetadata(TagMonitor::REQUEST, 2, 2000,
+            makeRequest(ANDROID_CONTROL_AE_MODE_ON, ANDROID_CONTROL_AF_MODE_AUTO));
+    monitor.monitorMetadata(TagMonitor::REQUEST, 3, 3000,
+            makeRequest(ANDROID_CONTROL_AE_MODE_OFF, ANDROID_CONTROL_AF_MODE_AUTO));
+    CameraMetadata request =
+            makeRequest(ANDROID_CONTROL_AE_MODE_OFF, ANDROID_CONTROL_AF_MODE_AUTO);
+    request.erase(ANDROID_CONTROL_AF_MODE);
+    monitor.monitorMetadata(TagMonitor::REQUEST, 4, 4000, request);
+
+    return events(monitor);
+}
+
+static const std::vector<std::string> kModeSequenceEvents = {
+    "f1 REQ:android.control.aeMode",
+    "f1 REQ:android.control.afMode",
+    "f3 REQ:android.control.aeMode",
+    "f4 REQ:android.control.afMode (Removed)",
+};
+
+TEST(TagMonitorTest, SectionWildcard) {
+    TagMonitor monitor;
+    monitor.parseTagsToMonitor(String8("android.flash.*"));
+    std::string output = dump(monitor);
+    EXPECT_NE(std::string::npos, output.find("Tag monitoring enabled"));
+    EXPECT_NE(std::string::npos, output.find("android.flash.mode\n"));
+    EXPECT_NE(std::string::npos, output.find("android.flash.firingPower\n"));
+    EXPECT_EQ(std::string::npos, output.find("android.control."));
+
+    // Wildcards mix with single tags, and duplicates are monitored once
+    monitor.parseTagsToMonitor(String8("android.flash.mode, android.flash.*"));
+    output = dump(monitor);
+    size_t first = output.find("android.flash.mode\n");
+    ASSERT_NE(std::string::npos, first);
+    EXPECT_EQ(std::string::npos, output.find("android.flash.mode\n", first + 1));
+}
+
+TEST(TagMonitorTest, UnknownSectionKeepsCurrentTags) {
+    TagMonitor monitor;
+    monitor.parseTagsToMonitor(String8("android.nosuchsection.*"));
+    EXPECT_NE(std::string::npos, dump(monitor).find("Tag monitoring disabled"));
+
+    monitor.parseTagsToMonitor(String8("android.control.aeMode"));
+    monitor.parseTagsToMonitor(String8("android.nosuchsection.*"));
+    std::string output = dump(monitor);
+    EXPECT_NE(std::string::npos, output.find("Tag monitoring enabled"));
+    EXPECT_NE(std::string::npos, output.find("android.control.aeMode\n"));
+}
+
+// Fewer monitored tags than metadata entries: each monitored tag is looked up
+TEST(TagMonitorTest, LookupDiff) {
+    EXPECT_EQ(kModeSequenceEvents,
+            runModeSequence("android.control.aeMode, android.control.afMode"));
+}
+
+// More monitored tags than metadata entries: the metadata is walked once, and tags not seen
+// in the walk are reported as removed
+TEST(TagMonitorTest, WalkDiff) {
+    EXPECT_EQ(kModeSequenceEvents, runModeSequence("android.control.*"));
+}
+
+TEST(TagMonitorTest, RequestsAndResultsAreDiffedSeparately) {
+    TagMonitor monitor;
+    monitor.parseTagsToMonitor(String8("android.control.aeMode"));
+    CameraMetadata metadata =
+            makeRequest(ANDROID_CONTROL_AE_MODE_ON, ANDROID_CONTROL_AF_MODE_AUTO);
+    monitor.monitorMetadata(TagMonitor::REQUEST, 1, 1000, metadata);
+    monitor.monitorMetadata(TagMonitor::RESULT, 1, 1500, metadata);
+    monitor.monitorMetadata(TagMonitor::REQUEST, 2, 2000, metadata);
+    monitor.monitorMetadata(TagMonitor::RESULT, 2, 2500, metadata);
+
+    std::vector<std::string> expected = {
+        "f1 REQ:android.control.aeMode",
+        "f1 RES:android.control.aeMode",
+    };
+    EXPECT_EQ(expected, events(monitor));
+}
+
+// Changing the tag list resizes the per-tag state that monitorMetadata() indexes, so it must
+// not race with a concurrent monitorMetadata() (as with dumpsys camera -m during capture)
+TEST(TagMonitorTest, ParseConcurrentWithMonitor) {
+    TagMonitor monitor;
+    monitor.parseTagsToMonitor(String8("android.control.aeMode"));
+    CameraMetadata metadata =
+            makeRequest(ANDROID_CONTROL_AE_MODE_ON, ANDROID_CONTROL_AF_MODE_AUTO);
+
+    std::thread capture([&]() {
+        for (int frame = 0; frame < 2000; frame++) {
+            monitor.monitorMetadata(TagMonitor::REQUEST, frame, 1000 + frame, metadata);
+        }
+    });
+    for (int i = 0; i < 200; i++) {
+        monitor.parseTagsToMonitor(String8(i % 2 ? "android.control.*" :
+                "android.control.aeMode, android.flash.mode"));
+    }
+    capture.join();
+    EXPECT_NE(std::string::npos, dump(monitor).find("Tag monitoring enabled"));
+}
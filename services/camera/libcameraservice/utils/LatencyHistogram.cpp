@@ -46,7 +46,7 @@ void CameraLatencyHistogram::add(nsecs_t start, nsecs_t end) {
 }
 
 void CameraLatencyHistogram::reset() {
-    mBins.clear();
+    mBins.assign(mBinCount, 0);
     mTotalCount = 0;
 }
 
@@ -103,4 +103,75 @@ void CameraLatencyHistogram::formatHistogramText(
     lineBinCounts.append(" (%)");
 }
 
+CameraLogLatencyHistogram::CameraLogLatencyHistogram() {
+    reset();
+}
+
+void CameraLogLatencyHistogram::add(nsecs_t duration) {
+    uint64_t durationUs = duration > 0 ? static_cast<uint64_t>(duration / 1000) : 0;
+    size_t bin = 0;
+    while (bin < kBinCount - 1 && (durationUs >> (bin + 1)) != 0) {
+        bin++;
+    }
+    mBins[bin].fetch_add(1, std::memory_order_relaxed);
+    mTotalUs.fetch_add(durationUs, std::memory_order_relaxed);
+    mTotalCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CameraLogLatencyHistogram::reset() {
+    for (size_t i = 0; i < kBinCount; i++) {
+        mBins[i].store(0, std::memory_order_relaxed);
+    }
+    mTotalCount.store(0, std::memory_order_relaxed);
+    mTotalUs.store(0, std::memory_order_relaxed);
+}
+
+uint64_t CameraLogLatencyHistogram::percentileUs(uint64_t total, uint64_t counts[],
+        double percentile) const {
+    uint64_t target = static_cast<uint64_t>(total * percentile);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBinCount; i++) {
+        seen += counts[i];
+        if (seen > target) {
+            return 2ULL << i;
+        }
+    }
+    return 2ULL << (kBinCount - 1);
+}
+
+void CameraLogLatencyHistogram::dump(int fd, const char* name) const {
+    // Snapshot the bins; concurrent adds may make the total slightly inconsistent
+    uint64_t counts[kBinCount];
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBinCount; i++) {
+        counts[i] = mBins[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return;
+    }
+
+    String8 lines;
+    lines.appendFormat("%s (%" PRIu64 ") samples: mean %" PRIu64 " us, p50 < %" PRIu64
+            " us, p90 < %" PRIu64 " us, p99 < %" PRIu64 " us\n", name, total,
+            mTotalUs.load(std::memory_order_relaxed) / total,
+            percentileUs(total, counts, 0.5), percentileUs(total, counts, 0.9),
+            percentileUs(total, counts, 0.99));
+    write(fd, lines.string(), lines.size());
+}
+
+void CameraLogLatencyHistogram::dumpCsv(int fd, const char* name) const {
+    if (count() == 0) {
+        return;
+    }
+    String8 line;
+    line.appendFormat("%s,%" PRIu64 ",%" PRIu64, name, count(),
+            mTotalUs.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < kBinCount; i++) {
+        line.appendFormat(",%" PRIu64, mBins[i].load(std::memory_order_relaxed));
+    }
+    line.append("\n");
+    write(fd, line.string(), line.size());
+}
+
 }; //namespace android
@@ -17,6 +17,7 @@
 #ifndef ANDROID_SERVERS_CAMERA_LATENCY_HISTOGRAM_H_
 #define ANDROID_SERVERS_CAMERA_LATENCY_HISTOGRAM_H_
 
+#include <atomic>
 #include <vector>
 
 #include <utils/Timers.h>
@@ -43,6 +44,32 @@ private:
     void formatHistogramText(String8& lineBins, String8& lineBinCounts) const;
 }; // class CameraLatencyHistogram
 
+// Latency histogram with power-of-two microsecond bins, covering 1 us to several
+// seconds without tuning. Samples can be added from any thread without locking.
+class CameraLogLatencyHistogram {
+public:
+    // Bin 0 counts durations under 2 us, bin i in [2^i, 2^(i+1)) us, and the last bin
+    // everything longer.
+    static const size_t kBinCount = 24;
+
+    CameraLogLatencyHistogram();
+    void add(nsecs_t duration);
+    void reset();
+    uint64_t count() const { return mTotalCount.load(std::memory_order_relaxed); }
+
+    // Human-readable summary with percentile estimates
+    void dump(int fd, const char* name) const;
+    // One line per histogram for scripts: "name,count,sum_us,bin0,bin1,..."
+    void dumpCsv(int fd, const char* name) const;
+private:
+    std::atomic<uint64_t> mBins[kBinCount];
+    std::atomic<uint64_t> mTotalCount;
+    std::atomic<uint64_t> mTotalUs;
+
+    // Upper bound in us of the bin containing the given percentile
+    uint64_t percentileUs(uint64_t total, uint64_t counts[], double percentile) const;
+}; // class CameraLogLatencyHistogram
+
 }; // namespace android
 
 #endif // ANDROID_SERVERS_CAMERA_LATENCY_HISTOGRAM_H_
@@ -20,6 +20,7 @@
 
 #include "TagMonitor.h"
 
+#include <algorithm>
 #include <inttypes.h>
 #include <utils/Log.h>
 #include <camera/VendorTagDescriptor.h>
@@ -31,7 +32,11 @@ TagMonitor::TagMonitor():
         mMonitoringEnabled(false),
         mMonitoringEvents(kMaxMonitorEvents),
         mVendorTagId(CAMERA_METADATA_INVALID_VENDOR_ID)
-{}
+{
+    for (auto& event : mMonitoringEvents) {
+        event.newData.reserve(kEventDataReserve);
+    }
+}
 
 const char* TagMonitor::k3aTags =
         "android.control.aeMode, android.control.afMode, android.control.awbMode,"
@@ -44,8 +49,6 @@ const char* TagMonitor::k3aTags =
         "android.control.videoStabilizationMode";
 
 void TagMonitor::parseTagsToMonitor(String8 tagNames) {
-    std::lock_guard<std::mutex> lock(mMonitorMutex);
-
     // Expand shorthands
     if (ssize_t idx = tagNames.find("3a") != -1) {
         ssize_t end = tagNames.find(",", idx);
@@ -65,38 +68,125 @@ void TagMonitor::parseTagsToMonitor(String8 tagNames) {
         }
     }
 
+    // Build the new list aside; monitorMetadata() indexes the per-tag state by position in
+    // mMonitoredTagList, so the list and the state are only replaced together, under the lock
     bool gotTag = false;
+    std::vector<uint32_t> tags;
 
     char *tokenized = tagNames.lockBuffer(tagNames.size());
     char *savePtr;
     char *nextTagName = strtok_r(tokenized, ", ", &savePtr);
     while (nextTagName != nullptr) {
-        uint32_t tag;
-        status_t res = CameraMetadata::getTagFromName(nextTagName, vTags.get(), &tag);
-        if (res != OK) {
-            ALOGW("%s: Unknown tag %s, ignoring", __FUNCTION__, nextTagName);
+        size_t nameLength = strlen(nextTagName);
+        if (nameLength > 2 && strcmp(nextTagName + nameLength - 2, ".*") == 0) {
+            // Wildcard for a whole section
+            nextTagName[nameLength - 2] = '\0';
+            if (addSectionTags(nextTagName, vTags.get(), &tags)) {
+                gotTag = true;
+            } else {
+                ALOGW("%s: Unknown section %s, ignoring", __FUNCTION__, nextTagName);
+            }
         } else {
-            if (!gotTag) {
-                mMonitoredTagList.clear();
+            uint32_t tag;
+            status_t res = CameraMetadata::getTagFromName(nextTagName, vTags.get(), &tag);
+            if (res != OK) {
+                ALOGW("%s: Unknown tag %s, ignoring", __FUNCTION__, nextTagName);
+            } else {
+                tags.push_back(tag);
                 gotTag = true;
             }
-            mMonitoredTagList.push_back(tag);
         }
         nextTagName = strtok_r(nullptr, ", ", &savePtr);
     }
 
     tagNames.unlockBuffer();
 
-    if (gotTag) {
-        // Got at least one new tag
-        mMonitoringEnabled = true;
+    if (!gotTag) return;
+
+    // Got at least one new tag
+    std::sort(tags.begin(), tags.end());
+    tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+
+    std::lock_guard<std::mutex> lock(mMonitorMutex);
+    mMonitoredTagList.swap(tags);
+    mLastRequestValues.assign(mMonitoredTagList.size(), TagState());
+    mLastResultValues.assign(mMonitoredTagList.size(), TagState());
+    mMonitoringEnabled = true;
+}
+
+bool TagMonitor::addSectionTags(const char *sectionName, const VendorTagDescriptor *vTags,
+        std::vector<uint32_t> *tags) {
+    for (size_t section = 0; section < ANDROID_SECTION_COUNT; section++) {
+        if (strcmp(sectionName, camera_metadata_section_names[section]) == 0) {
+            for (uint32_t tag = camera_metadata_section_bounds[section][0];
+                    tag < camera_metadata_section_bounds[section][1]; tag++) {
+                tags->push_back(tag);
+            }
+            return true;
+        }
+    }
+
+    if (vTags == nullptr || vTags->getTagCount() <= 0) return false;
+    std::vector<uint32_t> vendorTags(vTags->getTagCount());
+    vTags->getTagArray(vendorTags.data());
+    bool found = false;
+    for (uint32_t tag : vendorTags) {
+        const char *tagSection = vTags->getSectionName(tag);
+        if (tagSection != nullptr && strcmp(sectionName, tagSection) == 0) {
+            tags->push_back(tag);
+            found = true;
+        }
     }
+    return found;
 }
 
 void TagMonitor::disableMonitoring() {
+    std::lock_guard<std::mutex> lock(mMonitorMutex);
     mMonitoringEnabled = false;
-    mLastMonitoredRequestValues.clear();
-    mLastMonitoredResultValues.clear();
+    mLastRequestValues.assign(mMonitoredTagList.size(), TagState());
+    mLastResultValues.assign(mMonitoredTagList.size(), TagState());
+}
+
+uint64_t TagMonitor::hashEntry(const camera_metadata_ro_entry &entry) {
+    // 64-bit FNV-1a over the raw value bytes
+    const uint8_t *data = entry.data.u8;
+    size_t size = camera_metadata_type_size[entry.type] * entry.count;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+void TagMonitor::updateTagLocked(eventSource source, uint32_t frameNumber, nsecs_t timestamp,
+        const camera_metadata_ro_entry &entry, TagState *state) {
+    if (entry.count > 0) {
+        uint64_t hash = hashEntry(entry);
+        // A changed count or type, or no last value, is always a change
+        if (state->present && state->type == entry.type && state->count == entry.count &&
+                state->hash == hash) {
+            return;
+        }
+        ALOGV("%s: Tag %s changed", __FUNCTION__,
+              get_local_camera_metadata_tag_name_vendor_id(
+                      entry.tag, mVendorTagId));
+        state->present = true;
+        state->type = entry.type;
+        state->count = entry.count;
+        state->hash = hash;
+    } else if (state->present) {
+        // Value has been removed
+        ALOGV("%s: Tag %s removed", __FUNCTION__,
+              get_local_camera_metadata_tag_name_vendor_id(
+                      entry.tag, mVendorTagId));
+        state->present = false;
+    } else {
+        return;
+    }
+
+    mMonitoringEvents[mMonitoringEventFront].set(source, frameNumber, timestamp, entry);
+    mMonitoringEventFront = (mMonitoringEventFront + 1) % kMaxMonitorEvents;
+    if (mMonitoringEventCount < kMaxMonitorEvents) mMonitoringEventCount++;
 }
 
 void TagMonitor::monitorMetadata(eventSource source, int64_t frameNumber, nsecs_t timestamp,
@@ -109,63 +199,52 @@ void TagMonitor::monitorMetadata(eventSource source, int64_t frameNumber, nsecs_
         timestamp = systemTime(SYSTEM_TIME_BOOTTIME);
     }
 
-    for (auto tag : mMonitoredTagList) {
-        camera_metadata_ro_entry entry = metadata.find(tag);
-        CameraMetadata &lastValues = (source == REQUEST) ?
-                mLastMonitoredRequestValues : mLastMonitoredResultValues;
-        if (lastValues.isEmpty()) {
-            lastValues = CameraMetadata(mMonitoredTagList.size());
-            const camera_metadata_t *metaBuffer =
-                    lastValues.getAndLock();
-            set_camera_metadata_vendor_id(
-                    const_cast<camera_metadata_t *> (metaBuffer), mVendorTagId);
-            lastValues.unlock(metaBuffer);
-        }
-
-        camera_metadata_entry lastEntry = lastValues.find(tag);
-
-        if (entry.count > 0) {
-            bool isDifferent = false;
-            if (lastEntry.count > 0) {
-                // Have a last value, compare to see if changed
-                if (lastEntry.type == entry.type &&
-                        lastEntry.count == entry.count) {
-                    // Same type and count, compare values
-                    size_t bytesPerValue = camera_metadata_type_size[lastEntry.type];
-                    size_t entryBytes = bytesPerValue * lastEntry.count;
-                    int cmp = memcmp(entry.data.u8, lastEntry.data.u8, entryBytes);
-                    if (cmp != 0) {
-                        isDifferent = true;
-                    }
-                } else {
-                    // Count or type has changed
-                    isDifferent = true;
-                }
-            } else {
-                // No last entry, so always consider to be different
-                isDifferent = true;
+    std::vector<TagState> &lastValues = (source == REQUEST) ?
+            mLastRequestValues : mLastResultValues;
+    const camera_metadata_t *buffer = metadata.getAndLock();
+    size_t entryCount = (buffer != nullptr) ? get_camera_metadata_entry_count(buffer) : 0;
+
+    if (mMonitoredTagList.size() <= entryCount) {
+        // Few tags compared to the metadata size (e.g. "3a"): look each one up
+        for (size_t i = 0; i < mMonitoredTagList.size(); i++) {
+            camera_metadata_ro_entry entry = camera_metadata_ro_entry();
+            if (buffer == nullptr ||
+                    find_camera_metadata_ro_entry(buffer, mMonitoredTagList[i], &entry) != OK) {
+                entry.count = 0;
             }
-
-            if (isDifferent) {
-                ALOGV("%s: Tag %s changed", __FUNCTION__,
-                      get_local_camera_metadata_tag_name_vendor_id(
-                              tag, mVendorTagId));
-                lastValues.update(entry);
-                mMonitoringEvents.emplace(source, frameNumber, timestamp, entry);
+            entry.tag = mMonitoredTagList[i];
+            if (entry.count == 0) {
+                entry.type = get_local_camera_metadata_tag_type_vendor_id(entry.tag,
+                        mVendorTagId);
+            }
+            updateTagLocked(source, frameNumber, timestamp, entry, &lastValues[i]);
+        }
+    } else {
+        // Many tags (e.g. wildcards): walk the metadata once, then catch removals
+        uint32_t scan = ++mScanCount;
+        for (size_t i = 0; i < entryCount; i++) {
+            camera_metadata_ro_entry entry;
+            if (get_camera_metadata_ro_entry(buffer, i, &entry) != OK) continue;
+            auto it = std::lower_bound(mMonitoredTagList.begin(), mMonitoredTagList.end(),
+                    entry.tag);
+            if (it == mMonitoredTagList.end() || *it != entry.tag) continue;
+            TagState &state = lastValues[it - mMonitoredTagList.begin()];
+            state.lastScan = scan;
+            updateTagLocked(source, frameNumber, timestamp, entry, &state);
+        }
+        for (size_t i = 0; i < mMonitoredTagList.size(); i++) {
+            TagState &state = lastValues[i];
+            if (state.present && state.lastScan != scan) {
+                camera_metadata_ro_entry entry = camera_metadata_ro_entry();
+                entry.tag = mMonitoredTagList[i];
+                entry.type = get_local_camera_metadata_tag_type_vendor_id(entry.tag,
+                        mVendorTagId);
+                updateTagLocked(source, frameNumber, timestamp, entry, &state);
             }
-        } else if (lastEntry.count > 0) {
-            // Value has been removed
-            ALOGV("%s: Tag %s removed", __FUNCTION__,
-                  get_local_camera_metadata_tag_name_vendor_id(
-                          tag, mVendorTagId));
-            lastValues.erase(tag);
-            entry.tag = tag;
-            entry.type = get_local_camera_metadata_tag_type_vendor_id(tag,
-                    mVendorTagId);
-            entry.count = 0;
-            mMonitoringEvents.emplace(source, frameNumber, timestamp, entry);
         }
     }
+
+    metadata.unlock(buffer);
 }
 
 void TagMonitor::dumpMonitoredMetadata(int fd) {
@@ -183,9 +262,12 @@ void TagMonitor::dumpMonitoredMetadata(int fd) {
     } else {
         dprintf(fd, "     Tag monitoring disabled (enable with -m <name1,..,nameN>)\n");
     }
-    if (mMonitoringEvents.size() > 0) {
+    if (mMonitoringEventCount > 0) {
         dprintf(fd, "     Monitored tag event log:\n");
-        for (const auto& event : mMonitoringEvents) {
+        // Newest first
+        for (size_t i = 1; i <= mMonitoringEventCount; i++) {
+            const MonitorEvent& event = mMonitoringEvents[
+                    (mMonitoringEventFront + kMaxMonitorEvents - i) % kMaxMonitorEvents];
             int indentation = (event.source == REQUEST) ? 15 : 30;
             dprintf(fd, "        f%d:%" PRId64 "ns: %*s%s.%s: ",
                     event.frameNumber, event.timestamp,
@@ -291,18 +373,15 @@ void TagMonitor::printData(int fd, const uint8_t *data_ptr, uint32_t tag,
     }
 }
 
-template<typename T>
-TagMonitor::MonitorEvent::MonitorEvent(eventSource src, uint32_t frameNumber, nsecs_t timestamp,
-        const T &value) :
-        source(src),
-        frameNumber(frameNumber),
-        timestamp(timestamp),
-        tag(value.tag),
-        type(value.type),
-        newData(value.data.u8, value.data.u8 + camera_metadata_type_size[value.type] * value.count) {
-}
-
-TagMonitor::MonitorEvent::~MonitorEvent() {
+void TagMonitor::MonitorEvent::set(eventSource src, uint32_t frameNumber, nsecs_t timestamp,
+        const camera_metadata_ro_entry &value) {
+    source = src;
+    this->frameNumber = frameNumber;
+    this->timestamp = timestamp;
+    tag = value.tag;
+    type = value.type;
+    newData.assign(value.data.u8,
+            value.data.u8 + camera_metadata_type_size[value.type] * value.count);
 }
 
 } // namespace android
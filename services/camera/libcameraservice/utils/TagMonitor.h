@@ -25,17 +25,22 @@
 #include <utils/String8.h>
 #include <utils/Timers.h>
 
-#include <media/RingBuffer.h>
 #include <system/camera_metadata.h>
 #include <system/camera_vendor_tags.h>
 #include <camera/CameraMetadata.h>
 
 namespace android {
 
+class VendorTagDescriptor;
+
 /**
  * A monitor for camera metadata values.
  * Tracks changes to specified metadata values over time, keeping a circular
- * buffer log that can be dumped at will. */
+ * buffer log that can be dumped at will.
+ *
+ * Cheap enough to leave enabled at high frame rates: only a hash of each
+ * monitored value is kept between frames, and events are recorded into
+ * preallocated slots whose storage is reused once the log wraps. */
 class TagMonitor {
   public:
     enum eventSource {
@@ -50,7 +55,8 @@ class TagMonitor {
     // Parse tag name list (comma-separated) and if valid, enable monitoring
     // If invalid, do nothing.
     // Recognizes "3a" as a shortcut for enabling tracking 3A state, mode, and
-    // triggers
+    // triggers, and "<section>.*" for all tags in a section, e.g.
+    // "android.control.*"
     void parseTagsToMonitor(String8 tagNames);
 
     // Disable monitoring; does not clear the event log
@@ -68,38 +74,63 @@ class TagMonitor {
     static void printData(int fd, const uint8_t *data_ptr, uint32_t tag,
             int type, int count, int indentation);
 
+    // Add all tags of the named section to tags; returns false if there is no
+    // such section
+    static bool addSectionTags(const char *sectionName, const VendorTagDescriptor *vTags,
+            std::vector<uint32_t> *tags);
+
+    static uint64_t hashEntry(const camera_metadata_ro_entry &entry);
+
     std::atomic<bool> mMonitoringEnabled;
     std::mutex mMonitorMutex;
 
-    // Current tags to monitor and record changes to
+    // Current tags to monitor and record changes to, sorted and without duplicates
     std::vector<uint32_t> mMonitoredTagList;
 
-    // Latest-seen values of tracked tags
-    CameraMetadata mLastMonitoredRequestValues;
-    CameraMetadata mLastMonitoredResultValues;
+    // Summary of the latest-seen value of a tracked tag, parallel to
+    // mMonitoredTagList
+    struct TagState {
+        bool present = false;
+        uint8_t type = 0;
+        uint32_t count = 0;
+        uint64_t hash = 0;
+        // Scan in which the tag was last found, to detect removals when walking
+        // the metadata instead of looking up each tag
+        uint32_t lastScan = 0;
+    };
+    std::vector<TagState> mLastRequestValues;
+    std::vector<TagState> mLastResultValues;
+    uint32_t mScanCount = 0;
+
+    // Compare one entry against its last state, and log an event if it changed
+    void updateTagLocked(eventSource source, uint32_t frameNumber, nsecs_t timestamp,
+            const camera_metadata_ro_entry &entry, TagState *state);
 
     /**
      * A monitoring event
      * Stores a new metadata field value and the timestamp at which it changed.
-     * Copies the source metadata value array and frees it on destruct.
+     * Events live in preallocated slots; recording into a slot reuses the
+     * capacity of its data vector.
      */
     struct MonitorEvent {
-        template<typename T>
-        MonitorEvent(eventSource src, uint32_t frameNumber, nsecs_t timestamp,
-                const T &newValue);
-        ~MonitorEvent();
-
-        eventSource source;
-        uint32_t frameNumber;
-        nsecs_t timestamp;
-        uint32_t tag;
-        uint8_t type;
+        void set(eventSource src, uint32_t frameNumber, nsecs_t timestamp,
+                const camera_metadata_ro_entry &newValue);
+
+        eventSource source = REQUEST;
+        uint32_t frameNumber = 0;
+        nsecs_t timestamp = 0;
+        uint32_t tag = 0;
+        uint8_t type = 0;
         std::vector<uint8_t> newData;
     };
 
-    // A ring buffer for tracking the last kMaxMonitorEvents metadata changes
-    static const int kMaxMonitorEvents = 100;
-    RingBuffer<MonitorEvent> mMonitoringEvents;
+    // A circular log of the last kMaxMonitorEvents metadata changes
+    static const size_t kMaxMonitorEvents = 100;
+    // Initial storage per event, enough for 3A regions and most scalar tags
+    static const size_t kEventDataReserve = 64;
+    std::vector<MonitorEvent> mMonitoringEvents;
+    size_t mMonitoringEventFront = 0; // Slot for the next event
+    size_t mMonitoringEventCount = 0;
 
     // 3A fields to use with the "3a" option
     static const char *k3aTags;
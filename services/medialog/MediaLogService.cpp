@@ -52,9 +52,22 @@ void MediaLogService::registerWriter(const sp<IMemory>& shared, size_t size, con
             shared->size() < NBLog::Timeline::sharedSize(size)) {
         return;
     }
+    // A NBLog::MultiWriter registers a whole number of segments, each with its own FIFO.
+    // Its segments are merged by timestamp by a MultiReader when dumping.
+    size_t segments = shared->size() / NBLog::Timeline::sharedSize(size);
+    if (segments > kMaxSegments) {
+        segments = kMaxSegments;
+    }
+    Mutex::Autolock _l(mLock);
+    if (segments > 1) {
+        sp<NBLog::Reader> reader(new NBLog::MultiReader(shared, size, segments));
+        NBLog::NamedReader namedReader(reader, name);
+        mNamedReaders.add(namedReader);
+        mMultiReaders.add(namedReader);
+        return;
+    }
     sp<NBLog::Reader> reader(new NBLog::Reader(shared, size));
     NBLog::NamedReader namedReader(reader, name);
-    Mutex::Autolock _l(mLock);
     mNamedReaders.add(namedReader);
     mMerger.addReader(namedReader);
 }
@@ -72,6 +85,13 @@ void MediaLogService::unregisterWriter(const sp<IMemory>& shared)
             i++;
         }
     }
+    for (size_t i = 0; i < mMultiReaders.size(); ) {
+        if (mMultiReaders[i].reader()->isIMemory(shared)) {
+            mMultiReaders.removeAt(i);
+        } else {
+            i++;
+        }
+    }
 }
 
 bool MediaLogService::dumpTryLock(Mutex& mutex)
@@ -133,6 +153,25 @@ status_t MediaLogService::dump(int fd, const Vector<String16>& args __unused)
 
     // FIXME request merge to make sure log is up to date
     mMergeReader.dump(fd);
+
+    // needed because mMultiReaders is protected by mLock
+    if (!dumpTryLock(mLock)) {
+        if (fd >= 0) {
+            write(fd, kDeadlockedString, strlen(kDeadlockedString));
+        } else {
+            ALOGW("%s:", kDeadlockedString);
+        }
+        return NO_ERROR;
+    }
+    for (const auto& multiReader : mMultiReaders) {
+        if (fd >= 0) {
+            dprintf(fd, "\n%s:\n", multiReader.name());
+        } else {
+            ALOGI("%s:", multiReader.name());
+        }
+        multiReader.reader()->dump(fd);
+    }
+    mLock.unlock();
     return NO_ERROR;
 }
 
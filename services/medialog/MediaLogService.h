@@ -35,6 +35,8 @@ public:
 
     static const size_t kMinSize = 0x100;
     static const size_t kMaxSize = 0x10000;
+    // maximum number of segments of a writer, see NBLog::MultiWriter
+    static const size_t kMaxSegments = 16;
     virtual void        registerWriter(const sp<IMemory>& shared, size_t size, const char *name);
     virtual void        unregisterWriter(const sp<IMemory>& shared);
 
@@ -56,6 +58,9 @@ private:
     Mutex               mLock;
 
     Vector<NBLog::NamedReader> mNamedReaders;   // protected by mLock
+    // writers with several segments, each read by a NBLog::MultiReader which merges the
+    // segments while dumping instead of copying them through mMerger; protected by mLock
+    Vector<NBLog::NamedReader> mMultiReaders;
 
     // FIXME Need comments on all of these, especially about locking
     NBLog::Shared *mMergerShared;
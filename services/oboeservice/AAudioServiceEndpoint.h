@@ -73,6 +73,20 @@ public:
 
     virtual AudioStreamInternal *getStreamInternal() = 0;
 
+    /**
+     * @return ring buffer that all shared streams read from, or nullptr if each stream
+     *         has its own, e.g. for output
+     */
+    virtual SharedRingBuffer *getSharedRingBuffer() { return nullptr; }
+
+    /**
+     * Position and time of the most recent transfer to the shared ring buffer.
+     */
+    virtual aaudio_result_t getFreeRunningPosition(int64_t * /*positionFrames*/,
+                                                   int64_t * /*timeNanos*/) {
+        return AAUDIO_ERROR_UNIMPLEMENTED;
+    }
+
     std::atomic<bool>        mCallbackEnabled{false};
 
     mutable std::mutex       mLockStreams;
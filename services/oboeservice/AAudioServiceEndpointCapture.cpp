@@ -34,36 +34,81 @@
 using namespace android;  // TODO just import names needed
 using namespace aaudio;   // TODO just import names needed
 
+// Capacity of the ring shared by all clients, in bursts.
+// This is the same as the default capacity of a shared stream.  The ring is allocated when
+// the endpoint opens and clients map it directly, so it cannot grow for a later client.
+// Every shared capture stream therefore gets this capacity regardless of the capacity it
+// requested; AAudioServiceStreamShared::open() logs a clamp and reports the actual capacity
+// back to the client.
+#define BURSTS_PER_CAPTURE_RING   16
+
 AAudioServiceEndpointCapture::AAudioServiceEndpointCapture(AAudioService &audioService)
         : mStreamInternalCapture(audioService, true) {
 }
 
 AAudioServiceEndpointCapture::~AAudioServiceEndpointCapture() {
-    delete mDistributionBuffer;
+    delete mCaptureRing;
 }
 
 aaudio_result_t AAudioServiceEndpointCapture::open(const AAudioStreamConfiguration& configuration) {
     aaudio_result_t result = AAudioServiceEndpoint::open(configuration);
     if (result == AAUDIO_OK) {
-        delete mDistributionBuffer;
-        int distributionBufferSizeBytes = getStreamInternal()->getFramesPerBurst()
-                                          * getStreamInternal()->getBytesPerFrame();
-        mDistributionBuffer = new uint8_t[distributionBufferSizeBytes];
+        delete mCaptureRing;
+        // The capacity is a whole number of bursts so that a burst never wraps.
+        mCaptureRing = new SharedRingBuffer();
+        result = mCaptureRing->allocate(getStreamInternal()->getBytesPerFrame(),
+                                        BURSTS_PER_CAPTURE_RING * getFramesPerBurst());
+        if (result == AAUDIO_OK) {
+            // Clients only read the data, at their own read counters.
+            result = mCaptureRing->protectFromClients();
+        }
+        if (result != AAUDIO_OK) {
+            ALOGE("AAudioServiceEndpointCapture::open() could not allocate capture ring, %d",
+                  result);
+            delete mCaptureRing;
+            mCaptureRing = nullptr;
+            close();
+        }
     }
     return result;
 }
 
-// Read data from the shared MMAP stream and then distribute it to the client streams.
+aaudio_result_t AAudioServiceEndpointCapture::getFreeRunningPosition(int64_t *positionFrames,
+                                                                   int64_t *timeNanos) {
+    static const int kMaxTries = 5;
+    for (int tries = 0; tries < kMaxTries; tries++) {
+        uint32_t before = mMarkedSequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        int64_t position = mMarkedPosition.load(std::memory_order_relaxed);
+        int64_t time = mMarkedTime.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mMarkedSequence.load(std::memory_order_relaxed) == before) {
+            *positionFrames = position;
+            *timeNanos = time;
+            return AAUDIO_OK;
+        }
+    }
+    return AAUDIO_ERROR_UNAVAILABLE;
+}
+
+// Read data from the shared MMAP stream directly into the ring that the client streams read from.
+// No copy per client and no lock are needed, the clients just see the write counter advance.
 void *AAudioServiceEndpointCapture::callbackLoop() {
     ALOGD("AAudioServiceEndpointCapture(): callbackLoop() entering");
-    int32_t underflowCount = 0;
     aaudio_result_t result = AAUDIO_OK;
     int64_t timeoutNanos = getStreamInternal()->calculateReasonableTimeout();
+    FifoBuffer *fifo = mCaptureRing->getFifoBuffer();
+    const int32_t capacityInFrames = fifo->getBufferCapacityInFrames();
+    uint8_t *data = mCaptureRing->getDataAddress();
 
     // result might be a frame count
     while (mCallbackEnabled.load() && getStreamInternal()->isActive() && (result >= 0)) {
         // Read audio data from stream using a blocking read.
-        result = getStreamInternal()->read(mDistributionBuffer, getFramesPerBurst(), timeoutNanos);
+        fifo_counter_t writeCounter = fifo->getWriteCounter();
+        uint8_t *burst = data + fifo->convertFramesToBytes(writeCounter % capacityInFrames);
+        result = getStreamInternal()->read(burst, getFramesPerBurst(), timeoutNanos);
         if (result == AAUDIO_ERROR_DISCONNECTED) {
             disconnectRegisteredStreams();
             break;
@@ -73,24 +118,18 @@ void *AAudioServiceEndpointCapture::callbackLoop() {
             break;
         }
 
-        // Distribute data to each active stream.
-        { // use lock guard
-            std::lock_guard <std::mutex> lock(mLockStreams);
-            for (sp<AAudioServiceStreamShared> sharedStream : mRegisteredStreams) {
-                if (sharedStream->isRunning()) {
-                    FifoBuffer *fifo = sharedStream->getDataFifoBuffer();
-                    if (fifo->getFifoControllerBase()->getEmptyFramesAvailable() <
-                        getFramesPerBurst()) {
-                        underflowCount++;
-                    } else {
-                        fifo->write(mDistributionBuffer, getFramesPerBurst());
-                    }
-                    sharedStream->markTransferTime(AudioClock::getNanoseconds());
-                }
-            }
-        }
+        // Publish the burst. Clients that are more than a ring behind will detect the overrun.
+        writeCounter += getFramesPerBurst();
+        fifo->setWriteCounter(writeCounter);
+
+        uint32_t sequence = mMarkedSequence.load(std::memory_order_relaxed);
+        mMarkedSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        mMarkedPosition.store(writeCounter, std::memory_order_relaxed);
+        mMarkedTime.store(AudioClock::getNanoseconds(), std::memory_order_relaxed);
+        mMarkedSequence.store(sequence + 2, std::memory_order_release);
     }
 
-    ALOGD("AAudioServiceEndpointCapture(): callbackLoop() exiting, %d underflows", underflowCount);
+    ALOGD("AAudioServiceEndpointCapture(): callbackLoop() exiting");
     return NULL; // TODO review
 }
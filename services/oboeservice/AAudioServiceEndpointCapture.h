@@ -17,8 +17,11 @@
 #ifndef AAUDIO_SERVICE_ENDPOINT_CAPTURE_H
 #define AAUDIO_SERVICE_ENDPOINT_CAPTURE_H
 
+#include <atomic>
+
 #include "client/AudioStreamInternal.h"
 #include "client/AudioStreamInternalCapture.h"
+#include "SharedRingBuffer.h"
 
 namespace aaudio {
 
@@ -33,11 +36,23 @@ public:
         return &mStreamInternalCapture;
     }
 
+    SharedRingBuffer *getSharedRingBuffer() override {
+        return mCaptureRing;
+    }
+
+    aaudio_result_t getFreeRunningPosition(int64_t *positionFrames, int64_t *timeNanos) override;
+
     void *callbackLoop() override;
 
 private:
     AudioStreamInternalCapture  mStreamInternalCapture;
-    uint8_t                    *mDistributionBuffer = nullptr;
+    // Captured data, read by every shared stream at its own read counter.
+    SharedRingBuffer           *mCaptureRing = nullptr;
+
+    // Even while mMarkedPosition and mMarkedTime are being updated.
+    std::atomic<uint32_t>       mMarkedSequence{0};
+    std::atomic<int64_t>        mMarkedPosition{0};
+    std::atomic<int64_t>        mMarkedTime{0};
 };
 
 } /* namespace aaudio */
@@ -155,7 +155,21 @@ aaudio_result_t AAudioServiceStreamShared::open(const aaudio::AAudioStreamReques
 
     // Create audio data shared memory buffer for client.
     mAudioDataQueue = new SharedRingBuffer();
-    result = mAudioDataQueue->allocate(calculateBytesPerFrame(), mCapacityInFrames);
+    if (mServiceEndpoint->getSharedRingBuffer() != nullptr) {
+        // Capture: read the ring shared by all streams of the endpoint, at our own position.
+        result = mAudioDataQueue->allocateReader(mServiceEndpoint->getSharedRingBuffer());
+        if (result == AAUDIO_OK) {
+            // The ring already exists, so its capacity replaces the one calculated above.
+            int32_t ringCapacity = mAudioDataQueue->getFifoBuffer()->getBufferCapacityInFrames();
+            if (ringCapacity < mCapacityInFrames) {
+                ALOGW("AAudioServiceStreamShared::open() capacity %d clamped to capture ring %d",
+                      mCapacityInFrames, ringCapacity);
+            }
+            mCapacityInFrames = ringCapacity;
+        }
+    } else {
+        result = mAudioDataQueue->allocate(calculateBytesPerFrame(), mCapacityInFrames);
+    }
     if (result != AAUDIO_OK) {
         ALOGE("AAudioServiceStreamShared::open() could not allocate FIFO with %d frames",
               mCapacityInFrames);
@@ -171,6 +185,7 @@ aaudio_result_t AAudioServiceStreamShared::open(const aaudio::AAudioStreamReques
     configurationOutput.setSamplesPerFrame(mSamplesPerFrame);
     configurationOutput.setFormat(mAudioFormat);
     configurationOutput.setDeviceId(mServiceEndpoint->getDeviceId());
+    configurationOutput.setBufferCapacity(mCapacityInFrames);
 
     result = mServiceEndpoint->registerStream(keep);
     if (result != AAUDIO_OK) {
@@ -206,6 +221,11 @@ aaudio_result_t AAudioServiceStreamShared::start()  {
     } else {
         result = endpoint->getStreamInternal()->startClient(mMmapClient, &mClientHandle);
         if (result == AAUDIO_OK) {
+            if (endpoint->getSharedRingBuffer() != nullptr) {
+                // Skip what was captured while we were stopped, as if it was not delivered.
+                FifoBuffer *fifo = mAudioDataQueue->getFifoBuffer();
+                fifo->setReadCounter(fifo->getWriteCounter());
+            }
             result = AAudioServiceStreamBase::start();
         }
     }
@@ -282,16 +302,20 @@ aaudio_result_t AAudioServiceStreamShared::close()  {
         return AAUDIO_ERROR_INVALID_STATE;
     }
 
+    // Detach from the endpoint before tearing down the data queue, and tear that down before
+    // closing the endpoint: for capture the queue reads the endpoint's ring, which is freed
+    // when the last stream closes the endpoint.
     endpoint->unregisterStream(this);
 
-    AAudioEndpointManager &mEndpointManager = AAudioEndpointManager::getInstance();
-    mEndpointManager.closeEndpoint(endpoint);
-    mServiceEndpoint = nullptr;
-
     if (mAudioDataQueue != nullptr) {
         delete mAudioDataQueue;
         mAudioDataQueue = nullptr;
     }
+
+    AAudioEndpointManager &mEndpointManager = AAudioEndpointManager::getInstance();
+    mEndpointManager.closeEndpoint(endpoint);
+    mServiceEndpoint = nullptr;
+
     return AAudioServiceStreamBase::close();
 }
 
@@ -314,6 +338,11 @@ void AAudioServiceStreamShared::markTransferTime(int64_t nanoseconds) {
 
 aaudio_result_t AAudioServiceStreamShared::getFreeRunningPosition(int64_t *positionFrames,
                                                                 int64_t *timeNanos) {
+    // A shared capture endpoint tracks the position of its ring for all streams.
+    AAudioServiceEndpoint *endpoint = mServiceEndpoint;
+    if (endpoint != nullptr && endpoint->getSharedRingBuffer() != nullptr) {
+        return endpoint->getFreeRunningPosition(positionFrames, timeNanos);
+    }
     // TODO get these two numbers as an atomic pair
     *positionFrames = mMarkedPosition;
     *timeNanos = mMarkedTime;
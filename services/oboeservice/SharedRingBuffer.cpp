@@ -37,13 +37,8 @@ SharedRingBuffer::~SharedRingBuffer()
     }
 }
 
-aaudio_result_t SharedRingBuffer::allocate(fifo_frames_t   bytesPerFrame,
-                                         fifo_frames_t   capacityInFrames) {
-    mCapacityInFrames = capacityInFrames;
-
-    // Create shared memory large enough to hold the data and the read and write counters.
-    mDataMemorySizeInBytes = bytesPerFrame * capacityInFrames;
-    mSharedMemorySizeInBytes = mDataMemorySizeInBytes + (2 * (sizeof(fifo_counter_t)));
+aaudio_result_t SharedRingBuffer::allocateSharedMemory(int32_t sizeInBytes) {
+    mSharedMemorySizeInBytes = sizeInBytes;
     mFileDescriptor.reset(ashmem_create_region("AAudioSharedRingBuffer", mSharedMemorySizeInBytes));
     if (mFileDescriptor.get() == -1) {
         ALOGE("SharedRingBuffer::allocate() ashmem_create_region() failed %d", errno);
@@ -65,9 +60,24 @@ aaudio_result_t SharedRingBuffer::allocate(fifo_frames_t   bytesPerFrame,
                          mFileDescriptor.get(), 0);
     if (mSharedMemory == MAP_FAILED) {
         ALOGE("SharedRingBuffer::allocate() mmap() failed %d", errno);
+        mSharedMemory = nullptr;
         mFileDescriptor.reset();
         return AAUDIO_ERROR_INTERNAL; // TODO convert errno to a better AAUDIO_ERROR;
     }
+    return AAUDIO_OK;
+}
+
+aaudio_result_t SharedRingBuffer::allocate(fifo_frames_t   bytesPerFrame,
+                                         fifo_frames_t   capacityInFrames) {
+    mCapacityInFrames = capacityInFrames;
+
+    // Create shared memory large enough to hold the data and the read and write counters.
+    mDataMemorySizeInBytes = bytesPerFrame * capacityInFrames;
+    aaudio_result_t result = allocateSharedMemory(
+            mDataMemorySizeInBytes + (2 * (sizeof(fifo_counter_t))));
+    if (result != AAUDIO_OK) {
+        return result;
+    }
 
     // Get addresses for our counters and data from the shared memory.
     fifo_counter_t *readCounterAddress =
@@ -81,15 +91,60 @@ aaudio_result_t SharedRingBuffer::allocate(fifo_frames_t   bytesPerFrame,
     return AAUDIO_OK;
 }
 
+aaudio_result_t SharedRingBuffer::allocateReader(SharedRingBuffer *writerRing) {
+    mWriterRing = writerRing;
+    mCapacityInFrames = writerRing->mCapacityInFrames;
+    mDataMemorySizeInBytes = writerRing->mDataMemorySizeInBytes;
+
+    // Only the read counter is ours.
+    aaudio_result_t result = allocateSharedMemory(sizeof(fifo_counter_t));
+    if (result != AAUDIO_OK) {
+        return result;
+    }
+
+    fifo_counter_t *readCounterAddress =
+            (fifo_counter_t *) &mSharedMemory[SHARED_RINGBUFFER_READ_OFFSET];
+    fifo_counter_t *writeCounterAddress =
+            (fifo_counter_t *) &writerRing->mSharedMemory[SHARED_RINGBUFFER_WRITE_OFFSET];
+    uint8_t *dataAddress = &writerRing->mSharedMemory[SHARED_RINGBUFFER_DATA_OFFSET];
+
+    mFifoBuffer = new FifoBuffer(writerRing->mFifoBuffer->getBytesPerFrame(), mCapacityInFrames,
+                                 readCounterAddress, writeCounterAddress, dataAddress);
+    // Start reading at the current write position, so a late joiner does not see an overrun.
+    mFifoBuffer->setReadCounter(mFifoBuffer->getWriteCounter());
+    return AAUDIO_OK;
+}
+
+aaudio_result_t SharedRingBuffer::protectFromClients() {
+    int err = ashmem_set_prot_region(mFileDescriptor.get(), PROT_READ);
+    if (err < 0) {
+        ALOGE("SharedRingBuffer::protectFromClients() ashmem_set_prot_region() failed %d", errno);
+        return AAUDIO_ERROR_INTERNAL;
+    }
+    return AAUDIO_OK;
+}
+
 void SharedRingBuffer::fillParcelable(AudioEndpointParcelable &endpointParcelable,
                     RingBufferParcelable &ringBufferParcelable) {
     int fdIndex = endpointParcelable.addFileDescriptor(mFileDescriptor, mSharedMemorySizeInBytes);
-    ringBufferParcelable.setupMemory(fdIndex,
-                                     SHARED_RINGBUFFER_DATA_OFFSET,
-                                     mDataMemorySizeInBytes,
-                                     SHARED_RINGBUFFER_READ_OFFSET,
-                                     SHARED_RINGBUFFER_WRITE_OFFSET,
-                                     sizeof(fifo_counter_t));
+    if (mWriterRing != nullptr) {
+        int writerFdIndex = endpointParcelable.addFileDescriptor(
+                mWriterRing->mFileDescriptor, mWriterRing->mSharedMemorySizeInBytes);
+        ringBufferParcelable.setupMemory(fdIndex,
+                                         SHARED_RINGBUFFER_READ_OFFSET,
+                                         writerFdIndex,
+                                         SHARED_RINGBUFFER_DATA_OFFSET,
+                                         mDataMemorySizeInBytes,
+                                         SHARED_RINGBUFFER_WRITE_OFFSET,
+                                         sizeof(fifo_counter_t));
+    } else {
+        ringBufferParcelable.setupMemory(fdIndex,
+                                         SHARED_RINGBUFFER_DATA_OFFSET,
+                                         mDataMemorySizeInBytes,
+                                         SHARED_RINGBUFFER_READ_OFFSET,
+                                         SHARED_RINGBUFFER_WRITE_OFFSET,
+                                         sizeof(fifo_counter_t));
+    }
     ringBufferParcelable.setBytesPerFrame(mFifoBuffer->getBytesPerFrame());
     ringBufferParcelable.setFramesPerBurst(1);
     ringBufferParcelable.setCapacityInFrames(mCapacityInFrames);
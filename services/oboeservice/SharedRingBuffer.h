@@ -44,6 +44,19 @@ public:
 
     aaudio_result_t allocate(android::fifo_frames_t bytesPerFrame, android::fifo_frames_t capacityInFrames);
 
+    /**
+     * Allocate only a private read counter, and share the data and write counter of
+     * another SharedRingBuffer that must outlive this one.
+     * This lets several clients read the same data, each at its own position.
+     */
+    aaudio_result_t allocateReader(SharedRingBuffer *writerRing);
+
+    /**
+     * Make the shared memory read-only for anyone who maps it from now on, e.g. clients.
+     * Our own mapping stays writable.
+     */
+    aaudio_result_t protectFromClients();
+
     void fillParcelable(AudioEndpointParcelable &endpointParcelable,
                         RingBufferParcelable &ringBufferParcelable);
 
@@ -51,8 +64,16 @@ public:
         return mFifoBuffer;
     }
 
+    // For a writer that fills the data in place, without an intermediate buffer.
+    uint8_t * getDataAddress() {
+        return &mSharedMemory[SHARED_RINGBUFFER_DATA_OFFSET];
+    }
+
 private:
+    aaudio_result_t allocateSharedMemory(int32_t sizeInBytes);
+
     android::base::unique_fd  mFileDescriptor;
+    SharedRingBuffer         *mWriterRing = nullptr; // owns data and write counter if not null
     android::FifoBuffer      *mFifoBuffer = nullptr;
     uint8_t                  *mSharedMemory = nullptr;
     int32_t                   mSharedMemorySizeInBytes = 0;